@@ -28,6 +28,7 @@
 
 #include "llavatarappearance.h"
 #include "llavatarappearancedefines.h"
+#include "llavatardefinitioncache.h"
 #include "llavatarjointmesh.h"
 #include "llstl.h"
 #include "lldir.h"
@@ -161,6 +162,7 @@ LLAvatarAppearance::LLAvatarXmlInfo::~LLAvatarXmlInfo()
 //-----------------------------------------------------------------------------
 LLAvatarSkeletonInfo* LLAvatarAppearance::sAvatarSkeletonInfo = NULL;
 LLAvatarAppearance::LLAvatarXmlInfo* LLAvatarAppearance::sAvatarXmlInfo = NULL;
+std::string LLAvatarAppearance::sDefinitionCacheFile;
 LLAvatarAppearanceDefines::LLAvatarAppearanceDictionary* LLAvatarAppearance::sAvatarDictionary = NULL;
 
 
@@ -322,21 +324,34 @@ void LLAvatarAppearance::initClass(const std::string& avatar_file_name_arg, cons
         sAvatarDictionary = new LLAvatarAppearanceDefines::LLAvatarAppearanceDictionary();
     }
 
-    std::string avatar_file_name;
+    LLTimer load_timer;
 
-    if (!avatar_file_name_arg.empty())
+    std::string avatar_file_leaf = avatar_file_name_arg;
+    if (avatar_file_leaf.empty())
     {
-        avatar_file_name = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER,avatar_file_name_arg);
+        avatar_file_leaf = AVATAR_DEFAULT_CHAR + "_lad.xml";
     }
-    else
+    std::string avatar_file_name = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER, avatar_file_leaf);
+
+    // A warm start takes the parse trees and meshes from the cache; any
+    // failure along the way falls back on the definition files.
+    LLAvatarDefinitionCache cache;
+    bool warm = !sDefinitionCacheFile.empty() &&
+                cache.open(sDefinitionCacheFile, avatar_file_leaf, skeleton_file_name_arg);
+
+    LLXmlTree xml_tree;
+    LLXmlTree skeleton_xml_tree;
+    if (warm)
     {
-        avatar_file_name = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER,AVATAR_DEFAULT_CHAR + "_lad.xml");
+        warm = cache.loadXmlTrees(xml_tree, skeleton_xml_tree);
     }
-    LLXmlTree xml_tree;
-    BOOL success = xml_tree.parseFile( avatar_file_name, FALSE );
-    if (!success)
+    if (!warm)
     {
-        LL_ERRS() << "Problem reading avatar configuration file:" << avatar_file_name << LL_ENDL;
+        BOOL success = xml_tree.parseFile( avatar_file_name, FALSE );
+        if (!success)
+        {
+            LL_ERRS() << "Problem reading avatar configuration file:" << avatar_file_name << LL_ENDL;
+        }
     }
 
     // now sanity check xml file
@@ -374,7 +389,7 @@ void LLAvatarAppearance::initClass(const std::string& avatar_file_name_arg, cons
         return;
     }
 
-    std::string skeleton_file_name = skeleton_file_name_arg;
+    std::string skeleton_file_name = warm ? cache.getSkeletonFile() : skeleton_file_name_arg;
     if (skeleton_file_name.empty())
     {
         static LLStdStringHandle file_name_string = LLXmlTree::addAttributeString("file_name");
@@ -385,9 +400,8 @@ void LLAvatarAppearance::initClass(const std::string& avatar_file_name_arg, cons
     }
 
     std::string skeleton_path;
-    LLXmlTree skeleton_xml_tree;
     skeleton_path = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER,skeleton_file_name);
-    if (!parseSkeletonFile(skeleton_path, skeleton_xml_tree))
+    if (!warm && !parseSkeletonFile(skeleton_path, skeleton_xml_tree))
     {
         LL_ERRS() << "Error parsing skeleton file: " << skeleton_path << LL_ENDL;
     }
@@ -434,6 +448,46 @@ void LLAvatarAppearance::initClass(const std::string& avatar_file_name_arg, cons
     {
         LL_ERRS() << "Error parsing skeleton node in avatar XML file: " << skeleton_path << LL_ENDL;
     }
+
+    // The shared mesh data would otherwise be loaded along with the first
+    // avatar; a cold start loads it here so it can go into the cache.
+    if (warm)
+    {
+        warm = cache.loadMeshes();
+    }
+    cache.close();
+    if (!warm && !sDefinitionCacheFile.empty())
+    {
+        LLAvatarDefinitionCache::mesh_list_t meshes;
+        for (const LLAvatarXmlInfo::LLAvatarMeshInfo* info : sAvatarXmlInfo->mMeshInfoList)
+        {
+            if (std::find_if(meshes.begin(), meshes.end(),
+                             [info](const LLAvatarDefinitionCache::mesh_list_t::value_type& mesh)
+                             { return mesh.first == info->mMeshFileName; }) != meshes.end())
+            {
+                continue;
+            }
+            LLPolyMeshSharedData* reference_data = NULL;
+            if (!info->mReferenceMeshName.empty())
+            {
+                reference_data = LLPolyMesh::findSharedData(info->mReferenceMeshName);
+            }
+            if (!LLPolyMesh::loadSharedData(info->mMeshFileName, reference_data))
+            {
+                meshes.clear();
+                break;
+            }
+            meshes.emplace_back(info->mMeshFileName, info->mReferenceMeshName);
+        }
+        if (!meshes.empty())
+        {
+            LLAvatarDefinitionCache::save(sDefinitionCacheFile, avatar_file_leaf, skeleton_file_name,
+                                          xml_tree, skeleton_xml_tree, meshes);
+        }
+    }
+
+    LL_INFOS("Avatar") << "Loaded avatar definitions in " << load_timer.getElapsedTimeF64() * 1000.0 << " ms, "
+                       << (warm ? "warm start from cache" : "cold start") << LL_ENDL;
 }
 
 void LLAvatarAppearance::cleanupClass()
@@ -70,6 +70,9 @@ class LLAvatarAppearance : public LLCharacter
     static void         initClass(const std::string& avatar_file_name, const std::string& skeleton_file_name); // initializes static members
     static void         initClass();
     static void         cleanupClass(); // Cleanup data that's only init'd once per class.
+    // Where initClass() keeps a binary snapshot of the parsed definition
+    // files and meshes; empty to always parse them.
+    static void         setDefinitionCacheFile(const std::string& cache_file) { sDefinitionCacheFile = cache_file; }
     virtual void        initInstance(); // Called after construction to initialize the instance.
     S32                 mInitFlags;
     virtual BOOL        loadSkeletonNode();
@@ -221,6 +224,7 @@ class LLAvatarAppearance : public LLCharacter
 protected:
     static LLAvatarSkeletonInfo*                    sAvatarSkeletonInfo;
     static LLAvatarXmlInfo*                         sAvatarXmlInfo;
+    static std::string                              sDefinitionCacheFile;
 
 
 /**                    Skeleton
@@ -0,0 +1,495 @@
+/**
+ * @file llavatardefinitioncache.cpp
+ * @brief Binary snapshot of the avatar definition files, mapped at startup.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llavatardefinitioncache.h"
+
+#include <algorithm>
+
+#include "hbxxh.h"
+#include "lldir.h"
+#include "llfile.h"
+#include "llpolymesh.h"
+#include "llxmltree.h"
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Layout, all in native byte order:
+//  header
+//  avatar file name, skeleton file name
+//  source count, source file names
+//  avatar tree and skeleton tree, each a size and LLXmlTree::writeBinary()
+//  mesh count, then per mesh its name, reference mesh name and
+//      LLPolyMeshSharedData::writeCache()
+namespace
+{
+    const char CACHE_MAGIC[8] = { 'L', 'L', 'A', 'V', 'D', 'E', 'F', '\0' };
+
+    struct CacheHeader
+    {
+        char mMagic[8];
+        U64 mBuildId;       // see LLAvatarDefinitionCache::buildId()
+        U64 mSourceHash;
+        U64 mPayloadHash;   // of everything past the header
+        U64 mSize;
+    };
+
+    // Moves from over to, replacing it in one step.  rename() does that on
+    // POSIX, but _wrename(), and so LLFile::rename(), fails on Windows when
+    // to exists.
+    bool replace_file(const std::string& from, const std::string& to)
+    {
+#if LL_WINDOWS
+        return MoveFileExW(ll_convert_string_to_wide(from).c_str(), ll_convert_string_to_wide(to).c_str(),
+                           MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        return LLFile::rename(from, to) == 0;
+#endif
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Writer / Reader
+//-----------------------------------------------------------------------------
+void LLAvatarDefinitionCache::Writer::writeString(const std::string& str)
+{
+    write((U32)str.size());
+    write(str.data(), str.size());
+}
+
+bool LLAvatarDefinitionCache::Reader::read(void* data, size_t size)
+{
+    const U8* block = readBlock(size);
+    if (!block)
+    {
+        return false;
+    }
+    memcpy(data, block, size);
+    return true;
+}
+
+bool LLAvatarDefinitionCache::Reader::readString(std::string& str)
+{
+    U32 length;
+    const U8* block = read(length) ? readBlock(length) : NULL;
+    if (!block)
+    {
+        return false;
+    }
+    str.assign((const char*)block, length);
+    return true;
+}
+
+const U8* LLAvatarDefinitionCache::Reader::readBlock(size_t size)
+{
+    if ((size_t)(mEnd - mData) < size)
+    {
+        mData = mEnd;
+        return NULL;
+    }
+    const U8* block = mData;
+    mData += size;
+    return block;
+}
+
+//-----------------------------------------------------------------------------
+// LLAvatarDefinitionCache
+//-----------------------------------------------------------------------------
+LLAvatarDefinitionCache::LLAvatarDefinitionCache()
+    : mData(NULL),
+      mSize(0),
+#if LL_WINDOWS
+      mFileHandle(NULL),
+      mMappingHandle(NULL),
+#endif
+      mTrees(NULL)
+{
+}
+
+LLAvatarDefinitionCache::~LLAvatarDefinitionCache()
+{
+    close();
+}
+
+bool LLAvatarDefinitionCache::map(const std::string& cache_file)
+{
+#if LL_WINDOWS
+    HANDLE file = CreateFileW(ll_convert_string_to_wide(cache_file).c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    mFileHandle = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(CacheHeader))
+    {
+        return false;
+    }
+    mMappingHandle = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mMappingHandle)
+    {
+        return false;
+    }
+    mData = (const U8*)MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0);
+    mSize = mData ? (size_t)size.QuadPart : 0;
+#else
+    int fd = ::open(cache_file.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(CacheHeader))
+    {
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            mData = (const U8*)data;
+            mSize = st.st_size;
+        }
+    }
+    // the mapping stays valid without the descriptor
+    ::close(fd);
+#endif
+    return mData != NULL;
+}
+
+void LLAvatarDefinitionCache::close()
+{
+#if LL_WINDOWS
+    if (mData)
+    {
+        UnmapViewOfFile(mData);
+    }
+    if (mMappingHandle)
+    {
+        CloseHandle(mMappingHandle);
+        mMappingHandle = NULL;
+    }
+    if (mFileHandle)
+    {
+        CloseHandle(mFileHandle);
+        mFileHandle = NULL;
+    }
+#else
+    if (mData)
+    {
+        munmap((void*)mData, mSize);
+    }
+#endif
+    mData = NULL;
+    mSize = 0;
+    mTrees = NULL;
+    mSkeletonFile.clear();
+}
+
+bool LLAvatarDefinitionCache::open(const std::string& cache_file, const std::string& avatar_file,
+                                   const std::string& skeleton_file)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    close();
+    if (!map(cache_file))
+    {
+        LL_INFOS("Avatar") << "No avatar definition cache at " << cache_file << LL_ENDL;
+        close();
+        return false;
+    }
+
+    const CacheHeader* header = (const CacheHeader*)mData;
+    if (memcmp(header->mMagic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) || header->mBuildId != buildId())
+    {
+        LL_INFOS("Avatar") << "Ignoring avatar definition cache from another build" << LL_ENDL;
+        close();
+        return false;
+    }
+    // a truncated or damaged file
+    if (header->mSize != mSize ||
+        HBXXH64::digest(mData + sizeof(CacheHeader), mSize - sizeof(CacheHeader)) != header->mPayloadHash)
+    {
+        LL_WARNS("Avatar") << "Ignoring corrupt avatar definition cache " << cache_file << LL_ENDL;
+        close();
+        return false;
+    }
+
+    Reader reader(mData + sizeof(CacheHeader), mSize - sizeof(CacheHeader));
+    std::string cached_avatar_file;
+    U32 num_sources = 0;
+    bool ok = reader.readString(cached_avatar_file) && reader.readString(mSkeletonFile) &&
+              reader.read(num_sources);
+    // a handful in practice, anything more means a corrupt file
+    ok = ok && num_sources <= 256;
+    std::vector<std::string> sources(ok ? num_sources : 0);
+    for (std::string& source : sources)
+    {
+        ok = ok && reader.readString(source);
+    }
+    if (!ok || cached_avatar_file != avatar_file ||
+        (!skeleton_file.empty() && skeleton_file != mSkeletonFile))
+    {
+        LL_INFOS("Avatar") << "Avatar definition cache is for other files" << LL_ENDL;
+        close();
+        return false;
+    }
+
+    // Reading and hashing the sources is far cheaper than parsing them,
+    // and catches edits that keep sizes and dates.
+    U64 source_hash = hashSources(sources);
+    if (!source_hash || source_hash != header->mSourceHash)
+    {
+        LL_INFOS("Avatar") << "Avatar definition files changed, rebuilding the cache" << LL_ENDL;
+        close();
+        return false;
+    }
+
+    mTrees = reader.readBlock(0);
+    return true;
+}
+
+bool LLAvatarDefinitionCache::loadXmlTrees(LLXmlTree& avatar_tree, LLXmlTree& skeleton_tree)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    llassert(mTrees);
+    Reader reader(mTrees, mSize - (mTrees - mData));
+    for (LLXmlTree* tree : { &avatar_tree, &skeleton_tree })
+    {
+        U32 size = 0;
+        const U8* block = reader.read(size) ? reader.readBlock(size) : NULL;
+        if (!block || !tree->readBinary(block, size))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LLAvatarDefinitionCache::loadMeshes()
+{
+    LL_PROFILE_ZONE_SCOPED;
+    llassert(mTrees);
+    Reader reader(mTrees, mSize - (mTrees - mData));
+    for (S32 i = 0; i < 2; ++i)
+    {
+        U32 size = 0;
+        if (!reader.read(size) || !reader.readBlock(size))
+        {
+            return false;
+        }
+    }
+
+    U32 num_meshes = 0;
+    if (!reader.read(num_meshes))
+    {
+        return false;
+    }
+
+    // Nothing but this cache fills the mesh table before the first avatar,
+    // so a partial load is undone and the meshes are all read from file.
+    std::vector<std::string> added;
+    auto fail = [&added]()
+    {
+        for (const std::string& mesh_name : added)
+        {
+            LLPolyMesh::removeSharedData(mesh_name);
+        }
+        return false;
+    };
+
+    std::string name, reference_name;
+    for (U32 i = 0; i < num_meshes; ++i)
+    {
+        if (!reader.readString(name) || !reader.readString(reference_name))
+        {
+            return fail();
+        }
+
+        LLPolyMeshSharedData* reference_data = NULL;
+        if (!reference_name.empty())
+        {
+            reference_data = LLPolyMesh::findSharedData(reference_name);
+            if (!reference_data)
+            {
+                LL_WARNS("Avatar") << "Cached mesh " << name << " precedes its reference " << reference_name << LL_ENDL;
+                return fail();
+            }
+        }
+
+        LLPolyMeshSharedData* mesh_data = new LLPolyMeshSharedData();
+        if (!mesh_data->readCache(reader, reference_data))
+        {
+            LL_WARNS("Avatar") << "Corrupt avatar definition cache at mesh " << name << LL_ENDL;
+            delete mesh_data;
+            return fail();
+        }
+        if (LLPolyMesh::addSharedData(name, mesh_data))
+        {
+            added.push_back(name);
+        }
+        else
+        {
+            // already loaded, as on a second login attempt
+            delete mesh_data;
+        }
+    }
+    return true;
+}
+
+//static
+bool LLAvatarDefinitionCache::save(const std::string& cache_file, const std::string& avatar_file,
+                                   const std::string& skeleton_file, LLXmlTree& avatar_tree,
+                                   LLXmlTree& skeleton_tree, const mesh_list_t& meshes)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    std::vector<std::string> sources;
+    sources.push_back(avatar_file);
+    sources.push_back(skeleton_file);
+    for (const mesh_list_t::value_type& mesh : meshes)
+    {
+        if (std::find(sources.begin(), sources.end(), mesh.first) == sources.end())
+        {
+            sources.push_back(mesh.first);
+        }
+    }
+
+    CacheHeader header;
+    memcpy(header.mMagic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.mBuildId = buildId();
+    header.mSourceHash = hashSources(sources);
+    header.mPayloadHash = 0;
+    header.mSize = 0;
+    if (!header.mSourceHash)
+    {
+        return false;
+    }
+
+    std::string buffer;
+    Writer writer(buffer);
+    writer.write(header);
+    writer.writeString(avatar_file);
+    writer.writeString(skeleton_file);
+    writer.write((U32)sources.size());
+    for (const std::string& source : sources)
+    {
+        writer.writeString(source);
+    }
+
+    std::string tree_buffer;
+    for (LLXmlTree* tree : { &avatar_tree, &skeleton_tree })
+    {
+        tree_buffer.clear();
+        tree->writeBinary(tree_buffer);
+        writer.write((U32)tree_buffer.size());
+        writer.write(tree_buffer.data(), tree_buffer.size());
+    }
+
+    writer.write((U32)meshes.size());
+    for (const mesh_list_t::value_type& mesh : meshes)
+    {
+        LLPolyMeshSharedData* mesh_data = LLPolyMesh::findSharedData(mesh.first);
+        if (!mesh_data)
+        {
+            LL_WARNS("Avatar") << "Not caching avatar definitions, mesh " << mesh.first << " is not loaded" << LL_ENDL;
+            return false;
+        }
+        writer.writeString(mesh.first);
+        writer.writeString(mesh.second);
+        mesh_data->writeCache(writer);
+    }
+
+    header.mSize = buffer.size();
+    header.mPayloadHash = HBXXH64::digest(buffer.data() + sizeof(header), buffer.size() - sizeof(header));
+    memcpy(&buffer[0], &header, sizeof(header));
+
+    // Write then rename, so that a crash or a second instance never leaves
+    // a half written cache in place.
+    std::string temp_file = cache_file + ".tmp";
+    LLUniqueFile fp = LLFile::fopen(temp_file, "wb");
+    if (!fp)
+    {
+        LL_WARNS("Avatar") << "Can't create avatar definition cache " << temp_file << LL_ENDL;
+        return false;
+    }
+    bool written = fwrite(buffer.data(), 1, buffer.size(), fp) == buffer.size();
+    fp.close();
+    if (!written || !replace_file(temp_file, cache_file))
+    {
+        LL_WARNS("Avatar") << "Failed writing avatar definition cache " << cache_file << LL_ENDL;
+        LLFile::remove(temp_file);
+        return false;
+    }
+
+    LL_INFOS("Avatar") << "Saved avatar definition cache, " << buffer.size() / 1024 << " KB" << LL_ENDL;
+    return true;
+}
+
+//static
+U64 LLAvatarDefinitionCache::hashSources(const std::vector<std::string>& sources)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    HBXXH64 hash;
+    for (const std::string& source : sources)
+    {
+        hash.update(source);
+        LLFILE* fp = LLFile::fopen(gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER, source), "rb");
+        if (!fp)
+        {
+            LL_WARNS("Avatar") << "Can't read avatar definition file " << source << LL_ENDL;
+            return 0;
+        }
+        // reads to the end and closes the file
+        hash.update(fp);
+    }
+    return hash.digest();
+}
+
+//static
+U64 LLAvatarDefinitionCache::buildId()
+{
+    HBXXH64 hash;
+    // the structs written whole
+    const U32 sizes[] = { (U32)sizeof(void*), (U32)sizeof(LLVector2), (U32)sizeof(LLVector3),
+                          (U32)sizeof(LLVector4a), (U32)sizeof(LLQuaternion), (U32)sizeof(LLPolyFace) };
+    hash.update(sizes, sizeof(sizes));
+    // and the code writing them, which any rebuild of the viewer may change
+    llstat exe_stat;
+    const std::string& exe = gDirUtilp->getExecutablePathAndName();
+    if (!exe.empty() && LLFile::stat(exe, &exe_stat) == 0)
+    {
+        U64 exe_size = exe_stat.st_size;
+        U64 exe_time = exe_stat.st_mtime;
+        hash.update(&exe_size, sizeof(exe_size));
+        hash.update(&exe_time, sizeof(exe_time));
+    }
+    return hash.digest();
+}
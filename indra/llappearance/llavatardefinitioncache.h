@@ -0,0 +1,131 @@
+/**
+ * @file llavatardefinitioncache.h
+ * @brief Binary snapshot of the avatar definition files, mapped at startup.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLAVATARDEFINITIONCACHE_H
+#define LL_LLAVATARDEFINITIONCACHE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class LLXmlTree;
+
+//-----------------------------------------------------------------------------
+// LLAvatarDefinitionCache
+//
+// A binary snapshot of what LLAvatarAppearance reads from the character
+// directory at startup: the avatar_lad.xml and skeleton trees and the
+// shared data of every .llm mesh, morphs included. It is keyed on a hash of
+// the contents of all of those files, so changing any of them just makes
+// the next start rebuild it.
+//
+// A warm start maps the file and copies the arrays straight out of it,
+// rather than running expat and the field by field .llm reader. The file
+// is only ever read back by the build that wrote it on the same machine,
+// and only once its contents check out against the hash in its header.
+//-----------------------------------------------------------------------------
+class LLAvatarDefinitionCache
+{
+public:
+    // Appends to the snapshot being built; used by the classes that
+    // serialize themselves into it.
+    class Writer
+    {
+    public:
+        Writer(std::string& buffer) : mBuffer(buffer) {}
+
+        void write(const void* data, size_t size) { mBuffer.append((const char*)data, size); }
+        template<typename T>
+        void write(const T& value) { write(&value, sizeof(T)); }
+        void writeString(const std::string& str);
+
+    private:
+        std::string& mBuffer;
+    };
+
+    // Reads a mapped snapshot back; every read fails once the data runs out.
+    class Reader
+    {
+    public:
+        Reader(const U8* data, size_t size) : mData(data), mEnd(data + size) {}
+
+        bool read(void* data, size_t size);
+        template<typename T>
+        bool read(T& value) { return read(&value, sizeof(T)); }
+        bool readString(std::string& str);
+        // size bytes left in place, NULL if there are not that many
+        const U8* readBlock(size_t size);
+
+    private:
+        const U8* mData;
+        const U8* mEnd;
+    };
+
+    // name and reference mesh name, empty for a base mesh
+    typedef std::vector<std::pair<std::string, std::string> > mesh_list_t;
+
+    LLAvatarDefinitionCache();
+    ~LLAvatarDefinitionCache();
+
+    // Maps cache_file and checks that it was built from avatar_file and,
+    // when given, skeleton_file (both names in the character directory) and
+    // that none of its sources changed since.
+    bool open(const std::string& cache_file, const std::string& avatar_file, const std::string& skeleton_file);
+    void close();
+
+    // These are only valid after open() succeeded.
+    const std::string& getSkeletonFile() const { return mSkeletonFile; }
+    bool loadXmlTrees(LLXmlTree& avatar_tree, LLXmlTree& skeleton_tree);
+    // Adds every mesh in the snapshot to LLPolyMesh's shared mesh table.
+    bool loadMeshes();
+
+    // Snapshots both trees and the listed meshes, which must all have been
+    // loaded, into cache_file.
+    static bool save(const std::string& cache_file, const std::string& avatar_file,
+                     const std::string& skeleton_file, LLXmlTree& avatar_tree,
+                     LLXmlTree& skeleton_tree, const mesh_list_t& meshes);
+
+private:
+    bool map(const std::string& cache_file);
+
+    static U64 hashSources(const std::vector<std::string>& sources);
+    // Identifies the build writing or reading a snapshot, which holds raw
+    // structs and so is only good for the build that wrote it.
+    static U64 buildId();
+
+    const U8* mData;
+    size_t mSize;
+#if LL_WINDOWS
+    void* mFileHandle;
+    void* mMappingHandle;
+#endif
+
+    std::string mSkeletonFile;
+    // past the header and source list
+    const U8* mTrees;
+};
+
+#endif // LL_LLAVATARDEFINITIONCACHE_H
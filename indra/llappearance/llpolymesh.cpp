@@ -724,6 +724,176 @@ BOOL LLPolyMeshSharedData::loadMesh( const std::string& fileName )
         return status;
 }
 
+//-----------------------------------------------------------------------------
+// LLPolyMeshSharedData::writeCache()
+//-----------------------------------------------------------------------------
+void LLPolyMeshSharedData::writeCache(LLAvatarDefinitionCache::Writer& writer)
+{
+        writer.write(mPosition);
+        writer.write(mRotation);
+        writer.write(mScale);
+        writer.write(mNumVertices);
+
+        // LODs share the vertex data of their reference mesh
+        if (!isLOD())
+        {
+                writer.write((U8)mHasWeights);
+                writer.write((U8)mHasDetailTexCoords);
+                writer.write(mBaseCoords, sizeof(LLVector4a) * mNumVertices);
+                writer.write(mBaseNormals, sizeof(LLVector4a) * mNumVertices);
+                writer.write(mBaseBinormals, sizeof(LLVector4a) * mNumVertices);
+                writer.write(mTexCoords, sizeof(LLVector2) * mNumVertices);
+                if (mHasDetailTexCoords)
+                {
+                        writer.write(mDetailTexCoords, sizeof(LLVector2) * mNumVertices);
+                }
+                if (mHasWeights)
+                {
+                        writer.write(mWeights, sizeof(F32) * mNumVertices);
+                }
+        }
+
+        writer.write(mNumFaces);
+        writer.write(mFaces, sizeof(LLPolyFace) * mNumFaces);
+
+        writer.write(mNumJointNames);
+        for (U32 i = 0; i < mNumJointNames; i++)
+        {
+                writer.writeString(mJointNames[i]);
+        }
+
+        writer.write((U32)mMorphData.size());
+        for (LLPolyMorphData* morph_data : mMorphData)
+        {
+                morph_data->writeCache(writer);
+        }
+
+        writer.write((U32)mSharedVerts.size());
+        for (const std::map<S32, S32>::value_type& remap : mSharedVerts)
+        {
+                writer.write(remap.first);
+                writer.write(remap.second);
+        }
+}
+
+//-----------------------------------------------------------------------------
+// LLPolyMeshSharedData::readCache()
+//-----------------------------------------------------------------------------
+BOOL LLPolyMeshSharedData::readCache(LLAvatarDefinitionCache::Reader& reader, LLPolyMeshSharedData* reference_data)
+{
+        freeMeshData();
+        setupLOD(reference_data);
+
+        S32 numVertices;
+        if (!reader.read(mPosition) || !reader.read(mRotation) || !reader.read(mScale) ||
+            !reader.read(numVertices) || numVertices < 0 || numVertices > 0xFFFF)
+        {
+                return FALSE;
+        }
+
+        if (isLOD())
+        {
+                // the highest vertex its faces use, see loadMesh()
+                if (numVertices > mReferenceData->mNumVertices)
+                {
+                        return FALSE;
+                }
+                mNumVertices = numVertices;
+        }
+        else
+        {
+                U8 hasWeights, hasDetailTexCoords;
+                if (!reader.read(hasWeights) || !reader.read(hasDetailTexCoords))
+                {
+                        return FALSE;
+                }
+                mHasWeights = hasWeights ? TRUE : FALSE;
+                mHasDetailTexCoords = hasDetailTexCoords ? TRUE : FALSE;
+
+                allocateVertexData(numVertices);
+                if (!reader.read(mBaseCoords, sizeof(LLVector4a) * numVertices) ||
+                    !reader.read(mBaseNormals, sizeof(LLVector4a) * numVertices) ||
+                    !reader.read(mBaseBinormals, sizeof(LLVector4a) * numVertices) ||
+                    !reader.read(mTexCoords, sizeof(LLVector2) * numVertices) ||
+                    (mHasDetailTexCoords && !reader.read(mDetailTexCoords, sizeof(LLVector2) * numVertices)) ||
+                    (mHasWeights && !reader.read(mWeights, sizeof(F32) * numVertices)))
+                {
+                        return FALSE;
+                }
+        }
+
+        S32 numFaces;
+        if (!reader.read(numFaces) || numFaces < 0 || numFaces > 0xFFFF)
+        {
+                return FALSE;
+        }
+        allocateFaceData(numFaces);
+        if (!reader.read(mFaces, sizeof(LLPolyFace) * numFaces))
+        {
+                return FALSE;
+        }
+        for (S32 i = 0; i < numFaces; i++)
+        {
+                for (S32 j = 0; j < 3; j++)
+                {
+                        if (mFaces[i][j] < 0 || mFaces[i][j] >= mNumVertices)
+                        {
+                                LL_WARNS() << "Bad face " << i << " vertex " << mFaces[i][j] << LL_ENDL;
+                                return FALSE;
+                        }
+                }
+        }
+
+        U32 numJointNames;
+        if (!reader.read(numJointNames) || numJointNames > 0xFFFF)
+        {
+                return FALSE;
+        }
+        allocateJointNames(numJointNames);
+        for (U32 i = 0; i < numJointNames; i++)
+        {
+                if (!reader.readString(mJointNames[i]))
+                {
+                        return FALSE;
+                }
+        }
+
+        U32 numMorphs;
+        if (!reader.read(numMorphs))
+        {
+                return FALSE;
+        }
+        for (U32 i = 0; i < numMorphs; i++)
+        {
+                LLPolyMorphData* morph_data = new LLPolyMorphData(LLStringUtil::null);
+                if (!morph_data->readCache(reader, this))
+                {
+                        delete morph_data;
+                        return FALSE;
+                }
+                mMorphData.insert(morph_data);
+        }
+
+        U32 numRemaps;
+        if (!reader.read(numRemaps))
+        {
+                return FALSE;
+        }
+        for (U32 i = 0; i < numRemaps; i++)
+        {
+                S32 remapSrc;
+                S32 remapDst;
+                if (!reader.read(remapSrc) || !reader.read(remapDst) ||
+                    remapSrc < 0 || remapSrc >= mNumVertices || remapDst < 0 || remapDst >= mNumVertices)
+                {
+                        return FALSE;
+                }
+                mSharedVerts[remapSrc] = remapDst;
+        }
+
+        return TRUE;
+}
+
 //-----------------------------------------------------------------------------
 // getSharedVert()
 //-----------------------------------------------------------------------------
@@ -764,6 +934,7 @@ LLPolyMesh::LLPolyMesh(LLPolyMeshSharedData *shared_data, LLPolyMesh *reference_
     mFaceIndexOffset = 0;
     mFaceVertexCount = 0;
     mFaceVertexOffset = 0;
+    mMorphSerial = 0;
 
     if (shared_data->isLOD() && reference_mesh)
     {
@@ -801,6 +972,7 @@ LLPolyMesh::LLPolyMesh(LLPolyMeshSharedData *shared_data, LLPolyMesh *reference_
         mScaledNormals      =   (LLVector4a*)(mVertexData + offset); offset += 4*nverts;
         mBinormals          =   (LLVector4a*)(mVertexData + offset); offset += 4*nverts;
         mScaledBinormals    =   (LLVector4a*)(mVertexData + offset); offset += 4*nverts;
+        mMorphedVertexFlags.resize(nverts, 0);
         initializeForMorph();
     }
 }
@@ -820,16 +992,29 @@ LLPolyMesh::~LLPolyMesh()
 // LLPolyMesh::getMesh()
 //-----------------------------------------------------------------------------
 LLPolyMesh *LLPolyMesh::getMesh(const std::string &name, LLPolyMesh* reference_mesh)
+{
+        LLPolyMeshSharedData* mesh_data = loadSharedData(name, reference_mesh ? reference_mesh->getSharedData() : NULL);
+        if (!mesh_data)
+        {
+                return NULL;
+        }
+
+        return new LLPolyMesh(mesh_data, reference_mesh);
+}
+
+//-----------------------------------------------------------------------------
+// LLPolyMesh::loadSharedData()
+//-----------------------------------------------------------------------------
+LLPolyMeshSharedData *LLPolyMesh::loadSharedData(const std::string &name, LLPolyMeshSharedData* reference_data)
 {
         //-------------------------------------------------------------------------
         // search for an existing mesh by this name
         //-------------------------------------------------------------------------
-        LLPolyMeshSharedData* meshSharedData = get_if_there(sGlobalSharedMeshList, name, (LLPolyMeshSharedData*)NULL);
+        LLPolyMeshSharedData* meshSharedData = findSharedData(name);
         if (meshSharedData)
         {
 //              LL_INFOS() << "Polymesh " << name << " found in global mesh table." << LL_ENDL;
-                LLPolyMesh *poly_mesh = new LLPolyMesh(meshSharedData, reference_mesh);
-                return poly_mesh;
+                return meshSharedData;
         }
 
         //-------------------------------------------------------------------------
@@ -839,9 +1024,9 @@ LLPolyMesh *LLPolyMesh::getMesh(const std::string &name, LLPolyMesh* reference_m
         full_path = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER,name);
 
         LLPolyMeshSharedData *mesh_data = new LLPolyMeshSharedData();
-        if (reference_mesh)
+        if (reference_data)
         {
-                mesh_data->setupLOD(reference_mesh->getSharedData());
+                mesh_data->setupLOD(reference_data);
         }
         if ( ! mesh_data->loadMesh( full_path ) )
         {
@@ -849,12 +1034,39 @@ LLPolyMesh *LLPolyMesh::getMesh(const std::string &name, LLPolyMesh* reference_m
                 return NULL;
         }
 
-        LLPolyMesh *poly_mesh = new LLPolyMesh(mesh_data, reference_mesh);
-
 //      LL_INFOS() << "Polymesh " << name << " added to global mesh table." << LL_ENDL;
-        sGlobalSharedMeshList[name] = poly_mesh->mSharedData;
+        sGlobalSharedMeshList[name] = mesh_data;
 
-        return poly_mesh;
+        return mesh_data;
+}
+
+//-----------------------------------------------------------------------------
+// LLPolyMesh::findSharedData()
+//-----------------------------------------------------------------------------
+LLPolyMeshSharedData *LLPolyMesh::findSharedData(const std::string &name)
+{
+        return get_if_there(sGlobalSharedMeshList, name, (LLPolyMeshSharedData*)NULL);
+}
+
+//-----------------------------------------------------------------------------
+// LLPolyMesh::addSharedData()
+//-----------------------------------------------------------------------------
+bool LLPolyMesh::addSharedData(const std::string &name, LLPolyMeshSharedData *shared_data)
+{
+        return sGlobalSharedMeshList.emplace(name, shared_data).second;
+}
+
+//-----------------------------------------------------------------------------
+// LLPolyMesh::removeSharedData()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::removeSharedData(const std::string &name)
+{
+        LLPolyMeshSharedDataTable::iterator iter = sGlobalSharedMeshList.find(name);
+        if (iter != sGlobalSharedMeshList.end())
+        {
+                delete iter->second;
+                sGlobalSharedMeshList.erase(iter);
+        }
 }
 
 //-----------------------------------------------------------------------------
@@ -972,6 +1184,89 @@ LLVector4a *LLPolyMesh::getScaledBinormals()
 }
 
 
+//-----------------------------------------------------------------------------
+// queueMorph()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::queueMorph(const LLPolyMorphData* morph_data, const F32* mask_weights, F32 weight, bool clothing)
+{
+    llassert(!isLOD());
+    mQueuedMorphs.push_back({ morph_data, mask_weights, weight, clothing });
+}
+
+//-----------------------------------------------------------------------------
+// applyMorphQueue()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::applyMorphQueue()
+{
+    LL_PROFILE_ZONE_SCOPED;
+    for (const QueuedMorph& morph : mQueuedMorphs)
+    {
+        const LLPolyMorphData* morph_data = morph.mMorphData;
+        const F32* mask_weights = morph.mMaskWeights;
+        LLVector4a* clothing_weights = morph.mClothing ? mClothingWeights : NULL;
+
+        const LLVector4a* delta = morph_data->mDeltas;
+        const U32* vertex_indices = morph_data->mVertexIndices;
+        for (U32 vert_index_morph = 0; vert_index_morph < morph_data->mNumIndices; vert_index_morph++, delta += LLPolyMorphData::DELTA_STRIDE)
+        {
+            U32 vert_index_mesh = vertex_indices[vert_index_morph];
+
+            F32 mask_weight = mask_weights ? mask_weights[vert_index_morph] : 1.f;
+            LLVector4a weight;
+            weight.splat(morph.mWeight * mask_weight);
+
+            LLVector4a t;
+            t.setMul(delta[0], weight);
+            mCoords[vert_index_mesh].add(t);
+
+            if (clothing_weights)
+            {
+                LLVector4a& clothing_weight = clothing_weights[vert_index_mesh];
+                clothing_weight.add(t);
+                clothing_weight.getF32ptr()[VW] = mask_weight;
+            }
+
+            t.setMul(delta[1], weight);
+            mScaledNormals[vert_index_mesh].add(t);
+
+            t.setMul(delta[2], weight);
+            mScaledBinormals[vert_index_mesh].add(t);
+
+            t.setMul(delta[3], weight);
+            mTexCoords[vert_index_mesh].mV[VX] += t[VX];
+            mTexCoords[vert_index_mesh].mV[VY] += t[VY];
+
+            dirtyMorphedVertex(vert_index_mesh);
+        }
+    }
+    mQueuedMorphs.clear();
+}
+
+//-----------------------------------------------------------------------------
+// renormalizeMorphedVertices()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::renormalizeMorphedVertices()
+{
+    LL_PROFILE_ZONE_SCOPED;
+    ++mMorphSerial;
+    for (U32 index : mMorphedVertices)
+    {
+        // calculate new normals based on half angles
+        LLVector4a norm = mScaledNormals[index];
+        norm.normalize3fast();
+        mNormals[index] = norm;
+
+        // calculate new binormals
+        LLVector4a tangent;
+        tangent.setCross3(mScaledBinormals[index], norm);
+        mBinormals[index].setCross3(norm, tangent);
+        mBinormals[index].normalize3fast();
+
+        mMorphedVertexFlags[index] = 0;
+    }
+    mMorphedVertices.clear();
+}
+
 //-----------------------------------------------------------------------------
 // initializeForMorph()
 //-----------------------------------------------------------------------------
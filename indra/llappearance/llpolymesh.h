@@ -29,6 +29,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include "llstl.h"
 
 #include "v3math.h"
@@ -132,6 +133,11 @@ class LLPolyMeshSharedData
     BOOL loadMesh( const std::string& fileName );
 
 public:
+    // Binary form for LLAvatarDefinitionCache; reference_data is the base
+    // mesh of an LOD mesh, as passed to setupLOD().
+    void writeCache(LLAvatarDefinitionCache::Writer& writer);
+    BOOL readCache(LLAvatarDefinitionCache::Reader& reader, LLPolyMeshSharedData* reference_data);
+
     void genIndices(S32 offset);
 
     const LLVector2 &getUVs(U32 index);
@@ -139,6 +145,8 @@ class LLPolyMeshSharedData
     const S32   *getSharedVert(S32 vert);
 
     BOOL isLOD() { return (mReferenceData != NULL); }
+
+    S32 getNumVertices() const { return mNumVertices; }
 };
 
 
@@ -168,6 +176,22 @@ class LLPolyMesh
     // otherwise it is loaded from file, added to the table, and returned.
     static LLPolyMesh *getMesh( const std::string &name, LLPolyMesh* reference_mesh = NULL);
 
+    // Finds the shared data of a mesh in the global mesh table, loading
+    // it from file if it isn't there yet. Returns NULL on failure.
+    static LLPolyMeshSharedData *loadSharedData( const std::string &name, LLPolyMeshSharedData* reference_data = NULL);
+
+    // The shared data of a mesh already in the global mesh table, or NULL.
+    static LLPolyMeshSharedData *findSharedData( const std::string &name );
+
+    // Adds shared data loaded by other means, i.e. from the avatar
+    // definition cache, to the global mesh table. Returns false, leaving
+    // shared_data with the caller, if a mesh by that name is already there.
+    static bool addSharedData( const std::string &name, LLPolyMeshSharedData *shared_data );
+
+    // Takes a mesh added by addSharedData() out of the global mesh table
+    // again and frees it, before any LLPolyMesh uses it.
+    static void removeSharedData( const std::string &name );
+
     // Frees all loaded meshes.
     // This should only be called once you know there are no outstanding
     // references to these objects.  Generally, upon exit of the application.
@@ -215,21 +239,24 @@ class LLPolyMesh
         return mSharedData->mHasWeights;
     }
 
-    // Get coords
-    const LLVector4a    *getCoords() const{
+    // Get coords, with any queued morphs applied
+    const LLVector4a    *getCoords() {
+        getReferenceMesh()->applyQueuedMorphs();
         return mCoords;
     }
 
     // non const version
     LLVector4a *getWritableCoords();
 
-    // Get normals
-    const LLVector4a    *getNormals() const{
+    // Get normals, up to date with the morphs applied so far
+    const LLVector4a    *getNormals() {
+        getReferenceMesh()->applyQueuedMorphs();
         return mNormals;
     }
 
     // Get normals
-    const LLVector4a    *getBinormals() const{
+    const LLVector4a    *getBinormals() {
+        getReferenceMesh()->applyQueuedMorphs();
         return mBinormals;
     }
 
@@ -252,8 +279,40 @@ class LLPolyMesh
     LLVector4a *getWritableBinormals();
     LLVector4a *getScaledBinormals();
 
+    // Morph targets don't touch the mesh when their weight changes, they
+    // queue the change here. The queue is applied in one pass the next time
+    // the mesh is read, and only adds to the scaled normals and binormals,
+    // flagging each vertex it moves. Output normals and binormals of the
+    // flagged vertices are then worked out once, however many morphs moved
+    // them. mask_weights must stay valid until the queue is applied.
+    void queueMorph(const LLPolyMorphData* morph_data, const F32* mask_weights, F32 weight, bool clothing);
+    void dirtyMorphedVertex(U32 index)
+    {
+        if (!mMorphedVertexFlags[index])
+        {
+            mMorphedVertexFlags[index] = 1;
+            mMorphedVertices.push_back(index);
+        }
+    }
+    void applyQueuedMorphs()
+    {
+        if (!mQueuedMorphs.empty())
+        {
+            applyMorphQueue();
+        }
+        if (!mMorphedVertices.empty())
+        {
+            renormalizeMorphedVertices();
+        }
+    }
+
+    // Bumped whenever applying morphs moves any vertex, so that a copy of
+    // the mesh can tell whether it is out of date.
+    U32 getMorphSerial() { return getReferenceMesh()->mMorphSerial; }
+
     // Get texCoords
-    const LLVector2 *getTexCoords() const {
+    const LLVector2 *getTexCoords() {
+        getReferenceMesh()->applyQueuedMorphs();
         return mTexCoords;
     }
 
@@ -278,6 +337,7 @@ class LLPolyMesh
 
     const LLVector4a        *getClothingWeights()
     {
+        getReferenceMesh()->applyQueuedMorphs();
         return mClothingWeights;
     }
 
@@ -330,6 +390,8 @@ class LLPolyMesh
     U32             mCurVertexCount;
 private:
     void initializeForMorph();
+    void applyMorphQueue();
+    void renormalizeMorphedVertices();
 
     // Dumps diagnostic information about the global mesh table
     static void dumpDiagInfo();
@@ -354,6 +416,19 @@ class LLPolyMesh
     // output texture coordinates
     LLVector2               *mTexCoords;
 
+    // see queueMorph()
+    struct QueuedMorph
+    {
+        const LLPolyMorphData*  mMorphData;
+        const F32*              mMaskWeights;
+        F32                     mWeight;
+        bool                    mClothing;
+    };
+    std::vector<QueuedMorph> mQueuedMorphs;
+    std::vector<U8>         mMorphedVertexFlags;
+    std::vector<U32>        mMorphedVertices;
+    U32                     mMorphSerial;
+
     LLPolyMesh              *mReferenceMesh;
 
     // global mesh list
@@ -57,6 +57,7 @@ LLPolyMorphData::LLPolyMorphData(const std::string& morph_name)
     mNormals = NULL;
     mBinormals = NULL;
     mTexCoords = NULL;
+    mDeltas = NULL;
 
     mMesh = NULL;
 }
@@ -71,7 +72,9 @@ LLPolyMorphData::LLPolyMorphData(const LLPolyMorphData &rhs) :
     mCoords(NULL),
     mNormals(NULL),
     mBinormals(NULL),
-    mTexCoords(NULL)
+    mTexCoords(NULL),
+    mDeltas(NULL),
+    mMesh(rhs.mMesh)
 {
     const S32 numVertices = mNumIndices;
 
@@ -91,6 +94,8 @@ LLPolyMorphData::LLPolyMorphData(const LLPolyMorphData &rhs) :
         mTexCoords[v] = rhs.mTexCoords[v];
         mVertexIndices[v] = rhs.mVertexIndices[v];
     }
+
+    packDeltas();
 }
 
 //-----------------------------------------------------------------------------
@@ -213,9 +218,118 @@ BOOL LLPolyMorphData::loadBinary(LLFILE *fp, LLPolyMeshSharedData *mesh)
     mAvgDistortion.mul(1.f/(F32)mNumIndices);
     mAvgDistortion.normalize3fast();
 
+    packDeltas();
+
+    return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// writeCache()
+//-----------------------------------------------------------------------------
+void LLPolyMorphData::writeCache(LLAvatarDefinitionCache::Writer& writer) const
+{
+    writer.writeString(mName);
+    writer.write(mNumIndices);
+    writer.write(mTotalDistortion);
+    writer.write(mMaxDistortion);
+    writer.write(mAvgDistortion);
+    writer.write(mVertexIndices, sizeof(U32) * mNumIndices);
+    writer.write(mCoords, sizeof(LLVector4a) * mNumIndices);
+    writer.write(mNormals, sizeof(LLVector4a) * mNumIndices);
+    writer.write(mBinormals, sizeof(LLVector4a) * mNumIndices);
+    writer.write(mTexCoords, sizeof(LLVector2) * mNumIndices);
+}
+
+//-----------------------------------------------------------------------------
+// readCache()
+//-----------------------------------------------------------------------------
+BOOL LLPolyMorphData::readCache(LLAvatarDefinitionCache::Reader& reader, LLPolyMeshSharedData *mesh)
+{
+    freeData();
+
+    U32 num_indices;
+    if (!reader.readString(mName) || !reader.read(num_indices) || num_indices > 10000 ||
+        !reader.read(mTotalDistortion) || !reader.read(mMaxDistortion) || !reader.read(mAvgDistortion))
+    {
+        return FALSE;
+    }
+
+    U32 size = sizeof(LLVector4a) * num_indices;
+    mCoords = static_cast<LLVector4a*>(ll_aligned_malloc_16(size));
+    mNormals = static_cast<LLVector4a*>(ll_aligned_malloc_16(size));
+    mBinormals = static_cast<LLVector4a*>(ll_aligned_malloc_16(size));
+    mTexCoords = new LLVector2[num_indices];
+    mVertexIndices = new U32[num_indices];
+    mNumIndices = num_indices;
+    mMesh = mesh;
+
+    if (!reader.read(mVertexIndices, sizeof(U32) * num_indices) ||
+        !reader.read(mCoords, size) ||
+        !reader.read(mNormals, size) ||
+        !reader.read(mBinormals, size) ||
+        !reader.read(mTexCoords, sizeof(LLVector2) * num_indices))
+    {
+        return FALSE;
+    }
+
+    // apply() trusts these to be in the mesh
+    for (U32 v = 0; v < num_indices; v++)
+    {
+        if (mVertexIndices[v] >= (U32)mesh->getNumVertices())
+        {
+            LL_WARNS() << "Bad morph index " << v << ": " << mVertexIndices[v] << LL_ENDL;
+            return FALSE;
+        }
+    }
+
+    packDeltas();
+
     return TRUE;
 }
 
+//-----------------------------------------------------------------------------
+// packDeltas()
+//-----------------------------------------------------------------------------
+void LLPolyMorphData::packDeltas()
+{
+    if (mDeltas != NULL)
+    {
+        ll_aligned_free_16(mDeltas);
+        mDeltas = NULL;
+    }
+
+    if (!mNumIndices)
+    {
+        return;
+    }
+
+    mDeltas = static_cast<LLVector4a*>(ll_aligned_malloc_16(sizeof(LLVector4a) * DELTA_STRIDE * mNumIndices));
+
+    LLVector4a soften;
+    soften.splat(NORMAL_SOFTEN_FACTOR);
+
+    LLVector4a* delta = mDeltas;
+    for (U32 v = 0; v < mNumIndices; v++, delta += DELTA_STRIDE)
+    {
+        delta[0] = mCoords[v];
+        delta[0].getF32ptr()[VW] = 0.f;
+
+        delta[1].setMul(mNormals[v], soften);
+        delta[1].getF32ptr()[VW] = 0.f;
+
+        // guard against degenerate input data before we create NaNs when applied!
+        LLVector4a binorm = mBinormals[v];
+        if (!binorm.isFinite3() || (binorm.dot3(binorm).getF32() <= F_APPROXIMATELY_ZERO))
+        {
+            binorm.set(1,0,0,1);
+        }
+        delta[2].setMul(binorm, soften);
+        delta[2].getF32ptr()[VW] = 0.f;
+
+        delta[3].set(mTexCoords[v].mV[VX], mTexCoords[v].mV[VY], 0.f, 0.f);
+    }
+}
+
 //-----------------------------------------------------------------------------
 // freeData()
 //-----------------------------------------------------------------------------
@@ -250,6 +364,12 @@ void LLPolyMorphData::freeData()
         delete [] mVertexIndices;
         mVertexIndices = NULL;
     }
+
+    if (mDeltas != NULL)
+    {
+        ll_aligned_free_16(mDeltas);
+        mDeltas = NULL;
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -571,76 +691,18 @@ void LLPolyMorphTarget::apply( ESex avatar_sex )
     if (delta_weight != 0.f)
     {
         llassert(!mMesh->isLOD());
-        LLVector4a *coords = mMesh->getWritableCoords();
-
-        LLVector4a *scaled_normals = mMesh->getScaledNormals();
-        LLVector4a *normals = mMesh->getWritableNormals();
-
-        LLVector4a *scaled_binormals = mMesh->getScaledBinormals();
-        LLVector4a *binormals = mMesh->getWritableBinormals();
-
-        LLVector4a *clothing_weights = mMesh->getWritableClothingWeights();
-        LLVector2 *tex_coords = mMesh->getWritableTexCoords();
-
         F32 *maskWeightArray = (mVertMask) ? mVertMask->getMorphMaskWeights() : NULL;
 
-        for(U32 vert_index_morph = 0; vert_index_morph < mMorphData->mNumIndices; vert_index_morph++)
+        if (!mMorphData->mDeltas)
         {
-            S32 vert_index_mesh = mMorphData->mVertexIndices[vert_index_morph];
-
-            F32 maskWeight = 1.f;
-            if (maskWeightArray)
-            {
-                maskWeight = maskWeightArray[vert_index_morph];
-            }
-
-
-            LLVector4a pos = mMorphData->mCoords[vert_index_morph];
-            pos.mul(delta_weight*maskWeight);
-            coords[vert_index_mesh].add(pos);
-
-            if (getInfo()->mIsClothingMorph && clothing_weights)
-            {
-                LLVector4a clothing_offset = mMorphData->mCoords[vert_index_morph];
-                clothing_offset.mul(delta_weight * maskWeight);
-                LLVector4a* clothing_weight = &clothing_weights[vert_index_mesh];
-                clothing_weight->add(clothing_offset);
-                clothing_weight->getF32ptr()[VW] = maskWeight;
-            }
-
-            // calculate new normals based on half angles
-            LLVector4a norm = mMorphData->mNormals[vert_index_morph];
-            norm.mul(delta_weight*maskWeight*NORMAL_SOFTEN_FACTOR);
-            scaled_normals[vert_index_mesh].add(norm);
-            norm = scaled_normals[vert_index_mesh];
-
-            // guard against degenerate input data before we create NaNs below!
-            //
-            norm.normalize3fast();
-            normals[vert_index_mesh] = norm;
-
-            // calculate new binormals
-            LLVector4a binorm = mMorphData->mBinormals[vert_index_morph];
-
-            // guard against degenerate input data before we create NaNs below!
-            //
-            if (!binorm.isFinite3() || (binorm.dot3(binorm).getF32() <= F_APPROXIMATELY_ZERO))
-            {
-                binorm.set(1,0,0,1);
-            }
-
-            binorm.mul(delta_weight*maskWeight*NORMAL_SOFTEN_FACTOR);
-            scaled_binormals[vert_index_mesh].add(binorm);
-            LLVector4a tangent;
-            tangent.setCross3(scaled_binormals[vert_index_mesh], norm);
-            LLVector4a& normalized_binormal = binormals[vert_index_mesh];
-
-            normalized_binormal.setCross3(norm, tangent);
-            normalized_binormal.normalize3fast();
-
-            tex_coords[vert_index_mesh] += mMorphData->mTexCoords[vert_index_morph] * delta_weight * maskWeight;
+            mMorphData->packDeltas();
         }
 
+        // The vertices are moved, together with those of every other morph
+        // changed since, the next time the mesh is read, see
+        // LLPolyMesh::queueMorph().
+        mMesh->queueMorph(mMorphData, maskWeightArray, delta_weight, getInfo()->mIsClothingMorph);
+
         // now apply volume changes
         for(LLPolyVolumeMorph& volume_morph : mVolumeMorphs)
         {
@@ -664,6 +726,9 @@ void LLPolyMorphTarget::apply( ESex avatar_sex )
 //-----------------------------------------------------------------------------
 void    LLPolyMorphTarget::applyMask(U8 *maskTextureData, S32 width, S32 height, S32 num_components, BOOL invert)
 {
+    // the queue may still be using the current mask weights
+    mMesh->applyQueuedMorphs();
+
     LLVector4a *clothing_weights = getInfo()->mIsClothingMorph ? mMesh->getWritableClothingWeights() : NULL;
 
     if (!mVertMask)
@@ -690,36 +755,42 @@ void    LLPolyMorphTarget::applyMask(U8 *maskTextureData, S32 width, S32 height,
             clothing_mask.setElement<2>();
 
 
-            for(U32 vert = 0; vert < mMorphData->mNumIndices; vert++)
+            if (!mMorphData->mDeltas)
             {
-                F32 lastMaskWeight = mLastWeight * maskWeights[vert];
+                mMorphData->packDeltas();
+            }
+
+            const LLVector4a* delta = mMorphData->mDeltas;
+            for(U32 vert = 0; vert < mMorphData->mNumIndices; vert++, delta += LLPolyMorphData::DELTA_STRIDE)
+            {
+                LLVector4a lastMaskWeight;
+                lastMaskWeight.splat(mLastWeight * maskWeights[vert]);
                 S32 out_vert = mMorphData->mVertexIndices[vert];
 
                 // remove effect of existing masked morph
                 LLVector4a t;
-                t = mMorphData->mCoords[vert];
-                t.mul(lastMaskWeight);
+                t.setMul(delta[0], lastMaskWeight);
                 coords[out_vert].sub(t);
 
-                t = mMorphData->mNormals[vert];
-                t.mul(lastMaskWeight*NORMAL_SOFTEN_FACTOR);
+                if (clothing_weights)
+                {
+                    LLVector4a* clothing_weight = &clothing_weights[out_vert];
+                    LLVector4a c;
+                    c.setSub(*clothing_weight, t);
+                    clothing_weight->setSelectWithMask(clothing_mask, c, *clothing_weight);
+                }
+
+                t.setMul(delta[1], lastMaskWeight);
                 scaled_normals[out_vert].sub(t);
 
-                t = mMorphData->mBinormals[vert];
-                t.mul(lastMaskWeight*NORMAL_SOFTEN_FACTOR);
+                t.setMul(delta[2], lastMaskWeight);
                 scaled_binormals[out_vert].sub(t);
 
-                tex_coords[out_vert] -= mMorphData->mTexCoords[vert] * lastMaskWeight;
+                t.setMul(delta[3], lastMaskWeight);
+                tex_coords[out_vert].mV[VX] -= t[VX];
+                tex_coords[out_vert].mV[VY] -= t[VY];
 
-                if (clothing_weights)
-                {
-                    LLVector4a clothing_offset = mMorphData->mCoords[vert];
-                    clothing_offset.mul(lastMaskWeight);
-                    LLVector4a* clothing_weight = &clothing_weights[out_vert];
-                    LLVector4a t;
-                    t.setSub(*clothing_weight, clothing_offset);
-                    clothing_weight->setSelectWithMask(clothing_mask, t, *clothing_weight);
-                }
+                mMesh->dirtyMorphedVertex(out_vert);
             }
         }
     }
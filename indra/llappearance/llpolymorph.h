@@ -31,6 +31,7 @@
 #include <vector>
 
 #include "llviewervisualparam.h"
+#include "llavatardefinitioncache.h"
 
 class LLAvatarJointCollisionVolume;
 class LLPolyMeshSharedData;
@@ -52,6 +53,13 @@ class alignas(16) LLPolyMorphData
     BOOL            loadBinary(LLFILE* fp, LLPolyMeshSharedData *mesh);
     const std::string& getName() { return mName; }
 
+    // Binary form for LLAvatarDefinitionCache
+    void            writeCache(LLAvatarDefinitionCache::Writer& writer) const;
+    BOOL            readCache(LLAvatarDefinitionCache::Reader& reader, LLPolyMeshSharedData *mesh);
+
+    // Rebuilds mDeltas from the arrays below; call after changing them.
+    void            packDeltas();
+
 public:
     std::string         mName;
 
@@ -64,6 +72,11 @@ class alignas(16) LLPolyMorphData
     LLVector4a*         mBinormals;
     LLVector2*          mTexCoords;
 
+    // The same deltas as applied, DELTA_STRIDE vectors per index: coords,
+    // normal and binormal scaled by NORMAL_SOFTEN_FACTOR, and texcoords.
+    static const U32    DELTA_STRIDE = 4;
+    LLVector4a*         mDeltas;
+
     F32                 mTotalDistortion;   // vertex distortion summed over entire morph
     F32                 mMaxDistortion;     // maximum single vertex distortion in a given morph
     LLVector4a          mAvgDistortion;     // average vertex distortion, to infer directionality of the morph
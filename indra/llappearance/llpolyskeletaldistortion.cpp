@@ -242,6 +242,7 @@ LLPolyMorphData *clone_morph_param_direction(const LLPolyMorphData *src_data,
                 cloned_morph_data->mNormals[v].clear();
                 cloned_morph_data->mBinormals[v].clear();
         }
+        cloned_morph_data->packDeltas();
         return cloned_morph_data;
 }
 
@@ -273,6 +274,7 @@ LLPolyMorphData *clone_morph_param_cleavage(const LLPolyMorphData *src_data,
                 cloned_morph_data->mBinormals[v].setMul(src_data->mBinormals[v],sc);
             }
         }
+        cloned_morph_data->packDeltas();
         return cloned_morph_data;
 }
 
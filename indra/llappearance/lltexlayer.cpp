@@ -524,6 +524,45 @@ void LLTexLayerSet::renderAlphaMaskTextures(S32 x, S32 y, S32 width, S32 height,
     gGL.setSceneBlendType(LLRender::BT_ALPHA);
 }
 
+BOOL LLTexLayerSet::buildComposite(LLTexLayerCompositor& compositor, const LLTexLayerInterface::image_source_t& source)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    BOOL success = TRUE;
+    compositor.mVisible = true;
+    for (LLTexLayerInterface* layer : mMaskLayerList)
+    {
+        if (layer->isInvisibleAlphaMask())
+        {
+            compositor.mVisible = false;
+        }
+    }
+    if (!compositor.mVisible)
+    {
+        return success;
+    }
+
+    for (LLTexLayerInterface* layer : mLayerList)
+    {
+        if (layer->getRenderPass() == LLTexLayer::RP_COLOR)
+        {
+            success &= layer->addToComposite(compositor, source);
+        }
+    }
+
+    // as renderAlphaMaskTextures()
+    const LLTexLayerSetInfo *info = getInfo();
+    if (!info->mStaticAlphaFileName.empty())
+    {
+        compositor.mStaticAlpha = LLTexLayerStaticImageList::getInstance()->getImageRaw(info->mStaticAlphaFileName, TRUE);
+    }
+    compositor.mClearAlpha = info->mClearAlpha || !mMaskLayerList.empty();
+    for (LLTexLayerInterface* layer : mMaskLayerList)
+    {
+        success &= layer->addAlphaMaskToComposite(compositor, source);
+    }
+    return success;
+}
+
 void LLTexLayerSet::applyMorphMask(U8* tex_data, S32 width, S32 height, S32 num_components)
 {
     mAvatarAppearance->applyMorphMask(tex_data, width, height, num_components, mBakedTexIndex);
@@ -1176,6 +1215,88 @@ BOOL LLTexLayer::render(S32 x, S32 y, S32 width, S32 height, LLRenderTarget* bou
     return success;
 }
 
+BOOL LLTexLayer::addToComposite(LLTexLayerCompositor& compositor, const image_source_t& source)
+{
+    LLTexLayerCompositor::Layer layer;
+    BOOL color_specified = findNetColor(&layer.mColor);
+    if (mTexLayerSet->getAvatarAppearance()->mIsDummy)
+    {
+        color_specified = true;
+        layer.mColor = LLAvatarAppearance::getDummyColor();
+    }
+    if (is_approx_zero(layer.mColor.mV[VW]))
+    {
+        return TRUE;
+    }
+
+    BOOL success = TRUE;
+    layer.mName = getName();
+    const LLTexLayerInfo* info = getInfo();
+
+    // the local texture render() would bind, if any
+    LLPointer<LLImageRaw> local_image;
+    LLGLTexture* tex = mLocalTextureObject ? mLocalTextureObject->getImage() : NULL;
+    if (info->mLocalTexture != -1 && tex)
+    {
+        local_image = source(tex);
+        if (local_image.isNull())
+        {
+            return FALSE;
+        }
+    }
+
+    if (!mParamAlphaList.empty())
+    {
+        LLTexLayerParamAlpha* first_param = *mParamAlphaList.begin();
+        layer.mClearMorphMask = !first_param || !first_param->getMultiplyBlend();
+        for (LLTexLayerParamAlpha* param : mParamAlphaList)
+        {
+            success &= param->addToComposite(layer.mAlphaParams);
+        }
+        if (layer.mAlphaParams.empty())
+        {
+            // every param was skipped; the layer is still drawn through
+            // its (cleared or kept) mask, so leave a no-op in its place
+            LLTexLayerCompositor::AlphaParam param;
+            param.mWeight = 1.f;
+            param.mMultiply = true;
+            layer.mAlphaParams.push_back(param);
+        }
+        if (local_image.notNull() && tex->getComponents() == 4)
+        {
+            layer.mMaskTexture = local_image;
+        }
+        if (!info->mStaticImageFileName.empty() && info->mStaticImageIsMask)
+        {
+            layer.mMaskStaticImage = LLTexLayerStaticImageList::getInstance()->getImageRaw(info->mStaticImageFileName, TRUE);
+        }
+        layer.mKeepMorphMask = hasMorph();
+    }
+
+    layer.mWriteAllChannels = info->mWriteAllChannels;
+
+    if (!info->mUseLocalTextureAlphaOnly && mLocalTextureObject && mLocalTextureObject->getID() != IMG_DEFAULT_AVATAR)
+    {
+        layer.mTexture = local_image;
+    }
+
+    if (!info->mStaticImageFileName.empty())
+    {
+        layer.mStaticImage = LLTexLayerStaticImageList::getInstance()->getImageRaw(info->mStaticImageFileName, info->mStaticImageIsMask);
+        if (layer.mStaticImage.isNull())
+        {
+            success = FALSE;
+        }
+    }
+
+    layer.mDrawColor = ((-1 == info->mLocalTexture) || info->mUseLocalTextureAlphaOnly) &&
+                       info->mStaticImageFileName.empty() &&
+                       color_specified;
+
+    compositor.mLayers.push_back(layer);
+    return success;
+}
+
 const U8*   LLTexLayer::getAlphaData() const
 {
     LLCRC alpha_mask_crc;
@@ -1280,6 +1401,33 @@ BOOL LLTexLayer::blendAlphaTexture(S32 x, S32 y, S32 width, S32 height)
     return success;
 }
 
+BOOL LLTexLayer::addAlphaMaskToComposite(LLTexLayerCompositor& compositor, const image_source_t& source)
+{
+    if (!getInfo()->mStaticImageFileName.empty())
+    {
+        LLPointer<LLImageRaw> image = LLTexLayerStaticImageList::getInstance()->getImageRaw(getInfo()->mStaticImageFileName, getInfo()->mStaticImageIsMask);
+        if (image.isNull())
+        {
+            return FALSE;
+        }
+        compositor.mAlphaMasks.push_back(image);
+    }
+    else if (getInfo()->mLocalTexture >= 0 && getInfo()->mLocalTexture < TEX_NUM_INDICES)
+    {
+        LLGLTexture* tex = mLocalTextureObject ? mLocalTextureObject->getImage() : NULL;
+        if (tex)
+        {
+            LLPointer<LLImageRaw> image = source(tex);
+            if (image.isNull())
+            {
+                return FALSE;
+            }
+            compositor.mAlphaMasks.push_back(image);
+        }
+    }
+    return TRUE;
+}
+
 /*virtual*/ void LLTexLayer::gatherAlphaMasks(U8 *data, S32 originX, S32 originY, S32 width, S32 height, LLRenderTarget* bound_target)
 {
     addAlphaMask(data, originX, originY, width, height, bound_target);
@@ -1470,14 +1618,7 @@ void LLTexLayer::addAlphaMask(U8 *data, S32 originX, S32 originY, S32 width, S32
     }
     if (alphaData)
     {
-        for( S32 i = 0; i < size; i++ )
-        {
-            U8 curAlpha = data[i];
-            U16 resultAlpha = curAlpha;
-            resultAlpha *= ( ((U16)alphaData[i]) + 1);
-            resultAlpha = resultAlpha >> 8;
-            data[i] = (U8)resultAlpha;
-        }
+        LLTexLayerCompositor::multiplyAlphaMask(data, alphaData, size);
     }
 }
 
@@ -1642,6 +1783,45 @@ LLTexLayer* LLTexLayerTemplate::getLayer(U32 i) const
     return success;
 }
 
+/*virtual*/ BOOL LLTexLayerTemplate::addToComposite(LLTexLayerCompositor& compositor, const image_source_t& source)
+{
+    if (!mInfo)
+    {
+        return FALSE;
+    }
+
+    BOOL success = TRUE;
+    updateWearableCache();
+    for (LLWearable* wearable : mWearableCache)
+    {
+        LLLocalTextureObject *lto = wearable ? wearable->getLocalTextureObject(mInfo->mLocalTexture) : NULL;
+        LLTexLayer *layer = lto ? lto->getTexLayer(getName()) : NULL;
+        if (layer)
+        {
+            // as render(), so that colors and params are this wearable's
+            wearable->writeToAvatar(mAvatarAppearance);
+            layer->setLTO(lto);
+            success &= layer->addToComposite(compositor, source);
+        }
+    }
+    return success;
+}
+
+/*virtual*/ BOOL LLTexLayerTemplate::addAlphaMaskToComposite(LLTexLayerCompositor& compositor, const image_source_t& source)
+{
+    BOOL success = TRUE;
+    U32 num_wearables = updateWearableCache();
+    for (U32 i = 0; i < num_wearables; i++)
+    {
+        LLTexLayer *layer = getLayer(i);
+        if (layer)
+        {
+            success &= layer->addAlphaMaskToComposite(compositor, source);
+        }
+    }
+    return success;
+}
+
 /*virtual*/ void LLTexLayerTemplate::gatherAlphaMasks(U8 *data, S32 originX, S32 originY, S32 width, S32 height, LLRenderTarget* bound_target)
 {
     U32 num_wearables = updateWearableCache();
@@ -1748,6 +1928,7 @@ void LLTexLayerSet::cloneTemplates(LLLocalTextureObject *lto, LLAvatarAppearance
 LLTexLayerStaticImageList::LLTexLayerStaticImageList() :
     mGLBytes(0),
     mTGABytes(0),
+    mRawBytes(0),
     mImageNames(16384)
 {
 }
@@ -1761,24 +1942,28 @@ void LLTexLayerStaticImageList::dumpByteCount() const
 {
     LL_INFOS() << "Avatar Static Textures " <<
         "KB GL:" << (mGLBytes / 1024) <<
-        "KB TGA:" << (mTGABytes / 1024) << "KB" << LL_ENDL;
+        "KB TGA:" << (mTGABytes / 1024) <<
+        "KB Raw:" << (mRawBytes / 1024) << "KB" << LL_ENDL;
 }
 
 void LLTexLayerStaticImageList::deleteCachedImages()
 {
-    if( mGLBytes || mTGABytes )
+    if( mGLBytes || mTGABytes || mRawBytes )
     {
         LL_INFOS() << "Clearing Static Textures " <<
             "KB GL:" << (mGLBytes / 1024) <<
-            "KB TGA:" << (mTGABytes / 1024) << "KB" << LL_ENDL;
+            "KB TGA:" << (mTGABytes / 1024) <<
+            "KB Raw:" << (mRawBytes / 1024) << "KB" << LL_ENDL;
 
         //mStaticImageLists uses LLPointers, clear() will cause deletion
 
         mStaticImageListTGA.clear();
         mStaticImageList.clear();
+        mStaticImageListRaw.clear();
 
         mGLBytes = 0;
         mTGABytes = 0;
+        mRawBytes = 0;
     }
 }
 
@@ -1864,6 +2049,38 @@ LLGLTexture* LLTexLayerStaticImageList::getTexture(const std::string& file_name,
     return tex;
 }
 
+// Returns the decoded data from a tga file named file_name, converted as
+// getTexture() would before uploading it. Caches the result; only the CPU
+// compositor keeps static images in memory this way.
+LLImageRaw* LLTexLayerStaticImageList::getImageRaw(const std::string& file_name, BOOL is_mask)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    const char *namekey = mImageNames.addString(file_name);
+    image_raw_map_t::const_iterator iter = mStaticImageListRaw.find(namekey);
+    if (iter != mStaticImageListRaw.end())
+    {
+        return iter->second;
+    }
+
+    LLPointer<LLImageRaw> image_raw = new LLImageRaw;
+    if (!loadImageRaw(file_name, image_raw))
+    {
+        return NULL;
+    }
+    if ((image_raw->getComponents() == 1) && is_mask)
+    {
+        LLPointer<LLImageRaw> alpha_image_raw = image_raw;
+        image_raw = new LLImageRaw(image_raw->getWidth(),
+                                   image_raw->getHeight(),
+                                   4);
+
+        image_raw->copyUnscaledAlphaMask(alpha_image_raw, LLColor4U::black);
+    }
+    mStaticImageListRaw[namekey] = image_raw;
+    mRawBytes += image_raw->getDataSize();
+    return image_raw;
+}
+
 // Reads a .tga file, decodes it, and puts the decoded data in image_raw.
 // Returns TRUE if successful.
 BOOL LLTexLayerStaticImageList::loadImageRaw(const std::string& file_name, LLImageRaw* image_raw)
@@ -28,6 +28,7 @@
 #define LL_LLTEXLAYER_H
 
 #include <deque>
+#include <functional>
 #include "llglslshader.h"
 #include "llgltexture.h"
 #include "llavatarappearancedefines.h"
@@ -70,6 +71,13 @@ class LLTexLayerInterface
     virtual BOOL            blendAlphaTexture(S32 x, S32 y, S32 width, S32 height) = 0;
     virtual BOOL            isInvisibleAlphaMask() const = 0;
 
+    // The pixels of a local texture, or NULL if they are not available.
+    typedef std::function<LLPointer<LLImageRaw>(LLGLTexture* tex)> image_source_t;
+    // Add what render() and blendAlphaTexture() would draw to compositor;
+    // FALSE if an image could not be had.
+    virtual BOOL            addToComposite(LLTexLayerCompositor& compositor, const image_source_t& source) = 0;
+    virtual BOOL            addAlphaMaskToComposite(LLTexLayerCompositor& compositor, const image_source_t& source) = 0;
+
     const LLTexLayerInfo*   getInfo() const             { return mInfo; }
     virtual BOOL            setInfo(const LLTexLayerInfo *info, LLWearable* wearable); // sets mInfo, calls initialization functions
     LLWearableType::EType   getWearableType() const;
@@ -124,6 +132,8 @@ class LLTexLayerTemplate final : public LLTexLayerInterface
     /*virtual*/ BOOL        render(S32 x, S32 y, S32 width, S32 height, LLRenderTarget* bound_target) override;
     /*virtual*/ BOOL        setInfo(const LLTexLayerInfo *info, LLWearable* wearable) override; // This sets mInfo and calls initialization functions
     /*virtual*/ BOOL        blendAlphaTexture(S32 x, S32 y, S32 width, S32 height) override; // Multiplies a single alpha texture against the frame buffer
+    /*virtual*/ BOOL        addToComposite(LLTexLayerCompositor& compositor, const image_source_t& source) override;
+    /*virtual*/ BOOL        addAlphaMaskToComposite(LLTexLayerCompositor& compositor, const image_source_t& source) override;
     /*virtual*/ void        gatherAlphaMasks(U8 *data, S32 originX, S32 originY, S32 width, S32 height, LLRenderTarget* bound_target) override;
     /*virtual*/ void        setHasMorph(BOOL newval) override;
     /*virtual*/ void        deleteCaches() override;
@@ -159,6 +169,8 @@ class LLTexLayer final : public LLTexLayerInterface
 
     BOOL                    findNetColor(LLColor4* color) const;
     /*virtual*/ BOOL        blendAlphaTexture(S32 x, S32 y, S32 width, S32 height) override; // Multiplies a single alpha texture against the frame buffer
+    /*virtual*/ BOOL        addToComposite(LLTexLayerCompositor& compositor, const image_source_t& source) override;
+    /*virtual*/ BOOL        addAlphaMaskToComposite(LLTexLayerCompositor& compositor, const image_source_t& source) override;
     /*virtual*/ void        gatherAlphaMasks(U8 *data, S32 originX, S32 originY, S32 width, S32 height, LLRenderTarget* bound_target) override;
     void                    renderMorphMasks(S32 x, S32 y, S32 width, S32 height, const LLColor4 &layer_color, LLRenderTarget* bound_target, bool force_render);
     void                    addAlphaMask(U8 *data, S32 originX, S32 originY, S32 width, S32 height, LLRenderTarget* bound_target);
@@ -201,6 +213,10 @@ class LLTexLayerSet
 
     BOOL                        render(S32 x, S32 y, S32 width, S32 height, LLRenderTarget* bound_target = nullptr);
     void                        renderAlphaMaskTextures(S32 x, S32 y, S32 width, S32 height, LLRenderTarget* bound_target = nullptr, bool forceClear = false);
+    // Snapshots what render() would draw into compositor, which can then
+    // composite on the CPU and off the main thread. FALSE if any image
+    // could not be had from source, in which case render() is the only way.
+    BOOL                        buildComposite(LLTexLayerCompositor& compositor, const LLTexLayerInterface::image_source_t& source);
 
     BOOL                        isBodyRegion(const std::string& region) const;
     void                        applyMorphMask(U8* tex_data, S32 width, S32 height, S32 num_components);
@@ -296,6 +312,8 @@ class LLTexLayerStaticImageList final : public LLSingleton<LLTexLayerStaticImage
 public:
     LLGLTexture*        getTexture(const std::string& file_name, BOOL is_mask);
     LLImageTGA*         getImageTGA(const std::string& file_name);
+    // the pixels getTexture() would upload
+    LLImageRaw*         getImageRaw(const std::string& file_name, BOOL is_mask);
     void                deleteCachedImages();
     void                dumpByteCount() const;
 protected:
@@ -306,8 +324,11 @@ class LLTexLayerStaticImageList final : public LLSingleton<LLTexLayerStaticImage
     texture_map_t       mStaticImageList;
     typedef std::map<const char*, LLPointer<LLImageTGA> > image_tga_map_t;
     image_tga_map_t     mStaticImageListTGA;
+    typedef std::map<const char*, LLPointer<LLImageRaw> > image_raw_map_t;
+    image_raw_map_t     mStaticImageListRaw;
     S32                 mGLBytes;
     S32                 mTGABytes;
+    S32                 mRawBytes;
 };
 
 #endif  // LL_LLTEXLAYER_H
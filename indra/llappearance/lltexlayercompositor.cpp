@@ -0,0 +1,638 @@
+/**
+ * @file lltexlayercompositor.cpp
+ * @brief CPU compositing of avatar texture layer sets.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lltexlayercompositor.h"
+
+#include "llimagetga.h"
+#include "llmath.h"
+#include "workqueue.h"
+
+#include <algorithm>
+#include <emmintrin.h>
+
+namespace
+{
+    // The blend a draw runs with; see LLTexLayer::render().
+    enum EBlend
+    {
+        BLEND_SOURCE_ALPHA, // BT_ALPHA
+        BLEND_DEST_ALPHA,   // BF_DEST_ALPHA, BF_ONE_MINUS_DEST_ALPHA
+        BLEND_REPLACE       // BT_REPLACE
+    };
+
+    // gAlphaMaskProgram's minimum alpha of 0.004, in units of 255 * 255:
+    // a fragment is dropped when texture alpha times color alpha is below
+    // it.
+    const S32 ALPHA_TEST_MIN = 260;
+
+    inline U8 div255(U32 x)
+    {
+        x += 128;
+        return (U8)((x + (x >> 8)) >> 8);
+    }
+
+    // x / 255, rounded, in each 16 bit lane
+    inline __m128i div255(__m128i x)
+    {
+        x = _mm_add_epi16(x, _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    }
+
+    // each pixel's alpha lane copied over the pixel, two pixels per register
+    inline __m128i broadcastAlpha(__m128i x)
+    {
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm_shufflehi_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    inline U8 toU8(F32 f)
+    {
+        return (U8)ll_round(llclamp(f, 0.f, 1.f) * 255.f);
+    }
+
+    //-------------------------------------------------------------------------
+    // sampling
+
+    // Halves src along each axis that is at least twice dst_size, as the
+    // next mip level down would.
+    LLPointer<LLImageRaw> reduce(const LLImageRaw* src, S32 dst_width, S32 dst_height)
+    {
+        LLPointer<LLImageRaw> image = const_cast<LLImageRaw*>(src);
+        const S32 comps = src->getComponents();
+        while (image->getWidth() >= dst_width * 2 || image->getHeight() >= dst_height * 2)
+        {
+            const S32 src_width = image->getWidth();
+            const S32 src_height = image->getHeight();
+            const S32 step_x = src_width >= dst_width * 2 ? 2 : 1;
+            const S32 step_y = src_height >= dst_height * 2 ? 2 : 1;
+            const S32 width = src_width / step_x;
+            const S32 height = src_height / step_y;
+            LLPointer<LLImageRaw> half = new LLImageRaw(width, height, comps);
+            const U8* in = image->getData();
+            U8* out = half->getData();
+            const S32 count = step_x * step_y;
+            for (S32 y = 0; y < height; ++y)
+            {
+                for (S32 x = 0; x < width; ++x)
+                {
+                    for (S32 c = 0; c < comps; ++c)
+                    {
+                        U32 sum = 0;
+                        for (S32 j = 0; j < step_y; ++j)
+                        {
+                            for (S32 i = 0; i < step_x; ++i)
+                            {
+                                sum += in[((y * step_y + j) * src_width + x * step_x + i) * comps + c];
+                            }
+                        }
+                        *out++ = (U8)((sum + count / 2) / count);
+                    }
+                }
+            }
+            image = half;
+        }
+        return image;
+    }
+
+    // src stretched over dst_width x dst_height with bilinear filtering and
+    // clamped edges, keeping its components.
+    LLPointer<LLImageRaw> stretch(const LLImageRaw* src, S32 dst_width, S32 dst_height)
+    {
+        LLPointer<LLImageRaw> image = reduce(src, dst_width, dst_height);
+        const S32 src_width = image->getWidth();
+        const S32 src_height = image->getHeight();
+        if (src_width == dst_width && src_height == dst_height)
+        {
+            return image;
+        }
+
+        const S32 comps = image->getComponents();
+        LLPointer<LLImageRaw> dst = new LLImageRaw(dst_width, dst_height, comps);
+        const U8* in = image->getData();
+        U8* out = dst->getData();
+
+        // 8 bit filter weights, the subtexel precision GL hardware uses
+        std::vector<S32> x0(dst_width), x1(dst_width), wx(dst_width);
+        for (S32 x = 0; x < dst_width; ++x)
+        {
+            F32 u = llclamp((x + 0.5f) * src_width / dst_width - 0.5f, 0.f, (F32)(src_width - 1));
+            x0[x] = (S32)u * comps;
+            x1[x] = llmin((S32)u + 1, src_width - 1) * comps;
+            wx[x] = ll_round((u - (S32)u) * 256.f);
+        }
+        for (S32 y = 0; y < dst_height; ++y)
+        {
+            F32 v = llclamp((y + 0.5f) * src_height / dst_height - 0.5f, 0.f, (F32)(src_height - 1));
+            const S32 y0 = (S32)v;
+            const S32 y1 = llmin(y0 + 1, src_height - 1);
+            const U32 wy = ll_round((v - y0) * 256.f);
+            const U8* row0 = in + y0 * src_width * comps;
+            const U8* row1 = in + y1 * src_width * comps;
+            for (S32 x = 0; x < dst_width; ++x)
+            {
+                const U32 w1 = wx[x];
+                const U32 w0 = 256 - w1;
+                for (S32 c = 0; c < comps; ++c)
+                {
+                    const U32 top = row0[x0[x] + c] * w0 + row0[x1[x] + c] * w1;
+                    const U32 bottom = row1[x0[x] + c] * w0 + row1[x1[x] + c] * w1;
+                    *out++ = (U8)((top * (256 - wy) + bottom * wy + 32768) >> 16);
+                }
+            }
+        }
+        return dst;
+    }
+
+    // src as GL would sample it into RGBA: luminance is grey, and missing
+    // alpha is opaque.
+    LLPointer<LLImageRaw> toRGBA(const LLImageRaw* src, S32 width, S32 height)
+    {
+        LLPointer<LLImageRaw> image = stretch(src, width, height);
+        const S32 comps = image->getComponents();
+        if (comps == 4)
+        {
+            return image;
+        }
+        LLPointer<LLImageRaw> rgba = new LLImageRaw(width, height, 4);
+        const U8* in = image->getData();
+        U8* out = rgba->getData();
+        for (S32 i = 0, count = width * height; i < count; ++i, in += comps, out += 4)
+        {
+            switch (comps)
+            {
+                case 1:
+                    out[0] = out[1] = out[2] = in[0];
+                    out[3] = 255;
+                    break;
+                case 2:
+                    out[0] = out[1] = out[2] = in[0];
+                    out[3] = in[1];
+                    break;
+                default:
+                    out[0] = in[0];
+                    out[1] = in[1];
+                    out[2] = in[2];
+                    out[3] = 255;
+                    break;
+            }
+        }
+        return rgba;
+    }
+
+    // The alpha channel of src as toRGBA() samples it.
+    std::vector<U8> toAlpha(const LLImageRaw* src, S32 width, S32 height)
+    {
+        std::vector<U8> alpha(width * height);
+        LLPointer<LLImageRaw> image = toRGBA(src, width, height);
+        const U8* in = image->getData();
+        for (size_t i = 0; i < alpha.size(); ++i)
+        {
+            alpha[i] = in[i * 4 + 3];
+        }
+        return alpha;
+    }
+
+    //-------------------------------------------------------------------------
+    // RGBA kernels
+
+    // One draw of tex (or a flat color when tex is NULL) tinted by color
+    // into dst, under the given blend and alpha test.
+    template <EBlend blend>
+    void drawRGBA(U8* dst, const U8* tex, const U8 color[4], bool alpha_test, S32 count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi16(255);
+        const __m128i color16 = _mm_setr_epi16(color[0], color[1], color[2], color[3],
+                                               color[0], color[1], color[2], color[3]);
+        // alpha test on the unsigned products, biased into signed range
+        const __m128i bias = _mm_set1_epi16((short)0x8000);
+        const __m128i test_min = _mm_set1_epi16((short)(ALPHA_TEST_MIN ^ 0x8000));
+        const __m128i flat = _mm_setr_epi16(255, 255, 255, 255, 255, 255, 255, 255);
+
+        S32 i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+            __m128i t = tex ? _mm_loadu_si128((const __m128i*)(tex + i * 4)) : zero;
+
+            __m128i d_lo = _mm_unpacklo_epi8(d, zero);
+            __m128i d_hi = _mm_unpackhi_epi8(d, zero);
+            __m128i t_lo = tex ? _mm_unpacklo_epi8(t, zero) : flat;
+            __m128i t_hi = tex ? _mm_unpackhi_epi8(t, zero) : flat;
+
+            __m128i raw_lo = _mm_mullo_epi16(t_lo, color16);
+            __m128i raw_hi = _mm_mullo_epi16(t_hi, color16);
+            __m128i s_lo = div255(raw_lo);
+            __m128i s_hi = div255(raw_hi);
+
+            __m128i r_lo, r_hi;
+            if (blend == BLEND_REPLACE)
+            {
+                r_lo = s_lo;
+                r_hi = s_hi;
+            }
+            else
+            {
+                __m128i f_lo = broadcastAlpha(blend == BLEND_SOURCE_ALPHA ? s_lo : d_lo);
+                __m128i f_hi = broadcastAlpha(blend == BLEND_SOURCE_ALPHA ? s_hi : d_hi);
+                r_lo = div255(_mm_add_epi16(_mm_mullo_epi16(s_lo, f_lo),
+                                            _mm_mullo_epi16(d_lo, _mm_sub_epi16(ones, f_lo))));
+                r_hi = div255(_mm_add_epi16(_mm_mullo_epi16(s_hi, f_hi),
+                                            _mm_mullo_epi16(d_hi, _mm_sub_epi16(ones, f_hi))));
+            }
+
+            if (alpha_test)
+            {
+                __m128i keep_lo = broadcastAlpha(_mm_cmpgt_epi16(_mm_xor_si128(raw_lo, bias), test_min));
+                __m128i keep_hi = broadcastAlpha(_mm_cmpgt_epi16(_mm_xor_si128(raw_hi, bias), test_min));
+                r_lo = _mm_or_si128(_mm_and_si128(keep_lo, r_lo), _mm_andnot_si128(keep_lo, d_lo));
+                r_hi = _mm_or_si128(_mm_and_si128(keep_hi, r_hi), _mm_andnot_si128(keep_hi, d_hi));
+            }
+
+            _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_packus_epi16(r_lo, r_hi));
+        }
+
+        for (; i < count; ++i)
+        {
+            U8* d = dst + i * 4;
+            U32 raw[4];
+            U8 s[4];
+            for (S32 c = 0; c < 4; ++c)
+            {
+                raw[c] = (tex ? tex[i * 4 + c] : 255) * color[c];
+                s[c] = div255(raw[c]);
+            }
+            if (alpha_test && (S32)raw[3] <= ALPHA_TEST_MIN)
+            {
+                continue;
+            }
+            if (blend == BLEND_REPLACE)
+            {
+                memcpy(d, s, 4);
+                continue;
+            }
+            const U32 f = blend == BLEND_SOURCE_ALPHA ? s[3] : d[3];
+            for (S32 c = 0; c < 4; ++c)
+            {
+                d[c] = div255(s[c] * f + d[c] * (255 - f));
+            }
+        }
+    }
+
+    void draw(EBlend blend, U8* dst, const U8* tex, const U8 color[4], bool alpha_test, S32 count)
+    {
+        switch (blend)
+        {
+            case BLEND_SOURCE_ALPHA:
+                drawRGBA<BLEND_SOURCE_ALPHA>(dst, tex, color, alpha_test, count);
+                break;
+            case BLEND_DEST_ALPHA:
+                drawRGBA<BLEND_DEST_ALPHA>(dst, tex, color, alpha_test, count);
+                break;
+            case BLEND_REPLACE:
+                drawRGBA<BLEND_REPLACE>(dst, tex, color, alpha_test, count);
+                break;
+        }
+    }
+
+    void fillRGBA(U8* dst, const U8 color[4], S32 count)
+    {
+        U32 pixel;
+        memcpy(&pixel, color, 4);
+        U32* out = (U32*)dst;
+        std::fill(out, out + count, pixel);
+    }
+
+    //-------------------------------------------------------------------------
+    // alpha plane kernels, for draws with only the alpha channel enabled
+
+    void getAlpha(const U8* rgba, U8* alpha, S32 count)
+    {
+        for (S32 i = 0; i < count; ++i)
+        {
+            alpha[i] = rgba[i * 4 + 3];
+        }
+    }
+
+    void setAlpha(U8* rgba, const U8* alpha, S32 count)
+    {
+        for (S32 i = 0; i < count; ++i)
+        {
+            rgba[i * 4 + 3] = alpha[i];
+        }
+    }
+
+    // alpha = src * scale / 255 * alpha / 255, for BT_MULT_ALPHA; src NULL
+    // is a flat 255
+    void multiplyAlpha(U8* alpha, const U8* src, U8 scale, S32 count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i scale16 = _mm_set1_epi16(scale);
+        S32 i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)(alpha + i));
+            __m128i s_lo = scale16;
+            __m128i s_hi = scale16;
+            if (src)
+            {
+                __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+                s_lo = div255(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), scale16));
+                s_hi = div255(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), scale16));
+            }
+            __m128i r_lo = div255(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), s_lo));
+            __m128i r_hi = div255(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), s_hi));
+            _mm_storeu_si128((__m128i*)(alpha + i), _mm_packus_epi16(r_lo, r_hi));
+        }
+        for (; i < count; ++i)
+        {
+            U8 s = src ? div255(src[i] * scale) : scale;
+            alpha[i] = div255(alpha[i] * s);
+        }
+    }
+
+    // alpha = min(255, alpha + src * scale / 255), for BT_ADD
+    void addAlpha(U8* alpha, const U8* src, U8 scale, S32 count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i scale16 = _mm_set1_epi16(scale);
+        const __m128i flat = _mm_set1_epi8((char)scale);
+        S32 i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i s = flat;
+            if (src)
+            {
+                s = _mm_loadu_si128((const __m128i*)(src + i));
+                s = _mm_packus_epi16(div255(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), scale16)),
+                                     div255(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), scale16)));
+            }
+            __m128i a = _mm_loadu_si128((const __m128i*)(alpha + i));
+            _mm_storeu_si128((__m128i*)(alpha + i), _mm_adds_epu8(a, s));
+        }
+        for (; i < count; ++i)
+        {
+            U32 s = src ? div255(src[i] * scale) : scale;
+            alpha[i] = (U8)llmin(255U, alpha[i] + s);
+        }
+    }
+
+    // alpha = src unless the alpha test drops it, for BT_REPLACE
+    void replaceAlpha(U8* alpha, const U8* src, S32 count)
+    {
+        for (S32 i = 0; i < count; ++i)
+        {
+            if ((S32)src[i] * 255 > ALPHA_TEST_MIN)
+            {
+                alpha[i] = src[i];
+            }
+        }
+    }
+}
+
+LLTexLayerCompositor::LLTexLayerCompositor(S32 width, S32 height) :
+    mWidth(width),
+    mHeight(height)
+{
+}
+
+void LLTexLayerCompositor::composite(Result& result) const
+{
+    LL_PROFILE_ZONE_SCOPED;
+    const S32 count = mWidth * mHeight;
+    result.mImage = new LLImageRaw(mWidth, mHeight, 4);
+    result.mMorphMasks.clear();
+    U8* dst = result.mImage->getData();
+
+    if (!mVisible)
+    {
+        const U8 clear[4] = { 0, 0, 0, 0 };
+        fillRGBA(dst, clear, count);
+        return;
+    }
+    const U8 black[4] = { 0, 0, 0, 255 };
+    fillRGBA(dst, black, count);
+
+    std::vector<U8> alpha(count);
+    for (const Layer& layer : mLayers)
+    {
+        const U8 color[4] = { toU8(layer.mColor.mV[VRED]), toU8(layer.mColor.mV[VGREEN]),
+                              toU8(layer.mColor.mV[VBLUE]), toU8(layer.mColor.mV[VALPHA]) };
+        if (!color[3])
+        {
+            // LLTexLayer::render() skips layers it cannot see
+            continue;
+        }
+
+        EBlend blend = BLEND_SOURCE_ALPHA;
+        if (!layer.mAlphaParams.empty())
+        {
+            // LLTexLayer::renderMorphMasks(), into the alpha channel only
+            getAlpha(dst, alpha.data(), count);
+            if (layer.mClearMorphMask)
+            {
+                std::fill(alpha.begin(), alpha.end(), 0);
+            }
+
+            // gradients and mask textures are drawn with whatever color the
+            // last flat param left behind
+            U8 draw_alpha = 255;
+            for (const AlphaParam& param : layer.mAlphaParams)
+            {
+                std::vector<U8> gradient;
+                if (param.mImage.notNull())
+                {
+                    LLPointer<LLImageRaw> processed = new LLImageRaw;
+                    // only reads the shared TGA data
+                    LLImageTGA* tga = const_cast<LLImageTGA*>(param.mImage.get());
+                    if (!tga->decodeAndProcess(processed, param.mDomain, param.mWeight))
+                    {
+                        continue;
+                    }
+                    // an alpha texture, unlike other one component images
+                    LLPointer<LLImageRaw> stretched = stretch(processed, mWidth, mHeight);
+                    gradient.assign(stretched->getData(), stretched->getData() + count);
+                }
+                else
+                {
+                    draw_alpha = toU8(param.mWeight);
+                }
+
+                const U8* src = gradient.empty() ? NULL : gradient.data();
+                if (param.mMultiply)
+                {
+                    multiplyAlpha(alpha.data(), src, draw_alpha, count);
+                }
+                else
+                {
+                    addAlpha(alpha.data(), src, draw_alpha, count);
+                }
+            }
+
+            if (layer.mMaskTexture.notNull())
+            {
+                std::vector<U8> mask = toAlpha(layer.mMaskTexture, mWidth, mHeight);
+                multiplyAlpha(alpha.data(), mask.data(), draw_alpha, count);
+            }
+            if (layer.mMaskStaticImage.notNull())
+            {
+                std::vector<U8> mask = toAlpha(layer.mMaskStaticImage, mWidth, mHeight);
+                multiplyAlpha(alpha.data(), mask.data(), draw_alpha, count);
+            }
+            if (color[3] != 255)
+            {
+                multiplyAlpha(alpha.data(), NULL, color[3], count);
+            }
+            setAlpha(dst, alpha.data(), count);
+
+            if (layer.mKeepMorphMask)
+            {
+                MorphMask morph_mask;
+                morph_mask.mLayerName = layer.mName;
+                morph_mask.mAlpha = new LLImageRaw(alpha.data(), mWidth, mHeight, 1);
+                result.mMorphMasks.push_back(morph_mask);
+            }
+            blend = BLEND_DEST_ALPHA;
+        }
+
+        if (layer.mWriteAllChannels)
+        {
+            blend = BLEND_REPLACE;
+        }
+
+        if (layer.mTexture.notNull())
+        {
+            LLPointer<LLImageRaw> tex = toRGBA(layer.mTexture, mWidth, mHeight);
+            draw(blend, dst, tex->getData(), color, !layer.mWriteAllChannels, count);
+        }
+        if (layer.mStaticImage.notNull())
+        {
+            LLPointer<LLImageRaw> tex = toRGBA(layer.mStaticImage, mWidth, mHeight);
+            draw(blend, dst, tex->getData(), color, true, count);
+        }
+        if (layer.mDrawColor)
+        {
+            draw(blend, dst, NULL, color, false, count);
+        }
+    }
+
+    // LLTexLayerSet::renderAlphaMaskTextures()
+    if (mStaticAlpha.notNull() || mClearAlpha || !mAlphaMasks.empty())
+    {
+        getAlpha(dst, alpha.data(), count);
+        if (mStaticAlpha.notNull())
+        {
+            std::vector<U8> src = toAlpha(mStaticAlpha, mWidth, mHeight);
+            replaceAlpha(alpha.data(), src.data(), count);
+        }
+        else
+        {
+            std::fill(alpha.begin(), alpha.end(), 255);
+        }
+        for (const LLPointer<LLImageRaw>& mask : mAlphaMasks)
+        {
+            std::vector<U8> src = toAlpha(mask, mWidth, mHeight);
+            multiplyAlpha(alpha.data(), src.data(), 255, count);
+        }
+        setAlpha(dst, alpha.data(), count);
+    }
+}
+
+//static
+bool LLTexLayerCompositor::compositeAsync(const std::shared_ptr<const LLTexLayerCompositor>& compositor,
+                                          const callback_t& callback)
+{
+    LL::WorkQueue::ptr_t main_queue = LL::WorkQueue::getInstance("mainloop");
+    LL::WorkQueue::ptr_t general_queue = LL::WorkQueue::getInstance("General");
+    if (!main_queue || !general_queue)
+    {
+        return false;
+    }
+
+    return main_queue->postTo(
+        general_queue,
+        [compositor]() // Work done on general queue
+        {
+            Result result;
+            compositor->composite(result);
+            return result;
+        },
+        [callback](const Result& result) // Callback to main thread
+        {
+            callback(result);
+        });
+}
+
+//static
+void LLTexLayerCompositor::multiplyAlphaMask(U8* data, const U8* mask, S32 count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    S32 i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i m = _mm_loadu_si128((const __m128i*)(mask + i));
+        __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_add_epi16(_mm_unpacklo_epi8(m, zero), one));
+        __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_add_epi16(_mm_unpackhi_epi8(m, zero), one));
+        _mm_storeu_si128((__m128i*)(data + i), _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+    for (; i < count; ++i)
+    {
+        U16 result = data[i];
+        result *= ((U16)mask[i]) + 1;
+        data[i] = (U8)(result >> 8);
+    }
+}
+
+//static
+bool LLTexLayerCompositor::difference(const LLImageRaw* a, const LLImageRaw* b, S32& max_diff, F32& mean_diff)
+{
+    max_diff = 0;
+    mean_diff = 0.f;
+    if (!a || !b ||
+        a->getWidth() != b->getWidth() ||
+        a->getHeight() != b->getHeight() ||
+        a->getComponents() != b->getComponents())
+    {
+        return false;
+    }
+
+    const S32 count = a->getWidth() * a->getHeight() * a->getComponents();
+    const U8* a_data = a->getData();
+    const U8* b_data = b->getData();
+    U64 total = 0;
+    for (S32 i = 0; i < count; ++i)
+    {
+        S32 diff = llabs((S32)a_data[i] - (S32)b_data[i]);
+        max_diff = llmax(max_diff, diff);
+        total += diff;
+    }
+    mean_diff = count ? (F32)((F64)total / count) : 0.f;
+    return true;
+}
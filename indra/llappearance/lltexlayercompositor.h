@@ -0,0 +1,137 @@
+/**
+ * @file lltexlayercompositor.h
+ * @brief CPU compositing of avatar texture layer sets.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXLAYERCOMPOSITOR_H
+#define LL_LLTEXLAYERCOMPOSITOR_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llimage.h"
+#include "llimagetga.h"
+#include "llpointer.h"
+#include "v4color.h"
+
+//-----------------------------------------------------------------------------
+// LLTexLayerCompositor
+//
+// A snapshot of everything LLTexLayerSet::render() draws, and a CPU
+// implementation of the draws. The snapshot is taken on the main thread
+// (LLTexLayerSet::buildComposite()) and holds no pointers into the avatar,
+// so composite() can run on any thread, and without a GL context.
+//
+// The blends reproduce the GL state each draw runs with, including the
+// alpha test, on an 8 bit RGBA buffer. Textures are sampled as GL would
+// stretch them over the bake: box filtered down to within a factor of two,
+// as a mip chain would, then bilinear with clamped edges. The result
+// matches the GL path to within a couple of steps per channel.
+//-----------------------------------------------------------------------------
+class LLTexLayerCompositor
+{
+public:
+    // One param_alpha of a layer's morph mask.
+    struct AlphaParam
+    {
+        // gradient to process with mDomain and mWeight, or NULL for a flat
+        // mWeight over the whole bake
+        LLPointer<LLImageTGA> mImage;
+        F32 mDomain = 0.f;
+        F32 mWeight = 0.f;
+        bool mMultiply = false;
+    };
+
+    // One color layer, as LLTexLayer::render() would draw it.
+    struct Layer
+    {
+        std::string mName;
+        LLColor4 mColor;
+        bool mWriteAllChannels = false;
+        // morph mask, drawn first when not empty; it starts from the
+        // current alpha unless cleared
+        std::vector<AlphaParam> mAlphaParams;
+        bool mClearMorphMask = true;
+        // multiplied into the morph mask
+        LLPointer<LLImageRaw> mMaskTexture;
+        LLPointer<LLImageRaw> mMaskStaticImage;
+        // keep the morph mask, as the GL path reads it back
+        bool mKeepMorphMask = false;
+        // drawn in this order, tinted by mColor
+        LLPointer<LLImageRaw> mTexture;
+        LLPointer<LLImageRaw> mStaticImage;
+        bool mDrawColor = false;
+    };
+
+    struct MorphMask
+    {
+        std::string mLayerName;
+        LLPointer<LLImageRaw> mAlpha; // one component
+    };
+
+    struct Result
+    {
+        LLPointer<LLImageRaw> mImage; // four components
+        std::vector<MorphMask> mMorphMasks;
+    };
+
+    LLTexLayerCompositor(S32 width, S32 height);
+
+    S32 getWidth() const { return mWidth; }
+    S32 getHeight() const { return mHeight; }
+
+    // The snapshot, filled in by LLTexLayerSet::buildComposite().
+    bool mVisible = true;
+    std::vector<Layer> mLayers;
+    // alpha pass (LLTexLayerSet::renderAlphaMaskTextures())
+    LLPointer<LLImageRaw> mStaticAlpha;
+    bool mClearAlpha = false;
+    std::vector<LLPointer<LLImageRaw> > mAlphaMasks;
+
+    // Runs the snapshot; safe on any thread.
+    void composite(Result& result) const;
+
+    // Runs composite() on the "General" thread pool and hands the result
+    // to callback on the main loop. Returns false, without calling back,
+    // when the queues are not available.
+    typedef std::function<void(const Result&)> callback_t;
+    static bool compositeAsync(const std::shared_ptr<const LLTexLayerCompositor>& compositor,
+                               const callback_t& callback);
+
+    // data[i] = data[i] * (mask[i] + 1) >> 8, as LLTexLayer::addAlphaMask()
+    // combines morph masks.
+    static void multiplyAlphaMask(U8* data, const U8* mask, S32 count);
+
+    // Largest and mean per channel difference between two images, to check
+    // a composite against the GL bake. False if their sizes differ.
+    static bool difference(const LLImageRaw* a, const LLImageRaw* b, S32& max_diff, F32& mean_diff);
+
+private:
+    S32 mWidth;
+    S32 mHeight;
+};
+
+#endif // LL_LLTEXLAYERCOMPOSITOR_H
@@ -361,6 +361,41 @@ BOOL LLTexLayerParamAlpha::render(S32 x, S32 y, S32 width, S32 height)
     return success;
 }
 
+BOOL LLTexLayerParamAlpha::addToComposite(std::vector<LLTexLayerCompositor::AlphaParam>& params)
+{
+    if (!mTexLayer || getSkip())
+    {
+        return TRUE;
+    }
+
+    LLTexLayerCompositor::AlphaParam param;
+    param.mWeight = (mTexLayer->getTexLayerSet()->getAvatarAppearance()->getSex() & getSex()) ? mCurWeight : getDefaultWeight();
+
+    LLTexLayerParamAlphaInfo *info = (LLTexLayerParamAlphaInfo *)getInfo();
+    param.mMultiply = info->mMultiplyBlend;
+    if (!info->mStaticImageFileName.empty() && !mStaticImageInvalid)
+    {
+        if (mStaticImageTGA.isNull())
+        {
+            mStaticImageTGA = LLTexLayerStaticImageList::getInstance()->getImageTGA(info->mStaticImageFileName);
+            LLTexLayerSet::sHasCaches |= mStaticImageTGA.notNull() ? TRUE : FALSE;
+
+            if (mStaticImageTGA.isNull())
+            {
+                LL_WARNS() << "Unable to load static file: " << info->mStaticImageFileName << LL_ENDL;
+                mStaticImageInvalid = TRUE; // don't try again.
+                return FALSE;
+            }
+        }
+        // processed with the domain and weight by the compositor
+        param.mImage = mStaticImageTGA;
+        param.mDomain = info->mDomain;
+    }
+
+    params.push_back(param);
+    return TRUE;
+}
+
 //-----------------------------------------------------------------------------
 // LLTexLayerParamAlphaInfo
 //-----------------------------------------------------------------------------
@@ -30,6 +30,7 @@
 #include "llpointer.h"
 #include "v4color.h"
 #include "llviewervisualparam.h"
+#include "lltexlayercompositor.h"
 
 class LLAvatarAppearance;
 class LLImageRaw;
@@ -90,6 +91,8 @@ class alignas(16) LLTexLayerParamAlpha final : public LLTexLayerParam
 
     // New functions
     BOOL                    render( S32 x, S32 y, S32 width, S32 height );
+    // what render() would draw, for LLTexLayerCompositor
+    BOOL                    addToComposite(std::vector<LLTexLayerCompositor::AlphaParam>& params);
     BOOL                    getSkip() const;
     void                    deleteCaches();
     BOOL                    getMultiplyBlend() const;
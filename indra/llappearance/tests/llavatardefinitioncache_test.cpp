@@ -0,0 +1,148 @@
+/**
+ * @file llavatardefinitioncache_test.cpp
+ * @brief Tests for LLAvatarDefinitionCache
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llavatardefinitioncache.h"
+
+#include "lldir.h"
+#include "llfile.h"
+#include "llxmltree.h"
+#include "stringize.h"
+
+#include <memory>
+
+#include "../test/lltut.h"
+
+namespace
+{
+    // The cache finds its sources in the character directory; point that
+    // at a scratch directory holding small definition files.
+    class ScratchDir : public LLDir
+    {
+    public:
+        ScratchDir(const LLDir& dir, const std::string& root)
+        {
+            mDirDelimiter = dir.getDirDelimiter();
+            mTempDir = dir.getTempDir();
+            mAppRODataDir = root;
+        }
+
+        void initAppDirs(const std::string&, const std::string&) override {}
+        std::string getCurPath() override { return ""; }
+        bool fileExists(const std::string& filename) const override { return LLFile::isfile(filename); }
+        std::string getLLPluginLauncher() override { return ""; }
+        std::string getLLPluginFilename(std::string) override { return ""; }
+    };
+
+    void writeFile(const std::string& path, const std::string& contents)
+    {
+        LLUniqueFile fp = LLFile::fopen(path, "wb");
+        fwrite(contents.data(), 1, contents.size(), fp);
+    }
+}
+
+namespace tut
+{
+    struct avatar_definition_cache_data
+    {
+        avatar_definition_cache_data()
+            : mSavedDir(gDirUtilp)
+        {
+            mRoot = gDirUtilp->add(gDirUtilp->getTempDir(), "llavatardefinitioncache_test");
+            mCharacterDir = gDirUtilp->add(mRoot, "character");
+            LLFile::mkdir(mRoot);
+            LLFile::mkdir(mCharacterDir);
+            mCacheFile = gDirUtilp->add(mRoot, "avatar_definitions.bin");
+            mScratchDir.reset(new ScratchDir(*gDirUtilp, mRoot));
+            gDirUtilp = mScratchDir.get();
+        }
+
+        ~avatar_definition_cache_data()
+        {
+            gDirUtilp = mSavedDir;
+            LLFile::remove(mCacheFile, ENOENT);
+            LLFile::remove(mCacheFile + ".tmp", ENOENT);
+            LLFile::remove(gDirUtilp->add(mCharacterDir, "avatar.xml"));
+            LLFile::remove(gDirUtilp->add(mCharacterDir, "skeleton.xml"));
+            LLFile::rmdir(mCharacterDir);
+            LLFile::rmdir(mRoot);
+        }
+
+        // Writes the definition files, saves them to the cache and reads
+        // the avatar tree back; returns the version the cache holds, or -1.
+        S32 saveAndReload(S32 version)
+        {
+            std::string avatar_file = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER, "avatar.xml");
+            std::string skeleton_file = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER, "skeleton.xml");
+            writeFile(avatar_file, STRINGIZE("<linden_avatar version=\"" << version << "\"></linden_avatar>"));
+            writeFile(skeleton_file, "<linden_skeleton version=\"2.0\"></linden_skeleton>");
+
+            LLXmlTree avatar_tree;
+            LLXmlTree skeleton_tree;
+            if (!avatar_tree.parseFile(avatar_file, FALSE) || !skeleton_tree.parseFile(skeleton_file, FALSE) ||
+                !LLAvatarDefinitionCache::save(mCacheFile, "avatar.xml", "skeleton.xml", avatar_tree, skeleton_tree,
+                                               LLAvatarDefinitionCache::mesh_list_t()))
+            {
+                return -1;
+            }
+
+            LLAvatarDefinitionCache cache;
+            LLXmlTree cached_avatar_tree;
+            LLXmlTree cached_skeleton_tree;
+            S32 cached_version = -1;
+            if (cache.open(mCacheFile, "avatar.xml", "skeleton.xml") &&
+                cache.loadXmlTrees(cached_avatar_tree, cached_skeleton_tree))
+            {
+                cached_avatar_tree.getRoot()->getAttributeS32("version", cached_version);
+            }
+            return cached_version;
+        }
+
+        LLDir* mSavedDir;
+        std::unique_ptr<ScratchDir> mScratchDir;
+        std::string mRoot;
+        std::string mCharacterDir;
+        std::string mCacheFile;
+    };
+    typedef test_group<avatar_definition_cache_data> avatar_definition_cache_group;
+    typedef avatar_definition_cache_group::object avatar_definition_cache_object;
+    tut::avatar_definition_cache_group avatar_definition_cache_test("LLAvatarDefinitionCache");
+
+    template<> template<>
+    void avatar_definition_cache_object::test<1>()
+    {
+        set_test_name("save over an existing cache");
+
+        ensure_equals("first save", saveAndReload(1), 1);
+        ensure("cache written", LLFile::isfile(mCacheFile));
+        // the definition files changed, so the cache is written again over
+        // the one already there
+        ensure_equals("second save replaces the first", saveAndReload(2), 2);
+        ensure_equals("and again", saveAndReload(3), 3);
+        ensure("no temporary file left behind", !LLFile::isfile(mCacheFile + ".tmp"));
+    }
+}
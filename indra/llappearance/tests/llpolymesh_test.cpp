@@ -0,0 +1,397 @@
+/**
+ * @file   llpolymesh_test.cpp
+ * @brief  LLPolyMesh queued morphs against applying each morph in turn.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "stringize.h"
+
+#include "../llpolymesh.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+    const S32 NUM_VERTICES = 211;
+    const U32 NUM_MORPHS = 6;
+    const U32 CLOTHING_MORPH = 2;
+    const U32 MASKED_MORPH = 4;
+    // as in llpolymorph.cpp
+    const F32 NORMAL_SOFTEN_FACTOR = 0.65f;
+    // normalize3fast() precision
+    const F32 TOLERANCE = 0.002f;
+
+    F32 rand01(U32& seed)
+    {
+        seed = seed * 1664525 + 1013904223;
+        return (F32)(seed >> 8) / (F32)(1 << 24);
+    }
+
+    LLVector4a randVector(U32& seed, F32 scale)
+    {
+        LLVector4a v;
+        v.set((rand01(seed) - 0.5f) * scale, (rand01(seed) - 0.5f) * scale, (rand01(seed) - 0.5f) * scale, 0.f);
+        return v;
+    }
+
+    LLVector4a randUnitVector(U32& seed)
+    {
+        LLVector4a v = randVector(seed, 2.f);
+        v.add(LLVector4a(0.f, 0.f, 0.5f, 0.f));
+        v.normalize3();
+        return v;
+    }
+
+    std::string morphName(U32 i)
+    {
+        return stringize("morph", i);
+    }
+
+    enum EDamage
+    {
+        NO_DAMAGE,
+        BAD_FACE,
+        BAD_MORPH_INDEX
+    };
+
+    // A mesh with NUM_MORPHS overlapping morphs, in the form
+    // LLPolyMeshSharedData::readCache() takes.
+    std::string makeMeshBlob(U32 seed, EDamage damage = NO_DAMAGE)
+    {
+        std::string blob;
+        LLAvatarDefinitionCache::Writer writer(blob);
+        writer.write(LLVector3::zero);
+        writer.write(LLQuaternion::DEFAULT);
+        writer.write(LLVector3(1.f, 1.f, 1.f));
+        writer.write(NUM_VERTICES);
+
+        writer.write((U8)FALSE); // weights
+        writer.write((U8)FALSE); // detail tex coords
+        for (S32 v = 0; v < NUM_VERTICES; ++v)
+        {
+            LLVector4a coord = randVector(seed, 2.f);
+            writer.write(coord);
+        }
+        std::vector<LLVector4a> normals(NUM_VERTICES);
+        for (S32 v = 0; v < NUM_VERTICES; ++v)
+        {
+            normals[v] = randUnitVector(seed);
+            writer.write(normals[v]);
+        }
+        for (S32 v = 0; v < NUM_VERTICES; ++v)
+        {
+            // perpendicular to the normal
+            LLVector4a binormal;
+            binormal.setCross3(normals[v], randUnitVector(seed));
+            binormal.normalize3();
+            writer.write(binormal);
+        }
+        for (S32 v = 0; v < NUM_VERTICES; ++v)
+        {
+            writer.write(LLVector2(rand01(seed), rand01(seed)));
+        }
+
+        S32 num_faces = NUM_VERTICES - 2;
+        writer.write(num_faces);
+        for (S32 f = 0; f < num_faces; ++f)
+        {
+            LLPolyFace face = { f, f + 1, f + 2 };
+            if (damage == BAD_FACE && f == num_faces / 2)
+            {
+                face[1] = NUM_VERTICES;
+            }
+            writer.write(face);
+        }
+
+        writer.write((U32)0); // joint names
+
+        writer.write(NUM_MORPHS);
+        for (U32 m = 0; m < NUM_MORPHS; ++m)
+        {
+            // every other vertex from a different start, so most vertices
+            // are moved by several morphs
+            std::vector<U32> indices;
+            for (U32 v = m % 3; v < (U32)NUM_VERTICES; v += 1 + (m % 2))
+            {
+                indices.push_back(v);
+            }
+            if (damage == BAD_MORPH_INDEX && m == NUM_MORPHS - 1)
+            {
+                indices.back() = NUM_VERTICES;
+            }
+            U32 num_indices = (U32)indices.size();
+            writer.writeString(morphName(m));
+            writer.write(num_indices);
+            writer.write(0.f); // total distortion
+            writer.write(0.f); // max distortion
+            LLVector4a avg_distortion;
+            avg_distortion.clear();
+            writer.write(avg_distortion);
+            writer.write(indices.data(), sizeof(U32) * num_indices);
+            for (U32 i = 0; i < num_indices; ++i)
+            {
+                writer.write(randVector(seed, 0.2f));
+            }
+            for (U32 i = 0; i < num_indices; ++i)
+            {
+                writer.write(randVector(seed, 1.f));
+            }
+            for (U32 i = 0; i < num_indices; ++i)
+            {
+                // one degenerate binormal, which the morph must not turn into NaNs
+                LLVector4a binormal = randVector(seed, 1.f);
+                if (i == 7)
+                {
+                    binormal.clear();
+                }
+                writer.write(binormal);
+            }
+            for (U32 i = 0; i < num_indices; ++i)
+            {
+                writer.write(LLVector2(rand01(seed) * 0.1f, rand01(seed) * 0.1f));
+            }
+        }
+
+        writer.write((U32)0); // shared vertex remaps
+        return blob;
+    }
+
+    // What LLPolyMorphTarget::apply() used to do, for each morph in turn:
+    // move the vertices, then renormalize the normal and rebuild the
+    // binormal of each vertex moved.
+    struct EagerMesh
+    {
+        std::vector<LLVector4a> mCoords;
+        std::vector<LLVector4a> mScaledNormals;
+        std::vector<LLVector4a> mNormals;
+        std::vector<LLVector4a> mScaledBinormals;
+        std::vector<LLVector4a> mBinormals;
+        std::vector<LLVector4a> mClothingWeights;
+        std::vector<LLVector2> mTexCoords;
+
+        EagerMesh(LLPolyMesh* mesh) :
+            mCoords(mesh->getCoords(), mesh->getCoords() + NUM_VERTICES),
+            mScaledNormals(mesh->getNormals(), mesh->getNormals() + NUM_VERTICES),
+            mNormals(mScaledNormals),
+            mScaledBinormals(mesh->getBinormals(), mesh->getBinormals() + NUM_VERTICES),
+            mBinormals(mScaledBinormals),
+            mClothingWeights(mesh->getClothingWeights(), mesh->getClothingWeights() + NUM_VERTICES),
+            mTexCoords(mesh->getTexCoords(), mesh->getTexCoords() + NUM_VERTICES)
+        {
+        }
+
+        void apply(const LLPolyMorphData* morph, const F32* mask_weights, F32 delta_weight, bool clothing)
+        {
+            for (U32 i = 0; i < morph->mNumIndices; ++i)
+            {
+                U32 v = morph->mVertexIndices[i];
+                F32 mask_weight = mask_weights ? mask_weights[i] : 1.f;
+                LLVector4a weight;
+                weight.splat(delta_weight * mask_weight);
+
+                LLVector4a t;
+                t.setMul(morph->mCoords[i], weight);
+                t.getF32ptr()[VW] = 0.f;
+                mCoords[v].add(t);
+                if (clothing)
+                {
+                    mClothingWeights[v].add(t);
+                    mClothingWeights[v].getF32ptr()[VW] = mask_weight;
+                }
+
+                LLVector4a soft_weight;
+                soft_weight.splat(delta_weight * mask_weight * NORMAL_SOFTEN_FACTOR);
+                t.setMul(morph->mNormals[i], soft_weight);
+                t.getF32ptr()[VW] = 0.f;
+                mScaledNormals[v].add(t);
+                LLVector4a norm = mScaledNormals[v];
+                norm.normalize3fast();
+                mNormals[v] = norm;
+
+                LLVector4a binorm = morph->mBinormals[i];
+                if (!binorm.isFinite3() || (binorm.dot3(binorm).getF32() <= F_APPROXIMATELY_ZERO))
+                {
+                    binorm.set(1, 0, 0, 1);
+                }
+                t.setMul(binorm, soft_weight);
+                t.getF32ptr()[VW] = 0.f;
+                mScaledBinormals[v].add(t);
+                LLVector4a tangent;
+                tangent.setCross3(mScaledBinormals[v], norm);
+                mBinormals[v].setCross3(norm, tangent);
+                mBinormals[v].normalize3fast();
+
+                mTexCoords[v].mV[VX] += morph->mTexCoords[i].mV[VX] * delta_weight * mask_weight;
+                mTexCoords[v].mV[VY] += morph->mTexCoords[i].mV[VY] * delta_weight * mask_weight;
+            }
+        }
+    };
+}
+
+namespace tut
+{
+    struct polymesh_data
+    {
+        LLPolyMeshSharedData* mSharedData = nullptr;
+        LLPolyMesh* mMesh = nullptr;
+        std::vector<F32> mMaskWeights;
+
+        polymesh_data()
+        {
+            std::string blob = makeMeshBlob(1234);
+            LLAvatarDefinitionCache::Reader reader((const U8*)blob.data(), blob.size());
+            mSharedData = new LLPolyMeshSharedData();
+            if (mSharedData->readCache(reader, NULL))
+            {
+                mMesh = new LLPolyMesh(mSharedData, NULL);
+            }
+
+            U32 seed = 99;
+            LLPolyMorphData* masked = mMesh ? mMesh->getMorphData(morphName(MASKED_MORPH)) : NULL;
+            mMaskWeights.resize(masked ? masked->mNumIndices : 0);
+            for (F32& weight : mMaskWeights)
+            {
+                weight = rand01(seed);
+            }
+        }
+
+        ~polymesh_data()
+        {
+            delete mMesh;
+            delete mSharedData;
+        }
+
+        // each morph a few times, as dragging a slider does
+        template <typename APPLY>
+        void applyMorphs(APPLY apply)
+        {
+            U32 seed = 42;
+            for (U32 pass = 0; pass < 3; ++pass)
+            {
+                for (U32 m = 0; m < NUM_MORPHS; ++m)
+                {
+                    const LLPolyMorphData* morph = mMesh->getMorphData(morphName(m));
+                    const F32* mask_weights = (m == MASKED_MORPH) ? mMaskWeights.data() : NULL;
+                    apply(morph, mask_weights, rand01(seed) - 0.3f, m == CLOTHING_MORPH);
+                }
+            }
+        }
+
+        void ensureMatches(const std::string& desc, const EagerMesh& eager)
+        {
+            const LLVector4a* coords = mMesh->getCoords();
+            const LLVector4a* normals = mMesh->getNormals();
+            const LLVector4a* binormals = mMesh->getBinormals();
+            const LLVector4a* clothing_weights = mMesh->getClothingWeights();
+            const LLVector2* tex_coords = mMesh->getTexCoords();
+            for (S32 v = 0; v < NUM_VERTICES; ++v)
+            {
+                for (U32 c = 0; c < 3; ++c)
+                {
+                    std::string where(stringize(" ", desc, " vertex ", v, " component ", c));
+                    ensure_approximately_equals_range(("coords" + where).c_str(), coords[v][c], eager.mCoords[v][c], TOLERANCE);
+                    ensure_approximately_equals_range(("normal" + where).c_str(), normals[v][c], eager.mNormals[v][c], TOLERANCE);
+                    ensure_approximately_equals_range(("binormal" + where).c_str(), binormals[v][c], eager.mBinormals[v][c], TOLERANCE);
+                    ensure_approximately_equals_range(("clothing" + where).c_str(), clothing_weights[v][c], eager.mClothingWeights[v][c], TOLERANCE);
+                }
+                ensure_equals(stringize(desc, " clothing mask ", v), clothing_weights[v][VW], eager.mClothingWeights[v][VW]);
+                ensure_approximately_equals_range(stringize(desc, " tex coord ", v).c_str(), tex_coords[v].mV[VX], eager.mTexCoords[v].mV[VX], TOLERANCE);
+                ensure_approximately_equals_range(stringize(desc, " tex coord ", v).c_str(), tex_coords[v].mV[VY], eager.mTexCoords[v].mV[VY], TOLERANCE);
+            }
+        }
+    };
+    typedef test_group<polymesh_data> polymesh_group;
+    typedef polymesh_group::object polymesh_object;
+    tut::polymesh_group polymesh("LLPolyMesh");
+
+    template<> template<>
+    void polymesh_object::test<1>()
+    {
+        set_test_name("queued morphs match applying each in turn");
+        ensure("mesh loaded", mMesh != NULL);
+
+        EagerMesh eager(mMesh);
+        applyMorphs([&](const LLPolyMorphData* morph, const F32* mask_weights, F32 weight, bool clothing)
+                    {
+                        eager.apply(morph, mask_weights, weight, clothing);
+                        mMesh->queueMorph(morph, mask_weights, weight, clothing);
+                    });
+        ensureMatches("batched", eager);
+    }
+
+    template<> template<>
+    void polymesh_object::test<2>()
+    {
+        set_test_name("reading the mesh between morphs");
+        ensure("mesh loaded", mMesh != NULL);
+
+        EagerMesh eager(mMesh);
+        U32 count = 0;
+        applyMorphs([&](const LLPolyMorphData* morph, const F32* mask_weights, F32 weight, bool clothing)
+                    {
+                        eager.apply(morph, mask_weights, weight, clothing);
+                        mMesh->queueMorph(morph, mask_weights, weight, clothing);
+                        if (++count % 4 == 0)
+                        {
+                            mMesh->getNormals();
+                        }
+                    });
+        ensureMatches("interleaved", eager);
+    }
+
+    template<> template<>
+    void polymesh_object::test<3>()
+    {
+        set_test_name("morph serial");
+        ensure("mesh loaded", mMesh != NULL);
+
+        mMesh->getCoords();
+        U32 serial = mMesh->getMorphSerial();
+        mMesh->getNormals();
+        ensure_equals("reading doesn't change the serial", mMesh->getMorphSerial(), serial);
+
+        const LLPolyMorphData* morph = mMesh->getMorphData(morphName(0));
+        mMesh->queueMorph(morph, NULL, 0.5f, false);
+        mMesh->queueMorph(morph, NULL, 0.25f, false);
+        mMesh->getCoords();
+        ensure("applying morphs changes the serial", mMesh->getMorphSerial() != serial);
+        serial = mMesh->getMorphSerial();
+        mMesh->getTexCoords();
+        ensure_equals("once per batch", mMesh->getMorphSerial(), serial);
+    }
+
+    template<> template<>
+    void polymesh_object::test<4>()
+    {
+        set_test_name("vertex indices out of the mesh");
+
+        for (EDamage damage : { BAD_FACE, BAD_MORPH_INDEX })
+        {
+            std::string blob = makeMeshBlob(1234, damage);
+            LLAvatarDefinitionCache::Reader reader((const U8*)blob.data(), blob.size());
+            LLPolyMeshSharedData shared_data;
+            ensure(stringize("damage ", damage, " rejected"), !shared_data.readCache(reader, NULL));
+        }
+    }
+}
@@ -0,0 +1,562 @@
+/**
+ * @file   lltexlayercompositor_test.cpp
+ * @brief  LLTexLayerCompositor against a model of the GL draws it replaces,
+ *         and a compositing benchmark.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llimagetga.h"
+#include "lltimer.h"
+#include "stringize.h"
+
+#include "../lltexlayercompositor.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+    // Odd sizes, so the vector loops leave a tail.
+    const S32 WIDTH = 37;
+    const S32 HEIGHT = 23;
+    const S32 COUNT = WIDTH * HEIGHT;
+    const S32 TOLERANCE = 2;
+
+    LLPointer<LLImageRaw> makeImage(S32 width, S32 height, S32 comps, U32 seed)
+    {
+        LLPointer<LLImageRaw> image = new LLImageRaw(width, height, comps);
+        U8* data = image->getData();
+        for (S32 i = 0; i < width * height * comps; ++i)
+        {
+            seed = seed * 1664525 + 1013904223;
+            data[i] = (U8)(seed >> 24);
+        }
+        return image;
+    }
+
+    LLPointer<LLImageRaw> makeFlatImage(S32 width, S32 height, const U8 pixel[4])
+    {
+        LLPointer<LLImageRaw> image = new LLImageRaw(width, height, 4);
+        for (S32 i = 0; i < width * height; ++i)
+        {
+            memcpy(image->getData() + i * 4, pixel, 4);
+        }
+        return image;
+    }
+
+    // A one component RLE tga, as avatar_lad.xml's param_alpha gradients
+    // are: a horizontal ramp in raw packets.
+    LLPointer<LLImageTGA> makeGradient(S32 width, S32 height)
+    {
+        std::vector<U8> file(18, 0);
+        file[2] = 11;
+        file[12] = (U8)width;
+        file[13] = (U8)(width >> 8);
+        file[14] = (U8)height;
+        file[15] = (U8)(height >> 8);
+        file[16] = 8;
+        for (S32 y = 0; y < height; ++y)
+        {
+            for (S32 x = 0; x < width; x += 128)
+            {
+                S32 run = llmin(128, width - x);
+                file.push_back((U8)(run - 1));
+                for (S32 i = 0; i < run; ++i)
+                {
+                    file.push_back((U8)((x + i) * 255 / (width - 1)));
+                }
+            }
+        }
+        LLPointer<LLImageTGA> tga = new LLImageTGA;
+        tga->allocateData((S32)file.size());
+        memcpy(tga->getData(), file.data(), file.size());
+        tga->updateData();
+        return tga;
+    }
+}
+
+namespace tut
+{
+    // The GL draw sequence of LLTexLayerSet::render(), in floats, rounded
+    // to the 8 bit render target after every draw.
+    class Reference
+    {
+    public:
+        enum EBlend { SOURCE_ALPHA, DEST_ALPHA, REPLACE };
+
+        Reference() : mPixels(COUNT * 4, 0.f) {}
+
+        static F32 quantize(F32 f) { return ll_round(llclamp(f, 0.f, 1.f) * 255.f) / 255.f; }
+
+        // texel i of an image the size of the bake, as GL samples it
+        static void texel(const LLImageRaw* image, S32 i, F32 out[4])
+        {
+            const S32 comps = image->getComponents();
+            const U8* in = image->getData() + i * comps;
+            out[0] = in[0] / 255.f;
+            out[1] = in[comps >= 3 ? 1 : 0] / 255.f;
+            out[2] = in[comps >= 3 ? 2 : 0] / 255.f;
+            out[3] = comps == 4 ? in[3] / 255.f : comps == 2 ? in[1] / 255.f : 1.f;
+        }
+
+        void fill(F32 r, F32 g, F32 b, F32 a)
+        {
+            for (S32 i = 0; i < COUNT; ++i)
+            {
+                F32* d = &mPixels[i * 4];
+                d[0] = r; d[1] = g; d[2] = b; d[3] = a;
+            }
+        }
+
+        void draw(EBlend blend, const LLImageRaw* tex, const LLColor4& color, bool alpha_test)
+        {
+            for (S32 i = 0; i < COUNT; ++i)
+            {
+                F32 s[4] = { 1.f, 1.f, 1.f, 1.f };
+                if (tex)
+                {
+                    texel(tex, i, s);
+                }
+                for (S32 c = 0; c < 4; ++c)
+                {
+                    s[c] *= quantize(color.mV[c]);
+                }
+                if (alpha_test && s[3] <= 0.004f)
+                {
+                    continue;
+                }
+                F32* d = &mPixels[i * 4];
+                const F32 f = blend == SOURCE_ALPHA ? s[3] : d[3];
+                for (S32 c = 0; c < 4; ++c)
+                {
+                    d[c] = quantize(blend == REPLACE ? s[c] : s[c] * f + d[c] * (1.f - f));
+                }
+            }
+        }
+
+        // Alpha only draws, as the morph mask and alpha mask passes run.
+        void clearAlpha(F32 a)
+        {
+            for (S32 i = 0; i < COUNT; ++i)
+            {
+                mPixels[i * 4 + 3] = a;
+            }
+        }
+
+        // BT_ADD, or BT_MULT_ALPHA when multiply; src is an alpha texture
+        // or NULL for a flat draw
+        void blendAlpha(const U8* src, F32 color_alpha, bool multiply)
+        {
+            for (S32 i = 0; i < COUNT; ++i)
+            {
+                F32 s = (src ? src[i] / 255.f : 1.f) * quantize(color_alpha);
+                F32& a = mPixels[i * 4 + 3];
+                a = quantize(multiply ? a * s : a + s);
+            }
+        }
+
+        void multiplyAlpha(const LLImageRaw* tex, F32 color_alpha)
+        {
+            for (S32 i = 0; i < COUNT; ++i)
+            {
+                F32 s[4];
+                texel(tex, i, s);
+                F32& a = mPixels[i * 4 + 3];
+                a = quantize(a * s[3] * quantize(color_alpha));
+            }
+        }
+
+        void replaceAlpha(const LLImageRaw* tex)
+        {
+            for (S32 i = 0; i < COUNT; ++i)
+            {
+                F32 s[4];
+                texel(tex, i, s);
+                if (s[3] > 0.004f)
+                {
+                    mPixels[i * 4 + 3] = s[3];
+                }
+            }
+        }
+
+        F32 alpha(S32 i) const { return mPixels[i * 4 + 3]; }
+
+        // empty if every channel is within TOLERANCE of the reference
+        std::string compare(const LLImageRaw* image) const
+        {
+            if (image->getWidth() != WIDTH || image->getHeight() != HEIGHT || image->getComponents() != 4)
+            {
+                return "image size";
+            }
+            for (S32 i = 0; i < COUNT * 4; ++i)
+            {
+                S32 expected = ll_round(mPixels[i] * 255.f);
+                S32 actual = image->getData()[i];
+                if (llabs(expected - actual) > TOLERANCE)
+                {
+                    return STRINGIZE("pixel " << i / 4 << " channel " << i % 4 << ": "
+                                     << actual << " != " << expected);
+                }
+            }
+            return "";
+        }
+
+        std::string compareAlpha(const LLImageRaw* mask, const std::vector<F32>& expected) const
+        {
+            for (S32 i = 0; i < COUNT; ++i)
+            {
+                S32 e = ll_round(expected[i] * 255.f);
+                S32 a = mask->getData()[i];
+                if (llabs(e - a) > TOLERANCE)
+                {
+                    return STRINGIZE("mask pixel " << i << ": " << a << " != " << e);
+                }
+            }
+            return "";
+        }
+
+    private:
+        std::vector<F32> mPixels;
+    };
+
+    struct lltexlayercompositor_data
+    {
+        LLTexLayerCompositor mCompositor;
+        Reference mReference;
+
+        lltexlayercompositor_data() :
+            mCompositor(WIDTH, HEIGHT)
+        {
+            // every visible bake starts from opaque black
+            mReference.fill(0.f, 0.f, 0.f, 1.f);
+        }
+
+        std::string run(LLTexLayerCompositor::Result& result)
+        {
+            mCompositor.composite(result);
+            return mReference.compare(result.mImage);
+        }
+    };
+    typedef test_group<lltexlayercompositor_data> lltexlayercompositor_group;
+    typedef lltexlayercompositor_group::object object;
+    lltexlayercompositor_group lltexlayercompositorgrp("lltexlayercompositor");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("tinted textures, static images and colors");
+        LLTexLayerCompositor::Layer skin;
+        skin.mColor.set(0.8f, 0.6f, 0.5f, 1.f);
+        skin.mTexture = makeImage(WIDTH, HEIGHT, 3, 1);
+        mCompositor.mLayers.push_back(skin);
+        mReference.draw(Reference::SOURCE_ALPHA, skin.mTexture, skin.mColor, true);
+
+        // partly transparent, with fully transparent texels for the alpha
+        // test to drop
+        LLTexLayerCompositor::Layer tattoo;
+        tattoo.mColor.set(0.3f, 0.9f, 0.2f, 0.7f);
+        tattoo.mTexture = makeImage(WIDTH, HEIGHT, 4, 2);
+        for (S32 i = 0; i < COUNT; i += 5)
+        {
+            tattoo.mTexture->getData()[i * 4 + 3] = 0;
+        }
+        tattoo.mStaticImage = makeImage(WIDTH, HEIGHT, 2, 3);
+        mCompositor.mLayers.push_back(tattoo);
+        mReference.draw(Reference::SOURCE_ALPHA, tattoo.mTexture, tattoo.mColor, true);
+        mReference.draw(Reference::SOURCE_ALPHA, tattoo.mStaticImage, tattoo.mColor, true);
+
+        LLTexLayerCompositor::Layer tint;
+        tint.mColor.set(0.1f, 0.2f, 0.9f, 0.5f);
+        tint.mDrawColor = true;
+        mCompositor.mLayers.push_back(tint);
+        mReference.draw(Reference::SOURCE_ALPHA, NULL, tint.mColor, false);
+
+        // invisible layers are skipped entirely
+        LLTexLayerCompositor::Layer hidden;
+        hidden.mColor.set(1.f, 1.f, 1.f, 0.f);
+        hidden.mDrawColor = true;
+        mCompositor.mLayers.push_back(hidden);
+
+        LLTexLayerCompositor::Result result;
+        ensure_equals(run(result), "");
+        ensure("no morph masks", result.mMorphMasks.empty());
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("textures are stretched over the bake");
+        // larger, smaller and odd sized flat textures sample to their color
+        const U8 pixels[3][4] = { { 200, 40, 90, 255 }, { 10, 250, 30, 128 }, { 70, 70, 220, 60 } };
+        const S32 sizes[3][2] = { { WIDTH * 4, HEIGHT * 2 }, { 8, 8 }, { 51, 3 } };
+        for (S32 i = 0; i < 3; ++i)
+        {
+            LLTexLayerCompositor::Layer layer;
+            layer.mColor.set(1.f, 1.f, 1.f, 1.f);
+            layer.mTexture = makeFlatImage(sizes[i][0], sizes[i][1], pixels[i]);
+            mCompositor.mLayers.push_back(layer);
+            mReference.draw(Reference::SOURCE_ALPHA, makeFlatImage(WIDTH, HEIGHT, pixels[i]), layer.mColor, true);
+        }
+        LLTexLayerCompositor::Result result;
+        ensure_equals(run(result), "");
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("morph masks");
+        LLTexLayerCompositor::Layer base;
+        base.mColor.set(0.5f, 0.4f, 0.3f, 1.f);
+        base.mTexture = makeImage(WIDTH, HEIGHT, 4, 4);
+        mCompositor.mLayers.push_back(base);
+        mReference.draw(Reference::SOURCE_ALPHA, base.mTexture, base.mColor, true);
+
+        // a gradient added over a flat weight, then multiplied down
+        LLTexLayerCompositor::Layer layer;
+        layer.mName = "masked";
+        layer.mColor.set(0.9f, 0.7f, 0.2f, 0.6f);
+        LLTexLayerCompositor::AlphaParam flat;
+        flat.mWeight = 0.25f;
+        LLTexLayerCompositor::AlphaParam gradient;
+        gradient.mImage = makeGradient(64, 16);
+        gradient.mDomain = 0.5f;
+        gradient.mWeight = 0.7f;
+        LLTexLayerCompositor::AlphaParam multiply;
+        multiply.mWeight = 0.8f;
+        multiply.mMultiply = true;
+        layer.mAlphaParams.push_back(flat);
+        layer.mAlphaParams.push_back(gradient);
+        layer.mAlphaParams.push_back(multiply);
+        layer.mMaskTexture = makeImage(WIDTH, HEIGHT, 4, 5);
+        layer.mKeepMorphMask = true;
+        layer.mTexture = makeImage(WIDTH, HEIGHT, 3, 6);
+        mCompositor.mLayers.push_back(layer);
+
+        // the gradient as GL would sample it: processed, then stretched
+        LLPointer<LLImageRaw> processed = new LLImageRaw;
+        ensure("gradient", gradient.mImage->decodeAndProcess(processed, gradient.mDomain, gradient.mWeight));
+        std::vector<U8> ramp(COUNT);
+        for (S32 y = 0; y < HEIGHT; ++y)
+        {
+            for (S32 x = 0; x < WIDTH; ++x)
+            {
+                // the ramp only runs along x, so linear filtering is exact
+                F32 u = llclamp((x + 0.5f) * 64 / WIDTH - 0.5f, 0.f, 63.f);
+                S32 x0 = (S32)u;
+                S32 x1 = llmin(x0 + 1, 63);
+                const U8* row = processed->getData() + (y * 16 / HEIGHT) * 64;
+                ramp[y * WIDTH + x] = (U8)ll_round(row[x0] + (row[x1] - row[x0]) * (u - x0));
+            }
+        }
+
+        mReference.clearAlpha(0.f);
+        mReference.blendAlpha(NULL, flat.mWeight, false);
+        // still drawn with the flat param's color
+        mReference.blendAlpha(ramp.data(), flat.mWeight, false);
+        mReference.blendAlpha(NULL, multiply.mWeight, true);
+        mReference.multiplyAlpha(layer.mMaskTexture, multiply.mWeight);
+        mReference.blendAlpha(NULL, layer.mColor.mV[VW], true);
+        std::vector<F32> morph_mask(COUNT);
+        for (S32 i = 0; i < COUNT; ++i)
+        {
+            morph_mask[i] = mReference.alpha(i);
+        }
+        mReference.draw(Reference::DEST_ALPHA, layer.mTexture, layer.mColor, true);
+
+        LLTexLayerCompositor::Result result;
+        ensure_equals(run(result), "");
+        ensure_equals("kept morph masks", result.mMorphMasks.size(), 1);
+        ensure_equals(result.mMorphMasks[0].mLayerName, "masked");
+        ensure_equals(mReference.compareAlpha(result.mMorphMasks[0].mAlpha, morph_mask), "");
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("multiplied morph mask and write all channels");
+        LLTexLayerCompositor::Layer base;
+        base.mColor.set(1.f, 1.f, 1.f, 1.f);
+        base.mTexture = makeImage(WIDTH, HEIGHT, 4, 7);
+        mCompositor.mLayers.push_back(base);
+        mReference.draw(Reference::SOURCE_ALPHA, base.mTexture, base.mColor, true);
+
+        // a first multiply param starts from the current alpha
+        LLTexLayerCompositor::Layer layer;
+        layer.mColor.set(0.2f, 0.3f, 0.4f, 1.f);
+        layer.mClearMorphMask = false;
+        LLTexLayerCompositor::AlphaParam multiply;
+        multiply.mWeight = 0.5f;
+        multiply.mMultiply = true;
+        layer.mAlphaParams.push_back(multiply);
+        layer.mMaskStaticImage = makeImage(WIDTH, HEIGHT, 4, 8);
+        layer.mDrawColor = true;
+        mCompositor.mLayers.push_back(layer);
+        mReference.blendAlpha(NULL, multiply.mWeight, true);
+        mReference.multiplyAlpha(layer.mMaskStaticImage, multiply.mWeight);
+        mReference.draw(Reference::DEST_ALPHA, NULL, layer.mColor, false);
+
+        LLTexLayerCompositor::Result result;
+        ensure_equals(run(result), "");
+        ensure("morph mask not kept", result.mMorphMasks.empty());
+
+        // overwrites everything under it
+        LLTexLayerCompositor::Layer replace;
+        replace.mColor.set(0.6f, 0.5f, 0.4f, 0.9f);
+        replace.mWriteAllChannels = true;
+        replace.mTexture = makeImage(WIDTH, HEIGHT, 4, 9);
+        mCompositor.mLayers.push_back(replace);
+        mReference.draw(Reference::REPLACE, replace.mTexture, replace.mColor, false);
+        ensure_equals(run(result), "");
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        set_test_name("alpha masks");
+        LLTexLayerCompositor::Layer base;
+        base.mColor.set(1.f, 1.f, 1.f, 1.f);
+        base.mTexture = makeImage(WIDTH, HEIGHT, 4, 10);
+        mCompositor.mLayers.push_back(base);
+        mReference.draw(Reference::SOURCE_ALPHA, base.mTexture, base.mColor, true);
+
+        mCompositor.mClearAlpha = true;
+        mCompositor.mAlphaMasks.push_back(makeImage(WIDTH, HEIGHT, 4, 11));
+        mCompositor.mAlphaMasks.push_back(makeImage(WIDTH, HEIGHT, 2, 12));
+        mReference.clearAlpha(1.f);
+        for (const LLPointer<LLImageRaw>& mask : mCompositor.mAlphaMasks)
+        {
+            mReference.multiplyAlpha(mask, 1.f);
+        }
+
+        LLTexLayerCompositor::Result result;
+        ensure_equals(run(result), "");
+
+        // a static alpha replaces the alpha, where the alpha test lets it
+        mCompositor.mStaticAlpha = makeImage(WIDTH, HEIGHT, 4, 13);
+        for (S32 i = 0; i < COUNT; i += 3)
+        {
+            mCompositor.mStaticAlpha->getData()[i * 4 + 3] = 1;
+        }
+        mReference = Reference();
+        mReference.fill(0.f, 0.f, 0.f, 1.f);
+        mReference.draw(Reference::SOURCE_ALPHA, base.mTexture, base.mColor, true);
+        mReference.replaceAlpha(mCompositor.mStaticAlpha);
+        for (const LLPointer<LLImageRaw>& mask : mCompositor.mAlphaMasks)
+        {
+            mReference.multiplyAlpha(mask, 1.f);
+        }
+        ensure_equals(run(result), "");
+    }
+
+    template<> template<>
+    void object::test<6>()
+    {
+        set_test_name("invisible bake");
+        LLTexLayerCompositor::Layer layer;
+        layer.mColor.set(1.f, 1.f, 1.f, 1.f);
+        layer.mDrawColor = true;
+        mCompositor.mLayers.push_back(layer);
+        mCompositor.mVisible = false;
+        mReference.fill(0.f, 0.f, 0.f, 0.f);
+
+        LLTexLayerCompositor::Result result;
+        ensure_equals(run(result), "");
+    }
+
+    template<> template<>
+    void object::test<7>()
+    {
+        set_test_name("multiplyAlphaMask");
+        LLPointer<LLImageRaw> data = makeImage(COUNT, 1, 1, 14);
+        LLPointer<LLImageRaw> mask = makeImage(COUNT, 1, 1, 15);
+        std::vector<U8> expected(COUNT);
+        for (S32 i = 0; i < COUNT; ++i)
+        {
+            expected[i] = (U8)((data->getData()[i] * (mask->getData()[i] + 1)) >> 8);
+        }
+        LLTexLayerCompositor::multiplyAlphaMask(data->getData(), mask->getData(), COUNT);
+        ensure("exact", std::equal(expected.begin(), expected.end(), data->getData()));
+    }
+
+    template<> template<>
+    void object::test<8>()
+    {
+        set_test_name("difference");
+        const U8 pixel[4] = { 100, 150, 200, 255 };
+        LLPointer<LLImageRaw> a = makeFlatImage(WIDTH, HEIGHT, pixel);
+        LLPointer<LLImageRaw> b = makeFlatImage(WIDTH, HEIGHT, pixel);
+        S32 max_diff = -1;
+        F32 mean_diff = -1.f;
+        ensure("same size", LLTexLayerCompositor::difference(a, b, max_diff, mean_diff));
+        ensure_equals("identical max", max_diff, 0);
+        ensure_equals("identical mean", mean_diff, 0.f);
+
+        // one channel of every pixel off by 4, one channel of one pixel by 9
+        for (S32 i = 0; i < COUNT; ++i)
+        {
+            b->getData()[i * 4 + 1] += 4;
+        }
+        b->getData()[2] -= 9;
+        ensure("same size", LLTexLayerCompositor::difference(a, b, max_diff, mean_diff));
+        ensure_equals("max", max_diff, 9);
+        ensure_approximately_equals("mean", mean_diff, (COUNT * 4 + 9) / (F32)(COUNT * 4), 16);
+
+        LLPointer<LLImageRaw> c = makeFlatImage(WIDTH + 1, HEIGHT, pixel);
+        ensure("different size", !LLTexLayerCompositor::difference(a, c, max_diff, mean_diff));
+    }
+
+    template<> template<>
+    void object::test<9>()
+    {
+        set_test_name("compositing benchmark");
+        // a bake sized layer stack, roughly a clothed upper body
+        LLTexLayerCompositor compositor(1024, 1024);
+        for (S32 i = 0; i < 6; ++i)
+        {
+            LLTexLayerCompositor::Layer layer;
+            layer.mColor.set(0.8f, 0.7f, 0.6f, i ? 0.8f : 1.f);
+            layer.mTexture = makeImage(512, 512, i % 2 ? 4 : 3, 20 + i);
+            if (i % 3 == 2)
+            {
+                LLTexLayerCompositor::AlphaParam param;
+                param.mWeight = 0.5f;
+                layer.mAlphaParams.push_back(param);
+                layer.mMaskTexture = makeImage(512, 512, 4, 30 + i);
+            }
+            compositor.mLayers.push_back(layer);
+        }
+        compositor.mClearAlpha = true;
+
+        const S32 runs = 5;
+        LLTimer timer;
+        LLTexLayerCompositor::Result result;
+        for (S32 i = 0; i < runs; ++i)
+        {
+            compositor.composite(result);
+        }
+        F64 ms = timer.getElapsedTimeF64() * 1000.0 / runs;
+        ensure("composited", result.mImage.notNull());
+
+        LL_INFOS("Benchmark") << "LLTexLayerCompositor 1024x1024, 6 layers: " << ms << " ms" << LL_ENDL;
+    }
+} // namespace tut
@@ -28,8 +28,7 @@
 
 #include "llbvhloader.h"
 
-#include <boost/tokenizer.hpp>
-#include <boost/lexical_cast.hpp>
+#include <atomic>
 
 #include "lldatapacker.h"
 #include "lldir.h"
@@ -38,6 +37,8 @@
 #include "llstl.h"
 #include "llapr.h"
 #include "llsdserialize.h"
+#include "jobsystem.h"
+#include "workqueue.h"
 
 
 using namespace std;
@@ -127,11 +128,165 @@ LLQuaternion::Order bvhStringToOrder( char *str )
     return retVal;
 }
 
+namespace
+{
+    //--------------------------------------------------------------------
+    // BVHLineReader
+    //
+    // Hands out the non-empty lines of a NUL terminated buffer one at a
+    // time, through a string that is reused from line to line so that
+    // reading a long MOTION section does not allocate per frame.
+    //--------------------------------------------------------------------
+    class BVHLineReader
+    {
+    public:
+        BVHLineReader(const char* buffer) : mBuffer(buffer), mPos(buffer) {}
+
+        bool next(std::string& line)
+        {
+            mPos += strspn(mPos, "\r\n");
+            if (!*mPos)
+            {
+                return false;
+            }
+            size_t length = strcspn(mPos, "\r\n");
+            line.assign(mPos, length);
+            mPos += length;
+            return true;
+        }
+
+        // bytes of the buffer consumed so far
+        size_t getOffset() const { return mPos - mBuffer; }
+
+    private:
+        const char* mBuffer;
+        const char* mPos;
+    };
+
+    // every power of ten a double holds exactly
+    const F64 POWERS_OF_TEN[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const S32 MAX_EXACT_POWER_OF_TEN = LL_ARRAY_SIZE(POWERS_OF_TEN) - 1;
+
+    //--------------------------------------------------------------------
+    // parse_frame_value()
+    //
+    // Reads the decimal number at p, which must be followed by a space, a
+    // tab or the end of the line. Returns the end of the number, or NULL if
+    // the token is not a number a float can hold. Unlike strtof(), this
+    // does not depend on the locale.
+    //--------------------------------------------------------------------
+    const char* parse_frame_value(const char* p, F32& value)
+    {
+        bool negative = false;
+        if (*p == '-' || *p == '+')
+        {
+            negative = (*p == '-');
+            ++p;
+        }
+
+        // 17 digits is past what a float resolves, and leaves room for one
+        // more in a U64
+        const U64 MAX_MANTISSA = 10000000000000000ULL;
+        U64 mantissa = 0;
+        S32 exponent = 0;
+        bool has_digits = false;
+        for (; *p >= '0' && *p <= '9'; ++p)
+        {
+            has_digits = true;
+            if (mantissa < MAX_MANTISSA)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+            }
+            else
+            {
+                ++exponent;
+            }
+        }
+        if (*p == '.')
+        {
+            for (++p; *p >= '0' && *p <= '9'; ++p)
+            {
+                has_digits = true;
+                if (mantissa < MAX_MANTISSA)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    --exponent;
+                }
+            }
+        }
+        if (!has_digits)
+        {
+            return NULL;
+        }
+
+        if (*p == 'e' || *p == 'E')
+        {
+            ++p;
+            bool negative_exponent = false;
+            if (*p == '-' || *p == '+')
+            {
+                negative_exponent = (*p == '-');
+                ++p;
+            }
+            if (*p < '0' || *p > '9')
+            {
+                return NULL;
+            }
+            S32 written_exponent = 0;
+            for (; *p >= '0' && *p <= '9'; ++p)
+            {
+                if (written_exponent < 10000)
+                {
+                    written_exponent = written_exponent * 10 + (*p - '0');
+                }
+            }
+            exponent += negative_exponent ? -written_exponent : written_exponent;
+        }
+
+        if (*p && *p != ' ' && *p != '\t')
+        {
+            return NULL;
+        }
+
+        // one rounding, hence as strtof() would, whenever the digits fit a
+        // double and the exponent fits the table; frame data always does
+        F64 result = (F64)mantissa;
+        if (exponent < 0)
+        {
+            result /= (-exponent <= MAX_EXACT_POWER_OF_TEN) ? POWERS_OF_TEN[-exponent] : pow(10.0, -exponent);
+        }
+        else if (exponent > 0)
+        {
+            result *= (exponent <= MAX_EXACT_POWER_OF_TEN) ? POWERS_OF_TEN[exponent] : pow(10.0, exponent);
+        }
+
+        value = (F32)(negative ? -result : result);
+        if (!llfinite(value))
+        {
+            return NULL;
+        }
+        return p;
+    }
+
+    // frames parsed between progress reports
+    const S32 PROGRESS_FRAME_INTERVAL = 256;
+    // parsing is reported as the first half of the load, optimize() as
+    // the second
+    const F32 PARSE_PROGRESS_SHARE = 0.5f;
+}
+
 //-----------------------------------------------------------------------------
 // LLBVHLoader()
 //-----------------------------------------------------------------------------
 
-LLBVHLoader::LLBVHLoader(const char* buffer, ELoadStatus &loadStatus, S32 &errorLine, std::map<std::string, std::string>& joint_alias_map )
+LLBVHLoader::LLBVHLoader(const char* buffer, ELoadStatus &loadStatus, S32 &errorLine, std::map<std::string, std::string>& joint_alias_map,
+                         const parallel_for_t& parallel_for, const progress_callback_t& progress)
+    : mParallelFor(parallel_for),
+      mProgress(progress)
 {
     reset();
     errorLine = 0;
@@ -194,6 +349,59 @@ LLBVHLoader::~LLBVHLoader()
     mJoints.clear();
 }
 
+//static
+bool LLBVHLoader::loadAsync(const std::string& buffer, const std::map<std::string, std::string>& joint_alias_map,
+                            const loaded_callback_t& callback, const parallel_for_t& parallel_for,
+                            const progress_callback_t& progress)
+{
+    LL::WorkQueue::ptr_t main_queue = LL::WorkQueue::getInstance("mainloop");
+    LL::WorkQueue::ptr_t general_queue = LL::WorkQueue::getInstance("General");
+    if (!main_queue || !general_queue)
+    {
+        return false;
+    }
+
+    return main_queue->postTo(
+        general_queue,
+        [buffer, joint_alias_map, parallel_for, progress]() // Work done on general queue
+        {
+            ELoadStatus status = E_ST_OK;
+            S32 error_line = 0;
+            std::map<std::string, std::string> aliases(joint_alias_map);
+            return std::make_shared<LLBVHLoader>(buffer.c_str(), status, error_line, aliases, parallel_for, progress);
+        },
+        [callback](const std::shared_ptr<LLBVHLoader>& loader) // Callback to main thread
+        {
+            callback(loader);
+        });
+}
+
+// static
+LLBVHLoader::parallel_for_t LLBVHLoader::poolParallelFor(const std::string& pool_name)
+{
+    std::weak_ptr<LL::JobSystem> weak_jobs =
+        std::dynamic_pointer_cast<LL::JobSystem>(LL::ThreadPoolBase::getInstance(pool_name));
+    if (weak_jobs.expired())
+    {
+        return parallel_for_t();
+    }
+
+    return [weak_jobs](U32 count, const std::function<void(U32)>& job)
+        {
+            if (std::shared_ptr<LL::JobSystem> jobs = weak_jobs.lock())
+            {
+                jobs->parallelFor(count, [&job](size_t i) { job((U32)i); });
+            }
+            else
+            { // pool went away during shutdown
+                for (U32 i = 0; i < count; ++i)
+                {
+                    job(i);
+                }
+            }
+        };
+}
+
 //------------------------------------------------------------------------
 // LLBVHLoader::loadTranslationTable()
 //------------------------------------------------------------------------
@@ -579,11 +787,8 @@ ELoadStatus LLBVHLoader::loadBVHFile(const char *buffer, char* error_text, S32 &
     err_line = 0;
     error_text[127] = '\0';
 
-    std::string str(buffer);
-    typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
-    boost::char_separator<char> sep("\r\n");
-    tokenizer tokens(str, sep);
-    tokenizer::iterator iter = tokens.begin();
+    const size_t length = strlen(buffer);
+    BVHLineReader reader(buffer);
 
     mLineNumber = 0;
     mJoints.clear();
@@ -593,9 +798,8 @@ ELoadStatus LLBVHLoader::loadBVHFile(const char *buffer, char* error_text, S32 &
     //--------------------------------------------------------------------
     // consume  hierarchy
     //--------------------------------------------------------------------
-    if (iter == tokens.end())
+    if (!reader.next(line))
         return E_ST_EOF;
-    line = (*(iter++));
     err_line++;
 
     if ( !strstr(line.c_str(), "HIERARCHY") )
@@ -612,9 +816,8 @@ ELoadStatus LLBVHLoader::loadBVHFile(const char *buffer, char* error_text, S32 &
         //----------------------------------------------------------------
         // get next line
         //----------------------------------------------------------------
-        if (iter == tokens.end())
+        if (!reader.next(line))
             return E_ST_EOF;
-        line = (*(iter++));
         err_line++;
 
         //----------------------------------------------------------------
@@ -646,9 +849,11 @@ ELoadStatus LLBVHLoader::loadBVHFile(const char *buffer, char* error_text, S32 &
         }
         else if ( strstr(line.c_str(), "End Site") )
         {
-            iter++; // {
-            iter++; //     OFFSET
-            iter++; // }
+            // {, OFFSET and }; running out is caught by the next read
+            for (S32 j = 0; j < 3 && reader.next(line); j++)
+            {
+                err_line++;
+            }
             S32 depth = 0;
             for (S32 j = (S32)parent_joints.size() - 1; j >= 0; j--)
             {
@@ -718,11 +923,10 @@ ELoadStatus LLBVHLoader::loadBVHFile(const char *buffer, char* error_text, S32 &
         //----------------------------------------------------------------
         // get next line
         //----------------------------------------------------------------
-        if (iter == tokens.end())
+        if (!reader.next(line))
         {
             return E_ST_EOF;
         }
-        line = (*(iter++));
         err_line++;
 
         //----------------------------------------------------------------
@@ -741,11 +945,10 @@ ELoadStatus LLBVHLoader::loadBVHFile(const char *buffer, char* error_text, S32 &
         //----------------------------------------------------------------
         // get next line
         //----------------------------------------------------------------
-        if (iter == tokens.end())
+        if (!reader.next(line))
         {
             return E_ST_EOF;
         }
-        line = (*(iter++));
         err_line++;
 
         //----------------------------------------------------------------
@@ -760,11 +963,10 @@ ELoadStatus LLBVHLoader::loadBVHFile(const char *buffer, char* error_text, S32 &
         //----------------------------------------------------------------
         // get next line
         //----------------------------------------------------------------
-        if (iter == tokens.end())
+        if (!reader.next(line))
         {
             return E_ST_EOF;
         }
-        line = (*(iter++));
         err_line++;
 
         //----------------------------------------------------------------
@@ -829,11 +1031,10 @@ ELoadStatus LLBVHLoader::loadBVHFile(const char *buffer, char* error_text, S32 &
     //--------------------------------------------------------------------
     // get number of frames
     //--------------------------------------------------------------------
-    if (iter == tokens.end())
+    if (!reader.next(line))
     {
         return E_ST_EOF;
     }
-    line = (*(iter++));
     err_line++;
 
     if ( !strstr(line.c_str(), "Frames:") )
@@ -851,11 +1052,10 @@ ELoadStatus LLBVHLoader::loadBVHFile(const char *buffer, char* error_text, S32 &
     //--------------------------------------------------------------------
     // get frame time
     //--------------------------------------------------------------------
-    if (iter == tokens.end())
+    if (!reader.next(line))
     {
         return E_ST_EOF;
     }
-    line = (*(iter++));
     err_line++;
 
     if ( !strstr(line.c_str(), "Frame Time:") )
@@ -882,62 +1082,83 @@ ELoadStatus LLBVHLoader::loadBVHFile(const char *buffer, char* error_text, S32 &
     //--------------------------------------------------------------------
     // load frames
     //--------------------------------------------------------------------
+    // Every value takes at least two bytes, so what is left of the buffer
+    // bounds how many frames a bogus Frames: count can reserve room for.
+    size_t channels_per_frame = 0;
+    for (Joint* joint : mJoints)
+    {
+        channels_per_frame += llmax(joint->mNumChannels, 3);
+    }
+    if (mNumFrames > 0 && channels_per_frame > 0)
+    {
+        size_t frames = llmin((size_t)mNumFrames, (length - reader.getOffset()) / (channels_per_frame * 2) + 1);
+        for (Joint* joint : mJoints)
+        {
+            joint->mKeys.reserve(frames);
+        }
+    }
+
+    std::vector<F32> floats;
+    floats.reserve(channels_per_frame);
     for (S32 i=0; i<mNumFrames; i++)
     {
+        if (mProgress && i % PROGRESS_FRAME_INTERVAL == 0)
+        {
+            reportProgress(PARSE_PROGRESS_SHARE * (F32)reader.getOffset() / (F32)length);
+        }
+
         // get next line
-        if (iter == tokens.end())
+        if (!reader.next(line))
         {
             return E_ST_EOF;
         }
-        line = (*(iter++));
         err_line++;
 
         // Split line into a collection of floats.
-        std::deque<F32> floats;
-        boost::char_separator<char> whitespace_sep("\t ");
-        tokenizer float_tokens(line, whitespace_sep);
-        tokenizer::iterator float_token_iter = float_tokens.begin();
-        while (float_token_iter != float_tokens.end())
+        floats.clear();
+        const char* p = line.c_str();
+        while (*(p += strspn(p, "\t ")))
         {
-            try
-            {
-                F32 val = boost::lexical_cast<float>(*float_token_iter);
-                floats.push_back(val);
-            }
-            catch (const boost::bad_lexical_cast&)
+            F32 val;
+            p = parse_frame_value(p, val);
+            if (!p)
             {
                 strncpy(error_text, line.c_str(), 127); /*Flawfinder: ignore*/
                 return E_ST_NO_POS;
             }
-            float_token_iter++;
+            floats.push_back(val);
         }
         LL_DEBUGS("BVH") << "Got " << floats.size() << " floats " << LL_ENDL;
+        const F32* next_float = floats.data();
+        const F32* floats_end = next_float + floats.size();
         for (U32 j=0; j<mJoints.size(); j++)
         {
             Joint *joint = mJoints[j];
-            joint->mKeys.push_back( Key() );
+            joint->mKeys.emplace_back();
             Key &key = joint->mKeys.back();
 
-            if (floats.size() < joint->mNumChannels)
+            // assume either numChannels == 6, in which case we have pos + rot,
+            // or numChannels == 3, in which case we have only rot.
+            if (floats_end - next_float < llmax(joint->mNumChannels, 3))
             {
                 strncpy(error_text, line.c_str(), 127); /*Flawfinder: ignore*/
                 return E_ST_NO_POS;
             }
 
-            // assume either numChannels == 6, in which case we have pos + rot,
-            // or numChannels == 3, in which case we have only rot.
             if (joint->mNumChannels == 6)
             {
-                key.mPos[0] = floats.front(); floats.pop_front();
-                key.mPos[1] = floats.front(); floats.pop_front();
-                key.mPos[2] = floats.front(); floats.pop_front();
+                key.mPos[0] = *next_float++;
+                key.mPos[1] = *next_float++;
+                key.mPos[2] = *next_float++;
             }
-            key.mRot[ joint->mOrder[0]-'X' ] = floats.front(); floats.pop_front();
-            key.mRot[ joint->mOrder[1]-'X' ] = floats.front(); floats.pop_front();
-            key.mRot[ joint->mOrder[2]-'X' ] = floats.front(); floats.pop_front();
+            key.mRot[ joint->mOrder[0]-'X' ] = *next_float++;
+            key.mRot[ joint->mOrder[1]-'X' ] = *next_float++;
+            key.mRot[ joint->mOrder[2]-'X' ] = *next_float++;
         }
     }
 
+    reportProgress(PARSE_PROGRESS_SHARE);
+
     return E_ST_OK;
 }
 
@@ -1061,178 +1282,208 @@ void LLBVHLoader::optimize()
         mEaseOut *= factor;
     }
 
-    for (Joint* joint : mJoints)
+    // Joints are reduced independently of each other, which is what makes
+    // spreading them over threads safe.
+    const U32 joint_count = (U32)mJoints.size();
+    std::atomic<U32> joints_done(0);
+    auto reduce = [&](U32 i)
     {
-        BOOL pos_changed = FALSE;
-        BOOL rot_changed = FALSE;
+        optimizeJoint(mJoints[i]);
+        if (mProgress)
+        {
+            F32 done = (F32)(++joints_done) / (F32)joint_count;
+            mProgress(PARSE_PROGRESS_SHARE + (1.f - PARSE_PROGRESS_SHARE) * done);
+        }
+    };
 
-        if ( ! joint->mIgnore )
+    if (mParallelFor)
+    {
+        mParallelFor(joint_count, reduce);
+    }
+    else
+    {
+        for (U32 i = 0; i < joint_count; ++i)
         {
-            joint->mNumPosKeys = 0;
-            joint->mNumRotKeys = 0;
-            LLQuaternion::Order order = bvhStringToOrder( joint->mOrder );
+            reduce(i);
+        }
+    }
+}
 
-            KeyVector::iterator first_key = joint->mKeys.begin();
+//-----------------------------------------------------------------------------
+// LLBVHLoader::optimizeJoint()
+//-----------------------------------------------------------------------------
+//static
+void LLBVHLoader::optimizeJoint(Joint* joint)
+{
+    BOOL pos_changed = FALSE;
+    BOOL rot_changed = FALSE;
 
-            // no keys?
-            if (first_key == joint->mKeys.end())
-            {
-                joint->mIgnore = TRUE;
-                continue;
-            }
+    if ( ! joint->mIgnore )
+    {
+        joint->mNumPosKeys = 0;
+        joint->mNumRotKeys = 0;
+        LLQuaternion::Order order = bvhStringToOrder( joint->mOrder );
+
+        KeyVector::iterator first_key = joint->mKeys.begin();
+
+        // no keys?
+        if (first_key == joint->mKeys.end())
+        {
+            joint->mIgnore = TRUE;
+            return;
+        }
+
+        LLVector3 first_frame_pos(first_key->mPos);
+        LLQuaternion first_frame_rot = mayaQ( first_key->mRot[0], first_key->mRot[1], first_key->mRot[2], order);
+
+        // skip first key
+        KeyVector::iterator ki = joint->mKeys.begin();
+        if (joint->mKeys.size() == 1)
+        {
+            // *FIX: use single frame to move pelvis
+            // if only one keyframe force output for this joint
+            rot_changed = TRUE;
+        }
+        else
+        {
+            // if more than one keyframe, use first frame as reference and skip to second
+            first_key->mIgnorePos = TRUE;
+            first_key->mIgnoreRot = TRUE;
+            ++ki;
+        }
+
+        KeyVector::iterator ki_prev = ki;
+        KeyVector::iterator ki_last_good_pos = ki;
+        KeyVector::iterator ki_last_good_rot = ki;
+        S32 numPosFramesConsidered = 2;
+        S32 numRotFramesConsidered = 2;
 
-            LLVector3 first_frame_pos(first_key->mPos);
-            LLQuaternion first_frame_rot = mayaQ( first_key->mRot[0], first_key->mRot[1], first_key->mRot[2], order);
+        F32 rot_threshold = ROTATION_KEYFRAME_THRESHOLD / llmax((F32)joint->mChildTreeMaxDepth * 0.33f, 1.f);
 
-            // skip first key
-            KeyVector::iterator ki = joint->mKeys.begin();
-            if (joint->mKeys.size() == 1)
+        double diff_max = 0;
+        KeyVector::iterator ki_max = ki;
+        for (; ki != joint->mKeys.end(); ++ki)
+        {
+            if (ki_prev == ki_last_good_pos)
             {
-                // *FIX: use single frame to move pelvis
-                // if only one keyframe force output for this joint
-                rot_changed = TRUE;
+                joint->mNumPosKeys++;
+                if (dist_vec_squared(LLVector3(ki_prev->mPos), first_frame_pos) > POSITION_MOTION_THRESHOLD_SQUARED)
+                {
+                    pos_changed = TRUE;
+                }
             }
             else
             {
-                // if more than one keyframe, use first frame as reference and skip to second
-                first_key->mIgnorePos = TRUE;
-                first_key->mIgnoreRot = TRUE;
-                ++ki;
-            }
-
-            KeyVector::iterator ki_prev = ki;
-            KeyVector::iterator ki_last_good_pos = ki;
-            KeyVector::iterator ki_last_good_rot = ki;
-            S32 numPosFramesConsidered = 2;
-            S32 numRotFramesConsidered = 2;
+                //check position for noticeable effect
+                LLVector3 test_pos(ki_prev->mPos);
+                LLVector3 last_good_pos(ki_last_good_pos->mPos);
+                LLVector3 current_pos(ki->mPos);
+                LLVector3 interp_pos = lerp(current_pos, last_good_pos, 1.f / (F32)numPosFramesConsidered);
 
-            F32 rot_threshold = ROTATION_KEYFRAME_THRESHOLD / llmax((F32)joint->mChildTreeMaxDepth * 0.33f, 1.f);
+                if (dist_vec_squared(current_pos, first_frame_pos) > POSITION_MOTION_THRESHOLD_SQUARED)
+                {
+                    pos_changed = TRUE;
+                }
 
-            double diff_max = 0;
-            KeyVector::iterator ki_max = ki;
-            for (; ki != joint->mKeys.end(); ++ki)
-            {
-                if (ki_prev == ki_last_good_pos)
+                if (dist_vec_squared(interp_pos, test_pos) < POSITION_KEYFRAME_THRESHOLD_SQUARED)
                 {
-                    joint->mNumPosKeys++;
-                    if (dist_vec_squared(LLVector3(ki_prev->mPos), first_frame_pos) > POSITION_MOTION_THRESHOLD_SQUARED)
-                    {
-                        pos_changed = TRUE;
-                    }
+                    ki_prev->mIgnorePos = TRUE;
+                    numPosFramesConsidered++;
                 }
                 else
                 {
-                    //check position for noticeable effect
-                    LLVector3 test_pos(ki_prev->mPos);
-                    LLVector3 last_good_pos(ki_last_good_pos->mPos);
-                    LLVector3 current_pos(ki->mPos);
-                    LLVector3 interp_pos = lerp(current_pos, last_good_pos, 1.f / (F32)numPosFramesConsidered);
+                    numPosFramesConsidered = 2;
+                    ki_last_good_pos = ki_prev;
+                    joint->mNumPosKeys++;
+                }
+            }
 
-                    if (dist_vec_squared(current_pos, first_frame_pos) > POSITION_MOTION_THRESHOLD_SQUARED)
-                    {
-                        pos_changed = TRUE;
-                    }
+            if (ki_prev == ki_last_good_rot)
+            {
+                joint->mNumRotKeys++;
+                LLQuaternion test_rot = mayaQ( ki_prev->mRot[0], ki_prev->mRot[1], ki_prev->mRot[2], order);
+                F32 x_delta = dist_vec(LLVector3::x_axis * first_frame_rot, LLVector3::x_axis * test_rot);
+                F32 y_delta = dist_vec(LLVector3::y_axis * first_frame_rot, LLVector3::y_axis * test_rot);
+                F32 rot_test = x_delta + y_delta;
 
-                    if (dist_vec_squared(interp_pos, test_pos) < POSITION_KEYFRAME_THRESHOLD_SQUARED)
-                    {
-                        ki_prev->mIgnorePos = TRUE;
-                        numPosFramesConsidered++;
-                    }
-                    else
-                    {
-                        numPosFramesConsidered = 2;
-                        ki_last_good_pos = ki_prev;
-                        joint->mNumPosKeys++;
-                    }
+                if (rot_test > ROTATION_MOTION_THRESHOLD)
+                {
+                    rot_changed = TRUE;
                 }
-
-                if (ki_prev == ki_last_good_rot)
+            }
+            else
+            {
+                //check rotation for noticeable effect
+                LLQuaternion test_rot = mayaQ( ki_prev->mRot[0], ki_prev->mRot[1], ki_prev->mRot[2], order);
+                LLQuaternion last_good_rot = mayaQ( ki_last_good_rot->mRot[0], ki_last_good_rot->mRot[1], ki_last_good_rot->mRot[2], order);
+                LLQuaternion current_rot = mayaQ( ki->mRot[0], ki->mRot[1], ki->mRot[2], order);
+                LLQuaternion interp_rot = lerp(1.f / (F32)numRotFramesConsidered, current_rot, last_good_rot);
+
+                F32 x_delta;
+                F32 y_delta;
+                F32 rot_test;
+
+                // Test if the rotation has changed significantly since the very first frame.  If false
+                // for all frames, then we'll just throw out this joint's rotation entirely.
+                x_delta = dist_vec(LLVector3::x_axis * first_frame_rot, LLVector3::x_axis * test_rot);
+                y_delta = dist_vec(LLVector3::y_axis * first_frame_rot, LLVector3::y_axis * test_rot);
+                rot_test = x_delta + y_delta;
+                if (rot_test > ROTATION_MOTION_THRESHOLD)
                 {
+                    rot_changed = TRUE;
+                }
+                x_delta = dist_vec(LLVector3::x_axis * interp_rot, LLVector3::x_axis * test_rot);
+                y_delta = dist_vec(LLVector3::y_axis * interp_rot, LLVector3::y_axis * test_rot);
+                rot_test = x_delta + y_delta;
+
+                // Draw a line between the last good keyframe and current.  Test the distance between the last frame (current-1, i.e. ki_prev)
+                // and the line.  If it's greater than some threshold, then it represents a significant frame and we want to include it.
+                if (rot_test >= rot_threshold ||
+                    (ki+1 == joint->mKeys.end() && numRotFramesConsidered > 2))
+                {
+                    // Add the current test keyframe (which is technically the previous key, i.e. ki_prev).
+                    numRotFramesConsidered = 2;
+                    ki_last_good_rot = ki_prev;
                     joint->mNumRotKeys++;
-                    LLQuaternion test_rot = mayaQ( ki_prev->mRot[0], ki_prev->mRot[1], ki_prev->mRot[2], order);
-                    F32 x_delta = dist_vec(LLVector3::x_axis * first_frame_rot, LLVector3::x_axis * test_rot);
-                    F32 y_delta = dist_vec(LLVector3::y_axis * first_frame_rot, LLVector3::y_axis * test_rot);
-                    F32 rot_test = x_delta + y_delta;
 
-                    if (rot_test > ROTATION_MOTION_THRESHOLD)
+                    // Add another keyframe between the last good keyframe and current, at whatever point was the most "significant" (i.e.
+                    // had the largest deviation from the earlier tests).  Note that a more robust approach would be test all intermediate
+                    // keyframes against the line between the last good keyframe and current, but we're settling for this other method
+                    // because it's significantly faster.
+                    if (diff_max > 0)
                     {
-                        rot_changed = TRUE;
+                        if (ki_max->mIgnoreRot == TRUE)
+                        {
+                            ki_max->mIgnoreRot = FALSE;
+                            joint->mNumRotKeys++;
+                        }
+                        diff_max = 0;
                     }
                 }
                 else
                 {
-                    //check rotation for noticeable effect
-                    LLQuaternion test_rot = mayaQ( ki_prev->mRot[0], ki_prev->mRot[1], ki_prev->mRot[2], order);
-                    LLQuaternion last_good_rot = mayaQ( ki_last_good_rot->mRot[0], ki_last_good_rot->mRot[1], ki_last_good_rot->mRot[2], order);
-                    LLQuaternion current_rot = mayaQ( ki->mRot[0], ki->mRot[1], ki->mRot[2], order);
-                    LLQuaternion interp_rot = lerp(1.f / (F32)numRotFramesConsidered, current_rot, last_good_rot);
-
-                    F32 x_delta;
-                    F32 y_delta;
-                    F32 rot_test;
-
-                    // Test if the rotation has changed significantly since the very first frame.  If false
-                    // for all frames, then we'll just throw out this joint's rotation entirely.
-                    x_delta = dist_vec(LLVector3::x_axis * first_frame_rot, LLVector3::x_axis * test_rot);
-                    y_delta = dist_vec(LLVector3::y_axis * first_frame_rot, LLVector3::y_axis * test_rot);
-                    rot_test = x_delta + y_delta;
-                    if (rot_test > ROTATION_MOTION_THRESHOLD)
-                    {
-                        rot_changed = TRUE;
-                    }
-                    x_delta = dist_vec(LLVector3::x_axis * interp_rot, LLVector3::x_axis * test_rot);
-                    y_delta = dist_vec(LLVector3::y_axis * interp_rot, LLVector3::y_axis * test_rot);
-                    rot_test = x_delta + y_delta;
-
-                    // Draw a line between the last good keyframe and current.  Test the distance between the last frame (current-1, i.e. ki_prev)
-                    // and the line.  If it's greater than some threshold, then it represents a significant frame and we want to include it.
-                    if (rot_test >= rot_threshold ||
-                        (ki+1 == joint->mKeys.end() && numRotFramesConsidered > 2))
-                    {
-                        // Add the current test keyframe (which is technically the previous key, i.e. ki_prev).
-                        numRotFramesConsidered = 2;
-                        ki_last_good_rot = ki_prev;
-                        joint->mNumRotKeys++;
-
-                        // Add another keyframe between the last good keyframe and current, at whatever point was the most "significant" (i.e.
-                        // had the largest deviation from the earlier tests).  Note that a more robust approach would be test all intermediate
-                        // keyframes against the line between the last good keyframe and current, but we're settling for this other method
-                        // because it's significantly faster.
-                        if (diff_max > 0)
-                        {
-                            if (ki_max->mIgnoreRot == TRUE)
-                            {
-                                ki_max->mIgnoreRot = FALSE;
-                                joint->mNumRotKeys++;
-                            }
-                            diff_max = 0;
-                        }
-                    }
-                    else
+                    // This keyframe isn't significant enough, throw it away.
+                    ki_prev->mIgnoreRot = TRUE;
+                    numRotFramesConsidered++;
+                    // Store away the keyframe that has the largest deviation from the interpolated line, for insertion later.
+                    if (rot_test > diff_max)
                     {
-                        // This keyframe isn't significant enough, throw it away.
-                        ki_prev->mIgnoreRot = TRUE;
-                        numRotFramesConsidered++;
-                        // Store away the keyframe that has the largest deviation from the interpolated line, for insertion later.
-                        if (rot_test > diff_max)
-                        {
-                            diff_max = rot_test;
-                            ki_max = ki;
-                        }
+                        diff_max = rot_test;
+                        ki_max = ki;
                     }
                 }
-
-                ki_prev = ki;
             }
-        }
 
-        // don't output joints with no motion
-        if (!(pos_changed || rot_changed))
-        {
-            //LL_INFOS() << "Ignoring joint " << joint->mName << LL_ENDL;
-            joint->mIgnore = TRUE;
+            ki_prev = ki;
         }
     }
+
+    // don't output joints with no motion
+    if (!(pos_changed || rot_changed))
+    {
+        //LL_INFOS() << "Ignoring joint " << joint->mName << LL_ENDL;
+        joint->mIgnore = TRUE;
+    }
 }
 
 void LLBVHLoader::reset()
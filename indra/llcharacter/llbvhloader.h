@@ -27,6 +27,9 @@
 #ifndef LL_LLBVHLOADER_H
 #define LL_LLBVHLOADER_H
 
+#include <functional>
+#include <memory>
+
 #include "v3math.h"
 #include "m3math.h"
 #include "llmath.h"
@@ -226,10 +229,34 @@ class LLBVHLoader
 {
     friend class LLKeyframeMotion;
 public:
+    // Calls job(i) once for each i in [0, count), possibly concurrently, and
+    // returns once all of them have. optimize() uses it to reduce the keys
+    // of each joint in parallel; without one it runs them in order.
+    typedef std::function<void(U32 count, const std::function<void(U32)>& job)> parallel_for_t;
+
+    // A parallel_for_t that spreads the joints over the named LL::JobSystem
+    // pool, calling thread included. Empty if there is no such pool.
+    static parallel_for_t poolParallelFor(const std::string& pool_name = "General");
+
+    // Told how much of the load is done, from 0 to 1. Parsing reports from
+    // the loading thread, optimize() from whichever thread parallel_for ran
+    // a joint on, so calls may overlap and arrive slightly out of order.
+    typedef std::function<void(F32 fraction)> progress_callback_t;
+
     // Constructor
-    LLBVHLoader(const char* buffer, ELoadStatus &loadStatus, S32 &errorLine, std::map<std::string, std::string>& joint_alias_map );
+    LLBVHLoader(const char* buffer, ELoadStatus &loadStatus, S32 &errorLine, std::map<std::string, std::string>& joint_alias_map,
+                const parallel_for_t& parallel_for = parallel_for_t(), const progress_callback_t& progress = progress_callback_t());
     ~LLBVHLoader();
 
+    // Runs the constructor on the "General" thread pool and hands the
+    // loader to callback on the main loop; its getStatus() and
+    // getLineNumber() say how the load went. Returns false, without calling
+    // back, when the queues are not available.
+    typedef std::function<void(const std::shared_ptr<LLBVHLoader>& loader)> loaded_callback_t;
+    static bool loadAsync(const std::string& buffer, const std::map<std::string, std::string>& joint_alias_map,
+                          const loaded_callback_t& callback, const parallel_for_t& parallel_for = parallel_for_t(),
+                          const progress_callback_t& progress = progress_callback_t());
+
 /*
     // Status Codes
     typedef const char *status_t;
@@ -310,6 +337,11 @@ class LLBVHLoader
     // Consumes one line of input from file.
     BOOL getLine(apr_file_t *fp);
 
+    // optimize() for a single joint; touches nothing but the joint.
+    static void optimizeJoint(Joint* joint);
+
+    void reportProgress(F32 fraction) const { if (mProgress) mProgress(fraction); }
+
     // parser state
     char        mLine[BVH_PARSER_LINE_SIZE];        /* Flawfinder: ignore */
     S32         mLineNumber;
@@ -335,6 +367,9 @@ class LLBVHLoader
 
     // computed values
     F32 mDuration;
+
+    parallel_for_t      mParallelFor;
+    progress_callback_t mProgress;
 };
 
 #endif // LL_LLBVHLOADER_H
@@ -191,22 +191,46 @@ void LLCharacter::requestStopMotion( LLMotion* motion)
 void LLCharacter::updateMotions(e_update_t update_type)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    if (prepareMotions(update_type))
+    {
+        evaluateMotions(update_type);
+    }
+    finishMotions();
+}
+
+//-----------------------------------------------------------------------------
+// prepareMotions()
+//-----------------------------------------------------------------------------
+bool LLCharacter::prepareMotions(e_update_t update_type)
+{
     if (update_type == HIDDEN_UPDATE)
     {
         mMotionController.updateMotionsMinimal();
+        return false;
     }
-    else
+
+    // unpause if the number of outstanding pause requests has dropped to the initial one
+    if (mMotionController.isPaused() && mPauseRequest->getNumRefs() == 1)
     {
-        // unpause if the number of outstanding pause requests has dropped to the initial one
-        if (mMotionController.isPaused() && mPauseRequest->getNumRefs() == 1)
-        {
-            mMotionController.unpauseAllMotions();
-        }
-        bool force_update = (update_type == FORCE_UPDATE);
-        {
-            mMotionController.updateMotions(force_update);
-        }
+        mMotionController.unpauseAllMotions();
     }
+    return mMotionController.prepareMotions();
+}
+
+//-----------------------------------------------------------------------------
+// evaluateMotions()
+//-----------------------------------------------------------------------------
+void LLCharacter::evaluateMotions(e_update_t update_type)
+{
+    mMotionController.evaluateMotions(update_type == FORCE_UPDATE);
+}
+
+//-----------------------------------------------------------------------------
+// finishMotions()
+//-----------------------------------------------------------------------------
+void LLCharacter::finishMotions()
+{
+    mMotionController.finishMotions();
 }
 
 
@@ -158,10 +158,18 @@ class LLCharacter
     enum e_update_t { NORMAL_UPDATE, HIDDEN_UPDATE, FORCE_UPDATE };
     void updateMotions(e_update_t update_type);
 
+    // updateMotions() split as LLMotionController::prepareMotions(),
+    // evaluateMotions() and finishMotions(), for animating many characters
+    // in parallel. prepareMotions() returns false if there is nothing for
+    // evaluateMotions() to do; finishMotions() is always due.
+    bool prepareMotions(e_update_t update_type);
+    void evaluateMotions(e_update_t update_type);
+    void finishMotions();
+
     LLAnimPauseRequest requestPause();
     BOOL areAnimationsPaused() const { return mMotionController.isPaused(); }
     void setAnimTimeFactor(F32 factor) { mMotionController.setTimeFactor(factor); }
-    void setTimeStep(F32 time_step) { mMotionController.setTimeStep(time_step); }
+    void setTimeStep(F32 time_step, F32 phase = 0.f) { mMotionController.setTimeStep(time_step, phase); }
 
     LLMotionController& getMotionController() { return mMotionController; }
 
@@ -32,11 +32,12 @@
 #include "lljoint.h"
 
 #include "llmath.h"
+#include "llskeletonpose.h"
 #include "llcallstack.h"
 #include <boost/algorithm/string.hpp>
 
-S32 LLJoint::sNumUpdates = 0;
-S32 LLJoint::sNumTouches = 0;
+std::atomic<S32> LLJoint::sNumUpdates{ 0 };
+std::atomic<S32> LLJoint::sNumTouches{ 0 };
 
 template <class T>
 bool attachment_map_iter_compare_key(const T& a, const T& b)
@@ -105,6 +106,7 @@ void LLJoint::init()
 {
     mName = "unnamed";
     mParent = NULL;
+    mPoseBuffer = NULL;
     mXform.setScaleChildOffset(TRUE);
     mXform.setScale(LLVector3(1.0f, 1.0f, 1.0f));
     mDirtyFlags = MATRIX_DIRTY | ROTATION_DIRTY | POSITION_DIRTY;
@@ -156,6 +158,7 @@ LLJoint::~LLJoint()
         mParent->removeChild( this );
     }
     removeAllChildren();
+    delete mPoseBuffer;
 }
 
 
@@ -200,7 +203,7 @@ void LLJoint::touch(U32 flags)
 {
     if ((flags | mDirtyFlags) != mDirtyFlags)
     {
-        sNumTouches++;
+        sNumTouches.fetch_add(1, std::memory_order_relaxed);
         mDirtyFlags |= flags;
         U32 child_flags = flags;
         if (flags & ROTATION_DIRTY)
@@ -273,6 +276,7 @@ void LLJoint::addChild(LLJoint* joint)
     joint->mXform.setParent(&mXform);
     joint->mParent = this;
     joint->touch();
+    onHierarchyChanged();
 }
 
 
@@ -289,6 +293,7 @@ void LLJoint::removeChild(LLJoint* joint)
         joint->mXform.setParent(NULL);
         joint->mParent = NULL;
         joint->touch();
+        onHierarchyChanged();
     }
 }
 
@@ -308,10 +313,30 @@ void LLJoint::removeAllChildren()
             //delete joint;
         }
     }
+    if (!mChildren.empty())
+    {
+        onHierarchyChanged();
+    }
     mChildren.clear();
 }
 
 
+//--------------------------------------------------------------------
+// onHierarchyChanged()
+//--------------------------------------------------------------------
+void LLJoint::onHierarchyChanged()
+{
+    // only the skeleton this joint belongs to is affected
+    for (LLJoint* joint = this; joint; joint = joint->mParent)
+    {
+        if (joint->mPoseBuffer)
+        {
+            joint->mPoseBuffer->setLayoutDirty();
+        }
+    }
+}
+
+
 //--------------------------------------------------------------------
 // getPosition()
 //--------------------------------------------------------------------
@@ -1006,6 +1031,12 @@ void LLJoint::updateWorldMatrixChildren()
 {
     if (!this->mUpdateXform) return;
 
+    if (mPoseBuffer)
+    {
+        mPoseBuffer->update();
+        return;
+    }
+
     if (mDirtyFlags & MATRIX_DIRTY)
     {
         updateWorldMatrix();
@@ -1016,6 +1047,22 @@ void LLJoint::updateWorldMatrixChildren()
     }
 }
 
+//-----------------------------------------------------------------------------
+// setPoseBuffer()
+//-----------------------------------------------------------------------------
+void LLJoint::setPoseBuffer(bool enable)
+{
+    if (enable && !mPoseBuffer)
+    {
+        mPoseBuffer = new LLSkeletonPose(this);
+    }
+    else if (!enable && mPoseBuffer)
+    {
+        delete mPoseBuffer;
+        mPoseBuffer = NULL;
+    }
+}
+
 //-----------------------------------------------------------------------------
 // updateWorldMatrix()
 //-----------------------------------------------------------------------------
@@ -1023,7 +1070,7 @@ void LLJoint::updateWorldMatrix()
 {
     if (mDirtyFlags & MATRIX_DIRTY)
     {
-        sNumUpdates++;
+        sNumUpdates.fetch_add(1, std::memory_order_relaxed);
         mXform.updateMatrix(FALSE);
         mWorldMatrix = mXform.getWorldMatrix();
         mDirtyFlags = 0x0;
@@ -30,6 +30,7 @@
 //-----------------------------------------------------------------------------
 // Header Files
 //-----------------------------------------------------------------------------
+#include <atomic>
 #include <string>
 #include <list>
 
@@ -55,6 +56,8 @@ const U32 LL_FACE_JOINT_NUM = (LL_CHARACTER_MAX_ANIMATED_JOINTS-2);
 const S32 LL_CHARACTER_MAX_PRIORITY = 7;
 const F32 LL_MAX_PELVIS_OFFSET = 5.f;
 
+class LLSkeletonPose;
+
 const F32 LL_JOINT_TRESHOLD_POS_OFFSET = 0.0001f; //0.1 mm
 
 class LLVector3OverrideMap
@@ -91,6 +94,7 @@ LL_ALIGN_PREFIX(16)
 class LLJoint
 {
     LL_ALIGN_NEW
+    friend class LLSkeletonPose;
 public:
     // priority levels, from highest to lowest
     enum JointPriority
@@ -129,6 +133,13 @@ class LLJoint
     // parent joint
     LLJoint *mParent;
 
+    // evaluates this joint's subtree when set, see setPoseBuffer()
+    LLSkeletonPose* mPoseBuffer;
+
+    // this joint gained or lost a child: have the pose buffers above it
+    // lay their joints out again
+    void onHierarchyChanged();
+
     LLVector3       mDefaultPosition;
     LLVector3       mDefaultScale;
 
@@ -158,9 +169,9 @@ class LLJoint
     typedef std::vector<LLJoint*> joints_t;
     joints_t mChildren;
 
-    // debug statics
-    static S32      sNumTouches;
-    static S32      sNumUpdates;
+    // debug statics, counted by every thread animating avatars
+    static std::atomic<S32> sNumTouches;
+    static std::atomic<S32> sNumUpdates;
     typedef std::set<std::string> debug_joint_name_t;
     static debug_joint_name_t s_debugJointNames;
     static void setDebugJointNames(const debug_joint_name_t& names);
@@ -304,6 +315,13 @@ class LLJoint
 
     void updateWorldMatrix();
 
+    // Have updateWorldMatrixChildren() evaluate this joint's subtree with a
+    // flat, SIMD LLSkeletonPose instead of recursing. Meant for the root of
+    // a skeleton.
+    void setPoseBuffer(bool enable);
+    bool hasPoseBuffer() const { return mPoseBuffer != NULL; }
+    const LLSkeletonPose* getPoseBuffer() const { return mPoseBuffer; }
+
     // get/set skin offset
     const LLVector3 &getSkinOffset();
     void setSkinOffset( const LLVector3 &offset);
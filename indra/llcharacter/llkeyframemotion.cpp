@@ -61,6 +61,217 @@ static F32 MIN_ACCELERATION_SQUARED = 0.0005f * 0.0005f;
 
 static F32 MAX_CONSTRAINTS = 10;
 
+// samples further than this many keys past the last one search instead
+static const U32 MAX_KEY_CURSOR_STEPS = 8;
+
+//-----------------------------------------------------------------------------
+// Packed keys
+//-----------------------------------------------------------------------------
+namespace
+{
+    // a rotation or position key as read from the asset
+    struct QuantizedKey
+    {
+        F32 mTime;
+        U16 mValues[4]; // time, x, y, z
+    };
+
+    // Appends keys to packed in time order. Of several keys with the same
+    // time only the last one read is kept, as with Curve::mKeys.
+    LLKeyframeMotion::PackedCurve pack_keys(std::vector<QuantizedKey>& keys, std::vector<U16>& packed)
+    {
+        std::stable_sort(keys.begin(), keys.end(),
+                         [](const QuantizedKey& a, const QuantizedKey& b) { return a.mTime < b.mTime; });
+
+        LLKeyframeMotion::PackedCurve curve;
+        curve.mFirstKey = (U32)(packed.size() / 4);
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            if (i + 1 < keys.size() && keys[i + 1].mTime == keys[i].mTime)
+            {
+                continue;
+            }
+            packed.insert(packed.end(), keys[i].mValues, keys[i].mValues + 4);
+            ++curve.mNumKeys;
+        }
+        keys.clear();
+        return curve;
+    }
+
+    // the ranges deserialize() unpacks a curve's key lanes, time, x, y and
+    // z, with, as lower bound, upper - lower and the smallest non zero value
+    struct KeyRange
+    {
+        LLVector4a mLower;
+        LLVector4a mDelta;
+        LLVector4a mMaxError;
+        bool mRotation;
+    };
+
+    KeyRange make_key_range(F32 duration, F32 lower, F32 upper, bool rotation)
+    {
+        KeyRange range;
+        range.mLower.set(0.f, lower, lower, lower);
+        range.mDelta.set(duration - 0.f, upper - lower, upper - lower, upper - lower);
+        range.mMaxError = range.mDelta;
+        range.mMaxError.mul(OOU16MAX);
+        range.mRotation = rotation;
+        return range;
+    }
+
+    // Decodes key index into value and returns its time: the x, y, z and w
+    // of a rotation as LLQuaternion::unpackFromVector3() has them, or the x,
+    // y and z of a position. All lanes are decoded at once, each exactly as
+    // U16_to_F32() would.
+    F32 decode_key(const U16* keys, U32 index, const KeyRange& range, F32* value)
+    {
+        __m128i ival = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(keys + index * 4)), _mm_setzero_si128());
+        __m128 val = _mm_mul_ps(_mm_cvtepi32_ps(ival), _mm_set1_ps(OOU16MAX));
+        val = _mm_add_ps(_mm_mul_ps(val, range.mDelta), range.mLower);
+
+        // make sure that zero's come through as zero
+        __m128 magnitude = _mm_andnot_ps(_mm_set1_ps(-0.f), val);
+        LLVector4a lanes(_mm_andnot_ps(_mm_cmplt_ps(magnitude, range.mMaxError), val));
+
+        const F32* decoded = lanes.getF32ptr();
+        if (range.mRotation)
+        {
+            LLQuaternion rot;
+            rot.unpackFromVector3(LLVector3(decoded + 1));
+            memcpy(value, rot.mQ, sizeof(rot.mQ));
+        }
+        else
+        {
+            memcpy(value, decoded + 1, 3 * sizeof(F32));
+            value[3] = 0.f;
+        }
+        return decoded[0];
+    }
+
+    // The smallest quantized key time that decodes to time or later, or
+    // U16MAX + 1 if none does. Key times decode in the same order they are
+    // quantized in, so a key is before time exactly when its U16 is below
+    // this, and seeking needs no decoding.
+    U32 quantize_time(F32 time, F32 duration)
+    {
+        if (!(time > 0.f))
+        {
+            return 0;
+        }
+        U32 quantized = (U32)llclamp(time / duration * U16MAX, 0.f, (F32)U16MAX);
+        while (quantized > 0 && U16_to_F32((U16)(quantized - 1), 0.f, duration) >= time)
+        {
+            --quantized;
+        }
+        while (quantized <= U16MAX && U16_to_F32((U16)quantized, 0.f, duration) < time)
+        {
+            ++quantized;
+        }
+        return quantized;
+    }
+
+    // The first of num_keys keys at or after time, as std::lower_bound()
+    // over the curve's mKeys finds it. Starts from cursor, the key the
+    // previous sample found, and only searches when time went backwards or
+    // skipped ahead many keys.
+    U32 seek_key(const U16* keys, U32 num_keys, U32 cursor, U32 time)
+    {
+        U32 first = 0;
+        U32 last = llmin(cursor, num_keys);
+        if (last == 0 || keys[(last - 1) * 4] < time)
+        {
+            // forward from the cursor, a few keys at most
+            for (U32 steps = 0; last < num_keys && keys[last * 4] < time; ++steps)
+            {
+                ++last;
+                if (steps == MAX_KEY_CURSOR_STEPS)
+                {
+                    // skipped well ahead, search the rest
+                    first = last;
+                    last = num_keys;
+                    break;
+                }
+            }
+            if (first == 0)
+            {
+                return last;
+            }
+        }
+
+        // back from the cursor, or far ahead of it
+        U32 count = last - first;
+        while (count > 0)
+        {
+            U32 step = count / 2;
+            if (keys[(first + step) * 4] < time)
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+            {
+                count = step;
+            }
+        }
+        return first;
+    }
+
+    const char* const ROTATION_KEY_NAMES[4] = { "time", "rot_angle_x", "rot_angle_y", "rot_angle_z" };
+    const char* const POSITION_KEY_NAMES[4] = { "time", "pos_x", "pos_y", "pos_z" };
+
+    // Writes a packed curve's keys the way serialize() writes a curve's.
+    BOOL pack_packed_keys(LLDataPacker& dp, const std::vector<U16>& keys, const LLKeyframeMotion::PackedCurve& curve,
+                          const char* const names[4])
+    {
+        BOOL success = TRUE;
+        for (U32 k = curve.mFirstKey * 4; k < (curve.mFirstKey + curve.mNumKeys) * 4; k++)
+        {
+            success &= dp.packU16(keys[k], names[k % 4]);
+        }
+        return success;
+    }
+
+    // Brings cursor to time, finding keys the way Curve::getValue() does.
+    // Returns true when time falls between the cursor's mBefore and mAfter,
+    // or false when the value there is just mAfter. Keys are only decoded
+    // when the cursor moves onto them.
+    bool seek_cursor(const U16* keys, U32 num_keys, LLKeyframeMotion::KeyCursor& cursor, F32 time,
+                     U32 quantized_time, const KeyRange& range)
+    {
+        if (cursor.mValid && cursor.mKey > 0 && cursor.mKey < num_keys &&
+            cursor.mBeforeTime < time && time < cursor.mAfterTime)
+        {
+            // still between the same two keys, as while playing forward
+            return true;
+        }
+
+        U32 right = seek_key(keys, num_keys, cursor.mKey, quantized_time);
+        if (!cursor.mValid || right != cursor.mKey)
+        {
+            if (right > 0 && right < num_keys)
+            {
+                if (cursor.mValid && right == cursor.mKey + 1)
+                {
+                    // moved on by one key, the one after is now the one before
+                    memcpy(cursor.mBefore, cursor.mAfter, sizeof(cursor.mBefore));
+                    cursor.mBeforeTime = cursor.mAfterTime;
+                }
+                else
+                {
+                    cursor.mBeforeTime = decode_key(keys, right - 1, range, cursor.mBefore);
+                }
+            }
+            // past the last key, sample that
+            cursor.mAfterTime = decode_key(keys, llmin(right, num_keys - 1), range, cursor.mAfter);
+            cursor.mKey = right;
+            cursor.mValid = true;
+        }
+
+        // before the first key, past the last or exactly on one, that key
+        return right > 0 && right < num_keys && cursor.mAfterTime != time;
+    }
+}
+
 //-----------------------------------------------------------------------------
 // JointMotionList
 //-----------------------------------------------------------------------------
@@ -85,6 +296,48 @@ LLKeyframeMotion::JointMotionList::~JointMotionList()
     mJointMotionArray.clear();
 }
 
+void LLKeyframeMotion::JointMotionList::unpackKeys()
+{
+    if (!hasPackedKeys())
+    {
+        return;
+    }
+
+    const KeyRange rot_range = make_key_range(mDuration, -1.f, 1.f, true);
+    const KeyRange pos_range = make_key_range(mDuration, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET, false);
+    F32 value[4];
+    for (U32 i = 0; i < getNumJointMotions(); i++)
+    {
+        JointMotion* joint_motion = mJointMotionArray[i];
+
+        const PackedCurve& rotations = mPackedRotations[i];
+        RotationCurve& rot_curve = joint_motion->mRotationCurve;
+        rot_curve.mKeys.clear();
+        for (U32 k = rotations.mFirstKey; k < rotations.mFirstKey + rotations.mNumKeys; k++)
+        {
+            RotationKey rot_key;
+            rot_key.mTime = decode_key(mPackedKeys.data(), k, rot_range, value);
+            memcpy(rot_key.mValue.mQ, value, sizeof(rot_key.mValue.mQ));
+            rot_curve.mKeys[rot_key.mTime] = rot_key;
+        }
+
+        const PackedCurve& positions = mPackedPositions[i];
+        PositionCurve& pos_curve = joint_motion->mPositionCurve;
+        pos_curve.mKeys.clear();
+        for (U32 k = positions.mFirstKey; k < positions.mFirstKey + positions.mNumKeys; k++)
+        {
+            PositionKey pos_key;
+            pos_key.mTime = decode_key(mPackedKeys.data(), k, pos_range, value);
+            pos_key.mValue.set(value);
+            pos_curve.mKeys[pos_key.mTime] = pos_key;
+        }
+    }
+
+    std::vector<U16>().swap(mPackedKeys);
+    std::vector<PackedCurve>().swap(mPackedRotations);
+    std::vector<PackedCurve>().swap(mPackedPositions);
+}
+
 U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 {
     S32 total_size = sizeof(JointMotionList);
@@ -101,14 +354,14 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 
             total_size += joint_motion_p->mScaleCurve.mNumKeys * sizeof(ScaleKey);
         }
-        if (joint_motion_p->mUsage & LLJointState::ROT)
+        if ((joint_motion_p->mUsage & LLJointState::ROT) && !hasPackedKeys())
         {
             LL_INFOS() << "\t" << joint_motion_p->mRotationCurve.mNumKeys << " rotation keys at "
             << joint_motion_p->mRotationCurve.mNumKeys * sizeof(RotationKey) << " bytes" << LL_ENDL;
 
             total_size += joint_motion_p->mRotationCurve.mNumKeys * sizeof(RotationKey);
         }
-        if (joint_motion_p->mUsage & LLJointState::POS)
+        if ((joint_motion_p->mUsage & LLJointState::POS) && !hasPackedKeys())
         {
             LL_INFOS() << "\t" << joint_motion_p->mPositionCurve.mNumKeys << " position keys at "
             << joint_motion_p->mPositionCurve.mNumKeys * sizeof(PositionKey) << " bytes" << LL_ENDL;
@@ -116,6 +369,12 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
             total_size += joint_motion_p->mPositionCurve.mNumKeys * sizeof(PositionKey);
         }
     }
+    if (hasPackedKeys())
+    {
+        LL_INFOS() << mPackedKeys.size() / 4 << " packed keys at " << mPackedKeys.size() * sizeof(U16) << " bytes" << LL_ENDL;
+
+        total_size += mPackedKeys.size() * sizeof(U16) + mPackedRotations.size() * 2 * sizeof(PackedCurve);
+    }
     LL_INFOS() << "Size: " << total_size << " bytes" << LL_ENDL;
 
     return total_size;
@@ -281,6 +540,7 @@ LLMotion::LLMotionInitStatus LLKeyframeMotion::onInitialize(LLCharacter *charact
     {
         // motion already existed in cache, so grab it
         mJointMotionList = joint_motion_list;
+        mKeyCursors.clear();
 
         mJointStates.reserve(mJointMotionList->getNumJointMotions());
 
@@ -485,11 +745,18 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
     llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
-    for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
+    if (mJointMotionList->hasPackedKeys())
     {
-        mJointMotionList->getJointMotion(i)->update(mJointStates[i],
-                                                      time,
-                                                      mJointMotionList->mDuration );
+        applyPackedKeyframes(time);
+    }
+    else
+    {
+        for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
+        {
+            mJointMotionList->getJointMotion(i)->update(mJointStates[i],
+                                                          time,
+                                                          mJointMotionList->mDuration );
+        }
     }
 
     LLJoint::JointPriority* pose_priority = (LLJoint::JointPriority* )mCharacter->getAnimationData("Hand Pose Priority");
@@ -508,6 +775,84 @@ void LLKeyframeMotion::applyKeyframes(F32 time)
     }
 }
 
+//-----------------------------------------------------------------------------
+// applyPackedKeyframes()
+// JointMotion::update() for every joint motion at once, sampling the packed
+// keys from where the previous call left off.
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::applyPackedKeyframes(F32 time)
+{
+    const U32 num_motions = mJointMotionList->getNumJointMotions();
+    const F32 duration = mJointMotionList->mDuration;
+    const U16* keys = mJointMotionList->mPackedKeys.data();
+
+    if (mKeyCursors.size() != num_motions * 2)
+    {
+        mKeyCursors.assign(num_motions * 2, KeyCursor());
+    }
+
+    const KeyRange rot_range = make_key_range(duration, -1.f, 1.f, true);
+    const KeyRange pos_range = make_key_range(duration, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET, false);
+    const U32 quantized_time = quantize_time(time, duration);
+
+    for (U32 i = 0; i < num_motions; i++)
+    {
+        LLJointState* joint_state = mJointStates[i];
+        if (!joint_state)
+        {
+            continue;
+        }
+
+        JointMotion* joint_motion = mJointMotionList->getJointMotion(i);
+        U32 usage = joint_state->getUsage();
+
+        if ((usage & LLJointState::SCALE) && joint_motion->mScaleCurve.mNumKeys)
+        {
+            joint_state->setScale(joint_motion->mScaleCurve.getValue(time, duration));
+        }
+
+        const PackedCurve& rotations = mJointMotionList->mPackedRotations[i];
+        if ((usage & LLJointState::ROT) && rotations.mNumKeys)
+        {
+            KeyCursor& cursor = mKeyCursors[i * 2];
+            bool between = seek_cursor(keys + rotations.mFirstKey * 4, rotations.mNumKeys, cursor, time, quantized_time,
+                                       rot_range);
+            RotationKey after;
+            memcpy(after.mValue.mQ, cursor.mAfter, sizeof(after.mValue.mQ));
+            if (between)
+            {
+                RotationKey before;
+                memcpy(before.mValue.mQ, cursor.mBefore, sizeof(before.mValue.mQ));
+                F32 u = (time - cursor.mBeforeTime) / (cursor.mAfterTime - cursor.mBeforeTime);
+                joint_state->setRotation(joint_motion->mRotationCurve.interp(u, before, after));
+            }
+            else
+            {
+                joint_state->setRotation(after.mValue);
+            }
+        }
+
+        const PackedCurve& positions = mJointMotionList->mPackedPositions[i];
+        if ((usage & LLJointState::POS) && positions.mNumKeys)
+        {
+            KeyCursor& cursor = mKeyCursors[i * 2 + 1];
+            bool between = seek_cursor(keys + positions.mFirstKey * 4, positions.mNumKeys, cursor, time, quantized_time,
+                                       pos_range);
+            PositionKey after(0.f, LLVector3(cursor.mAfter));
+            if (between)
+            {
+                PositionKey before(0.f, LLVector3(cursor.mBefore));
+                F32 u = (time - cursor.mBeforeTime) / (cursor.mAfterTime - cursor.mBeforeTime);
+                joint_state->setPosition(joint_motion->mPositionCurve.interp(u, before, after));
+            }
+            else
+            {
+                joint_state->setPosition(after.mValue);
+            }
+        }
+    }
+}
+
 //-----------------------------------------------------------------------------
 // applyConstraints()
 //-----------------------------------------------------------------------------
@@ -515,6 +860,19 @@ void LLKeyframeMotion::applyConstraints(F32 time, U8* joint_mask)
 {
     //TODO: investigate replacing spring simulation with critically damped motion
 
+    // not worth solving for characters at a low animation LOD
+    if (mCharacter->getMotionController().skipSecondaryMotions())
+    {
+        for (JointConstraint* constraintp : mConstraints)
+        {
+            if (constraintp->mActive)
+            {
+                deactivateConstraint(constraintp);
+            }
+        }
+        return;
+    }
+
     // re-init constraints if skeleton has changed
     if (mCharacter->getSkeletonSerialNum() != mLastSkeletonSerialNum)
     {
@@ -1175,6 +1533,14 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
     mJointStates.clear();
     mJointStates.reserve(num_motions);
 
+    // keys of the current format are only kept packed, as they were read
+    std::vector<QuantizedKey> quantized_keys;
+    if (!old_version)
+    {
+        joint_motion_list->mPackedRotations.resize(num_motions);
+        joint_motion_list->mPackedPositions.resize(num_motions);
+    }
+
     //-------------------------------------------------------------------------
     // initialize joint motions
     //-------------------------------------------------------------------------
@@ -1285,7 +1651,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
         for (S32 k = 0; k < joint_motion->mRotationCurve.mNumKeys; k++)
         {
             F32 time;
-            U16 time_short;
+            U16 time_short = 0;
 
             if (old_version)
             {
@@ -1320,7 +1686,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
             RotationKey rot_key;
             rot_key.mTime = time;
             LLVector3 rot_angles;
-            U16 x, y, z;
+            U16 x = 0, y = 0, z = 0;
 
             if (old_version)
             {
@@ -1376,10 +1742,24 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
                 return FALSE;
             }
 
-            rCurve->mKeys[time] = rot_key;
+            if (old_version)
+            {
+                rCurve->mKeys[time] = rot_key;
+            }
+            else
+            {
+                quantized_keys.push_back({ time, { time_short, x, y, z } });
+            }
+        }
+
+        S32 num_rot_keys = rCurve->mKeys.size();
+        if (!old_version)
+        {
+            joint_motion_list->mPackedRotations[i] = pack_keys(quantized_keys, joint_motion_list->mPackedKeys);
+            num_rot_keys = joint_motion_list->mPackedRotations[i].mNumKeys;
         }
 
-        if (joint_motion->mRotationCurve.mNumKeys > joint_motion->mRotationCurve.mKeys.size())
+        if (joint_motion->mRotationCurve.mNumKeys > num_rot_keys)
         {
             rotation_dupplicates++;
             LL_INFOS() << "Motion: " << asset_id << " had dupplicate rotation keys that were removed" << LL_ENDL;
@@ -1408,7 +1788,8 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
         BOOL is_pelvis = joint_motion->mJointName == "mPelvis";
         for (S32 k = 0; k < joint_motion->mPositionCurve.mNumKeys; k++)
         {
-            U16 time_short;
+            U16 time_short = 0;
+            U16 x = 0, y = 0, z = 0;
             PositionKey pos_key;
 
             if (old_version)
@@ -1449,8 +1830,6 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
             }
             else
             {
-                U16 x, y, z;
-
                 if (!dp.unpackU16(x, "pos_x"))
                 {
                     LL_WARNS() << "can't read pos_x in position key (" << k << ")" << LL_ENDL;
@@ -1479,7 +1858,14 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
                 return FALSE;
             }
 
-            pCurve->mKeys[pos_key.mTime] = pos_key;
+            if (old_version)
+            {
+                pCurve->mKeys[pos_key.mTime] = pos_key;
+            }
+            else
+            {
+                quantized_keys.push_back({ pos_key.mTime, { time_short, x, y, z } });
+            }
 
             if (is_pelvis)
             {
@@ -1487,7 +1873,14 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
             }
         }
 
-        if (joint_motion->mPositionCurve.mNumKeys > joint_motion->mPositionCurve.mKeys.size())
+        S32 num_pos_keys = pCurve->mKeys.size();
+        if (!old_version)
+        {
+            joint_motion_list->mPackedPositions[i] = pack_keys(quantized_keys, joint_motion_list->mPackedKeys);
+            num_pos_keys = joint_motion_list->mPackedPositions[i].mNumKeys;
+        }
+
+        if (joint_motion->mPositionCurve.mNumKeys > num_pos_keys)
         {
             position_dupplicates++;
         }
@@ -1736,6 +2129,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
 
     // *FIX: support cleanup of old keyframe data
     mJointMotionList = joint_motion_list.release();
+    mKeyCursors.clear();
     LLKeyframeDataCache::addKeyframeData(getID(),  mJointMotionList);
     mAssetStatus = ASSET_LOADED;
 
@@ -1784,6 +2178,19 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
         JointMotion* joint_motionp = mJointMotionList->getJointMotion(i);
         success &= dp.packString(joint_motionp->mJointName, "joint_name");
         success &= dp.packS32(joint_motionp->mPriority, "joint_priority");
+
+        if (mJointMotionList->hasPackedKeys())
+        {
+            // the keys as they were read, nothing to quantize again
+            const PackedCurve& rotations = mJointMotionList->mPackedRotations[i];
+            success &= dp.packS32(rotations.mNumKeys, "num_rot_keys");
+            success &= pack_packed_keys(dp, mJointMotionList->mPackedKeys, rotations, ROTATION_KEY_NAMES);
+            const PackedCurve& positions = mJointMotionList->mPackedPositions[i];
+            success &= dp.packS32(positions.mNumKeys, "num_pos_keys");
+            success &= pack_packed_keys(dp, mJointMotionList->mPackedKeys, positions, POSITION_KEY_NAMES);
+            continue;
+        }
+
         success &= dp.packS32(joint_motionp->mRotationCurve.mKeys.size(), "num_rot_keys");
 
         LL_DEBUGS("BVH") << "Joint " << i
@@ -280,6 +280,8 @@ class LLKeyframeMotion :
 
     void applyKeyframes(F32 time);
 
+    void applyPackedKeyframes(F32 time);
+
     void applyConstraints(F32 time, U8* joint_mask);
 
     void activateConstraint(JointConstraint* constraintp);
@@ -376,6 +378,33 @@ class LLKeyframeMotion :
     typedef Curve<LLVector3> PositionCurve;
     typedef PositionCurve::Key PositionKey;
 
+    //-------------------------------------------------------------------------
+    // PackedCurve
+    // A rotation or position curve kept the way the asset stores it: four
+    // U16s (time, x, y, z) per key, in time order, in the shared
+    // JointMotionList::mPackedKeys array. For assets in the current format
+    // this is the only copy of the keys; the curve's mKeys stays empty until
+    // JointMotionList::unpackKeys() decodes them into it.
+    //-------------------------------------------------------------------------
+    struct PackedCurve
+    {
+        U32 mFirstKey = 0;
+        U32 mNumKeys = 0;
+    };
+
+    // Where a motion last sampled a packed curve: the first key at or after
+    // that time, and the keys either side of it already decoded, so that
+    // playing forward only decodes each key once.
+    struct KeyCursor
+    {
+        F32 mBefore[4];
+        F32 mAfter[4];
+        F32 mBeforeTime = 0.f;
+        F32 mAfterTime = 0.f;
+        U32 mKey = 0;
+        bool mValid = false;
+    };
+
     //-------------------------------------------------------------------------
     // JointMotion
     //-------------------------------------------------------------------------
@@ -415,12 +444,22 @@ class LLKeyframeMotion :
         // TODO: LLKeyframeDataCache::getKeyframeData should probably return a class containing
         // JointMotionList and mEmoteName, see LLKeyframeMotion::onInitialize.
         std::string             mEmoteName;
+        // Quantized keys of every rotation and position curve, and where
+        // each joint motion's curves start in them. Only assets in the
+        // current format are packed; anything else keeps its keys in mKeys.
+        std::vector<U16>        mPackedKeys;
+        std::vector<PackedCurve> mPackedRotations;
+        std::vector<PackedCurve> mPackedPositions;
     public:
         JointMotionList();
         ~JointMotionList();
         U32 dumpDiagInfo();
         JointMotion* getJointMotion(U32 index) const { llassert(index < mJointMotionArray.size()); return mJointMotionArray[index]; }
         U32 getNumJointMotions() const { return mJointMotionArray.size(); }
+        bool hasPackedKeys() const { return !mPackedRotations.empty(); }
+        // Decodes the packed keys into the curves' mKeys and drops them, so
+        // that edits to mKeys are what gets played back and saved.
+        void unpackKeys();
     };
 
 protected:
@@ -434,13 +473,15 @@ class LLKeyframeMotion :
     F32                             mLastUpdateTime;
     F32                             mLastLoopedTime;
     AssetStatus                     mAssetStatus;
+    // per joint motion, the rotation then the position curve's cursor
+    std::vector<KeyCursor>          mKeyCursors;
 
 public:
     void setCharacter(LLCharacter* character) { mCharacter = character; }
 
     //BD - Poser
     JointMotionList* getJointMotionList() const { return mJointMotionList; }
-    void setJointMotionList(JointMotionList* list) { mJointMotionList = list; }
+    void setJointMotionList(JointMotionList* list) { mJointMotionList = list; mKeyCursors.clear(); }
 };
 
 class LLKeyframeDataCache
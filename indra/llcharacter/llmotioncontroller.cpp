@@ -121,15 +121,19 @@ LLMotionController::LLMotionController()
     : mTimeFactor(sCurrentTimeFactor),
       mCharacter(NULL),
       mAnimTime(0.f),
+      mClockTime(0.f),
       mPrevTimerElapsed(0.f),
       mLastTime(0.0f),
       mHasRunOnce(FALSE),
       mPaused(FALSE),
       mPausedFrame(0),
       mTimeStep(0.f),
+      mTimeStepPhase(0.f),
       mTimeStepCount(0),
       mLastInterp(0.f),
+      mAnimationLOD(ANIMATION_LOD_FULL),
       mIsSelf(FALSE),
+      mEvaluating(false),
       mLastCountAfterPurge(0)
 {
 }
@@ -171,6 +175,12 @@ void LLMotionController::deleteAllMotions()
     // up the mDeprecatedMotions list as well.
     std::for_each(mDeprecatedMotions.begin(), mDeprecatedMotions.end(), DeletePointer());
     mDeprecatedMotions.clear();
+
+    // deprecated motions evaluateMotions() took off mDeprecatedMotions but
+    // finishMotions() never got to
+    std::for_each(mDeferredRemovals.begin(), mDeferredRemovals.end(), DeletePointer());
+    mDeferredRemovals.clear();
+    mDeferredStopRequests.clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -257,25 +267,27 @@ void LLMotionController::deactivateStoppedMotions()
 //-----------------------------------------------------------------------------
 // setTimeStep()
 //-----------------------------------------------------------------------------
-void LLMotionController::setTimeStep(F32 step)
+void LLMotionController::setTimeStep(F32 step, F32 phase)
 {
-    mTimeStep = step;
+    if (step == mTimeStep && phase == mTimeStepPhase)
+    {
+        return;
+    }
 
-    if (step != 0.f)
+    // Settle on the pose cached for the current quantum, so that the blenders
+    // start the new step empty. Motion timestamps are left alone: snapping
+    // them to the quantum overflowed on the F32_MAX stop timestamps of
+    // looping motions.
+    if (mTimeStep != 0.f)
     {
-        // make sure timestamps conform to new quantum
-        for (motion_list_t::iterator iter = mActiveMotions.begin();
-             iter != mActiveMotions.end(); ++iter)
-        {
-            LLMotion* motionp = *iter;
-            F32 activation_time = motionp->mActivationTimestamp;
-            motionp->mActivationTimestamp = (F32)(llfloor(activation_time / step)) * step;
-            BOOL stopped = motionp->isStopped();
-            motionp->setStopTime((F32)(llfloor(motionp->getStopTime() / step)) * step);
-            motionp->setStopped(stopped);
-            motionp->mSendStopTimestamp = (F32)llfloor(motionp->mSendStopTimestamp / step) * step;
-        }
+        mPoseBlender.interpolate(1.f);
+        clearBlenders();
     }
+
+    mTimeStep = step;
+    mTimeStepPhase = phase;
+    mTimeStepCount = 0;
+    mLastInterp = 0.f;
 }
 
 //-----------------------------------------------------------------------------
@@ -517,7 +529,7 @@ void LLMotionController::updateIdleMotion(LLMotion* motionp)
         // this will only be called when an animation stops itself (runs out of time)
         if (mLastTime <= motionp->mSendStopTimestamp)
         {
-            mCharacter->requestStopMotion( motionp );
+            requestStopMotion( motionp );
             stopMotionInstance(motionp, FALSE);
         }
     }
@@ -546,6 +558,24 @@ void LLMotionController::updateIdleActiveMotions()
     }
 }
 
+//-----------------------------------------------------------------------------
+// updateIdleMotionsByType()
+// Keeps motions of one type timing out without evaluating them
+//-----------------------------------------------------------------------------
+void LLMotionController::updateIdleMotionsByType(LLMotion::LLMotionBlendType anim_type)
+{
+    for (motion_list_t::iterator iter = mActiveMotions.begin();
+         iter != mActiveMotions.end(); )
+    {
+        motion_list_t::iterator curiter = iter++;
+        LLMotion* motionp = *curiter;
+        if (motionp->getBlendType() == anim_type)
+        {
+            updateIdleMotion(motionp);
+        }
+    }
+}
+
 //-----------------------------------------------------------------------------
 // updateMotionsByType()
 //-----------------------------------------------------------------------------
@@ -619,7 +649,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
                 // this will only be called when an animation stops itself (runs out of time)
                 if (mLastTime <= motionp->mSendStopTimestamp)
                 {
-                    mCharacter->requestStopMotion( motionp );
+                    requestStopMotion( motionp );
                     stopMotionInstance(motionp, FALSE);
                 }
             }
@@ -700,7 +730,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
                 // this will only be called when an animation stops itself (runs out of time)
                 if (mLastTime <= motionp->mSendStopTimestamp)
                 {
-                    mCharacter->requestStopMotion( motionp );
+                    requestStopMotion( motionp );
                     stopMotionInstance(motionp, FALSE);
                 }
             }
@@ -746,7 +776,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
                 // animation has stopped itself due to internal logic
                 // propagate this to the network
                 // as not all viewers are guaranteed to have access to the same logic
-                mCharacter->requestStopMotion( motionp );
+                requestStopMotion( motionp );
                 stopMotionInstance(motionp, FALSE);
             }
 
@@ -811,10 +841,20 @@ void LLMotionController::updateLoadingMotions()
 void LLMotionController::updateMotions(bool force_update)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
-    // SL-763: "Distant animated objects run at super fast speed"
-    // The use_quantum optimization or possibly the associated code in setTimeStamp()
-    // does not work as implemented.
-    // Currently setting mTimeStep to nonzero is disabled elsewhere.
+    if (prepareMotions())
+    {
+        evaluateMotions(force_update);
+    }
+    finishMotions();
+//  LL_INFOS() << "Motion controller time " << motionTimer.getElapsedTimeF32() << LL_ENDL;
+}
+
+//-----------------------------------------------------------------------------
+// prepareMotions()
+//-----------------------------------------------------------------------------
+bool LLMotionController::prepareMotions()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
     BOOL use_quantum = (mTimeStep != 0.f);
 
     // Always update mPrevTimerElapsed
@@ -829,26 +869,32 @@ void LLMotionController::updateMotions(bool force_update)
     // Update timing info for this time step.
     if (!mPaused)
     {
-        F32 update_time = mAnimTime + delta_time * mTimeFactor;
+        // SL-763: "Distant animated objects run at super fast speed"
+        // Advance the unquantized clock, not mAnimTime: that runs up to a
+        // step ahead, and adding to it moved on a whole quantum every frame.
+        F32 update_time = mClockTime + delta_time * mTimeFactor;
+        mClockTime = update_time;
         if (use_quantum)
         {
-            F32 time_interval = fmodf(update_time, mTimeStep);
+            F32 phased_time = update_time + mTimeStepPhase;
+            F32 time_interval = fmodf(phased_time, mTimeStep);
 
             // always animate *ahead* of actual time
-            S32 quantum_count = llmax(0, llfloor((update_time - time_interval) / mTimeStep)) + 1;
+            S32 quantum_count = llmax(0, llfloor((phased_time - time_interval) / mTimeStep)) + 1;
             if (quantum_count == mTimeStepCount)
             {
                 // we're still in same time quantum as before, so just interpolate and exit
-                if (!mPaused)
+                // the joints are already mLastInterp of the way to the cached pose
+                F32 interp = llclamp(time_interval / mTimeStep, mLastInterp, 1.f);
+                if (interp > mLastInterp)
                 {
-                    F32 interp = time_interval / mTimeStep;
-                    mPoseBlender.interpolate(interp - mLastInterp);
+                    mPoseBlender.interpolate((interp - mLastInterp) / (1.f - mLastInterp));
                     mLastInterp = interp;
                 }
 
                 updateLoadingMotions();
 
-                return;
+                return false;
             }
 
             // is calculating a new keyframe pose, make sure the last one gets applied
@@ -856,7 +902,7 @@ void LLMotionController::updateMotions(bool force_update)
             clearBlenders();
 
             mTimeStepCount = quantum_count;
-            mAnimTime = (F32)quantum_count * mTimeStep;
+            mAnimTime = (F32)quantum_count * mTimeStep - mTimeStepPhase;
             mLastInterp = 0.f;
         }
         else
@@ -868,6 +914,17 @@ void LLMotionController::updateMotions(bool force_update)
 
     updateLoadingMotions();
 
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// evaluateMotions()
+//-----------------------------------------------------------------------------
+void LLMotionController::evaluateMotions(bool force_update)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    mEvaluating = true;
+
     resetJointSignatures();
 
     if (mPaused && !force_update)
@@ -877,14 +934,21 @@ void LLMotionController::updateMotions(bool force_update)
     else
     {
         // update additive motions
-        updateAdditiveMotions();
+        if (skipSecondaryMotions())
+        {
+            updateIdleMotionsByType(LLMotion::ADDITIVE_BLEND);
+        }
+        else
+        {
+            updateAdditiveMotions();
+        }
 
         resetJointSignatures();
 
         // update all regular motions
         updateRegularMotions();
 
-        if (use_quantum)
+        if (mTimeStep != 0.f)
         {
             mPoseBlender.blendAndCache(TRUE);
         }
@@ -895,7 +959,41 @@ void LLMotionController::updateMotions(bool force_update)
     }
 
     mHasRunOnce = TRUE;
-//  LL_INFOS() << "Motion controller time " << motionTimer.getElapsedTimeF32() << LL_ENDL;
+    mEvaluating = false;
+}
+
+//-----------------------------------------------------------------------------
+// finishMotions()
+//-----------------------------------------------------------------------------
+void LLMotionController::finishMotions()
+{
+    // stop requests first, the motions they name may be about to go
+    for (LLMotion* motionp : mDeferredStopRequests)
+    {
+        mCharacter->requestStopMotion(motionp);
+    }
+    mDeferredStopRequests.clear();
+
+    for (LLMotion* motionp : mDeferredRemovals)
+    {
+        removeMotionInstance(motionp);
+    }
+    mDeferredRemovals.clear();
+}
+
+//-----------------------------------------------------------------------------
+// requestStopMotion()
+//-----------------------------------------------------------------------------
+void LLMotionController::requestStopMotion(LLMotion* motionp)
+{
+    if (mEvaluating)
+    {
+        mDeferredStopRequests.push_back(motionp);
+    }
+    else
+    {
+        mCharacter->requestStopMotion(motionp);
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -993,7 +1091,16 @@ BOOL LLMotionController::deactivateMotionInstance(LLMotion *motion)
     if (found_it != mDeprecatedMotions.end())
     {
         // deprecated motions need to be completely excised
-        removeMotionInstance(motion);
+        if (mEvaluating)
+        {
+            // but not from a worker thread, see finishMotions()
+            mActiveMotions.remove(motion);
+            mDeferredRemovals.push_back(motion);
+        }
+        else
+        {
+            removeMotionInstance(motion);
+        }
         mDeprecatedMotions.erase(found_it);
     }
     else
@@ -33,6 +33,7 @@
 #include <string>
 #include <map>
 #include <deque>
+#include <vector>
 
 #include "llmotion.h"
 #include "llpose.h"
@@ -136,6 +137,20 @@ class LLMotionController
     // deactivates terminated motions`
     void updateMotions(bool force_update = false);
 
+    // updateMotions() in three steps, so that many characters can be
+    // animated on worker threads at once:
+    // prepareMotions() advances the clock and finishes loading motions. It
+    // may create motions and reach outside this character, so call it on
+    // the main thread. It returns false if there is nothing to evaluate.
+    // evaluateMotions() runs the active motions and blends the pose into
+    // the joints. It may run on any thread, so long as nothing else touches
+    // this character meanwhile: anything that would leave the character
+    // (stop requests, deleting deprecated motions) is held back for...
+    // finishMotions(), back on the main thread.
+    bool prepareMotions();
+    void evaluateMotions(bool force_update = false);
+    void finishMotions();
+
     // minimal update (e.g. while hidden)
     void updateMotionsMinimal();
 
@@ -154,9 +169,28 @@ class LLMotionController
     BOOL isPaused() const { return mPaused; }
     S32 getPausedFrame() const { return mPausedFrame; }
 
-    void setTimeStep(F32 step);
+    // Evaluate motions only once per step seconds of animation time, a step
+    // ahead, and interpolate the pose towards the result in between. Phase
+    // offsets the step boundaries so that characters sharing a step are not
+    // all evaluated on the same frame. Zero evaluates every update.
+    void setTimeStep(F32 step, F32 phase = 0.f);
     F32 getTimeStep() const { return mTimeStep; }
 
+    // Animation level of detail, picked by the character from its size on
+    // screen. The time step goes with it; from ANIMATION_LOD_LOW on,
+    // additive motions and keyframe constraints are skipped as well.
+    enum EAnimationLOD
+    {
+        ANIMATION_LOD_FULL = 0,
+        ANIMATION_LOD_REDUCED,
+        ANIMATION_LOD_LOW,
+        ANIMATION_LOD_IMPOSTOR,
+        ANIMATION_LOD_COUNT
+    };
+    void setAnimationLOD(EAnimationLOD lod) { mAnimationLOD = lod; }
+    EAnimationLOD getAnimationLOD() const { return mAnimationLOD; }
+    bool skipSecondaryMotions() const { return mAnimationLOD >= ANIMATION_LOD_LOW; }
+
     void setTimeFactor(F32 time_factor);
     F32 getTimeFactor() const { return mTimeFactor; }
 
@@ -174,6 +208,9 @@ class LLMotionController
     void dumpMotions();
 
     const LLFrameTimer& getFrameTimer() { return mTimer; }
+    // Sets how long the controller's clock has been running, so that tests
+    // can step time exactly instead of sleeping between updates
+    void setElapsedTime(F64 seconds) { mTimer.setAge(seconds); }
 
     static F32  getCurrentTimeFactor()              { return sCurrentTimeFactor;    };
     static void setCurrentTimeFactor(F32 factor)    { sCurrentTimeFactor = factor;  };
@@ -189,12 +226,14 @@ class LLMotionController
     void removeMotionInstance(LLMotion* motion);
     void updateRegularMotions();
     void updateAdditiveMotions();
+    void updateIdleMotionsByType(LLMotion::LLMotionBlendType motion_type);
     void resetJointSignatures();
     void updateMotionsByType(LLMotion::LLMotionBlendType motion_type);
     void updateIdleMotion(LLMotion* motionp);
     void updateIdleActiveMotions();
     void purgeExcessMotions();
     void deactivateStoppedMotions();
+    void requestStopMotion(LLMotion* motion);
 
 protected:
     F32                 mTimeFactor;            // 1.f for normal speed
@@ -223,15 +262,23 @@ class LLMotionController
     LLFrameTimer        mTimer;
     F32                 mPrevTimerElapsed;
     F32                 mAnimTime;
+    F32                 mClockTime;             // mAnimTime before quantizing to mTimeStep
     F32                 mLastTime;
     BOOL                mHasRunOnce;
     BOOL                mPaused;
     S32                 mPausedFrame;
     F32                 mTimeStep;
+    F32                 mTimeStepPhase;
     S32                 mTimeStepCount;
     F32                 mLastInterp;
+    EAnimationLOD       mAnimationLOD;
 
     U8                  mJointSignature[2][LL_CHARACTER_MAX_ANIMATED_JOINTS];
+
+    // held back by evaluateMotions() for finishMotions()
+    bool                mEvaluating;
+    std::vector<LLMotion*> mDeferredStopRequests;
+    std::vector<LLMotion*> mDeferredRemovals;
 private:
     U32                 mLastCountAfterPurge; //for logging and debugging purposes
 };
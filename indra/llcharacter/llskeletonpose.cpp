@@ -0,0 +1,270 @@
+/**
+ * @file llskeletonpose.cpp
+ * @brief Implementation of LLSkeletonPose class.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+//-----------------------------------------------------------------------------
+// Header Files
+//-----------------------------------------------------------------------------
+#include "linden_common.h"
+
+#include "llskeletonpose.h"
+
+#include "lljoint.h"
+
+namespace
+{
+    // mState bits, rebuilt by every update()
+    enum
+    {
+        // local transform loaded, world transform computed this pass
+        POSE_DIRTY = 0x1,
+        // this joint or an ancestor has mUpdateXform off
+        POSE_SKIPPED = 0x2,
+        // clean, world transform loaded from the joint this pass
+        POSE_LOADED = 0x4,
+        // the joint's xform scales its children's offsets
+        POSE_SCALES_CHILDREN = 0x8
+    };
+
+    // LLVector4a::setRotated(), inlined for the hot loop
+    inline void rotate_vector(LLVector4a& out, const LLQuaternion2& rot, const LLVector4a& vec)
+    {
+        const LLVector4a& q = rot.getVector4a();
+        LLVector4a temp;
+        temp.setCross3(q, vec);
+        temp.add(temp);
+        LLVector4a real;
+        real.splat<3>(q);
+        out.setMul(temp, real);
+        out.add(vec);
+        LLVector4a cross;
+        cross.setCross3(q, temp);
+        out.add(cross);
+    }
+
+    // Same result as LLMatrix4::initAll(scale, rot, pos): the rows are the
+    // rotated axes times the scale, then the position.
+    inline void build_world_matrix(LLMatrix4a& mat, const LLVector4a& scale,
+                                   const LLQuaternion2& rot, const LLVector4a& pos)
+    {
+        static LL_ALIGN_16(const U32 signX[4]) = { 0x80000000, 0x0, 0x0, 0x0 };
+        static LL_ALIGN_16(const U32 signY[4]) = { 0x0, 0x80000000, 0x0, 0x0 };
+        static LL_ALIGN_16(const U32 signZ[4]) = { 0x0, 0x0, 0x80000000, 0x0 };
+        static LL_ALIGN_16(const U32 signXZ[4]) = { 0x80000000, 0x0, 0x80000000, 0x0 };
+        static LL_ALIGN_16(const U32 signXY[4]) = { 0x80000000, 0x80000000, 0x0, 0x0 };
+        static LL_ALIGN_16(const U32 signYZ[4]) = { 0x0, 0x80000000, 0x80000000, 0x0 };
+        static LL_ALIGN_16(const U32 maskXYZ[4]) = { 0xffffffff, 0xffffffff, 0xffffffff, 0x0 };
+        static LL_ALIGN_16(const F32 axisX[4]) = { 1.f, 0.f, 0.f, 0.f };
+        static LL_ALIGN_16(const F32 axisY[4]) = { 0.f, 1.f, 0.f, 0.f };
+        static LL_ALIGN_16(const F32 axisZ[4]) = { 0.f, 0.f, 1.f, 0.f };
+        static LL_ALIGN_16(const F32 axisW[4]) = { 0.f, 0.f, 0.f, 1.f };
+
+        const LLQuad q = rot.getVector4a();
+        const LLQuad q2 = _mm_add_ps(q, q);
+        const LLQuad xyz = _mm_load_ps((const F32*)maskXYZ);
+
+        //          [VX]         [VY]         [VZ]
+        // row0: 1 -(yy2+zz2)    xy2+zw2      xz2-yw2
+        // row1:    xy2-zw2   1 -(xx2+zz2)    yz2+xw2
+        // row2:    xz2+yw2      yz2-xw2   1 -(xx2+yy2)
+        LLQuad a = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 0, 0, 1)),
+                              _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3, 2, 1, 1)));
+        LLQuad b = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 1, 2, 2)),
+                              _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3, 3, 3, 2)));
+        LLQuad row0 = _mm_add_ps(_mm_xor_ps(a, _mm_load_ps((const F32*)signX)),
+                                 _mm_xor_ps(b, _mm_load_ps((const F32*)signXZ)));
+
+        a = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 1, 0, 0)),
+                       _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3, 2, 0, 1)));
+        b = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 0, 2, 2)),
+                       _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3, 3, 2, 3)));
+        LLQuad row1 = _mm_add_ps(_mm_xor_ps(a, _mm_load_ps((const F32*)signY)),
+                                 _mm_xor_ps(b, _mm_load_ps((const F32*)signXY)));
+
+        a = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 0, 1, 0)),
+                       _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3, 0, 2, 2)));
+        b = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 1, 0, 1)),
+                       _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3, 1, 3, 3)));
+        LLQuad row2 = _mm_add_ps(_mm_xor_ps(a, _mm_load_ps((const F32*)signZ)),
+                                 _mm_xor_ps(b, _mm_load_ps((const F32*)signYZ)));
+
+        const LLQuad s = scale;
+        row0 = _mm_mul_ps(_mm_and_ps(_mm_add_ps(row0, _mm_load_ps(axisX)), xyz),
+                          _mm_shuffle_ps(s, s, _MM_SHUFFLE(0, 0, 0, 0)));
+        row1 = _mm_mul_ps(_mm_and_ps(_mm_add_ps(row1, _mm_load_ps(axisY)), xyz),
+                          _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+        row2 = _mm_mul_ps(_mm_and_ps(_mm_add_ps(row2, _mm_load_ps(axisZ)), xyz),
+                          _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 2, 2, 2)));
+        const LLQuad row3 = _mm_or_ps(_mm_and_ps(pos, xyz), _mm_load_ps(axisW));
+
+        mat.mMatrix[0] = row0;
+        mat.mMatrix[1] = row1;
+        mat.mMatrix[2] = row2;
+        mat.mMatrix[3] = row3;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// LLSkeletonPose()
+//-----------------------------------------------------------------------------
+LLSkeletonPose::LLSkeletonPose(LLJoint* root) :
+    mRoot(root),
+    mLayoutDirty(false)
+{
+    rebuild();
+}
+
+//-----------------------------------------------------------------------------
+// rebuild()
+// Lays the joints under the root out depth first, as
+// updateWorldMatrixChildren() visits them.
+//-----------------------------------------------------------------------------
+void LLSkeletonPose::rebuild()
+{
+    mLayoutDirty.store(false, std::memory_order_relaxed);
+
+    mJoints.clear();
+    mParents.clear();
+
+    std::vector<std::pair<LLJoint*, S32> > stack;
+    stack.emplace_back(mRoot, -1);
+    while (!stack.empty())
+    {
+        LLJoint* joint = stack.back().first;
+        S32 parent = stack.back().second;
+        stack.pop_back();
+
+        S32 index = (S32)mJoints.size();
+        mJoints.push_back(joint);
+        mParents.push_back(parent);
+        // pushed in reverse so that children come out in order
+        for (auto it = joint->mChildren.rbegin(); it != joint->mChildren.rend(); ++it)
+        {
+            stack.emplace_back(*it, index);
+        }
+    }
+
+    const size_t count = mJoints.size();
+    mLocalPosition.resize(count);
+    mLocalRotation.resize(count);
+    mLocalScale.resize(count);
+    mWorldPosition.resize(count);
+    mWorldRotation.resize(count);
+    mWorldMatrix.resize(count);
+    mState.assign(count, 0);
+}
+
+//-----------------------------------------------------------------------------
+// loadWorld()
+// Takes a clean joint's current world transform, for its children's use.
+//-----------------------------------------------------------------------------
+void LLSkeletonPose::loadWorld(S32 index)
+{
+    LLXformMatrix& xform = mJoints[index]->mXform;
+    mWorldPosition[index].load3(xform.getWorldPosition().mV);
+    mWorldRotation[index].getVector4aRw().loadua(xform.getWorldRotation().mQ);
+    mLocalScale[index].load3(xform.getScale().mV);
+    mState[index] |= POSE_LOADED;
+}
+
+//-----------------------------------------------------------------------------
+// update()
+//-----------------------------------------------------------------------------
+void LLSkeletonPose::update()
+{
+    if (mLayoutDirty.load(std::memory_order_acquire))
+    {
+        rebuild();
+    }
+
+    if (!mRoot->mUpdateXform)
+    {
+        return;
+    }
+
+    // the root's xform parent may be outside the skeleton
+    mRoot->updateWorldMatrix();
+    mState[0] = mRoot->mXform.getScaleChildOffset() ? POSE_SCALES_CHILDREN : 0;
+
+    // One pass, parents first, as the recursion would visit them. Each
+    // dirty joint is read and written once; its parent's world transform
+    // comes from the arrays.
+    const S32 count = (S32)mJoints.size();
+    S32 updated = 0;
+    LLVector4a offset;
+    LLVector3 world_position;
+    LLQuaternion world_rotation;
+    for (S32 i = 1; i < count; ++i)
+    {
+        LLJoint* joint = mJoints[i];
+        const S32 parent = mParents[i];
+        if (!joint->mUpdateXform || (mState[parent] & POSE_SKIPPED))
+        {
+            mState[i] = POSE_SKIPPED;
+            continue;
+        }
+
+        LLXformMatrix& xform = joint->mXform;
+        U8 state = xform.getScaleChildOffset() ? POSE_SCALES_CHILDREN : 0;
+        if (!(joint->mDirtyFlags & LLJoint::MATRIX_DIRTY))
+        {
+            mState[i] = state;
+            continue;
+        }
+        mState[i] = state | POSE_DIRTY;
+
+        if (!(mState[parent] & (POSE_DIRTY | POSE_LOADED)))
+        {
+            loadWorld(parent);
+        }
+
+        mLocalPosition[i].load3(xform.getPosition().mV);
+        mLocalRotation[i].getVector4aRw().loadua(xform.getRotation().mQ);
+        mLocalScale[i].load3(xform.getScale().mV);
+
+        offset = mLocalPosition[i];
+        if (mState[parent] & POSE_SCALES_CHILDREN)
+        {
+            offset.mul(mLocalScale[parent]);
+        }
+        rotate_vector(mWorldPosition[i], mWorldRotation[parent], offset);
+        mWorldPosition[i].add(mWorldPosition[parent]);
+
+        mWorldRotation[i] = mLocalRotation[i];
+        mWorldRotation[i].mul(mWorldRotation[parent]);
+
+        build_world_matrix(mWorldMatrix[i], mLocalScale[i], mWorldRotation[i], mWorldPosition[i]);
+
+        // write back for everything that reads the joint
+        world_position.set(mWorldPosition[i].getF32ptr());
+        _mm_storeu_ps(world_rotation.mQ, mWorldRotation[i].getVector4a());
+        xform.setWorldTransform(world_position, world_rotation, mWorldMatrix[i]);
+        joint->mWorldMatrix = mWorldMatrix[i];
+        joint->mDirtyFlags = 0x0;
+        ++updated;
+    }
+
+    LLJoint::sNumUpdates.fetch_add(updated, std::memory_order_relaxed);
+}
@@ -0,0 +1,100 @@
+/**
+ * @file llskeletonpose.h
+ * @brief Flat, SIMD evaluated world transforms for a joint hierarchy.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSKELETONPOSE_H
+#define LL_LLSKELETONPOSE_H
+
+//-----------------------------------------------------------------------------
+// Header Files
+//-----------------------------------------------------------------------------
+#include <atomic>
+#include <vector>
+
+#include "llmath.h"
+#include "llmatrix4a.h"
+
+class LLJoint;
+
+//-----------------------------------------------------------------------------
+// class LLSkeletonPose
+//
+// The pose of a joint hierarchy as parallel arrays of local position,
+// rotation and scale and of world position, rotation and matrix, indexed by
+// joint in depth first order so that every parent precedes its children.
+//
+// update() replaces the recursive LLJoint::updateWorldMatrixChildren() of
+// the root it was built for: one flat pass over the dirty joints with
+// LLQuaternion2/LLMatrix4a math. Motions keep writing local transforms
+// through the joints, and the results are written back to each joint, so
+// LLJoint stays the view everything else reads.
+//
+// The root itself is evaluated the old way since its xform may be parented
+// to an object the avatar sits on. The layout is rebuilt on the next
+// update() after a joint under the root gains or loses a child.
+//-----------------------------------------------------------------------------
+class LLSkeletonPose
+{
+public:
+    LLSkeletonPose(LLJoint* root);
+
+    // Brings the world transforms of every dirty joint under the root up to
+    // date, exactly as root->updateWorldMatrixChildren() would.
+    void update();
+
+    // Called by LLJoint when the hierarchy under the root changes
+    void setLayoutDirty() { mLayoutDirty.store(true, std::memory_order_release); }
+    bool isLayoutDirty() const { return mLayoutDirty.load(std::memory_order_acquire); }
+
+    // joints in evaluation order, the root first
+    S32 getNumJoints() const { return (S32)mJoints.size(); }
+    LLJoint* getJoint(S32 index) const { return mJoints[index]; }
+
+    // valid for joints updated by the last update()
+    const LLMatrix4a& getWorldMatrix(S32 index) const { return mWorldMatrix[index]; }
+
+private:
+    void rebuild();
+    void loadWorld(S32 index);
+
+    LLJoint* mRoot;
+    std::atomic<bool> mLayoutDirty;
+
+    std::vector<LLJoint*> mJoints;
+    std::vector<S32> mParents;
+
+    std::vector<LLVector4a> mLocalPosition;
+    std::vector<LLQuaternion2> mLocalRotation;
+    std::vector<LLVector4a> mLocalScale;
+
+    std::vector<LLVector4a> mWorldPosition;
+    std::vector<LLQuaternion2> mWorldRotation;
+    std::vector<LLMatrix4a> mWorldMatrix;
+
+    // per update() pass, see llskeletonpose.cpp
+    std::vector<U8> mState;
+};
+
+#endif // LL_LLSKELETONPOSE_H
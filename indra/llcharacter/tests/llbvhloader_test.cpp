@@ -0,0 +1,383 @@
+/**
+ * @file   llbvhloader_test.cpp
+ * @brief  BVH parsing and parallel key reduction against the serial path,
+ *         and a benchmark over large BVH files.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "../llbvhloader.h"
+// STL headers
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+// std headers
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "jobsystem.h"
+#include "lldatapacker.h"
+#include "lltimer.h"
+#include "stringize.h"
+
+namespace
+{
+    class Sequence
+    {
+    public:
+        Sequence(U32 seed): mState(seed) {}
+        U32 next() { mState = mState * 1664525U + 1013904223U; return mState >> 8; }
+        F32 range(F32 low, F32 high) { return low + (high - low) * (F32)(next() & 0xffff) / 65535.f; }
+
+    private:
+        U32 mState;
+    };
+
+    // A hip with arms of chained joints, moving smoothly with some jitter,
+    // written out the way exporters format frame data.
+    std::string make_bvh(U32 seed, U32 arms, U32 arm_length, U32 frames)
+    {
+        Sequence sequence(seed);
+        std::ostringstream bvh;
+        bvh << "HIERARCHY\n"
+            << "ROOT hip\n{\n"
+            << "\tOFFSET 0.00 0.00 0.00\n"
+            << "\tCHANNELS 6 Xposition Yposition Zposition Zrotation Xrotation Yrotation\n";
+        for (U32 a = 0; a < arms; ++a)
+        {
+            for (U32 j = 0; j < arm_length; ++j)
+            {
+                bvh << "\tJOINT arm" << a << "_" << j << "\n\t{\n"
+                    << "\t\tOFFSET 0.00 4.00 0.00\n"
+                    << "\t\tCHANNELS 3 Zrotation Xrotation Yrotation\n";
+            }
+            bvh << "\t\tEnd Site\n\t\t{\n\t\t\tOFFSET 0.00 2.00 0.00\n\t\t}\n";
+            for (U32 j = 0; j < arm_length; ++j)
+            {
+                bvh << "\t}\n";
+            }
+        }
+        bvh << "}\nMOTION\n"
+            << "Frames: " << frames << "\n"
+            << "Frame Time: 0.033333\n";
+
+        const U32 joints = 1 + arms * arm_length;
+        std::vector<F32> phases;
+        for (U32 j = 0; j < joints * 3; ++j)
+        {
+            phases.push_back(sequence.range(0.f, F_TWO_PI));
+        }
+        char value[32];
+        for (U32 f = 0; f < frames; ++f)
+        {
+            F32 t = (F32)f / 30.f;
+            snprintf(value, sizeof(value), "%.6f %.6f %.6f", sinf(t) * 10.f, 40.f + cosf(t), t * 2.f);
+            bvh << value;
+            for (U32 c = 0; c < joints * 3; ++c)
+            {
+                // every fourth joint holds still, for the reduction to drop
+                F32 angle = ((c / 3) % 4 == 3) ? 5.f : 30.f * sinf(t * (1.f + (c % 5)) + phases[c]) + sequence.range(-0.5f, 0.5f);
+                snprintf(value, sizeof(value), " %.4f", angle);
+                bvh << value;
+            }
+            bvh << "\n";
+        }
+        return bvh.str();
+    }
+
+    // Large files to benchmark with, from the directory LL_BVH_CORPUS names,
+    // or else a synthetic spread of skeletons and lengths.
+    std::vector<std::string> load_corpus()
+    {
+        std::vector<std::string> corpus;
+        if (const char* dir = getenv("LL_BVH_CORPUS"))
+        {
+            for (const auto& entry : std::filesystem::directory_iterator(dir))
+            {
+                if (entry.path().extension() == ".bvh")
+                {
+                    std::ifstream file(entry.path(), std::ios::binary);
+                    corpus.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                }
+            }
+        }
+        if (corpus.empty())
+        {
+            for (U32 i = 0; i < 4; ++i)
+            {
+                corpus.push_back(make_bvh(i, 5 + i, 4 + i * 2, 1800 + 600 * i));
+            }
+        }
+        return corpus;
+    }
+
+    // what the constructor reports through, set up before it runs
+    struct LoaderResults
+    {
+        ELoadStatus mIgnoredStatus = E_ST_OK;
+        S32 mIgnoredLine = 0;
+        std::map<std::string, std::string> mNoAliases;
+    };
+
+    // The stages the constructor runs, without the translation table it
+    // reads from the app settings directory.
+    class TestLoader: private LoaderResults, public LLBVHLoader
+    {
+    public:
+        TestLoader(const parallel_for_t& parallel_for = parallel_for_t(),
+                   const progress_callback_t& progress = progress_callback_t()):
+            LLBVHLoader("", mIgnoredStatus, mIgnoredLine, mNoAliases, parallel_for, progress)
+        {
+        }
+
+        ELoadStatus parse(const std::string& bvh, bool alias_root = true)
+        {
+            makeTranslation("hip", "mPelvis");
+            // alias whatever the root is to the pelvis, as the viewer's
+            // joint aliases would
+            const char* p = strstr(bvh.c_str(), "ROOT");
+            char root[80]; /* Flawfinder: ignore */
+            if (alias_root && p && sscanf(p, "ROOT %79s", root) == 1) /* Flawfinder: ignore */
+            {
+                makeTranslation(root, "mPelvis");
+            }
+
+            char error_text[128]; /* Flawfinder: ignore */
+            S32 error_line = 0;
+            return loadBVHFile(bvh.c_str(), error_text, error_line);
+        }
+
+        void reduce()
+        {
+            applyTranslations();
+            optimize();
+        }
+
+        std::vector<U8> output()
+        {
+            std::vector<U8> buffer(getOutputSize());
+            LLDataPackerBinaryBuffer dp(buffer.data(), (S32)buffer.size());
+            serialize(dp);
+            return buffer;
+        }
+
+        const JointVector& getJoints() const { return mJoints; }
+    };
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llbvhloader_data
+    {
+        llbvhloader_data():
+            jobs("llbvhloader_test", 4)
+        {
+            jobs.start();
+            // the way the viewer borrows its "General" pool
+            parallel_for = LLBVHLoader::poolParallelFor("llbvhloader_test");
+        }
+
+        LL::JobSystem jobs;
+        LLBVHLoader::parallel_for_t parallel_for;
+    };
+    typedef test_group<llbvhloader_data> llbvhloader_group;
+    typedef llbvhloader_group::object object;
+    llbvhloader_group llbvhloadergrp("llbvhloader");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("frame values parse as written");
+        // CRLF line endings, blank lines and the spellings numbers take
+        std::string bvh =
+            "HIERARCHY\r\n"
+            "ROOT hip\r\n{\r\n"
+            "\tOFFSET 0 0 0\r\n"
+            "\tCHANNELS 6 Xposition Yposition Zposition Zrotation Xrotation Yrotation\r\n"
+            "\tJOINT chest\r\n\t{\r\n"
+            "\t\tOFFSET 0 5 0\r\n"
+            "\t\tCHANNELS 3 Yrotation Xrotation Zrotation\r\n"
+            "\t\tEnd Site\r\n\t\t{\r\n\t\t\tOFFSET 0 1 0\r\n\t\t}\r\n"
+            "\t}\r\n}\r\n"
+            "MOTION\r\n"
+            "Frames: 2\r\n"
+            "Frame Time: 0.1\r\n"
+            "\r\n"
+            "1 -2.5 +3. .25 -.5 1e1 \t 2.5E-1 -0 7\r\n"
+            "\r\n"
+            "0.1 0.2 0.3 12.345678 -98.7654321 0.000001 1 2 3\r\n";
+        TestLoader loader;
+        ensure_equals("status", loader.parse(bvh), E_ST_OK);
+        const JointVector& joints = loader.getJoints();
+        ensure_equals("joints", joints.size(), (size_t)2);
+        ensure_equals("keys", joints[0]->mKeys.size(), (size_t)2);
+
+        const Key& hip = joints[0]->mKeys[0];
+        ensure_equals("x", hip.mPos[0], 1.f);
+        ensure_equals("y", hip.mPos[1], -2.5f);
+        ensure_equals("z", hip.mPos[2], 3.f);
+        // in Z, X, Y order
+        ensure_equals("rot z", hip.mRot[2], .25f);
+        ensure_equals("rot x", hip.mRot[0], -.5f);
+        ensure_equals("rot y", hip.mRot[1], 10.f);
+        // in Y, X, Z order
+        const Key& chest = joints[1]->mKeys[0];
+        ensure_equals("chest y", chest.mRot[1], .25f);
+        ensure_equals("chest x", chest.mRot[0], 0.f);
+        ensure_equals("chest z", chest.mRot[2], 7.f);
+
+        // as strtof() rounds them
+        const Key& second = joints[0]->mKeys[1];
+        ensure_equals("rounded", second.mRot[2], strtof("12.345678", NULL));
+        ensure_equals("rounded", second.mRot[0], strtof("-98.7654321", NULL));
+        ensure_equals("rounded", second.mRot[1], strtof("0.000001", NULL));
+        ensure_equals("rounded", second.mPos[0], strtof("0.1", NULL));
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("malformed files report as before");
+        const std::string good = make_bvh(3, 2, 3, 10);
+        const std::string motion = good.substr(0, good.find("MOTION"));
+        const std::string header = motion + "MOTION\nFrames: 2\nFrame Time: 0.1\n";
+        const std::string frame = good.substr(good.find('\n', good.find("Frame Time:")) + 1);
+        const std::string first_frame = frame.substr(0, frame.find('\n') + 1);
+        // the first frame with its first value swapped for another token
+        auto bad_frame = [&first_frame](const std::string& token)
+        {
+            return token + first_frame.substr(first_frame.find(' '));
+        };
+
+        std::vector<std::pair<std::string, ELoadStatus>> cases =
+        {
+            { "", E_ST_EOF },
+            { "HIERARCH\nROOT hip\n", E_ST_NO_HIER },
+            { "HIERARCHY\nROOT hip\n", E_ST_EOF },
+            { "HIERARCHY\nROOT hip\n{\nOFFSET 0 0 0\nCHANNELS 6 Xposition\n", E_ST_NO_ROTATION },
+            { motion + "MOTION\nFrames: x\n", E_ST_NO_FRAMES },
+            { motion + "MOTION\nFrames: 2\nFrameTime: 0.1\n", E_ST_NO_FRAME_TIME },
+            { header + first_frame, E_ST_EOF },
+            { header + first_frame + "1 2 3\n", E_ST_NO_POS },
+            { header + first_frame + bad_frame("3x"), E_ST_NO_POS },
+            { header + first_frame + bad_frame("nan"), E_ST_NO_POS },
+            { header + first_frame + bad_frame("1e99"), E_ST_NO_POS },
+            { header + first_frame + bad_frame("3e"), E_ST_NO_POS },
+            { header + first_frame + bad_frame("."), E_ST_NO_POS },
+            { header + first_frame + bad_frame("1.2.3"), E_ST_NO_POS },
+            { header + first_frame + bad_frame("-1.5e+1"), E_ST_OK },
+            { header + first_frame + first_frame, E_ST_OK },
+        };
+        for (size_t i = 0; i < cases.size(); ++i)
+        {
+            TestLoader loader;
+            ensure_equals(STRINGIZE("case " << i), loader.parse(cases[i].first), cases[i].second);
+        }
+
+        TestLoader loader;
+        ensure_equals("root", loader.parse(good, false), E_ST_OK);
+        TestLoader other_root;
+        ensure_equals("other root", other_root.parse("HIERARCHY\nROOT pelvis_bone\n{\n", false), E_ST_BAD_ROOT);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("parallel reduction matches serial");
+        ensure("found the pool", bool(parallel_for));
+        ensure("no such pool", ! LLBVHLoader::poolParallelFor("llbvhloader_test_missing"));
+        for (U32 seed = 0; seed < 4; ++seed)
+        {
+            const std::string bvh = make_bvh(seed, 3 + seed, 2 + seed, 120 + 50 * seed);
+
+            TestLoader serial;
+            ensure_equals("serial", serial.parse(bvh), E_ST_OK);
+            serial.reduce();
+
+            std::mutex mutex;
+            std::vector<F32> progress;
+            TestLoader parallel(parallel_for, [&](F32 fraction)
+                                {
+                                    std::lock_guard<std::mutex> lock(mutex);
+                                    progress.push_back(fraction);
+                                });
+            ensure_equals("parallel", parallel.parse(bvh), E_ST_OK);
+            parallel.reduce();
+
+            ensure("output", serial.output() == parallel.output());
+            U32 dropped = 0;
+            for (size_t j = 0; j < serial.getJoints().size(); ++j)
+            {
+                const Joint* a = serial.getJoints()[j];
+                const Joint* b = parallel.getJoints()[j];
+                ensure_equals("ignore", a->mIgnore, b->mIgnore);
+                ensure_equals("rot keys", a->mNumRotKeys, b->mNumRotKeys);
+                ensure_equals("pos keys", a->mNumPosKeys, b->mNumPosKeys);
+                dropped += a->mIgnore ? 1 : 0;
+            }
+            ensure("still joints dropped", dropped > 0);
+
+            ensure("progress reported", progress.size() > serial.getJoints().size());
+            F32 highest = 0.f;
+            for (F32 fraction : progress)
+            {
+                ensure("progress in range", fraction >= 0.f && fraction <= 1.f);
+                highest = llmax(highest, fraction);
+            }
+            ensure_equals("progress completes", highest, 1.f);
+        }
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("parse and reduction benchmark");
+        std::vector<std::string> corpus = load_corpus();
+
+        size_t bytes = 0;
+        F64 parse_ms = 0.0, serial_ms = 0.0, parallel_ms = 0.0;
+        const U32 passes = 3;
+        LLTimer timer;
+        for (U32 pass = 0; pass < passes; ++pass)
+        {
+            for (const std::string& bvh : corpus)
+            {
+                bytes += bvh.size();
+
+                TestLoader serial;
+                timer.reset();
+                ELoadStatus status = serial.parse(bvh);
+                parse_ms += timer.getElapsedTimeF64() * 1000.0;
+                ensure_equals("parse", status, E_ST_OK);
+                timer.reset();
+                serial.reduce();
+                serial_ms += timer.getElapsedTimeF64() * 1000.0;
+
+                TestLoader parallel(parallel_for);
+                parallel.parse(bvh);
+                timer.reset();
+                parallel.reduce();
+                parallel_ms += timer.getElapsedTimeF64() * 1000.0;
+            }
+        }
+        const F64 seconds = parse_ms / 1000.0;
+
+        LL_INFOS("Benchmark") << corpus.size() << " files, " << bytes / passes / corpus.size()
+                              << " bytes each: parse " << parse_ms / passes / corpus.size() << " ms ("
+                              << (F64)bytes / (1024.0 * 1024.0) / seconds << " MB/s), reduce serial "
+                              << serial_ms / passes / corpus.size() << " ms, parallel "
+                              << parallel_ms / passes / corpus.size() << " ms" << LL_ENDL;
+    }
+} // namespace tut
@@ -0,0 +1,419 @@
+/**
+ * @file   llkeyframemotion_test.cpp
+ * @brief  Packed keyframe sampling against the key curves, and a benchmark
+ *         over a corpus of .anim assets.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "../llkeyframemotion.h"
+// STL headers
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+// std headers
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "../llcharacter.h"
+#include "lldatapacker.h"
+#include "llquantize.h"
+#include "lltimer.h"
+#include "stringize.h"
+#include "v3dmath.h"
+
+namespace
+{
+    // about as many joints as a full body animation moves
+    const U32 NUM_JOINTS = 64;
+
+    class Sequence
+    {
+    public:
+        Sequence(U32 seed): mState(seed) {}
+        U32 next() { mState = mState * 1664525U + 1013904223U; return mState >> 8; }
+        F32 range(F32 low, F32 high) { return low + (high - low) * (F32)(next() & 0xffff) / 65535.f; }
+
+    private:
+        U32 mState;
+    };
+
+    class SyntheticCharacter: public LLCharacter
+    {
+    public:
+        SyntheticCharacter()
+        {
+            mID.generate();
+            mRoot.setup("mRoot");
+            mRoot.setJointNum(0);
+            for (U32 i = 0; i < NUM_JOINTS; ++i)
+            {
+                mJoints.emplace_back(std::make_unique<LLJoint>());
+                mJoints.back()->setup(STRINGIZE("joint" << i), &mRoot);
+                mJoints.back()->setJointNum((S32)i + 1);
+            }
+        }
+
+        const char* getAnimationPrefix() override { return "synthetic"; }
+        LLJoint* getRootJoint() override { return &mRoot; }
+        LLVector3 getCharacterPosition() override { return LLVector3::zero; }
+        LLQuaternion getCharacterRotation() override { return LLQuaternion::DEFAULT; }
+        LLVector3 getCharacterVelocity() override { return LLVector3::zero; }
+        LLVector3 getCharacterAngularVelocity() override { return LLVector3::zero; }
+        void getGround(const LLVector3& in_pos, LLVector3& out_pos, LLVector3& out_norm) override
+        {
+            out_pos = in_pos;
+            out_pos.mV[VZ] = 0.f;
+            out_norm = LLVector3::z_axis;
+        }
+        LLJoint* getCharacterJoint(U32 i) override { return i < mJoints.size() ? mJoints[i].get() : NULL; }
+        F32 getTimeDilation() override { return 1.f; }
+        F32 getPixelArea() const override { return 100000.f; }
+        LLPolyMesh* getHeadMesh() override { return NULL; }
+        LLPolyMesh* getUpperBodyMesh() override { return NULL; }
+        LLVector3d getPosGlobalFromAgent(const LLVector3& position) override { return LLVector3d(position); }
+        LLVector3 getPosAgentFromGlobal(const LLVector3d& position) override { return LLVector3(position); }
+        void addDebugText(const std::string& text) override {}
+        const LLUUID& getID() const override { return mID; }
+
+        LLUUID mID;
+        LLJoint mRoot;
+        std::vector<std::unique_ptr<LLJoint>> mJoints;
+    };
+
+    // exposes the sampling for the tests
+    class TestMotion: public LLKeyframeMotion
+    {
+    public:
+        TestMotion(LLCharacter* character): LLKeyframeMotion(LLUUID::generateNewID())
+        {
+            setCharacter(character);
+        }
+
+        ~TestMotion()
+        {
+            LLKeyframeDataCache::removeKeyframeData(getID());
+        }
+
+        BOOL load(const std::vector<U8>& anim)
+        {
+            LLDataPackerBinaryBuffer dp(const_cast<U8*>(anim.data()), (S32)anim.size());
+            return deserialize(dp, getID());
+        }
+
+        void applyKeyframes(F32 time) { LLKeyframeMotion::applyKeyframes(time); }
+        void applyPackedKeyframes(F32 time) { LLKeyframeMotion::applyPackedKeyframes(time); }
+
+        // what the curves' own getValue() gives
+        void applyCurves(F32 time)
+        {
+            for (U32 i = 0; i < mJointMotionList->getNumJointMotions(); ++i)
+            {
+                mJointMotionList->getJointMotion(i)->update(mJointStates[i], time, mJointMotionList->mDuration);
+            }
+        }
+
+        std::vector<U8> save() const
+        {
+            std::vector<U8> buffer(1024 * 1024);
+            LLDataPackerBinaryBuffer dp(buffer.data(), (S32)buffer.size());
+            buffer.resize(serialize(dp) ? dp.getCurrentSize() : 0);
+            return buffer;
+        }
+
+        // empty if every joint state holds the values of the curves of list
+        // at time
+        std::string checkKeyframes(F32 time, JointMotionList* list)
+        {
+            for (U32 i = 0; i < list->getNumJointMotions(); ++i)
+            {
+                JointMotion* joint_motion = list->getJointMotion(i);
+                LLJointState* state = mJointStates[i];
+                LLQuaternion rot = joint_motion->mRotationCurve.getValue(time, getDuration());
+                if (joint_motion->mRotationCurve.mNumKeys && dot(rot, state->getRotation()) < 0.99999f)
+                {
+                    return STRINGIZE("joint " << i << " at " << time << " rotation " << state->getRotation()
+                                     << " != " << rot);
+                }
+                LLVector3 pos = joint_motion->mPositionCurve.getValue(time, getDuration());
+                if (joint_motion->mPositionCurve.mNumKeys && dist_vec(pos, state->getPosition()) > 1.e-5f)
+                {
+                    return STRINGIZE("joint " << i << " at " << time << " position " << state->getPosition()
+                                     << " != " << pos);
+                }
+            }
+            return "";
+        }
+
+        JointMotionList* getList() const { return mJointMotionList; }
+
+        // bytes the curves' key vectors take, and the packed keys
+        U32 keyBytes() const
+        {
+            U32 bytes = 0;
+            for (JointMotion* joint_motion : mJointMotionList->mJointMotionArray)
+            {
+                bytes += joint_motion->mRotationCurve.mKeys.size() * sizeof(RotationCurve::key_map_t::value_type);
+                bytes += joint_motion->mPositionCurve.mKeys.size() * sizeof(PositionCurve::key_map_t::value_type);
+            }
+            return bytes;
+        }
+        U32 packedBytes() const { return mJointMotionList->mPackedKeys.size() * sizeof(U16); }
+    };
+
+    // An .anim in the current format, with rotation keys on every joint and
+    // position keys on every fourth. Some neighbouring keys are written out
+    // of order and some times twice, which deserialize() has to sort out.
+    std::vector<U8> make_anim(U32 seed, U32 joints, U32 keys, F32 duration)
+    {
+        Sequence sequence(seed);
+        std::vector<U8> buffer(256 + joints * (64 + 2 * keys * 10));
+        LLDataPackerBinaryBuffer dp(buffer.data(), (S32)buffer.size());
+        dp.packU16(KEYFRAME_MOTION_VERSION, "version");
+        dp.packU16(KEYFRAME_MOTION_SUBVERSION, "sub_version");
+        dp.packS32(LLJoint::MEDIUM_PRIORITY, "base_priority");
+        dp.packF32(duration, "duration");
+        dp.packString("", "emote_name");
+        dp.packF32(0.f, "loop_in_point");
+        dp.packF32(duration, "loop_out_point");
+        dp.packS32(1, "loop");
+        dp.packF32(0.5f, "ease_in_duration");
+        dp.packF32(0.5f, "ease_out_duration");
+        dp.packU32(LLHandMotion::HAND_POSE_RELAXED, "hand_pose");
+        dp.packU32(joints, "num_joints");
+
+        auto pack_keys = [&](U32 count, F32 limit)
+        {
+            std::vector<U16> times;
+            for (U32 k = 0; k < count; ++k)
+            {
+                times.push_back((U16)((U32)U16MAX * k / (count - 1)));
+                if (k % 16 == 7)
+                {
+                    times.push_back(times.back());
+                }
+                else if (k % 16 == 12)
+                {
+                    std::swap(times[times.size() - 1], times[times.size() - 2]);
+                }
+            }
+            dp.packS32((S32)times.size(), "num_keys");
+            for (U16 time : times)
+            {
+                dp.packU16(time, "time");
+                dp.packU16(F32_to_U16(sequence.range(-limit, limit), -1.f, 1.f), "x");
+                dp.packU16(F32_to_U16(sequence.range(-limit, limit), -1.f, 1.f), "y");
+                dp.packU16(F32_to_U16(sequence.range(-limit, limit), -1.f, 1.f), "z");
+            }
+        };
+
+        for (U32 j = 0; j < joints; ++j)
+        {
+            dp.packString(STRINGIZE("joint" << j), "joint_name");
+            dp.packS32(LLJoint::MEDIUM_PRIORITY, "joint_priority");
+            pack_keys(keys, 0.5f);
+            if (j % 4 == 0)
+            {
+                pack_keys(keys / 2, 1.f);
+            }
+            else
+            {
+                dp.packS32(0, "num_pos_keys");
+            }
+        }
+        dp.packS32(0, "num_constraints");
+        buffer.resize(dp.getCurrentSize());
+        return buffer;
+    }
+
+    // Real assets to benchmark with, from the directory LL_ANIM_CORPUS
+    // names, or else a synthetic spread of sizes, keyed at between 5 and 30
+    // frames a second as uploads are.
+    std::vector<std::vector<U8>> load_corpus()
+    {
+        std::vector<std::vector<U8>> corpus;
+        if (const char* dir = getenv("LL_ANIM_CORPUS"))
+        {
+            for (const auto& entry : std::filesystem::directory_iterator(dir))
+            {
+                if (entry.path().extension() == ".anim")
+                {
+                    std::ifstream file(entry.path(), std::ios::binary);
+                    corpus.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                }
+            }
+        }
+        if (corpus.empty())
+        {
+            for (U32 i = 0; i < 200; ++i)
+            {
+                U32 seconds = 1 + i % 10;
+                corpus.push_back(make_anim(i, 8 + (i * 7) % (NUM_JOINTS - 8), seconds * (5 + (i * 37) % 26),
+                                           (F32)seconds));
+            }
+        }
+        return corpus;
+    }
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llkeyframemotion_data
+    {
+        SyntheticCharacter mCharacter;
+    };
+    typedef test_group<llkeyframemotion_data> llkeyframemotion_group;
+    typedef llkeyframemotion_group::object object;
+    llkeyframemotion_group llkeyframemotiongrp("llkeyframemotion");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("packed keys sample like the curves");
+        const std::vector<U8> anim = make_anim(1, 20, 40, 3.f);
+        TestMotion motion(&mCharacter);
+        ensure("deserialize", motion.load(anim));
+        ensure("packed", motion.getList()->hasPackedKeys());
+        ensure_equals("only packed", motion.keyBytes(), 0U);
+
+        // the same keys decoded into curves
+        TestMotion curves(&mCharacter);
+        ensure("deserialize curves", curves.load(anim));
+        curves.getList()->unpackKeys();
+        ensure("unpacked", !curves.getList()->hasPackedKeys());
+        ensure("smaller", motion.packedBytes() < curves.keyBytes());
+
+        const F32 duration = motion.getDuration();
+        std::vector<F32> times;
+        // playing forward, a frame at a time
+        for (F32 time = 0.f; time <= duration; time += 1.f / 45.f)
+        {
+            times.push_back(time);
+        }
+        // looping back, skipping ahead, and outside the keys
+        for (F32 time : { 0.2f, 2.9f, 0.f, 1.5f, 1.49f, -1.f, duration, duration + 1.f, 0.7f })
+        {
+            times.push_back(time);
+        }
+        // exactly on keys
+        for (U32 k = 0; k < 40; k += 3)
+        {
+            times.push_back(U16_to_F32((U16)((U32)U16MAX * k / 39), 0.f, duration));
+        }
+
+        for (F32 time : times)
+        {
+            motion.applyKeyframes(time);
+            std::string error = motion.checkKeyframes(time, curves.getList());
+            ensure_equals(error, "");
+        }
+
+        // as the poser does before editing keys
+        motion.getList()->unpackKeys();
+        ensure("unpacked motion", !motion.getList()->hasPackedKeys());
+        ensure_equals("decoded keys", motion.keyBytes(), curves.keyBytes());
+        motion.applyKeyframes(1.f);
+        ensure_equals("unpacked motion", motion.checkKeyframes(1.f, motion.getList()), "");
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("serialize writes the packed keys back");
+        TestMotion motion(&mCharacter);
+        ensure("deserialize", motion.load(make_anim(2, 12, 30, 2.f)));
+        std::vector<U8> saved = motion.save();
+        ensure("serialize", !saved.empty());
+
+        TestMotion reloaded(&mCharacter);
+        ensure("deserialize saved", reloaded.load(saved));
+        ensure("same keys", reloaded.getList()->mPackedKeys == motion.getList()->mPackedKeys);
+        ensure_equals("saved again", reloaded.save().size(), saved.size());
+        ensure("saved again the same", reloaded.save() == saved);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("deserialize and sampling benchmark");
+        std::vector<std::vector<U8>> corpus = load_corpus();
+
+        // deserializing, with the packing it now does
+        const U32 passes = 5;
+        U32 key_bytes = 0, packed_bytes = 0;
+        F64 deserialize_us = 0.0;
+        LLTimer timer;
+        for (U32 pass = 0; pass < passes; ++pass)
+        {
+            for (const std::vector<U8>& anim : corpus)
+            {
+                TestMotion motion(&mCharacter);
+                timer.reset();
+                BOOL loaded = motion.load(anim);
+                deserialize_us += timer.getElapsedTimeF64() * 1.e6;
+                ensure("deserialize", loaded);
+                if (pass == 0)
+                {
+                    packed_bytes += motion.packedBytes();
+                }
+            }
+        }
+        deserialize_us /= passes * corpus.size();
+
+        // playing each motion through at 45 frames a second, from the
+        // packed keys or from the same keys decoded into the curves
+        std::vector<std::unique_ptr<TestMotion>> motions;
+        std::vector<std::unique_ptr<TestMotion>> curve_motions;
+        for (const std::vector<U8>& anim : corpus)
+        {
+            motions.emplace_back(std::make_unique<TestMotion>(&mCharacter));
+            motions.back()->load(anim);
+            curve_motions.emplace_back(std::make_unique<TestMotion>(&mCharacter));
+            curve_motions.back()->load(anim);
+            curve_motions.back()->getList()->unpackKeys();
+            key_bytes += curve_motions.back()->keyBytes();
+        }
+        auto play = [&motions, &curve_motions](bool packed)
+        {
+            U32 frames = 0;
+            LLTimer timer;
+            for (auto& motion : packed ? motions : curve_motions)
+            {
+                const F32 duration = motion->getDuration();
+                for (F32 time = 0.f; time <= duration; time += 1.f / 45.f, ++frames)
+                {
+                    if (packed)
+                    {
+                        motion->applyPackedKeyframes(time);
+                    }
+                    else
+                    {
+                        motion->applyCurves(time);
+                    }
+                }
+            }
+            return timer.getElapsedTimeF64() * 1.e6 / frames;
+        };
+        play(false);
+        play(true);
+        F64 curve_us = play(false);
+        F64 packed_us = play(true);
+
+        LL_INFOS("Benchmark") << corpus.size() << " animations: deserialize " << deserialize_us
+                              << " us each, keys " << key_bytes << " bytes, packed " << packed_bytes
+                              << " bytes; us per frame sampling curves " << curve_us
+                              << ", packed " << packed_us << LL_ENDL;
+    }
+} // namespace tut
@@ -0,0 +1,414 @@
+/**
+ * @file   llmotioncontroller_test.cpp
+ * @brief  Split motion updates and a headless crowd animation benchmark.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "../llmotioncontroller.h"
+// STL headers
+#include <memory>
+#include <sstream>
+#include <vector>
+// std headers
+#include <cmath>
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "../llcharacter.h"
+#include "../lljointstate.h"
+#include "jobsystem.h"
+#include "llframetimer.h"
+#include "lltimer.h"
+#include "stringize.h"
+#include "v3dmath.h"
+
+namespace
+{
+    const LLUUID WAVE_MOTION_ID("6b61c8e8-4747-0d75-12d7-e49ff207a4ca");
+    const LLUUID STOP_MOTION_ID("ebb6a5b3-6b3c-4f23-9d3a-8a2d3d8c2f10");
+    const LLUUID ADDITIVE_MOTION_ID("2b2f3c5e-8d0a-4c1e-a7f4-5e9b3d6a1c27");
+
+    // eight chains of eight joints hanging off the root: about the size of
+    // the animated part of an avatar skeleton
+    const U32 NUM_CHAINS = 8;
+    const U32 CHAIN_LENGTH = 8;
+    const U32 NUM_JOINTS = 1 + NUM_CHAINS * CHAIN_LENGTH;
+
+    // Rotates every joint but the root about its own axis, each a little
+    // out of phase with its neighbours.
+    class WaveMotion: public LLMotion
+    {
+    public:
+        WaveMotion(const LLUUID& id): LLMotion(id) { mName = "wave"; }
+        static LLMotion* create(const LLUUID& id) { return new WaveMotion(id); }
+
+        static LLQuaternion rotationAt(F32 time, U32 joint)
+        {
+            static const LLVector3 axes[3] = { LLVector3::x_axis, LLVector3::y_axis, LLVector3::z_axis };
+            return LLQuaternion(0.4f * sinf(2.f * time + 0.37f * joint), axes[joint % 3]);
+        }
+
+        BOOL getLoop() override { return TRUE; }
+        F32 getDuration() override { return 0.f; }
+        F32 getEaseInDuration() override { return 0.f; }
+        F32 getEaseOutDuration() override { return 0.f; }
+        LLJoint::JointPriority getPriority() override { return LLJoint::MEDIUM_PRIORITY; }
+        LLMotionBlendType getBlendType() override { return NORMAL_BLEND; }
+        F32 getMinPixelArea() override { return 0.f; }
+
+        LLMotionInitStatus onInitialize(LLCharacter* character) override
+        {
+            for (U32 i = 1; i < NUM_JOINTS; ++i)
+            {
+                LLPointer<LLJointState> state = new LLJointState(character->getCharacterJoint(i));
+                state->setUsage(LLJointState::ROT);
+                addJointState(state);
+                mStates.push_back(state);
+            }
+            return STATUS_SUCCESS;
+        }
+
+        BOOL onActivate() override { return TRUE; }
+
+        BOOL onUpdate(F32 time, U8* joint_mask) override
+        {
+            mLastTime = time;
+            ++mUpdates;
+            for (U32 i = 0; i < mStates.size(); ++i)
+            {
+                mStates[i]->setRotation(rotationAt(time, i + 1));
+            }
+            return TRUE;
+        }
+
+        void onDeactivate() override {}
+
+        F32 mLastTime = 0.f;
+        U32 mUpdates = 0;
+        std::vector<LLPointer<LLJointState>> mStates;
+    };
+
+    // The wave again, added on top of whatever else plays.
+    class AdditiveMotion: public WaveMotion
+    {
+    public:
+        AdditiveMotion(const LLUUID& id): WaveMotion(id) { mName = "additive"; }
+        static LLMotion* create(const LLUUID& id) { return new AdditiveMotion(id); }
+
+        LLMotionBlendType getBlendType() override { return ADDITIVE_BLEND; }
+    };
+
+    // Stops itself the first time it is evaluated.
+    class StopMotion: public WaveMotion
+    {
+    public:
+        StopMotion(const LLUUID& id): WaveMotion(id) { mName = "stop"; }
+        static LLMotion* create(const LLUUID& id) { return new StopMotion(id); }
+
+        BOOL getLoop() override { return FALSE; }
+        BOOL onUpdate(F32 time, U8* joint_mask) override { return FALSE; }
+    };
+
+    class SyntheticCharacter: public LLCharacter
+    {
+    public:
+        SyntheticCharacter()
+        {
+            mID.generate();
+            mRoot.setJointNum(0);
+            mJoints.push_back(&mRoot);
+            for (U32 chain = 0; chain < NUM_CHAINS; ++chain)
+            {
+                LLJoint* parent = &mRoot;
+                for (U32 link = 0; link < CHAIN_LENGTH; ++link)
+                {
+                    mOwned.emplace_back(std::make_unique<LLJoint>());
+                    LLJoint* joint = mOwned.back().get();
+                    joint->setup(STRINGIZE("joint" << chain << "_" << link), parent);
+                    joint->setJointNum((S32)mJoints.size());
+                    joint->setPosition(LLVector3(0.f, 0.1f * chain, 0.1f));
+                    mJoints.push_back(joint);
+                    parent = joint;
+                }
+            }
+            registerMotion(WAVE_MOTION_ID, WaveMotion::create);
+            registerMotion(STOP_MOTION_ID, StopMotion::create);
+            registerMotion(ADDITIVE_MOTION_ID, AdditiveMotion::create);
+        }
+
+        const char* getAnimationPrefix() override { return "synthetic"; }
+        LLJoint* getRootJoint() override { return &mRoot; }
+        LLVector3 getCharacterPosition() override { return LLVector3::zero; }
+        LLQuaternion getCharacterRotation() override { return LLQuaternion::DEFAULT; }
+        LLVector3 getCharacterVelocity() override { return LLVector3::zero; }
+        LLVector3 getCharacterAngularVelocity() override { return LLVector3::zero; }
+        void getGround(const LLVector3& in_pos, LLVector3& out_pos, LLVector3& out_norm) override
+        {
+            out_pos = in_pos;
+            out_pos.mV[VZ] = 0.f;
+            out_norm = LLVector3::z_axis;
+        }
+        LLJoint* getCharacterJoint(U32 i) override { return i < mJoints.size() ? mJoints[i] : NULL; }
+        F32 getTimeDilation() override { return 1.f; }
+        F32 getPixelArea() const override { return 100000.f; }
+        LLPolyMesh* getHeadMesh() override { return NULL; }
+        LLPolyMesh* getUpperBodyMesh() override { return NULL; }
+        LLVector3d getPosGlobalFromAgent(const LLVector3& position) override { return LLVector3d(position); }
+        LLVector3 getPosAgentFromGlobal(const LLVector3d& position) override { return LLVector3(position); }
+        void addDebugText(const std::string& text) override {}
+        const LLUUID& getID() const override { return mID; }
+
+        void requestStopMotion(LLMotion* motion) override { ++mStopRequests; }
+
+        // the world rotation every joint should have, given the time the
+        // wave motion last ran at
+        std::string checkPose()
+        {
+            WaveMotion* wave = (WaveMotion*)findMotion(WAVE_MOTION_ID);
+            if (!wave)
+            {
+                return "no wave motion";
+            }
+            std::vector<LLQuaternion> world(mJoints.size());
+            world[0] = mRoot.getRotation();
+            for (U32 i = 1; i < mJoints.size(); ++i)
+            {
+                LLJoint* joint = mJoints[i];
+                if (joint->mDirtyFlags)
+                {
+                    return STRINGIZE(joint->getName() << " still dirty");
+                }
+                U32 parent = (U32)joint->getParent()->getJointNum();
+                world[i] = WaveMotion::rotationAt(wave->mLastTime, i) * world[parent];
+                LLQuaternion actual = joint->getWorldRotation();
+                if (fabsf(dot(actual, world[i])) < 0.9999f)
+                {
+                    return STRINGIZE(joint->getName() << " is " << actual << ", expected " << world[i]);
+                }
+            }
+            return "";
+        }
+
+        LLUUID mID;
+        LLJoint mRoot;
+        std::vector<std::unique_ptr<LLJoint>> mOwned;
+        std::vector<LLJoint*> mJoints;
+        S32 mStopRequests = 0;
+    };
+
+    typedef std::vector<std::unique_ptr<SyntheticCharacter>> crowd_t;
+
+    void makeCrowd(crowd_t& crowd, U32 count)
+    {
+        for (U32 i = 0; i < count; ++i)
+        {
+            crowd.emplace_back(std::make_unique<SyntheticCharacter>());
+            crowd.back()->startMotion(WAVE_MOTION_ID);
+        }
+    }
+
+    // one frame, the way the viewer used to: every character in turn
+    void animateSerial(crowd_t& crowd)
+    {
+        LLFrameTimer::updateFrameTime();
+        for (auto& character : crowd)
+        {
+            character->updateMotions(LLCharacter::NORMAL_UPDATE);
+            character->getRootJoint()->updateWorldMatrixChildren();
+        }
+    }
+
+    // one frame, the way LLViewerObjectList::update() now animates avatars
+    void animateParallel(crowd_t& crowd, LL::JobSystem& jobs)
+    {
+        LLFrameTimer::updateFrameTime();
+        std::vector<U8> pending(crowd.size());
+        for (size_t i = 0; i < crowd.size(); ++i)
+        {
+            pending[i] = crowd[i]->prepareMotions(LLCharacter::NORMAL_UPDATE);
+        }
+        jobs.parallelFor(crowd.size(),
+                         [&crowd, &pending](size_t i)
+                         {
+                             if (pending[i])
+                             {
+                                 crowd[i]->evaluateMotions(LLCharacter::NORMAL_UPDATE);
+                             }
+                             crowd[i]->getRootJoint()->updateWorldMatrixChildren();
+                         });
+        for (auto& character : crowd)
+        {
+            character->finishMotions();
+        }
+    }
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llmotioncontroller_data
+    {
+        llmotioncontroller_data():
+            jobs("llmotioncontroller_test", 4)
+        {
+            jobs.start();
+        }
+
+        LL::JobSystem jobs;
+    };
+    typedef test_group<llmotioncontroller_data> llmotioncontroller_group;
+    typedef llmotioncontroller_group::object object;
+    llmotioncontroller_group llmotioncontrollergrp("llmotioncontroller");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("evaluateMotions() leaves stop requests to finishMotions()");
+        SyntheticCharacter character;
+        ensure("start", character.startMotion(STOP_MOTION_ID));
+
+        LLFrameTimer::updateFrameTime();
+        ensure("prepare", character.prepareMotions(LLCharacter::NORMAL_UPDATE));
+        character.evaluateMotions(LLCharacter::NORMAL_UPDATE);
+        ensure_equals("requests held back", character.mStopRequests, 0);
+        character.finishMotions();
+        ensure_equals("requests after finish", character.mStopRequests, 1);
+
+        // and updateMotions() is still the three in one
+        SyntheticCharacter other;
+        ensure("start other", other.startMotion(STOP_MOTION_ID));
+        other.updateMotions(LLCharacter::NORMAL_UPDATE);
+        ensure_equals("requests from updateMotions", other.mStopRequests, 1);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("hidden updates have nothing to evaluate");
+        SyntheticCharacter character;
+        character.startMotion(WAVE_MOTION_ID);
+        ensure("hidden", ! character.prepareMotions(LLCharacter::HIDDEN_UPDATE));
+        character.finishMotions();
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("characters animated in parallel hold their own poses");
+        crowd_t crowd;
+        makeCrowd(crowd, 48);
+        for (U32 frame = 0; frame < 10; ++frame)
+        {
+            animateParallel(crowd, jobs);
+            ms_sleep(2);
+        }
+        for (size_t i = 0; i < crowd.size(); ++i)
+        {
+            std::string error = crowd[i]->checkPose();
+            ensure(STRINGIZE("character " << i << ": " << error), error.empty());
+        }
+
+        // serial and parallel frames can be mixed freely
+        animateSerial(crowd);
+        ensure_equals("serial after parallel", crowd[0]->checkPose(), "");
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("crowd animation benchmark");
+        const U32 frames = 30;
+        std::ostringstream report;
+        report << "characters  serial  parallel (ms per frame, " << NUM_JOINTS << " joints, "
+               << jobs.getWidth() << " workers)";
+        for (U32 count : { 16U, 64U, 256U })
+        {
+            crowd_t crowd;
+            makeCrowd(crowd, count);
+            // let every motion run once before timing
+            animateSerial(crowd);
+
+            LLTimer timer;
+            for (U32 frame = 0; frame < frames; ++frame)
+            {
+                animateSerial(crowd);
+            }
+            F64 serial_ms = timer.getElapsedTimeF64() * 1000.0 / frames;
+
+            timer.reset();
+            for (U32 frame = 0; frame < frames; ++frame)
+            {
+                animateParallel(crowd, jobs);
+            }
+            F64 parallel_ms = timer.getElapsedTimeF64() * 1000.0 / frames;
+
+            ensure_equals(STRINGIZE(count << " characters"), crowd.back()->checkPose(), "");
+            report << "\n" << count << "  " << serial_ms << "  " << parallel_ms;
+        }
+        LL_INFOS("Benchmark") << report.str() << LL_ENDL;
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        set_test_name("animation LOD steps time without running ahead");
+        SyntheticCharacter character;
+        character.startMotion(WAVE_MOTION_ID);
+        character.startMotion(ADDITIVE_MOTION_ID);
+        LLFrameTimer::updateFrameTime();
+        character.updateMotions(LLCharacter::NORMAL_UPDATE);
+
+        LLMotionController& controller = character.getMotionController();
+        WaveMotion* wave = (WaveMotion*)character.findMotion(WAVE_MOTION_ID);
+        WaveMotion* additive = (WaveMotion*)character.findMotion(ADDITIVE_MOTION_ID);
+        ensure("motions", wave && additive);
+        ensure("additive at full LOD", additive->mUpdates > 0);
+
+        const F32 step = 0.02f;
+        controller.setAnimationLOD(LLMotionController::ANIMATION_LOD_LOW);
+        character.setTimeStep(step, 0.007f);
+        U32 wave_updates = wave->mUpdates;
+        U32 additive_updates = additive->mUpdates;
+        // drive the clock by hand, uneven frames of 2 to 7 ms, so that
+        // the number of steps crossed is known exactly
+        F64 clock = controller.getFrameTimer().getElapsedTimeF32();
+        const F64 start = clock;
+        const U32 frames = 60;
+        for (U32 frame = 0; frame < frames; ++frame)
+        {
+            clock += 0.002 + 0.001 * (frame % 6);
+            controller.setElapsedTime(clock);
+            character.updateMotions(LLCharacter::NORMAL_UPDATE);
+            // SL-763: every frame used to move on a whole step
+            F32 ahead = controller.getAnimTime() - (F32)clock;
+            ensure(STRINGIZE("frame " << frame << " is " << ahead << " ahead"),
+                   ahead > -0.001f && ahead < step + 0.001f);
+        }
+        // one evaluation per step boundary crossed, give or take rounding
+        // where a frame lands right on one
+        const S32 steps = (S32)((clock + 0.007) / step) - (S32)((start + 0.007) / step);
+        const S32 evaluations = (S32)(wave->mUpdates - wave_updates);
+        ensure(STRINGIZE(evaluations << " evaluations for " << steps << " steps"),
+               evaluations > 0 && abs(evaluations - steps) <= 1);
+        ensure_equals("additive skipped", additive->mUpdates, additive_updates);
+
+        // and back
+        controller.setAnimationLOD(LLMotionController::ANIMATION_LOD_FULL);
+        character.setTimeStep(0.f);
+        wave_updates = wave->mUpdates;
+        clock += 0.005;
+        controller.setElapsedTime(clock);
+        character.updateMotions(LLCharacter::NORMAL_UPDATE);
+        ensure_equals("full LOD evaluates", wave->mUpdates, wave_updates + 1);
+        ensure("additive again", additive->mUpdates > additive_updates);
+        ensure("on time", fabsf(controller.getAnimTime() - controller.getFrameTimer().getElapsedTimeF32()) < 0.001f);
+    }
+} // namespace tut
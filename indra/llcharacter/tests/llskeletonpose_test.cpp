@@ -0,0 +1,325 @@
+/**
+ * @file   llskeletonpose_test.cpp
+ * @brief  LLSkeletonPose against recursive LLJoint updates, and a benchmark.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "../llskeletonpose.h"
+// STL headers
+#include <memory>
+#include <sstream>
+#include <vector>
+// std headers
+#include <cmath>
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "../lljoint.h"
+#include "lltimer.h"
+#include "stringize.h"
+
+namespace
+{
+    // the size of the bento skeleton's bone set
+    const U32 NUM_JOINTS = 133;
+
+    // deterministic, so that two skeletons built with the same seed match
+    class Sequence
+    {
+    public:
+        Sequence(U32 seed): mState(seed) {}
+        U32 next() { mState = mState * 1664525U + 1013904223U; return mState >> 8; }
+        F32 unit() { return (F32)(next() & 0xffff) / 65535.f; }
+        F32 range(F32 low, F32 high) { return low + (high - low) * unit(); }
+
+    private:
+        U32 mState;
+    };
+
+    // Mostly long chains, as limbs, fingers and the face are, with the odd
+    // branch off an earlier joint.
+    class Skeleton
+    {
+    public:
+        Skeleton(U32 joints, U32 seed)
+        {
+            Sequence sequence(seed);
+            for (U32 i = 0; i < joints; ++i)
+            {
+                mJoints.emplace_back(std::make_unique<LLJoint>());
+                if (i > 0)
+                {
+                    U32 parent = (sequence.next() % 4) ? i - 1 : sequence.next() % i;
+                    mJoints[parent]->addChild(mJoints[i].get());
+                }
+            }
+        }
+
+        LLJoint* getRoot() const { return mJoints.front().get(); }
+        LLJoint* getJoint(U32 i) const { return mJoints[i].get(); }
+        U32 size() const { return (U32)mJoints.size(); }
+
+        void pose(U32 seed, U32 step=1)
+        {
+            Sequence sequence(seed);
+            for (U32 i = 0; i < size(); i += step)
+            {
+                LLJoint* joint = getJoint(i);
+                joint->setPosition(LLVector3(sequence.range(-0.2f, 0.2f), sequence.range(-0.2f, 0.2f),
+                                             sequence.range(0.f, 0.3f)));
+                LLQuaternion rot(sequence.range(-1.f, 1.f), sequence.range(-1.f, 1.f),
+                                 sequence.range(-1.f, 1.f), sequence.range(0.5f, 1.f));
+                rot.normalize();
+                joint->setRotation(rot);
+                joint->setScale(LLVector3(sequence.range(0.8f, 1.2f), sequence.range(0.8f, 1.2f),
+                                          sequence.range(0.8f, 1.2f)));
+            }
+        }
+
+    private:
+        std::vector<std::unique_ptr<LLJoint> > mJoints;
+    };
+
+    bool close_enough(const LLVector4a& a, const LLVector4a& b)
+    {
+        const F32* pa = a.getF32ptr();
+        const F32* pb = b.getF32ptr();
+        for (U32 i = 0; i < 4; ++i)
+        {
+            if (fabsf(pa[i] - pb[i]) > 1.e-4f * (1.f + fabsf(pa[i])))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // empty if every joint of actual has the world transform of its
+    // counterpart in expected
+    std::string compare(const Skeleton& expected, const Skeleton& actual)
+    {
+        for (U32 i = 0; i < expected.size(); ++i)
+        {
+            LLJoint* e = expected.getJoint(i);
+            LLJoint* a = actual.getJoint(i);
+            if (a->mDirtyFlags != e->mDirtyFlags)
+            {
+                return STRINGIZE("joint " << i << " dirty flags " << a->mDirtyFlags << " != " << e->mDirtyFlags);
+            }
+            const LLMatrix4a& em = e->getXform()->getWorldMatrix();
+            const LLMatrix4a& am = a->getXform()->getWorldMatrix();
+            const LLMatrix4a& ev = e->getWorldMatrix4a();
+            const LLMatrix4a& av = a->getWorldMatrix4a();
+            for (U32 row = 0; row < 4; ++row)
+            {
+                if (!close_enough(em.mMatrix[row], am.mMatrix[row]) ||
+                    !close_enough(ev.mMatrix[row], av.mMatrix[row]))
+                {
+                    return STRINGIZE("joint " << i << " world matrix row " << row);
+                }
+            }
+            if (dist_vec(e->getXform()->getWorldPosition(), a->getXform()->getWorldPosition()) > 1.e-4f)
+            {
+                return STRINGIZE("joint " << i << " world position");
+            }
+            if (dot(e->getXform()->getWorldRotation(), a->getXform()->getWorldRotation()) < 0.9999f)
+            {
+                return STRINGIZE("joint " << i << " world rotation");
+            }
+        }
+        return "";
+    }
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llskeletonpose_data
+    {
+    };
+    typedef test_group<llskeletonpose_data> llskeletonpose_group;
+    typedef llskeletonpose_group::object object;
+    llskeletonpose_group llskeletonposegrp("llskeletonpose");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("matches the recursive update");
+        Skeleton expected(NUM_JOINTS, 7), actual(NUM_JOINTS, 7);
+        actual.getRoot()->setPoseBuffer(true);
+        ensure("pose buffer", actual.getRoot()->hasPoseBuffer());
+
+        for (U32 frame = 0; frame < 3; ++frame)
+        {
+            expected.pose(frame);
+            actual.pose(frame);
+            expected.getRoot()->updateWorldMatrixChildren();
+            actual.getRoot()->updateWorldMatrixChildren();
+            ensure_equals(STRINGIZE("frame " << frame), compare(expected, actual), "");
+        }
+
+        // only some joints dirty, the rest must be left alone
+        expected.pose(11, 5);
+        actual.pose(11, 5);
+        expected.getRoot()->updateWorldMatrixChildren();
+        actual.getRoot()->updateWorldMatrixChildren();
+        ensure_equals("partial", compare(expected, actual), "");
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("skipped subtrees and a parented root");
+        Skeleton expected(NUM_JOINTS, 3), actual(NUM_JOINTS, 3);
+        actual.getRoot()->setPoseBuffer(true);
+
+        // as when the avatar sits on an object
+        LLXformMatrix seat_e, seat_a;
+        for (LLXformMatrix* seat : { &seat_e, &seat_a })
+        {
+            seat->setPosition(LLVector3(10.f, 20.f, 30.f));
+            seat->setRotation(LLQuaternion(0.3f, LLVector3::z_axis));
+            seat->setScale(LLVector3(2.f, 2.f, 2.f));
+            seat->update();
+        }
+        expected.getRoot()->getXform()->setParent(&seat_e);
+        actual.getRoot()->getXform()->setParent(&seat_a);
+
+        expected.getJoint(40)->mUpdateXform = FALSE;
+        actual.getJoint(40)->mUpdateXform = FALSE;
+
+        expected.pose(5);
+        actual.pose(5);
+        expected.getRoot()->updateWorldMatrixChildren();
+        actual.getRoot()->updateWorldMatrixChildren();
+        ensure("skipped joint still dirty", actual.getJoint(40)->mDirtyFlags & LLJoint::MATRIX_DIRTY);
+        ensure_equals(compare(expected, actual), "");
+
+        expected.getRoot()->mUpdateXform = FALSE;
+        actual.getRoot()->mUpdateXform = FALSE;
+        expected.pose(6);
+        actual.pose(6);
+        expected.getRoot()->updateWorldMatrixChildren();
+        actual.getRoot()->updateWorldMatrixChildren();
+        ensure_equals("skipped root", compare(expected, actual), "");
+
+        expected.getRoot()->getXform()->setParent(NULL);
+        actual.getRoot()->getXform()->setParent(NULL);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("hierarchy changes");
+        Skeleton expected(NUM_JOINTS, 9), actual(NUM_JOINTS, 9);
+        actual.getRoot()->setPoseBuffer(true);
+        actual.getRoot()->updateWorldMatrixChildren();
+
+        // graft an extra joint on each after the layout was built
+        LLJoint extra_e, extra_a;
+        expected.getJoint(20)->addChild(&extra_e);
+        actual.getJoint(20)->addChild(&extra_a);
+        extra_e.setPosition(LLVector3(0.f, 0.f, 1.f));
+        extra_a.setPosition(LLVector3(0.f, 0.f, 1.f));
+
+        expected.pose(2);
+        actual.pose(2);
+        expected.getRoot()->updateWorldMatrixChildren();
+        actual.getRoot()->updateWorldMatrixChildren();
+        ensure_equals(compare(expected, actual), "");
+        ensure("extra joint updated", extra_a.mDirtyFlags == 0);
+        ensure("extra joint placed",
+               dist_vec(extra_e.getWorldPosition(), extra_a.getWorldPosition()) < 1.e-4f);
+
+        expected.getJoint(20)->removeChild(&extra_e);
+        actual.getJoint(20)->removeChild(&extra_a);
+        actual.getRoot()->updateWorldMatrixChildren();
+        ensure_equals("extra joint dropped", actual.getRoot()->getPoseBuffer()->getNumJoints(), (S32)NUM_JOINTS);
+        actual.getRoot()->setPoseBuffer(false);
+        ensure("no pose buffer", !actual.getRoot()->hasPoseBuffer());
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("hierarchy changes only dirty their own skeleton");
+        Skeleton first(NUM_JOINTS, 4), second(NUM_JOINTS, 4);
+        first.getRoot()->setPoseBuffer(true);
+        second.getRoot()->setPoseBuffer(true);
+        first.getRoot()->updateWorldMatrixChildren();
+        second.getRoot()->updateWorldMatrixChildren();
+
+        // as when an attachment point is added to one avatar
+        LLJoint extra;
+        first.getJoint(60)->addChild(&extra);
+        ensure("changed skeleton dirty", first.getRoot()->getPoseBuffer()->isLayoutDirty());
+        ensure("other skeleton clean", !second.getRoot()->getPoseBuffer()->isLayoutDirty());
+
+        first.getRoot()->updateWorldMatrixChildren();
+        ensure("relaid out", !first.getRoot()->getPoseBuffer()->isLayoutDirty());
+        ensure_equals("extra joint laid out", first.getRoot()->getPoseBuffer()->getNumJoints(), (S32)NUM_JOINTS + 1);
+
+        first.getJoint(60)->removeChild(&extra);
+        ensure("other skeleton still clean", !second.getRoot()->getPoseBuffer()->isLayoutDirty());
+        first.getRoot()->setPoseBuffer(false);
+        second.getRoot()->setPoseBuffer(false);
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        set_test_name("skeleton update benchmark");
+        const U32 skeletons = 64;
+        const U32 frames = 50;
+        std::vector<std::unique_ptr<Skeleton> > recursive, flat;
+        for (U32 i = 0; i < skeletons; ++i)
+        {
+            recursive.emplace_back(std::make_unique<Skeleton>(NUM_JOINTS, i));
+            flat.emplace_back(std::make_unique<Skeleton>(NUM_JOINTS, i));
+            recursive.back()->pose(i);
+            flat.back()->pose(i);
+            flat.back()->getRoot()->setPoseBuffer(true);
+        }
+
+        // every joint dirty each frame, as while animating; only the update
+        // itself is timed
+        auto run = [frames](std::vector<std::unique_ptr<Skeleton> >& set)
+        {
+            F64 seconds = 0.0;
+            LLTimer timer;
+            for (U32 frame = 0; frame < frames; ++frame)
+            {
+                for (auto& skeleton : set)
+                {
+                    skeleton->getRoot()->touch();
+                }
+                timer.reset();
+                for (auto& skeleton : set)
+                {
+                    skeleton->getRoot()->updateWorldMatrixChildren();
+                }
+                seconds += timer.getElapsedTimeF64();
+            }
+            return seconds * 1.e6 / (frames * set.size());
+        };
+        run(recursive);
+        run(flat);
+        F64 recursive_us = run(recursive);
+        F64 flat_us = run(flat);
+
+        for (U32 i = 0; i < skeletons; ++i)
+        {
+            ensure_equals(STRINGIZE("skeleton " << i), compare(*recursive[i], *flat[i]), "");
+        }
+        LL_INFOS("Benchmark") << "skeleton update, us per " << NUM_JOINTS << " joint skeleton: recursive "
+                              << recursive_us << ", pose buffer " << flat_us << LL_ENDL;
+    }
+} // namespace tut
@@ -0,0 +1,428 @@
+/**
+ * @file   jobsystem.cpp
+ * @date   2024-06-12
+ * @brief  Implementation for jobsystem.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "jobsystem.h"
+// STL headers
+// std headers
+#include <algorithm>
+#include <chrono>
+// external library headers
+// other Linden headers
+#include "llcoros.h"
+#include "llerror.h"
+#include "llexception.h"
+
+namespace
+{
+    // Which JobSystem, if any, the current thread works for, and which of
+    // its deques is the thread's own.
+    struct WorkerId
+    {
+        const LL::JobSystem* mSystem = nullptr;
+        size_t mIndex = 0;
+    };
+    thread_local WorkerId sWorker;
+
+    constexpr size_t NO_WORKER = size_t(-1);
+} // anonymous namespace
+
+/*****************************************************************************
+*   Job
+*****************************************************************************/
+class LL::JobSystem::Job: public std::enable_shared_from_this<Job>
+{
+public:
+    Job(Work work): mWork(std::move(work)) {}
+
+    Work mWork;
+    JobPtr mParent;
+    // own work plus children not yet finished
+    std::atomic<S32> mUnfinished{ 1 };
+    // dependencies not yet finished, plus one until submitted
+    std::atomic<S32> mBlocked{ 1 };
+    std::atomic<bool> mFinished{ false };
+
+    // guards mDependents and mOnFinish, and the transition to mFinished
+    std::mutex mMutex;
+    std::vector<JobPtr> mDependents;
+    std::vector<Work> mOnFinish;
+};
+
+/*****************************************************************************
+*   JobSystem
+*****************************************************************************/
+thread_local LL::JobSystem::Job* LL::JobSystem::sCurrentJob = nullptr;
+
+LL::JobSystem::JobSystem(const std::string& name, size_t threads, bool auto_shutdown):
+    super(name, threads, 1024*1024, auto_shutdown)
+{
+    // one deque per thread, ThreadPoolBase applies the same override
+    size_t width = std::max<size_t>(1, getConfiguredWidth(name, threads));
+    mDeques.reserve(width);
+    for (size_t i = 0; i < width; ++i)
+    {
+        mDeques.emplace_back(std::make_unique<Deque>());
+    }
+}
+
+LL::JobSystem::~JobSystem()
+{
+    // ~ThreadPoolBase() would also close(), but by then our deques are gone
+    close();
+}
+
+void LL::JobSystem::close()
+{
+    super::close();
+
+    // the threads have been joined, anything left will never run
+    for (auto& deque: mDeques)
+    {
+        std::lock_guard lock(deque->mMutex);
+        mQueued -= deque->mJobs.size();
+        deque->mJobs.clear();
+    }
+}
+
+void LL::JobSystem::run()
+{
+    sWorker.mSystem = this;
+    sWorker.mIndex = mNextWorker++ % mDeques.size();
+    super::run();
+    sWorker = WorkerId();
+}
+
+size_t LL::JobSystem::currentWorker() const
+{
+    return sWorker.mSystem == this ? sWorker.mIndex : NO_WORKER;
+}
+
+LL::JobSystem::JobPtr LL::JobSystem::create(Work work, const JobPtr& parent)
+{
+    auto job = std::make_shared<Job>(std::move(work));
+    if (parent)
+    {
+        llassert(! parent->mFinished);
+        ++parent->mUnfinished;
+        job->mParent = parent;
+    }
+    return job;
+}
+
+void LL::JobSystem::addDependency(const JobPtr& after, const JobPtr& before)
+{
+    std::lock_guard lock(before->mMutex);
+    if (! before->mFinished)
+    {
+        ++after->mBlocked;
+        before->mDependents.push_back(after);
+    }
+}
+
+void LL::JobSystem::submit(const JobPtr& job)
+{
+    if (--job->mBlocked == 0)
+    {
+        schedule(job);
+    }
+}
+
+LL::JobSystem::JobPtr LL::JobSystem::spawn(Work work, const JobPtr& parent)
+{
+    auto job = create(std::move(work), parent);
+    submit(job);
+    return job;
+}
+
+LL::JobSystem::JobPtr LL::JobSystem::then(const JobPtr& before, Work work)
+{
+    auto job = create(std::move(work));
+    addDependency(job, before);
+    submit(job);
+    return job;
+}
+
+void LL::JobSystem::thenPostTo(const JobPtr& job, WorkQueueBase::weak_t target, Work work)
+{
+    onFinish(job,
+             [target, work=std::move(work)]()
+             {
+                 WorkQueueBase::postMaybe(target, work);
+             });
+}
+
+void LL::JobSystem::onFinish(const JobPtr& job, Work work)
+{
+    {
+        std::lock_guard lock(job->mMutex);
+        if (! job->mFinished)
+        {
+            job->mOnFinish.push_back(std::move(work));
+            return;
+        }
+    }
+    work();
+}
+
+//static
+LL::JobSystem::JobPtr LL::JobSystem::getCurrent()
+{
+    return sCurrentJob ? sCurrentJob->shared_from_this() : JobPtr();
+}
+
+//static
+bool LL::JobSystem::isFinished(const JobPtr& job)
+{
+    return job->mFinished;
+}
+
+void LL::JobSystem::schedule(const JobPtr& job)
+{
+    size_t index = currentWorker();
+    if (index == NO_WORKER)
+    {
+        index = mNextDeque++ % mDeques.size();
+    }
+
+    {
+        Deque& deque = *mDeques[index];
+        std::lock_guard lock(deque.mMutex);
+        deque.mJobs.push_back(job);
+    }
+    ++mQueued;
+
+    kick();
+
+    // a waiter with nothing to do may be able to help now
+    if (mWaiters > 0)
+    {
+        std::lock_guard lock(mWaitMutex);
+        mWaitCond.notify_all();
+    }
+}
+
+void LL::JobSystem::kick()
+{
+    // Enough threads are already on their way through the deques. Any of
+    // them leaving drain() rechecks mQueued after it stops counting itself.
+    if (mDraining + mKicks >= (S32)mDeques.size())
+    {
+        return;
+    }
+
+    ++mKicks;
+    bool posted = getQueue().post(
+        [this]()
+        {
+            ++mDraining;
+            --mKicks;
+            drain();
+        });
+    if (! posted)
+    {
+        --mKicks;
+    }
+}
+
+void LL::JobSystem::drain()
+{
+    for (;;)
+    {
+        while (runOneJob())
+        {
+        }
+
+        --mDraining;
+        if (mQueued <= 0)
+        {
+            return;
+        }
+        ++mDraining;
+    }
+}
+
+LL::JobSystem::JobPtr LL::JobSystem::findJob(size_t home)
+{
+    const size_t count = mDeques.size();
+    JobPtr job;
+
+    // own deque first, newest job: its data is most likely still in cache
+    if (home != NO_WORKER)
+    {
+        Deque& deque = *mDeques[home];
+        std::lock_guard lock(deque.mMutex);
+        if (! deque.mJobs.empty())
+        {
+            job = std::move(deque.mJobs.back());
+            deque.mJobs.pop_back();
+        }
+    }
+
+    // then everybody else's, oldest job: likely the root of the most work
+    if (! job && mQueued > 0)
+    {
+        size_t start = (home != NO_WORKER) ? home + 1 : mNextDeque.load();
+        for (size_t i = 0; i < count && ! job; ++i)
+        {
+            size_t victim = (start + i) % count;
+            if (victim == home)
+            {
+                continue;
+            }
+            Deque& deque = *mDeques[victim];
+            std::lock_guard lock(deque.mMutex);
+            if (! deque.mJobs.empty())
+            {
+                job = std::move(deque.mJobs.front());
+                deque.mJobs.pop_front();
+                ++mStealCount;
+            }
+        }
+    }
+
+    if (job)
+    {
+        --mQueued;
+    }
+    return job;
+}
+
+bool LL::JobSystem::runOneJob()
+{
+    JobPtr job = findJob(currentWorker());
+    if (! job)
+    {
+        return false;
+    }
+    execute(job);
+    return true;
+}
+
+void LL::JobSystem::execute(const JobPtr& job)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    ++mRunCount;
+    if (job->mWork)
+    {
+        Job* outer = sCurrentJob;
+        sCurrentJob = job.get();
+        try
+        {
+            job->mWork();
+        }
+        catch (...)
+        {
+            // As for WorkQueue: one job throwing mustn't take the worker
+            // down, and the job still counts as finished.
+            LOG_UNHANDLED_EXCEPTION(getName());
+        }
+        sCurrentJob = outer;
+        // release whatever the work captured
+        job->mWork = nullptr;
+    }
+    finish(job);
+}
+
+void LL::JobSystem::finish(const JobPtr& job)
+{
+    JobPtr current = job;
+    while (current && --current->mUnfinished == 0)
+    {
+        std::vector<JobPtr> dependents;
+        std::vector<Work> on_finish;
+        {
+            std::lock_guard lock(current->mMutex);
+            current->mFinished = true;
+            dependents.swap(current->mDependents);
+            on_finish.swap(current->mOnFinish);
+        }
+
+        for (const JobPtr& dependent: dependents)
+        {
+            submit(dependent);
+        }
+        for (const Work& work: on_finish)
+        {
+            work();
+        }
+
+        if (mWaiters > 0)
+        {
+            std::lock_guard lock(mWaitMutex);
+            mWaitCond.notify_all();
+        }
+
+        // the parent was waiting on this child
+        JobPtr parent = std::move(current->mParent);
+        current = std::move(parent);
+    }
+}
+
+void LL::JobSystem::wait(const JobPtr& job)
+{
+    if (job->mFinished)
+    {
+        return;
+    }
+
+    if (! LLCoros::getName().empty())
+    {
+        // On a coroutine of its own, let the thread's other coroutines carry
+        // on. The promise is shared because the finishing thread may still
+        // be inside set_value() when this coroutine resumes.
+        auto promise = std::make_shared<LLCoros::Promise<void>>();
+        auto future = LLCoros::getFuture(*promise);
+        onFinish(job, [promise]() { promise->set_value(); });
+        future.get();
+        return;
+    }
+
+    while (! job->mFinished)
+    {
+        if (runOneJob())
+        {
+            continue;
+        }
+
+        // Nothing to help with: sleep until some job finishes or is queued.
+        // finish() and schedule() check mWaiters after publishing, so the
+        // timeout is only a backstop.
+        ++mWaiters;
+        {
+            std::unique_lock lock(mWaitMutex);
+            mWaitCond.wait_for(lock, std::chrono::milliseconds(1),
+                               [this, &job]() { return job->mFinished || mQueued > 0; });
+        }
+        --mWaiters;
+    }
+}
+
+void LL::JobSystem::parallelFor(size_t count, const std::function<void(size_t)>& body, size_t grain)
+{
+    grain = std::max<size_t>(1, grain);
+    auto root = create(Work());
+    for (size_t begin = 0; begin < count; begin += grain)
+    {
+        size_t end = std::min(count, begin + grain);
+        spawn([&body, begin, end]()
+              {
+                  for (size_t i = begin; i < end; ++i)
+                  {
+                      body(i);
+                  }
+              },
+              root);
+    }
+    submit(root);
+    wait(root);
+}
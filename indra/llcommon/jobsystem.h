@@ -0,0 +1,183 @@
+/**
+ * @file   jobsystem.h
+ * @date   2024-06-12
+ * @brief  JobSystem is a ThreadPool whose workers also run fork/join jobs
+ *         from per-worker deques, stealing from each other when idle.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_JOBSYSTEM_H)
+#define LL_JOBSYSTEM_H
+
+#include "threadpool.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace LL
+{
+
+    /**
+     * JobSystem is a ThreadPool, so anything posted to its WorkQueue still
+     * runs on its threads as before. On top of that it runs Jobs: units of
+     * work that may have a parent, children and dependencies.
+     *
+     * - A Job is finished once its own work has run and every child created
+     *   under it has finished. That is the fork/join primitive: spawn
+     *   children from inside a job's work and the parent, and anything
+     *   depending on the parent, waits for all of them.
+     * - addDependency(after, before) keeps after from running until before
+     *   has finished. then() is shorthand for a continuation.
+     * - wait() blocks until a job has finished, running other jobs
+     *   meanwhile, so waiting inside a job can't starve the pool. Called from
+     *   a coroutine other than the thread's default one, wait() suspends
+     *   only that coroutine instead.
+     * - thenPostTo() hands a continuation to any WorkQueue, typically
+     *   "mainloop", when a job finishes.
+     *
+     * A job scheduled from one of this JobSystem's own threads goes on that
+     * thread's deque, where the owner takes the newest job first and thieves
+     * take the oldest. Jobs scheduled from other threads are dealt out over
+     * the deques round robin. Idle workers sleep in the WorkQueue and are
+     * woken by posting to it, so Jobs and plain WorkQueue posts share the
+     * same threads.
+     */
+    class JobSystem: public ThreadPool
+    {
+    private:
+        using super = ThreadPool;
+
+    public:
+        using Work = std::function<void()>;
+
+        class Job;
+        using JobPtr = std::shared_ptr<Job>;
+
+        /**
+         * threads is the compile-time default width, overridden by the
+         * "ThreadPoolSizes" setting just as for ThreadPool.
+         */
+        JobSystem(const std::string& name, size_t threads=1, bool auto_shutdown=true);
+        ~JobSystem() override;
+
+        void close() override;
+
+        /*------------------------- building jobs --------------------------*/
+
+        /**
+         * Create a job that runs work once submitted and once everything it
+         * depends on has finished. If parent is given, parent will not
+         * finish until this job has; parent must not have finished already,
+         * so create children from within the parent's work or before
+         * submitting the parent.
+         */
+        JobPtr create(Work work, const JobPtr& parent=JobPtr());
+
+        /**
+         * Don't run after until before has finished. Call before submitting
+         * after. If before has already finished this does nothing.
+         */
+        void addDependency(const JobPtr& after, const JobPtr& before);
+
+        /**
+         * Let job run as soon as its dependencies allow. Submit each job
+         * exactly once.
+         */
+        void submit(const JobPtr& job);
+
+        /**
+         * The job whose work is running on this thread, if any: pass it as
+         * the parent of children spawned from within that work.
+         */
+        static JobPtr getCurrent();
+
+        /// create() and submit() in one step
+        JobPtr spawn(Work work, const JobPtr& parent=JobPtr());
+
+        /// Create and submit a job that runs once before has finished.
+        JobPtr then(const JobPtr& before, Work work);
+
+        /**
+         * When job finishes, post work to target. If target no longer
+         * exists, or has closed, by then, work is dropped. Use this to bring
+         * results back to the main thread.
+         */
+        void thenPostTo(const JobPtr& job, WorkQueueBase::weak_t target, Work work);
+
+        /*---------------------------- waiting -----------------------------*/
+
+        static bool isFinished(const JobPtr& job);
+
+        /**
+         * Return once job has finished. On any thread's default coroutine
+         * this runs other jobs while it waits. On any other coroutine it
+         * suspends that coroutine until job finishes.
+         */
+        void wait(const JobPtr& job);
+
+        /**
+         * Call body(i) for each i in [0, count) in chunks of grain, and
+         * return when all have run. Chunks may run on any thread, including
+         * this one.
+         */
+        void parallelFor(size_t count, const std::function<void(size_t)>& body, size_t grain=1);
+
+        /*---------------------------- counters ----------------------------*/
+
+        /// jobs run since construction
+        U64 getRunCount() const { return mRunCount; }
+        /// jobs a thread took from a deque other than its own
+        U64 getStealCount() const { return mStealCount; }
+
+    protected:
+        void run() override;
+
+    private:
+        struct alignas(64) Deque
+        {
+            std::mutex mMutex;
+            std::deque<JobPtr> mJobs;
+        };
+
+        void schedule(const JobPtr& job);
+        void finish(const JobPtr& job);
+        void execute(const JobPtr& job);
+        void onFinish(const JobPtr& job, Work work);
+        JobPtr findJob(size_t home);
+        bool runOneJob();
+        void drain();
+        void kick();
+        size_t currentWorker() const;
+
+        // the job executing on this thread, innermost if wait() is nesting
+        static thread_local Job* sCurrentJob;
+
+        std::vector<std::unique_ptr<Deque>> mDeques;
+        std::atomic<size_t> mNextDeque{ 0 };
+        std::atomic<size_t> mNextWorker{ 0 };
+        // jobs sitting in deques
+        std::atomic<S64> mQueued{ 0 };
+        // threads inside drain(), and kicks posted but not yet running
+        std::atomic<S32> mDraining{ 0 };
+        std::atomic<S32> mKicks{ 0 };
+        std::atomic<U64> mRunCount{ 0 };
+        std::atomic<U64> mStealCount{ 0 };
+
+        // wait() on a default coroutine sleeps here when there is no job it
+        // can help with
+        std::mutex mWaitMutex;
+        std::condition_variable mWaitCond;
+        std::atomic<S32> mWaiters{ 0 };
+    };
+
+} // namespace LL
+
+#endif /* ! defined(LL_JOBSYSTEM_H) */
@@ -0,0 +1,498 @@
+/**
+ * @file lllockfreequeue.h
+ * @brief Bounded lock-free multi-producer, multi-consumer queue
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLLOCKFREEQUEUE_H
+#define LL_LLLOCKFREEQUEUE_H
+
+#include "llthreadsafequeue.h"      // LLThreadSafeQueueInterrupt
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+/*****************************************************************************
+*   LLLockFreeQueue
+*****************************************************************************/
+/**
+ * Drop-in alternative to LLThreadSafeQueue for queues that see many
+ * producers or consumers at once: push() and pop() on a queue that is
+ * neither full nor empty take no lock, so producers don't serialize on a
+ * mutex. The storage is a fixed ring of sequenced cells (Dmitry Vyukov's
+ * bounded MPMC queue).
+ *
+ * The public methods match LLThreadSafeQueue's, with these differences:
+ * - capacity is rounded up to a power of two, and the ring is allocated up
+ *   front, so keep it in proportion to the expected backlog;
+ * - there is no canPop() hook and no choice of underlying container: this
+ *   is strictly FIFO;
+ * - an element pushed concurrently with close() may still go in. Consumers
+ *   that have already seen done() won't see it; the destructor frees it.
+ *
+ * A consumer only blocks once the ring is empty, and a producer once it is
+ * full. They then park on a mutex and condition variable the other side
+ * only touches when it sees somebody parked. These are the same coroutine
+ * aware primitives LLThreadSafeQueue uses, so a coroutine blocking here
+ * lets the other coroutines on its thread run.
+ */
+template <typename ElementT>
+class LLLockFreeQueue
+{
+public:
+    typedef ElementT value_type;
+
+    LLLockFreeQueue(size_t capacity = 1024);
+    ~LLLockFreeQueue();
+
+    LLLockFreeQueue(const LLLockFreeQueue&) = delete;
+    LLLockFreeQueue& operator=(const LLLockFreeQueue&) = delete;
+
+    // Add an element to the queue (will block if the queue has reached
+    // capacity). Throws LLThreadSafeQueueInterrupt if the queue is closed
+    // before push is possible.
+    template <typename T>
+    void push(T&& element);
+
+    // Add an element to the queue (will block if the queue has reached
+    // capacity). Return false if the queue is closed before push is possible.
+    template <typename T>
+    bool pushIfOpen(T&& element);
+
+    // Try to add an element to the queue without blocking. Returns
+    // true only if the element was actually added.
+    template <typename T>
+    bool tryPush(T&& element);
+
+    // Try to add an element to the queue, blocking if full but with timeout
+    // after specified duration. Returns true if the element was added.
+    template <typename Rep, typename Period, typename T>
+    bool tryPushFor(const std::chrono::duration<Rep, Period>& timeout,
+                    T&& element);
+
+    // Try to add an element to the queue, blocking if full but with
+    // timeout at specified time_point. Returns true if the element was added.
+    template <typename Clock, typename Duration, typename T>
+    bool tryPushUntil(const std::chrono::time_point<Clock, Duration>& until,
+                      T&& element);
+
+    // Pop the element at the head of the queue (will block if the queue is
+    // empty). Throws LLThreadSafeQueueInterrupt once the queue is closed
+    // and drained.
+    ElementT pop();
+
+    // Pop an element from the head of the queue if there is one available.
+    // Returns true only if an element was popped.
+    bool tryPop(ElementT& element);
+
+    // Pop the element at the head of the queue, blocking if empty, with
+    // timeout after specified duration. Returns true if an element was popped.
+    template <typename Rep, typename Period>
+    bool tryPopFor(const std::chrono::duration<Rep, Period>& timeout, ElementT& element);
+
+    // Pop the element at the head of the queue, blocking if empty, with
+    // timeout at specified time_point. Returns true if an element was popped.
+    template <typename Clock, typename Duration>
+    bool tryPopUntil(const std::chrono::time_point<Clock, Duration>& until,
+                     ElementT& element);
+
+    // Returns the number of elements in the queue, which may be stale by
+    // the time the caller looks at it.
+    size_t size() const;
+
+    // Returns the capacity of the queue, after rounding.
+    U32 capacity() const { return (U32)(mMask + 1); }
+
+    // closes the queue, as LLThreadSafeQueue::close()
+    void close();
+
+    // producer end: are we prevented from pushing any additional items?
+    bool isClosed() const { return mClosed.load(); }
+    // consumer end: are we done, is the queue entirely drained?
+    bool done() const { return isClosed() && ! canPop(); }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> mSequence;
+        typename std::aligned_storage<sizeof(ElementT), alignof(ElementT)>::type mStorage;
+
+        ElementT* get() { return std::launder(reinterpret_cast<ElementT*>(&mStorage)); }
+    };
+
+    // Where one side sleeps when the ring is empty (consumers) or full
+    // (producers).
+    struct Parking
+    {
+        LLCoros::Mutex mMutex;
+        LLCoros::ConditionVariable mCond;
+        std::atomic<U32> mParked{ 0 };
+    };
+
+    enum result { DONE_OR_CLOSED, WOULD_BLOCK, OK };
+
+    template <typename T>
+    result push_(T&& element);
+    result pop_(ElementT& element);
+
+    bool canPush() const;
+    bool canPop() const;
+
+    // Sleep until ready() or until; returns false on timeout.
+    template <typename READY, typename Clock, typename Duration>
+    bool park(Parking& parking, READY&& ready,
+              const std::chrono::time_point<Clock, Duration>* until);
+    void unpark(Parking& parking);
+
+    std::unique_ptr<Cell[]> mCells;
+    size_t mMask;
+
+    // producers and consumers each hammer their own cache line
+    alignas(64) std::atomic<size_t> mEnqueuePos;
+    alignas(64) std::atomic<size_t> mDequeuePos;
+    alignas(64) std::atomic<bool> mClosed;
+
+    Parking mNotEmpty;
+    Parking mNotFull;
+};
+
+/*****************************************************************************
+*   LLLockFreeQueue implementation
+*****************************************************************************/
+template <typename ElementT>
+LLLockFreeQueue<ElementT>::LLLockFreeQueue(size_t capacity):
+    mEnqueuePos(0),
+    mDequeuePos(0),
+    mClosed(false)
+{
+    size_t size = 2;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    mMask = size - 1;
+    mCells.reset(new Cell[size]);
+    for (size_t i = 0; i < size; ++i)
+    {
+        mCells[i].mSequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename ElementT>
+LLLockFreeQueue<ElementT>::~LLLockFreeQueue()
+{
+    for (size_t pos = mDequeuePos.load(); pos != mEnqueuePos.load(); ++pos)
+    {
+        Cell& cell = mCells[pos & mMask];
+        if (cell.mSequence.load() == pos + 1)
+        {
+            cell.get()->~ElementT();
+        }
+    }
+}
+
+// A cell is free for the producer claiming position pos when its sequence
+// is pos, and holds the element for the consumer claiming pos when its
+// sequence is pos + 1. A consumer frees it for the next lap by setting it
+// to pos + capacity.
+template <typename ElementT>
+template <typename T>
+typename LLLockFreeQueue<ElementT>::result LLLockFreeQueue<ElementT>::push_(T&& element)
+{
+    if (mClosed.load(std::memory_order_relaxed))
+    {
+        return DONE_OR_CLOSED;
+    }
+
+    Cell* cell;
+    size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &mCells[pos & mMask];
+        size_t seq = cell->mSequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // the consumer of the previous lap hasn't got here yet
+            return WOULD_BLOCK;
+        }
+        else
+        {
+            // another producer claimed this position first
+            pos = mEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    new (&cell->mStorage) ElementT(std::forward<T>(element));
+    cell->mSequence.store(pos + 1, std::memory_order_release);
+    unpark(mNotEmpty);
+    return OK;
+}
+
+template <typename ElementT>
+typename LLLockFreeQueue<ElementT>::result LLLockFreeQueue<ElementT>::pop_(ElementT& element)
+{
+    Cell* cell;
+    size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &mCells[pos & mMask];
+        size_t seq = cell->mSequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0)
+        {
+            if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // On the consumer side, we always try to pop before checking
+            // mClosed so we can finish draining the queue.
+            return mClosed.load() ? DONE_OR_CLOSED : WOULD_BLOCK;
+        }
+        else
+        {
+            pos = mDequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    ElementT* stored = cell->get();
+    element = std::move(*stored);
+    stored->~ElementT();
+    cell->mSequence.store(pos + mMask + 1, std::memory_order_release);
+    unpark(mNotFull);
+    return OK;
+}
+
+template <typename ElementT>
+bool LLLockFreeQueue<ElementT>::canPush() const
+{
+    size_t pos = mEnqueuePos.load();
+    return (intptr_t)mCells[pos & mMask].mSequence.load() - (intptr_t)pos >= 0;
+}
+
+template <typename ElementT>
+bool LLLockFreeQueue<ElementT>::canPop() const
+{
+    size_t pos = mDequeuePos.load();
+    return (intptr_t)mCells[pos & mMask].mSequence.load() - (intptr_t)(pos + 1) >= 0;
+}
+
+template <typename ElementT>
+template <typename READY, typename Clock, typename Duration>
+bool LLLockFreeQueue<ElementT>::park(Parking& parking, READY&& ready,
+                                     const std::chrono::time_point<Clock, Duration>* until)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    LLCoros::LockType lock(parking.mMutex);
+    // Announce ourselves before looking at the ring one last time: the
+    // other side publishes before it looks at mParked, so one of us is
+    // bound to see the other.
+    ++parking.mParked;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool woken = true;
+    if (until)
+    {
+        woken = parking.mCond.wait_until(lock, *until, ready);
+    }
+    else
+    {
+        parking.mCond.wait(lock, ready);
+    }
+    --parking.mParked;
+    return woken;
+}
+
+template <typename ElementT>
+void LLLockFreeQueue<ElementT>::unpark(Parking& parking)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parking.mParked.load(std::memory_order_relaxed))
+    {
+        // Taking the lock means a waiter between its last check and its
+        // wait() can't miss this notification.
+        LLCoros::LockType lock(parking.mMutex);
+        parking.mCond.notify_one();
+    }
+}
+
+template <typename ElementT>
+template <typename T>
+bool LLLockFreeQueue<ElementT>::pushIfOpen(T&& element)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    for (;;)
+    {
+        result pushed = push_(std::forward<T>(element));
+        if (pushed != WOULD_BLOCK)
+        {
+            return pushed == OK;
+        }
+        // Storage full. Wait for a consumer.
+        park(mNotFull, [this]() { return isClosed() || canPush(); },
+             (const std::chrono::steady_clock::time_point*)nullptr);
+    }
+}
+
+template <typename ElementT>
+template <typename T>
+void LLLockFreeQueue<ElementT>::push(T&& element)
+{
+    if (! pushIfOpen(std::forward<T>(element)))
+    {
+        LLTHROW(LLThreadSafeQueueInterrupt());
+    }
+}
+
+template <typename ElementT>
+template <typename T>
+bool LLLockFreeQueue<ElementT>::tryPush(T&& element)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    return push_(std::forward<T>(element)) == OK;
+}
+
+template <typename ElementT>
+template <typename Rep, typename Period, typename T>
+bool LLLockFreeQueue<ElementT>::tryPushFor(const std::chrono::duration<Rep, Period>& timeout,
+                                           T&& element)
+{
+    // Convert duration to time_point: passing the same timeout duration to
+    // each of multiple calls is wrong.
+    return tryPushUntil(std::chrono::steady_clock::now() + timeout,
+                        std::forward<T>(element));
+}
+
+template <typename ElementT>
+template <typename Clock, typename Duration, typename T>
+bool LLLockFreeQueue<ElementT>::tryPushUntil(const std::chrono::time_point<Clock, Duration>& until,
+                                             T&& element)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    for (;;)
+    {
+        result pushed = push_(std::forward<T>(element));
+        if (pushed != WOULD_BLOCK)
+        {
+            return pushed == OK;
+        }
+        if (! park(mNotFull, [this]() { return isClosed() || canPush(); }, &until))
+        {
+            // timed out, but a consumer may have got in at the last moment
+            return push_(std::forward<T>(element)) == OK;
+        }
+    }
+}
+
+template <typename ElementT>
+ElementT LLLockFreeQueue<ElementT>::pop()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    ElementT value;
+    for (;;)
+    {
+        result popped = pop_(value);
+        if (popped == OK)
+        {
+            return value;
+        }
+        // Once the queue is DONE, there will never be any more coming.
+        if (popped == DONE_OR_CLOSED)
+        {
+            LLTHROW(LLThreadSafeQueueInterrupt());
+        }
+        park(mNotEmpty, [this]() { return isClosed() || canPop(); },
+             (const std::chrono::steady_clock::time_point*)nullptr);
+    }
+}
+
+template <typename ElementT>
+bool LLLockFreeQueue<ElementT>::tryPop(ElementT& element)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    return pop_(element) == OK;
+}
+
+template <typename ElementT>
+template <typename Rep, typename Period>
+bool LLLockFreeQueue<ElementT>::tryPopFor(const std::chrono::duration<Rep, Period>& timeout,
+                                          ElementT& element)
+{
+    return tryPopUntil(std::chrono::steady_clock::now() + timeout, element);
+}
+
+template <typename ElementT>
+template <typename Clock, typename Duration>
+bool LLLockFreeQueue<ElementT>::tryPopUntil(const std::chrono::time_point<Clock, Duration>& until,
+                                            ElementT& element)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    for (;;)
+    {
+        result popped = pop_(element);
+        if (popped != WOULD_BLOCK)
+        {
+            return popped == OK;
+        }
+        if (! park(mNotEmpty, [this]() { return isClosed() || canPop(); }, &until))
+        {
+            return pop_(element) == OK;
+        }
+    }
+}
+
+template <typename ElementT>
+size_t LLLockFreeQueue<ElementT>::size() const
+{
+    // read the head first: the tail can only have moved further ahead
+    size_t head = mDequeuePos.load();
+    size_t tail = mEnqueuePos.load();
+    return tail > head ? tail - head : 0;
+}
+
+template <typename ElementT>
+void LLLockFreeQueue<ElementT>::close()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_THREAD;
+    mClosed.store(true);
+    // wake everybody so pushers can fail and poppers can drain
+    for (Parking* parking : { &mNotEmpty, &mNotFull })
+    {
+        LLCoros::LockType lock(parking->mMutex);
+        parking->mCond.notify_all();
+    }
+}
+
+#endif // LL_LLLOCKFREEQUEUE_H
@@ -0,0 +1,452 @@
+/**
+ * @file   jobsystem_test.cpp
+ * @date   2024-06-12
+ * @brief  Stress and throughput tests for jobsystem.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "jobsystem.h"
+// STL headers
+// std headers
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "llcoros.h"
+#include "lleventcoro.h"
+#include "lltimer.h"
+#include "stringize.h"
+#include "workqueue.h"
+
+using namespace std::literals::chrono_literals; // ms suffix
+using JobPtr = LL::JobSystem::JobPtr;
+
+namespace
+{
+    // Fork/join the textbook way: each call spawns its halves as children
+    // and waits for them, which only works if waiting helps.
+    U64 fib(LL::JobSystem& jobs, U32 n)
+    {
+        if (n < 12)
+        {
+            return n < 2 ? n : fib(jobs, n - 1) + fib(jobs, n - 2);
+        }
+        U64 a = 0, b = 0;
+        auto parent = jobs.create(LL::JobSystem::Work());
+        jobs.spawn([&jobs, &a, n]() { a = fib(jobs, n - 1); }, parent);
+        jobs.spawn([&jobs, &b, n]() { b = fib(jobs, n - 2); }, parent);
+        jobs.submit(parent);
+        jobs.wait(parent);
+        return a + b;
+    }
+
+    U64 fib_serial(U32 n)
+    {
+        return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+    }
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct jobsystem_data
+    {
+        jobsystem_data():
+            jobs("jobsystem_test", 4)
+        {
+            jobs.start();
+        }
+
+        LL::JobSystem jobs;
+    };
+    typedef test_group<jobsystem_data> jobsystem_group;
+    typedef jobsystem_group::object object;
+    jobsystem_group jobsystemgrp("jobsystem");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("every job runs once");
+        const U32 count = 10000;
+        std::vector<std::atomic<U32>> runs(count);
+        for (auto& r: runs)
+        {
+            r = 0;
+        }
+
+        auto root = jobs.create(LL::JobSystem::Work());
+        for (U32 i = 0; i < count; ++i)
+        {
+            jobs.spawn([&runs, i]() { ++runs[i]; }, root);
+        }
+        jobs.submit(root);
+        jobs.wait(root);
+
+        ensure("root finished", LL::JobSystem::isFinished(root));
+        for (U32 i = 0; i < count; ++i)
+        {
+            ensure_equals(STRINGIZE("job " << i), runs[i].load(), 1U);
+        }
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("parent waits for children spawned by its work");
+        std::atomic<U32> children{ 0 };
+        U32 seen_by_continuation = 0;
+
+        auto parent = jobs.create(
+            [this, &children]()
+            {
+                // spawned from the parent's own work
+                JobPtr self = LL::JobSystem::getCurrent();
+                for (U32 i = 0; i < 100; ++i)
+                {
+                    jobs.spawn([&children]()
+                               {
+                                   std::this_thread::sleep_for(std::chrono::microseconds(50));
+                                   ++children;
+                               },
+                               self);
+                }
+            });
+        // children created under the parent before it runs
+        for (U32 i = 0; i < 50; ++i)
+        {
+            jobs.spawn([&children]()
+                       {
+                           std::this_thread::sleep_for(std::chrono::microseconds(50));
+                           ++children;
+                       },
+                       parent);
+        }
+        auto after = jobs.then(parent,
+                               [&children, &seen_by_continuation]()
+                               { seen_by_continuation = children; });
+        jobs.submit(parent);
+        jobs.wait(after);
+
+        ensure_equals("continuation saw every child", seen_by_continuation, 150U);
+        ensure("parent finished", LL::JobSystem::isFinished(parent));
+        ensure("no current job outside a job", ! LL::JobSystem::getCurrent());
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("dependencies order a diamond");
+        for (U32 pass = 0; pass < 200; ++pass)
+        {
+            std::atomic<U32> clock{ 0 };
+            U32 a = 0, b = 0, c = 0, d = 0;
+            auto ja = jobs.create([&]() { a = ++clock; });
+            auto jb = jobs.create([&]() { b = ++clock; });
+            auto jc = jobs.create([&]() { c = ++clock; });
+            auto jd = jobs.create([&]() { d = ++clock; });
+            jobs.addDependency(jb, ja);
+            jobs.addDependency(jc, ja);
+            jobs.addDependency(jd, jb);
+            jobs.addDependency(jd, jc);
+            // submit in the worst order
+            jobs.submit(jd);
+            jobs.submit(jc);
+            jobs.submit(jb);
+            ensure("nothing runs before its dependency", clock == 0);
+            jobs.submit(ja);
+            jobs.wait(jd);
+
+            ensure("a before b", a < b);
+            ensure("a before c", a < c);
+            ensure("b before d", b < d);
+            ensure("c before d", c < d);
+        }
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("wait inside jobs helps instead of deadlocking");
+        // one thread: every nested wait has to run the children itself
+        LL::JobSystem narrow("jobsystem_test_narrow", 1);
+        narrow.start();
+        U64 result = 0;
+        narrow.wait(narrow.spawn([&narrow, &result]() { result = fib(narrow, 22); }));
+        ensure_equals("fib on one thread", result, fib_serial(22));
+
+        result = fib(jobs, 25);
+        ensure_equals("fib on four threads", result, fib_serial(25));
+        ensure("somebody stole something", jobs.getStealCount() > 0);
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        set_test_name("thenPostTo hands the result to another queue");
+        auto mainloop = std::make_shared<LL::WorkQueue>("jobsystem_test_main");
+        std::thread::id ran_on;
+        std::atomic<bool> computed{ false };
+        bool delivered = false;
+
+        auto job = jobs.spawn([&computed]() { computed = true; });
+        jobs.thenPostTo(job, mainloop,
+                        [&ran_on, &delivered]()
+                        {
+                            ran_on = std::this_thread::get_id();
+                            delivered = true;
+                        });
+
+        LLTimer timer;
+        while (! delivered && timer.getElapsedTimeF32() < 10.f)
+        {
+            mainloop->runPending();
+            std::this_thread::sleep_for(1ms);
+        }
+        ensure("job ran", computed.load());
+        ensure("continuation delivered", delivered);
+        ensure("continuation ran on the queue's thread", ran_on == std::this_thread::get_id());
+
+        // a finished job hands over straight away
+        delivered = false;
+        jobs.thenPostTo(job, mainloop, [&delivered]() { delivered = true; });
+        mainloop->runPending();
+        ensure("late continuation delivered", delivered);
+    }
+
+    template<> template<>
+    void object::test<6>()
+    {
+        set_test_name("wait on a coroutine suspends only that coroutine");
+        std::atomic<bool> release{ false };
+        bool waited = false;
+
+        auto job = jobs.spawn([&release]()
+                              {
+                                  while (! release)
+                                  {
+                                      std::this_thread::sleep_for(1ms);
+                                  }
+                              });
+        LLCoros::instance().launch("jobsystem_test wait",
+                                   [this, job, &waited]()
+                                   {
+                                       jobs.wait(job);
+                                       waited = true;
+                                   });
+        // the coroutine is parked on the job, and we're still running
+        llcoro::suspend();
+        ensure("coroutine waiting", ! waited);
+        release = true;
+
+        LLTimer timer;
+        while (! waited && timer.getElapsedTimeF32() < 10.f)
+        {
+            llcoro::suspend();
+        }
+        ensure("coroutine resumed", waited);
+    }
+
+    template<> template<>
+    void object::test<7>()
+    {
+        set_test_name("a throwing job still finishes");
+        bool continued = false;
+        auto job = jobs.spawn([]() { throw std::runtime_error("jobsystem_test"); });
+        jobs.wait(jobs.then(job, [&continued]() { continued = true; }));
+        ensure("continuation ran", continued);
+    }
+
+    template<> template<>
+    void object::test<8>()
+    {
+        set_test_name("stress: many submitters, random graphs");
+        const U32 submitters = 4;
+        const U32 graphs = 300;
+        std::atomic<U64> ran{ 0 };
+        std::atomic<U64> expected{ 0 };
+        std::atomic<U32> misordered{ 0 };
+
+        std::vector<std::thread> threads;
+        for (U32 t = 0; t < submitters; ++t)
+        {
+            threads.emplace_back(
+                [this, t, &ran, &expected, &misordered]()
+                {
+                    std::mt19937 rng(t);
+                    for (U32 g = 0; g < graphs; ++g)
+                    {
+                        // a chain of layers, each layer depending on the one
+                        // before, each job forking a few children
+                        const U32 layers = 1 + rng() % 4;
+                        std::vector<JobPtr> previous;
+                        auto done = std::make_shared<std::vector<std::atomic<bool>>>(layers);
+                        JobPtr root = jobs.create(LL::JobSystem::Work());
+                        for (U32 l = 0; l < layers; ++l)
+                        {
+                            (*done)[l] = false;
+                            std::vector<JobPtr> layer;
+                            const U32 width = 1 + rng() % 6;
+                            for (U32 w = 0; w < width; ++w)
+                            {
+                                const U32 forks = rng() % 4;
+                                expected += 1 + forks;
+                                auto job = jobs.create(
+                                    [this, l, forks, done, &ran, &misordered]()
+                                    {
+                                        if (l > 0 && ! (*done)[l - 1])
+                                        {
+                                            ++misordered;
+                                        }
+                                        for (U32 f = 0; f < forks; ++f)
+                                        {
+                                            jobs.spawn([&ran]() { ++ran; });
+                                        }
+                                        ++ran;
+                                    },
+                                    root);
+                                for (const JobPtr& before: previous)
+                                {
+                                    jobs.addDependency(job, before);
+                                }
+                                layer.push_back(job);
+                            }
+                            // marks the layer done once all its jobs are
+                            auto marker = jobs.create([done, l]() { (*done)[l] = true; }, root);
+                            for (const JobPtr& job: layer)
+                            {
+                                jobs.addDependency(marker, job);
+                            }
+                            for (const JobPtr& job: layer)
+                            {
+                                jobs.submit(job);
+                            }
+                            jobs.submit(marker);
+                            previous = { marker };
+                        }
+                        jobs.submit(root);
+                        if (g % 16 == 0)
+                        {
+                            jobs.wait(root);
+                        }
+                    }
+                });
+        }
+        for (auto& thread: threads)
+        {
+            thread.join();
+        }
+
+        // forked jobs aren't children of anything: wait for the stragglers
+        LLTimer timer;
+        while (ran < expected && timer.getElapsedTimeF32() < 30.f)
+        {
+            std::this_thread::sleep_for(1ms);
+        }
+        ensure_equals("every job ran", ran.load(), expected.load());
+        ensure_equals("no layer ran early", misordered.load(), 0U);
+    }
+
+    template<> template<>
+    void object::test<9>()
+    {
+        set_test_name("throughput against a plain ThreadPool");
+        const U32 count = 200000;
+        const U32 grain = 64;
+        std::vector<U32> out(count);
+        auto body = [&out](size_t i)
+        {
+            U32 x = (U32)i;
+            for (U32 k = 0; k < 50; ++k)
+            {
+                x = x * 1664525u + 1013904223u;
+            }
+            out[i] = x;
+        };
+
+        // the existing way: post chunks to a pool, count them back in
+        LL::ThreadPool pool("jobsystem_test_pool", 4);
+        pool.start();
+        std::atomic<U32> chunks_left{ (count + grain - 1) / grain };
+        LLTimer timer;
+        for (U32 begin = 0; begin < count; begin += grain)
+        {
+            U32 end = llmin(count, begin + grain);
+            pool.getQueue().post([&body, &chunks_left, begin, end]()
+                                 {
+                                     for (U32 i = begin; i < end; ++i)
+                                     {
+                                         body(i);
+                                     }
+                                     --chunks_left;
+                                 });
+        }
+        while (chunks_left > 0)
+        {
+            std::this_thread::yield();
+        }
+        const F64 pool_ms = timer.getElapsedTimeF64() * 1000.0;
+        pool.close();
+        const U32 check = out[count - 1];
+
+        out.assign(count, 0);
+        timer.reset();
+        jobs.parallelFor(count, body, grain);
+        const F64 jobs_ms = timer.getElapsedTimeF64() * 1000.0;
+        ensure_equals("same results", out[count - 1], check);
+
+        const U64 runs_before = jobs.getRunCount();
+        timer.reset();
+        U64 result = fib(jobs, 27);
+        const F64 fib_ms = timer.getElapsedTimeF64() * 1000.0;
+        ensure_equals("fib", result, fib_serial(27));
+
+        LL_INFOS("Benchmark") << count << " items in chunks of " << grain << ": "
+            << pool_ms << " ms ThreadPool, " << jobs_ms << " ms JobSystem; fork/join fib(27) "
+            << fib_ms << " ms over " << (jobs.getRunCount() - runs_before) << " jobs, "
+            << jobs.getStealCount() << " steals" << LL_ENDL;
+    }
+
+    template<> template<>
+    void object::test<10>()
+    {
+        set_test_name("a plain post fans out with parallelFor");
+        // the viewer's "General" pool is a JobSystem: work posted to it the
+        // ThreadPool way may itself split up over the pool
+        std::vector<std::atomic<U32>> runs(1000);
+        for (auto& run : runs)
+        {
+            run = 0;
+        }
+        std::atomic<bool> done{ false };
+        jobs.getQueue().post([this, &runs, &done]()
+                             {
+                                 jobs.parallelFor(runs.size(),
+                                                  [&runs](size_t i) { ++runs[i]; },
+                                                  16);
+                                 done = true;
+                             });
+        LLTimer timer;
+        while (! done && timer.getElapsedTimeF32() < 10.f)
+        {
+            std::this_thread::yield();
+        }
+        ensure("posted work finished", done);
+        for (const auto& run : runs)
+        {
+            ensure_equals("each index ran once", run.load(), 1);
+        }
+    }
+} // namespace tut
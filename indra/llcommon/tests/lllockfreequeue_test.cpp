@@ -0,0 +1,350 @@
+/**
+ * @file   lllockfreequeue_test.cpp
+ * @brief  Tests and contention benchmark for LLLockFreeQueue.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "lllockfreequeue.h"
+// STL headers
+#include <string>
+#include <vector>
+// std headers
+#include <atomic>
+#include <chrono>
+#include <thread>
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "llthreadsafequeue.h"
+#include "lltimer.h"
+#include "stringize.h"
+#include "workqueue.h"
+
+using namespace std::literals::chrono_literals; // ms suffix
+using namespace std::literals::string_literals; // s suffix
+
+namespace
+{
+    // Each producer pushes (producer << 32) | sequence. Consumers check that
+    // every value arrives exactly once and each producer's values arrive in
+    // order, then report how long the whole exchange took.
+    template <typename QUEUE>
+    F64 exchange(QUEUE& queue, U32 producers, U32 consumers, U32 per_producer,
+                 std::string& error)
+    {
+        std::vector<std::vector<U32>> seen(consumers, std::vector<U32>(producers, 0));
+        std::atomic<U64> total{ 0 };
+        std::atomic<U32> misordered{ 0 };
+
+        LLTimer timer;
+        std::vector<std::thread> threads;
+        for (U32 c = 0; c < consumers; ++c)
+        {
+            threads.emplace_back(
+                [&queue, &seen, &total, &misordered, c]()
+                {
+                    std::vector<U32>& last = seen[c];
+                    try
+                    {
+                        for (;;)
+                        {
+                            U64 value = queue.pop();
+                            U32 producer = (U32)(value >> 32);
+                            U32 sequence = (U32)value;
+                            // one consumer can only see a producer's values
+                            // in increasing order
+                            if (sequence + 1 <= last[producer])
+                            {
+                                ++misordered;
+                            }
+                            last[producer] = sequence + 1;
+                            ++total;
+                        }
+                    }
+                    catch (const LLThreadSafeQueueInterrupt&)
+                    {
+                    }
+                });
+        }
+        std::vector<std::thread> pushers;
+        for (U32 p = 0; p < producers; ++p)
+        {
+            pushers.emplace_back(
+                [&queue, p, per_producer]()
+                {
+                    for (U32 i = 0; i < per_producer; ++i)
+                    {
+                        queue.push((U64(p) << 32) | i);
+                    }
+                });
+        }
+        for (auto& thread: pushers)
+        {
+            thread.join();
+        }
+        queue.close();
+        for (auto& thread: threads)
+        {
+            thread.join();
+        }
+        F64 ms = timer.getElapsedTimeF64() * 1000.0;
+
+        if (total != U64(producers) * per_producer)
+        {
+            error = STRINGIZE("received " << total << " of " << U64(producers) * per_producer);
+        }
+        else if (misordered)
+        {
+            error = STRINGIZE(misordered << " out of order");
+        }
+        return ms;
+    }
+
+    // As LLImageDecodeThread: producers post work to a WorkQueue that eight
+    // threads drain with runUntilClose(). Returns the time taken; ran is the
+    // number of work items that ran.
+    template <typename WORKQUEUE>
+    F64 fan_in(U32 producers, U32 per_producer, U32& ran)
+    {
+        WORKQUEUE queue("", 4096);
+        std::atomic<U32> count{ 0 };
+
+        LLTimer timer;
+        std::vector<std::thread> workers;
+        for (U32 w = 0; w < 8; ++w)
+        {
+            workers.emplace_back([&queue]() { queue.runUntilClose(); });
+        }
+        std::vector<std::thread> posters;
+        for (U32 p = 0; p < producers; ++p)
+        {
+            posters.emplace_back(
+                [&queue, &count, per_producer]()
+                {
+                    for (U32 i = 0; i < per_producer; ++i)
+                    {
+                        queue.post([&count]() { count.fetch_add(1, std::memory_order_relaxed); });
+                    }
+                });
+        }
+        for (std::thread& poster : posters)
+        {
+            poster.join();
+        }
+        queue.close();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+        ran = count.load();
+        return timer.getElapsedTimeF64() * 1000.0;
+    }
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct lllockfreequeue_data
+    {
+    };
+    typedef test_group<lllockfreequeue_data> lllockfreequeue_group;
+    typedef lllockfreequeue_group::object object;
+    lllockfreequeue_group lllockfreequeuegrp("lllockfreequeue");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("push, pop and close");
+        LLLockFreeQueue<std::string> queue(3);
+        ensure_equals("capacity rounds up", queue.capacity(), 4U);
+
+        queue.push("abc"s);
+        ensure("tryPush", queue.tryPush("def"s));
+        ensure("pushIfOpen", queue.pushIfOpen("ghi"s));
+        ensure("tryPush", queue.tryPush("jkl"s));
+        ensure("full", ! queue.tryPush("mno"s));
+        ensure_equals("size", queue.size(), 4U);
+
+        ensure_equals("first", queue.pop(), "abc"s);
+        std::string s;
+        ensure("tryPop", queue.tryPop(s));
+        ensure_equals("second", s, "def"s);
+        ensure("room again", queue.tryPush("mno"s));
+
+        queue.close();
+        ensure("closed", queue.isClosed());
+        ensure("not done", ! queue.done());
+        ensure("tryPush after close", ! queue.tryPush("pqr"s));
+        ensure("pushIfOpen after close", ! queue.pushIfOpen("pqr"s));
+        bool threw = false;
+        try
+        {
+            queue.push("pqr"s);
+        }
+        catch (const LLThreadSafeQueueInterrupt&)
+        {
+            threw = true;
+        }
+        ensure("push after close throws", threw);
+
+        // drains after close
+        ensure_equals("third", queue.pop(), "ghi"s);
+        ensure("tryPopFor", queue.tryPopFor(1s, s));
+        ensure_equals("fourth", s, "jkl"s);
+        ensure_equals("fifth", queue.pop(), "mno"s);
+        ensure("done", queue.done());
+        ensure("tryPop when done", ! queue.tryPop(s));
+        threw = false;
+        try
+        {
+            queue.pop();
+        }
+        catch (const LLThreadSafeQueueInterrupt&)
+        {
+            threw = true;
+        }
+        ensure("pop when done throws", threw);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("timeouts");
+        LLLockFreeQueue<U32> queue(2);
+        U32 value = 0;
+        auto start = std::chrono::steady_clock::now();
+        ensure("tryPopFor on empty", ! queue.tryPopFor(20ms, value));
+        ensure("waited for the timeout", std::chrono::steady_clock::now() - start >= 20ms);
+
+        queue.push(1);
+        queue.push(2);
+        start = std::chrono::steady_clock::now();
+        ensure("tryPushFor on full", ! queue.tryPushFor(20ms, 3));
+        ensure("waited for the timeout", std::chrono::steady_clock::now() - start >= 20ms);
+        ensure("tryPopUntil", queue.tryPopUntil(std::chrono::steady_clock::now() + 20ms, value));
+        ensure_equals("oldest first", value, 1U);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("parked threads wake on push, pop and close");
+        LLLockFreeQueue<U32> queue(2);
+        std::atomic<U32> popped{ 0 };
+        std::atomic<bool> interrupted{ false };
+        std::thread consumer([&]()
+                             {
+                                 try
+                                 {
+                                     for (;;)
+                                     {
+                                         popped += queue.pop();
+                                     }
+                                 }
+                                 catch (const LLThreadSafeQueueInterrupt&)
+                                 {
+                                     interrupted = true;
+                                 }
+                             });
+        // give the consumer time to park on the empty ring
+        std::this_thread::sleep_for(20ms);
+        queue.push(5);
+        LLTimer timer;
+        while (popped != 5 && timer.getElapsedTimeF32() < 10.f)
+        {
+            std::this_thread::sleep_for(1ms);
+        }
+        ensure_equals("consumer woke for push", popped.load(), 5U);
+
+        queue.close();
+        consumer.join();
+        ensure("consumer woke for close", interrupted.load());
+
+        // a producer parked on a full ring
+        LLLockFreeQueue<U32> full(2);
+        full.push(1);
+        full.push(2);
+        std::atomic<bool> pushed{ false };
+        std::thread producer([&]() { full.push(3); pushed = true; });
+        std::this_thread::sleep_for(20ms);
+        ensure("producer parked", ! pushed);
+        ensure_equals("pop", full.pop(), 1U);
+        producer.join();
+        ensure("producer woke for pop", pushed.load());
+        ensure_equals("size", full.size(), 2U);
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("many producers, many consumers");
+        for (U32 producers : { 1U, 3U, 8U })
+        {
+            for (U32 consumers : { 1U, 4U })
+            {
+                // small ring so both sides park often
+                LLLockFreeQueue<U64> queue(16);
+                std::string error;
+                exchange(queue, producers, consumers, 20000, error);
+                ensure(STRINGIZE(producers << " producers, " << consumers << " consumers: " << error),
+                       error.empty());
+            }
+        }
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        set_test_name("contention against LLThreadSafeQueue");
+        const U32 items = 400000;
+        const U32 consumers = 4;
+        std::ostringstream report;
+        report << "producers  LLThreadSafeQueue  LLLockFreeQueue (ms, " << items
+               << " items, " << consumers << " consumers)";
+        for (U32 producers : { 1U, 2U, 4U, 8U, 16U })
+        {
+            const U32 per_producer = items / producers;
+            std::string error;
+
+            LLThreadSafeQueue<U64> locked(4096);
+            F64 locked_ms = exchange(locked, producers, consumers, per_producer, error);
+            ensure(STRINGIZE("LLThreadSafeQueue " << producers << ": " << error), error.empty());
+
+            LLLockFreeQueue<U64> lockfree(4096);
+            F64 lockfree_ms = exchange(lockfree, producers, consumers, per_producer, error);
+            ensure(STRINGIZE("LLLockFreeQueue " << producers << ": " << error), error.empty());
+
+            report << "\n" << producers << "  " << locked_ms << "  " << lockfree_ms;
+        }
+        LL_INFOS("Benchmark") << report.str() << LL_ENDL;
+    }
+
+    template<> template<>
+    void object::test<6>()
+    {
+        set_test_name("image decode fan-in through WorkQueue and LockFreeWorkQueue");
+        const U32 items = 200000;
+        std::ostringstream report;
+        report << "producers  WorkQueue  LockFreeWorkQueue (ms, " << items
+               << " work items, 8 worker threads)";
+        for (U32 producers : { 1U, 4U, 16U })
+        {
+            const U32 per_producer = items / producers;
+            U32 ran = 0;
+            F64 locked_ms = fan_in<LL::WorkQueue>(producers, per_producer, ran);
+            ensure_equals(STRINGIZE("WorkQueue " << producers), ran, per_producer * producers);
+            F64 lockfree_ms = fan_in<LL::LockFreeWorkQueue>(producers, per_producer, ran);
+            ensure_equals(STRINGIZE("LockFreeWorkQueue " << producers), ran, per_producer * producers);
+            report << "\n" << producers << "  " << locked_ms << "  " << lockfree_ms;
+        }
+        LL_INFOS("Benchmark") << report.str() << LL_ENDL;
+    }
+} // namespace tut
@@ -135,6 +135,8 @@ namespace LL
 
     /// ThreadPool is shorthand for using the simpler WorkQueue
     using ThreadPool = ThreadPoolUsing<WorkQueue>;
+    /// for pools fed by many threads at once, with a bounded backlog
+    using LockFreeThreadPool = ThreadPoolUsing<LockFreeWorkQueue>;
 
 } // namespace LL
 
@@ -20,6 +20,7 @@ namespace LL
     struct ThreadPoolUsing;
 
     using ThreadPool = ThreadPoolUsing<WorkQueue>;
+    using LockFreeThreadPool = ThreadPoolUsing<LockFreeWorkQueue>;
 } // namespace LL
 
 #endif /* ! defined(LL_THREADPOOL_FWD_H) */
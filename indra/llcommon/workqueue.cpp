@@ -181,6 +181,55 @@ bool LL::WorkQueue::tryPop_(Work& work)
     return mQueue.tryPop(work);
 }
 
+/*****************************************************************************
+*   LockFreeWorkQueue
+*****************************************************************************/
+LL::LockFreeWorkQueue::LockFreeWorkQueue(const std::string& name, size_t capacity):
+    super(name),
+    mQueue(capacity)
+{
+}
+
+void LL::LockFreeWorkQueue::close()
+{
+    mQueue.close();
+}
+
+size_t LL::LockFreeWorkQueue::size()
+{
+    return mQueue.size();
+}
+
+bool LL::LockFreeWorkQueue::isClosed()
+{
+    return mQueue.isClosed();
+}
+
+bool LL::LockFreeWorkQueue::done()
+{
+    return mQueue.done();
+}
+
+bool LL::LockFreeWorkQueue::post(const Work& callable)
+{
+    return mQueue.pushIfOpen(callable);
+}
+
+bool LL::LockFreeWorkQueue::tryPost(const Work& callable)
+{
+    return mQueue.tryPush(callable);
+}
+
+LL::LockFreeWorkQueue::Work LL::LockFreeWorkQueue::pop_()
+{
+    return mQueue.pop();
+}
+
+bool LL::LockFreeWorkQueue::tryPop_(Work& work)
+{
+    return mQueue.tryPop(work);
+}
+
 /*****************************************************************************
 *   WorkSchedule
 *****************************************************************************/
@@ -16,6 +16,7 @@
 #include "llexception.h"
 #include "llinstancetracker.h"
 #include "llinstancetrackersubclass.h"
+#include "lllockfreequeue.h"
 #include "threadsafeschedule.h"
 #include <chrono>
 #include <exception>                // std::current_exception
@@ -262,6 +263,40 @@ namespace LL
         bool tryPop_(Work&) override;
     };
 
+/*****************************************************************************
+*   LockFreeWorkQueue: WorkQueue on an LLLockFreeQueue
+*****************************************************************************/
+    /**
+     * Same as WorkQueue, but posting and popping take no lock while the
+     * queue is neither empty nor full, for queues that many threads feed or
+     * drain at once. The capacity is allocated up front, and post() blocks
+     * while the queue is full, so keep it to a queue whose backlog is
+     * bounded and that the main thread does not post to.
+     */
+    class LockFreeWorkQueue: public LLInstanceTrackerSubclass<LockFreeWorkQueue, WorkQueueBase>
+    {
+    private:
+        using super = LLInstanceTrackerSubclass<LockFreeWorkQueue, WorkQueueBase>;
+
+    public:
+        LockFreeWorkQueue(const std::string& name = std::string(), size_t capacity=1024);
+
+        void close() override;
+        size_t size() override;
+        bool isClosed() override;
+        bool done() override;
+
+        bool post(const Work&) override;
+        bool tryPost(const Work&) override;
+
+    private:
+        using Queue = LLLockFreeQueue<Work>;
+        Queue mQueue;
+
+        Work pop_() override;
+        bool tryPop_(Work&) override;
+    };
+
 /*****************************************************************************
 *   WorkSchedule: add support for timestamped tasks
 *****************************************************************************/
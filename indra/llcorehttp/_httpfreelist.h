@@ -0,0 +1,126 @@
+/**
+ * @file _httpfreelist.h
+ * @brief Internal declarations for a bounded, thread-safe free list
+ *
+ * $LicenseInfo:firstyear=2012&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2012, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef _LLCORE_HTTP_FREELIST_H_
+#define _LLCORE_HTTP_FREELIST_H_
+
+
+#include <vector>
+
+#include "_mutex.h"
+
+
+namespace LLCoreInt
+{
+
+/// Bounded stack of released objects waiting to be handed out
+/// again.  Objects are typically released on the main thread
+/// (when a response is dropped) and reacquired on the worker
+/// thread (when the next response is built), so the list is
+/// guarded by a mutex.  The critical sections are a push_back
+/// or pop_back on a pre-reserved vector which keeps contention
+/// well below that of the general-purpose heap.
+///
+/// The list never allocates objects itself.  Callers try
+/// pop() first and fall back to their own allocation when
+/// it returns NULL.  When push() returns false the list is
+/// full and the caller must dispose of the object itself.
+///
+/// Threading:  thread-safe
+///
+/// Allocation:  Typically a function-local static so that
+/// it outlives the HttpService thread.  Objects still held
+/// when the list is destroyed are handed to the Disposer.
+///
+template <typename T, typename Disposer>
+class HttpFreeList
+{
+public:
+    explicit HttpFreeList(size_t max_count)
+        : mMaxCount(max_count)
+        {
+            mFree.reserve(max_count);
+        }
+
+    ~HttpFreeList()
+        {
+            Disposer dispose;
+            for (T * obj : mFree)
+            {
+                dispose(obj);
+            }
+            mFree.clear();
+        }
+
+    HttpFreeList(const HttpFreeList &) = delete;                // Not defined
+    void operator=(const HttpFreeList &) = delete;              // Not defined
+
+public:
+    /// @return         Previously released object or NULL if
+    ///                 none is available.
+    T * pop()
+        {
+            HttpScopedLock lock(mMutex);
+
+            if (mFree.empty())
+            {
+                return NULL;
+            }
+            T * obj(mFree.back());
+            mFree.pop_back();
+            return obj;
+        }
+
+    /// @return         True if the object was retained by the
+    ///                 list, false if the list is at capacity.
+    bool push(T * obj)
+        {
+            HttpScopedLock lock(mMutex);
+
+            if (mFree.size() >= mMaxCount)
+            {
+                return false;
+            }
+            mFree.push_back(obj);
+            return true;
+        }
+
+    size_t size()
+        {
+            HttpScopedLock lock(mMutex);
+
+            return mFree.size();
+        }
+
+protected:
+    const size_t        mMaxCount;
+    std::vector<T *>    mFree;
+    HttpMutex           mMutex;
+};  // end class HttpFreeList
+
+}  // end namespace LLCoreInt
+
+#endif  // _LLCORE_HTTP_FREELIST_H_
@@ -120,7 +120,7 @@ void HttpOperation::visitNotifier(HttpRequest *)
 {
     if (mUserHandler)
     {
-        HttpResponse * response = new HttpResponse();
+        HttpResponse * response = HttpResponse::alloc();
 
         response->setStatus(mStatus);
         mUserHandler->onCompleted(getHandle(), response);
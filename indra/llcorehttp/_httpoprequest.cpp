@@ -258,7 +258,7 @@ void HttpOpRequest::visitNotifier(HttpRequest * request)
     LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
     if (mUserHandler)
     {
-        HttpResponse * response = new HttpResponse();
+        HttpResponse * response = HttpResponse::alloc();
         response->setStatus(mStatus);
         response->setBody(mReplyBody);
         response->setHeaders(mReplyHeaders);
@@ -957,7 +957,7 @@ size_t HttpOpRequest::headerCallback(void * data, size_t size, size_t nmemb, voi
         // Save headers in response
         if (! op->mReplyHeaders)
         {
-            op->mReplyHeaders = std::make_shared<HttpHeaders>();
+            op->mReplyHeaders = HttpHeaders::alloc();
         }
         op->mReplyHeaders->append(name, value ? value : "");
     }
@@ -65,6 +65,11 @@ class RefCounted
     virtual ~RefCounted() = default;
     virtual void destroySelf();
 
+    // For classes that recycle themselves in destroySelf() rather
+    // than deleting.  Restores the implicit reference given to a
+    // newly-constructed object.
+    void revive() const;
+
 private:
     mutable LLAtomicS32         mRefCount;
 
@@ -116,6 +121,13 @@ inline void RefCounted::noRef() const
 }
 
 
+inline void RefCounted::revive() const
+{
+    llassert_always(0 == mRefCount);
+    mRefCount = 1;
+}
+
+
 inline void RefCounted::destroySelf()
 {
     delete this;
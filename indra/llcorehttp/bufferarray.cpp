@@ -25,9 +25,12 @@
  */
 
 #include "bufferarray.h"
+#include "httpstats.h"
 #include "llexception.h"
 #include "llmemory.h"
 
+#include "_httpfreelist.h"
+
 
 // BufferArray is a list of chunks, each a BufferArray::Block, of contiguous
 // data presented as a single array.  Chunks are at least BufferArray::BLOCK_ALLOC_SIZE
@@ -40,6 +43,14 @@
 // all take position arguments.  Single write/shared read isn't supported
 // directly and any such attempts have to be serialized outside of this
 // implementation.
+//
+// Blocks are recycled through a set of size-classed free lists.  Response
+// bodies are filled on the HttpService thread and released on the main
+// thread so, without the lists, every block was a cross-thread malloc/free
+// pair.  The first block of an array is sized to the smallest class that
+// holds the initial append so that small capability replies don't pin a
+// full BLOCK_ALLOC_SIZE block.  Requests larger than BLOCK_ALLOC_SIZE
+// (only possible through appendBufferAlloc()) bypass the lists.
 
 namespace LLCore
 {
@@ -68,9 +79,18 @@ class BufferArray::Block
     void * operator new(size_t len, size_t addl_len);
 
 public:
-    // Only public entry to get a block.
+    // Only public entry to get a block.  Block may be recycled
+    // and its contents are undefined.
     static Block * alloc(size_t len);
 
+    // Only public entry to dispose of a block.  Returns it to
+    // its free list when there is room.
+    static void recycle(Block * block);
+
+    // Smallest pooled size that can hold 'len' bytes, clamped
+    // to BLOCK_ALLOC_SIZE.
+    static size_t sizeClassFor(size_t len);
+
 public:
     size_t mUsed;
     size_t mAlloced;
@@ -82,6 +102,70 @@ class BufferArray::Block
 };
 
 
+// ==================================
+// Block free lists
+// ==================================
+
+namespace
+{
+
+struct BlockDisposer
+{
+    void operator()(BufferArray::Block * block) const
+        {
+            delete block;
+        }
+};
+
+typedef LLCoreInt::HttpFreeList<BufferArray::Block, BlockDisposer> BlockFreeList;
+
+const int BLOCK_SIZE_CLASS_COUNT = 3;
+
+const size_t BLOCK_SIZE_CLASSES[BLOCK_SIZE_CLASS_COUNT] =
+{
+    4096,
+    16384,
+    BufferArray::BLOCK_ALLOC_SIZE
+};
+
+// Retained blocks per class.  Bounds idle memory to roughly
+// 1MB + 2MB + 4MB.
+const size_t BLOCK_POOL_LIMITS[BLOCK_SIZE_CLASS_COUNT] =
+{
+    256,
+    128,
+    64
+};
+
+int size_class_index(size_t len)
+{
+    for (int i(0); i < BLOCK_SIZE_CLASS_COUNT; ++i)
+    {
+        if (len == BLOCK_SIZE_CLASSES[i])
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+BlockFreeList & block_free_list(int index)
+{
+    // Function-local so that the lists outlive any static
+    // BufferArray that might be released during shutdown.
+    static BlockFreeList lists[BLOCK_SIZE_CLASS_COUNT] =
+    {
+        BlockFreeList(BLOCK_POOL_LIMITS[0]),
+        BlockFreeList(BLOCK_POOL_LIMITS[1]),
+        BlockFreeList(BLOCK_POOL_LIMITS[2])
+    };
+
+    return lists[index];
+}
+
+}  // end anonymous namespace
+
+
 // ==================================
 // BufferArray Definitions
 // ==================================
@@ -103,7 +187,7 @@ BufferArray::~BufferArray()
          it != mBlocks.end();
          ++it)
     {
-        delete *it;
+        Block::recycle(*it);
         *it = NULL;
     }
     mBlocks.clear();
@@ -133,10 +217,13 @@ size_t BufferArray::append(const void * src, size_t len)
         }
     }
 
-    // Then get new blocks as needed
+    // Then get new blocks as needed.  Only the first block is
+    // sized to the data, later ones are assumed to be part of
+    // a large transfer.
     while (len)
     {
-        const size_t copy_len((std::min)(len, BLOCK_ALLOC_SIZE));
+        const size_t block_len(mBlocks.empty() ? Block::sizeClassFor(len) : BLOCK_ALLOC_SIZE);
+        const size_t copy_len((std::min)(len, block_len));
 
         if (mBlocks.size() >= mBlocks.capacity())
         {
@@ -145,7 +232,7 @@ size_t BufferArray::append(const void * src, size_t len)
         Block * block;
         try
         {
-            block = Block::alloc(BLOCK_ALLOC_SIZE);
+            block = Block::alloc(block_len);
         }
         catch (const std::bad_alloc&)
         {
@@ -177,6 +264,7 @@ void * BufferArray::appendBufferAlloc(size_t len)
         mBlocks.reserve(mBlocks.size() + 5);
     }
     Block * block = Block::alloc((std::max)(BLOCK_ALLOC_SIZE, len));
+    memset(block->mData, 0, len);
     block->mUsed = len;
     mBlocks.push_back(block);
     mLen += len;
@@ -326,9 +414,7 @@ bool BufferArray::getBlockStartEnd(int block, const char ** start, const char **
 BufferArray::Block::Block(size_t len)
     : mUsed(0),
       mAlloced(len)
-{
-    memset(mData, 0, len);
-}
+{}
 
 
 BufferArray::Block::~Block()
@@ -360,9 +446,45 @@ void BufferArray::Block::operator delete(void * mem, size_t)
 
 BufferArray::Block * BufferArray::Block::alloc(size_t len)
 {
+    const int index(size_class_index(len));
+    if (index >= 0)
+    {
+        Block * block = block_free_list(index).pop();
+        if (block)
+        {
+            HTTPStats::instance().recordAllocation(true);
+            block->mUsed = 0;
+            return block;
+        }
+    }
+
+    HTTPStats::instance().recordAllocation(false);
     Block * block = new (len) Block(len);
     return block;
 }
 
 
+void BufferArray::Block::recycle(Block * block)
+{
+    const int index(size_class_index(block->mAlloced));
+    if (index < 0 || ! block_free_list(index).push(block))
+    {
+        delete block;
+    }
+}
+
+
+size_t BufferArray::Block::sizeClassFor(size_t len)
+{
+    for (int i(0); i < BLOCK_SIZE_CLASS_COUNT; ++i)
+    {
+        if (len <= BLOCK_SIZE_CLASSES[i])
+        {
+            return BLOCK_SIZE_CLASSES[i];
+        }
+    }
+    return BLOCK_ALLOC_SIZE;
+}
+
+
 }  // end namespace LLCore
@@ -126,8 +126,12 @@ class BufferArray final : public LLCoreInt::RefCounted
 
     bool getBlockStartEnd(int block, const char ** start, const char ** end);
 
-protected:
+public:
+    // Opaque outside of the implementation.  Public only so that
+    // the block free lists in bufferarray.cpp can name it.
     class Block;
+
+protected:
     typedef std::vector<Block *> container_t;
 
     container_t         mBlocks;
@@ -25,13 +25,62 @@
  */
 
 #include "httpheaders.h"
+#include "httpstats.h"
 
 #include "llstring.h"
 
+#include "_httpfreelist.h"
+
 
 namespace LLCore
 {
 
+namespace
+{
+
+struct HeadersDisposer
+{
+    void operator()(HttpHeaders * headers) const
+        {
+            delete headers;
+        }
+};
+
+typedef LLCoreInt::HttpFreeList<HttpHeaders, HeadersDisposer> HeadersFreeList;
+
+const size_t HEADERS_POOL_LIMIT = 64;
+
+HeadersFreeList & headers_free_list()
+{
+    static HeadersFreeList list(HEADERS_POOL_LIMIT);
+
+    return list;
+}
+
+void recycle_headers(HttpHeaders * headers)
+{
+    headers->clear();
+    if (! headers_free_list().push(headers))
+    {
+        delete headers;
+    }
+}
+
+}  // end anonymous namespace
+
+
+// static
+HttpHeaders::ptr_t HttpHeaders::alloc()
+{
+    HttpHeaders * headers(headers_free_list().pop());
+    HTTPStats::instance().recordAllocation(NULL != headers);
+    if (! headers)
+    {
+        headers = new HttpHeaders();
+    }
+    return ptr_t(headers, recycle_headers);
+}
+
 
 void
 HttpHeaders::clear()
@@ -100,6 +100,12 @@ class HttpHeaders: private boost::noncopyable
     HttpHeaders(const HttpHeaders &) = delete;          // Not defined
     void operator=(const HttpHeaders &) = delete;       // Not defined
 
+    // Get an empty instance, recycled when one is available.
+    // When the last reference is dropped the instance is cleared
+    // and returned to a free list instead of being deleted.  Used
+    // by the library for response headers.
+    static ptr_t alloc();
+
 public:
     // Empty the list of headers.
     void clear();
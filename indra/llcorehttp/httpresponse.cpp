@@ -27,11 +27,41 @@
 #include "httpresponse.h"
 #include "bufferarray.h"
 #include "httpheaders.h"
+#include "httpstats.h"
+
+#include "_httpfreelist.h"
 
 
 namespace LLCore
 {
 
+struct HttpResponse::Disposer
+{
+    void operator()(HttpResponse * response) const
+        {
+            delete response;
+        }
+};
+
+
+namespace
+{
+
+typedef LLCoreInt::HttpFreeList<HttpResponse, HttpResponse::Disposer> ResponseFreeList;
+
+// Responses are usually released within the handler callback
+// so only a handful are ever outstanding.
+const size_t RESPONSE_POOL_LIMIT = 64;
+
+ResponseFreeList & response_free_list()
+{
+    static ResponseFreeList list(RESPONSE_POOL_LIMIT);
+
+    return list;
+}
+
+}  // end anonymous namespace
+
 
 HttpResponse::HttpResponse()
     : LLCoreInt::RefCounted(true),
@@ -42,7 +72,8 @@ HttpResponse::HttpResponse()
       mHeaders(),
       mRetries(0U),
       m503Retries(0U),
-      mRequestUrl()
+      mRequestUrl(),
+      mRequestId(0)
 {}
 
 
@@ -53,6 +84,50 @@ HttpResponse::~HttpResponse()
 }
 
 
+// static
+HttpResponse * HttpResponse::alloc()
+{
+    HttpResponse * response(response_free_list().pop());
+    if (response)
+    {
+        HTTPStats::instance().recordAllocation(true);
+        response->revive();
+        return response;
+    }
+
+    HTTPStats::instance().recordAllocation(false);
+    return new HttpResponse();
+}
+
+
+void HttpResponse::destroySelf()
+{
+    reset();
+    if (! response_free_list().push(this))
+    {
+        delete this;
+    }
+}
+
+
+void HttpResponse::reset()
+{
+    mStatus = HttpStatus();
+    mReplyOffset = 0U;
+    mReplyLength = 0U;
+    mReplyFullLength = 0U;
+    setBody(NULL);
+    mHeaders.reset();
+    mContentType.clear();
+    mRetries = 0U;
+    m503Retries = 0U;
+    mRequestUrl.clear();
+    mRequestMethod.clear();
+    mStats.reset();
+    mRequestId = 0;
+}
+
+
 void HttpResponse::setBody(BufferArray * ba)
 {
     if (mBufferArray == ba)
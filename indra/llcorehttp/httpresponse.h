@@ -55,16 +55,32 @@ class HttpHeaders;
 /// Threading:  Not intrinsically thread-safe.
 ///
 /// Allocation:  Refcounted, heap only.  Caller of the constructor
-/// is given a refcount.
+/// or of @see alloc() is given a refcount.  On final release the
+/// instance is cleared and kept on a free list for reuse by the
+/// library.
 ///
 class HttpResponse final : public LLCoreInt::RefCounted
 {
 public:
     HttpResponse();
 
+    /// Preferred way for the library to get a response.  Returns
+    /// a recycled instance when one is available.
+    static HttpResponse * alloc();
+
+    /// Deletes instances evicted from the free list.
+    struct Disposer;
+
 protected:
     virtual ~HttpResponse();                            // Use release()
 
+    // Returns the instance to the free list.
+    void destroySelf() override;
+
+    // Return instance to the freshly-constructed state, dropping
+    // references to body, headers and stats.
+    void reset();
+
     HttpResponse(const HttpResponse &) = delete;                    // Not defined
     void operator=(const HttpResponse &) = delete;              // Not defined
 
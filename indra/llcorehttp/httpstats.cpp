@@ -41,6 +41,8 @@ void HTTPStats::resetStats()
     mDataDown.reset();
     mDataUp.reset();
     mRequests = 0;
+    mAllocations = 0;
+    mRecycled = 0;
 }
 
 
@@ -89,6 +91,7 @@ void HTTPStats::dumpStats()
     out << "Data Sent: " << byte_count_converter(mDataUp.getSum()) << "   (" << mDataUp.getSum() << ")" << std::endl;
     out << "Data Recv: " << byte_count_converter(mDataDown.getSum()) << "   (" << mDataDown.getSum() << ")" << std::endl;
     out << "Total requests: " << mRequests << "(request objects created)" << std::endl;
+    out << "Heap allocations: " << mAllocations << "   Recycled: " << mRecycled << std::endl;
     out << std::endl;
     out << "Result Codes:" << std::endl << "--- -----" << std::endl;
 
@@ -33,6 +33,8 @@
 #include "llsingleton.h"
 #include "llsd.h"
 
+#include <atomic>
+
 namespace LLCore
 {
     class HTTPStats final : public LLSingleton<HTTPStats>
@@ -59,6 +61,21 @@ namespace LLCore
 
         void    recordResultCode(S32 code);
 
+        /// Called by the pooled allocators (BufferArray blocks,
+        /// HttpResponse and HttpHeaders).  'recycled' is true when
+        /// the object came from a free list rather than the heap.
+        /// May be called from any thread.
+        void    recordAllocation(bool recycled)
+        {
+            if (recycled)
+                ++mRecycled;
+            else
+                ++mAllocations;
+        }
+
+        U64     getAllocationCount() const { return mAllocations; }
+        U64     getRecycledCount() const { return mRecycled; }
+
         void    dumpStats();
     private:
         StatsAccumulator mDataDown;
@@ -66,6 +83,9 @@ namespace LLCore
 
         S32              mRequests;
 
+        std::atomic<U64> mAllocations;
+        std::atomic<U64> mRecycled;
+
         std::map<S32, S32> mResutCodes;
     };
 
@@ -27,6 +27,7 @@
 #define TEST_LLCORE_BUFFER_ARRAY_H_
 
 #include "bufferarray.h"
+#include "httpstats.h"
 
 #include <iostream>
 
@@ -374,6 +375,73 @@ void BufferArrayTestObjectType::test<8>()
     ba->release();
 }
 
+template <> template <>
+void BufferArrayTestObjectType::test<9>()
+{
+    set_test_name("BufferArray steady-state block recycling");
+
+    // test_allocator can't be used (see test_allocator.h) so count
+    // heap-sourced blocks through HTTPStats instead.
+    HTTPStats & stats(HTTPStats::instance());
+    char buffer[20000];
+    memset(buffer, 'a', sizeof(buffer));
+
+    // Warm up each size class with a response-like mix of a
+    // small body, a medium body and a multi-block body.
+    const size_t sizes[] = { 100, 10000, 3 * BufferArray::BLOCK_ALLOC_SIZE };
+    for (int pass(0); pass < 2; ++pass)
+    {
+        for (size_t size : sizes)
+        {
+            BufferArray * ba = new BufferArray();
+            for (size_t left(size); left; )
+            {
+                const size_t len((std::min)(left, sizeof(buffer)));
+                ba->append(buffer, len);
+                left -= len;
+            }
+            ensure("Warm-up size correct", size == ba->size());
+            ba->release();
+        }
+    }
+
+    const U64 allocs_before(stats.getAllocationCount());
+    const U64 recycled_before(stats.getRecycledCount());
+    for (int pass(0); pass < 100; ++pass)
+    {
+        for (size_t size : sizes)
+        {
+            BufferArray * ba = new BufferArray();
+            for (size_t left(size); left; )
+            {
+                const size_t len((std::min)(left, sizeof(buffer)));
+                ba->append(buffer, len);
+                left -= len;
+            }
+
+            char check[2] = { 0, 0 };
+            ensure("Recycled block content readable", 2 == ba->read(size - 2, check, 2));
+            ensure("Recycled block content correct", 'a' == check[0] && 'a' == check[1]);
+            ba->release();
+        }
+    }
+
+    ensure_equals("No heap blocks in steady state", stats.getAllocationCount(), allocs_before);
+    ensure("Blocks were recycled", stats.getRecycledCount() > recycled_before);
+
+    // appendBufferAlloc still hands out zeroed memory from a
+    // recycled block.
+    BufferArray * ba = new BufferArray();
+    char * out_buf(static_cast<char *>(ba->appendBufferAlloc(64)));
+    bool zeroed(true);
+    for (int i(0); i < 64; ++i)
+    {
+        zeroed = zeroed && ! out_buf[i];
+    }
+    ensure("appendBufferAlloc from recycled block zeroed", zeroed);
+    ba->release();
+}
+
 }  // end namespace tut
 
 
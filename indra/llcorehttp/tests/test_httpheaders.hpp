@@ -27,6 +27,7 @@
 #define TEST_LLCORE_HTTP_HEADERS_H_
 
 #include "httpheaders.h"
+#include "httpstats.h"
 
 #include <iostream>
 
@@ -386,6 +387,32 @@ void HttpHeadersTestObjectType::test<6>()
     headers.reset();
 }
 
+// Recycled headers come back empty
+template <> template <>
+void HttpHeadersTestObjectType::test<7>()
+{
+    set_test_name("HttpHeaders recycling");
+
+    LLCore::HTTPStats & stats(LLCore::HTTPStats::instance());
+
+    HttpHeaders::ptr_t headers(HttpHeaders::alloc());
+    ensure("Nothing in allocated headers", 0 == headers->size());
+    headers->append("Accept", "text/plain");
+    headers->append("Content-Type", "application/llsd+xml");
+    ensure("Headers appended", 2 == headers->size());
+
+    HttpHeaders * raw(headers.get());
+    headers.reset();
+
+    const U64 recycled_before(stats.getRecycledCount());
+    headers = HttpHeaders::alloc();
+    ensure("Instance was recycled", raw == headers.get());
+    ensure("Recycled headers empty", 0 == headers->size());
+    ensure("Recycle counted", stats.getRecycledCount() == recycled_before + 1);
+
+    headers.reset();
+}
+
 }  // end namespace tut
 
 
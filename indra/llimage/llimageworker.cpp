@@ -64,11 +64,17 @@ class ImageRequest
 
 //----------------------------------------------------------------------------
 
+// decodes waiting for a decode thread; the ring is allocated up front
+static const size_t DECODE_QUEUE_CAPACITY = 4096;
+
 // MAIN THREAD
 LLImageDecodeThread::LLImageDecodeThread(bool /*threaded*/)
     : mDecodeCount(0)
 {
-    mThreadPool.reset(new LL::ThreadPool("ImageDecode", 8));
+    // Texture fetch workers and the decode threads all hit this queue at
+    // once, so it takes no lock. Posting blocks while it is full, which
+    // only holds up the fetch worker that posts.
+    mThreadPool.reset(new LL::LockFreeThreadPool("ImageDecode", 8, DECODE_QUEUE_CAPACITY));
     mThreadPool->start();
 }
 
@@ -60,7 +60,7 @@ class LLImageDecodeThread
     // As of SL-17483, LLImageDecodeThread is no longer itself an
     // LLQueuedThread - instead this is the API by which we submit work to the
     // "ImageDecode" ThreadPool.
-    std::unique_ptr<LL::ThreadPool> mThreadPool;
+    std::unique_ptr<LL::LockFreeThreadPool> mThreadPool;
     LLAtomicU32 mDecodeCount;
 };
 
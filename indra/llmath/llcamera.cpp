@@ -245,6 +245,20 @@ S32 LLCamera::AABBInRegionFrustum(const LLVector4a& center, const LLVector4a& ra
     return AABBInFrustum(center, radius, mRegionPlanes);
 }
 
+U32 LLCamera::getActivePlaneMask(bool far_clip) const
+{
+    U32 bits = 0;
+    U32 max_planes = llmin(mPlaneCount, (U32) AGENT_PLANE_USER_CLIP_NUM);
+    for (U32 i = 0; i < max_planes; i++)
+    {
+        if (mPlaneMask[i] < PLANE_MASK_NUM && (far_clip || i != AGENT_PLANE_FAR))
+        {
+            bits |= 1 << i;
+        }
+    }
+    return bits;
+}
+
 S32 LLCamera::AABBInFrustumNoFarClip(const LLVector4a& center, const LLVector4a& radius, const LLPlane* planes)
 {
     if(!planes)
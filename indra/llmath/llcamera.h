@@ -141,6 +141,7 @@ class LLCamera
     LLVector3 mAgentFrustum[AGENT_FRUSTRUM_NUM];  //8 corners of 6-plane frustum
     F32 mFrustumCornerDist;     //distance to corner of frustum against far clip plane
     LLPlane& getAgentPlane(U32 idx) { return mAgentPlanes[idx]; }
+    const LLPlane* getAgentPlanes() const { return mAgentPlanes; }
 
 public:
     LLCamera();
@@ -201,6 +202,8 @@ class LLCamera
     S32 AABBInRegionFrustum(const LLVector4a& center, const LLVector4a& radius);
     S32 AABBInFrustumNoFarClip(const LLVector4a& center, const LLVector4a& radius, const LLPlane* planes = NULL);
     S32 AABBInRegionFrustumNoFarClip(const LLVector4a& center, const LLVector4a& radius);
+    // bit i set for each of mAgentPlanes[] the AABBInFrustum* tests above would use
+    U32 getActivePlaneMask(bool far_clip) const;
 
     //does a quick 'n dirty sphere-sphere check
     S32 sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius);
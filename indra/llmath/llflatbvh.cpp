@@ -0,0 +1,247 @@
+/**
+ * @file llflatbvh.cpp
+ * @brief Packed, structure-of-arrays copy of octree node bounds
+ *
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ */
+
+#include "linden_common.h"
+
+#include "llflatbvh.h"
+
+LLFlatBVH::LLFlatBVH()
+{
+}
+
+void LLFlatBVH::clear()
+{
+    for (U32 i = 0; i < 3; ++i)
+    {
+        mCenter[i].clear();
+        mSize[i].clear();
+    }
+    mFirstChild.clear();
+    mChildCount.clear();
+}
+
+S32 LLFlatBVH::allocate(U32 count)
+{
+    // every run starts on a block boundary so siblings load as whole vectors
+    S32 first = (S32) mFirstChild.size();
+    U32 blocks = (count + LANES - 1) / LANES;
+
+    mFirstChild.resize(first + blocks * LANES, -1);
+    mChildCount.resize(first + blocks * LANES, 0);
+    for (U32 i = 0; i < 3; ++i)
+    {
+        mCenter[i].resize(mCenter[i].size() + blocks, LLVector4a::getZero());
+        mSize[i].resize(mSize[i].size() + blocks, LLVector4a::getZero());
+    }
+
+    return first;
+}
+
+void LLFlatBVH::setBounds(S32 slot, const LLVector4a& center, const LLVector4a& size)
+{
+    llassert(slot >= 0 && slot < (S32) mFirstChild.size());
+
+    U32 block = slot / LANES;
+    U32 lane = slot % LANES;
+    for (U32 i = 0; i < 3; ++i)
+    {
+        mCenter[i][block].getF32ptr()[lane] = center[i];
+        mSize[i][block].getF32ptr()[lane] = size[i];
+    }
+}
+
+U32 LLFlatBVH::frustumTestBlock(U32 block, const LLPlane* planes, U32 plane_mask, U8* results) const
+{
+    const LLVector4a& cx = mCenter[0][block];
+    const LLVector4a& cy = mCenter[1][block];
+    const LLVector4a& cz = mCenter[2][block];
+    const LLVector4a& sx = mSize[0][block];
+    const LLVector4a& sy = mSize[1][block];
+    const LLVector4a& sz = mSize[2][block];
+
+    U32 outside = 0;
+    U32 partial = 0;
+
+    for (U32 i = 0; plane_mask >> i; ++i)
+    {
+        if (!(plane_mask & (1 << i)))
+        {
+            continue;
+        }
+
+        const LLPlane& p = planes[i];
+        LLVector4a nx, ny, nz, d;
+        nx.splat(p[0]);
+        ny.splat(p[1]);
+        nz.splat(p[2]);
+        d.splat(p[3]);
+
+        // signed distance of each box center
+        LLVector4a dist, t;
+        dist.setMul(nx, cx);
+        t.setMul(ny, cy);
+        dist.add(t);
+        t.setMul(nz, cz);
+        dist.add(t);
+        dist.add(d);
+
+        // projected radius of each box onto the plane normal
+        LLVector4a radius;
+        nx.setAbs(nx);
+        ny.setAbs(ny);
+        nz.setAbs(nz);
+        radius.setMul(nx, sx);
+        t.setMul(ny, sy);
+        radius.add(t);
+        t.setMul(nz, sz);
+        radius.add(t);
+
+        LLVector4a near_dist, far_dist;
+        near_dist.setSub(dist, radius);
+        far_dist.setAdd(dist, radius);
+
+        outside |= near_dist.greaterThan(LLVector4a::getZero()).getGatheredBits();
+        partial |= far_dist.greaterThan(LLVector4a::getZero()).getGatheredBits();
+    }
+
+    for (U32 lane = 0; lane < LANES; ++lane)
+    {
+        U32 bit = 1 << lane;
+        results[lane] = (outside & bit) ? 0 : ((partial & bit) ? 1 : 2);
+    }
+
+    return outside;
+}
+
+void LLFlatBVH::frustumCull(const LLPlane* planes, U32 plane_mask, std::vector<U8>& results) const
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    U32 slots = getSlotCount();
+    results.resize(slots);
+    if (!slots)
+    {
+        return;
+    }
+
+    frustumTestBlock(0, planes, plane_mask, &results[0]);
+
+    for (U32 slot = 0; slot < slots; ++slot)
+    {
+        U32 count = mChildCount[slot];
+        if (!count)
+        {
+            continue;
+        }
+
+        U32 first = mFirstChild[slot];
+        U8 res = results[slot];
+        if (res == 1)
+        {
+            U32 end = (first + count + LANES - 1) / LANES;
+            for (U32 block = first / LANES; block < end; ++block)
+            {
+                frustumTestBlock(block, planes, plane_mask, &results[block * LANES]);
+            }
+        }
+        else
+        {
+            memset(&results[first], res, count);
+        }
+    }
+}
+
+U32 LLFlatBVH::segmentTestBlock(U32 block, const LLVector4a* seg) const
+{
+    // same separating axis test as LLLineSegmentBoxIntersect, four boxes
+    // at a time; seg holds the half direction, midpoint and |half direction|
+    LLVector4a dir[3], adir[3], diff[3];
+    U32 miss = 0;
+
+    for (U32 i = 0; i < 3; ++i)
+    {
+        dir[i].splat(seg[0], i);
+        adir[i].splat(seg[2], i);
+
+        LLVector4a mid;
+        mid.splat(seg[1], i);
+        diff[i].setSub(mid, mCenter[i][block]);
+
+        LLVector4a lhs, rhs;
+        lhs.setAbs(diff[i]);
+        rhs.setAdd(mSize[i][block], adir[i]);
+        miss |= lhs.greaterThan(rhs).getGatheredBits();
+    }
+
+    static const U32 axis[3][2] = { { 1, 2 }, { 2, 0 }, { 0, 1 } };
+    for (U32 i = 0; i < 3; ++i)
+    {
+        U32 a = axis[i][0];
+        U32 b = axis[i][1];
+
+        LLVector4a f, t;
+        f.setMul(dir[a], diff[b]);
+        t.setMul(dir[b], diff[a]);
+        f.sub(t);
+        f.setAbs(f);
+
+        LLVector4a limit;
+        limit.setMul(mSize[a][block], adir[b]);
+        t.setMul(mSize[b][block], adir[a]);
+        limit.add(t);
+
+        miss |= f.greaterThan(limit).getGatheredBits();
+    }
+
+    return ~miss & 0xf;
+}
+
+U32 LLFlatBVH::segmentHitChildren(S32 slot, const LLVector4a& start, const LLVector4a& end) const
+{
+    S32 first = mFirstChild[slot];
+    if (first < 0)
+    {
+        return 0;
+    }
+
+    LLVector4a seg[3];
+    seg[0].setSub(end, start);
+    seg[0].mul(0.5f);
+    seg[1].setAdd(end, start);
+    seg[1].mul(0.5f);
+    seg[2].setAbs(seg[0]);
+
+    U32 count = mChildCount[slot];
+    U32 hits = 0;
+    U32 first_block = first / LANES;
+    for (U32 block = first_block; block * LANES < first + count; ++block)
+    {
+        hits |= segmentTestBlock(block, seg) << ((block - first_block) * LANES);
+    }
+
+    return hits & ((1 << count) - 1);
+}
@@ -0,0 +1,138 @@
+/**
+ * @file llflatbvh.h
+ * @brief Packed, structure-of-arrays copy of octree node bounds
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLFLATBVH_H
+#define LL_LLFLATBVH_H
+
+#include "lloctree.h"
+#include "llplane.h"
+#include "llvector4a.h"
+
+#include <vector>
+
+// Flat copy of an octree's node bounding boxes (center, half size) laid
+// out breadth first, with the children of each node packed into their own
+// run of 4-wide SoA blocks.  Queries test a whole block of siblings with one
+// pass of SIMD math instead of chasing child pointers and listeners.
+//
+// Slots are handed back to the caller at build time so it can keep the
+// boxes current with setBounds() as nodes are rebounded; any change to the
+// tree's shape needs a fresh build().
+class LLFlatBVH
+{
+public:
+    enum
+    {
+        LANES = 4,
+        MAX_CHILDREN = 8
+    };
+
+    LLFlatBVH();
+
+    void clear();
+    bool isEmpty() const                { return mFirstChild.empty(); }
+    U32 getSlotCount() const            { return (U32) mFirstChild.size(); }
+    S32 getFirstChild(S32 slot) const   { return mFirstChild[slot]; }
+    U32 getChildCount(S32 slot) const   { return mChildCount[slot]; }
+
+    // Rebuild from the octree rooted at root.  bounds(node) returns the
+    // node's (center, size) pair, set_slot(node, slot) records where it
+    // landed.  Child i of a node is always at getFirstChild() + i.
+    template <class T, typename T_PTR, typename BoundsFn, typename SlotFn>
+    void build(const LLOctreeNode<T, T_PTR>* root, BoundsFn bounds, SlotFn set_slot);
+
+    void setBounds(S32 slot, const LLVector4a& center, const LLVector4a& size);
+
+    // Classify every box reachable from the root against the planes whose
+    // bits are set in plane_mask, with the same 0 (outside), 1 (partial),
+    // 2 (inside) results as LLCamera::AABBInFrustum.  Children of boxes
+    // that are fully in or out inherit the parent's result untested.
+    void frustumCull(const LLPlane* planes, U32 plane_mask, std::vector<U8>& results) const;
+
+    // Bit i is set if the segment touches child i of slot.
+    U32 segmentHitChildren(S32 slot, const LLVector4a& start, const LLVector4a& end) const;
+
+private:
+    S32 allocate(U32 count);
+    U32 frustumTestBlock(U32 block, const LLPlane* planes, U32 plane_mask, U8* results) const;
+    U32 segmentTestBlock(U32 block, const LLVector4a* seg) const;
+
+    // one entry per block of LANES slots, component-major
+    std::vector<LLVector4a> mCenter[3];
+    std::vector<LLVector4a> mSize[3];
+
+    std::vector<S32> mFirstChild;   // -1 for leaves and padding
+    std::vector<U8> mChildCount;
+};
+
+template <class T, typename T_PTR, typename BoundsFn, typename SlotFn>
+void LLFlatBVH::build(const LLOctreeNode<T, T_PTR>* root, BoundsFn bounds, SlotFn set_slot)
+{
+    typedef LLOctreeNode<T, T_PTR> node_t;
+
+    clear();
+    if (!root)
+    {
+        return;
+    }
+
+    std::vector<std::pair<const node_t*, S32> > queue;
+
+    S32 slot = allocate(1);
+    const LLVector4a* box = bounds(root);
+    setBounds(slot, box[0], box[1]);
+    set_slot(root, slot);
+    queue.emplace_back(root, slot);
+
+    // breadth first, so a parent's slot always precedes its children's
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        const node_t* node = queue[head].first;
+        S32 parent = queue[head].second;
+
+        U32 count = node->getChildCount();
+        if (!count)
+        {
+            continue;
+        }
+
+        S32 first = allocate(count);
+        mFirstChild[parent] = first;
+        mChildCount[parent] = (U8) count;
+
+        for (U32 i = 0; i < count; ++i)
+        {
+            const node_t* child = node->getChild(i);
+            box = bounds(child);
+            setBounds(first + i, box[0], box[1]);
+            set_slot(child, first + i);
+            queue.emplace_back(child, first + i);
+        }
+    }
+}
+
+#endif // LL_LLFLATBVH_H
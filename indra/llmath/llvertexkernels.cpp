@@ -0,0 +1,521 @@
+/**
+ * @file llvertexkernels.cpp
+ * @brief Batch transforms over volume face vertex streams
+ *
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ */
+
+#include "linden_common.h"
+
+#include "llvertexkernels.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// The kernels are written once against a small set of register operations
+// and instantiated for 128 bit (SSE) and, when the build enables it, 256 bit
+// (AVX2) registers.  256 bit shuffles work within each 128 bit half, so the
+// per-vertex code sees exactly the same lane layout in both cases.
+namespace
+{
+    struct SSEOps
+    {
+        typedef __m128 V;
+        enum { VECS = 1 };    // LLVector4a per register
+
+        static V load(const F32* p)         { return _mm_loadu_ps(p); }
+        static V loadVec(const LLVector4a* p) { return _mm_load_ps((const F32*) p); }
+        static void store(F32* p, V v)      { _mm_storeu_ps(p, v); }
+        static void storeVec(LLVector4a* p, V v) { _mm_store_ps((F32*) p, v); }
+        static V broadcast(const LLVector4a& v) { return (LLQuad) v; }
+        static V set1(F32 f)                { return _mm_set1_ps(f); }
+        static V zero()                     { return _mm_setzero_ps(); }
+        static V wMask()                    { return _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0)); }
+        // the highest LLVector4a held in v
+        static LLQuad last(V v)             { return v; }
+
+        static V add(V a, V b)              { return _mm_add_ps(a, b); }
+        static V sub(V a, V b)              { return _mm_sub_ps(a, b); }
+        static V mul(V a, V b)              { return _mm_mul_ps(a, b); }
+        static V bitOr(V a, V b)            { return _mm_or_ps(a, b); }
+        static V bitXor(V a, V b)           { return _mm_xor_ps(a, b); }
+        static V cmpGE(V a, V b)            { return _mm_cmpge_ps(a, b); }
+        static V cmpLE(V a, V b)            { return _mm_cmple_ps(a, b); }
+        static V cmpLT(V a, V b)            { return _mm_cmplt_ps(a, b); }
+        static V cmpGT(V a, V b)            { return _mm_cmpgt_ps(a, b); }
+
+        // lanes of a where mask is set, b elsewhere
+        static V select(V mask, V a, V b)   { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+        template <int a, int b, int c, int d>
+        static V shuffle(V lo, V hi)        { return _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(d, c, b, a)); }
+        static V unpackLo(V a, V b)         { return _mm_unpacklo_ps(a, b); }
+        static V unpackHi(V a, V b)         { return _mm_unpackhi_ps(a, b); }
+
+        // four LLVector4a per lane group, as loaded by loadQuad()
+        static void loadQuad(const LLVector4a* p, V& a0, V& a1, V& a2, V& a3)
+        {
+            a0 = loadVec(p);
+            a1 = loadVec(p + 1);
+            a2 = loadVec(p + 2);
+            a3 = loadVec(p + 3);
+        }
+
+        // interleave s and t back into consecutive LLVector2
+        static void storePairs(F32* dst, V s, V t)
+        {
+            store(dst, unpackLo(s, t));
+            store(dst + 4, unpackHi(s, t));
+        }
+    };
+
+#if defined(__AVX2__)
+    struct AVXOps
+    {
+        typedef __m256 V;
+        enum { VECS = 2 };
+
+        static V load(const F32* p)         { return _mm256_loadu_ps(p); }
+        static V loadVec(const LLVector4a* p) { return _mm256_loadu_ps((const F32*) p); }
+        static void store(F32* p, V v)      { _mm256_storeu_ps(p, v); }
+        static void storeVec(LLVector4a* p, V v) { _mm256_storeu_ps((F32*) p, v); }
+        static V broadcast(const LLVector4a& v) { return _mm256_broadcast_ps((const __m128*) v.getF32ptr()); }
+        static V set1(F32 f)                { return _mm256_set1_ps(f); }
+        static V zero()                     { return _mm256_setzero_ps(); }
+        static V wMask()                    { return _mm256_castsi256_ps(_mm256_set_epi32(-1, 0, 0, 0, -1, 0, 0, 0)); }
+        static LLQuad last(V v)             { return _mm256_extractf128_ps(v, 1); }
+
+        static V add(V a, V b)              { return _mm256_add_ps(a, b); }
+        static V sub(V a, V b)              { return _mm256_sub_ps(a, b); }
+        static V mul(V a, V b)              { return _mm256_mul_ps(a, b); }
+        static V bitOr(V a, V b)            { return _mm256_or_ps(a, b); }
+        static V bitXor(V a, V b)           { return _mm256_xor_ps(a, b); }
+        static V cmpGE(V a, V b)            { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+        static V cmpLE(V a, V b)            { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static V cmpLT(V a, V b)            { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static V cmpGT(V a, V b)            { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+
+        static V select(V mask, V a, V b)   { return _mm256_blendv_ps(b, a, mask); }
+
+        template <int a, int b, int c, int d>
+        static V shuffle(V lo, V hi)        { return _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(d, c, b, a)); }
+        static V unpackLo(V a, V b)         { return _mm256_unpacklo_ps(a, b); }
+        static V unpackHi(V a, V b)         { return _mm256_unpackhi_ps(a, b); }
+
+        // vertices i and i + 4 share a register so that the in-lane
+        // transpose yields 8 consecutive vertices
+        static void loadQuad(const LLVector4a* p, V& a0, V& a1, V& a2, V& a3)
+        {
+            a0 = _mm256_insertf128_ps(_mm256_castps128_ps256((LLQuad) p[0]), (LLQuad) p[4], 1);
+            a1 = _mm256_insertf128_ps(_mm256_castps128_ps256((LLQuad) p[1]), (LLQuad) p[5], 1);
+            a2 = _mm256_insertf128_ps(_mm256_castps128_ps256((LLQuad) p[2]), (LLQuad) p[6], 1);
+            a3 = _mm256_insertf128_ps(_mm256_castps128_ps256((LLQuad) p[3]), (LLQuad) p[7], 1);
+        }
+
+        static void storePairs(F32* dst, V s, V t)
+        {
+            V lo = unpackLo(s, t);
+            V hi = unpackHi(s, t);
+            store(dst, _mm256_permute2f128_ps(lo, hi, 0x20));
+            store(dst + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+        }
+    };
+#endif
+
+    // mat * v with v.w ignored, as LLMatrix4a::affineTransform()
+    template <class O>
+    inline typename O::V affine(typename O::V v, const typename O::V* rows)
+    {
+        typedef typename O::V V;
+        V x = O::mul(O::template shuffle<0, 0, 0, 0>(v, v), rows[0]);
+        V y = O::mul(O::template shuffle<1, 1, 1, 1>(v, v), rows[1]);
+        V z = O::mul(O::template shuffle<2, 2, 2, 2>(v, v), rows[2]);
+        x = O::add(x, y);
+        z = O::add(z, rows[3]);
+        return O::add(x, z);
+    }
+
+    // upper 3x3 of mat * v, as LLMatrix4a::rotate()
+    template <class O>
+    inline typename O::V rotate(typename O::V v, const typename O::V* rows)
+    {
+        typedef typename O::V V;
+        V x = O::mul(O::template shuffle<0, 0, 0, 0>(v, v), rows[0]);
+        V y = O::mul(O::template shuffle<1, 1, 1, 1>(v, v), rows[1]);
+        V z = O::mul(O::template shuffle<2, 2, 2, 2>(v, v), rows[2]);
+        x = O::add(x, y);
+        return O::add(x, z);
+    }
+
+    template <class O>
+    inline void load_rows(const LLMatrix4a& mat, typename O::V* rows)
+    {
+        for (U32 i = 0; i < 4; ++i)
+        {
+            rows[i] = O::broadcast(mat.mMatrix[i]);
+        }
+    }
+
+    // Each kernel returns the number of elements it wrote; the caller
+    // finishes the rest with the narrower kernel or a scalar tail.
+    template <class O>
+    S32 transform_positions(const LLMatrix4a& mat, const LLVector4a* src, S32 count,
+                            F32 tex_index, LLVector4a* dst, LLVector4a& last)
+    {
+        typedef typename O::V V;
+        V rows[4];
+        load_rows<O>(mat, rows);
+
+        const V tex_idx = O::set1(tex_index);
+        const V mask = O::wMask();
+
+        S32 i = 0;
+        V res = O::zero();
+        for (; i + O::VECS <= count; i += O::VECS)
+        {
+            res = affine<O>(O::loadVec(src + i), rows);
+            O::storeVec(dst + i, O::select(mask, tex_idx, res));
+        }
+
+        if (i > 0)
+        {
+            last = O::last(res);
+        }
+        return i;
+    }
+
+    template <class O>
+    S32 rotate_vectors(const LLMatrix4a& mat, const LLVector4a* src, S32 count, LLVector4a* dst, bool keep_w)
+    {
+        typedef typename O::V V;
+        V rows[4];
+        load_rows<O>(mat, rows);
+
+        const V mask = O::wMask();
+
+        S32 i = 0;
+        if (keep_w)
+        {
+            for (; i + O::VECS <= count; i += O::VECS)
+            {
+                V v = O::loadVec(src + i);
+                O::storeVec(dst + i, O::select(mask, v, rotate<O>(v, rows)));
+            }
+        }
+        else
+        {
+            for (; i + O::VECS <= count; i += O::VECS)
+            {
+                O::storeVec(dst + i, rotate<O>(O::loadVec(src + i), rows));
+            }
+        }
+        return i;
+    }
+
+    // LLVector4a::dot3() uses DPPS when SSE4.1 is enabled, which sums
+    // (x + y) + (z + 0) rather than (x + y) + z.  The two only differ in the
+    // sign of a zero result, but match it anyway.
+    template <class O>
+    inline typename O::V dot3(typename O::V ax, typename O::V ay, typename O::V az,
+                              typename O::V bx, typename O::V by, typename O::V bz)
+    {
+        typedef typename O::V V;
+        V xy = O::add(O::mul(ax, bx), O::mul(ay, by));
+#if defined(__SSE4_1__)
+        V z = O::add(O::mul(az, bz), O::zero());
+#else
+        V z = O::mul(az, bz);
+#endif
+        return O::add(xy, z);
+    }
+
+    template <class O>
+    inline void transpose3(typename O::V a0, typename O::V a1, typename O::V a2, typename O::V a3,
+                           typename O::V& x, typename O::V& y, typename O::V& z)
+    {
+        typedef typename O::V V;
+        V t0 = O::unpackLo(a0, a1);
+        V t1 = O::unpackLo(a2, a3);
+        V t2 = O::unpackHi(a0, a1);
+        V t3 = O::unpackHi(a2, a3);
+        x = O::template shuffle<0, 1, 0, 1>(t0, t1);
+        y = O::template shuffle<2, 3, 2, 3>(t0, t1);
+        z = O::template shuffle<0, 1, 0, 1>(t2, t3);
+    }
+
+    // Scalar planarProjection() from llface.cpp, used for the tail.
+    inline void planar_one(const LLVector4a& normal, const LLVector4a& position,
+                           const LLVector4a& scale, LLVector2& tc)
+    {
+        LLVector4a vec;
+        vec.setMul(position, scale);
+
+        LLVector4a binormal;
+        F32 d = normal[0];
+
+        if (d >= 0.5f || d <= -0.5f)
+        {
+            if (d < 0)
+            {
+                binormal.set(0, -1, 0);
+            }
+            else
+            {
+                binormal.set(0, 1, 0);
+            }
+        }
+        else
+        {
+            if (normal[1] > 0)
+            {
+                binormal.set(-1, 0, 0);
+            }
+            else
+            {
+                binormal.set(1, 0, 0);
+            }
+        }
+        LLVector4a tangent;
+        tangent.setCross3(binormal, normal);
+
+        tc.mV[1] = -((tangent.dot3(vec).getF32()) * 2 - 0.5f);
+        tc.mV[0] = 1.0f + ((binormal.dot3(vec).getF32()) * 2 - 0.5f);
+    }
+
+    template <class O>
+    S32 planar_tex_coords(const LLVector4a* normals, const LLVector4a* positions,
+                          const LLVector4a& scale, S32 count, LLVector2* dst)
+    {
+        typedef typename O::V V;
+        const S32 step = 4 * O::VECS;
+
+        const V sx = O::set1(scale[0]);
+        const V sy = O::set1(scale[1]);
+        const V sz = O::set1(scale[2]);
+        const V zero = O::zero();
+        const V one = O::set1(1.f);
+        const V neg_one = O::set1(-1.f);
+        const V half = O::set1(0.5f);
+        const V neg_half = O::set1(-0.5f);
+        const V two = O::set1(2.f);
+        const V sign = O::set1(-0.f);
+
+        S32 i = 0;
+        for (; i + step <= count; i += step)
+        {
+            V a0, a1, a2, a3;
+            V nx, ny, nz;
+            O::loadQuad(normals + i, a0, a1, a2, a3);
+            transpose3<O>(a0, a1, a2, a3, nx, ny, nz);
+
+            V px, py, pz;
+            O::loadQuad(positions + i, a0, a1, a2, a3);
+            transpose3<O>(a0, a1, a2, a3, px, py, pz);
+
+            V vx = O::mul(px, sx);
+            V vy = O::mul(py, sy);
+            V vz = O::mul(pz, sz);
+
+            // binormal is +/-Y for faces pointing mostly along X, else +/-X
+            V along_x = O::bitOr(O::cmpGE(nx, half), O::cmpLE(nx, neg_half));
+            V by = O::select(along_x, O::select(O::cmpLT(nx, zero), neg_one, one), zero);
+            V bx = O::select(along_x, zero, O::select(O::cmpGT(ny, zero), neg_one, one));
+            V bz = zero;
+
+            // tangent = binormal x normal, term for term as setCross3()
+            V tx = O::sub(O::mul(nz, by), O::mul(bz, ny));
+            V ty = O::sub(O::mul(nx, bz), O::mul(bx, nz));
+            V tz = O::sub(O::mul(ny, bx), O::mul(by, nx));
+
+            V tdot = dot3<O>(tx, ty, tz, vx, vy, vz);
+            V bdot = dot3<O>(bx, by, bz, vx, vy, vz);
+
+            V t = O::bitXor(O::sub(O::mul(tdot, two), half), sign);
+            V s = O::add(one, O::sub(O::mul(bdot, two), half));
+
+            O::storePairs((F32*) (dst + i), s, t);
+        }
+        return i;
+    }
+
+    // Two texture coordinates per 128 bits, as xform4a() in llface.cpp.
+    template <class O>
+    inline typename O::V xform_pairs(typename O::V st, typename O::V trans, typename O::V rot0,
+                                     typename O::V rot1, typename O::V offset, typename O::V scale)
+    {
+        typedef typename O::V V;
+        st = O::add(st, trans);
+        V ss = O::template shuffle<0, 0, 2, 2>(st, st);
+        V tt = O::template shuffle<1, 1, 3, 3>(st, st);
+        V a = O::mul(rot0, ss);
+        V b = O::mul(rot1, tt);
+        st = O::add(a, b);
+        st = O::mul(st, scale);
+        return O::add(st, offset);
+    }
+
+    template <class O>
+    S32 xform_tex_coords(const LLVector2* src, S32 count, F32 cos_ang, F32 sin_ang,
+                         F32 offset_s, F32 offset_t, F32 mag_s, F32 mag_t, LLVector2* dst)
+    {
+        typedef typename O::V V;
+        const S32 step = 2 * O::VECS;
+
+        const V trans = O::set1(-0.5f);
+        const V rot0 = O::broadcast(LLVector4a(cos_ang, -sin_ang, cos_ang, -sin_ang));
+        const V rot1 = O::broadcast(LLVector4a(sin_ang, cos_ang, sin_ang, cos_ang));
+        const V scale = O::broadcast(LLVector4a(mag_s, mag_t, mag_s, mag_t));
+        const V offset = O::broadcast(LLVector4a(offset_s + 0.5f, offset_t + 0.5f, offset_s + 0.5f, offset_t + 0.5f));
+
+        S32 i = 0;
+        for (; i + step <= count; i += step)
+        {
+            V st = O::load((const F32*) (src + i));
+            O::store((F32*) (dst + i), xform_pairs<O>(st, trans, rot0, rot1, offset, scale));
+        }
+        return i;
+    }
+
+    // (mat * <s, t, 0>).xy for two texture coordinates per 128 bits.  The
+    // z term of affineTransform() is constant, so it is folded into the
+    // translation up front with the same operations.
+    template <class O>
+    S32 transform_tex_coords(const LLMatrix4a& mat, const LLVector2* src, S32 count, LLVector2* dst)
+    {
+        typedef typename O::V V;
+        const S32 step = 2 * O::VECS;
+
+        LLVector4a z;
+        z.setMul(LLVector4a::getZero(), mat.mMatrix[2]);
+        z.add(mat.mMatrix[3]);
+
+        V r0 = O::broadcast(mat.mMatrix[0]);
+        V r1 = O::broadcast(mat.mMatrix[1]);
+        V r3 = O::broadcast(z);
+        r0 = O::template shuffle<0, 1, 0, 1>(r0, r0);
+        r1 = O::template shuffle<0, 1, 0, 1>(r1, r1);
+        r3 = O::template shuffle<0, 1, 0, 1>(r3, r3);
+
+        S32 i = 0;
+        for (; i + step <= count; i += step)
+        {
+            V st = O::load((const F32*) (src + i));
+            V x = O::mul(O::template shuffle<0, 0, 2, 2>(st, st), r0);
+            V y = O::mul(O::template shuffle<1, 1, 3, 3>(st, st), r1);
+            x = O::add(x, y);
+            O::store((F32*) (dst + i), O::add(x, r3));
+        }
+        return i;
+    }
+}
+
+namespace LLVertexKernels
+{
+
+void transformPositions(const LLMatrix4a& mat, const LLVector4a* src, S32 count,
+                        F32 tex_index, LLVector4a* dst, S32 dst_count)
+{
+    // last transformed position, before the texture index went into w
+    LLVector4a last;
+    last.clear();
+
+    S32 i = 0;
+#if defined(__AVX2__)
+    i = transform_positions<AVXOps>(mat, src, count, tex_index, dst, last);
+#endif
+    transform_positions<SSEOps>(mat, src + i, count - i, tex_index, dst + i, last);
+
+    for (i = llmax(count, 0); i < dst_count; ++i)
+    {
+        dst[i] = last;
+    }
+}
+
+void rotateNormals(const LLMatrix4a& mat, const LLVector4a* src, S32 count, LLVector4a* dst)
+{
+    S32 i = 0;
+#if defined(__AVX2__)
+    i = rotate_vectors<AVXOps>(mat, src, count, dst, false);
+#endif
+    rotate_vectors<SSEOps>(mat, src + i, count - i, dst + i, false);
+}
+
+void rotateTangents(const LLMatrix4a& mat, const LLVector4a* src, S32 count, LLVector4a* dst)
+{
+    S32 i = 0;
+#if defined(__AVX2__)
+    i = rotate_vectors<AVXOps>(mat, src, count, dst, true);
+#endif
+    rotate_vectors<SSEOps>(mat, src + i, count - i, dst + i, true);
+}
+
+void planarTexCoords(const LLVector4a* normals, const LLVector4a* positions,
+                     const LLVector4a& scale, S32 count, LLVector2* dst)
+{
+    S32 i = 0;
+#if defined(__AVX2__)
+    i = planar_tex_coords<AVXOps>(normals, positions, scale, count, dst);
+#endif
+    i += planar_tex_coords<SSEOps>(normals + i, positions + i, scale, count - i, dst + i);
+
+    for (; i < count; ++i)
+    {
+        planar_one(normals[i], positions[i], scale, dst[i]);
+    }
+}
+
+void xformTexCoords(const LLVector2* src, S32 count, F32 cos_ang, F32 sin_ang,
+                    F32 offset_s, F32 offset_t, F32 mag_s, F32 mag_t, LLVector2* dst)
+{
+    S32 i = 0;
+#if defined(__AVX2__)
+    i = xform_tex_coords<AVXOps>(src, count, cos_ang, sin_ang, offset_s, offset_t, mag_s, mag_t, dst);
+#endif
+    i += xform_tex_coords<SSEOps>(src + i, count - i, cos_ang, sin_ang, offset_s, offset_t, mag_s, mag_t, dst + i);
+
+    if (i < count)
+    {   // odd one out goes through a padded pair so it sees the same math
+        LLVector2 tail[2] = { src[i], LLVector2::zero };
+        xform_tex_coords<SSEOps>(tail, 2, cos_ang, sin_ang, offset_s, offset_t, mag_s, mag_t, tail);
+        dst[i] = tail[0];
+    }
+}
+
+void transformTexCoords(const LLMatrix4a& mat, const LLVector2* src, S32 count, LLVector2* dst)
+{
+    S32 i = 0;
+#if defined(__AVX2__)
+    i = transform_tex_coords<AVXOps>(mat, src, count, dst);
+#endif
+    i += transform_tex_coords<SSEOps>(mat, src + i, count - i, dst + i);
+
+    if (i < count)
+    {
+        LLVector2 tail[2] = { src[i], LLVector2::zero };
+        transform_tex_coords<SSEOps>(mat, tail, 2, tail);
+        dst[i] = tail[0];
+    }
+}
+
+}
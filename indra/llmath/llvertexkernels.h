@@ -0,0 +1,72 @@
+/**
+ * @file llvertexkernels.h
+ * @brief Batch transforms over volume face vertex streams
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVERTEXKERNELS_H
+#define LL_LLVERTEXKERNELS_H
+
+#include "llmath.h"
+#include "llmatrix4a.h"
+#include "v2math.h"
+
+// One pass per attribute over the contiguous streams of an LLVolumeFace,
+// writing straight into vertex buffer memory.  Each kernel performs the
+// same floating point operations in the same order as the per-vertex
+// LLVector4a code it replaces, so output is bit-for-bit identical to that
+// code; builds with AVX2 enabled process two (or eight) vertices per step.
+//
+// Destinations only need the alignment the vertex buffer already gives
+// (16 bytes for 4-wide streams, 8 for texture coordinates), and exactly
+// count elements are written.
+namespace LLVertexKernels
+{
+    // dst[i] = mat * src[i] with w replaced by tex_index (a bit pattern, see
+    // LLFace::getGeometryVolume).  Any slots in [count, dst_count) are
+    // filled with the last transformed position, w included.
+    void transformPositions(const LLMatrix4a& mat, const LLVector4a* src, S32 count,
+                            F32 tex_index, LLVector4a* dst, S32 dst_count);
+
+    // dst[i] = rotation of src[i] by the upper 3x3 of mat.
+    void rotateNormals(const LLMatrix4a& mat, const LLVector4a* src, S32 count, LLVector4a* dst);
+
+    // As rotateNormals, but w (the bitangent sign) is carried over from src.
+    void rotateTangents(const LLMatrix4a& mat, const LLVector4a* src, S32 count, LLVector4a* dst);
+
+    // Planar texture generation from normals and scaled positions.
+    void planarTexCoords(const LLVector4a* normals, const LLVector4a* positions,
+                         const LLVector4a& scale, S32 count, LLVector2* dst);
+
+    // Rotate, scale and offset about the center of the texture (the
+    // legacy texture entry transform).  src may equal dst.
+    void xformTexCoords(const LLVector2* src, S32 count, F32 cos_ang, F32 sin_ang,
+                        F32 offset_s, F32 offset_t, F32 mag_s, F32 mag_t, LLVector2* dst);
+
+    // dst[i] = (mat * <src[i], 0>).xy for animated texture matrices.
+    // src may equal dst.
+    void transformTexCoords(const LLMatrix4a& mat, const LLVector2* src, S32 count, LLVector2* dst);
+}
+
+#endif // LL_LLVERTEXKERNELS_H
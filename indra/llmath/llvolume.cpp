@@ -27,6 +27,7 @@
 #include "llmemory.h"
 #include "llmath.h"
 
+#include <atomic>
 #include <set>
 #if !LL_WINDOWS
 #include <stdint.h>
@@ -37,6 +38,7 @@
 #include <meshoptimizer.h>
 
 #include "llerror.h"
+#include "llmutex.h"
 
 #include "llvolumemgr.h"
 #include "v2math.h"
@@ -54,6 +56,7 @@
 #include "llmeshoptimizer.h"
 #include "lltimer.h"
 #include "llvolumeoctree.h"
+#include "workqueue.h"
 
 #include "mikktspace/mikktspace.hh"
 
@@ -4084,101 +4087,14 @@ S32 LLVolume::lineSegmentIntersect(const LLVector4a& start, const LLVector4a& en
 
             if (isUnique())
             { //don't bother with an octree for flexi volumes
-                U32 tri_count = face.mNumIndices/3;
-
-                for (U32 j = 0; j < tri_count; ++j)
+                if (face.lineSegmentIntersectTriangles(start, dir, closest_t, intersection, tex_coord, normal, tangent_out))
                 {
-                    U16 idx0 = face.mIndices[j*3+0];
-                    U16 idx1 = face.mIndices[j*3+1];
-                    U16 idx2 = face.mIndices[j*3+2];
-
-                    const LLVector4a& v0 = face.mPositions[idx0];
-                    const LLVector4a& v1 = face.mPositions[idx1];
-                    const LLVector4a& v2 = face.mPositions[idx2];
-
-                    F32 a,b,t;
-
-                    if (LLTriangleRayIntersect(v0, v1, v2,
-                            start, dir, a, b, t))
-                    {
-                        if ((t >= 0.f) &&      // if hit is after start
-                            (t <= 1.f) &&      // and before end
-                            (t < closest_t))   // and this hit is closer
-                        {
-                            closest_t = t;
-                            hit_face = i;
-
-                            if (intersection != NULL)
-                            {
-                                LLVector4a intersect = dir;
-                                intersect.mul(closest_t);
-                                intersect.add(start);
-                                *intersection = intersect;
-                            }
-
-
-                            if (tex_coord != NULL)
-                            {
-                                LLVector2* tc = (LLVector2*) face.mTexCoords;
-                                *tex_coord = ((1.f - a - b)  * tc[idx0] +
-                                    a              * tc[idx1] +
-                                    b              * tc[idx2]);
-
-                            }
-
-                            if (normal!= NULL)
-                            {
-                                LLVector4a* norm = face.mNormals;
-
-                                LLVector4a n1,n2,n3;
-                                n1 = norm[idx0];
-                                n1.mul(1.f-a-b);
-
-                                n2 = norm[idx1];
-                                n2.mul(a);
-
-                                n3 = norm[idx2];
-                                n3.mul(b);
-
-                                n1.add(n2);
-                                n1.add(n3);
-
-                                *normal     = n1;
-                            }
-
-                            if (tangent_out != NULL)
-                            {
-                                LLVector4a* tangents = face.mTangents;
-
-                                LLVector4a t1,t2,t3;
-                                t1 = tangents[idx0];
-                                t1.mul(1.f-a-b);
-
-                                t2 = tangents[idx1];
-                                t2.mul(a);
-
-                                t3 = tangents[idx2];
-                                t3.mul(b);
-
-                                t1.add(t2);
-                                t1.add(t3);
-
-                                *tangent_out = t1;
-                            }
-                        }
-                    }
+                    hit_face = i;
                 }
             }
             else
             {
-                if (!face.getOctree())
-                {
-                    face.createOctree();
-                }
-
-                LLOctreeTriangleRayIntersect intersect(start, dir, &face, &closest_t, intersection, tex_coord, normal, tangent_out);
-                intersect.traverse(face.getOctree());
-                if (intersect.mHitFace)
+                if (face.lineSegmentIntersect(start, dir, closest_t, intersection, tex_coord, normal, tangent_out))
                 {
                     hit_face = i;
                 }
@@ -4725,8 +4641,6 @@ LLVolumeFace::LLVolumeFace() :
     mIndices(NULL),
     mWeights(NULL),
     mWeightsScrubbed(FALSE),
-    mOctree(NULL),
-    mOctreeTriangles(NULL),
     mOptimized(FALSE)
 {
     mExtents = (LLVector4a*) ll_aligned_malloc_16(sizeof(LLVector4a)*3);
@@ -4752,8 +4666,6 @@ LLVolumeFace::LLVolumeFace(const LLVolumeFace& src)
     mIndices(NULL),
     mWeights(NULL),
     mWeightsScrubbed(FALSE),
-    mOctree(NULL),
-    mOctreeTriangles(NULL),
     mOptimized(FALSE)
 {
     mExtents = (LLVector4a*) ll_aligned_malloc_16(sizeof(LLVector4a)*3);
@@ -5584,30 +5496,68 @@ bool LLVolumeFace::cacheOptimize(bool gen_tangents)
     return true;
 }
 
-void LLVolumeFace::createOctree(F32 scaler, const LLVector4a& center, const LLVector4a& size)
+namespace
 {
-    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME
+    // Guards every face's octree pointers and the LRU below.  Faces are
+    // created and destroyed on the mesh threads as well as the main thread.
+    LLMutex sOctreeMutex;
+    // Most recently queried first
+    std::list<LLVolumeFace*> sOctreeLRU;
+    std::atomic<U64> sOctreeMemory { 0 };
+    U64 sOctreeBudget = 0;
 
-    if (getOctree())
+    class LLVolumeOctreeCount final : public LLOctreeTraveler<LLVolumeTriangle, LLVolumeTriangle*>
     {
-        return;
+    public:
+        void visit(const LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>* branch) override { ++mNodes; }
+
+        U32 mNodes = 0;
+    };
+}
+
+// A built (or building) octree and the triangles it indexes.  Async builds
+// work from a private copy of the positions so the face can change or go
+// away underneath them; the triangle indices still refer to the face.
+struct LLVolumeFace::OctreeData
+{
+    ~OctreeData()
+    {
+        delete mOctree;
+        delete[] mTriangles;
+        ll_aligned_free_16(mPositions);
     }
 
-    llassert(mNumIndices % 3 == 0);
+    void build(const LLVector4a* positions, const U16* indices, U32 num_indices,
+               F32 scaler, const LLVector4a& center, const LLVector4a& size);
+
+    LLVolumeOctree* mOctree = nullptr;
+    LLVolumeTriangle* mTriangles = nullptr;
+    LLVector4a* mPositions = nullptr;
+    U64 mBytes = 0;
+    std::atomic<bool> mReady { false };
+    std::atomic<bool> mCancelled { false };
+};
+
+void LLVolumeFace::OctreeData::build(const LLVector4a* positions, const U16* indices, U32 num_indices,
+                                     F32 scaler, const LLVector4a& center, const LLVector4a& size)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME
+
+    llassert(num_indices % 3 == 0);
 
     mOctree = new LLVolumeOctree(center, size);
-    const U32 num_triangles = mNumIndices / 3;
+    const U32 num_triangles = num_indices / 3;
     // Initialize all the triangles we need
-    mOctreeTriangles = new LLVolumeTriangle[num_triangles];
+    mTriangles = new LLVolumeTriangle[num_triangles];
 
     for (U32 triangle_index = 0; triangle_index < num_triangles; ++triangle_index)
     { //for each triangle
         const U32 index = triangle_index * 3;
-        LLVolumeTriangle* tri = &mOctreeTriangles[triangle_index];
+        LLVolumeTriangle* tri = &mTriangles[triangle_index];
 
-        const LLVector4a& v0 = mPositions[mIndices[index]];
-        const LLVector4a& v1 = mPositions[mIndices[index + 1]];
-        const LLVector4a& v2 = mPositions[mIndices[index + 2]];
+        const LLVector4a& v0 = positions[indices[index]];
+        const LLVector4a& v1 = positions[indices[index + 1]];
+        const LLVector4a& v2 = positions[indices[index + 2]];
 
         //store pointers to vertex data
         tri->mV[0] = &v0;
@@ -5615,9 +5565,9 @@ void LLVolumeFace::createOctree(F32 scaler, const LLVector4a& center, const LLVe
         tri->mV[2] = &v2;
 
         //store indices
-        tri->mIndex[0] = mIndices[index];
-        tri->mIndex[1] = mIndices[index + 1];
-        tri->mIndex[2] = mIndices[index + 2];
+        tri->mIndex[0] = indices[index];
+        tri->mIndex[1] = indices[index + 1];
+        tri->mIndex[2] = indices[index + 2];
 
         //get minimum point
         LLVector4a min = v0;
@@ -5658,19 +5608,286 @@ void LLVolumeFace::createOctree(F32 scaler, const LLVector4a& center, const LLVe
         LLVolumeOctreeValidate validate;
         validate.traverse(mOctree);
     }
+
+    LLVolumeOctreeCount count;
+    count.traverse(mOctree);
+    mBytes += (U64)num_triangles * sizeof(LLVolumeTriangle) +
+        (U64)count.mNodes * (sizeof(LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>) + sizeof(LLVolumeOctreeListener));
+}
+
+void LLVolumeFace::createOctree(F32 scaler, const LLVector4a& center, const LLVector4a& size)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME
+
+    if (getOctree())
+    {
+        return;
+    }
+
+    std::shared_ptr<OctreeData> octree = std::make_shared<OctreeData>();
+    octree->build(mPositions, mIndices, mNumIndices, scaler, center, size);
+    octree->mReady = true;
+
+    LLMutexLock lock(&sOctreeMutex);
+    if (mOctreeBuild)
+    {
+        mOctreeBuild->mCancelled = true;
+        mOctreeBuild.reset();
+    }
+    mOctreeData = std::move(octree);
+    addOctreeLRU();
+}
+
+void LLVolumeFace::startOctreeBuild()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME
+
+    LL::WorkQueue::ptr_t general_queue = LL::WorkQueue::getInstance("General");
+    if (!general_queue)
+    {
+        createOctree();
+        return;
+    }
+
+    std::shared_ptr<OctreeData> octree = std::make_shared<OctreeData>();
+    octree->mPositions = (LLVector4a*)ll_aligned_malloc_16(sizeof(LLVector4a) * mNumVertices);
+    LLVector4a::memcpyNonAliased16((F32*)octree->mPositions, (F32*)mPositions, sizeof(LLVector4a) * mNumVertices);
+    octree->mBytes = sizeof(LLVector4a) * mNumVertices;
+    std::vector<U16> indices(mIndices, mIndices + mNumIndices);
+
+    {
+        LLMutexLock lock(&sOctreeMutex);
+        mOctreeBuild = octree;
+    }
+
+    bool posted = general_queue->post([octree, indices = std::move(indices)]()
+        {
+            if (!octree->mCancelled)
+            {
+                octree->build(octree->mPositions, indices.data(), (U32)indices.size(),
+                              0.25f, LLVector4a(0, 0, 0), LLVector4a(0.5f, 0.5f, 0.5f));
+                octree->mReady = true;
+            }
+        });
+
+    if (!posted)
+    { // queue is shutting down
+        {
+            LLMutexLock lock(&sOctreeMutex);
+            mOctreeBuild.reset();
+        }
+        createOctree();
+    }
+}
+
+void LLVolumeFace::addOctreeLRU()
+{
+    // sOctreeMutex must be held
+    if (mInOctreeLRU)
+    {
+        sOctreeLRU.splice(sOctreeLRU.begin(), sOctreeLRU, mOctreeLRUIter);
+        return;
+    }
+
+    sOctreeLRU.push_front(this);
+    mOctreeLRUIter = sOctreeLRU.begin();
+    mInOctreeLRU = true;
+    sOctreeMemory += mOctreeData->mBytes;
+
+    // evict from the cold end, never the face being queried
+    while (sOctreeBudget && sOctreeMemory > sOctreeBudget && sOctreeLRU.size() > 1)
+    {
+        LLVolumeFace* face = sOctreeLRU.back();
+        face->removeOctreeLRU();
+        face->mOctreeData.reset();
+    }
+}
+
+void LLVolumeFace::removeOctreeLRU()
+{
+    // sOctreeMutex must be held
+    if (mInOctreeLRU)
+    {
+        sOctreeMemory -= mOctreeData->mBytes;
+        sOctreeLRU.erase(mOctreeLRUIter);
+        mInOctreeLRU = false;
+    }
 }
 
 void LLVolumeFace::destroyOctree()
 {
-    delete mOctree;
-    mOctree = nullptr;
-    delete[] mOctreeTriangles;
-    mOctreeTriangles = nullptr;
+    LLMutexLock lock(&sOctreeMutex);
+    if (mOctreeBuild)
+    { // an in-flight build owns its own copy of the data, let it finish into the void
+        mOctreeBuild->mCancelled = true;
+        mOctreeBuild.reset();
+    }
+    if (mOctreeData)
+    {
+        removeOctreeLRU();
+        mOctreeData.reset();
+    }
+}
+
+std::shared_ptr<const LLVolumeOctree> LLVolumeFace::getOctree() const
+{
+    LLMutexLock lock(&sOctreeMutex);
+    if (!mOctreeData)
+    {
+        return nullptr;
+    }
+    // shares ownership of the OctreeData the tree lives in
+    return std::shared_ptr<const LLVolumeOctree>(mOctreeData, mOctreeData->mOctree);
+}
+
+bool LLVolumeFace::lineSegmentIntersect(const LLVector4a& start, const LLVector4a& dir, F32& closest_t,
+                                        LLVector4a* intersection, LLVector2* tex_coord, LLVector4a* normal, LLVector4a* tangent_out)
+{
+    std::shared_ptr<OctreeData> octree;
+    bool build = false;
+    {
+        LLMutexLock lock(&sOctreeMutex);
+        if (!mOctreeData && mOctreeBuild && mOctreeBuild->mReady)
+        {
+            mOctreeData = std::move(mOctreeBuild);
+        }
+
+        if (mOctreeData)
+        {
+            addOctreeLRU();
+            // hold a reference so an eviction from another thread can't free the tree mid-traversal
+            octree = mOctreeData;
+        }
+        else
+        {
+            build = !mOctreeBuild;
+        }
+    }
+
+    if (build)
+    {
+        startOctreeBuild();
+
+        LLMutexLock lock(&sOctreeMutex);
+        octree = mOctreeData;
+    }
+
+    if (!octree)
+    { // tree is still being built
+        return lineSegmentIntersectTriangles(start, dir, closest_t, intersection, tex_coord, normal, tangent_out);
+    }
+
+    LLOctreeTriangleRayIntersect intersect(start, dir, this, &closest_t, intersection, tex_coord, normal, tangent_out);
+    intersect.traverse(octree->mOctree);
+    return intersect.mHitFace;
+}
+
+bool LLVolumeFace::lineSegmentIntersectTriangles(const LLVector4a& start, const LLVector4a& dir, F32& closest_t,
+                                                 LLVector4a* intersection, LLVector2* tex_coord, LLVector4a* normal, LLVector4a* tangent_out)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME
+
+    bool hit = false;
+
+    U32 tri_count = mNumIndices/3;
+
+    for (U32 j = 0; j < tri_count; ++j)
+    {
+        U16 idx0 = mIndices[j*3+0];
+        U16 idx1 = mIndices[j*3+1];
+        U16 idx2 = mIndices[j*3+2];
+
+        const LLVector4a& v0 = mPositions[idx0];
+        const LLVector4a& v1 = mPositions[idx1];
+        const LLVector4a& v2 = mPositions[idx2];
+
+        F32 a,b,t;
+
+        if (LLTriangleRayIntersect(v0, v1, v2,
+                start, dir, a, b, t))
+        {
+            if ((t >= 0.f) &&      // if hit is after start
+                (t <= 1.f) &&      // and before end
+                (t < closest_t))   // and this hit is closer
+            {
+                closest_t = t;
+                hit = true;
+
+                if (intersection != NULL)
+                {
+                    LLVector4a intersect = dir;
+                    intersect.mul(closest_t);
+                    intersect.add(start);
+                    *intersection = intersect;
+                }
+
+
+                if (tex_coord != NULL)
+                {
+                    LLVector2* tc = (LLVector2*) mTexCoords;
+                    *tex_coord = ((1.f - a - b)  * tc[idx0] +
+                        a              * tc[idx1] +
+                        b              * tc[idx2]);
+
+                }
+
+                if (normal!= NULL)
+                {
+                    LLVector4a* norm = mNormals;
+
+                    LLVector4a n1,n2,n3;
+                    n1 = norm[idx0];
+                    n1.mul(1.f-a-b);
+
+                    n2 = norm[idx1];
+                    n2.mul(a);
+
+                    n3 = norm[idx2];
+                    n3.mul(b);
+
+                    n1.add(n2);
+                    n1.add(n3);
+
+                    *normal     = n1;
+                }
+
+                if (tangent_out != NULL)
+                {
+                    LLVector4a* tangents = mTangents;
+
+                    LLVector4a t1,t2,t3;
+                    t1 = tangents[idx0];
+                    t1.mul(1.f-a-b);
+
+                    t2 = tangents[idx1];
+                    t2.mul(a);
+
+                    t3 = tangents[idx2];
+                    t3.mul(b);
+
+                    t1.add(t2);
+                    t1.add(t3);
+
+                    *tangent_out = t1;
+                }
+            }
+        }
+    }
+
+    return hit;
+}
+
+//static
+U64 LLVolumeFace::getOctreeMemory()
+{
+    return sOctreeMemory;
 }
 
-const LLVolumeOctree* LLVolumeFace::getOctree() const
+//static
+void LLVolumeFace::setOctreeBudget(U64 bytes)
 {
-    return mOctree;
+    LLMutexLock lock(&sOctreeMutex);
+    sOctreeBudget = bytes;
 }
 
 
@@ -28,6 +28,8 @@
 #define LL_LLVOLUME_H
 
 #include <iostream>
+#include <list>
+#include <memory>
 
 class LLProfileParams;
 class LLPathParams;
@@ -916,8 +918,26 @@ class LLVolumeFace
 
     void createOctree(F32 scaler = 0.25f, const LLVector4a& center = LLVector4a(0,0,0), const LLVector4a& size = LLVector4a(0.5f,0.5f,0.5f));
     void destroyOctree();
-    // Get a reference to the octree, which may be null
-    const LLVolumeOctree* getOctree() const;
+    // Get a reference to the octree, which may be null.  The reference keeps
+    // the tree alive if another thread evicts it from the LRU meanwhile.
+    std::shared_ptr<const LLVolumeOctree> getOctree() const;
+
+    // Ray test against this face, updating closest_t and the optional
+    // outputs on a closer hit.  The first query queues an octree build on
+    // the "General" thread pool (or builds it in place when there is no
+    // pool) and is answered by testing every triangle until the tree is
+    // ready.
+    bool lineSegmentIntersect(const LLVector4a& start, const LLVector4a& dir, F32& closest_t,
+                              LLVector4a* intersection, LLVector2* tex_coord, LLVector4a* normal, LLVector4a* tangent_out);
+    // Ray test against every triangle, no octree needed
+    bool lineSegmentIntersectTriangles(const LLVector4a& start, const LLVector4a& dir, F32& closest_t,
+                                       LLVector4a* intersection, LLVector2* tex_coord, LLVector4a* normal, LLVector4a* tangent_out);
+
+    // Bytes held by built face octrees across all faces
+    static U64 getOctreeMemory();
+    // Once face octrees hold more than this many bytes the least recently
+    // queried ones are released (0 for no limit)
+    static void setOctreeBudget(U64 bytes);
 
     enum
     {
@@ -986,8 +1006,18 @@ class LLVolumeFace
     LLVector3 mNormalizedScale = LLVector3(1,1,1);
 
 private:
-    LLVolumeOctree* mOctree;
-    LLVolumeTriangle* mOctreeTriangles;
+    struct OctreeData;
+
+    void startOctreeBuild();
+    void addOctreeLRU();
+    void removeOctreeLRU();
+
+    // Both guarded by the octree LRU mutex; mOctreeBuild is an async build
+    // that has not been adopted yet
+    std::shared_ptr<OctreeData> mOctreeData;
+    std::shared_ptr<OctreeData> mOctreeBuild;
+    std::list<LLVolumeFace*>::iterator mOctreeLRUIter;
+    bool mInOctreeLRU = false;
 
     BOOL createUnCutCubeCap(LLVolume* volume, BOOL partial_build = FALSE);
     BOOL createCap(LLVolume* volume, BOOL partial_build = FALSE);
@@ -0,0 +1,280 @@
+/**
+ * @file llflatbvh_test.cpp
+ * @brief Checks LLFlatBVH queries against the scalar box tests
+ *
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+
+#include "../llflatbvh.h"
+#include "../llcamera.h"
+#include "../llvolumeoctree.h"
+
+#include <map>
+#include <memory>
+#include <random>
+
+namespace
+{
+    typedef LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*> node_t;
+
+    const LLVector4a* node_bounds(const node_t* node)
+    {
+        return ((const LLVolumeOctreeListener*) node->getListener(0))->mBounds;
+    }
+
+    // random boxes of varying size spread over a region-sized volume
+    struct BoxTree
+    {
+        BoxTree(U32 count, U32 seed)
+            : mVerts(count * 3),
+              mObjects(new LLVolumeTriangle[count])
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<F32> pos(0.f, 256.f);
+            std::uniform_real_distribution<F32> extent(0.1f, 8.f);
+
+            mOctree = new LLVolumeOctree(LLVector4a(128.f, 128.f, 128.f), LLVector4a(128.f, 128.f, 128.f));
+
+            for (U32 i = 0; i < count; ++i)
+            {
+                LLVector4a center(pos(rng), pos(rng), pos(rng) * 0.5f);
+                LLVector4a half(extent(rng), extent(rng), extent(rng));
+
+                LLVector4a* v = &mVerts[i * 3];
+                v[0].setSub(center, half);
+                v[1].setAdd(center, half);
+                v[2] = center;
+
+                LLVolumeTriangle* tri = &mObjects[i];
+                tri->mV[0] = &v[0];
+                tri->mV[1] = &v[1];
+                tri->mV[2] = &v[2];
+                tri->mPositionGroup = center;
+                tri->mRadius = half.getLength3().getF32();
+                mOctree->insert(tri);
+            }
+
+            while (!mOctree->balance()) { }
+
+            LLVolumeOctreeRebound rebound;
+            rebound.traverse(mOctree);
+
+            mBVH.build(mOctree.get(), node_bounds,
+                [this](const node_t* node, S32 slot) { mSlots[node] = slot; });
+        }
+
+        std::vector<LLVector4a> mVerts;
+        std::unique_ptr<LLVolumeTriangle[]> mObjects;
+        LLPointer<LLVolumeOctree> mOctree;
+        LLFlatBVH mBVH;
+        std::map<const node_t*, S32> mSlots;
+    };
+
+    void setup_camera(LLCamera& camera, const LLVector3& origin, F32 yaw, F32 far_clip)
+    {
+        LLVector3 at(cosf(yaw), sinf(yaw), -0.2f);
+        at.normVec();
+        LLVector3 up(0.f, 0.f, 1.f);
+        LLVector3 left = up % at;
+        left.normVec();
+        up = at % left;
+
+        camera.setOrigin(origin);
+        camera.setAxes(at, left, up);
+        camera.setView(1.0f);
+        camera.setAspect(1.5f);
+        camera.setNear(0.5f);
+        camera.setFar(far_clip);
+
+        F32 half_h = tanf(camera.getView() * 0.5f) * camera.getNear();
+        F32 half_w = half_h * camera.getAspect();
+        LLVector3 near_center = origin + at * camera.getNear();
+
+        LLVector3 frust[8];
+        frust[0] = near_center + left * half_w - up * half_h;
+        frust[1] = near_center - left * half_w - up * half_h;
+        frust[2] = near_center - left * half_w + up * half_h;
+        frust[3] = near_center + left * half_w + up * half_h;
+        for (U32 i = 0; i < 4; ++i)
+        {
+            LLVector3 dir = frust[i] - origin;
+            dir.normVec();
+            frust[i + 4] = origin + dir * camera.getFar();
+        }
+        camera.calcAgentFrustumPlanes(frust);
+    }
+
+    // Walk the octree the way LLViewerOctreeCull does and compare every
+    // result the traversal would actually ask for.
+    void compare_cull(BoxTree& tree, LLCamera& camera, bool far_clip, const std::vector<U8>& results,
+                      const node_t* node, S32 parent_res, U32& checked)
+    {
+        if (parent_res == 0)
+        {
+            return;
+        }
+
+        const LLVector4a* bounds = node_bounds(node);
+        S32 res = parent_res;
+        if (parent_res == 1)
+        {
+            res = far_clip ? camera.AABBInFrustum(bounds[0], bounds[1])
+                           : camera.AABBInFrustumNoFarClip(bounds[0], bounds[1]);
+            tut::ensure_equals("frustum result", (S32) results[tree.mSlots[node]], res);
+            ++checked;
+        }
+
+        for (U32 i = 0; i < node->getChildCount(); ++i)
+        {
+            compare_cull(tree, camera, far_clip, results, node->getChild(i), res, checked);
+        }
+    }
+}
+
+namespace tut
+{
+    struct flatbvh
+    {
+    };
+    typedef test_group<flatbvh> flatbvh_t;
+    typedef flatbvh_t::object flatbvh_object_t;
+    tut::flatbvh_t tut_flatbvh("LLFlatBVH");
+
+    template<> template<>
+    void flatbvh_object_t::test<1>()
+    {
+        set_test_name("layout mirrors the octree");
+        BoxTree tree(5000, 7);
+
+        ensure("built", !tree.mBVH.isEmpty());
+        ensure_equals("root slot", tree.mSlots[tree.mOctree.get()], 0);
+
+        for (const auto& entry : tree.mSlots)
+        {
+            const node_t* node = entry.first;
+            S32 slot = entry.second;
+            ensure_equals("child count", tree.mBVH.getChildCount(slot), node->getChildCount());
+            for (U32 i = 0; i < node->getChildCount(); ++i)
+            {
+                S32 child = tree.mSlots[node->getChild(i)];
+                ensure_equals("children are contiguous", child, tree.mBVH.getFirstChild(slot) + (S32) i);
+                ensure("parent before child", child > slot);
+            }
+        }
+    }
+
+    template<> template<>
+    void flatbvh_object_t::test<2>()
+    {
+        set_test_name("frustum cull matches LLCamera");
+        BoxTree tree(5000, 11);
+        LLCamera camera;
+        std::vector<U8> results;
+
+        U32 checked = 0;
+        for (U32 view = 0; view < 16; ++view)
+        {
+            bool far_clip = view & 1;
+            setup_camera(camera, LLVector3(128.f, 128.f, 30.f), view * 0.4f, 96.f);
+            tree.mBVH.frustumCull(camera.getAgentPlanes(), camera.getActivePlaneMask(far_clip), results);
+            ensure_equals("one result per slot", (U32) results.size(), tree.mBVH.getSlotCount());
+
+            compare_cull(tree, camera, far_clip, results, tree.mOctree.get(), 1, checked);
+        }
+        ensure("tested something", checked > 16);
+    }
+
+    template<> template<>
+    void flatbvh_object_t::test<3>()
+    {
+        set_test_name("segment test matches LLLineSegmentBoxIntersect");
+        BoxTree tree(5000, 13);
+        std::mt19937 rng(17);
+        std::uniform_real_distribution<F32> pos(-20.f, 276.f);
+
+        U32 hits = 0;
+        for (U32 ray = 0; ray < 64; ++ray)
+        {
+            LLVector4a start(pos(rng), pos(rng), pos(rng) * 0.5f);
+            LLVector4a end(pos(rng), pos(rng), pos(rng) * 0.5f);
+
+            for (const auto& entry : tree.mSlots)
+            {
+                const node_t* node = entry.first;
+                U32 mask = tree.mBVH.segmentHitChildren(entry.second, start, end);
+                for (U32 i = 0; i < node->getChildCount(); ++i)
+                {
+                    const LLVector4a* bounds = node_bounds(node->getChild(i));
+                    bool expected = LLLineSegmentBoxIntersect(start, end, bounds[0], bounds[1]);
+                    ensure_equals("child hit", (mask >> i) & 1, expected ? 1U : 0U);
+                    hits += expected;
+                }
+                ensure_equals("no bits past the last child", mask >> node->getChildCount(), 0U);
+            }
+        }
+        ensure("segments hit something", hits > 0);
+    }
+
+    template<> template<>
+    void flatbvh_object_t::test<4>()
+    {
+        set_test_name("setBounds updates boxes in place");
+        BoxTree tree(500, 19);
+        LLCamera camera;
+        setup_camera(camera, LLVector3(128.f, 128.f, 30.f), 0.f, 96.f);
+
+        std::vector<U8> before;
+        tree.mBVH.frustumCull(camera.getAgentPlanes(), camera.getActivePlaneMask(true), before);
+        ensure("root starts in view", before[0] != 0);
+
+        // move everything far behind the camera
+        for (const auto& entry : tree.mSlots)
+        {
+            tree.mBVH.setBounds(entry.second, LLVector4a(-1000.f, 128.f, 30.f), LLVector4a(1.f, 1.f, 1.f));
+        }
+
+        std::vector<U8> results;
+        tree.mBVH.frustumCull(camera.getAgentPlanes(), camera.getActivePlaneMask(true), results);
+        for (const auto& entry : tree.mSlots)
+        {
+            ensure_equals("moved box is outside", (S32) results[entry.second], 0);
+        }
+
+        // and back again
+        for (const auto& entry : tree.mSlots)
+        {
+            const LLVector4a* bounds = node_bounds(entry.first);
+            tree.mBVH.setBounds(entry.second, bounds[0], bounds[1]);
+        }
+
+        tree.mBVH.frustumCull(camera.getAgentPlanes(), camera.getActivePlaneMask(true), results);
+        for (const auto& entry : tree.mSlots)
+        {
+            ensure_equals("restored box", results[entry.second], before[entry.second]);
+        }
+    }
+}
@@ -0,0 +1,554 @@
+/**
+ * @file llvertexkernels_test.cpp
+ * @brief Checks the vertex stream kernels against the per-vertex code
+ *
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+
+#include "../llvertexkernels.h"
+#include "lltimer.h"
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // The loops below are the per-vertex code from
+    // LLFace::getGeometryVolume() that the kernels replace.
+
+    void ref_positions(const LLMatrix4a& mat_vert, const LLVector4a* src, S32 num_vertices,
+                       F32 val, LLVector4a* out, S32 geom_count)
+    {
+        const LLVector4a* end = src + num_vertices;
+        F32* dst = (F32*) out;
+        F32* end_f32 = dst + geom_count * 4;
+
+        LLVector4a res0;
+        res0.clear();
+
+        LLVector4Logical mask;
+        mask.clear();
+        mask.setElement<3>();
+
+        LLVector4a texIdx;
+        texIdx.set(0, 0, 0, val);
+
+        LLVector4a tmp;
+
+        while (src < end)
+        {
+            mat_vert.affineTransform(*src++, res0);
+            tmp.setSelectWithMask(mask, texIdx, res0);
+            tmp.store4a((F32*) dst);
+            dst += 4;
+        }
+
+        while (dst < end_f32)
+        {
+            res0.store4a((F32*) dst);
+            dst += 4;
+        }
+    }
+
+    void ref_normals(const LLMatrix4a& mat_normal, const LLVector4a* src, S32 num_vertices, LLVector4a* out)
+    {
+        F32* normals = (F32*) out;
+        const LLVector4a* end = src + num_vertices;
+
+        while (src < end)
+        {
+            LLVector4a normal;
+            mat_normal.rotate(*src++, normal);
+            normal.store4a(normals);
+            normals += 4;
+        }
+    }
+
+    void ref_tangents(const LLMatrix4a& mat_normal, const LLVector4a* src, S32 num_vertices, LLVector4a* out)
+    {
+        F32* tangents = (F32*) out;
+
+        LLVector4Logical mask;
+        mask.clear();
+        mask.setElement<3>();
+
+        const LLVector4a* end = src + num_vertices;
+
+        while (src < end)
+        {
+            LLVector4a tangent_out;
+            mat_normal.rotate(*src, tangent_out);
+            tangent_out.setSelectWithMask(mask, *src, tangent_out);
+            tangent_out.store4a(tangents);
+
+            src++;
+            tangents += 4;
+        }
+    }
+
+    void planarProjection(LLVector2 &tc, const LLVector4a& normal,
+                          const LLVector4a &center, const LLVector4a& vec)
+    {
+        LLVector4a binormal;
+        F32 d = normal[0];
+
+        if (d >= 0.5f || d <= -0.5f)
+        {
+            if (d < 0)
+            {
+                binormal.set(0,-1,0);
+            }
+            else
+            {
+                binormal.set(0, 1, 0);
+            }
+        }
+        else
+        {
+            if (normal[1] > 0)
+            {
+                binormal.set(-1,0,0);
+            }
+            else
+            {
+                binormal.set(1,0,0);
+            }
+        }
+        LLVector4a tangent;
+        tangent.setCross3(binormal,normal);
+
+        tc.mV[1] = -((tangent.dot3(vec).getF32())*2 - 0.5f);
+        tc.mV[0] = 1.0f+((binormal.dot3(vec).getF32())*2 - 0.5f);
+    }
+
+    void xform(LLVector2 &tex_coord, F32 cosAng, F32 sinAng, F32 offS, F32 offT, F32 magS, F32 magT)
+    {
+        F32 s = tex_coord.mV[0];
+        F32 t = tex_coord.mV[1];
+
+        s -= 0.5;
+        t -= 0.5;
+
+        F32 temp = s;
+        s  = s     * cosAng + t * sinAng;
+        t  = -temp * sinAng + t * cosAng;
+
+        s *= magS;
+        t *= magT;
+
+        s += offS + 0.5f;
+        t += offT + 0.5f;
+
+        tex_coord.mV[0] = s;
+        tex_coord.mV[1] = t;
+    }
+
+    void xform4a(LLVector4a &tex_coord, const LLVector4a& trans, const LLVector4Logical& mask, const LLVector4a& rot0, const LLVector4a& rot1, const LLVector4a& offset, const LLVector4a& scale)
+    {
+        LLVector4a st;
+        st.setAdd(tex_coord, trans);
+
+        LLVector4a s0;
+        s0.splat(st, 0);
+        LLVector4a s1;
+        s1.splat(st, 2);
+        LLVector4a ss;
+        ss.setSelectWithMask(mask, s1, s0);
+
+        LLVector4a a;
+        a.setMul(rot0, ss);
+
+        LLVector4a t0;
+        t0.splat(st, 1);
+        LLVector4a t1;
+        t1.splat(st, 3);
+        LLVector4a tt;
+        tt.setSelectWithMask(mask, t1, t0);
+
+        LLVector4a b;
+        b.setMul(rot1, tt);
+
+        st.setAdd(a,b);
+        st.mul(scale);
+        tex_coord.setAdd(st, offset);
+    }
+
+    // the unplanar fast path works on pairs, so callers pad odd counts
+    void ref_xform4a(const LLVector2* tc_in, S32 num_vertices, F32 cos_ang, F32 sin_ang,
+                     F32 os, F32 ot, F32 ms, F32 mt, LLVector2* out)
+    {
+        F32* dst = (F32*) out;
+        const F32* src = (const F32*) tc_in;
+
+        LLVector4a trans;
+        trans.splat(-0.5f);
+        LLVector4a rot0;
+        rot0.set(cos_ang, -sin_ang, cos_ang, -sin_ang);
+        LLVector4a rot1;
+        rot1.set(sin_ang, cos_ang, sin_ang, cos_ang);
+        LLVector4a scale;
+        scale.set(ms, mt, ms, mt);
+        LLVector4a offset;
+        offset.set(os+0.5f, ot+0.5f, os+0.5f, ot+0.5f);
+
+        LLVector4Logical mask;
+        mask.clear();
+        mask.setElement<2>();
+        mask.setElement<3>();
+
+        U32 count = num_vertices/2 + num_vertices%2;
+
+        for (U32 i = 0; i < count; i++)
+        {
+            LLVector4a res;
+            res.loadua(src);
+            src += 4;
+            xform4a(res, trans, mask, rot0, rot1, offset, scale);
+            _mm_storeu_ps(dst, res);
+            dst += 4;
+        }
+    }
+
+    LLMatrix4a random_matrix(std::mt19937& rng)
+    {
+        std::uniform_real_distribution<F32> dist(-4.f, 4.f);
+        LLMatrix4a mat;
+        for (U32 i = 0; i < 4; ++i)
+        {
+            mat.mMatrix[i].set(dist(rng), dist(rng), dist(rng), dist(rng));
+        }
+        return mat;
+    }
+
+    // Vertex streams shaped like the faces getGeometryVolume() sees.  Counts
+    // are deliberately not multiples of the kernel widths.
+    struct Face
+    {
+        std::string mName;
+        std::vector<LLVector4a> mPositions;
+        std::vector<LLVector4a> mNormals;
+        std::vector<LLVector4a> mTangents;
+        std::vector<LLVector2> mTexCoords;
+
+        S32 size() const { return (S32) mPositions.size(); }
+
+        void add(const LLVector3& pos, const LLVector3& normal, const LLVector2& tc, F32 sign)
+        {
+            mPositions.emplace_back(pos.mV[0], pos.mV[1], pos.mV[2]);
+            mNormals.emplace_back(normal.mV[0], normal.mV[1], normal.mV[2]);
+            LLVector3 tangent = normal % LLVector3(0.f, 0.f, 1.f);
+            if (tangent.lengthSquared() < 0.001f)
+            {
+                tangent.set(1.f, 0.f, 0.f);
+            }
+            tangent.normVec();
+            mTangents.emplace_back(tangent.mV[0], tangent.mV[1], tangent.mV[2], sign);
+            mTexCoords.push_back(tc);
+        }
+    };
+
+    // one side of a subdivided prim box
+    Face make_box_side(const LLVector3& normal, U32 steps)
+    {
+        Face face;
+        face.mName = "box";
+        LLVector3 u(normal.mV[1], normal.mV[2], normal.mV[0]);
+        LLVector3 v = normal % u;
+        for (U32 i = 0; i <= steps; ++i)
+        {
+            for (U32 j = 0; j <= steps; ++j)
+            {
+                F32 s = (F32) i / steps;
+                F32 t = (F32) j / steps;
+                LLVector3 pos = normal * 0.5f + u * (s - 0.5f) + v * (t - 0.5f);
+                face.add(pos, normal, LLVector2(s, t), 1.f);
+            }
+        }
+        return face;
+    }
+
+    // latitude/longitude prim sphere, which sweeps through every
+    // binormal choice of the planar mapping
+    Face make_sphere(U32 rings, U32 segments)
+    {
+        Face face;
+        face.mName = "sphere";
+        for (U32 i = 0; i <= rings; ++i)
+        {
+            F32 phi = F_PI * i / rings;
+            for (U32 j = 0; j <= segments; ++j)
+            {
+                F32 theta = F_TWO_PI * j / segments;
+                LLVector3 n(sinf(phi) * cosf(theta), sinf(phi) * sinf(theta), cosf(phi));
+                face.add(n * 0.5f, n, LLVector2((F32) j / segments, (F32) i / rings), j % 2 ? 1.f : -1.f);
+            }
+        }
+        return face;
+    }
+
+    // unstructured mesh upload: arbitrary normals, including ones sitting
+    // exactly on the planar mapping's decision boundaries
+    Face make_mesh(U32 count, U32 seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<F32> unit(-1.f, 1.f);
+        std::uniform_real_distribution<F32> tc(-2.f, 3.f);
+
+        const F32 edges[] = { 0.5f, -0.5f, 0.f, -0.f, 1.f, -1.f };
+
+        Face face;
+        face.mName = "mesh";
+        for (U32 i = 0; i < count; ++i)
+        {
+            LLVector3 n(unit(rng), unit(rng), unit(rng));
+            if (i % 7 == 0)
+            {
+                n.mV[0] = edges[(i / 7) % LL_ARRAY_SIZE(edges)];
+            }
+            if (i % 11 == 0)
+            {
+                n.mV[1] = edges[(i / 11) % LL_ARRAY_SIZE(edges)];
+            }
+            LLVector3 pos(unit(rng) * 8.f, unit(rng) * 8.f, unit(rng) * 8.f);
+            face.add(pos, n, LLVector2(tc(rng), tc(rng)), unit(rng) < 0.f ? -1.f : 1.f);
+        }
+        return face;
+    }
+
+    std::vector<Face> make_faces()
+    {
+        std::vector<Face> faces;
+        faces.push_back(make_box_side(LLVector3(1.f, 0.f, 0.f), 8));
+        faces.push_back(make_box_side(LLVector3(0.f, -1.f, 0.f), 8));
+        faces.push_back(make_box_side(LLVector3(0.f, 0.f, 1.f), 1));
+        faces.push_back(make_sphere(24, 24));
+        faces.push_back(make_mesh(1237, 17));
+        faces.push_back(make_mesh(3, 18));
+        faces.push_back(make_mesh(1, 19));
+        return faces;
+    }
+
+    template <class T>
+    bool same_bits(const std::vector<T>& a, const std::vector<T>& b, size_t count)
+    {
+        return a.size() >= count && b.size() >= count &&
+            memcmp(a.data(), b.data(), count * sizeof(T)) == 0;
+    }
+}
+
+namespace tut
+{
+    struct vertexkernels
+    {
+        vertexkernels()
+            : mFaces(make_faces()),
+              mRNG(4242)
+        {
+        }
+
+        std::vector<Face> mFaces;
+        std::mt19937 mRNG;
+    };
+
+    typedef test_group<vertexkernels> vertexkernels_t;
+    typedef vertexkernels_t::object vertexkernels_object_t;
+    tut::vertexkernels_t tut_vertexkernels("LLVertexKernels");
+
+    template<> template<>
+    void vertexkernels_object_t::test<1>()
+    {
+        set_test_name("positions, normals and tangents match");
+
+        for (const Face& face : mFaces)
+        {
+            const S32 count = face.size();
+            const LLMatrix4a mat = random_matrix(mRNG);
+
+            S32 idx = 3;
+            F32 tex_index;
+            memcpy(&tex_index, &idx, sizeof(F32));
+
+            // geometry slots past the face's vertices get the last position
+            const S32 geom_count = count + 5;
+            std::vector<LLVector4a> expected(geom_count), actual(geom_count);
+            ref_positions(mat, face.mPositions.data(), count, tex_index, expected.data(), geom_count);
+            LLVertexKernels::transformPositions(mat, face.mPositions.data(), count, tex_index, actual.data(), geom_count);
+            ensure(face.mName + " positions", same_bits(expected, actual, geom_count));
+
+            ref_normals(mat, face.mNormals.data(), count, expected.data());
+            LLVertexKernels::rotateNormals(mat, face.mNormals.data(), count, actual.data());
+            ensure(face.mName + " normals", same_bits(expected, actual, count));
+
+            ref_tangents(mat, face.mTangents.data(), count, expected.data());
+            LLVertexKernels::rotateTangents(mat, face.mTangents.data(), count, actual.data());
+            ensure(face.mName + " tangents", same_bits(expected, actual, count));
+        }
+    }
+
+    template<> template<>
+    void vertexkernels_object_t::test<2>()
+    {
+        set_test_name("planar texture coordinates match");
+
+        const LLVector4a center(0.f, 0.f, 0.f);
+        const LLVector4a scales[] =
+        {
+            LLVector4a(1.f, 1.f, 1.f),
+            LLVector4a(0.5f, 3.f, 10.f),
+            LLVector4a(64.f, 0.01f, 2.5f)
+        };
+
+        for (const Face& face : mFaces)
+        {
+            const S32 count = face.size();
+            for (const LLVector4a& scalea : scales)
+            {
+                std::vector<LLVector2> expected(count), actual(count);
+                for (S32 i = 0; i < count; i++)
+                {
+                    LLVector2 tc(face.mTexCoords[i]);
+                    LLVector4a vec = face.mPositions[i];
+                    vec.mul(scalea);
+                    planarProjection(tc, face.mNormals[i], center, vec);
+                    expected[i] = tc;
+                }
+
+                LLVertexKernels::planarTexCoords(face.mNormals.data(), face.mPositions.data(), scalea, count, actual.data());
+                ensure(face.mName + " planar", same_bits(expected, actual, count));
+            }
+        }
+    }
+
+    template<> template<>
+    void vertexkernels_object_t::test<3>()
+    {
+        set_test_name("texture transforms match");
+
+        std::uniform_real_distribution<F32> dist(-3.f, 3.f);
+
+        for (const Face& face : mFaces)
+        {
+            const S32 count = face.size();
+
+            F32 r = dist(mRNG);
+            F32 cos_ang = cos(r);
+            F32 sin_ang = sin(r);
+            F32 os = dist(mRNG), ot = dist(mRNG), ms = dist(mRNG), mt = dist(mRNG);
+
+            // scalar transform used after planar mapping
+            std::vector<LLVector2> expected(face.mTexCoords), actual(count);
+            for (S32 i = 0; i < count; ++i)
+            {
+                xform(expected[i], cos_ang, sin_ang, os, ot, ms, mt);
+            }
+            LLVertexKernels::xformTexCoords(face.mTexCoords.data(), count, cos_ang, sin_ang, os, ot, ms, mt, actual.data());
+            ensure(face.mName + " xform", same_bits(expected, actual, count));
+
+            // paired transform used for the default mapping
+            std::vector<LLVector2> padded(face.mTexCoords);
+            padded.resize(count + 1);
+            std::vector<LLVector2> paired(count + 1);
+            ref_xform4a(padded.data(), count, cos_ang, sin_ang, os, ot, ms, mt, paired.data());
+            ensure(face.mName + " xform4a", same_bits(paired, actual, count));
+
+            // in place
+            actual = face.mTexCoords;
+            LLVertexKernels::xformTexCoords(actual.data(), count, cos_ang, sin_ang, os, ot, ms, mt, actual.data());
+            ensure(face.mName + " xform in place", same_bits(expected, actual, count));
+
+            // animated texture matrix
+            const LLMatrix4a mat = random_matrix(mRNG);
+            for (S32 i = 0; i < count; ++i)
+            {
+                LLVector4a tc(face.mTexCoords[i].mV[VX], face.mTexCoords[i].mV[VY], 0.f);
+                mat.affineTransform(tc, tc);
+                expected[i].set(tc.getF32ptr());
+            }
+            LLVertexKernels::transformTexCoords(mat, face.mTexCoords.data(), count, actual.data());
+            ensure(face.mName + " texture matrix", same_bits(expected, actual, count));
+        }
+    }
+
+    template<> template<>
+    void vertexkernels_object_t::test<4>()
+    {
+        set_test_name("vertex stream benchmark");
+
+        // roughly what a region's worth of rebuilt faces pushes through
+        Face face = make_mesh(20000, 23);
+        const S32 count = face.size();
+        const LLMatrix4a mat = random_matrix(mRNG);
+        const LLVector4a center(0.f, 0.f, 0.f);
+        const LLVector4a scalea(2.f, 3.f, 4.f);
+
+        std::vector<LLVector4a> verts(count), norms(count), tangents(count);
+        std::vector<LLVector2> tcs(count + 1);
+
+        const U32 passes = 100;
+        LLTimer timer;
+        for (U32 pass = 0; pass < passes; ++pass)
+        {
+            ref_positions(mat, face.mPositions.data(), count, 0.f, verts.data(), count);
+            ref_normals(mat, face.mNormals.data(), count, norms.data());
+            ref_tangents(mat, face.mTangents.data(), count, tangents.data());
+            for (S32 i = 0; i < count; i++)
+            {
+                LLVector2 tc(face.mTexCoords[i]);
+                LLVector4a vec = face.mPositions[i];
+                vec.mul(scalea);
+                planarProjection(tc, face.mNormals[i], center, vec);
+                xform(tc, 0.8f, 0.6f, 0.1f, 0.2f, 2.f, 2.f);
+                tcs[i] = tc;
+            }
+        }
+        const F64 scalar_ms = timer.getElapsedTimeF64() * 1000.0 / passes;
+
+        std::vector<LLVector4a> kverts(count), knorms(count), ktangents(count);
+        std::vector<LLVector2> ktcs(count + 1);
+
+        timer.reset();
+        for (U32 pass = 0; pass < passes; ++pass)
+        {
+            LLVertexKernels::transformPositions(mat, face.mPositions.data(), count, 0.f, kverts.data(), count);
+            LLVertexKernels::rotateNormals(mat, face.mNormals.data(), count, knorms.data());
+            LLVertexKernels::rotateTangents(mat, face.mTangents.data(), count, ktangents.data());
+            LLVertexKernels::planarTexCoords(face.mNormals.data(), face.mPositions.data(), scalea, count, ktcs.data());
+            LLVertexKernels::xformTexCoords(ktcs.data(), count, 0.8f, 0.6f, 0.1f, 0.2f, 2.f, 2.f, ktcs.data());
+        }
+        const F64 kernel_ms = timer.getElapsedTimeF64() * 1000.0 / passes;
+
+        ensure("positions", same_bits(verts, kverts, count));
+        ensure("normals", same_bits(norms, knorms, count));
+        ensure("tangents", same_bits(tangents, ktangents, count));
+        ensure("texture coordinates", same_bits(tcs, ktcs, count));
+
+        LL_INFOS("Benchmark") << count << " vertices: " << scalar_ms << " ms per-vertex, "
+            << kernel_ms << " ms kernels" << LL_ENDL;
+    }
+}
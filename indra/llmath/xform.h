@@ -147,6 +147,14 @@ class LLXformMatrix : public LLXform
     const LLMatrix4a&    getWorldMatrix() const      { return mWorldMatrix; }
     void setWorldMatrix (const LLMatrix4a& mat)   { mWorldMatrix = mat; }
 
+    // Store a world transform evaluated elsewhere, see LLSkeletonPose
+    void setWorldTransform(const LLVector3& pos, const LLQuaternion& rot, const LLMatrix4a& mat)
+    {
+        mWorldPosition = pos;
+        mWorldRotation = rot;
+        mWorldMatrix = mat;
+    }
+
     void init()
     {
         mWorldMatrix.setIdentity();
@@ -32,10 +32,14 @@
 #include "llcoproceduremanager.h"
 
 #include <chrono>
+#include <mutex>
+#include <set>
 
 #include <boost/fiber/buffered_channel.hpp>
 
 #include "llexception.h"
+#include "lltimer.h"
+#include "lltrace.h"
 #include "stringize.h"
 
 //=========================================================================
@@ -52,11 +56,34 @@ static const U32 DEFAULT_POOL_SIZE = 5;
 // unlimited.
 const U32 LLCoprocedureManager::DEFAULT_QUEUE_SIZE = 1024*1024;
 
+// Time spent waiting in the queue.  Trace handles have to be statically
+// initialized, so the known pools get their own and everything else shares
+// one.
+static LLTrace::EventStatHandle<F64Milliseconds> sQueueLatencyUpload("coprocqueuelatencyupload", "Time Upload coprocedures waited to run");
+static LLTrace::EventStatHandle<F64Milliseconds> sQueueLatencyAIS("coprocqueuelatencyais", "Time AIS coprocedures waited to run");
+static LLTrace::EventStatHandle<F64Milliseconds> sQueueLatencyExpCache("coprocqueuelatencyexpcache", "Time ExpCache coprocedures waited to run");
+static LLTrace::EventStatHandle<F64Milliseconds> sQueueLatencyAssetStorage("coprocqueuelatencyassetstorage", "Time AssetStorage coprocedures waited to run");
+static LLTrace::EventStatHandle<F64Milliseconds> sQueueLatencyOther("coprocqueuelatency", "Time coprocedures in other pools waited to run");
+
+static LLTrace::EventStatHandle<F64Milliseconds>& queue_latency_stat(const std::string &poolName)
+{
+    if (poolName == "Upload")
+        return sQueueLatencyUpload;
+    if (poolName == "AIS")
+        return sQueueLatencyAIS;
+    if (poolName == "ExpCache")
+        return sQueueLatencyExpCache;
+    if (poolName == "AssetStorage")
+        return sQueueLatencyAssetStorage;
+    return sQueueLatencyOther;
+}
+
 //=========================================================================
 class LLCoprocedurePool: private boost::noncopyable
 {
 public:
     typedef LLCoprocedureManager::CoProcedure_t CoProcedure_t;
+    typedef LLCoprocedureManager::QueueOptions QueueOptions;
 
     LLCoprocedurePool(const std::string &name, size_t size);
     ~LLCoprocedurePool() = default;
@@ -65,9 +92,10 @@ class LLCoprocedurePool: private boost::noncopyable
     ///
     /// @param name Is used for debugging and should identify this coroutine.
     /// @param proc Is a bound function to be executed
+    /// @param options Priority, timeout and coalescing key
     ///
     /// @return This method returns a UUID that can be used later to cancel execution.
-    LLUUID enqueueCoprocedure(const std::string &name, CoProcedure_t proc);
+    LLUUID enqueueCoprocedure(const std::string &name, CoProcedure_t proc, const QueueOptions &options);
 
     /// Returns the number of coprocedures in the queue awaiting processing.
     ///
@@ -90,6 +118,8 @@ class LLCoprocedurePool: private boost::noncopyable
         return countPending() + countActive();
     }
 
+    LLSD getQueueStats() const;
+
     void close();
 
 private:
@@ -97,25 +127,86 @@ class LLCoprocedurePool: private boost::noncopyable
     {
         typedef std::shared_ptr<QueuedCoproc> ptr_t;
 
-        QueuedCoproc(const std::string &name, const LLUUID &id, CoProcedure_t proc) :
+        QueuedCoproc(const std::string &name, const LLUUID &id, CoProcedure_t proc,
+                     const QueueOptions &options, U64 sequence) :
             mName(name),
             mId(id),
-            mProc(proc)
-        {}
+            mProc(proc),
+            mPriority(options.mPriority),
+            mSequence(sequence),
+            mKey(options.mKey),
+            mEnqueueTime(LLTimer::getTotalSeconds()),
+            mExpiry(0.0)
+        {
+            if (options.mTimeout > F64Seconds(0.0))
+            {
+                mExpiry = mEnqueueTime + options.mTimeout;
+            }
+        }
+
+        bool isExpired(F64Seconds now) const
+        {
+            return mExpiry > F64Seconds(0.0) && now > mExpiry;
+        }
+
+        // Highest priority first, then in order of arrival.
+        struct Compare
+        {
+            bool operator()(const ptr_t &lhs, const ptr_t &rhs) const
+            {
+                if (lhs->mPriority != rhs->mPriority)
+                {
+                    return lhs->mPriority > rhs->mPriority;
+                }
+                return lhs->mSequence < rhs->mSequence;
+            }
+        };
 
         std::string mName;
         LLUUID mId;
         CoProcedure_t mProc;
+        S32 mPriority;
+        U64 mSequence;
+        std::string mKey;
+        F64Seconds mEnqueueTime;
+        F64Seconds mExpiry;
     };
 
     // we use a buffered_channel here rather than unbuffered_channel since we want to be able to
     // push values without blocking,even if there's currently no one calling a pop operation (due to
-    // fiber running right now)
-    typedef boost::fibers::buffered_channel<QueuedCoproc::ptr_t>  CoprocQueue_t;
-    // Use shared_ptr to control the lifespan of our CoprocQueue_t instance
+    // fiber running right now).  The channel carries one token per queued coprocedure and is only
+    // used to wake the invoker coroutines; the coprocedure itself is taken from the ordered set.
+    typedef boost::fibers::buffered_channel<U8> CoprocQueue_t;
+
+    struct PendingCoprocs
+    {
+        typedef std::set<QueuedCoproc::ptr_t, QueuedCoproc::Compare> queue_t;
+        typedef std::map<std::string, QueuedCoproc::ptr_t> keyed_t;
+
+        PendingCoprocs(size_t capacity) :
+            mTokens(capacity),
+            mSequence(0)
+        {}
+
+        /// Removes the highest priority coprocedure.  The caller's
+        /// pointer holds the last reference so that nothing is
+        /// destroyed while mMutex is held.
+        QueuedCoproc::ptr_t takeNext();
+
+        CoprocQueue_t   mTokens;
+        std::mutex      mMutex;
+        queue_t         mQueue;
+        keyed_t         mKeyed;
+        U64             mSequence;
+    };
+
+    // Use shared_ptr to control the lifespan of our PendingCoprocs instance
     // because the consuming coroutine might outlive this LLCoprocedurePool
     // instance.
-    typedef std::shared_ptr<CoprocQueue_t> CoprocQueuePtr;
+    typedef std::shared_ptr<PendingCoprocs> CoprocQueuePtr;
+
+    // Bin i counts latencies below 2^i ms, the last bin takes the rest.
+    static const S32 LATENCY_BIN_COUNT = 16;
 
     std::string     mPoolName;
     size_t          mPoolSize, mActiveCoprocsCount, mPending;
@@ -127,6 +218,13 @@ class LLCoprocedurePool: private boost::noncopyable
 
     CoroAdapterMap_t mCoroMapping;
 
+    LLTrace::EventStatHandle<F64Milliseconds>& mLatencyStat;
+    U32             mLatencyBins[LATENCY_BIN_COUNT];
+    U32             mCoalescedCount;
+    U32             mExpiredCount;
+
+    void recordLatency(F64Seconds latency);
+
     void coprocedureInvokerCoro(CoprocQueuePtr pendingCoprocs,
                                 LLCoreHttpUtil::HttpCoroutineAdapter::ptr_t httpAdapter);
 };
@@ -183,6 +281,11 @@ void LLCoprocedureManager::initializePool(const std::string &poolName)
 
 //-------------------------------------------------------------------------
 LLUUID LLCoprocedureManager::enqueueCoprocedure(const std::string &pool, const std::string &name, CoProcedure_t proc)
+{
+    return enqueueCoprocedure(pool, name, proc, QueueOptions());
+}
+
+LLUUID LLCoprocedureManager::enqueueCoprocedure(const std::string &pool, const std::string &name, CoProcedure_t proc, const QueueOptions &options)
 {
     // Attempt to find the pool and enqueue the procedure.  If the pool does
     // not exist, create it.
@@ -196,7 +299,7 @@ LLUUID LLCoprocedureManager::enqueueCoprocedure(const std::string &pool, const s
     }
 
     poolPtr_t targetPool = it->second;
-    return targetPool->enqueueCoprocedure(name, proc);
+    return targetPool->enqueueCoprocedure(name, proc, options);
 }
 
 void LLCoprocedureManager::setPropertyMethods(SettingQuery_t queryfn, SettingUpdate_t updatefn)
@@ -272,6 +375,15 @@ size_t LLCoprocedureManager::count(const std::string &pool) const
     return it->second->count();
 }
 
+LLSD LLCoprocedureManager::getQueueStats(const std::string &pool) const
+{
+    poolMap_t::const_iterator it = mPoolMap.find(pool);
+
+    if (it == mPoolMap.end())
+        return LLSD();
+    return it->second->getQueueStats();
+}
+
 void LLCoprocedureManager::close()
 {
     for(auto & poolEntry : mPoolMap)
@@ -295,10 +407,15 @@ LLCoprocedurePool::LLCoprocedurePool(const std::string &poolName, size_t size):
     mPoolSize(size),
     mActiveCoprocsCount(0),
     mPending(0),
-    mPendingCoprocs(std::make_shared<CoprocQueue_t>(LLCoprocedureManager::DEFAULT_QUEUE_SIZE)),
+    mPendingCoprocs(std::make_shared<PendingCoprocs>(LLCoprocedureManager::DEFAULT_QUEUE_SIZE)),
     mHTTPPolicy(LLCore::HttpRequest::DEFAULT_POLICY_ID),
-    mCoroMapping()
+    mCoroMapping(),
+    mLatencyStat(queue_latency_stat(poolName)),
+    mCoalescedCount(0),
+    mExpiredCount(0)
 {
+    std::fill_n(mLatencyBins, LATENCY_BIN_COUNT, 0);
+
     try
     {
         // store in our LLTempBoundListener so that when the LLCoprocedurePool is
@@ -316,7 +433,7 @@ LLCoprocedurePool::LLCoprocedurePool(const std::string &poolName, size_t size):
                                       << LL_ENDL;
                 // This should ensure that all waiting coprocedures in this
                 // pool will wake up and terminate.
-                pendingCoprocs->close();
+                pendingCoprocs->mTokens.close();
             }
             return false;
         });
@@ -350,9 +467,45 @@ LLCoprocedurePool::LLCoprocedurePool(const std::string &poolName, size_t size):
 }
 
 //-------------------------------------------------------------------------
-LLUUID LLCoprocedurePool::enqueueCoprocedure(const std::string &name, LLCoprocedurePool::CoProcedure_t proc)
+LLUUID LLCoprocedurePool::enqueueCoprocedure(const std::string &name, LLCoprocedurePool::CoProcedure_t proc, const QueueOptions &options)
 {
-    LLUUID id(LLUUID::generateNewID());
+    QueuedCoproc::ptr_t coproc;
+    {
+        std::lock_guard<std::mutex> lock(mPendingCoprocs->mMutex);
+
+        if (!options.mKey.empty())
+        {
+            PendingCoprocs::keyed_t::iterator it = mPendingCoprocs->mKeyed.find(options.mKey);
+            if (it != mPendingCoprocs->mKeyed.end())
+            {
+                // Coalesce with the one already waiting, promoting it if
+                // the new request is more urgent.
+                QueuedCoproc::ptr_t pending = it->second;
+                if (options.mPriority > pending->mPriority)
+                {
+                    mPendingCoprocs->mQueue.erase(pending);
+                    pending->mPriority = options.mPriority;
+                    mPendingCoprocs->mQueue.insert(pending);
+                }
+                if (options.mTimeout <= F64Seconds(0.0))
+                {
+                    pending->mExpiry = F64Seconds(0.0);
+                }
+                else if (pending->mExpiry > F64Seconds(0.0))
+                {
+                    pending->mExpiry = llmax(pending->mExpiry, F64Seconds(LLTimer::getTotalSeconds()) + options.mTimeout);
+                }
+                ++mCoalescedCount;
+
+                LL_DEBUGS("CoProcMgr") << "Coprocedure(" << name << ") coalesced with id=" << pending->mId.asString()
+                                       << " in pool \"" << mPoolName << "\" key " << options.mKey << LL_ENDL;
+                return pending->mId;
+            }
+        }
+
+        coproc = std::make_shared<QueuedCoproc>(name, LLUUID::generateNewID(), proc, options, mPendingCoprocs->mSequence++);
+    }
+    LLUUID id(coproc->mId);
 
     if (mPoolName == "AIS")
     {
@@ -374,13 +527,39 @@ LLUUID LLCoprocedurePool::enqueueCoprocedure(const std::string &name, LLCoproced
         LL_INFOS("CoProcMgr") << "Coprocedure(" << name << ") enqueuing with id=" << id.asString() << " in pool \"" << mPoolName << "\" at "
                               << mPending << LL_ENDL;
     }
-    auto pushed = mPendingCoprocs->try_push(std::make_shared<QueuedCoproc>(name, id, proc));
+    {
+        std::lock_guard<std::mutex> lock(mPendingCoprocs->mMutex);
+        mPendingCoprocs->mQueue.insert(coproc);
+        if (!coproc->mKey.empty())
+        {
+            mPendingCoprocs->mKeyed[coproc->mKey] = coproc;
+        }
+        else
+        {
+            // This one may be a write (an AIS update, say) that the keyed
+            // reads queued ahead of it would miss.  Later reads must not
+            // fold into those.
+            mPendingCoprocs->mKeyed.clear();
+        }
+    }
+
+    auto pushed = mPendingCoprocs->mTokens.try_push(1);
     if (pushed == boost::fibers::channel_op_status::success)
     {
         ++mPending;
         return id;
     }
 
+    // No token, so nothing will ever take it.
+    {
+        std::lock_guard<std::mutex> lock(mPendingCoprocs->mMutex);
+        mPendingCoprocs->mQueue.erase(coproc);
+        if (!coproc->mKey.empty())
+        {
+            mPendingCoprocs->mKeyed.erase(coproc->mKey);
+        }
+    }
+
     // Here we didn't succeed in pushing. Shutdown could be the reason.
     if (pushed == boost::fibers::channel_op_status::closed)
     {
@@ -416,12 +595,14 @@ void LLCoprocedurePool::coprocedureInvokerCoro(
         // - which called enqueueCoprocedure()
         // - which tried to acquire the lock on pendingCoprocs... alas.
         // Using a fresh, clean ptr_t ensures that no previous value is
-        // destroyed during pop_wait_for().
+        // destroyed during pop_wait_for() or while takeNext() holds the
+        // queue mutex.
         QueuedCoproc::ptr_t coproc;
+        U8 token;
         boost::fibers::channel_op_status status;
         {
             LLCoros::TempStatus st("waiting for work for 10s");
-            status = pendingCoprocs->pop_wait_for(coproc, std::chrono::seconds(10));
+            status = pendingCoprocs->mTokens.pop_wait_for(token, std::chrono::seconds(10));
         }
         if (status == boost::fibers::channel_op_status::closed)
         {
@@ -435,6 +616,22 @@ void LLCoprocedurePool::coprocedureInvokerCoro(
         }
         // we actually popped an item
         --mPending;
+        coproc = pendingCoprocs->takeNext();
+        if (!coproc)
+        {
+            continue;
+        }
+
+        F64Seconds now(LLTimer::getTotalSeconds());
+        if (coproc->isExpired(now))
+        {
+            ++mExpiredCount;
+            LL_DEBUGS("CoProcMgr") << "Discarding coprocedure(" << coproc->mName << ") with id=" << coproc->mId.asString()
+                                   << " in pool \"" << mPoolName << "\" after waiting " << (now - coproc->mEnqueueTime) << LL_ENDL;
+            continue;
+        }
+        recordLatency(now - coproc->mEnqueueTime);
+
         mActiveCoprocsCount++;
 
 #ifdef SHOW_DEBUG
@@ -469,7 +666,64 @@ void LLCoprocedurePool::coprocedureInvokerCoro(
     }
 }
 
+void LLCoprocedurePool::recordLatency(F64Seconds latency)
+{
+    F64Milliseconds latency_ms(latency);
+    record(mLatencyStat, latency_ms);
+
+    S32 bin = 0;
+    for (F64 upper = 1.0; bin < LATENCY_BIN_COUNT - 1 && latency_ms.value() >= upper; upper *= 2.0)
+    {
+        ++bin;
+    }
+    ++mLatencyBins[bin];
+}
+
+LLSD LLCoprocedurePool::getQueueStats() const
+{
+    LLSD stats;
+    F64 upper = 1.0;
+    for (S32 bin = 0; bin < LATENCY_BIN_COUNT; ++bin, upper *= 2.0)
+    {
+        LLSD entry;
+        // Last bin is open ended
+        entry["below_ms"] = (bin < LATENCY_BIN_COUNT - 1) ? LLSD(upper) : LLSD();
+        entry["count"] = LLSD::Integer(mLatencyBins[bin]);
+        stats["latency"].append(entry);
+    }
+    stats["coalesced"] = LLSD::Integer(mCoalescedCount);
+    stats["expired"] = LLSD::Integer(mExpiredCount);
+    return stats;
+}
+
 void LLCoprocedurePool::close()
 {
-    mPendingCoprocs->close();
+    if (!mPendingCoprocs->mTokens.is_closed())
+    {
+        LL_INFOS("CoProcMgr") << "Pool \"" << mPoolName << "\" queue stats: " << getQueueStats() << LL_ENDL;
+    }
+    mPendingCoprocs->mTokens.close();
+}
+
+//-------------------------------------------------------------------------
+LLCoprocedurePool::QueuedCoproc::ptr_t LLCoprocedurePool::PendingCoprocs::takeNext()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mQueue.empty())
+    {
+        return QueuedCoproc::ptr_t();
+    }
+
+    QueuedCoproc::ptr_t coproc = *mQueue.begin();
+    mQueue.erase(mQueue.begin());
+    if (!coproc->mKey.empty())
+    {
+        keyed_t::iterator it = mKeyed.find(coproc->mKey);
+        if (it != mKeyed.end() && it->second == coproc)
+        {
+            mKeyed.erase(it);
+        }
+    }
+    return coproc;
 }
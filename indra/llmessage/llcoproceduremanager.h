@@ -31,6 +31,7 @@
 #include "lleventcoro.h"
 #include "llcoros.h"
 #include "llcorehttputil.h"
+#include "llunits.h"
 #include "lluuid.h"
 
 class LLCoprocedurePool;
@@ -46,6 +47,36 @@ class LLCoprocedureManager final : public LLSingleton < LLCoprocedureManager >
 
     typedef boost::function<void(LLCoreHttpUtil::HttpCoroutineAdapter::ptr_t &, const LLUUID &id)> CoProcedure_t;
 
+    enum EPriority
+    {
+        PRIORITY_LOW = -100,
+        PRIORITY_NORMAL = 0,
+        PRIORITY_HIGH = 100
+    };
+
+    /// Scheduling hints for a queued coprocedure.  The defaults give the
+    /// original FIFO behavior.
+    struct QueueOptions
+    {
+        /// Higher values are dequeued first.  Equal priorities run in
+        /// the order they were queued.
+        S32 mPriority = PRIORITY_NORMAL;
+
+        /// If non-zero, the coprocedure is discarded without being run
+        /// when it has waited in the queue longer than this.
+        F64Seconds mTimeout = F64Seconds(0.0);
+
+        /// If non-empty, enqueueing while another coprocedure with the
+        /// same key is still pending does not queue the new proc.  The
+        /// pending one takes the higher of the two priorities and its
+        /// id is returned.  Only use keys for requests whose procs are
+        /// interchangeable: the coalesced proc (and any callback bound
+        /// into it) is dropped.  A coprocedure queued without a key may
+        /// change what the keyed ones would return, so nothing queued
+        /// after it coalesces with one queued before it.
+        std::string mKey;
+    };
+
     /// Places the coprocedure on the queue for processing.
     ///
     /// @param name Is used for debugging and should identify this coroutine.
@@ -53,6 +84,7 @@ class LLCoprocedureManager final : public LLSingleton < LLCoprocedureManager >
     ///
     /// @return This method returns a UUID that can be used later to cancel execution.
     LLUUID enqueueCoprocedure(const std::string &pool, const std::string &name, CoProcedure_t proc);
+    LLUUID enqueueCoprocedure(const std::string &pool, const std::string &name, CoProcedure_t proc, const QueueOptions &options);
 
     /// Cancel a coprocedure. If the coprocedure is already being actively executed
     /// this method calls cancelYieldingOperation() on the associated HttpAdapter
@@ -76,6 +108,11 @@ class LLCoprocedureManager final : public LLSingleton < LLCoprocedureManager >
     size_t count() const;
     size_t count(const std::string &pool) const;
 
+    /// Returns counts of dequeued coprocedures binned by the time they
+    /// spent waiting in the queue, along with coalesced and expired counts.
+    /// Mean/min/max latencies are also recorded through LLTrace.
+    LLSD getQueueStats(const std::string &pool) const;
+
     void close();
     void close(const std::string &pool);
 
@@ -26,6 +26,7 @@
 #include <utility>
 #include "_httpoprequest.h"
 #include "_httprequestqueue.h"
+#include "llpacketcapture.h"
 
 static boost::circular_buffer<LogPayload> sRingBuffer = boost::circular_buffer<LogPayload>(2048);
 
@@ -52,7 +53,7 @@ LLMessageLogEntry::LLMessageLogEntry(EEntryType etype, U8* data, size_t data_siz
     EHTTPMethod method, U8 status_code, U64 request_id)
 :   mType(etype)
 ,   mDataSize(data_size)
-,   mData(nullptr)
+,   mData(data)
 ,   mURL(std::move(url))
 ,   mContentType(std::move(content_type))
 ,   mHeaders(std::move(headers))
@@ -60,11 +61,6 @@ LLMessageLogEntry::LLMessageLogEntry(EEntryType etype, U8* data, size_t data_siz
 ,   mStatusCode(status_code)
 ,   mRequestId(request_id)
 {
-    if (data)
-    {
-        mData = new U8[data_size];
-        memcpy(mData, data, data_size);
-    }
 }
 
 
@@ -79,9 +75,13 @@ LLMessageLogEntry::LLMessageLogEntry(const LLMessageLogEntry& entry)
 ,   mMethod(entry.mMethod)
 ,   mStatusCode(entry.mStatusCode)
 ,   mRequestId(entry.mRequestId)
+,   mData(nullptr)
 {
-    mData = new U8[mDataSize];
-    memcpy(mData, entry.mData, mDataSize);
+    if (entry.mData)
+    {
+        mData = new U8[mDataSize];
+        memcpy(mData, entry.mData, mDataSize);
+    }
 }
 
 /* virtual */
@@ -118,10 +118,12 @@ void LLMessageLog::setCallback(LogCallback callback)
 /* static */
 void LLMessageLog::log(LLHost from_host, LLHost to_host, U8* data, S32 data_size)
 {
-    if (!haveLogger()) return;
-
     if(!data_size || data == nullptr) return;
 
+    LLPacketCapture::capture(from_host, to_host, data, data_size);
+
+    if (!haveLogger()) return;
+
     LogPayload payload = std::make_shared<LLMessageLogEntry>(from_host, to_host, data, data_size);
 
     if(sCallback) sCallback(payload);
@@ -47,7 +47,7 @@ struct LLMessageLogEntry
 
     /// Ctor for TEMPLATE lludp message
     LLMessageLogEntry(LLHost from_host, LLHost to_host, U8* data, size_t data_size);
-    /// Ctor for HTTP message
+    /// Ctor for HTTP message, takes ownership of data (allocated with new[])
     LLMessageLogEntry(EEntryType etype, U8* data, size_t data_size, std::string url,
                       std::string content_type, LLCore::HttpHeaders::ptr_t headers, EHTTPMethod method,
         U8 status_code, U64 request_id);
@@ -82,7 +82,7 @@ class LLMessageLog
 public:
     /// Set log callback
     static void setCallback(LogCallback callback);
-    /// Log lludp messages
+    /// Log lludp messages, and hand them to LLPacketCapture when capturing
     static void log(LLHost from_host, LLHost to_host, U8* data, S32 data_size);
     /// Log HTTP Request Op
     static void log(const LLCore::HttpRequestQueue::opPtr_t& op);
@@ -0,0 +1,253 @@
+/**
+ * @file llpacketcapture.cpp
+ * @brief Background writer for pcap captures of lludp traffic.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketcapture.h"
+
+#include <chrono>
+
+namespace
+{
+    // Enough to ride out a slow disk for a second or so of heavy
+    // traffic without holding more than a couple of megabytes.
+    const S32 CAPTURE_SLOT_COUNT = 256;
+
+    const U32 PCAP_MAGIC = 0xa1b2c3d4;
+    const U32 PCAP_SNAPLEN = 65535;
+    const U32 PCAP_LINKTYPE_RAW = 101;
+
+    const S32 IPV4_HEADER_SIZE = 20;
+    const S32 UDP_HEADER_SIZE = 8;
+
+    struct PcapFileHeader
+    {
+        U32 mMagic;
+        U16 mVersionMajor;
+        U16 mVersionMinor;
+        S32 mThisZone;
+        U32 mSigFigs;
+        U32 mSnapLen;
+        U32 mLinkType;
+    };
+
+    struct PcapRecordHeader
+    {
+        U32 mSeconds;
+        U32 mMicroseconds;
+        U32 mCapturedLength;
+        U32 mOriginalLength;
+    };
+
+    inline void put_be16(U8* p, U32 value)
+    {
+        p[0] = (U8)(value >> 8);
+        p[1] = (U8)value;
+    }
+
+    // LLHost keeps addresses as they came out of sockaddr_in, so the
+    // in-memory bytes are already in network order.
+    inline void put_address(U8* p, const LLHost& host)
+    {
+        U32 ip = host.getAddress();
+        memcpy(p, &ip, sizeof(ip));
+    }
+}
+
+LLPacketCapture* LLPacketCapture::sInstance = nullptr;
+
+//static
+bool LLPacketCapture::startCapture(const std::string& filename)
+{
+    stopCapture();
+
+    LLFILE* fp = LLFile::fopen(filename, "wb");
+    if (!fp)
+    {
+        LL_WARNS("Messaging") << "Unable to open packet capture file " << filename << LL_ENDL;
+        return false;
+    }
+
+    PcapFileHeader header;
+    header.mMagic = PCAP_MAGIC;
+    header.mVersionMajor = 2;
+    header.mVersionMinor = 4;
+    header.mThisZone = 0;
+    header.mSigFigs = 0;
+    header.mSnapLen = PCAP_SNAPLEN;
+    header.mLinkType = PCAP_LINKTYPE_RAW;
+    if (fwrite(&header, sizeof(header), 1, fp) != 1)
+    {
+        LL_WARNS("Messaging") << "Unable to write packet capture file " << filename << LL_ENDL;
+        fclose(fp);
+        return false;
+    }
+
+    LL_INFOS("Messaging") << "Capturing packets to " << filename << LL_ENDL;
+    sInstance = new LLPacketCapture(fp);
+    sInstance->start();
+    return true;
+}
+
+//static
+void LLPacketCapture::stopCapture()
+{
+    if (!sInstance)
+    {
+        return;
+    }
+
+    // Closing the queue lets the writer drain what is left and return
+    // from run() on its own, so shutdown() only has to wait for it.
+    sInstance->mPendingSlots.close();
+    sInstance->shutdown();
+
+    LL_INFOS("Messaging") << "Packet capture stopped: " << sInstance->mCaptured << " captured, "
+                          << sInstance->mDropped << " dropped" << LL_ENDL;
+
+    delete sInstance;
+    sInstance = nullptr;
+}
+
+LLPacketCapture::LLPacketCapture(LLFILE* fp)
+:   LLThread("PacketCapture"),
+    mFile(fp),
+    mSlots(new Slot[CAPTURE_SLOT_COUNT]),
+    mFreeSlots(CAPTURE_SLOT_COUNT),
+    mPendingSlots(CAPTURE_SLOT_COUNT),
+    mCaptured(0),
+    mDropped(0)
+{
+    for (S32 i = 0; i < CAPTURE_SLOT_COUNT; ++i)
+    {
+        mFreeSlots.tryPush(&mSlots[i]);
+    }
+}
+
+LLPacketCapture::~LLPacketCapture()
+{
+    if (mFile)
+    {
+        fclose(mFile);
+        mFile = nullptr;
+    }
+}
+
+void LLPacketCapture::enqueue(const LLHost& from_host, const LLHost& to_host, const U8* data, S32 data_size)
+{
+    if (!data || data_size <= 0)
+    {
+        return;
+    }
+
+    Slot* slot = nullptr;
+    if (!mFreeSlots.tryPop(slot))
+    {
+        ++mDropped;
+        return;
+    }
+
+    slot->mTimeUsec = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    slot->mFromHost = from_host;
+    slot->mToHost = to_host;
+    slot->mSize = llmin(data_size, (S32)NET_BUFFER_SIZE);
+    memcpy(slot->mData, data, slot->mSize);
+
+    if (mPendingSlots.tryPush(slot))
+    {
+        ++mCaptured;
+    }
+    else
+    {
+        mFreeSlots.tryPush(slot);
+        ++mDropped;
+    }
+}
+
+void LLPacketCapture::writeRecord(const Slot& slot)
+{
+    const S32 ip_size = IPV4_HEADER_SIZE + UDP_HEADER_SIZE + slot.mSize;
+
+    PcapRecordHeader record;
+    record.mSeconds = (U32)(slot.mTimeUsec / 1000000);
+    record.mMicroseconds = (U32)(slot.mTimeUsec % 1000000);
+    record.mCapturedLength = ip_size;
+    record.mOriginalLength = ip_size;
+
+    U8 headers[IPV4_HEADER_SIZE + UDP_HEADER_SIZE] = {};
+    U8* ip = headers;
+    ip[0] = 0x45;                   // IPv4, 5 word header
+    put_be16(ip + 2, ip_size);
+    ip[8] = 64;                     // ttl
+    ip[9] = 17;                     // UDP
+    put_address(ip + 12, slot.mFromHost);
+    put_address(ip + 16, slot.mToHost);
+    U32 sum = 0;
+    for (S32 i = 0; i < IPV4_HEADER_SIZE; i += 2)
+    {
+        sum += (ip[i] << 8) | ip[i + 1];
+    }
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum += sum >> 16;
+    put_be16(ip + 10, ~sum & 0xffff);
+
+    U8* udp = headers + IPV4_HEADER_SIZE;
+    put_be16(udp, slot.mFromHost.getPort());
+    put_be16(udp + 2, slot.mToHost.getPort());
+    put_be16(udp + 4, UDP_HEADER_SIZE + slot.mSize);
+    // checksum is optional for UDP over IPv4, leave it zero
+
+    fwrite(&record, sizeof(record), 1, mFile);
+    fwrite(headers, sizeof(headers), 1, mFile);
+    fwrite(slot.mData, slot.mSize, 1, mFile);
+}
+
+void LLPacketCapture::run()
+{
+    bool unflushed = false;
+    Slot* slot = nullptr;
+    while (true)
+    {
+        if (mPendingSlots.tryPopFor(std::chrono::milliseconds(250), slot))
+        {
+            writeRecord(*slot);
+            mFreeSlots.tryPush(slot);
+            unflushed = true;
+        }
+        else if (mPendingSlots.done())
+        {
+            break;
+        }
+        else if (unflushed)
+        {
+            // quiet moment, make what we have visible to anyone tailing the file
+            fflush(mFile);
+            unflushed = false;
+        }
+    }
+    fflush(mFile);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file llpacketcapture.h
+ * @brief Background writer for pcap captures of lludp traffic.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETCAPTURE_H
+#define LL_LLPACKETCAPTURE_H
+
+#include "llfile.h"
+#include "llhost.h"
+#include "llthread.h"
+#include "llthreadsafequeue.h"
+#include "net.h"        // for NET_BUFFER_SIZE
+
+#include <memory>
+
+/**
+ * @brief Writes every lludp packet sent or received to a pcap file.
+ *
+ * Packets are wrapped in synthetic IPv4/UDP headers (LINKTYPE_RAW) so
+ * the capture opens directly in Wireshark and similar tools.  The main
+ * thread only copies each packet into one of a fixed set of slots and
+ * hands it to a writer thread; if the writer falls behind, packets are
+ * dropped and counted rather than stalling the message system.
+ *
+ * startCapture(), stopCapture() and capture() are main thread only.
+ */
+class LLPacketCapture : public LLThread
+{
+public:
+    /// Begin capturing to filename, replacing any capture in progress.
+    /// Returns false if the file could not be opened.
+    static bool startCapture(const std::string& filename);
+    /// Write out anything still queued and close the capture file.
+    static void stopCapture();
+    static bool isCapturing() { return sInstance != nullptr; }
+
+    /// Queue a packet for the writer thread.  No-op when not capturing.
+    static void capture(const LLHost& from_host, const LLHost& to_host, const U8* data, S32 data_size)
+    {
+        if (sInstance)
+        {
+            sInstance->enqueue(from_host, to_host, data, data_size);
+        }
+    }
+
+private:
+    struct Slot
+    {
+        U64 mTimeUsec;
+        LLHost mFromHost;
+        LLHost mToHost;
+        S32 mSize;
+        U8 mData[NET_BUFFER_SIZE];
+    };
+
+    LLPacketCapture(LLFILE* fp);
+    ~LLPacketCapture();
+
+    void enqueue(const LLHost& from_host, const LLHost& to_host, const U8* data, S32 data_size);
+    void writeRecord(const Slot& slot);
+
+    void run() override;
+
+    LLFILE* mFile;
+    std::unique_ptr<Slot[]> mSlots;
+    LLThreadSafeQueue<Slot*> mFreeSlots;
+    LLThreadSafeQueue<Slot*> mPendingSlots;
+    U64 mCaptured;
+    U64 mDropped;
+
+    static LLPacketCapture* sInstance;
+};
+
+#endif // LL_LLPACKETCAPTURE_H
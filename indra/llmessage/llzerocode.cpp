@@ -0,0 +1,120 @@
+/**
+ * @file llzerocode.cpp
+ * @brief Zero-code expansion of lludp message bodies.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llzerocode.h"
+
+#include <emmintrin.h>
+#if LL_WINDOWS
+#include <intrin.h>
+#endif
+
+namespace
+{
+    inline U32 lowest_set_bit(U32 mask)
+    {
+#if LL_WINDOWS
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (U32)index;
+#else
+        return (U32)__builtin_ctz(mask);
+#endif
+    }
+
+    // Return the first zero byte in [p, end), or end if there is none.
+    // Message bodies are mostly short literal runs between zeroes, so
+    // this checks 16 bytes at a time and finishes the tail by hand.
+    inline const U8* find_zero(const U8* p, const U8* end)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        while (end - p >= 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            U32 mask = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero));
+            if (mask)
+            {
+                return p + lowest_set_bit(mask);
+            }
+            p += 16;
+        }
+        while (p < end && *p)
+        {
+            ++p;
+        }
+        return p;
+    }
+}
+
+S32 ll_zero_code_expand(const U8* in, S32 in_size, U8* out, S32 out_size)
+{
+    const U8* inp = in;
+    const U8* in_end = in + llmax(in_size, 0);
+    U8* outp = out;
+    U8* out_end = out + llmax(out_size, 0);
+
+    while (inp < in_end)
+    {
+        const U8* zerop = find_zero(inp, in_end);
+        size_t literal = zerop - inp;
+        if (literal > (size_t)(out_end - outp))
+        {
+            return -1;
+        }
+        memcpy(outp, inp, literal);
+        outp += literal;
+        inp = zerop;
+
+        if (inp == in_end)
+        {
+            break;
+        }
+
+        // 0 [0 ...] count
+        ++inp;
+        size_t run = 1;
+        while (inp < in_end && !*inp)
+        {
+            run += 256;
+            ++inp;
+        }
+        if (inp < in_end)
+        {
+            run += *inp - 1;
+            ++inp;
+        }
+
+        if (run > (size_t)(out_end - outp))
+        {
+            return -1;
+        }
+        memset(outp, 0, run);
+        outp += run;
+    }
+
+    return (S32)(outp - out);
+}
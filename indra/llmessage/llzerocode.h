@@ -0,0 +1,42 @@
+/**
+ * @file llzerocode.h
+ * @brief Zero-code expansion of lludp message bodies.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLZEROCODE_H
+#define LL_LLZEROCODE_H
+
+// Expand a zero-coded message body from in into out.
+//
+// Runs of zero bytes are encoded as a 0 followed by a count byte, with
+// each additional 0 count byte adding 256 to the run (0 0 0 4 is 260
+// zeroes).  A 0 at the very end of the input with no count expands to
+// the zeroes seen so far.  Literal runs are located with an SSE2 scan
+// and copied in bulk rather than byte by byte.
+//
+// Returns the number of bytes written, or -1 if the expansion would
+// not fit in out_size bytes.  out is left partially written on failure.
+S32 ll_zero_code_expand(const U8* in, S32 in_size, U8* out, S32 out_size);
+
+#endif // LL_LLZEROCODE_H
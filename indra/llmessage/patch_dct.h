@@ -86,6 +86,15 @@ void get_patch_group_header(LLGroupHeader *gopp);
 void set_group_of_patch_header(LLGroupHeader *gopp);
 void init_patch_decompressor(S32 size);
 void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph);
+// Reentrant form: does not rely on set_group_of_patch_header(), safe to call from worker threads.
+void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph, const LLGroupHeader *gopp);
 void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph);
 
+// In-place 2D inverse DCT of a dequantized size*size block, size being
+// NORMAL_PATCH_SIZE or LARGE_PATCH_SIZE.  The SSE version is used by the
+// decompressors; the scalar version is kept as the reference and must give
+// bit-identical results.
+void idct_patch_block(F32 *block, S32 size);
+void idct_patch_block_scalar(F32 *block, S32 size);
+
 #endif
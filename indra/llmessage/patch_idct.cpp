@@ -28,34 +28,47 @@
 
 #include "llmath.h"
 //#include "vmath.h"
+#include "llsimdmath.h"
 #include "v3math.h"
 #include "patch_dct.h"
 
-LLGroupHeader   *gGOPP;
+// Per-thread so that land layers can be decoded on a worker while wind
+// is decoded on the main thread.
+thread_local LLGroupHeader  *gGOPP;
 
 void set_group_of_patch_header(LLGroupHeader *gopp)
 {
     gGOPP = gopp;
 }
 
-F32 gPatchDequantizeTable[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-void build_patch_dequantize_table(S32 size)
+namespace
+{
+
+// Lookup tables for one patch size.  These used to be globals rebuilt
+// whenever the patch size changed, which made decoding unsafe off the
+// main thread; now one read-only instance exists per supported size.
+struct LLPatchDecompressTables
+{
+    F32 mDequantize[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+    F32 mICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+    S32 mDeCopy[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+
+    explicit LLPatchDecompressTables(S32 size);
+};
+
+void build_patch_dequantize_table(F32 *table, S32 size)
 {
     S32 i, j;
     for (j = 0; j < size; j++)
     {
         for (i = 0; i < size; i++)
         {
-            gPatchDequantizeTable[j*size + i] = (1.f + 2.f*(i+j));
+            table[j*size + i] = (1.f + 2.f*(i+j));
         }
     }
 }
 
-S32 gCurrentDeSize = 0;
-
-F32 gPatchICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-
-void setup_patch_icosines(S32 size)
+void setup_patch_icosines(F32 *table, S32 size)
 {
     S32 n, u;
     F32 oosob = F_PI*0.5f/size;
@@ -64,14 +77,12 @@ void setup_patch_icosines(S32 size)
     {
         for (n = 0; n < size; n++)
         {
-            gPatchICosines[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
+            table[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
         }
     }
 }
 
-S32 gDeCopyMatrix[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-
-void build_decopy_matrix(S32 size)
+void build_decopy_matrix(S32 *matrix, S32 size)
 {
     S32 i, j, count;
     BOOL    b_diag = FALSE;
@@ -84,7 +95,7 @@ void build_decopy_matrix(S32 size)
     while (  (i < size)
            &&(j < size))
     {
-        gDeCopyMatrix[j*size + i] = count;
+        matrix[j*size + i] = count;
 
         count++;
 
@@ -135,27 +146,43 @@ void build_decopy_matrix(S32 size)
     }
 }
 
-void init_patch_decompressor(S32 size)
+LLPatchDecompressTables::LLPatchDecompressTables(S32 size)
+{
+    build_patch_dequantize_table(mDequantize, size);
+    setup_patch_icosines(mICosines, size);
+    build_decopy_matrix(mDeCopy, size);
+}
+
+const LLPatchDecompressTables &get_decompress_tables(S32 size)
 {
-    if (size != gCurrentDeSize)
+    // function-local statics: built once, thread-safe initialization
+    if (size == LARGE_PATCH_SIZE)
     {
-        gCurrentDeSize = size;
-        build_patch_dequantize_table(size);
-        setup_patch_icosines(size);
-        build_decopy_matrix(size);
+        static const LLPatchDecompressTables sLarge(LARGE_PATCH_SIZE);
+        return sLarge;
     }
+    static const LLPatchDecompressTables sNormal(NORMAL_PATCH_SIZE);
+    return sNormal;
+}
+
+} // anonymous namespace
+
+void init_patch_decompressor(S32 size)
+{
+    // Tables are now built on first use; this just front-loads the cost.
+    get_decompress_tables(size);
 }
 
-inline void idct_line(F32 *linein, F32 *lineout, S32 line)
+inline void idct_line(const F32 *pcp, F32 *linein, F32 *lineout, S32 line)
 {
     S32 n;
     F32 total;
-    F32 *pcp = gPatchICosines;
 
 #ifdef _PATCH_SIZE_16_AND_32_ONLY
     F32 oosob = 2.f/16.f;
     S32 line_size = line*NORMAL_PATCH_SIZE;
-    F32 *tlinein, *tpcp;
+    F32 *tlinein;
+    const F32 *tpcp;
 
 
     for (n = 0; n < NORMAL_PATCH_SIZE; n++)
@@ -202,15 +229,15 @@ inline void idct_line(F32 *linein, F32 *lineout, S32 line)
 #endif
 }
 
-inline void idct_line_large_slow(F32 *linein, F32 *lineout, S32 line)
+inline void idct_line_large_slow(const F32 *pcp, F32 *linein, F32 *lineout, S32 line)
 {
     S32 n;
     F32 total;
-    F32 *pcp = gPatchICosines;
 
     F32 oosob = 2.f/32.f;
     S32 line_size = line*LARGE_PATCH_SIZE;
-    F32 *tlinein, *tpcp;
+    F32 *tlinein;
+    const F32 *tpcp;
 
 
     for (n = 0; n < LARGE_PATCH_SIZE; n++)
@@ -264,15 +291,15 @@ inline void idct_line_large_slow(F32 *linein, F32 *lineout, S32 line)
 
 // Nota Bene: assumes that coefficients beyond 128 are 0!
 
-void idct_line_large(F32 *linein, F32 *lineout, S32 line)
+void idct_line_large(const F32 *pcp, F32 *linein, F32 *lineout, S32 line)
 {
     S32 n;
     F32 total;
-    F32 *pcp = gPatchICosines;
 
     F32 oosob = 2.f/32.f;
     S32 line_size = line*LARGE_PATCH_SIZE;
-    F32 *tlinein, *tpcp;
+    F32 *tlinein;
+    const F32 *tpcp;
     F32 *baselinein = linein + line_size;
     F32 *baselineout = lineout + line_size;
 
@@ -306,14 +333,14 @@ void idct_line_large(F32 *linein, F32 *lineout, S32 line)
     }
 }
 
-inline void idct_column(F32 *linein, F32 *lineout, S32 column)
+inline void idct_column(const F32 *pcp, F32 *linein, F32 *lineout, S32 column)
 {
     S32 n;
     F32 total;
-    F32 *pcp = gPatchICosines;
 
 #ifdef _PATCH_SIZE_16_AND_32_ONLY
-    F32 *tlinein, *tpcp;
+    F32 *tlinein;
+    const F32 *tpcp;
 
     for (n = 0; n < NORMAL_PATCH_SIZE; n++)
     {
@@ -361,13 +388,13 @@ inline void idct_column(F32 *linein, F32 *lineout, S32 column)
 #endif
 }
 
-inline void idct_column_large_slow(F32 *linein, F32 *lineout, S32 column)
+inline void idct_column_large_slow(const F32 *pcp, F32 *linein, F32 *lineout, S32 column)
 {
     S32 n;
     F32 total;
-    F32 *pcp = gPatchICosines;
 
-    F32 *tlinein, *tpcp;
+    F32 *tlinein;
+    const F32 *tpcp;
 
     for (n = 0; n < LARGE_PATCH_SIZE; n++)
     {
@@ -420,13 +447,13 @@ inline void idct_column_large_slow(F32 *linein, F32 *lineout, S32 column)
 
 // Nota Bene: assumes that coefficients beyond 128 are 0!
 
-void idct_column_large(F32 *linein, F32 *lineout, S32 column)
+void idct_column_large(const F32 *pcp, F32 *linein, F32 *lineout, S32 column)
 {
     S32 n, m;
     F32 total;
-    F32 *pcp = gPatchICosines;
 
-    F32 *tlinein, *tpcp;
+    F32 *tlinein;
+    const F32 *tpcp;
     F32 *baselinein = linein + column;
     F32 *baselineout = lineout + column;
 
@@ -443,159 +470,259 @@ void idct_column_large(F32 *linein, F32 *lineout, S32 column)
     }
 }
 
-inline void idct_patch(F32 *block)
+inline void idct_patch(const F32 *pcp, F32 *block)
 {
     F32 temp[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
 #ifdef _PATCH_SIZE_16_AND_32_ONLY
-    idct_column(block, temp, 0);
-    idct_column(block, temp, 1);
-    idct_column(block, temp, 2);
-    idct_column(block, temp, 3);
-
-    idct_column(block, temp, 4);
-    idct_column(block, temp, 5);
-    idct_column(block, temp, 6);
-    idct_column(block, temp, 7);
-
-    idct_column(block, temp, 8);
-    idct_column(block, temp, 9);
-    idct_column(block, temp, 10);
-    idct_column(block, temp, 11);
-
-    idct_column(block, temp, 12);
-    idct_column(block, temp, 13);
-    idct_column(block, temp, 14);
-    idct_column(block, temp, 15);
-
-    idct_line(temp, block, 0);
-    idct_line(temp, block, 1);
-    idct_line(temp, block, 2);
-    idct_line(temp, block, 3);
-
-    idct_line(temp, block, 4);
-    idct_line(temp, block, 5);
-    idct_line(temp, block, 6);
-    idct_line(temp, block, 7);
-
-    idct_line(temp, block, 8);
-    idct_line(temp, block, 9);
-    idct_line(temp, block, 10);
-    idct_line(temp, block, 11);
-
-    idct_line(temp, block, 12);
-    idct_line(temp, block, 13);
-    idct_line(temp, block, 14);
-    idct_line(temp, block, 15);
+    idct_column(pcp, block, temp, 0);
+    idct_column(pcp, block, temp, 1);
+    idct_column(pcp, block, temp, 2);
+    idct_column(pcp, block, temp, 3);
+
+    idct_column(pcp, block, temp, 4);
+    idct_column(pcp, block, temp, 5);
+    idct_column(pcp, block, temp, 6);
+    idct_column(pcp, block, temp, 7);
+
+    idct_column(pcp, block, temp, 8);
+    idct_column(pcp, block, temp, 9);
+    idct_column(pcp, block, temp, 10);
+    idct_column(pcp, block, temp, 11);
+
+    idct_column(pcp, block, temp, 12);
+    idct_column(pcp, block, temp, 13);
+    idct_column(pcp, block, temp, 14);
+    idct_column(pcp, block, temp, 15);
+
+    idct_line(pcp, temp, block, 0);
+    idct_line(pcp, temp, block, 1);
+    idct_line(pcp, temp, block, 2);
+    idct_line(pcp, temp, block, 3);
+
+    idct_line(pcp, temp, block, 4);
+    idct_line(pcp, temp, block, 5);
+    idct_line(pcp, temp, block, 6);
+    idct_line(pcp, temp, block, 7);
+
+    idct_line(pcp, temp, block, 8);
+    idct_line(pcp, temp, block, 9);
+    idct_line(pcp, temp, block, 10);
+    idct_line(pcp, temp, block, 11);
+
+    idct_line(pcp, temp, block, 12);
+    idct_line(pcp, temp, block, 13);
+    idct_line(pcp, temp, block, 14);
+    idct_line(pcp, temp, block, 15);
 #else
     S32 i;
     S32 size = gGOPP->patch_size;
     for (i = 0; i < size; i++)
     {
-        idct_column(block, temp, i);
+        idct_column(pcp, block, temp, i);
     }
     for (i = 0; i < size; i++)
     {
-        idct_line(temp, block, i);
+        idct_line(pcp, temp, block, i);
     }
 #endif
 }
 
-inline void idct_patch_large(F32 *block)
+inline void idct_patch_large(const F32 *pcp, F32 *block)
 {
     F32 temp[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
-    idct_column_large_slow(block, temp, 0);
-    idct_column_large_slow(block, temp, 1);
-    idct_column_large_slow(block, temp, 2);
-    idct_column_large_slow(block, temp, 3);
-
-    idct_column_large_slow(block, temp, 4);
-    idct_column_large_slow(block, temp, 5);
-    idct_column_large_slow(block, temp, 6);
-    idct_column_large_slow(block, temp, 7);
-
-    idct_column_large_slow(block, temp, 8);
-    idct_column_large_slow(block, temp, 9);
-    idct_column_large_slow(block, temp, 10);
-    idct_column_large_slow(block, temp, 11);
-
-    idct_column_large_slow(block, temp, 12);
-    idct_column_large_slow(block, temp, 13);
-    idct_column_large_slow(block, temp, 14);
-    idct_column_large_slow(block, temp, 15);
-
-    idct_column_large_slow(block, temp, 16);
-    idct_column_large_slow(block, temp, 17);
-    idct_column_large_slow(block, temp, 18);
-    idct_column_large_slow(block, temp, 19);
-
-    idct_column_large_slow(block, temp, 20);
-    idct_column_large_slow(block, temp, 21);
-    idct_column_large_slow(block, temp, 22);
-    idct_column_large_slow(block, temp, 23);
-
-    idct_column_large_slow(block, temp, 24);
-    idct_column_large_slow(block, temp, 25);
-    idct_column_large_slow(block, temp, 26);
-    idct_column_large_slow(block, temp, 27);
-
-    idct_column_large_slow(block, temp, 28);
-    idct_column_large_slow(block, temp, 29);
-    idct_column_large_slow(block, temp, 30);
-    idct_column_large_slow(block, temp, 31);
-
-    idct_line_large_slow(temp, block, 0);
-    idct_line_large_slow(temp, block, 1);
-    idct_line_large_slow(temp, block, 2);
-    idct_line_large_slow(temp, block, 3);
-
-    idct_line_large_slow(temp, block, 4);
-    idct_line_large_slow(temp, block, 5);
-    idct_line_large_slow(temp, block, 6);
-    idct_line_large_slow(temp, block, 7);
-
-    idct_line_large_slow(temp, block, 8);
-    idct_line_large_slow(temp, block, 9);
-    idct_line_large_slow(temp, block, 10);
-    idct_line_large_slow(temp, block, 11);
-
-    idct_line_large_slow(temp, block, 12);
-    idct_line_large_slow(temp, block, 13);
-    idct_line_large_slow(temp, block, 14);
-    idct_line_large_slow(temp, block, 15);
-
-    idct_line_large_slow(temp, block, 16);
-    idct_line_large_slow(temp, block, 17);
-    idct_line_large_slow(temp, block, 18);
-    idct_line_large_slow(temp, block, 19);
-
-    idct_line_large_slow(temp, block, 20);
-    idct_line_large_slow(temp, block, 21);
-    idct_line_large_slow(temp, block, 22);
-    idct_line_large_slow(temp, block, 23);
-
-    idct_line_large_slow(temp, block, 24);
-    idct_line_large_slow(temp, block, 25);
-    idct_line_large_slow(temp, block, 26);
-    idct_line_large_slow(temp, block, 27);
-
-    idct_line_large_slow(temp, block, 28);
-    idct_line_large_slow(temp, block, 29);
-    idct_line_large_slow(temp, block, 30);
-    idct_line_large_slow(temp, block, 31);
+    idct_column_large_slow(pcp, block, temp, 0);
+    idct_column_large_slow(pcp, block, temp, 1);
+    idct_column_large_slow(pcp, block, temp, 2);
+    idct_column_large_slow(pcp, block, temp, 3);
+
+    idct_column_large_slow(pcp, block, temp, 4);
+    idct_column_large_slow(pcp, block, temp, 5);
+    idct_column_large_slow(pcp, block, temp, 6);
+    idct_column_large_slow(pcp, block, temp, 7);
+
+    idct_column_large_slow(pcp, block, temp, 8);
+    idct_column_large_slow(pcp, block, temp, 9);
+    idct_column_large_slow(pcp, block, temp, 10);
+    idct_column_large_slow(pcp, block, temp, 11);
+
+    idct_column_large_slow(pcp, block, temp, 12);
+    idct_column_large_slow(pcp, block, temp, 13);
+    idct_column_large_slow(pcp, block, temp, 14);
+    idct_column_large_slow(pcp, block, temp, 15);
+
+    idct_column_large_slow(pcp, block, temp, 16);
+    idct_column_large_slow(pcp, block, temp, 17);
+    idct_column_large_slow(pcp, block, temp, 18);
+    idct_column_large_slow(pcp, block, temp, 19);
+
+    idct_column_large_slow(pcp, block, temp, 20);
+    idct_column_large_slow(pcp, block, temp, 21);
+    idct_column_large_slow(pcp, block, temp, 22);
+    idct_column_large_slow(pcp, block, temp, 23);
+
+    idct_column_large_slow(pcp, block, temp, 24);
+    idct_column_large_slow(pcp, block, temp, 25);
+    idct_column_large_slow(pcp, block, temp, 26);
+    idct_column_large_slow(pcp, block, temp, 27);
+
+    idct_column_large_slow(pcp, block, temp, 28);
+    idct_column_large_slow(pcp, block, temp, 29);
+    idct_column_large_slow(pcp, block, temp, 30);
+    idct_column_large_slow(pcp, block, temp, 31);
+
+    idct_line_large_slow(pcp, temp, block, 0);
+    idct_line_large_slow(pcp, temp, block, 1);
+    idct_line_large_slow(pcp, temp, block, 2);
+    idct_line_large_slow(pcp, temp, block, 3);
+
+    idct_line_large_slow(pcp, temp, block, 4);
+    idct_line_large_slow(pcp, temp, block, 5);
+    idct_line_large_slow(pcp, temp, block, 6);
+    idct_line_large_slow(pcp, temp, block, 7);
+
+    idct_line_large_slow(pcp, temp, block, 8);
+    idct_line_large_slow(pcp, temp, block, 9);
+    idct_line_large_slow(pcp, temp, block, 10);
+    idct_line_large_slow(pcp, temp, block, 11);
+
+    idct_line_large_slow(pcp, temp, block, 12);
+    idct_line_large_slow(pcp, temp, block, 13);
+    idct_line_large_slow(pcp, temp, block, 14);
+    idct_line_large_slow(pcp, temp, block, 15);
+
+    idct_line_large_slow(pcp, temp, block, 16);
+    idct_line_large_slow(pcp, temp, block, 17);
+    idct_line_large_slow(pcp, temp, block, 18);
+    idct_line_large_slow(pcp, temp, block, 19);
+
+    idct_line_large_slow(pcp, temp, block, 20);
+    idct_line_large_slow(pcp, temp, block, 21);
+    idct_line_large_slow(pcp, temp, block, 22);
+    idct_line_large_slow(pcp, temp, block, 23);
+
+    idct_line_large_slow(pcp, temp, block, 24);
+    idct_line_large_slow(pcp, temp, block, 25);
+    idct_line_large_slow(pcp, temp, block, 26);
+    idct_line_large_slow(pcp, temp, block, 27);
+
+    idct_line_large_slow(pcp, temp, block, 28);
+    idct_line_large_slow(pcp, temp, block, 29);
+    idct_line_large_slow(pcp, temp, block, 30);
+    idct_line_large_slow(pcp, temp, block, 31);
+}
+
+// SSE versions of the column and line passes.  Each lane carries one
+// output sample and accumulates the cosine terms in the same order as the
+// scalar loops above, using separate multiplies and adds, so the result is
+// bit-identical to idct_patch()/idct_patch_large().
+template <S32 SIZE>
+void idct_columns_sse(const F32 *pcp, const F32 *linein, F32 *lineout)
+{
+    constexpr S32 LANES = SIZE / 4;
+    const __m128 oosqrt2 = _mm_set1_ps(OO_SQRT2);
+
+    for (S32 n = 0; n < SIZE; n++)
+    {
+        __m128 total[LANES];
+        for (S32 k = 0; k < LANES; k++)
+        {
+            total[k] = _mm_mul_ps(oosqrt2, _mm_loadu_ps(linein + 4*k));
+        }
+        for (S32 u = 1; u < SIZE; u++)
+        {
+            const F32 *tlinein = linein + u*SIZE;
+            const __m128 cosine = _mm_set1_ps(pcp[u*SIZE + n]);
+            for (S32 k = 0; k < LANES; k++)
+            {
+                total[k] = _mm_add_ps(total[k], _mm_mul_ps(_mm_loadu_ps(tlinein + 4*k), cosine));
+            }
+        }
+        for (S32 k = 0; k < LANES; k++)
+        {
+            _mm_storeu_ps(lineout + n*SIZE + 4*k, total[k]);
+        }
+    }
+}
+
+template <S32 SIZE>
+void idct_lines_sse(const F32 *pcp, const F32 *linein, F32 *lineout)
+{
+    constexpr S32 LANES = SIZE / 4;
+    const __m128 oosqrt2 = _mm_set1_ps(OO_SQRT2);
+    const __m128 oosob = _mm_set1_ps(2.f/SIZE);
+
+    for (S32 line = 0; line < SIZE; line++)
+    {
+        const F32 *tlinein = linein + line*SIZE;
+        const __m128 dc = _mm_mul_ps(oosqrt2, _mm_set1_ps(tlinein[0]));
+        __m128 total[LANES];
+        for (S32 k = 0; k < LANES; k++)
+        {
+            total[k] = dc;
+        }
+        for (S32 u = 1; u < SIZE; u++)
+        {
+            const F32 *tpcp = pcp + u*SIZE;
+            const __m128 coeff = _mm_set1_ps(tlinein[u]);
+            for (S32 k = 0; k < LANES; k++)
+            {
+                total[k] = _mm_add_ps(total[k], _mm_mul_ps(coeff, _mm_loadu_ps(tpcp + 4*k)));
+            }
+        }
+        for (S32 k = 0; k < LANES; k++)
+        {
+            _mm_storeu_ps(lineout + line*SIZE + 4*k, _mm_mul_ps(total[k], oosob));
+        }
+    }
+}
+
+void idct_patch_block(F32 *block, S32 size)
+{
+    F32 temp[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+    const F32 *pcp = get_decompress_tables(size).mICosines;
+
+    if (size == NORMAL_PATCH_SIZE)
+    {
+        idct_columns_sse<NORMAL_PATCH_SIZE>(pcp, block, temp);
+        idct_lines_sse<NORMAL_PATCH_SIZE>(pcp, temp, block);
+    }
+    else
+    {
+        idct_columns_sse<LARGE_PATCH_SIZE>(pcp, block, temp);
+        idct_lines_sse<LARGE_PATCH_SIZE>(pcp, temp, block);
+    }
+}
+
+void idct_patch_block_scalar(F32 *block, S32 size)
+{
+    const F32 *pcp = get_decompress_tables(size).mICosines;
+
+    if (size == NORMAL_PATCH_SIZE)
+    {
+        idct_patch(pcp, block);
+    }
+    else
+    {
+        idct_patch_large(pcp, block);
+    }
 }
 
 S32 gDitherNoise = 128;
 
 void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph)
+{
+    decompress_patch(patch, cpatch, ph, gGOPP);
+}
+
+void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph, const LLGroupHeader *gopp)
 {
     S32     i, j;
 
     F32     block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE], *tblock = block;
     F32     *tpatch;
 
-    LLGroupHeader   *gopp = gGOPP;
     S32     size = gopp->patch_size;
     F32     range = ph->range;
     S32     prequant = (ph->quant_wbits >> 4) + 2;
@@ -603,9 +730,11 @@ void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph)
     F32     hmin = ph->dc_offset;
     S32     stride = gopp->stride;
 
+    const LLPatchDecompressTables &tables = get_decompress_tables(size);
+
     F32     ooq = 1.f/(F32)quantize;
-    F32     *dq = gPatchDequantizeTable;
-    S32     *decopy_matrix = gDeCopyMatrix;
+    const F32   *dq = tables.mDequantize;
+    const S32   *decopy_matrix = tables.mDeCopy;
 
     F32     mult = ooq*range;
     F32     addval = mult*(F32)(1<<(prequant - 1))+hmin;
@@ -615,14 +744,7 @@ void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph)
         *(tblock++) = *(cpatch + *(decopy_matrix++))*(*dq++);
     }
 
-    if (size == 16)
-    {
-        idct_patch(block);
-    }
-    else
-    {
-        idct_patch_large(block);
-    }
+    idct_patch_block(block, size);
 
     for (j = 0; j < size; j++)
     {
@@ -651,9 +773,11 @@ void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
     F32     hmin = ph->dc_offset;
     S32     stride = gopp->stride;
 
+    const LLPatchDecompressTables &tables = get_decompress_tables(size);
+
     F32     ooq = 1.f/(F32)quantize;
-    F32     *dq = gPatchDequantizeTable;
-    S32     *decopy_matrix = gDeCopyMatrix;
+    const F32   *dq = tables.mDequantize;
+    const S32   *decopy_matrix = tables.mDeCopy;
 
     F32     mult = ooq*range;
     F32     addval = mult*(F32)(1<<(prequant - 1))+hmin;
@@ -666,10 +790,7 @@ void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
         *(tblock++) = *(cpatch + *(decopy_matrix++))*(*dq++);
     }
 
-    if (size == 16)
-        idct_patch(block);
-    else
-        idct_patch_large(block);
+    idct_patch_block(block, size);
 
     for (j = 0; j < size; j++)
     {
@@ -681,4 +802,3 @@ void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
         }
     }
 }
-
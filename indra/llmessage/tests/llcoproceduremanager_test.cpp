@@ -45,6 +45,8 @@
 #pragma GCC diagnostic pop
 #endif
 
+#include "lltimer.h"
+
 #include "../test/lltut.h"
 #include "../test/sync.h"
 
@@ -182,4 +184,138 @@ namespace tut
         LL_INFOS("CoMain") << "checking count" << LL_ENDL;
         ensure_equals("coprocedure failed to update counter", counter, 5);
     }
+
+    template<> template<>
+    void coproceduremanager_object_t::test<5>()
+    {
+        set_test_name("priority ordering");
+
+        Sync sync;
+        std::vector<std::string> order;
+        LLCoprocedureManager &mgr(LLCoprocedureManager::instance());
+        mgr.initializePool("PriorityPool");
+
+        auto make_proc = [&order, &sync](const std::string &tag)
+        {
+            return [&order, &sync, tag](LLCoreHttpUtil::HttpCoroutineAdapter::ptr_t &, const LLUUID &)
+            {
+                order.push_back(tag);
+                sync.bump();
+            };
+        };
+
+        LLCoprocedureManager::QueueOptions low, high;
+        low.mPriority = LLCoprocedureManager::PRIORITY_LOW;
+        high.mPriority = LLCoprocedureManager::PRIORITY_HIGH;
+
+        mgr.enqueueCoprocedure("PriorityPool", "low", make_proc("low"), low);
+        mgr.enqueueCoprocedure("PriorityPool", "normal1", make_proc("normal1"));
+        mgr.enqueueCoprocedure("PriorityPool", "high", make_proc("high"), high);
+        mgr.enqueueCoprocedure("PriorityPool", "normal2", make_proc("normal2"));
+
+        sync.yield(4);
+        ensure_equals("all coprocedures ran", order.size(), 4);
+        ensure_equals("high first", order[0], "high");
+        ensure_equals("normal FIFO 1", order[1], "normal1");
+        ensure_equals("normal FIFO 2", order[2], "normal2");
+        ensure_equals("low last", order[3], "low");
+
+        mgr.close("PriorityPool");
+    }
+
+    template<> template<>
+    void coproceduremanager_object_t::test<6>()
+    {
+        set_test_name("coalescing and expiry");
+
+        Sync sync;
+        int keyed_runs = 0, expired_runs = 0, plain_runs = 0;
+        LLCoprocedureManager &mgr(LLCoprocedureManager::instance());
+        mgr.initializePool("CoalescePool");
+
+        LLCoprocedureManager::QueueOptions keyed;
+        keyed.mKey = "folder";
+        LLUUID id1 = mgr.enqueueCoprocedure("CoalescePool", "keyed1",
+            [&keyed_runs, &sync](LLCoreHttpUtil::HttpCoroutineAdapter::ptr_t &, const LLUUID &) {
+                ++keyed_runs;
+                sync.bump();
+            }, keyed);
+        LLUUID id2 = mgr.enqueueCoprocedure("CoalescePool", "keyed2",
+            [&keyed_runs, &sync](LLCoreHttpUtil::HttpCoroutineAdapter::ptr_t &, const LLUUID &) {
+                ++keyed_runs;
+                sync.bump();
+            }, keyed);
+        ensure_equals("coalesced request returns pending id", id2, id1);
+        ensure_equals("only one keyed request pending", mgr.countPending("CoalescePool"), 1);
+
+        // Runs ahead of everything else but will have expired by then
+        LLCoprocedureManager::QueueOptions expiring;
+        expiring.mPriority = LLCoprocedureManager::PRIORITY_HIGH;
+        expiring.mTimeout = F64Seconds(0.001);
+        mgr.enqueueCoprocedure("CoalescePool", "expiring",
+            [&expired_runs, &sync](LLCoreHttpUtil::HttpCoroutineAdapter::ptr_t &, const LLUUID &) {
+                ++expired_runs;
+                sync.bump();
+            }, expiring);
+        mgr.enqueueCoprocedure("CoalescePool", "plain",
+            [&plain_runs, &sync](LLCoreHttpUtil::HttpCoroutineAdapter::ptr_t &, const LLUUID &) {
+                ++plain_runs;
+                sync.bump();
+            });
+        ms_sleep(5);
+
+        sync.yield(2);
+        ensure_equals("keyed coprocedure ran once", keyed_runs, 1);
+        ensure_equals("plain coprocedure ran", plain_runs, 1);
+        ensure_equals("expired coprocedure skipped", expired_runs, 0);
+
+        LLSD stats = mgr.getQueueStats("CoalescePool");
+        ensure_equals("coalesced count", stats["coalesced"].asInteger(), 1);
+        ensure_equals("expired count", stats["expired"].asInteger(), 1);
+        ensure_equals("latency bins", stats["latency"].size(), 16);
+
+        mgr.close("CoalescePool");
+    }
+
+    template<> template<>
+    void coproceduremanager_object_t::test<7>()
+    {
+        set_test_name("no coalescing across an unkeyed request");
+
+        Sync sync;
+        std::vector<std::string> order;
+        LLCoprocedureManager &mgr(LLCoprocedureManager::instance());
+        mgr.initializePool("BarrierPool");
+
+        auto make_proc = [&order, &sync](const std::string &tag)
+        {
+            return [&order, &sync, tag](LLCoreHttpUtil::HttpCoroutineAdapter::ptr_t &, const LLUUID &)
+            {
+                order.push_back(tag);
+                sync.bump();
+            };
+        };
+
+        // fetch -> mutate -> fetch, as AIS queues a folder fetch, an
+        // update to the folder and another fetch of it
+        LLCoprocedureManager::QueueOptions fetch;
+        fetch.mKey = "category/children";
+        LLUUID id1 = mgr.enqueueCoprocedure("BarrierPool", "fetch1", make_proc("fetch1"), fetch);
+        mgr.enqueueCoprocedure("BarrierPool", "update", make_proc("update"));
+        LLUUID id2 = mgr.enqueueCoprocedure("BarrierPool", "fetch2", make_proc("fetch2"), fetch);
+        ensure("fetch after the update is queued on its own", id2 != id1);
+        // but fetches after that one still coalesce with it
+        LLUUID id3 = mgr.enqueueCoprocedure("BarrierPool", "fetch3", make_proc("fetch3"), fetch);
+        ensure_equals("fetch coalesced with the one after the update", id3, id2);
+        ensure_equals("pending", mgr.countPending("BarrierPool"), 3);
+
+        sync.yield(3);
+        ensure_equals("all coprocedures ran", order.size(), 3);
+        ensure_equals("first fetch", order[0], "fetch1");
+        ensure_equals("update", order[1], "update");
+        ensure_equals("fetch sees the update", order[2], "fetch2");
+        ensure_equals("coalesced count", mgr.getQueueStats("BarrierPool")["coalesced"].asInteger(), 1);
+
+        mgr.close("BarrierPool");
+    }
 }  // namespace tut
@@ -0,0 +1,171 @@
+/**
+ * @file llzerocode_test.cpp
+ * @brief Zero-code expansion unit tests
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llzerocode.h"
+
+#include "../test/lltut.h"
+#include "stringize.h"
+
+#include <random>
+#include <vector>
+
+namespace tut
+{
+    struct zerocode_test
+    {
+        typedef std::vector<U8> buffer_t;
+
+        // The byte-at-a-time loop LLMessageSystem::zeroCodeExpand used
+        // before, minus the packet header and bounds checks.
+        buffer_t referenceExpand(const buffer_t& in)
+        {
+            buffer_t out;
+            S32 count = (S32)in.size();
+            const U8* inptr = in.data();
+            while (count--)
+            {
+                out.push_back(*inptr);
+                if (!*inptr++)
+                {
+                    while ((count--) && !*inptr)
+                    {
+                        out.insert(out.end(), 256, 0);
+                        inptr++;
+                    }
+                    if (count < 0)
+                    {
+                        break;
+                    }
+                    out.insert(out.end(), *inptr - 1, 0);
+                    inptr++;
+                }
+            }
+            return out;
+        }
+
+        // Same output as zero_code() in lltemplatemessagebuilder.cpp,
+        // which splits long runs into 255 byte pieces rather than
+        // emitting wrap bytes.
+        buffer_t encode(const buffer_t& in)
+        {
+            buffer_t out;
+            size_t i = 0;
+            while (i < in.size())
+            {
+                if (in[i])
+                {
+                    out.push_back(in[i++]);
+                    continue;
+                }
+                U32 run = 0;
+                while (i < in.size() && !in[i] && run < 255)
+                {
+                    ++run;
+                    ++i;
+                }
+                out.push_back(0);
+                out.push_back((U8)run);
+            }
+            return out;
+        }
+
+        buffer_t expand(const buffer_t& in, S32 out_size)
+        {
+            buffer_t out(out_size);
+            S32 size = ll_zero_code_expand(in.data(), (S32)in.size(), out.data(), out_size);
+            if (size < 0)
+            {
+                return buffer_t();
+            }
+            out.resize(size);
+            return out;
+        }
+    };
+    typedef test_group<zerocode_test> zerocode_t;
+    typedef zerocode_t::object zerocode_object_t;
+    tut::zerocode_t tut_zerocode("llzerocode");
+
+    template<> template<>
+    void zerocode_object_t::test<1>()
+    {
+        set_test_name("Round trip through the encoder on random message bodies");
+        std::mt19937 rng(1234);
+        for (U32 iter = 0; iter < 500; ++iter)
+        {
+            // alternate literal and zero runs of varying length, including
+            // runs longer than a single count byte
+            buffer_t body;
+            S32 length = rng() % 1200;
+            while ((S32)body.size() < length)
+            {
+                U32 run = (rng() % 4) ? rng() % 40 : rng() % 600;
+                U8 value = (rng() & 1) ? 0 : (U8)(1 + rng() % 255);
+                body.insert(body.end(), run, value);
+            }
+
+            buffer_t encoded = encode(body);
+            ensure(STRINGIZE("round trip " << iter), expand(encoded, 8192) == body);
+            ensure(STRINGIZE("matches old decoder " << iter), expand(encoded, 8192) == referenceExpand(encoded));
+        }
+    }
+
+    template<> template<>
+    void zerocode_object_t::test<2>()
+    {
+        set_test_name("Truncated and malformed input matches the old decoder");
+        std::mt19937 rng(99);
+        for (U32 iter = 0; iter < 500; ++iter)
+        {
+            buffer_t in(rng() % 64);
+            for (U8& c : in)
+            {
+                c = (rng() % 3) ? (U8)rng() : 0;
+            }
+            ensure(STRINGIZE("input " << iter), expand(in, 65536) == referenceExpand(in));
+        }
+
+        // trailing zero with no count, and a trailing wrap
+        ensure("trailing zero", expand(buffer_t{ 5, 0 }, 16) == buffer_t{ 5, 0 });
+        ensure_equals("trailing wrap", expand(buffer_t{ 0, 0 }, 1024).size(), (size_t)257);
+        ensure_equals("wrap then count", expand(buffer_t{ 0, 0, 0, 4 }, 1024).size(), (size_t)516);
+    }
+
+    template<> template<>
+    void zerocode_object_t::test<3>()
+    {
+        set_test_name("Output bounds");
+        buffer_t in{ 1, 2, 0, 10, 3 };
+        ensure_equals("exact fit", expand(in, 13).size(), (size_t)13);
+        ensure("zero run past the end", expand(in, 11).empty());
+        ensure("literal past the end", expand(in, 12).empty());
+        ensure("empty input", expand(buffer_t(), 0).empty());
+
+        U8 out[4] = { 0xff, 0xff, 0xff, 0xff };
+        ensure_equals("overflow is reported", ll_zero_code_expand(in.data(), (S32)in.size(), out, 4), -1);
+    }
+}
@@ -0,0 +1,132 @@
+/**
+ * @file patch_idct_test.cpp
+ * @brief Terrain patch IDCT unit tests
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../patch_dct.h"
+
+#include "../test/lltut.h"
+#include "stringize.h"
+
+#include <cstring>
+#include <random>
+
+namespace tut
+{
+    struct patch_idct_test
+    {
+        // Fill a block the way dequantized terrain data looks: energy
+        // concentrated in the low frequencies, the rest mostly zero.
+        void fillBlock(F32 *block, S32 size, U32 seed, bool dense)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<F32> dist(-4096.f, 4096.f);
+            for (S32 j = 0; j < size; j++)
+            {
+                for (S32 i = 0; i < size; i++)
+                {
+                    block[j*size + i] = (dense || i + j < size/2) ? dist(rng) : 0.f;
+                }
+            }
+        }
+
+        void checkBitExact(S32 size)
+        {
+            F32 simd[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+            F32 scalar[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+            for (U32 seed = 0; seed < 64; seed++)
+            {
+                fillBlock(simd, size, seed, seed & 1);
+                memcpy(scalar, simd, sizeof(simd));
+
+                idct_patch_block(simd, size);
+                idct_patch_block_scalar(scalar, size);
+
+                for (S32 i = 0; i < size*size; i++)
+                {
+                    // compare representations, not values, so that -0/+0 and NaN differences show up too
+                    U32 a, b;
+                    memcpy(&a, &simd[i], sizeof(a));
+                    memcpy(&b, &scalar[i], sizeof(b));
+                    ensure_equals(STRINGIZE("size " << size << " seed " << seed << " sample " << i), a, b);
+                }
+            }
+        }
+    };
+    typedef test_group<patch_idct_test> patch_idct_t;
+    typedef patch_idct_t::object patch_idct_object_t;
+    tut::patch_idct_t tut_patch_idct("patch_idct");
+
+    template<> template<>
+    void patch_idct_object_t::test<1>()
+    {
+        set_test_name("16x16 SIMD IDCT matches scalar");
+        checkBitExact(NORMAL_PATCH_SIZE);
+    }
+
+    template<> template<>
+    void patch_idct_object_t::test<2>()
+    {
+        set_test_name("32x32 SIMD IDCT matches scalar");
+        checkBitExact(LARGE_PATCH_SIZE);
+    }
+
+    template<> template<>
+    void patch_idct_object_t::test<3>()
+    {
+        set_test_name("DC-only patch decodes flat through reentrant decompress_patch");
+        const S32 sizes[] = { NORMAL_PATCH_SIZE, LARGE_PATCH_SIZE };
+        for (S32 size : sizes)
+        {
+            LLGroupHeader gh;
+            gh.stride = size + 1;   // exercise a stride different from the patch size
+            gh.patch_size = size;
+            gh.layer_type = 0;
+
+            LLPatchHeader ph;
+            ph.dc_offset = 20.f;
+            ph.range = 0;           // zero range: every sample is exactly the DC offset
+            ph.quant_wbits = 0x88;
+            ph.patchids = 0;
+
+            S32 cpatch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE] = { 0 };
+            cpatch[0] = 100;
+            F32 patch[(LARGE_PATCH_SIZE + 1)*LARGE_PATCH_SIZE];
+            std::fill(std::begin(patch), std::end(patch), -1.f);
+
+            decompress_patch(patch, cpatch, &ph, &gh);
+
+            for (S32 j = 0; j < size; j++)
+            {
+                for (S32 i = 0; i < size; i++)
+                {
+                    ensure_equals("decoded height", patch[j*gh.stride + i], 20.f);
+                }
+                ensure_equals("stride padding untouched", patch[j*gh.stride + size], -1.f);
+            }
+        }
+    }
+}
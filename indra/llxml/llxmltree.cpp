@@ -96,6 +96,135 @@ void LLXmlTree::dumpNode( LLXmlTreeNode* node, const std::string& prefix )
     }
 }
 
+namespace
+{
+    void write_binary_string(std::string& buffer, const std::string& str)
+    {
+        U32 length = (U32)str.size();
+        buffer.append((const char*)&length, sizeof(length));
+        buffer.append(str);
+    }
+
+    bool read_binary_string(const U8*& data, const U8* end, std::string& str)
+    {
+        U32 length;
+        if (end - data < (ptrdiff_t)sizeof(length))
+        {
+            return false;
+        }
+        memcpy(&length, data, sizeof(length));
+        data += sizeof(length);
+        if ((size_t)(end - data) < length)
+        {
+            return false;
+        }
+        str.assign((const char*)data, length);
+        data += length;
+        return true;
+    }
+
+    bool read_binary_count(const U8*& data, const U8* end, U32& count)
+    {
+        if (end - data < (ptrdiff_t)sizeof(count))
+        {
+            return false;
+        }
+        memcpy(&count, data, sizeof(count));
+        data += sizeof(count);
+        return true;
+    }
+}
+
+// Each node is its name, contents, attribute count and name/value pairs,
+// then its child count followed by the children themselves.
+void LLXmlTree::writeBinary(std::string& buffer)
+{
+    if (mRoot)
+    {
+        writeBinaryNode(mRoot, buffer);
+    }
+}
+
+void LLXmlTree::writeBinaryNode(LLXmlTreeNode* node, std::string& buffer)
+{
+    write_binary_string(buffer, node->mName);
+    write_binary_string(buffer, node->mContents);
+
+    U32 count = (U32)node->mAttributes.size();
+    buffer.append((const char*)&count, sizeof(count));
+    for (const auto& attrib_pair : node->mAttributes)
+    {
+        write_binary_string(buffer, *attrib_pair.first);
+        write_binary_string(buffer, *attrib_pair.second);
+    }
+
+    count = (U32)node->mChildren.size();
+    buffer.append((const char*)&count, sizeof(count));
+    for (LLXmlTreeNode* child : node->mChildren)
+    {
+        writeBinaryNode(child, buffer);
+    }
+}
+
+BOOL LLXmlTree::readBinary(const U8* data, size_t size)
+{
+    delete mRoot;
+    mRoot = NULL;
+
+    const U8* end = data + size;
+    mRoot = readBinaryNode(data, end, NULL);
+    if (mRoot && data != end)
+    {
+        delete mRoot;
+        mRoot = NULL;
+    }
+    if (!mRoot)
+    {
+        LL_WARNS() << "LLXmlTree binary data is truncated or corrupt" << LL_ENDL;
+    }
+    return mRoot != NULL;
+}
+
+LLXmlTreeNode* LLXmlTree::readBinaryNode(const U8*& data, const U8* end, LLXmlTreeNode* parent)
+{
+    std::string name;
+    if (!read_binary_string(data, end, name))
+    {
+        return NULL;
+    }
+    LLXmlTreeNode* node = new LLXmlTreeNode(std::move(name), parent, this);
+
+    U32 count;
+    bool ok = read_binary_string(data, end, node->mContents) && read_binary_count(data, end, count);
+    std::string key, value;
+    for (U32 i = 0; ok && i < count; ++i)
+    {
+        ok = read_binary_string(data, end, key) && read_binary_string(data, end, value);
+        if (ok)
+        {
+            node->addAttribute(key, value);
+        }
+    }
+
+    ok = ok && read_binary_count(data, end, count);
+    for (U32 i = 0; ok && i < count; ++i)
+    {
+        LLXmlTreeNode* child = readBinaryNode(data, end, node);
+        ok = child != NULL;
+        if (ok)
+        {
+            node->addChild(child);
+        }
+    }
+
+    if (!ok)
+    {
+        delete node;
+        return NULL;
+    }
+    return node;
+}
+
 //////////////////////////////////////////////////////////////
 // LLXmlTreeNode
 
@@ -63,6 +63,13 @@ class LLXmlTree
     void            dump();
     void            dumpNode( LLXmlTreeNode* node, const std::string& prefix );
 
+    // A compact binary form of the tree, for callers that cache a parsed
+    // file across runs. readBinary() rebuilds the same tree without going
+    // through the XML parser. The form is only meant to be read back by the
+    // same build on the same machine: it is neither versioned nor portable.
+    void            writeBinary(std::string& buffer);
+    BOOL            readBinary(const U8* data, size_t size);
+
     static LLStdStringHandle addAttributeString( const std::string& name)
     {
         return sAttributeKeys.addString( name );
@@ -72,6 +79,10 @@ class LLXmlTree
     // global
     static LLStdStringTable sAttributeKeys;
 
+protected:
+    void            writeBinaryNode(LLXmlTreeNode* node, std::string& buffer);
+    LLXmlTreeNode*  readBinaryNode(const U8*& data, const U8* end, LLXmlTreeNode* parent);
+
 protected:
     LLXmlTreeNode* mRoot;
 
@@ -0,0 +1,199 @@
+/**
+ * @file   llxmltree_test.cpp
+ * @brief  LLXmlTree binary round trip, and a parse/binary load benchmark.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llfile.h"
+#include "lltimer.h"
+#include "lluuid.h"
+#include "stringize.h"
+
+#include "../llxmltree.h"
+
+#include "../test/lltut.h"
+#include <sstream>
+
+namespace
+{
+    // empty if the two subtrees hold the same names, contents, attributes
+    // and children in the same order
+    std::string compare(LLXmlTreeNode* expected, LLXmlTreeNode* actual, const std::string& path)
+    {
+        if (expected->getName() != actual->getName())
+        {
+            return STRINGIZE(path << ": name " << actual->getName() << " != " << expected->getName());
+        }
+        std::string here = path + "/" + expected->getName();
+        if (expected->getContents() != actual->getContents())
+        {
+            return here + ": contents";
+        }
+        for (const char* name : { "name", "value", "id", "missing" })
+        {
+            LLStdStringHandle handle = LLXmlTree::addAttributeString(name);
+            std::string e, a;
+            if (expected->getFastAttributeString(handle, e) != actual->getFastAttributeString(handle, a) || e != a)
+            {
+                return STRINGIZE(here << ": attribute " << name);
+            }
+        }
+        if (expected->getChildCount() != actual->getChildCount())
+        {
+            return here + ": child count";
+        }
+        LLXmlTreeNode* a = actual->getFirstChild();
+        for (LLXmlTreeNode* e = expected->getFirstChild(); e; e = expected->getNextChild(), a = actual->getNextChild())
+        {
+            std::string result = compare(e, a, here);
+            if (!result.empty())
+            {
+                return result;
+            }
+        }
+        return "";
+    }
+}
+
+namespace tut
+{
+    struct llxmltree_data
+    {
+        std::string mTestFile;
+
+        llxmltree_data()
+        {
+            LLUUID random;
+            random.generate();
+            mTestFile = STRINGIZE(LLFile::tmpdir() << "llxmltree-test-" << random << ".xml");
+        }
+        ~llxmltree_data()
+        {
+            LLFile::remove(mTestFile);
+        }
+
+        // shaped roughly like avatar_lad.xml: wide, a few levels deep and
+        // attribute heavy
+        void writeTestFile(S32 groups)
+        {
+            std::ostringstream out;
+            out << "<?xml version=\"1.0\" encoding=\"US-ASCII\" standalone=\"yes\"?>\n";
+            out << "<linden_avatar version=\"2.0\">\n";
+            for (S32 i = 0; i < groups; ++i)
+            {
+                out << "  <group name=\"group_" << i << "\" id=\"" << i << "\">\n";
+                for (S32 j = 0; j < 8; ++j)
+                {
+                    out << "    <param id=\"" << i * 8 + j << "\" name=\"param_" << j
+                        << "\" value=\"" << j * 0.25f << "\" />\n";
+                }
+                out << "    <comment>group &amp; contents " << i << "</comment>\n";
+                out << "  </group>\n";
+            }
+            out << "</linden_avatar>\n";
+
+            llofstream file(mTestFile.c_str());
+            file << out.str();
+        }
+    };
+    typedef test_group<llxmltree_data> llxmltree_group;
+    typedef llxmltree_group::object object;
+    llxmltree_group llxmltreegrp("llxmltree");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("binary round trip");
+        writeTestFile(5);
+        LLXmlTree parsed;
+        ensure("parse", parsed.parseFile(mTestFile));
+
+        std::string buffer;
+        parsed.writeBinary(buffer);
+        ensure("binary written", !buffer.empty());
+
+        LLXmlTree loaded;
+        ensure("read binary", loaded.readBinary((const U8*)buffer.data(), buffer.size()));
+        ensure_equals(compare(parsed.getRoot(), loaded.getRoot(), ""), "");
+
+        LLXmlTreeNode* group = loaded.getRoot()->getChildByName("group");
+        ensure("named lookup", group != NULL);
+        LLXmlTreeNode* comment = group->getChildByName("comment");
+        ensure("contents kept", comment && comment->getContents() == "group & contents 0");
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("truncated binary is rejected");
+        writeTestFile(2);
+        LLXmlTree parsed;
+        ensure("parse", parsed.parseFile(mTestFile));
+        std::string buffer;
+        parsed.writeBinary(buffer);
+
+        LLXmlTree loaded;
+        ensure("truncated", !loaded.readBinary((const U8*)buffer.data(), buffer.size() - 3));
+        ensure("no root", loaded.getRoot() == NULL);
+        buffer.push_back('x');
+        ensure("trailing bytes", !loaded.readBinary((const U8*)buffer.data(), buffer.size()));
+        ensure("empty", !loaded.readBinary((const U8*)buffer.data(), 0));
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("parse versus binary load benchmark");
+        // avatar_lad.xml is about 350KB
+        writeTestFile(600);
+        const S32 runs = 10;
+
+        std::string buffer;
+        F64 parse_ms = 0.0;
+        LLTimer timer;
+        for (S32 i = 0; i < runs; ++i)
+        {
+            LLXmlTree tree;
+            timer.reset();
+            ensure("parse", tree.parseFile(mTestFile, FALSE));
+            parse_ms += timer.getElapsedTimeF64() * 1000.0;
+            if (buffer.empty())
+            {
+                tree.writeBinary(buffer);
+            }
+        }
+
+        F64 binary_ms = 0.0;
+        for (S32 i = 0; i < runs; ++i)
+        {
+            LLXmlTree tree;
+            timer.reset();
+            ensure("read binary", tree.readBinary((const U8*)buffer.data(), buffer.size()));
+            binary_ms += timer.getElapsedTimeF64() * 1000.0;
+        }
+
+        LL_INFOS("Benchmark") << "LLXmlTree load, ms: parse " << parse_ms / runs
+                              << ", binary " << binary_ms / runs << " (" << buffer.size() << " bytes)" << LL_ENDL;
+    }
+} // namespace tut
@@ -2862,6 +2862,12 @@ LLKeyframeMotion* BDFloaterPoseCreator::onReadyTempMotion(std::string filename,
             mTempMotion->setEternal(true);
         }
 
+        //BD - We edit the curves' keys directly, have the motion play those back.
+        if (success)
+        {
+            mTempMotion->getJointMotionList()->unpackKeys();
+        }
+
         //BD - Cleanup the rest.
         delete[]anim_data;
     }
@@ -440,7 +440,8 @@ void AISAPI::FetchItem(const LLUUID &itemId, ITEM_TYPE type, completion_t callba
     LLCoprocedureManager::CoProcedure_t proc(boost::bind(&AISAPI::InvokeAISCommandCoro,
         _1, getFn, url, itemId, LLSD(), callback, FETCHITEM));
 
-    EnqueueAISCommand("FetchItem", proc);
+    // Identical fetches without a callback are interchangeable
+    EnqueueAISCommand("FetchItem", proc, callback ? std::string() : url);
 }
 
 /*static*/
@@ -491,7 +492,8 @@ void AISAPI::FetchCategoryChildren(const LLUUID &catId, ITEM_TYPE type, bool rec
     LLCoprocedureManager::CoProcedure_t proc(boost::bind(&AISAPI::InvokeAISCommandCoro,
         _1, getFn, url, catId, body, callback, FETCHCATEGORYCHILDREN));
 
-    EnqueueAISCommand("FetchCategoryChildren", proc);
+    // Identical fetches without a callback are interchangeable
+    EnqueueAISCommand("FetchCategoryChildren", proc, callback ? std::string() : url);
 }
 
 // some folders can be requested by name, like
@@ -544,7 +546,8 @@ void AISAPI::FetchCategoryChildren(const std::string &identifier, bool recursive
     LLCoprocedureManager::CoProcedure_t proc(boost::bind(&AISAPI::InvokeAISCommandCoro,
         _1, getFn, url, LLUUID::null, body, callback, FETCHCATEGORYCHILDREN));
 
-    EnqueueAISCommand("FetchCategoryChildren", proc);
+    // Identical fetches without a callback are interchangeable
+    EnqueueAISCommand("FetchCategoryChildren", proc, callback ? std::string() : url);
 }
 
 /*static*/
@@ -595,7 +598,8 @@ void AISAPI::FetchCategoryCategories(const LLUUID &catId, ITEM_TYPE type, bool r
     LLCoprocedureManager::CoProcedure_t proc(boost::bind(&AISAPI::InvokeAISCommandCoro,
         _1, getFn, url, catId, body, callback, FETCHCATEGORYCATEGORIES));
 
-    EnqueueAISCommand("FetchCategoryCategories", proc);
+    // Identical fetches without a callback are interchangeable
+    EnqueueAISCommand("FetchCategoryCategories", proc, callback ? std::string() : url);
 }
 
 void AISAPI::FetchCategorySubset(const LLUUID& catId,
@@ -710,7 +714,8 @@ void AISAPI::FetchCOF(completion_t callback)
     LLCoprocedureManager::CoProcedure_t proc(boost::bind(&AISAPI::InvokeAISCommandCoro,
                                                          _1, getFn, url, LLUUID::null, body, callback, FETCHCOF));
 
-    EnqueueAISCommand("FetchCOF", proc);
+    // Identical fetches without a callback are interchangeable
+    EnqueueAISCommand("FetchCOF", proc, callback ? std::string() : url);
 }
 
 void AISAPI::FetchCategoryLinks(const LLUUID &catId, completion_t callback)
@@ -746,7 +751,8 @@ void AISAPI::FetchCategoryLinks(const LLUUID &catId, completion_t callback)
     LLCoprocedureManager::CoProcedure_t proc(
         boost::bind(&AISAPI::InvokeAISCommandCoro, _1, getFn, url, LLUUID::null, body, callback, FETCHCATEGORYLINKS));
 
-    EnqueueAISCommand("FetchCategoryLinks", proc);
+    // Identical fetches without a callback are interchangeable
+    EnqueueAISCommand("FetchCategoryLinks", proc, callback ? std::string() : url);
 }
 
 /*static*/
@@ -783,14 +789,17 @@ void AISAPI::FetchOrphans(completion_t callback)
 }
 
 /*static*/
-void AISAPI::EnqueueAISCommand(const std::string &procName, LLCoprocedureManager::CoProcedure_t proc)
+void AISAPI::EnqueueAISCommand(const std::string &procName, LLCoprocedureManager::CoProcedure_t proc,
+                               const std::string &coalesceKey)
 {
     LLCoprocedureManager &inst = LLCoprocedureManager::instance();
     S32 pending_in_pool = inst.countPending("AIS");
     std::string procFullName = "AIS(" + procName + ")";
+    LLCoprocedureManager::QueueOptions options;
+    options.mKey = coalesceKey;
     if (pending_in_pool < MAX_SIMULTANEOUS_COROUTINES)
     {
-        inst.enqueueCoprocedure("AIS", procFullName, proc);
+        inst.enqueueCoprocedure("AIS", procFullName, proc, options);
     }
     else
     {
@@ -799,12 +808,12 @@ void AISAPI::EnqueueAISCommand(const std::string &procName, LLCoprocedureManager
         // so this is a workaround to not overfill it.
         if (sPostponedQuery.empty())
         {
-            sPostponedQuery.push_back(ais_query_item_t(procFullName, proc));
+            sPostponedQuery.push_back(ais_query_item_t(ais_proc_t(procFullName, proc), options));
             gIdleCallbacks.addFunction(onIdle, NULL);
         }
         else
         {
-            sPostponedQuery.push_back(ais_query_item_t(procFullName, proc));
+            sPostponedQuery.push_back(ais_query_item_t(ais_proc_t(procFullName, proc), options));
         }
     }
 }
@@ -819,7 +828,7 @@ void AISAPI::onIdle(void *userdata)
         while (pending_in_pool < MAX_SIMULTANEOUS_COROUTINES && !sPostponedQuery.empty())
         {
             ais_query_item_t &item = sPostponedQuery.front();
-            inst.enqueueCoprocedure("AIS", item.first, item.second);
+            inst.enqueueCoprocedure("AIS", item.first.first, item.first.second, item.second);
             sPostponedQuery.pop_front();
             pending_in_pool++;
         }
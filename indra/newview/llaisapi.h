@@ -92,7 +92,10 @@ class AISAPI
     typedef boost::function < LLSD (LLCoreHttpUtil::HttpCoroutineAdapter::ptr_t, LLCore::HttpRequest::ptr_t,
         const std::string, LLSD, LLCore::HttpOptions::ptr_t, LLCore::HttpHeaders::ptr_t) > invokationFn_t;
 
-    static void EnqueueAISCommand(const std::string &procName, LLCoprocedureManager::CoProcedure_t proc);
+    // A non-empty coalesceKey lets a still-queued request with the same
+    // key stand in for this one.  Only pass one when there is no callback.
+    static void EnqueueAISCommand(const std::string &procName, LLCoprocedureManager::CoProcedure_t proc,
+                                  const std::string &coalesceKey = std::string());
     static void onIdle(void *userdata); // launches postponed AIS commands
     static void onUpdateReceived(const LLSD& update, COMMAND_TYPE type, const LLSD& request_body);
 
@@ -103,7 +106,8 @@ class AISAPI
         invokationFn_t invoke, std::string url, LLUUID targetId, LLSD body,
         completion_t callback, COMMAND_TYPE type);
 
-    typedef std::pair<std::string, LLCoprocedureManager::CoProcedure_t> ais_query_item_t;
+    typedef std::pair<std::string, LLCoprocedureManager::CoProcedure_t> ais_proc_t;
+    typedef std::pair<ais_proc_t, LLCoprocedureManager::QueueOptions> ais_query_item_t;
     static std::list<ais_query_item_t> sPostponedQuery;
 };
 
@@ -119,6 +119,7 @@
 #include "llscenemonitor.h"
 #include "llavatarrenderinfoaccountant.h"
 #include "lllocalbitmaps.h"
+#include "llparallelcull.h"
 #include "llperfstats.h"
 #include "llgltfmateriallist.h"
 
@@ -253,6 +254,7 @@
 #include "llviewerassetstats.h"
 #include "gltfscenemanager.h"
 
+#include "jobsystem.h"
 #include "workqueue.h"
 using namespace LL;
 
@@ -558,6 +560,7 @@ static void settings_to_globals()
     LLVOVolume::sDistanceFactor         = 1.f-LLVOVolume::sLODFactor * 0.1f;
     LLVolumeImplFlexible::sUpdateFactor = gSavedSettings.getF32("RenderFlexTimeFactor");
     LLVOTree::sTreeFactor               = gSavedSettings.getF32("RenderTreeLODFactor");
+    LLVolumeFace::setOctreeBudget((U64)gSavedSettings.getU32("RenderFaceOctreeBudget") * 1024 * 1024);
     LLVOAvatar::sLODFactor              = llclamp(gSavedSettings.getF32("RenderAvatarLODFactor"), 0.f, MAX_AVATAR_LOD_FACTOR);
     LLVOAvatar::sPhysicsLODFactor       = llclamp(gSavedSettings.getF32("RenderAvatarPhysicsLODFactor"), 0.f, MAX_AVATAR_LOD_FACTOR);
     LLVOAvatar::updateImpostorRendering(gSavedSettings.getU32("RenderAvatarMaxNonImpostors"));
@@ -2003,6 +2006,7 @@ bool LLAppViewer::cleanup()
     {
         mGeneralThreadPool->close();
     }
+    LLParallelCull::cleanupClass();
 
     sTextureFetch->shutDownTextureCacheThread() ;
     LLLFSThread::sLocal->shutdown();
@@ -2136,7 +2140,9 @@ void LLAppViewer::initGeneralThread()
         return;
     }
 
-    mGeneralThreadPool = new LL::ThreadPool("General", 3);
+    // A JobSystem, so work on the pool can also fan out over it with
+    // parallelFor (LLBVHLoader does).  Plain posts run as on a ThreadPool.
+    mGeneralThreadPool = new LL::JobSystem("General", 3);
     mGeneralThreadPool->start();
 }
 
@@ -2177,6 +2183,9 @@ bool LLAppViewer::initThreads()
     // general task background thread (LLPerfStats, etc)
     LLAppViewer::instance()->initGeneralThread();
 
+    // helpers for culling spatial partitions in parallel (LLPipeline::updateCull)
+    LLParallelCull::initClass(llclamp(cores / 4, 1, 3));
+
     LLAppViewer::sPurgeDiskCacheThread = new LLPurgeDiskCacheThread();
 
     if (LLTrace::BlockTimer::sLog || LLTrace::BlockTimer::sMetricLog)
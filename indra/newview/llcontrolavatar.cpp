@@ -373,6 +373,13 @@ void LLControlAvatar::idleUpdate(LLAgent &agent, const F64 &time)
     }
 }
 
+//virtual
+bool LLControlAvatar::canAnimateInParallel() const
+{
+    // idleUpdate() has to see this to kill the avatar
+    return !mMarkedForDeath && LLVOAvatar::canAnimateInParallel();
+}
+
 void LLControlAvatar::markDead()
 {
     mRootVolp = NULL;
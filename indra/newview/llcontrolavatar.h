@@ -60,6 +60,7 @@ class LLControlAvatar final :
     void markForDeath();
 
     virtual void idleUpdate(LLAgent &agent, const F64 &time);
+    virtual bool canAnimateInParallel() const;
     virtual bool computeNeedsUpdate();
     virtual bool updateCharacter(LLAgent &agent);
 
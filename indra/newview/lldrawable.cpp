@@ -916,8 +916,15 @@ void LLDrawable::updateDistance(LLCamera& camera, bool force_update)
             pos = LLVector3(getPositionGroup().getF32ptr());
         }
 
-        pos -= camera.getOrigin();
-        mDistanceWRTCamera = ll_round(pos.magVec(), 0.01f);
+        if (volume && gObjectList.hasCurrentScore(volume, camera.getOrigin()))
+        {   // scored this frame by LLViewerObjectList::updateApparentAngles
+            mDistanceWRTCamera = gObjectList.getScores().getLODDistance(volume->getScoreIndex());
+        }
+        else
+        {
+            pos -= camera.getOrigin();
+            mDistanceWRTCamera = ll_round(pos.magVec(), 0.01f);
+        }
         mVObjp->updateLOD();
     }
 }
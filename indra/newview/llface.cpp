@@ -34,6 +34,7 @@
 #include "llvolume.h"
 #include "m3math.h"
 #include "llmatrix4a.h"
+#include "llvertexkernels.h"
 #include "v3color.h"
 
 #include "lldefs.h"
@@ -764,46 +765,6 @@ static void xform(LLVector2 &tex_coord, F32 cosAng, F32 sinAng, F32 offS, F32 of
     tex_coord.mV[1] = t;
 }
 
-// Transform the texture coordinates for this face.
-static void xform4a(LLVector4a &tex_coord, const LLVector4a& trans, const LLVector4Logical& mask, const LLVector4a& rot0, const LLVector4a& rot1, const LLVector4a& offset, const LLVector4a& scale)
-{
-    //tex coord is two coords, <s0, t0, s1, t1>
-    LLVector4a st;
-
-    // Texture transforms are done about the center of the face.
-    st.setAdd(tex_coord, trans);
-
-    // <s0 * cosAng, s0*-sinAng, s1*cosAng, s1*-sinAng>
-    LLVector4a s0;
-    s0.splat(st, 0);
-    LLVector4a s1;
-    s1.splat(st, 2);
-    LLVector4a ss;
-    ss.setSelectWithMask(mask, s1, s0);
-
-    LLVector4a a;
-    a.setMul(rot0, ss);
-
-    // <t0*sinAng, t0*cosAng, t1*sinAng, t1*cosAng>
-    LLVector4a t0;
-    t0.splat(st, 1);
-    LLVector4a t1;
-    t1.splat(st, 3);
-    LLVector4a tt;
-    tt.setSelectWithMask(mask, t1, t0);
-
-    LLVector4a b;
-    b.setMul(rot1, tt);
-
-    st.setAdd(a,b);
-
-    // Then scale
-    st.mul(scale);
-
-    // Then offset
-    tex_coord.setAdd(st, offset);
-}
-
 
 bool less_than_max_mag(const LLVector4a& vec)
 {
@@ -1585,98 +1546,28 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
                         else
                         {
                             LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("ggv - texgen 2");
-                            F32* dst = (F32*) tex_coords0.get();
-                            LLVector4a* src = (LLVector4a*) vf.mTexCoords;
-
-                            LLVector4a trans;
-                            trans.splat(-0.5f);
-
-                            LLVector4a rot0;
-                            rot0.set(cos_ang, -sin_ang, cos_ang, -sin_ang);
-
-                            LLVector4a rot1;
-                            rot1.set(sin_ang, cos_ang, sin_ang, cos_ang);
-
-                            LLVector4a scale;
-                            scale.set(ms, mt, ms, mt);
-
-                            LLVector4a offset;
-                            offset.set(os+0.5f, ot+0.5f, os+0.5f, ot+0.5f);
-
-                            LLVector4Logical mask;
-                            mask.clear();
-                            mask.setElement<2>();
-                            mask.setElement<3>();
-
-                            U32 count = num_vertices/2 + num_vertices%2;
-
-                            for (S32 i = 0; i < count; i++)
-                            {
-                                LLVector4a res = *src++;
-                                xform4a(res, trans, mask, rot0, rot1, offset, scale);
-                                res.store4a(dst);
-                                dst += 4;
-                            }
+                            LLVertexKernels::xformTexCoords(vf.mTexCoords, num_vertices,
+                                cos_ang, sin_ang, os, ot, ms, mt, tex_coords0.get());
                         }
                     }
                     else
                     { //do tex mat, no texgen, no bump
-                        for (S32 i = 0; i < num_vertices; i++)
-                        {
-                            LLVector4a tc(vf.mTexCoords[i].mV[VX],vf.mTexCoords[i].mV[VY],0.f);
-                            mTextureMatrix->affineTransform(tc,tc);
-                            (tex_coords0++)->set(tc.getF32ptr());
-                        }
+                        LLVertexKernels::transformTexCoords(*mTextureMatrix, vf.mTexCoords, num_vertices, tex_coords0.get());
                     }
                 }
                 else
                 { //no bump, tex gen planar
                     LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - texgen planar");
+                    LLVector2* dst = tex_coords0.get();
+                    LLVertexKernels::planarTexCoords(vf.mNormals, vf.mPositions, scalea, num_vertices, dst);
+
                     if (do_tex_mat)
                     {
-                        for (S32 i = 0; i < num_vertices; i++)
-                        {
-                            LLVector2 tc(vf.mTexCoords[i]);
-                            const LLVector4a& norm = vf.mNormals[i];
-                            const LLVector4a& center = *(vf.mCenter);
-                            LLVector4a vec = vf.mPositions[i];
-                            vec.mul(scalea);
-                            planarProjection(tc, norm, center, vec);
-
-                            LLVector4a tmp(tc.mV[VX],tc.mV[VY],0.f);
-                            mTextureMatrix->affineTransform(tmp,tmp);
-                            (tex_coords0++)->set(tmp.getF32ptr());
-                        }
+                        LLVertexKernels::transformTexCoords(*mTextureMatrix, dst, num_vertices, dst);
                     }
                     else if (xforms != XFORM_NONE)
                     {
-                        for (S32 i = 0; i < num_vertices; i++)
-                        {
-                            LLVector2 tc(vf.mTexCoords[i]);
-                            const LLVector4a& norm = vf.mNormals[i];
-                            const LLVector4a& center = *(vf.mCenter);
-                            LLVector4a vec = vf.mPositions[i];
-                            vec.mul(scalea);
-                            planarProjection(tc, norm, center, vec);
-
-                            xform(tc, cos_ang, sin_ang, os, ot, ms, mt);
-
-                            *tex_coords0++ = tc;
-                        }
-                    }
-                    else
-                    {
-                        for (S32 i = 0; i < num_vertices; i++)
-                        {
-                            LLVector2 tc(vf.mTexCoords[i]);
-                            LLVector4a& norm = vf.mNormals[i];
-                            LLVector4a& center = *(vf.mCenter);
-                            LLVector4a vec = vf.mPositions[i];
-                            vec.mul(scalea);
-                            planarProjection(tc, norm, center, vec);
-
-                            *tex_coords0++ = tc;
-                        }
+                        LLVertexKernels::xformTexCoords(dst, num_vertices, cos_ang, sin_ang, os, ot, ms, mt, dst);
                     }
                 }
             }
@@ -1746,43 +1637,29 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
                     }
                     const bool do_xform = (xforms & xform_channel) != XFORM_NONE;
 
+                    LLVector2* tc = dst.get();
 
-                    for (S32 i = 0; i < num_vertices; i++)
+                    if (texgen == LLTextureEntry::TEX_GEN_PLANAR)
                     {
-                        LLVector2 tc(vf.mTexCoords[i]);
-
-                        LLVector4a& norm = vf.mNormals[i];
-
-                        LLVector4a& center = *(vf.mCenter);
-
-                        if (texgen != LLTextureEntry::TEX_GEN_DEFAULT)
-                        {
-                            LLVector4a vec = vf.mPositions[i];
-
-                            vec.mul(scalea);
-
-                            if (texgen == LLTextureEntry::TEX_GEN_PLANAR)
-                            {
-                                planarProjection(tc, norm, center, vec);
-                            }
-                        }
+                        LLVertexKernels::planarTexCoords(vf.mNormals, vf.mPositions, scalea, num_vertices, tc);
+                    }
+                    else
+                    {
+                        memcpy(tc, vf.mTexCoords, num_vertices * sizeof(LLVector2));
+                    }
 
-                        if (tex_mode && mTextureMatrix)
-                        {
-                            LLVector4a tmp(tc.mV[VX],tc.mV[VY],0.f);
-                            mTextureMatrix->affineTransform(tmp,tmp);
-                            tc.set(tmp.getF32ptr());
-                        }
-                        else if (do_xform)
-                        {
-                            xform(tc, cos_ang, sin_ang, os, ot, ms, mt);
-                        }
+                    if (tex_mode && mTextureMatrix)
+                    {
+                        LLVertexKernels::transformTexCoords(*mTextureMatrix, tc, num_vertices, tc);
+                    }
+                    else if (do_xform)
+                    {
+                        LLVertexKernels::xformTexCoords(tc, num_vertices, cos_ang, sin_ang, os, ot, ms, mt, tc);
+                    }
 
-                        *dst++ = tc;
-                        if ((!mat && !gltf_mat) && do_bump)
-                        {
-                            bump_tc.push_back(tc);
-                        }
+                    if (ch == 0 && (!mat && !gltf_mat) && do_bump)
+                    {
+                        bump_tc.assign(tc, tc + num_vertices);
                     }
                 }
 
@@ -1829,32 +1706,11 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
         if (rebuild_pos)
         {
-            LLVector4a* src = vf.mPositions;
-
-            //_mm_prefetch((char*)src, _MM_HINT_T0);
-
-            LLVector4a* end = src+num_vertices;
-            //LLVector4a* end_64 = end-4;
-
+            LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - position");
             llassert(num_vertices > 0);
 
             mVertexBuffer->getVertexStrider(vert, mGeomIndex, mGeomCount);
 
-
-            F32* dst = (F32*) vert.get();
-            F32* end_f32 = dst+mGeomCount*4;
-
-            //_mm_prefetch((char*)dst, _MM_HINT_NTA);
-            //_mm_prefetch((char*)src, _MM_HINT_NTA);
-
-            //_mm_prefetch((char*)dst, _MM_HINT_NTA);
-
-
-            LLVector4a res0; //,res1,res2,res3;
-            res0.clear();
-
-            LLVector4a texIdx;
-
             S32 index = mTextureIndex < FACE_DO_NOT_BATCH_TEXTURES ? mTextureIndex : 0;
 
             F32 val = 0.f;
@@ -1863,28 +1719,8 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
             llassert(index < LLGLSLShader::sIndexedTextureChannels);
 
-            LLVector4Logical mask;
-            mask.clear();
-            mask.setElement<3>();
-
-            texIdx.set(0,0,0,val);
-
-            LLVector4a tmp;
-
-
-            while (src < end)
-            {
-                mat_vert.affineTransform(*src++, res0);
-                tmp.setSelectWithMask(mask, texIdx, res0);
-                tmp.store4a((F32*) dst);
-                dst += 4;
-            }
-
-            while (dst < end_f32)
-            {
-                res0.store4a((F32*) dst);
-                dst += 4;
-            }
+            LLVertexKernels::transformPositions(mat_vert, vf.mPositions, num_vertices, val,
+                                                (LLVector4a*) vert.get(), mGeomCount);
         }
 
         if (rebuild_normal)
@@ -1892,17 +1728,7 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
             LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - normal");
 
             mVertexBuffer->getNormalStrider(norm, mGeomIndex, mGeomCount);
-            F32* normals = (F32*) norm.get();
-            LLVector4a* src = vf.mNormals;
-            LLVector4a* end = src+num_vertices;
-
-            while (src < end)
-            {
-                LLVector4a normal;
-                mat_normal.rotate(*src++, normal);
-                normal.store4a(normals);
-                normals += 4;
-            }
+            LLVertexKernels::rotateNormals(mat_normal, vf.mNormals, num_vertices, (LLVector4a*) norm.get());
         }
 
         if (rebuild_tangent)
@@ -1913,23 +1739,7 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
             mVObjp->getVolume()->genTangents(face_index);
 
-            LLVector4Logical mask;
-            mask.clear();
-            mask.setElement<3>();
-
-            LLVector4a* src = vf.mTangents;
-            LLVector4a* end = vf.mTangents +num_vertices;
-
-            while (src < end)
-            {
-                LLVector4a tangent_out;
-                mat_normal.rotate(*src, tangent_out);
-                tangent_out.setSelectWithMask(mask, *src, tangent_out);
-                tangent_out.store4a(tangents);
-
-                src++;
-                tangents += 4;
-            }
+            LLVertexKernels::rotateTangents(mat_normal, vf.mTangents, num_vertices, (LLVector4a*) tangents);
         }
 
         if (rebuild_weights && vf.mWeights)
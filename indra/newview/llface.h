@@ -256,6 +256,11 @@ class alignas(16) LLFace
     LLVOAvatar* mAvatar = nullptr;
     LLMeshSkinInfo* mSkinInfo = nullptr;
 
+    // slot in the spatial group's LLSpatialGroup::BatchLayout this face was
+    // last placed in by a full genDrawInfo pass
+    U32 mBatchGeneration = 0;
+    U32 mBatchPosition = 0;
+
     // return mSkinInfo->mHash or 0 if mSkinInfo is null
     U64 getSkinHash();
 
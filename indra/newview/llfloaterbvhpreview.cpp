@@ -155,9 +155,6 @@ std::map <std::string, std::string> LLFloaterBvhPreview::getJointAliases()
 //-----------------------------------------------------------------------------
 BOOL LLFloaterBvhPreview::postBuild()
 {
-    LLKeyframeMotion* motionp = NULL;
-    LLBVHLoader* loaderp = NULL;
-
     if (!LLFloaterNameDesc::postBuild())
     {
         return FALSE;
@@ -189,6 +186,8 @@ BOOL LLFloaterBvhPreview::postBuild()
 
     mAnimPreview = new LLPreviewAnimation(256, 256);
 
+    std::shared_ptr<LLBVHLoader> loaderp;
+
     std::string exten = gDirUtilp->getExtension(mFilename);
     if (exten == "bvh")
     {
@@ -206,34 +205,74 @@ BOOL LLFloaterBvhPreview::postBuild()
         }
         else
         {
-            char*   file_buffer;
+            std::string file_buffer(file_size, '\0');
+            bool read = (file_size == infile.read(&file_buffer[0], file_size));
+            infile.close();
 
-            file_buffer = new char[file_size + 1];
-
-            if (file_size == infile.read(file_buffer, file_size))
+            if (read)
             {
-                file_buffer[file_size] = '\0';
                 LL_INFOS() << "Loading BVH file " << mFilename << LL_ENDL;
-                ELoadStatus load_status = E_ST_OK;
-                S32 line_number = 0;
-
                 std::map<std::string, std::string> joint_alias_map = getJointAliases();
 
-                loaderp = new LLBVHLoader(file_buffer, load_status, line_number, joint_alias_map);
-                std::string status = getString(BVHSTATUS[load_status]);
-
-                if(load_status == E_ST_NO_XLT_FILE)
+                // Parse and reduce the keys off the main thread, spreading
+                // the joints over the General pool, and show how far along
+                // it is until onBvhLoaded() sets up the preview.
+                std::shared_ptr<std::atomic<F32> > progress = std::make_shared<std::atomic<F32> >(0.f);
+                LLHandle<LLFloater> handle = getHandle();
+                auto on_progress = [progress](F32 fraction)
                 {
-                    LL_WARNS() << "NOTE: No translation table found." << LL_ENDL;
-                }
-                else
+                    // reports from the pool threads can overtake each other
+                    F32 current = *progress;
+                    while (fraction > current && !progress->compare_exchange_weak(current, fraction))
+                    {
+                    }
+                };
+                auto on_loaded = [handle](const std::shared_ptr<LLBVHLoader>& loader)
                 {
-                    LL_WARNS() << "ERROR: [line: " << line_number << "] " << status << LL_ENDL;
+                    LLFloaterBvhPreview* self = (LLFloaterBvhPreview*)handle.get();
+                    if (self)
+                    {
+                        self->onBvhLoaded(loader);
+                    }
+                };
+                if (LLBVHLoader::loadAsync(file_buffer, joint_alias_map, on_loaded, LLBVHLoader::poolParallelFor(), on_progress))
+                {
+                    mLoadProgress = progress;
+                    refresh();
+                    return TRUE;
                 }
+
+                ELoadStatus load_status = E_ST_OK;
+                S32 line_number = 0;
+                loaderp = std::make_shared<LLBVHLoader>(file_buffer.c_str(), load_status, line_number, joint_alias_map,
+                                                        LLBVHLoader::poolParallelFor());
             }
+        }
+    }
+
+    onBvhLoaded(loaderp);
+
+    return TRUE;
+}
 
-            infile.close() ;
-            delete[] file_buffer;
+//-----------------------------------------------------------------------------
+// onBvhLoaded()
+//-----------------------------------------------------------------------------
+void LLFloaterBvhPreview::onBvhLoaded(const std::shared_ptr<LLBVHLoader>& loaderp)
+{
+    LLKeyframeMotion* motionp = NULL;
+
+    mLoadProgress.reset();
+
+    if (loaderp)
+    {
+        if (loaderp->getStatus() == E_ST_NO_XLT_FILE)
+        {
+            LL_WARNS() << "NOTE: No translation table found." << LL_ENDL;
+        }
+        else
+        {
+            LL_WARNS() << "ERROR: [line: " << loaderp->getLineNumber() << "] " << getString(BVHSTATUS[loaderp->getStatus()]) << LL_ENDL;
         }
     }
 
@@ -334,10 +373,6 @@ BOOL LLFloaterBvhPreview::postBuild()
     }
 
     refresh();
-
-    delete loaderp;
-
-    return TRUE;
 }
 
 //-----------------------------------------------------------------------------
@@ -355,6 +390,13 @@ LLFloaterBvhPreview::~LLFloaterBvhPreview()
 //-----------------------------------------------------------------------------
 void LLFloaterBvhPreview::draw()
 {
+    if (mLoadProgress)
+    {
+        LLUIString out_str = getString("loading");
+        out_str.setArg("[PERCENT]", llformat("%d", ll_round(*mLoadProgress * 100.f)));
+        getChild<LLUICtrl>("bad_animation_text")->setValue(out_str.getString());
+    }
+
     LLFloater::draw();
     LLRect r = getRect();
 
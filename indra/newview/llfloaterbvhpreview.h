@@ -27,6 +27,9 @@
 #ifndef LL_LLFLOATERBVHPREVIEW_H
 #define LL_LLFLOATERBVHPREVIEW_H
 
+#include <atomic>
+#include <memory>
+
 #include "llassettype.h"
 #include "llfloaternamedesc.h"
 #include "lldynamictexture.h"
@@ -34,6 +37,7 @@
 #include "llquaternion.h"
 #include "llextendedstatus.h"
 
+class LLBVHLoader;
 class LLVOAvatar;
 class LLViewerJointMesh;
 
@@ -109,6 +113,9 @@ class LLFloaterBvhPreview final : public LLFloaterNameDesc
 private:
     void setAnimCallbacks() ;
     std::map <std::string, std::string> getJointAliases();
+    // Sets up the preview from a finished load, or reports why there is
+    // nothing to preview.
+    void onBvhLoaded(const std::shared_ptr<LLBVHLoader>& loaderp);
 
 
 protected:
@@ -128,6 +135,9 @@ class LLFloaterBvhPreview final : public LLFloaterNameDesc
     LLAnimPauseRequest  mPauseRequest;
 
     std::map<std::string, LLUUID>   mIDList;
+
+    // fraction of the BVH file loaded, while it loads off the main thread
+    std::shared_ptr<std::atomic<F32> > mLoadProgress;
 };
 
 #endif  // LL_LLFLOATERBVHPREVIEW_H
@@ -0,0 +1,67 @@
+/**
+ * @file lllinksetcomplexity.cpp
+ * @brief Cache of the render complexity of each linkset attached to an avatar
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lllinksetcomplexity.h"
+
+LLLinksetComplexityCache::Linkset& LLLinksetComplexityCache::get(const LLUUID& root_id)
+{
+    Linkset& linkset = mLinksets[root_id];
+    linkset.mGeneration = mGeneration;
+    return linkset;
+}
+
+void LLLinksetComplexityCache::endPass()
+{
+    for (linkset_map_t::iterator it = mLinksets.begin(); it != mLinksets.end();)
+    {
+        if (it->second.mGeneration != mGeneration)
+        {
+            it = mLinksets.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void LLLinksetComplexityCache::invalidate(const LLUUID& root_id)
+{
+    linkset_map_t::iterator it = mLinksets.find(root_id);
+    if (it != mLinksets.end())
+    {
+        it->second.mValid = false;
+    }
+}
+
+bool LLLinksetComplexityCache::isValid(const LLUUID& root_id) const
+{
+    linkset_map_t::const_iterator it = mLinksets.find(root_id);
+    return it != mLinksets.end() && it->second.mValid;
+}
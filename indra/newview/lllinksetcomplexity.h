@@ -0,0 +1,78 @@
+/**
+ * @file lllinksetcomplexity.h
+ * @brief Cache of the render complexity of each linkset attached to an avatar
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLLINKSETCOMPLEXITY_H
+#define LL_LLLINKSETCOMPLEXITY_H
+
+#include "lluuid.h"
+
+#include <boost/unordered/unordered_map.hpp>
+
+// Cost of each attached linkset (and of a control avatar's own), by root
+// object id, kept until something in the linkset changes.  Kept free of
+// LLViewerObject so that it can be tested on its own; LLVOAvatar does the
+// costing and the objects report their changes through
+// LLVOVolume::updateVisualComplexity().
+//
+// A complexity update is one pass: beginPass(), get() for every linkset
+// still attached, recomputing those that are not valid, then endPass() to
+// forget the ones that were not seen.
+class LLLinksetComplexityCache
+{
+public:
+    struct Linkset
+    {
+        F32  mCost = 0.f; // before clamping to the attachment limits
+        U32  mVisibleTriangles = 0;
+        F32  mEstTriangles = 0.f;
+        F32  mSurfaceArea = 0.f;
+        // false until computed, when something changed, or while any of
+        // the textures has yet to report its size
+        bool mValid = false;
+        U32  mGeneration = 0;
+    };
+
+    void beginPass() { ++mGeneration; }
+    // Entry of a linkset that is still attached, added invalid if new.
+    Linkset& get(const LLUUID& root_id);
+    // Forget the linksets that get() was not called for since beginPass().
+    void endPass();
+
+    // Something in the linkset changed; recompute it on the next pass.
+    void invalidate(const LLUUID& root_id);
+    void clear() { mLinksets.clear(); }
+
+    bool isValid(const LLUUID& root_id) const;
+    U32 size() const { return (U32)mLinksets.size(); }
+
+private:
+    typedef boost::unordered_map<LLUUID, Linkset> linkset_map_t;
+    linkset_map_t mLinksets;
+    U32 mGeneration = 0;
+};
+
+#endif // LL_LLLINKSETCOMPLEXITY_H
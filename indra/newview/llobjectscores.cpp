@@ -0,0 +1,211 @@
+/**
+ * @file llobjectscores.cpp
+ * @brief Per-object distance, LOD, apparent angle and interest scores
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llobjectscores.h"
+
+#include "llmath.h"
+#include "llvector4a.h"
+
+void LLObjectScores::clear()
+{
+    resize(0);
+}
+
+void LLObjectScores::resize(U32 count)
+{
+    for (std::vector<F32>* column : { &mX, &mY, &mZ, &mRadius, &mMaxScale, &mMidScale, &mHalfMinScale,
+                                      &mDistance, &mLODDistance, &mLODAdjusted, &mAppAngle, &mPixelArea, &mInterest })
+    {
+        column->resize(count, 0.f);
+    }
+    mFlags.resize(count, 0);
+}
+
+U32 LLObjectScores::add()
+{
+    U32 index = size();
+    resize(index + 1);
+    return index;
+}
+
+void LLObjectScores::removeSwap(U32 index)
+{
+    llassert(index < size());
+
+    U32 last = size() - 1;
+    if (index != last)
+    {
+        for (std::vector<F32>* column : { &mX, &mY, &mZ, &mRadius, &mMaxScale, &mMidScale, &mHalfMinScale,
+                                          &mDistance, &mLODDistance, &mLODAdjusted, &mAppAngle, &mPixelArea, &mInterest })
+        {
+            (*column)[index] = (*column)[last];
+        }
+        mFlags[index] = mFlags[last];
+    }
+    resize(last);
+}
+
+void LLObjectScores::set(U32 index, const LLVector3& center, F32 radius,
+                         F32 max_scale, F32 mid_scale, F32 min_scale, U32 flags)
+{
+    mX[index] = center.mV[VX];
+    mY[index] = center.mV[VY];
+    mZ[index] = center.mV[VZ];
+    mRadius[index] = radius;
+    mMaxScale[index] = max_scale;
+    mMidScale[index] = mid_scale;
+    mHalfMinScale[index] = min_scale/2;
+    mFlags[index] = flags | UNSCORED;
+}
+
+void LLObjectScores::score(const Params& params)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    mEye = params.mEye;
+
+    const U32 count = size();
+
+    // Distances, pixel area and interest for every entry.  Entries that end
+    // up on a special case below are overwritten there.
+    {
+        LLVector4a eye_x, eye_y, eye_z, ratio, near_radius;
+        eye_x.splat(params.mEye.mV[VX]);
+        eye_y.splat(params.mEye.mV[VY]);
+        eye_z.splat(params.mEye.mV[VZ]);
+        ratio.splat(params.mPixelMeterRatio);
+        near_radius.splat(params.mNearRadius);
+
+        U32 i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            LLVector4a dx, dy, dz;
+            dx.loadua(&mX[i]);
+            dy.loadua(&mY[i]);
+            dz.loadua(&mZ[i]);
+            dx.setSub(eye_x, dx);
+            dy.setSub(eye_y, dy);
+            dz.setSub(eye_z, dz);
+
+            // sqrt((dx*dx + dy*dy) + dz*dz)
+            LLVector4a dist, sq;
+            dist.setMul(dx, dx);
+            sq.setMul(dy, dy);
+            dist.add(sq);
+            sq.setMul(dz, dz);
+            dist.add(sq);
+            dist = _mm_sqrt_ps(dist);
+            _mm_storeu_ps(&mDistance[i], dist);
+
+            LLVector4a half_min, max_scale, mid_scale;
+            half_min.loadua(&mHalfMinScale[i]);
+            max_scale.loadua(&mMaxScale[i]);
+            mid_scale.loadua(&mMidScale[i]);
+
+            // (ppm * max_scale) * (ppm * mid_scale), ppm = ratio / range
+            LLVector4a range, ppm, area, t;
+            range.setSub(dist, half_min);
+            ppm.setDiv(ratio, range);
+            area.setMul(ppm, max_scale);
+            t.setMul(ppm, mid_scale);
+            area.mul(t);
+            _mm_storeu_ps(&mPixelArea[i], area);
+
+            // (rad * rad) / (dist - near_radius)
+            LLVector4a rad, interest, near_dist;
+            rad.loadua(&mRadius[i]);
+            interest.setMul(rad, rad);
+            near_dist.setSub(dist, near_radius);
+            interest.div(near_dist);
+            _mm_storeu_ps(&mInterest[i], interest);
+        }
+
+        for (; i < count; i++)
+        {
+            F32 dx = params.mEye.mV[VX] - mX[i];
+            F32 dy = params.mEye.mV[VY] - mY[i];
+            F32 dz = params.mEye.mV[VZ] - mZ[i];
+            F32 dist = sqrtf(dx*dx + dy*dy + dz*dz);
+            mDistance[i] = dist;
+
+            F32 ppm = params.mPixelMeterRatio / (dist - mHalfMinScale[i]);
+            mPixelArea[i] = (ppm * mMaxScale[i]) * (ppm * mMidScale[i]);
+
+            mInterest[i] = (mRadius[i] * mRadius[i]) / (dist - params.mNearRadius);
+        }
+    }
+
+    // Branches, rounding and atan2
+    const F32 ramp = params.mLODRampDistance;
+    for (U32 i = 0; i < count; i++)
+    {
+        mFlags[i] &= ~UNSCORED;
+
+        const F32 dist = mDistance[i];
+
+        const F32 range = dist - mHalfMinScale[i];
+        if (range < 0.001f || (mFlags[i] & HUD))
+        {
+            mAppAngle[i] = 180.f;
+            mPixelArea[i] = params.mScreenPixelArea;
+        }
+        else
+        {
+            mAppAngle[i] = (F32)atan2(mMaxScale[i], range) * RAD_TO_DEG;
+            if (mPixelArea[i] > params.mScreenPixelArea)
+            {
+                mAppAngle[i] = 180.f;
+                mPixelArea[i] = params.mScreenPixelArea;
+            }
+        }
+
+        const F32 lod_distance = ll_round(dist, 0.01f);
+        mLODDistance[i] = lod_distance;
+
+        F32 adjusted = lod_distance * params.mDistanceFactor;
+        if (adjusted < ramp)
+        {
+            // Boost LOD when you're REALLY close
+            adjusted *= 1.0f/ramp;
+            adjusted *= adjusted;
+            adjusted *= ramp;
+        }
+        mLODAdjusted[i] = adjusted * (F_PI/3.f);
+
+        const F32 near_dist = dist - params.mNearRadius;
+        if (near_dist <= 0.f)
+        {
+            mInterest[i] = LARGE_INTEREST;
+        }
+        else if (near_dist + params.mNearRadius >= params.mMaxDistance + mRadius[i])
+        {
+            mInterest[i] = 0.f; // out of draw distance
+        }
+    }
+}
@@ -0,0 +1,122 @@
+/**
+ * @file llobjectscores.h
+ * @brief Per-object distance, LOD, apparent angle and interest scores
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLOBJECTSCORES_H
+#define LL_LLOBJECTSCORES_H
+
+#include "v3math.h"
+
+#include <vector>
+
+// Structure-of-arrays table of the bounds the viewer scores objects by,
+// kept free of LLViewerObject so that it can be tested and timed on its
+// own.  score() fills every output column in one pass, four entries at a
+// time with SSE, followed by a scalar pass for the branches and atan2.
+//
+// The arithmetic is that of LLViewerObject::setPixelAreaAndAngle (apparent
+// angle and pixel area), LLDrawable::updateDistance plus LLVOVolume::calcLOD
+// (LOD distance) and the cache entry scene contribution that
+// LLViewerRegion::updateVisibleEntries loads by (interest), in the same
+// operation order.
+class LLObjectScores
+{
+public:
+    enum
+    {
+        HUD = 0x1,              // apparent angle is always 180 degrees
+        // free for the owner's use, carried along untouched
+        USER_FLAG_0 = 0x100,
+        // set() since the last score(), outputs are out of date
+        UNSCORED = 0x80000000,
+    };
+
+    struct Params
+    {
+        LLVector3 mEye;
+        // apparent angle and pixel area
+        F32 mPixelMeterRatio = 1.f;
+        F32 mScreenPixelArea = 1.f;
+        // LOD, see LLVOVolume::calcLOD
+        F32 mDistanceFactor = 1.f;
+        F32 mLODRampDistance = 2.f;
+        // interest, see LLViewerRegion::updateVisibleEntries
+        F32 mNearRadius = 0.f;
+        F32 mMaxDistance = 0.f;
+    };
+
+    // Interest of objects closer than the near radius, large enough to
+    // force them to load.
+    static constexpr F32 LARGE_INTEREST = 1000.f;
+
+    U32 size() const { return (U32)mFlags.size(); }
+    void clear();
+    void resize(U32 count);
+
+    // Append an entry with zero bounds and return its index.
+    U32 add();
+    // Move the last entry into index and shrink by one.
+    void removeSwap(U32 index);
+
+    // radius: LOD radius (also the interest radius).  max, mid and min
+    // scale: the object's extents for apparent angle and pixel area.
+    void set(U32 index, const LLVector3& center, F32 radius,
+             F32 max_scale, F32 mid_scale, F32 min_scale, U32 flags);
+
+    void score(const Params& params);
+
+    const LLVector3& getEye() const         { return mEye; }
+    U32 getFlags(U32 i) const               { return mFlags[i]; }
+    bool isScored(U32 i) const              { return !(mFlags[i] & UNSCORED); }
+    F32 getRadius(U32 i) const              { return mRadius[i]; }
+    // distance to the eye rounded to cm, as LLDrawable::mDistanceWRTCamera
+    F32 getLODDistance(U32 i) const         { return mLODDistance[i]; }
+    // LOD distance after the distance factor and close range ramp, the
+    // value LLVOVolume::computeLODDetail takes
+    F32 getLODAdjustedDistance(U32 i) const { return mLODAdjusted[i]; }
+    F32 getAppAngle(U32 i) const            { return mAppAngle[i]; }
+    F32 getPixelArea(U32 i) const           { return mPixelArea[i]; }
+    F32 getInterest(U32 i) const            { return mInterest[i]; }
+
+private:
+    // inputs
+    std::vector<F32> mX, mY, mZ;
+    std::vector<F32> mRadius;
+    std::vector<F32> mMaxScale, mMidScale, mHalfMinScale;
+    std::vector<U32> mFlags;
+
+    // outputs
+    std::vector<F32> mDistance;
+    std::vector<F32> mLODDistance;
+    std::vector<F32> mLODAdjusted;
+    std::vector<F32> mAppAngle;
+    std::vector<F32> mPixelArea;
+    std::vector<F32> mInterest;
+
+    LLVector3 mEye;
+};
+
+#endif // LL_LLOBJECTSCORES_H
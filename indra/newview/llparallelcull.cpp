@@ -0,0 +1,136 @@
+/**
+ * @file llparallelcull.cpp
+ * @brief Fork/join helper for culling independent spatial partitions
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+#include "llparallelcull.h"
+
+#include "threadpool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+LL::ThreadPool* LLParallelCull::sPool = nullptr;
+
+namespace
+{
+    // Shared between the caller and any helpers that pick it up.  Helpers
+    // hold a reference, so one that only gets scheduled after the batch
+    // has finished still finds valid (and exhausted) state.
+    class CullBatch
+    {
+    public:
+        CullBatch(U32 count, const std::function<void(U32)>& job)
+            : mCount(count), mJob(job), mNext(0), mDone(0)
+        {
+        }
+
+        void work()
+        {
+            U32 finished = 0;
+            for (U32 i = mNext++; i < mCount; i = mNext++)
+            {
+                mJob(i);
+                ++finished;
+            }
+
+            if (finished && (mDone += finished) == mCount)
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mFinished.notify_all();
+            }
+        }
+
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mFinished.wait(lock, [this]() { return mDone == mCount; });
+        }
+
+    private:
+        const U32 mCount;
+        // only dereferenced for claimed indices, all of which complete
+        // before the caller returns from LLParallelCull::run()
+        const std::function<void(U32)>& mJob;
+        std::atomic<U32> mNext;
+        std::atomic<U32> mDone;
+        std::mutex mMutex;
+        std::condition_variable mFinished;
+    };
+}
+
+//static
+void LLParallelCull::initClass(U32 threads)
+{
+    if (sPool)
+    {
+        return;
+    }
+
+    sPool = new LL::ThreadPool("Cull", threads);
+    sPool->start();
+}
+
+//static
+void LLParallelCull::cleanupClass()
+{
+    if (sPool)
+    {
+        sPool->close();
+        delete sPool;
+        sPool = nullptr;
+    }
+}
+
+//static
+void LLParallelCull::run(U32 count, const std::function<void(U32)>& job)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    if (!sPool || count < 2)
+    {
+        for (U32 i = 0; i < count; ++i)
+        {
+            job(i);
+        }
+        return;
+    }
+
+    auto batch = std::make_shared<CullBatch>(count, job);
+
+    U32 helpers = llmin((U32)sPool->getWidth(), count - 1);
+    for (U32 i = 0; i < helpers; ++i)
+    {
+        if (!sPool->getQueue().post([batch]() { batch->work(); }))
+        {
+            break;
+        }
+    }
+
+    batch->work();
+    batch->wait();
+}
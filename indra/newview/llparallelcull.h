@@ -0,0 +1,58 @@
+/**
+ * @file llparallelcull.h
+ * @brief Fork/join helper for culling independent spatial partitions
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPARALLELCULL_H
+#define LL_LLPARALLELCULL_H
+
+#include "threadpool_fwd.h"
+
+#include <functional>
+
+// Runs a batch of independent cull jobs on a small dedicated thread pool.
+// Volume geometry rebuilds borrow the same pool for their vertex fills.
+// The calling thread works through the batch alongside the pool and does
+// not return until every job has finished, so jobs may safely refer to
+// the caller's stack.  If the pool is busy or missing, the caller simply
+// ends up running the whole batch itself.
+class LLParallelCull
+{
+public:
+    static void initClass(U32 threads);
+    static void cleanupClass();
+
+    static bool isAvailable() { return sPool != nullptr; }
+
+    // Call job(i) once for each i in [0, count).  Jobs are claimed in
+    // index order but may finish in any order; callers write results
+    // into per-index storage and merge afterwards.
+    static void run(U32 count, const std::function<void(U32)>& job);
+
+private:
+    static LL::ThreadPool* sPool;
+};
+
+#endif // LL_LLPARALLELCULL_H
@@ -29,6 +29,7 @@
 #include "llcontrol.h"
 #include "pipeline.h"
 #include "llagentcamera.h"
+#include "llmotioncontroller.h"
 #include "llviewerwindow.h"
 #include "llvoavatar.h"
 #include "llwindow.h"
@@ -37,6 +38,9 @@
 
 extern LLControlGroup gSavedSettings;
 
+static_assert(LLPerfStats::ANIMATION_LOD_COUNT == LLMotionController::ANIMATION_LOD_COUNT,
+              "LLPerfStats::ANIMATION_LOD_COUNT out of step with LLMotionController");
+
 namespace LLPerfStats
 {
     // avatar timing metrics in ms (updated once per mainloop iteration)
@@ -44,6 +48,20 @@ namespace LLPerfStats
     std::atomic<F32> sAverageAvatarTime = 0.f;
     std::atomic<F32> sMaxAvatarTime = 0.f;
 
+    // animation LOD counters for the frame in progress, and the last one
+    std::array<std::atomic<U32>, ANIMATION_LOD_COUNT> sAnimationAvatars{};
+    std::array<std::atomic<U32>, ANIMATION_LOD_COUNT> sAnimationEvaluated{};
+    std::array<std::atomic<U64>, ANIMATION_LOD_COUNT> sAnimationTime{};
+    F64 sFullAnimationRaw{0.0}; // smoothed cost of one full LOD evaluation
+    AnimationLODStats sAnimationLODStats;
+
+    // complexity counters for the second in progress, and the last one
+    U32 sComplexityAvatars{0};
+    U32 sComplexityLinksets{0};
+    U32 sComplexityLinksetsCached{0};
+    F64 sComplexityPeriodStart{0.0};
+    ComplexityStats sComplexityStats;
+
     std::atomic<int64_t> tunedAvatars{0};
     std::atomic<U64> renderAvatarMaxART_ns{(U64)(ART_UNLIMITED_NANOS)}; // highest render time we'll allow without culling features
     bool belowTargetFPS{false};
@@ -284,6 +302,89 @@ namespace LLPerfStats
         }
     }
 
+    void recordAnimation(S32 lod, bool evaluated, U64 raw_time)
+    {
+        sAnimationAvatars[lod].fetch_add(1, std::memory_order_relaxed);
+        if (evaluated)
+        {
+            sAnimationEvaluated[lod].fetch_add(1, std::memory_order_relaxed);
+            sAnimationTime[lod].fetch_add(raw_time, std::memory_order_relaxed);
+        }
+    }
+
+    const AnimationLODStats& getAnimationLODStats()
+    {
+        return sAnimationLODStats;
+    }
+
+    static void updateAnimationLODStats()
+    {
+        const S32 full = LLMotionController::ANIMATION_LOD_FULL;
+        std::array<U64, ANIMATION_LOD_COUNT> raw_time;
+        U64 total_time = 0;
+        U32 total_evaluated = 0;
+        for (S32 lod = 0; lod < ANIMATION_LOD_COUNT; ++lod)
+        {
+            sAnimationLODStats.avatars[lod] = sAnimationAvatars[lod].exchange(0);
+            sAnimationLODStats.evaluated[lod] = sAnimationEvaluated[lod].exchange(0);
+            raw_time[lod] = sAnimationTime[lod].exchange(0);
+            total_time += raw_time[lod];
+            total_evaluated += sAnimationLODStats.evaluated[lod];
+        }
+
+        if (sAnimationLODStats.evaluated[full])
+        {
+            F64 mean = (F64)raw_time[full] / sAnimationLODStats.evaluated[full];
+            sFullAnimationRaw = sFullAnimationRaw > 0.0 ? sFullAnimationRaw + (mean - sFullAnimationRaw) * 0.1 : mean;
+        }
+        else if (sFullAnimationRaw <= 0.0 && total_evaluated)
+        {
+            // nobody close enough yet, the best we have
+            sFullAnimationRaw = (F64)total_time / total_evaluated;
+        }
+
+        F64 saved = 0.0;
+        for (S32 lod = full + 1; lod < ANIMATION_LOD_COUNT; ++lod)
+        {
+            saved += llmax(0.0, sFullAnimationRaw * sAnimationLODStats.avatars[lod] - (F64)raw_time[lod]);
+        }
+
+        sAnimationLODStats.evaluateMs = cpu_hertz > 0.0 ? raw_to_ms(total_time) : 0.0;
+        sAnimationLODStats.savedMs = cpu_hertz > 0.0 ? raw_to_ms((U64)saved) : 0.0;
+    }
+
+    void recordComplexityUpdate(U32 linksets_computed, U32 linksets_cached)
+    {
+        ++sComplexityAvatars;
+        sComplexityLinksets += linksets_computed;
+        sComplexityLinksetsCached += linksets_cached;
+    }
+
+    const ComplexityStats& getComplexityStats()
+    {
+        return sComplexityStats;
+    }
+
+    static void updateComplexityStats()
+    {
+        const F64 now = LLFrameTimer::getTotalSeconds();
+        const F64 elapsed = now - sComplexityPeriodStart;
+        if (elapsed < 1.0)
+        {
+            return;
+        }
+        if (sComplexityPeriodStart > 0.0)
+        {
+            sComplexityStats.avatarsPerSecond = (U32)ll_round(sComplexityAvatars / elapsed);
+            sComplexityStats.linksetsPerSecond = (U32)ll_round(sComplexityLinksets / elapsed);
+            sComplexityStats.linksetsCachedPerSecond = (U32)ll_round(sComplexityLinksetsCached / elapsed);
+        }
+        sComplexityAvatars = 0;
+        sComplexityLinksets = 0;
+        sComplexityLinksetsCached = 0;
+        sComplexityPeriodStart = now;
+    }
+
     // called once per main loop iteration on main thread
     void updateClass()
     {
@@ -292,6 +393,9 @@ namespace LLPerfStats
         sTotalAvatarTime = LLVOAvatar::getTotalGPURenderTime();
         sAverageAvatarTime = LLVOAvatar::getAverageGPURenderTime();
         sMaxAvatarTime = LLVOAvatar::getMaxGPURenderTime();
+
+        updateAnimationLODStats();
+        updateComplexityStats();
     }
 
     //static
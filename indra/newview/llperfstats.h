@@ -46,6 +46,42 @@ namespace LLPerfStats
     // called once per main loop iteration
     void updateClass();
 
+    // Avatars animated in the last frame at each animation LOD (see
+    // LLVOAvatar::updateAnimationLOD()), how many of them had their motions
+    // evaluated rather than interpolated, and the CPU time it took. The
+    // saving is an estimate: each avatar is charged the mean cost of a full
+    // LOD evaluation, less what it actually spent.
+    // LLMotionController::ANIMATION_LOD_COUNT, checked in llperfstats.cpp
+    constexpr S32 ANIMATION_LOD_COUNT = 4;
+    struct AnimationLODStats
+    {
+        std::array<U32, ANIMATION_LOD_COUNT> avatars{};
+        std::array<U32, ANIMATION_LOD_COUNT> evaluated{};
+        F64 evaluateMs{0.0};
+        F64 savedMs{0.0};
+    };
+
+    // from any thread, once per avatar animated, lod being its
+    // LLMotionController::EAnimationLOD
+    void recordAnimation(S32 lod, bool evaluated, U64 raw_time);
+    // main thread
+    const AnimationLODStats& getAnimationLODStats();
+
+    // Avatar complexity recalculations over the last whole second (see
+    // LLVOAvatar::calculateUpdateRenderComplexity()): how many avatars
+    // were recalculated, and how many attached linksets had their cost
+    // recomputed rather than taken from the cache.
+    struct ComplexityStats
+    {
+        U32 avatarsPerSecond{0};
+        U32 linksetsPerSecond{0};
+        U32 linksetsCachedPerSecond{0};
+    };
+
+    // main thread, once per avatar recalculated
+    void recordComplexityUpdate(U32 linksets_computed, U32 linksets_cached);
+    const ComplexityStats& getComplexityStats();
+
 // Note if changing these, they should correspond with the log range of the correpsonding sliders
     static constexpr U64 ART_UNLIMITED_NANOS{50000000};
     static constexpr U64 ART_MINIMUM_NANOS{100000};
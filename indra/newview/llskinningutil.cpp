@@ -172,6 +172,44 @@ void LLSkinningUtil::checkSkinWeights(LLVector4a* weights, U32 num_vertices, con
 #endif
 }
 
+void LLSkinningUtil::applyBindShapeMatrix(LLMatrix4a* mat, S32 count, const LLMeshSkinInfo* skin)
+{
+    // positions are transformed with an implied w of 1, so make the bind
+    // shape matrix strictly affine before folding it in
+    LLMatrix4a bind_shape_matrix = skin->mBindShapeMatrix;
+    bind_shape_matrix.mMatrix[0].getF32ptr()[3] = 0.f;
+    bind_shape_matrix.mMatrix[1].getF32ptr()[3] = 0.f;
+    bind_shape_matrix.mMatrix[2].getF32ptr()[3] = 0.f;
+    bind_shape_matrix.mMatrix[3].getF32ptr()[3] = 1.f;
+
+    for (S32 j = 0; j < count; ++j)
+    {
+        matMul(bind_shape_matrix, mat[j], mat[j]);
+    }
+}
+
+void LLSkinningUtil::skinPositions(LLMatrix4a* mat, const LLVector4a* weights, const LLVector4a* src, U32 count,
+                                   LLVector4a* dst, LLVector4a& min, LLVector4a& max)
+{
+    llassert(count > 0);
+
+    LLMatrix4a final_mat;
+    getPerVertexSkinMatrixUnchecked(weights[0], mat, final_mat);
+    final_mat.affineTransform(src[0], dst[0]);
+
+    min = dst[0];
+    max = dst[0];
+
+    for (U32 j = 1; j < count; ++j)
+    {
+        getPerVertexSkinMatrixUnchecked(weights[j], mat, final_mat);
+        final_mat.affineTransform(src[j], dst[j]);
+
+        min.setMin(min, dst[j]);
+        max.setMax(max, dst[j]);
+    }
+}
+
 void LLSkinningUtil::getPerVertexSkinMatrix(
     F32* weights,
     const LLMatrix4a* mat,
@@ -55,6 +55,16 @@ namespace LLSkinningUtil
     void checkSkinWeights(LLVector4a* weights, U32 num_vertices, const LLMeshSkinInfo* skin);
     void getPerVertexSkinMatrix(F32* weights, const LLMatrix4a* mat, bool handle_bad_scale, LLMatrix4a& final_mat);
 
+    // Premultiply a palette from initSkinningMatrixPalette by the skin's bind
+    // shape matrix so each vertex needs a single transform in skinPositions.
+    void applyBindShapeMatrix(LLMatrix4a* mat, S32 count, const LLMeshSkinInfo* skin);
+
+    // Skin count positions against a palette from applyBindShapeMatrix and
+    // return their bounds.  Touches nothing but the arguments, so disjoint
+    // ranges of a face may be skinned on different threads.
+    void skinPositions(LLMatrix4a* mat, const LLVector4a* weights, const LLVector4a* src, U32 count,
+                       LLVector4a* dst, LLVector4a& min, LLVector4a& max);
+
     void updateRiggingInfo(const LLMeshSkinInfo* skin, LLVOAvatar *avatar, LLVolumeFace& vol_face);
 
     inline void scrubSkinWeights(LLVector4a* weights, U32 num_vertices, const LLMeshSkinInfo* skin)
@@ -291,6 +291,8 @@ void LLSpatialGroup::expandExtents(const LLVector4a* addingExtents, const LLXfor
     mBounds[0].mul(0.5f);
     mBounds[1].setSub(mExtents[0], mExtents[1]);
     mBounds[1].mul(0.5f);
+
+    updateBVHBounds();
 }
 
 BOOL LLSpatialGroup::addObject(LLDrawable *drawablep)
@@ -377,6 +379,7 @@ void LLSpatialPartition::rebuildGeom(LLSpatialGroup* group)
                         << index_count << " indices" << LL_ENDL;
                     group->mVertexBuffer = NULL;
                     group->mBufferMap.clear();
+                    group->mBatchLayouts.clear();
                 }
             }
         }
@@ -390,6 +393,7 @@ void LLSpatialPartition::rebuildGeom(LLSpatialGroup* group)
     {
         group->mVertexBuffer = NULL;
         group->mBufferMap.clear();
+        group->mBatchLayouts.clear();
     }
 
     group->mLastUpdateTime = gFrameTimeSeconds;
@@ -798,6 +802,9 @@ void LLSpatialGroup::handleDestruction(const TreeNode* node)
     }
     setState(DEAD);
 
+    //nodes can leave the tree without a removal notice (see LLOctreeRoot::balance)
+    getSpatialPartition()->dirtyBVH();
+
     for (element_iter i = getDataBegin(), i_end = getDataEnd(); i != i_end; ++i)
     {
         LLViewerOctreeEntry* entry = *i;
@@ -814,6 +821,7 @@ void LLSpatialGroup::handleDestruction(const TreeNode* node)
     clearDrawMap();
     mVertexBuffer = NULL;
     mBufferMap.clear();
+    mBatchLayouts.clear();
     sZombieGroups++;
     mOctreeNode = NULL;
 }
@@ -832,10 +840,17 @@ void LLSpatialGroup::handleChildAddition(const OctreeNode* parent, OctreeNode* c
     }
 
     unbound();
+    getSpatialPartition()->dirtyBVH();
 
     assert_states_valid(this);
 }
 
+void LLSpatialGroup::handleChildRemoval(const OctreeNode* parent, const OctreeNode* child)
+{
+    getSpatialPartition()->dirtyBVH();
+    super::handleChildRemoval(parent, child);
+}
+
 //virtual
 void LLSpatialGroup::rebound()
 {
@@ -870,6 +885,16 @@ void LLSpatialGroup::rebound()
             }
         }
     }
+
+    updateBVHBounds();
+}
+
+void LLSpatialGroup::updateBVHBounds()
+{
+    if (mBVHSlot >= 0 && !isDead())
+    {
+        getSpatialPartition()->setBVHBounds(mBVHSlot, mBounds);
+    }
 }
 
 void LLSpatialGroup::destroyGLState(bool keep_occlusion)
@@ -884,6 +909,7 @@ void LLSpatialGroup::destroyGLState(bool keep_occlusion)
     mLastUpdateTime = gFrameTimeSeconds;
     mVertexBuffer = NULL;
     mBufferMap.clear();
+    mBatchLayouts.clear();
 
     clearDrawMap();
 
@@ -922,6 +948,8 @@ LLSpatialPartition::LLSpatialPartition(U32 data_mask, BOOL render_by_group, LLVi
     mDepthMask = FALSE;
     mSlopRatio = 0.25f;
     mInfiniteFarClip = FALSE;
+    mBVHDirty = true;
+    mUseBVH = false;
 
     new LLSpatialGroup(mOctree, this);
 }
@@ -1036,6 +1064,7 @@ void LLSpatialPartition::shift(const LLVector4a &offset)
 { //shift octree node bounding boxes by offset
     LLSpatialShift shifter(offset);
     shifter.traverse(mOctree);
+    dirtyBVH();
 }
 
 class LLOctreeCull : public LLViewerOctreeCull
@@ -1240,6 +1269,23 @@ class LLOctreeCullDetectVisible: public LLOctreeCullShadow
     BOOL mResult;
 };
 
+// Records the groups T would hand to markNotCulled() instead of marking
+// them, so the traversal has no side effects and can run on any thread.
+template <class T>
+class LLOctreeCullRecord : public T
+{
+public:
+    LLOctreeCullRecord(LLCamera* camera, std::vector<LLSpatialGroup*>& visible)
+        : T(camera), mVisible(visible) { }
+
+    virtual void processGroup(LLViewerOctreeGroup* base_group)
+    {
+        mVisible.push_back((LLSpatialGroup*)base_group);
+    }
+
+    std::vector<LLSpatialGroup*>& mVisible;
+};
+
 class LLOctreeSelect : public LLOctreeCull
 {
 public:
@@ -1434,6 +1480,32 @@ extern BOOL gCubeSnapshot;
 S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_SPATIAL;
+    prepareCull();
+
+    if (LLPipeline::sShadowRender)
+    {
+        LLOctreeCullShadow culler(&camera);
+        setupBVHCull(culler, camera, true);
+        culler.traverse(mOctree);
+    }
+    else if (mInfiniteFarClip || (!LLPipeline::sUseFarClip && !gCubeSnapshot))
+    {
+        LLOctreeCullNoFarClip culler(&camera);
+        setupBVHCull(culler, camera, false);
+        culler.traverse(mOctree);
+    }
+    else
+    {
+        LLOctreeCull culler(&camera);
+        setupBVHCull(culler, camera, false);
+        culler.traverse(mOctree);
+    }
+
+    return 0;
+}
+
+void LLSpatialPartition::prepareCull()
+{
 #if LL_OCTREE_PARANOIA_CHECK
     ((LLSpatialGroup*)mOctree->getListener(0))->checkStates();
 #endif
@@ -1444,23 +1516,71 @@ S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
     ((LLSpatialGroup*)mOctree->getListener(0))->validate();
 #endif
 
+    updateBVH();
+}
+
+static bool use_flat_bvh()
+{
+    static LLCachedControl<bool> use_bvh(gSavedSettings, "RenderCullFlatBVH", true);
+    return use_bvh;
+}
+
+void LLSpatialPartition::updateBVH()
+{
+    mUseBVH = use_flat_bvh();
+    if (!mUseBVH || !mBVHDirty)
+    {
+        return;
+    }
+
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_SPATIAL;
+    mBVH.build(mOctree,
+        [](const OctreeNode* node) { return ((const LLSpatialGroup*) node->getListener(0))->getBounds(); },
+        [](const OctreeNode* node, S32 slot) { ((LLSpatialGroup*) node->getListener(0))->setBVHSlot(slot); });
+    mBVHDirty = false;
+}
+
+void LLSpatialPartition::setBVHBounds(S32 slot, const LLVector4a* bounds)
+{
+    if (!mBVHDirty && slot < (S32) mBVH.getSlotCount())
+    {
+        mBVH.setBounds(slot, bounds[0], bounds[1]);
+    }
+}
+
+void LLSpatialPartition::setupBVHCull(LLViewerOctreeCull& culler, LLCamera& camera, bool far_clip)
+{
+    const LLFlatBVH* bvh = getBVH();
+    if (bvh)
+    {
+        bvh->frustumCull(camera.getAgentPlanes(), camera.getActivePlaneMask(far_clip), mBVHResults);
+        culler.setBVHResults(mBVHResults.data(), far_clip);
+    }
+}
+
+void LLSpatialPartition::cullVisible(LLCamera& camera, std::vector<LLSpatialGroup*>& visible)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_SPATIAL;
+    llassert(LLPipeline::sUseOcclusion < 2 || LLPipeline::sReflectionRender);
+
     if (LLPipeline::sShadowRender)
     {
-        LLOctreeCullShadow culler(&camera);
+        LLOctreeCullRecord<LLOctreeCullShadow> culler(&camera, visible);
+        setupBVHCull(culler, camera, true);
         culler.traverse(mOctree);
     }
     else if (mInfiniteFarClip || (!LLPipeline::sUseFarClip && !gCubeSnapshot))
     {
-        LLOctreeCullNoFarClip culler(&camera);
+        LLOctreeCullRecord<LLOctreeCullNoFarClip> culler(&camera, visible);
+        setupBVHCull(culler, camera, false);
         culler.traverse(mOctree);
     }
     else
     {
-        LLOctreeCull culler(&camera);
+        LLOctreeCullRecord<LLOctreeCull> culler(&camera, visible);
+        setupBVHCull(culler, camera, false);
         culler.traverse(mOctree);
     }
-
-    return 0;
 }
 
 void pushVerts(LLDrawInfo* params)
@@ -3034,12 +3154,14 @@ void renderRaycast(LLDrawable* drawablep)
 
                     if (!volume->isUnique())
                     {
-                        if (!face.getOctree())
+                        std::shared_ptr<const LLVolumeOctree> octree = face.getOctree();
+                        if (!octree)
                         {
                             ((LLVolumeFace*) &face)->createOctree();
+                            octree = face.getOctree();
                         }
 
-                        renderOctreeRaycast(start, end, face.getOctree());
+                        renderOctreeRaycast(start, end, octree.get());
                     }
 
                     gGL.popMatrix();
@@ -3717,37 +3839,61 @@ class LLOctreeIntersect : public LLOctreeTraveler<LLViewerOctreeEntry, LLPointer
         }
     }
 
-    virtual LLDrawable* check(const OctreeNode* node)
+    void localSegment(LLSpatialPartition* part, LLVector4a& local_start, LLVector4a& local_end)
     {
-        node->accept(this);
+        local_start = mStart;
+        local_end   = mEnd;
 
-        for (U32 i = 0; i < node->getChildCount(); i++)
+        if (part->isBridge())
         {
-            const OctreeNode* child = node->getChild(i);
-            LLVector3 res;
+            LLMatrix4a local_matrix4a = part->asBridge()->mDrawable->getRenderMatrix();
+            local_matrix4a.invert();
 
-            LLSpatialGroup* group = (LLSpatialGroup*) child->getListener(0);
+            local_matrix4a.affineTransform(mStart, local_start);
+            local_matrix4a.affineTransform(mEnd, local_end);
+        }
+    }
 
-            LLVector4a size;
-            LLVector4a center;
+    virtual LLDrawable* check(const OctreeNode* node)
+    {
+        node->accept(this);
 
-            const LLVector4a* bounds = group->getBounds();
-            size = bounds[1];
-            center = bounds[0];
+        LLSpatialGroup* group = (LLSpatialGroup*) node->getListener(0);
+        LLSpatialPartition* part = group->getSpatialPartition();
+        const LLFlatBVH* bvh = part->getBVH();
 
-            LLVector4a local_start = mStart;
-            LLVector4a local_end   = mEnd;
+        if (bvh && group->getBVHSlot() >= 0 && node->getChildCount())
+        { //test all children at once, then again whenever a hit shortens the segment
+            LLVector4a local_start, local_end;
+            localSegment(part, local_start, local_end);
+            U32 hits = bvh->segmentHitChildren(group->getBVHSlot(), local_start, local_end);
 
-            if (group->getSpatialPartition()->isBridge())
+            for (U32 i = 0; i < node->getChildCount(); i++)
             {
-                LLMatrix4a local_matrix4a = group->getSpatialPartition()->asBridge()->mDrawable->getRenderMatrix();
-                local_matrix4a.invert();
-
-                local_matrix4a.affineTransform(mStart, local_start);
-                local_matrix4a.affineTransform(mEnd, local_end);
+                if (hits & (1 << i))
+                {
+                    LLDrawable* last_hit = mHit;
+                    check(node->getChild(i));
+                    if (mHit != last_hit)
+                    {
+                        localSegment(part, local_start, local_end);
+                        hits = bvh->segmentHitChildren(group->getBVHSlot(), local_start, local_end);
+                    }
+                }
             }
 
-            if (LLLineSegmentBoxIntersect(local_start, local_end, center, size))
+            return mHit;
+        }
+
+        for (U32 i = 0; i < node->getChildCount(); i++)
+        {
+            const OctreeNode* child = node->getChild(i);
+            const LLVector4a* bounds = ((LLSpatialGroup*) child->getListener(0))->getBounds();
+
+            LLVector4a local_start, local_end;
+            localSegment(part, local_start, local_end);
+
+            if (LLLineSegmentBoxIntersect(local_start, local_end, bounds[0], bounds[1]))
             {
                 check(child);
             }
@@ -3771,6 +3917,7 @@ class LLOctreeIntersect : public LLOctreeTraveler<LLViewerOctreeEntry, LLPointer
             LLSpatialBridge* bridge = part->asBridge();
             if (bridge && gPipeline.hasRenderType(bridge->mDrawableType))
             {
+                part->updateBVH();
                 check(part->mOctree);
             }
         }
@@ -3841,6 +3988,8 @@ LLDrawable* LLSpatialPartition::lineSegmentIntersect(const LLVector4a& start, co
     )
 
 {
+    updateBVH();
+
     LLOctreeIntersect intersect(start, end, pick_transparent, pick_rigged, pick_unselectable, pick_reflection_probe, face_hit, intersection, tex_coord, normal, tangent);
     LLDrawable* drawable = intersect.check(mOctree);
 
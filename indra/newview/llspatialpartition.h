@@ -30,6 +30,7 @@
 #define SG_MIN_DIST_RATIO 0.00001f
 
 #include "lldrawable.h"
+#include "llflatbvh.h"
 #include "lloctree.h"
 #include "llpointer.h"
 #include "llrefcount.h"
@@ -212,6 +213,28 @@ class LLSpatialGroup final : public LLOcclusionCullingGroup
     typedef boost::unordered_map<LLFace*, buffer_list_t> buffer_texture_map_t;
     typedef boost::unordered_map<U32, buffer_texture_map_t> buffer_map_t;
 
+    // Vertex buffer placement of one face list from the last full
+    // LLVolumeGeometryManager::genDrawInfo pass, so later rebuilds that
+    // don't move or resize any face can patch draw info in place.
+    struct BatchLayout
+    {
+        struct Slot
+        {
+            LLVertexBuffer* mBuffer;
+            U32 mGeomCount;
+            U32 mIndicesCount;
+        };
+
+        U32 mGeneration = 0; // matches LLFace::mBatchGeneration of every face in the layout, 0 if invalid
+        U32 mMask = 0;
+        bool mBatchTextures = false;
+        std::vector<Slot> mSlots; // indexed by LLFace::mBatchPosition
+        buffer_list_t mBuffers; // keeps mSlots buffers alive
+
+        void clear() { mGeneration = 0; mSlots.clear(); mBuffers.clear(); }
+    };
+    typedef std::vector<BatchLayout> batch_layout_list_t;
+
     struct CompareDistanceGreater
     {
         bool operator()(const LLSpatialGroup* const& lhs, const LLSpatialGroup* const& rhs)
@@ -317,10 +340,15 @@ class LLSpatialGroup final : public LLOcclusionCullingGroup
     virtual void handleRemoval(const TreeNode* node, LLViewerOctreeEntry* face);
     virtual void handleDestruction(const TreeNode* node);
     virtual void handleChildAddition(const OctreeNode* parent, OctreeNode* child);
+    virtual void handleChildRemoval(const OctreeNode* parent, const OctreeNode* child);
 
     // LLViewerOctreeGroup
     virtual void rebound();
 
+private:
+    // copy mBounds into the partition's flat BVH after it changes
+    void updateBVHBounds();
+
 public:
     LL_ALIGN_16(LLVector4a mViewAngle);
     LL_ALIGN_16(LLVector4a mLastUpdateViewAngle);
@@ -334,6 +362,7 @@ class LLSpatialGroup final : public LLOcclusionCullingGroup
 
     bridge_list_t mBridgeList;
     buffer_map_t mBufferMap; //used by volume buffers to attempt to reuse vertex buffers
+    batch_layout_list_t mBatchLayouts; //used by volume buffers to patch draw info without re-sorting faces
 
     F32 mObjectBoxSize; //cached mObjectBounds[1].getLength3()
     U32 mGeometryBytes; //used by volumes to track how many bytes of geometry data are in this node
@@ -402,6 +431,21 @@ class LLSpatialPartition: public LLViewerOctreePartition, public LLGeometryManag
     /*virtual*/ S32 cull(LLCamera &camera, bool do_occlusion=false); // Cull on arbitrary frustum
     S32 cull(LLCamera &camera, std::vector<LLDrawable *>* results, BOOL for_select); // Cull on arbitrary frustum
 
+    // cull() split in two so that many partitions can be culled at once (see LLPipeline::updateCull).
+    // prepareCull() rebounds the octree and must run on the main thread; cullVisible() then only
+    // reads the octree and appends the groups cull() would have passed to markNotCulled().
+    // Only valid when occlusion query readback is off, since that happens during traversal.
+    void prepareCull();
+    void cullVisible(LLCamera& camera, std::vector<LLSpatialGroup*>& visible);
+
+    // Flat copy of the octree's group bounds used to test siblings together when culling
+    // and picking.  Bounds follow LLSpatialGroup::rebound(), any change to the shape of
+    // the octree marks it dirty until the next updateBVH().
+    void dirtyBVH() { mBVHDirty = true; }
+    void updateBVH();
+    const LLFlatBVH* getBVH() const { return (mUseBVH && !mBVHDirty) ? &mBVH : NULL; }
+    void setBVHBounds(S32 slot, const LLVector4a* bounds);
+
     BOOL isVisible(const LLVector3& v);
     bool isHUDPartition() ;
 
@@ -425,6 +469,14 @@ class LLSpatialPartition: public LLViewerOctreePartition, public LLGeometryManag
     U32 mVertexDataMask;
     F32 mSlopRatio; //percentage distance must change before drawables receive LOD update (default is 0.25);
     bool mDepthMask; //if TRUE, objects in this partition will be written to depth during alpha rendering
+
+private:
+    void setupBVHCull(LLViewerOctreeCull& culler, LLCamera& camera, bool far_clip);
+
+    LLFlatBVH mBVH;
+    std::vector<U8> mBVHResults; // last frustum sweep, read by the culler that asked for it
+    bool mBVHDirty;
+    bool mUseBVH;
 };
 
 // class for creating bridges between spatial partitions
@@ -662,7 +714,8 @@ class LLVolumeGeometryManager: public LLGeometryManager
     virtual void rebuildMesh(LLSpatialGroup* group);
     virtual void getGeometry(LLSpatialGroup* group);
     virtual void addGeometryCount(LLSpatialGroup* group, U32& vertex_count, U32& index_count);
-    U32 genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace** faces, U32 face_count, BOOL distance_sort = FALSE, BOOL batch_textures = FALSE, BOOL rigged = FALSE);
+    // layout_index is the slot of this face list in LLSpatialGroup::mBatchLayouts
+    U32 genDrawInfo(LLSpatialGroup* group, U32 layout_index, U32 mask, LLFace** faces, U32 face_count, BOOL distance_sort = FALSE, BOOL batch_textures = FALSE, BOOL rigged = FALSE);
     void registerFace(LLSpatialGroup* group, LLFace* facep, U32 type);
 
 private:
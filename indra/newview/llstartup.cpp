@@ -124,6 +124,7 @@
 #include "llkeyboard.h"
 #include "llloginhandler.h"         // gLoginHandler, SLURL support
 #include "lllogininstance.h" // Host the login module.
+#include "llpacketcapture.h"
 #include "llpanellogin.h"
 #include "llmutelist.h"
 #include "llavatarpropertiesprocessor.h"
@@ -667,6 +668,12 @@ bool idle_startup()
             F32 dropPercent = gSavedSettings.getF32("PacketDropPercentage");
             msg->mPacketRing.setDropPercentage(dropPercent);
 
+            const std::string capture_file = gSavedSettings.getString("PacketCaptureFile");
+            if (!capture_file.empty())
+            {
+                LLPacketCapture::startCapture(gDirUtilp->getExpandedFilename(LL_PATH_LOGS, capture_file));
+            }
+
             F32 inBandwidth = gSavedSettings.getF32("InBandwidth");
             F32 outBandwidth = gSavedSettings.getF32("OutBandwidth");
             if (inBandwidth != 0.f)
@@ -1416,6 +1423,8 @@ bool idle_startup()
         display_startup();
 
         // init the shader managers
+        LLAvatarAppearance::setDefinitionCacheFile(gSavedSettings.getBOOL("AvatarDefinitionCache")
+            ? gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "avatar_definitions.bin") : std::string());
         LLAvatarAppearance::initClass("avatar_lad.xml","avatar_skeleton.xml");
         display_startup();
 
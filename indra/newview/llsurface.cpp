@@ -62,6 +62,7 @@ LLColor4U MAX_WATER_COLOR(0, 48, 96, 240);
 
 
 S32 LLSurface::sTextureSize = 256;
+U64 LLSurface::sLayerSequence = 0;
 
 // ---------------- LLSurface:: Public Members ---------------
 
@@ -78,6 +79,7 @@ LLSurface::LLSurface(U32 type, LLViewerRegion *regionp) :
     mGridsPerPatchEdge(0),
     mMetersPerGrid(1.0f),
     mMetersPerEdge(1.0f),
+    mCreatedLayerSequence(sLayerSequence),
     mRegionp(regionp)
 {
     // Surface data
@@ -752,15 +754,34 @@ template bool LLSurface::idleUpdate</*PBR=*/true>(F32 max_update_time);
 
 void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL b_large_patch)
 {
+    DecodedLayer layer;
+    decodeDCTPatches(bitpack, *gopp, b_large_patch, mPatchesPerEdge, layer);
+    applyDecodedPatches(layer, nextLayerSequence());
+}
+
+// static
+void LLSurface::decodeDCTPatches(LLBitPack &bitpack, const LLGroupHeader &goph, BOOL b_large_patch,
+                                 S32 patches_per_edge, DecodedLayer &layer)
+{
+    LL_PROFILE_ZONE_SCOPED;
 
     LLPatchHeader  ph;
     S32 j, i;
     S32 patch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-    LLSurfacePatch *patchp;
 
-    init_patch_decompressor(gopp->patch_size);
-    gopp->stride = mGridsPerEdge;
-    set_group_of_patch_header(gopp);
+    if (goph.patch_size != NORMAL_PATCH_SIZE && goph.patch_size != LARGE_PATCH_SIZE)
+    {
+        LL_WARNS() << "Received invalid terrain packet - unsupported patch size " << (S32)goph.patch_size << LL_ENDL;
+        return;
+    }
+
+    // Decode into a packed patch-sized buffer; the stride into the surface is
+    // applied when the heights are copied on the main thread.
+    LLGroupHeader group = goph;
+    group.stride = group.patch_size;
+
+    const S32 patch_area = group.patch_size * group.patch_size;
+    layer.mPatchSize = group.patch_size;
 
     while (1)
     {
@@ -781,10 +802,10 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL
             j = ph.patchids & 0x1F; //y
         }
 
-        if ((i >= mPatchesPerEdge) || (j >= mPatchesPerEdge))
+        if ((i >= patches_per_edge) || (j >= patches_per_edge))
         {
             LL_WARNS() << "Received invalid terrain packet - patch header patch ID incorrect!"
-                << " patches per edge " << mPatchesPerEdge
+                << " patches per edge " << patches_per_edge
                 << " i " << i
                 << " j " << j
                 << " dc_offset " << ph.dc_offset
@@ -795,11 +816,60 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL
             return;
         }
 
-        patchp = &mPatchList[j*mPatchesPerEdge + i];
+        decode_patch(bitpack, patch);
 
+        layer.mPatches.push_back({ i, j });
+        layer.mHeights.resize(layer.mHeights.size() + patch_area);
+        decompress_patch(&layer.mHeights[layer.mHeights.size() - patch_area], patch, &ph, &group);
+    }
+}
 
-        decode_patch(bitpack, patch);
-        decompress_patch(patchp->getDataZ(), patch, &ph);
+void LLSurface::applyDecodedPatches(const DecodedLayer &layer, U64 sequence)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    if (layer.mPatches.empty() || !mPatchList)
+    {
+        return;
+    }
+
+    if (sequence <= mCreatedLayerSequence)
+    {
+        // Decoded for a previous incarnation of this region.
+        return;
+    }
+
+    const S32 patch_size = layer.mPatchSize;
+    const F32 *heights = layer.mHeights.data();
+
+    for (const DecodedPatch &decoded : layer.mPatches)
+    {
+        const F32 *src = heights;
+        heights += patch_size * patch_size;
+
+        if ((decoded.mX >= mPatchesPerEdge) || (decoded.mY >= mPatchesPerEdge))
+        {
+            continue;
+        }
+
+        const S32 index = decoded.mY*mPatchesPerEdge + decoded.mX;
+        if (mPatchLayerSequence[index] > sequence)
+        {
+            // A newer layer already updated this patch.
+            continue;
+        }
+        mPatchLayerSequence[index] = sequence;
+
+        LLSurfacePatch *patchp = &mPatchList[index];
+
+        // Clip to the surface in case the layer's patch size exceeds ours.
+        const S32 cols = llmin(patch_size, mGridsPerEdge - decoded.mX*(S32)mGridsPerPatchEdge);
+        const S32 rows = llmin(patch_size, mGridsPerEdge - decoded.mY*(S32)mGridsPerPatchEdge);
+        F32 *dst = patchp->getDataZ();
+        for (S32 row = 0; row < rows; row++)
+        {
+            memcpy(dst + row*mGridsPerEdge, src + row*patch_size, cols * sizeof(F32));
+        }
 
         // Update edges for neighbors.  Need to guarantee that this gets done before we generate vertical stats.
         patchp->updateNorthEdge();
@@ -1079,6 +1149,7 @@ void LLSurface::createPatchData()
 
     // Allocate memory
     mPatchList = new LLSurfacePatch[mNumberOfPatches];
+    mPatchLayerSequence.assign(mNumberOfPatches, 0);
 
     // One of each for each camera
     mVisiblePatchCount = mNumberOfPatches;
@@ -1197,6 +1268,7 @@ void LLSurface::destroyPatchData()
 
     delete [] mPatchList;
     mPatchList = NULL;
+    mPatchLayerSequence.clear();
     mVisiblePatchCount = 0;
 }
 
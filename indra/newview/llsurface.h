@@ -85,6 +85,31 @@ class LLSurface
     void disconnectAllNeighbors();
 
     virtual void decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL b_large_patch);
+
+    // Heights decoded from one LayerData land packet.
+    struct DecodedPatch
+    {
+        S32 mX;
+        S32 mY;
+    };
+    struct DecodedLayer
+    {
+        S32 mPatchSize = 0;
+        std::vector<DecodedPatch> mPatches;
+        std::vector<F32> mHeights;  // mPatchSize * mPatchSize per patch, in mPatches order
+    };
+
+    // Bitpack decode and IDCT of a land layer.  Touches no surface state so
+    // it can run on a worker thread.  On a malformed packet it stops and keeps
+    // the patches decoded so far, like decompressDCTPatch() always has.
+    static void decodeDCTPatches(LLBitPack &bitpack, const LLGroupHeader &goph, BOOL b_large_patch,
+                                 S32 patches_per_edge, DecodedLayer &layer);
+    // Copy decoded heights into the patches and update neighbor edges.
+    // Patches already written by a layer with a later sequence are left alone,
+    // as are layers queued before this surface was created.
+    void applyDecodedPatches(const DecodedLayer &layer, U64 sequence);
+    // Tag for a land layer, taken on the main thread when it is queued for decoding.
+    static U64 nextLayerSequence()                  { return ++sLayerSequence; }
     virtual void updatePatchVisibilities(LLAgent &agent);
 
     inline F32 getZ(const U32 k) const              { return mSurfaceZ[k]; }
@@ -220,9 +245,13 @@ class LLSurface
 
     S32         mSurfacePatchUpdateCount;                   // Number of frames since last update.
 
+    U64         mCreatedLayerSequence;      // Layer sequence when this surface was created
+    std::vector<U64> mPatchLayerSequence;   // Sequence of the layer that last wrote each patch
+
 private:
     LLViewerRegion *mRegionp; // Patch whose coordinate system this surface is using.
     static S32  sTextureSize;               // Size of the surface texture
+    static U64  sLayerSequence;             // Last land layer sequence handed out
 };
 
 extern template bool LLSurface::idleUpdate</*PBR=*/false>(F32 max_update_time);
@@ -42,6 +42,7 @@
 #include "llvlcomposition.h"
 #include "lldrawpool.h"
 #include "noise.h"
+#include "llterrainnormals.h"
 
 extern bool gShiftFrame;
 extern U64MicrosecondsImplicit gFrameTime;
@@ -244,6 +245,66 @@ void LLSurfacePatch::eval(const U32 x, const U32 y, const U32 stride, LLVector3
 }
 
 
+void LLSurfacePatch::evalRow(const U32 x, const U32 y, const U32 stride, const U32 count,
+                             LLStrider<LLVector3> &vertices, LLStrider<LLVector3> &normals,
+                             LLStrider<LLVector2> &tex0, LLStrider<LLVector2> &tex1)
+{
+    if (!mSurfacep || !mSurfacep->getRegion() || !mSurfacep->getGridsPerEdge() || !mVObjp)
+    {
+        // failsafe, leave the output alone as eval() does
+        vertices += count;
+        normals += count;
+        tex0 += count;
+        tex1 += count;
+        return;
+    }
+
+    // Everything eval() looks up per vertex that does not depend on x.
+    LLViewerRegion *regionp = mSurfacep->getRegion();
+    const U32 surface_stride = mSurfacep->getGridsPerEdge();
+    const F32 meters_per_grid = mSurfacep->getMetersPerGrid();
+    const LLVector3 origin_agent = getOriginAgent();
+    const LLVector3 region_origin_agent = mVObjp->getRegion()->getOriginAgent();
+    const LLVector3 surface_origin_agent = mSurfacep->getOriginAgent();
+    const S32 origin_region_x = llfloor(mOriginRegion.mV[0]);
+    const S32 origin_region_y = llfloor(mOriginRegion.mV[1]);
+
+    const F32 xyScale = 4.9215f*7.f; //0.93284f;
+    const F32 xyScaleInv = (1.f / xyScale)*(0.2222222222f);
+    const F32 noise_y = (F32)fmod((F32)(mOriginGlobal.mdV[1] + y)*xyScaleInv, 256.f);
+
+    const F32 *row_z = mDataZ + y*surface_stride;
+    const LLVector3 *row_norm = mDataNorm + y*surface_stride;
+
+    LLVector3 pos_agent = origin_agent;
+    pos_agent.mV[VY] += y * meters_per_grid;
+
+    for (U32 i = 0, px = x; i < count; i++, px += stride)
+    {
+        *normals++ = row_norm[px];
+
+        pos_agent.mV[VX] = origin_agent.mV[VX] + px * meters_per_grid;
+        pos_agent.mV[VZ] = row_z[px];
+        *vertices++ = pos_agent - region_origin_agent;
+
+        LLVector3 rel_pos = pos_agent - surface_origin_agent;
+        LLVector2 *t0 = tex0++;
+        t0->mV[0] = rel_pos.mV[0];
+        t0->mV[1] = rel_pos.mV[1];
+
+        LLVector2 *t1 = tex1++;
+        t1->mV[0] = regionp->getCompositionXY(origin_region_x + px, origin_region_y + y);
+
+        F32 vec[3] = {
+                        (F32)fmod((F32)(mOriginGlobal.mdV[0] + px)*xyScaleInv, 256.f),
+                        noise_y,
+                        0.f
+                    };
+        t1->mV[1] = llclamp(noise2(vec)* 0.75f + 0.5f, 0.f, 1.f);
+    }
+}
+
+
 template<>
 void LLSurfacePatch::calcNormal</*PBR=*/false>(const U32 x, const U32 y, const U32 stride)
 {
@@ -338,32 +399,21 @@ void LLSurfacePatch::calcNormal</*PBR=*/false>(const U32 x, const U32 y, const U
         }
     }
 
-    LLVector3 p00(-mpg,-mpg,
-                  *(ppatches[0][0]->mDataZ
-                  + poffsets[0][0][0]
-                  + poffsets[0][0][1]*poffsets[0][0][2]));
-    LLVector3 p01(-mpg,+mpg,
-                  *(ppatches[0][1]->mDataZ
-                  + poffsets[0][1][0]
-                  + poffsets[0][1][1]*poffsets[0][1][2]));
-    LLVector3 p10(+mpg,-mpg,
-                  *(ppatches[1][0]->mDataZ
-                  + poffsets[1][0][0]
-                  + poffsets[1][0][1]*poffsets[1][0][2]));
-    LLVector3 p11(+mpg,+mpg,
-                  *(ppatches[1][1]->mDataZ
-                  + poffsets[1][1][0]
-                  + poffsets[1][1][1]*poffsets[1][1][2]));
-
-    LLVector3 c1 = p11 - p00;
-    LLVector3 c2 = p01 - p10;
-
-    LLVector3 normal = c1;
-    normal %= c2;
-    normal.normVec();
+    const F32 z00 = *(ppatches[0][0]->mDataZ
+                      + poffsets[0][0][0]
+                      + poffsets[0][0][1]*poffsets[0][0][2]);
+    const F32 z01 = *(ppatches[0][1]->mDataZ
+                      + poffsets[0][1][0]
+                      + poffsets[0][1][1]*poffsets[0][1][2]);
+    const F32 z10 = *(ppatches[1][0]->mDataZ
+                      + poffsets[1][0][0]
+                      + poffsets[1][0][1]*poffsets[1][0][2]);
+    const F32 z11 = *(ppatches[1][1]->mDataZ
+                      + poffsets[1][1][0]
+                      + poffsets[1][1][1]*poffsets[1][1][2]);
 
     llassert(mDataNorm);
-    *(mDataNorm + surface_stride * y + x) = normal;
+    *(mDataNorm + surface_stride * y + x) = LLTerrainNormals::smoothNormal(z00, z01, z10, z11, mpg);
 }
 
 template<>
@@ -377,6 +427,47 @@ void LLSurfacePatch::calcNormal</*PBR=*/true>(const U32 x, const U32 y, const U3
     calcNormalFlat(normal_out, x, y, index);
 }
 
+template<>
+void LLSurfacePatch::calcNormalRow</*PBR=*/false>(const U32 y, const U32 x_begin, const U32 x_end, const U32 stride)
+{
+    // Points whose whole stencil lies inside this patch go through the row
+    // kernel; the rest need the neighbor lookups of calcNormal().
+    const U32 patch_width = mSurfacep->mPVArray.mPatchWidth;
+    const U32 surface_stride = mSurfacep->getGridsPerEdge();
+
+    U32 x = x_begin;
+    if (y >= stride && y + stride < patch_width)
+    {
+        const U32 inner_begin = llmax(x_begin, stride);
+        const U32 inner_end = llmin(x_end, patch_width - stride);
+        for (; x < inner_begin; x++)
+        {
+            calcNormal<false>(x, y, stride);
+        }
+        if (inner_begin < inner_end)
+        {
+            const U32 offset = surface_stride * y + inner_begin;
+            LLTerrainNormals::smoothNormalRow(mDataZ + offset, surface_stride, stride,
+                                              mSurfacep->getMetersPerGrid() * stride,
+                                              inner_end - inner_begin, mDataNorm + offset);
+            x = inner_end;
+        }
+    }
+    for (; x < x_end; x++)
+    {
+        calcNormal<false>(x, y, stride);
+    }
+}
+
+template<>
+void LLSurfacePatch::calcNormalRow</*PBR=*/true>(const U32 y, const U32 x_begin, const U32 x_end, const U32 stride)
+{
+    for (U32 x = x_begin; x < x_end; x++)
+    {
+        calcNormal<true>(x, y, stride);
+    }
+}
+
 // Calculate the flat normal of a triangle whose least coordinate is specified by the given x,y values.
 // If index = 0, calculate the normal of the first triangle, otherwise calculate the normal of the second.
 void LLSurfacePatch::calcNormalFlat(LLVector3& normal_out, const U32 x, const U32 y, const U32 index)
@@ -633,65 +724,24 @@ void LLSurfacePatch::updateNormals()
     U32 grids_per_patch_edge = mSurfacep->getGridsPerPatchEdge();
     U32 grids_per_edge = mSurfacep->getGridsPerEdge();
 
-    BOOL dirty_patch = FALSE;
-
-    U32 i, j;
-    // update the east edge
-    if (mNormalsInvalid[EAST] || mNormalsInvalid[NORTHEAST] || mNormalsInvalid[SOUTHEAST])
-    {
-        for (j = 0; j <= grids_per_patch_edge; j++)
-        {
-            calcNormal<PBR>(grids_per_patch_edge, j, 2);
-            calcNormal<PBR>(grids_per_patch_edge - 1, j, 2);
-            calcNormal<PBR>(grids_per_patch_edge - 2, j, 2);
-        }
-
-        dirty_patch = TRUE;
-    }
-
-    // update the north edge
-    if (mNormalsInvalid[NORTHEAST] || mNormalsInvalid[NORTH] || mNormalsInvalid[NORTHWEST])
-    {
-        for (i = 0; i <= grids_per_patch_edge; i++)
-        {
-            calcNormal<PBR>(i, grids_per_patch_edge, 2);
-            calcNormal<PBR>(i, grids_per_patch_edge - 1, 2);
-            calcNormal<PBR>(i, grids_per_patch_edge - 2, 2);
-        }
-
-        dirty_patch = TRUE;
-    }
+    U32 i;
 
-    // update the west edge
+    // Fix up the buffer heights that come from diagonal neighbors before
+    // recomputing any normals.
     if (mNormalsInvalid[NORTHWEST] || mNormalsInvalid[WEST] || mNormalsInvalid[SOUTHWEST])
     {
         if (!getNeighborPatch(NORTH) && getNeighborPatch(NORTHWEST) && getNeighborPatch(NORTHWEST)->getHasReceivedData())
         {
             *(mDataZ + grids_per_patch_edge*grids_per_edge) = *(getNeighborPatch(NORTHWEST)->mDataZ + grids_per_patch_edge);
         }
-
-        for (j = 0; j < grids_per_patch_edge; j++)
-        {
-            calcNormal<PBR>(0, j, 2);
-            calcNormal<PBR>(1, j, 2);
-        }
-        dirty_patch = TRUE;
     }
 
-    // update the south edge
     if (mNormalsInvalid[SOUTHWEST] || mNormalsInvalid[SOUTH] || mNormalsInvalid[SOUTHEAST])
     {
         if (!getNeighborPatch(EAST) && getNeighborPatch(SOUTHEAST) && getNeighborPatch(SOUTHEAST)->getHasReceivedData())
         {
             *(mDataZ + grids_per_patch_edge) = *(getNeighborPatch(SOUTHEAST)->mDataZ + grids_per_patch_edge * getNeighborPatch(SOUTHEAST)->getSurface()->getGridsPerEdge());
         }
-
-        for (i = 0; i < grids_per_patch_edge; i++)
-        {
-            calcNormal<PBR>(i, 0, 2);
-            calcNormal<PBR>(i, 1, 2);
-        }
-        dirty_patch = TRUE;
     }
 
     // Invalidating the northeast corner is different, because depending on what the adjacent neighbors are,
@@ -775,24 +825,41 @@ void LLSurfacePatch::updateNormals()
             // We've got a northeast patch in the same surface.
             // The z and normals will be handled by that patch.
         }
-        calcNormal<PBR>(grids_per_patch_edge, grids_per_patch_edge, 2);
-        calcNormal<PBR>(grids_per_patch_edge, grids_per_patch_edge - 1, 2);
-        calcNormal<PBR>(grids_per_patch_edge - 1, grids_per_patch_edge, 2);
-        calcNormal<PBR>(grids_per_patch_edge - 1, grids_per_patch_edge - 1, 2);
-        dirty_patch = TRUE;
     }
 
-    // update the middle normals
-    if (mNormalsInvalid[MIDDLE])
+    // Recompute only the normals within reach of whatever changed: a single
+    // neighbor edge touches two or three rows/columns, not whole bands.
+    U64 row_masks[LLTerrainNormals::MAX_PATCH_EDGE + 1];
+    llassert(grids_per_patch_edge <= LLTerrainNormals::MAX_PATCH_EDGE);
+    LLTerrainNormals::buildDirtyRows(mNormalsInvalid, grids_per_patch_edge, row_masks);
+
+    BOOL dirty_patch = FALSE;
+    for (U32 y = 0; y <= grids_per_patch_edge; y++)
     {
-        for (j=2; j < grids_per_patch_edge - 2; j++)
+        U64 mask = row_masks[y];
+        if (!mask)
+        {
+            continue;
+        }
+        dirty_patch = TRUE;
+
+        // walk the runs of set bits
+        U32 x = 0;
+        while (mask)
         {
-            for (i=2; i < grids_per_patch_edge - 2; i++)
+            while (!(mask & 1))
             {
-                calcNormal<PBR>(i, j, 2);
+                mask >>= 1;
+                x++;
             }
+            U32 run_begin = x;
+            while (mask & 1)
+            {
+                mask >>= 1;
+                x++;
+            }
+            calcNormalRow<PBR>(y, run_begin, x, 2);
         }
-        dirty_patch = TRUE;
     }
 
     if (dirty_patch)
@@ -30,6 +30,7 @@
 #include "v3math.h"
 #include "v3dmath.h"
 #include "llpointer.h"
+#include "llstrider.h"
 
 class LLSurface;
 class LLVOSurfacePatch;
@@ -110,6 +111,9 @@ class LLSurfacePatch
     // is a debug parameter for testing.
     template<bool PBR>
     void calcNormal(const U32 x, const U32 y, const U32 stride);
+    // calcNormal() for x_begin <= x < x_end along row y
+    template<bool PBR>
+    void calcNormalRow(const U32 y, const U32 x_begin, const U32 x_end, const U32 stride);
     const LLVector3 &getNormal(const U32 x, const U32 y) const;
 
     // Per-triangle normals for flat edges
@@ -117,6 +121,11 @@ class LLSurfacePatch
 
     void eval(const U32 x, const U32 y, const U32 stride,
                 LLVector3 *vertex, LLVector3 *normal, LLVector2 *tex0, LLVector2 *tex1);
+    // eval() for count points starting at (x, y), stride apart along the row.
+    // Advances the striders by count.
+    void evalRow(const U32 x, const U32 y, const U32 stride, const U32 count,
+                 LLStrider<LLVector3> &vertices, LLStrider<LLVector3> &normals,
+                 LLStrider<LLVector2> &tex0, LLStrider<LLVector2> &tex1);
 
 
 
@@ -0,0 +1,172 @@
+/**
+ * @file llterrainnormals.cpp
+ * @brief Row-oriented terrain normal generation used by LLSurfacePatch
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llterrainnormals.h"
+
+#include "llmath.h"
+#include "llsimdmath.h"
+
+namespace LLTerrainNormals
+{
+
+LLVector3 smoothNormal(F32 z00, F32 z01, F32 z10, F32 z11, F32 mpg)
+{
+    LLVector3 p00(-mpg,-mpg, z00);
+    LLVector3 p01(-mpg,+mpg, z01);
+    LLVector3 p10(+mpg,-mpg, z10);
+    LLVector3 p11(+mpg,+mpg, z11);
+
+    LLVector3 c1 = p11 - p00;
+    LLVector3 c2 = p01 - p10;
+
+    LLVector3 normal = c1;
+    normal %= c2;
+    normal.normVec();
+    return normal;
+}
+
+void smoothNormalRow(const F32 *z, S32 row_stride, S32 step, F32 mpg, U32 count, LLVector3 *normals)
+{
+    const F32 *south = z - step*row_stride;
+    const F32 *north = z + step*row_stride;
+
+    // The horizontal components of the two diagonals are the same for every
+    // point.  Compute them exactly as smoothNormal() does so that the vector
+    // path rounds identically.
+    const F32 c1x = mpg - (-mpg);
+    const F32 c1y = mpg - (-mpg);
+    const F32 c2x = -mpg - mpg;
+    const F32 c2y = mpg - (-mpg);
+    const F32 nz = c1x*c2y - c2x*c1y;
+
+    LLVector4a v_c1x, v_c1y, v_c2x, v_c2y, v_nz, v_threshold;
+    v_c1x.splat(c1x);
+    v_c1y.splat(c1y);
+    v_c2x.splat(c2x);
+    v_c2y.splat(c2y);
+    v_nz.splat(nz);
+    v_threshold.splat(FP_MAG_THRESHOLD);
+    const LLVector4a one(1.f);
+
+    U32 i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        LLVector4a z00, z01, z10, z11;
+        z00.loadua(south + i - step);
+        z10.loadua(south + i + step);
+        z01.loadua(north + i - step);
+        z11.loadua(north + i + step);
+
+        LLVector4a c1z, c2z;
+        c1z.setSub(z11, z00);
+        c2z.setSub(z01, z10);
+
+        // cross product, same operand order as LLVector3::operator%=
+        LLVector4a nx, ny, t;
+        nx.setMul(v_c1y, c2z);
+        t.setMul(v_c2y, c1z);
+        nx.sub(t);
+        ny.setMul(c1z, v_c2x);
+        t.setMul(c2z, v_c1x);
+        ny.sub(t);
+
+        // LLVector3::normVec(): sqrt of ((x*x + y*y) + z*z), then scale by 1/mag
+        LLVector4a mag, sq;
+        mag.setMul(nx, nx);
+        sq.setMul(ny, ny);
+        mag.add(sq);
+        sq.setMul(v_nz, v_nz);
+        mag.add(sq);
+        mag = _mm_sqrt_ps(mag);
+
+        const LLQuad valid = _mm_cmpgt_ps(mag, v_threshold);
+        LLVector4a oomag;
+        oomag.setDiv(one, mag);
+
+        LLVector4a out_z;
+        nx.mul(oomag);
+        ny.mul(oomag);
+        out_z.setMul(v_nz, oomag);
+
+        LL_ALIGN_16(F32 xs[4]);
+        LL_ALIGN_16(F32 ys[4]);
+        LL_ALIGN_16(F32 zs[4]);
+        _mm_store_ps(xs, _mm_and_ps(nx, valid));
+        _mm_store_ps(ys, _mm_and_ps(ny, valid));
+        _mm_store_ps(zs, _mm_and_ps(out_z, valid));
+
+        for (U32 k = 0; k < 4; k++)
+        {
+            normals[i + k].set(xs[k], ys[k], zs[k]);
+        }
+    }
+
+    for (; i < count; i++)
+    {
+        normals[i] = smoothNormal(south[i - step], north[i - step], south[i + step], north[i + step], mpg);
+    }
+}
+
+void buildDirtyRows(const BOOL invalid[9], U32 patch_edge, U64 *row_masks)
+{
+    llassert(patch_edge >= 4 && patch_edge <= MAX_PATCH_EDGE);
+
+    const U32 n = patch_edge;
+    for (U32 y = 0; y <= n; y++)
+    {
+        row_masks[y] = 0;
+    }
+
+    // Inclusive rectangle [x0, x1] x [y0, y1] of points marked dirty.
+    auto mark = [row_masks](U32 x0, U32 x1, U32 y0, U32 y1)
+    {
+        const U64 bits = ((~0ULL) >> (63 - (x1 - x0))) << x0;
+        for (U32 y = y0; y <= y1; y++)
+        {
+            row_masks[y] |= bits;
+        }
+    };
+
+    // Normals look two grids away, so a neighbor only affects the two rows
+    // or columns nearest to it plus the shared edge itself.
+    if (invalid[EAST])      mark(n - 2, n,     0,     n);
+    if (invalid[WEST])      mark(0,     1,     0,     n);
+    if (invalid[NORTH])     mark(0,     n,     n - 2, n);
+    if (invalid[SOUTH])     mark(0,     n,     0,     1);
+    if (invalid[NORTHEAST]) mark(n - 2, n,     n - 2, n);
+    if (invalid[NORTHWEST]) mark(0,     1,     n - 2, n);
+    if (invalid[SOUTHWEST]) mark(0,     1,     0,     1);
+    if (invalid[SOUTHEAST]) mark(n - 2, n,     0,     1);
+    if (invalid[MIDDLE])
+    {
+        // Own heights changed: every normal that reads them.
+        mark(0, n, 0, n);
+    }
+}
+
+} // namespace LLTerrainNormals
@@ -0,0 +1,59 @@
+/**
+ * @file llterrainnormals.h
+ * @brief Row-oriented terrain normal generation used by LLSurfacePatch
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTERRAINNORMALS_H
+#define LL_LLTERRAINNORMALS_H
+
+#include "v3math.h"
+
+// Height field normal kernels, kept free of LLSurface so that they can be
+// tested and timed on their own.
+namespace LLTerrainNormals
+{
+    // Largest patch edge (in grids) the dirty row masks can describe.
+    constexpr U32 MAX_PATCH_EDGE = 63;
+
+    // Smooth vertex normal from the heights at the four diagonal samples
+    // (x -/+ step, y -/+ step), mpg being meters per grid times step.  This
+    // is the arithmetic of LLSurfacePatch::calcNormal</*PBR=*/false>.
+    LLVector3 smoothNormal(F32 z00, F32 z01, F32 z10, F32 z11, F32 mpg);
+
+    // smoothNormal() for count consecutive points of one row, four at a time
+    // with SSE.  z points at the height of the first point and row_stride is
+    // the distance between rows; every sample must be addressable from z.
+    // Results are bit-identical to smoothNormal().
+    void smoothNormalRow(const F32 *z, S32 row_stride, S32 step, F32 mpg, U32 count, LLVector3 *normals);
+
+    // Which normals of a patch need recomputing, given LLSurfacePatch's
+    // per-direction invalid flags (EAST..SOUTHEAST, MIDDLE).  Sets bit x of
+    // row_masks[y] for each point (x, y), 0 <= x, y <= patch_edge, whose
+    // stencil (reach 2) touches an invalid neighbor or, for MIDDLE, the
+    // patch's own heights.  A change along one edge only marks the rows and
+    // columns within reach of that edge.
+    void buildDirtyRows(const BOOL invalid[9], U32 patch_edge, U64 *row_masks);
+}
+
+#endif // LL_LLTERRAINNORMALS_H
@@ -468,7 +468,8 @@ LLSD LLNewFileResourceUploadInfo::exportTempFile()
             char*        file_buffer = new char[file_size + 1];
             ELoadStatus  load_status = E_ST_OK;
             S32          line_number = 0;
-            LLBVHLoader* loaderp     = new LLBVHLoader(file_buffer, load_status, line_number, joint_aliases);
+            LLBVHLoader* loaderp     = new LLBVHLoader(file_buffer, load_status, line_number, joint_aliases,
+                                                       LLBVHLoader::poolParallelFor());
 
             if (load_status == E_ST_NO_XLT_FILE)
             {
@@ -68,7 +68,12 @@
 //-----------------------------------------------------------------------------
 LLViewerJointMesh::LLViewerJointMesh()
     :
-    LLAvatarJointMesh()
+    LLAvatarJointMesh(),
+    mLastVertexBuffer(NULL),
+    mLastMesh(NULL),
+    mLastVertexOffset(0),
+    mLastIndexOffset(0),
+    mLastMorphSerial(0)
 {
 }
 
@@ -370,6 +375,27 @@ void LLViewerJointMesh::updateFaceData(LLFace *face, F32 pixel_area, BOOL damp_w
     {
         const U32 num_verts = mMesh->getNumVertices();
 
+        // applies any morphs queued since the last update
+        const LLVector4a* coords = mMesh->getCoords();
+        const LLVector4a* normals = mMesh->getNormals();
+        const U32 morph_serial = mMesh->getMorphSerial();
+
+        if (terse_update &&
+            morph_serial == mLastMorphSerial &&
+            face->getVertexBuffer() == mLastVertexBuffer &&
+            mMesh == mLastMesh &&
+            mMesh->mFaceVertexOffset == mLastVertexOffset &&
+            mMesh->mFaceIndexOffset == mLastIndexOffset)
+        {
+            // nothing has moved since this mesh was last copied here
+            return;
+        }
+        mLastVertexBuffer = face->getVertexBuffer();
+        mLastMesh = mMesh;
+        mLastVertexOffset = mMesh->mFaceVertexOffset;
+        mLastIndexOffset = mMesh->mFaceIndexOffset;
+        mLastMorphSerial = morph_serial;
+
         if (num_verts)
         {
             face->getVertexBuffer()->getIndexStrider(indicesp);
@@ -383,8 +409,8 @@ void LLViewerJointMesh::updateFaceData(LLFace *face, F32 pixel_area, BOOL damp_w
 
             U32 words = num_verts*4;
 
-            LLVector4a::memcpyNonAliased16(v, (F32*) mMesh->getCoords(), words*sizeof(F32));
-            LLVector4a::memcpyNonAliased16(n, (F32*) mMesh->getNormals(), words*sizeof(F32));
+            LLVector4a::memcpyNonAliased16(v, (F32*) coords, words*sizeof(F32));
+            LLVector4a::memcpyNonAliased16(n, (F32*) normals, words*sizeof(F32));
 
 
             if (!terse_update)
@@ -35,6 +35,7 @@
 
 class LLDrawable;
 class LLFace;
+class LLVertexBuffer;
 class LLCharacter;
 class LLViewerTexLayerSet;
 
@@ -72,6 +73,15 @@ class LLViewerJointMesh final : public LLAvatarJointMesh, public LLViewerJoint
 
     //copy mesh into given face's vertex buffer, applying current animation pose
     static void updateGeometry(LLFace* face, LLPolyMesh* mesh);
+
+    // where the mesh was last copied to by updateFaceData() and the
+    // LLPolyMesh morph serial it had then, lets a terse update of a mesh
+    // no morph has moved since be skipped
+    LLVertexBuffer* mLastVertexBuffer;
+    LLPolyMesh*     mLastMesh;
+    U32             mLastVertexOffset;
+    U32             mLastIndexOffset;
+    U32             mLastMorphSerial;
 };
 
 #endif // LL_LLVIEWERJOINTMESH_H
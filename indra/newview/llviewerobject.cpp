@@ -261,6 +261,7 @@ LLViewerObject::LLViewerObject(const LLUUID &id, const LLPCode pcode, LLViewerRe
     mLocalID(0),
     mTotalCRC(0),
     mListIndex(-1),
+    mScoreIndex(-1),
     mTEImages(NULL),
     mTENormalMaps(NULL),
     mTESpecularMaps(NULL),
@@ -438,7 +439,7 @@ void LLViewerObject::markDead()
             if (av && LLVOAvatar::getRiggedMeshID(this,mesh_id))
             {
                 // This case is needed for indirectly attached mesh objects.
-                av->updateAttachmentOverrides();
+                av->requestAttachmentOverrideUpdate();
             }
         }
         if (getControlAvatar())
@@ -3951,6 +3952,15 @@ void LLViewerObject::setPixelAreaAndAngle(LLAgent &agent)
     }
 
     LLVector3 viewer_pos_agent = gAgentCamera.getCameraPositionAgent();
+
+    if (gObjectList.hasCurrentScore(this, viewer_pos_agent))
+    {   // scored this frame by LLViewerObjectList::updateApparentAngles
+        const LLObjectScores& scores = gObjectList.getScores();
+        mAppAngle = scores.getAppAngle(mScoreIndex);
+        mPixelArea = scores.getPixelArea(mScoreIndex);
+        return;
+    }
+
     LLVector3 pos_agent = getRenderPosition();
 
     F32 dx = viewer_pos_agent.mV[VX] - pos_agent.mV[VX];
@@ -6332,9 +6342,11 @@ BOOL LLViewerObject::isParticleSource() const
 
 void LLViewerObject::setParticleSource(const LLPartSysData& particle_parameters, const LLUUID& owner_id)
 {
+    const F32 old_cost = getParticleCost();
     if (mPartSourcep)
     {
-        deleteParticleSource();
+        mPartSourcep->setDead();
+        mPartSourcep = NULL;
     }
 
     LLPointer<LLViewerPartSourceScript> pss = LLViewerPartSourceScript::createPSS(this, particle_parameters);
@@ -6359,10 +6371,12 @@ void LLViewerObject::setParticleSource(const LLPartSysData& particle_parameters,
         }
     }
     LLViewerPartSim::getInstance()->addPartSource(pss);
+    particleSourceChanged(old_cost);
 }
 
 void LLViewerObject::unpackParticleSource(const S32 block_num, const LLUUID& owner_id)
 {
+    const F32 old_cost = getParticleCost();
     if (!mPartSourcep.isNull() && mPartSourcep->isDead())
     {
         mPartSourcep = NULL;
@@ -6407,10 +6421,12 @@ void LLViewerObject::unpackParticleSource(const S32 block_num, const LLUUID& own
             mPartSourcep->setImage(image);
         }
     }
+    particleSourceChanged(old_cost);
 }
 
 void LLViewerObject::unpackParticleSource(LLDataPacker &dp, const LLUUID& owner_id, bool legacy)
 {
+    const F32 old_cost = getParticleCost();
     if (!mPartSourcep.isNull() && mPartSourcep->isDead())
     {
         mPartSourcep = NULL;
@@ -6454,14 +6470,55 @@ void LLViewerObject::unpackParticleSource(LLDataPacker &dp, const LLUUID& owner_
             mPartSourcep->setImage(image);
         }
     }
+    particleSourceChanged(old_cost);
 }
 
 void LLViewerObject::deleteParticleSource()
 {
     if (mPartSourcep.notNull())
     {
+        const F32 old_cost = getParticleCost();
         mPartSourcep->setDead();
         mPartSourcep = NULL;
+        particleSourceChanged(old_cost);
+    }
+}
+
+F32 LLViewerObject::getParticleCost() const
+{
+    static const U32 ARC_PARTICLE_COST = 1; // determined experimentally
+    static const U32 ARC_PARTICLE_MAX = 2048; // default values
+
+    if (!isParticleSource())
+    {
+        return 0.f;
+    }
+    const LLPartSysData *part_sys_data = &(mPartSourcep->mPartSysData);
+    const LLPartData *part_data = &(part_sys_data->mPartData);
+    U32 num_particles = (U32)(part_sys_data->mBurstPartCount * llceil( part_data->mMaxAge / part_sys_data->mBurstRate));
+    num_particles = num_particles > ARC_PARTICLE_MAX ? ARC_PARTICLE_MAX : num_particles;
+    F32 part_size = (llmax(part_data->mStartScale[0], part_data->mEndScale[0]) + llmax(part_data->mStartScale[1], part_data->mEndScale[1])) / 2.f;
+    return num_particles * part_size * ARC_PARTICLE_COST;
+}
+
+void LLViewerObject::particleSourceChanged(F32 old_cost)
+{
+    if (getParticleCost() == old_cost)
+    {
+        return;
+    }
+    LLVOVolume* volume = asVolume();
+    if (volume)
+    {
+        volume->updateVisualComplexity();
+    }
+    else
+    {
+        LLVOAvatar* avatar = getAvatarAncestor();
+        if (avatar)
+        {
+            avatar->updateVisualComplexity(this);
+        }
     }
 }
 
@@ -155,6 +155,11 @@ class LLViewerObject
     BOOL isDead() const                                 {return mDead;}
     BOOL isOrphaned() const                             { return mOrphaned; }
     BOOL isParticleSource() const;
+    // Render cost of the particles this object emits, 0 if none.
+    F32 getParticleCost() const;
+    // Particles count towards the complexity of the avatar wearing this
+    // object; tell it when getParticleCost() is no longer old_cost.
+    void particleSourceChanged(F32 old_cost);
 
     virtual LLVOAvatar* asAvatar();
     virtual LLVOVolume* asVolume();
@@ -270,6 +275,8 @@ class LLViewerObject
     U32 getCRC() const                              { return mTotalCRC; }
     S32 getListIndex() const                        { return mListIndex; }
     void setListIndex(S32 idx)                      { mListIndex = idx; }
+    S32 getScoreIndex() const                       { return mScoreIndex; }
+    void setScoreIndex(S32 idx)                     { mScoreIndex = idx; }
 
     virtual BOOL isFlexible() const                 { return FALSE; }
     virtual BOOL isSculpted() const                 { return FALSE; }
@@ -770,6 +777,9 @@ class LLViewerObject
     // index into LLViewerObjectList::mActiveObjects or -1 if not in list
     S32             mListIndex;
 
+    // index into LLViewerObjectList's score table or -1 if not in it
+    S32             mScoreIndex;
+
     LLPointer<LLViewerTexture> *mTEImages;
     LLPointer<LLViewerTexture> *mTENormalMaps;
     LLPointer<LLViewerTexture> *mTESpecularMaps;
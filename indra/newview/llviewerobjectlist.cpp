@@ -50,6 +50,7 @@
 #include "llhudnametag.h"
 #include "lldrawable.h"
 #include "llflexibleobject.h"
+#include "llparallelcull.h"
 #include "llviewertextureanim.h"
 #include "xform.h"
 #include "llsky.h"
@@ -113,6 +114,7 @@ LLViewerObjectList::LLViewerObjectList()
     mWasPaused = FALSE;
     mNumDeadObjectUpdates = 0;
     mNumUnknownUpdates = 0;
+    mScoreFrame = 0;
 }
 
 LLViewerObjectList::~LLViewerObjectList()
@@ -829,6 +831,106 @@ void LLViewerObjectList::setAllObjectDefaultTextures(U32 nChannel, bool fShowDef
 }
 // [/SL:KB]
 
+void LLViewerObjectList::addScore(LLViewerObject* objectp)
+{
+    objectp->setScoreIndex((S32)mScores.add());
+    mScoreObjects.push_back(objectp);
+    updateScore(objectp);
+}
+
+void LLViewerObjectList::removeScore(LLViewerObject* objectp)
+{
+    S32 index = objectp->getScoreIndex();
+    if (index < 0)
+    {
+        return;
+    }
+
+    LLViewerObject* last = mScoreObjects.back();
+    mScores.removeSwap(index);
+    mScoreObjects[index] = last;
+    mScoreObjects.pop_back();
+    last->setScoreIndex(index);
+    objectp->setScoreIndex(-1);
+}
+
+void LLViewerObjectList::updateScore(LLViewerObject* objectp)
+{
+    S32 index = objectp->getScoreIndex();
+    if (index < 0 || objectp->isDead())
+    {
+        return;
+    }
+
+    U32 flags = objectp->isHUDAttachment() ? LLObjectScores::HUD : 0;
+    LLVector3 center;
+    F32 radius;
+
+    LLDrawable* drawable = objectp->mDrawable;
+    LLVOVolume* volume = drawable ? drawable->getVOVolume() : nullptr;
+    if (volume)
+    {   // position of LLDrawable::updateDistance, radius of LLVOVolume::calcLOD
+        if (drawable->getGroup())
+        {
+            center.set(drawable->getPositionGroup().getF32ptr());
+            flags |= SCORE_POSITION_GROUP;
+        }
+        else
+        {
+            center = drawable->getPositionAgent();
+        }
+        radius = volume->getVolume() ? volume->getVolume()->mLODScaleBias.scaledVec(volume->getScale()).length() : volume->getScale().length();
+    }
+    else
+    {   // position of LLViewerObject::setPixelAreaAndAngle
+        center = objectp->getRenderPosition();
+        radius = objectp->getMaxScale();
+    }
+
+    mScores.set(index, center, radius, objectp->getMaxScale(), objectp->getMidScale(), objectp->getMinScale(), flags);
+}
+
+void LLViewerObjectList::scoreObjects()
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    LLViewerCamera* camera = LLViewerCamera::getInstance();
+
+    LLObjectScores::Params params;
+    params.mEye = camera->getOrigin();
+    params.mPixelMeterRatio = camera->getPixelMeterRatio();
+    params.mScreenPixelArea = (F32)camera->getScreenPixelArea();
+    params.mDistanceFactor = LLVOVolume::sDistanceFactor;
+    params.mLODRampDistance = LLVOVolume::sLODFactor * 2;
+    params.mNearRadius = LLVOCacheEntry::sNearRadius;
+    params.mMaxDistance = gAgentCamera.mDrawDistance;
+
+    mScores.score(params);
+    mScoreFrame = LLFrameTimer::getFrameCount();
+}
+
+bool LLViewerObjectList::hasCurrentScore(const LLViewerObject* objectp, const LLVector3& eye) const
+{
+    S32 index = objectp->getScoreIndex();
+    if (index < 0 || mScoreFrame != LLFrameTimer::getFrameCount() || !mScores.isScored(index) || mScores.getEye() != eye)
+    {
+        return false;
+    }
+
+    // the drawable has moved in or out of a spatial group since its bounds were taken
+    const LLDrawable* drawable = objectp->mDrawable;
+    if (drawable && drawable->getVOVolume())
+    {
+        bool from_group = (mScores.getFlags(index) & SCORE_POSITION_GROUP) != 0;
+        if (from_group != (drawable->getGroup() != nullptr))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void LLViewerObjectList::updateApparentAngles(LLAgent &agent)
 {
     S32 i;
@@ -847,6 +949,19 @@ void LLViewerObjectList::updateApparentAngles(LLAgent &agent)
         max_value = llmin((S32) mObjects.size(), mCurLazyUpdateIndex + num_updates);
     }
 
+    // Refresh the bounds of the objects we are about to visit and of
+    // everything that moves, then score the whole table in one pass.
+    // Objects that are neither pick up changes through updateScore().
+    for (i = mCurLazyUpdateIndex; i < max_value; i++)
+    {
+        updateScore(mObjects[i]);
+    }
+    for (LLViewerObject* active : mActiveObjects)
+    {
+        updateScore(active);
+    }
+    scoreObjects();
+
     // Iterate through some of the objects and lazy update their texture priorities
     for (i = mCurLazyUpdateIndex; i < max_value; i++)
     {
@@ -1016,12 +1131,53 @@ void LLViewerObjectList::update(LLAgent &agent)
     }
     else
     {
+        // Animate avatars other than self in parallel: set them all up
+        // here, evaluate their motions and joints on the parallel cull pool,
+        // then finish each where the loop below would have updated it.
+        static std::vector<LLVOAvatar*> animated;
+        animated.clear();
+        static LLCachedControl<bool> parallel_animation(gSavedSettings, "AvatarParallelAnimation", true);
+        if (parallel_animation && LLParallelCull::isAvailable())
+        {
+            for (std::vector<LLViewerObject*>::iterator idle_iter = idle_list.begin();
+                idle_iter != idle_end; idle_iter++)
+            {
+                objectp = *idle_iter;
+                if (objectp->isAvatar())
+                {
+                    LLVOAvatar* avatarp = (LLVOAvatar*)objectp;
+                    if (avatarp->canAnimateInParallel() && avatarp->beginIdleUpdate(agent, frame_time))
+                    {
+                        animated.push_back(avatarp);
+                    }
+                }
+            }
+        }
+
+        if (!animated.empty())
+        {
+            LL_PROFILE_ZONE_NAMED_CATEGORY_AVATAR("animate avatars");
+            LLVOAvatar::sAnimatingInParallel = true;
+            LLParallelCull::run((U32)animated.size(), [](U32 i)
+                {
+                    animated[i]->animateCharacter();
+                });
+            LLVOAvatar::sAnimatingInParallel = false;
+        }
+
         for (std::vector<LLViewerObject*>::iterator idle_iter = idle_list.begin();
             idle_iter != idle_end; idle_iter++)
         {
             objectp = *idle_iter;
             llassert(objectp->isActive());
+            if (objectp->isAvatar() && ((LLVOAvatar*)objectp)->isIdleUpdatePending())
+            {
+                ((LLVOAvatar*)objectp)->finishIdleUpdate();
+            }
+            else
+            {
                 objectp->idleUpdate(agent, frame_time);
+            }
         }
 
         //update flexible objects
@@ -1504,6 +1660,12 @@ void LLViewerObjectList::killAllObjects()
     if(!mObjects.empty())
     {
         LL_WARNS() << "LLViewerObjectList::killAllObjects still has entries in mObjects: " << mObjects.size() << LL_ENDL;
+        for (LLViewerObject* objectp : mScoreObjects)
+        {
+            objectp->setScoreIndex(-1);
+        }
+        mScores.clear();
+        mScoreObjects.clear();
         mObjects.clear();
     }
 
@@ -1562,6 +1724,7 @@ void LLViewerObjectList::cleanDeadObjects(BOOL use_timer)
                 LL_WARNS() << "Attempt to delete object " << objectp->mID << " but object not in dead list" << LL_ENDL;
                 num_divergent++; // this is the number we are adrift in the count
             }
+            removeScore(objectp);
             LLPointer<LLViewerObject>::swap(*iter, *target);
             *target = nullptr;
             ++target;
@@ -1768,6 +1931,12 @@ void LLViewerObjectList::shiftObjects(const LLVector3 &offset)
 
     gPipeline.shiftObjects(offset);
 
+    // every position in the score table just moved
+    for (LLViewerObject* objectp : mScoreObjects)
+    {
+        updateScore(objectp);
+    }
+
     LLWorld::getInstance()->shiftRegions(offset);
 }
 
@@ -2039,6 +2208,7 @@ LLViewerObject *LLViewerObjectList::createObjectViewer(const LLPCode pcode, LLVi
     mUUIDObjectMap[fullid] = objectp;
 
     mObjects.push_back(objectp);
+    addScore(objectp);
 
     updateActive(objectp);
 
@@ -2068,6 +2238,7 @@ LLViewerObject *LLViewerObjectList::createObjectFromCache(const LLPCode pcode, L
                     regionp->getHost().getAddress(),
                     regionp->getHost().getPort());
     mObjects.push_back(objectp);
+    addScore(objectp);
 
     updateActive(objectp);
 
@@ -2110,6 +2281,7 @@ LLViewerObject *LLViewerObjectList::createObject(const LLPCode pcode, LLViewerRe
                     gMessageSystem->getSenderPort());
 
     mObjects.push_back(objectp);
+    addScore(objectp);
 
     updateActive(objectp);
 
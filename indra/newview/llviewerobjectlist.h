@@ -35,6 +35,7 @@
 #include "lltrace.h"
 
 // project includes
+#include "llobjectscores.h"
 #include "llviewerobject.h"
 #include "lleventcoro.h"
 #include "llcoros.h"
@@ -133,6 +134,19 @@ class LLViewerObjectList
     void removeFromActiveList(LLViewerObject* objectp);
     void updateActive(LLViewerObject *objectp);
 
+    // Score table flag: the center is the drawable's position group
+    static constexpr U32 SCORE_POSITION_GROUP = LLObjectScores::USER_FLAG_0;
+
+    // Distance, LOD, apparent angle and interest scores of every object,
+    // computed in one pass per frame by updateApparentAngles().
+    const LLObjectScores& getScores() const { return mScores; }
+    // Refresh objectp's bounds in the score table; its scores are out of
+    // date until the next pass.
+    void updateScore(LLViewerObject* objectp);
+    // True if objectp was scored this frame from eye and its bounds have
+    // not changed since.
+    bool hasCurrentScore(const LLViewerObject* objectp, const LLVector3& eye) const;
+
     void updateAvatarVisibility();
 
     inline S32 getNumObjects() { return (S32) mObjects.size(); }
@@ -206,6 +220,12 @@ class LLViewerObjectList
     vobj_list_t mObjects;
     std::vector<LLPointer<LLViewerObject> > mActiveObjects;
 
+    // score table entries and the object each belongs to, see
+    // LLViewerObject::mScoreIndex
+    LLObjectScores mScores;
+    std::vector<LLViewerObject*> mScoreObjects;
+    U32 mScoreFrame;
+
     vobj_list_t mMapObjects;
 
 
@@ -234,6 +254,10 @@ class LLViewerObjectList
     friend class LLViewerObject;
 
 private:
+    void addScore(LLViewerObject* objectp);
+    void removeScore(LLViewerObject* objectp);
+    void scoreObjects();
+
     static void reportObjectCostFailure(LLSD &objectList);
     void fetchObjectCostsCoro(std::string url, uuid_hash_set_t staleObjects);
 
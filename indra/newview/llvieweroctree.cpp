@@ -460,7 +460,8 @@ LLViewerOctreeGroup::~LLViewerOctreeGroup()
 LLViewerOctreeGroup::LLViewerOctreeGroup(OctreeNode* node)
 :   mOctreeNode(node),
     mAnyVisible(0),
-    mState(CLEAN)
+    mState(CLEAN),
+    mBVHSlot(-1)
 {
     LLVector4a tmp;
     tmp.splat(0.f);
@@ -1372,6 +1373,10 @@ void LLViewerOctreeCull::traverse(const OctreeNode* n)
 //agent space group culling
 S32 LLViewerOctreeCull::AABBInFrustumNoFarClipGroupBounds(const LLViewerOctreeGroup* group)
 {
+    if (mBVHResults && !mBVHFarClip && group->mBVHSlot >= 0)
+    {
+        return mBVHResults[group->mBVHSlot];
+    }
     return mCamera->AABBInFrustumNoFarClip(group->mBounds[0], group->mBounds[1]);
 }
 
@@ -1382,6 +1387,10 @@ S32 LLViewerOctreeCull::AABBSphereIntersectGroupExtents(const LLViewerOctreeGrou
 
 S32 LLViewerOctreeCull::AABBInFrustumGroupBounds(const LLViewerOctreeGroup* group)
 {
+    if (mBVHResults && mBVHFarClip && group->mBVHSlot >= 0)
+    {
+        return mBVHResults[group->mBVHSlot];
+    }
     return mCamera->AABBInFrustum(group->mBounds[0], group->mBounds[1]);
 }
 //------------------------------------------
@@ -250,6 +250,10 @@ class LLViewerOctreeGroup
     U32 getElementCount() const { return mOctreeNode->getElementCount(); }
     bool hasElement(LLViewerOctreeEntryData* data);
 
+    //slot of this node in its partition's flat BVH, -1 if none
+    S32  getBVHSlot() const        {return mBVHSlot;}
+    void setBVHSlot(S32 slot)      {mBVHSlot = slot;}
+
 protected:
     void checkStates();
 private:
@@ -266,6 +270,7 @@ class LLViewerOctreeGroup
 
     S32         mAnyVisible; //latest visible to any camera
     S32         mVisible[LLViewerCamera::NUM_CAMERAS];
+    S32         mBVHSlot;
 
 };//LL_ALIGN_POSTFIX(16);
 
@@ -370,10 +375,14 @@ class LLViewerOctreeCull : public OctreeTraveler
 {
 public:
     LLViewerOctreeCull(LLCamera* camera)
-        : mCamera(camera), mRes(0) { }
+        : mCamera(camera), mRes(0), mBVHResults(NULL), mBVHFarClip(false) { }
 
     virtual void traverse(const OctreeNode* n);
 
+    //answer agent space group bounds checks from a flat BVH frustum sweep (see LLFlatBVH::frustumCull)
+    //instead of testing each group's box, far_clip says which of the two checks the sweep matches
+    void setBVHResults(const U8* results, bool far_clip) { mBVHResults = results; mBVHFarClip = far_clip; }
+
 protected:
     virtual bool earlyFail(LLViewerOctreeGroup* group);
 
@@ -409,6 +418,8 @@ class LLViewerOctreeCull : public OctreeTraveler
 protected:
     LLCamera *mCamera;
     S32 mRes;
+    const U8* mBVHResults;
+    bool mBVHFarClip;
 };
 
 //scan the octree, output the info of each node for debug use.
@@ -194,7 +194,13 @@ void LLViewerPartSourceScript::update(const F32 dt)
     if (mPartSysData.mMaxAge && ((mPartSysData.mStartAge + mLastUpdateTime + dt_update) > mPartSysData.mMaxAge))
     {
         // Kill particle source because it has outlived its max age...
+        LLPointer<LLViewerObject> source_objp = mSourceObjectp;
+        const F32 old_cost = source_objp.notNull() ? source_objp->getParticleCost() : 0.f;
         setDead();
+        if (source_objp.notNull())
+        {
+            source_objp->particleSourceChanged(old_cost);
+        }
         return;
     }
 
@@ -62,6 +62,7 @@
 #include "llstartup.h"
 #include "lltrans.h"
 #include "llurldispatcher.h"
+#include "llobjectscores.h"
 #include "llviewerobjectlist.h"
 #include "llviewerparceloverlay.h"
 #include "llviewerstatsrecorder.h"
@@ -1479,6 +1480,15 @@ void LLViewerRegion::updateVisibleEntries(F32 max_time)
     F32 projection_threshold = LLVOCacheEntry::getSquaredPixelThreshold(mImpl->mVOCachePartition->isFrontCull());
     F32 dist_threshold = mImpl->mVOCachePartition->isFrontCull() ? gAgentCamera.mDrawDistance : LLVOCacheEntry::sRearFarRadius;
 
+    // root entries of the visible groups, and the ones among them whose
+    // scene contribution is stale, scored below in one pass
+    static std::vector<LLVOCacheEntry*> entries;
+    static std::vector<LLVOCacheEntry*> scored_entries;
+    static LLObjectScores scores;
+    entries.clear();
+    scored_entries.clear();
+    scores.clear();
+
     std::set< LLPointer<LLViewerOctreeGroup> >::iterator group_iter = mImpl->mVisibleGroups.begin(), group_end = mImpl->mVisibleGroups.end();
     for(; group_iter != group_end; ++group_iter)
     {
@@ -1505,15 +1515,37 @@ void LLViewerRegion::updateVisibleEntries(F32 max_time)
                     continue; //skip invalid entry.
                 }
 
-                vo_entry->calcSceneContribution(local_origin, needs_update, last_update, dist_threshold);
-                if(vo_entry->getSceneContribution() > projection_threshold)
+                entries.push_back(vo_entry);
+                if(needs_update || vo_entry->getVisible() < last_update)
                 {
-                    mImpl->mWaitingList.insert(vo_entry);
+                    U32 index = scores.add();
+                    scores.set(index, LLVector3(vo_entry->getPositionGroup().getF32ptr()), vo_entry->getBinRadius(), 0.f, 0.f, 0.f, 0);
+                    scored_entries.push_back(vo_entry);
                 }
             }
         }
     }
 
+    LLObjectScores::Params params;
+    params.mEye.set(local_origin.getF32ptr());
+    params.mNearRadius = LLVOCacheEntry::sNearRadius;
+    params.mMaxDistance = dist_threshold;
+    scores.score(params);
+
+    for (U32 i = 0; i < scored_entries.size(); i++)
+    {
+        scored_entries[i]->setSceneContribution(scores.getInterest(i));
+        scored_entries[i]->setVisible();
+    }
+
+    for (LLVOCacheEntry* vo_entry : entries)
+    {
+        if(vo_entry->getSceneContribution() > projection_threshold)
+        {
+            mImpl->mWaitingList.insert(vo_entry);
+        }
+    }
+
     if(needs_update)
     {
         mImpl->mLastCameraOrigin = camera_origin;
@@ -139,7 +139,9 @@ LLTrace::CountStatHandle<>  FPS("FPS", "Frames rendered"),
                             FRAMETIME_DOUBLED("frametimedoubled", "Ratio of frames 2x longer than previous"),
                             TEX_BAKES("texbakes", "Number of times avatar textures have been baked"),
                             TEX_REBAKES("texrebakes", "Number of times avatar textures have been forced to rebake"),
-                            NUM_NEW_OBJECTS("numnewobjectsstat", "Number of objects in scene that were not previously in cache");
+                            NUM_NEW_OBJECTS("numnewobjectsstat", "Number of objects in scene that were not previously in cache"),
+                            DRAW_INFO_REBUILDS("drawinforebuilds", "Number of volume face lists sorted into new draw batches"),
+                            DRAW_INFO_PATCHES("drawinfopatches", "Number of volume face lists whose draw batches were patched in place");
 
 LLTrace::CountStatHandle<LLUnit<F64, LLUnits::Kilotriangles> >
                             TRIANGLES_DRAWN("trianglesdrawnstat");
@@ -203,7 +205,8 @@ LLTrace::SampleStatHandle<LLUnit<F32, LLUnits::Percent> >
 static LLTrace::SampleStatHandle<bool>
                             CHAT_BUBBLES("chatbubbles", "Chat Bubbles Enabled");
 
-LLTrace::SampleStatHandle<F64Megabytes > FORMATTED_MEM("formattedmemstat");
+LLTrace::SampleStatHandle<F64Megabytes > FORMATTED_MEM("formattedmemstat"),
+                                        OCTREE_MEM("octreememstat", "Memory used by volume face picking octrees");
 LLTrace::SampleStatHandle<F64Kilobytes >    DELTA_BANDWIDTH("deltabandwidth", "Increase/Decrease in bandwidth based on packet loss"),
                                                             MAX_BANDWIDTH("maxbandwidth", "Max bandwidth setting");
 
@@ -252,6 +255,8 @@ LLTrace::EventStatHandle<F64Seconds >   AVATAR_EDIT_TIME("avataredittime", "Seco
 
 LLTrace::EventStatHandle<LLUnit<F32, LLUnits::Percent> > OBJECT_CACHE_HIT_RATE("object_cache_hits");
 
+LLTrace::EventStatHandle<>   GEOMETRY_REBUILD_RATE("geometry_rebuild_rate", "Faces per millisecond of volume geometry generation");
+
 LLTrace::EventStatHandle<F64Seconds >   TEXTURE_FETCH_TIME("texture_fetch_time");
 
 LLTrace::SampleStatHandle<LLUnit<F32, LLUnits::Percent> >  SCENERY_FRAME_PCT("scenery_frame_pct");
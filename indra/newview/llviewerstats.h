@@ -138,7 +138,9 @@ extern LLTrace::CountStatHandle<>           FPS,
                                             FRAMETIME_DOUBLED,
                                             TEX_BAKES,
                                             TEX_REBAKES,
-                                            NUM_NEW_OBJECTS;
+                                            NUM_NEW_OBJECTS,
+                                            DRAW_INFO_REBUILDS,
+                                            DRAW_INFO_PATCHES;
 
 extern LLTrace::CountStatHandle<LLUnit<F64, LLUnits::Kilotriangles> > TRIANGLES_DRAWN;
 
@@ -192,7 +194,8 @@ extern LLTrace::SampleStatHandle<>      FPS_SAMPLE,
 
 extern LLTrace::SampleStatHandle<LLUnit<F32, LLUnits::Percent> > PACKETS_LOST_PERCENT;
 
-extern LLTrace::SampleStatHandle<F64Megabytes > FORMATTED_MEM;
+extern LLTrace::SampleStatHandle<F64Megabytes > FORMATTED_MEM,
+                                                OCTREE_MEM;
 
 extern LLTrace::SampleStatHandle<F64Kilobytes > DELTA_BANDWIDTH,
                                                                     MAX_BANDWIDTH;
@@ -240,6 +243,8 @@ extern LLTrace::EventStatHandle<F64Seconds >    AVATAR_EDIT_TIME,
 
 extern LLTrace::EventStatHandle<LLUnit<F32, LLUnits::Percent> > OBJECT_CACHE_HIT_RATE;
 
+extern LLTrace::EventStatHandle<>   GEOMETRY_REBUILD_RATE;
+
 }
 
 class LLViewerStats final : public LLSingleton<LLViewerStats>
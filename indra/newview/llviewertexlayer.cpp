@@ -36,6 +36,7 @@
 #include "llvoavatarself.h"
 #include "pipeline.h"
 #include "llviewercontrol.h"
+#include "lltexlayercompositor.h"
 
 // runway consolidate
 extern std::string self_av_string();
@@ -164,6 +165,12 @@ void LLViewerTexLayerSetBuffer::midRenderTexLayerSet(BOOL success)
     if (update_now)
     {
         doUpdate();
+
+        static LLCachedControl<bool> composite_cpu(gSavedSettings, "DebugAvatarCompositeCPU", false);
+        if (composite_cpu && success)
+        {
+            compareCompositeCPU();
+        }
     }
 
     // *TODO: Old logic does not check success before setGLTextureCreated
@@ -171,6 +178,62 @@ void LLViewerTexLayerSetBuffer::midRenderTexLayerSet(BOOL success)
     mGLTexturep->setGLTextureCreated(true);
 }
 
+// Composite the layer set that was just drawn again with
+// LLTexLayerCompositor, off the main thread, and log how far that is from
+// the GL bake. Local textures are read from their saved raw images; the
+// ones that have none are asked to keep one, and the layer set is compared
+// on a later update.
+void LLViewerTexLayerSetBuffer::compareCompositeCPU()
+{
+    LL_PROFILE_ZONE_SCOPED;
+    LLViewerTexLayerSet* layer_set = getViewerTexLayerSet();
+    const S32 width = getCompositeWidth();
+    const S32 height = getCompositeHeight();
+
+    auto source = [](LLGLTexture* tex) -> LLPointer<LLImageRaw>
+    {
+        LLViewerFetchedTexture* fetched = LLViewerTextureManager::staticCastToFetchedTexture(tex);
+        if (!fetched)
+        {
+            return NULL;
+        }
+        fetched->forceToSaveRawImage(0, 60.f);
+        return fetched->hasSavedRawImage() ? fetched->getSavedRawImage() : NULL;
+    };
+    std::shared_ptr<LLTexLayerCompositor> compositor = std::make_shared<LLTexLayerCompositor>(width, height);
+    if (!layer_set->buildComposite(*compositor, source))
+    {
+        LL_DEBUGS("Avatar") << "CPU composite of " << layer_set->getBodyRegionName()
+                            << " waits for local texture pixels" << LL_ENDL;
+        return;
+    }
+
+    // the GL bake is still in the bound target
+    LLPointer<LLImageRaw> gl_image = new LLImageRaw(width, height, 4);
+    glReadPixels(getCompositeOriginX(), getCompositeOriginY(), width, height,
+                 GL_RGBA, GL_UNSIGNED_BYTE, gl_image->getData());
+
+    const std::string region = layer_set->getBodyRegionName();
+    LLTimer timer;
+    LLTexLayerCompositor::compositeAsync(compositor,
+        [gl_image, region, timer](const LLTexLayerCompositor::Result& result)
+        {
+            S32 max_diff = 0;
+            F32 mean_diff = 0.f;
+            if (LLTexLayerCompositor::difference(gl_image, result.mImage, max_diff, mean_diff))
+            {
+                LL_INFOS("Avatar") << "CPU composite of " << region << " done "
+                                   << timer.getElapsedTimeF32() * 1000.f << " ms after the GL bake"
+                                   << ", differs from it by at most " << max_diff
+                                   << ", " << mean_diff << " on average" << LL_ENDL;
+            }
+            else
+            {
+                LL_WARNS("Avatar") << "CPU composite of " << region << " is not the size of the GL bake" << LL_ENDL;
+            }
+        });
+}
+
 BOOL LLViewerTexLayerSetBuffer::isInitialized(void) const
 {
     return mGLTexturep.notNull() && mGLTexturep->isGLTextureCreated();
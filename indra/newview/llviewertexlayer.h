@@ -97,6 +97,7 @@ class LLViewerTexLayerSetBuffer final : public LLTexLayerSetBuffer, public LLVie
     void            preRenderTexLayerSet() override;
     void            midRenderTexLayerSet(BOOL success) override;
     void            postRenderTexLayerSet(BOOL success) override;
+    void            compareCompositeCPU();
     S32             getCompositeOriginX() const override { return getOriginX(); }
     S32             getCompositeOriginY() const override { return getOriginY(); }
     S32             getCompositeWidth() const override { return getFullWidth(); }
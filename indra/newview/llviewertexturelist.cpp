@@ -41,6 +41,7 @@
 
 #include "llsdserialize.h"
 #include "llsys.h"
+#include "llvolume.h"
 #include "llxmltree.h"
 #include "message.h"
 
@@ -824,6 +825,7 @@ void LLViewerTextureList::updateImages(F32 max_time)
         sample(NUM_IMAGES, sNumImages);
         sample(NUM_RAW_IMAGES, LLImageRaw::sRawImageCount);
         sample(FORMATTED_MEM, F64Bytes(LLImageFormatted::sGlobalFormattedMemory));
+        sample(OCTREE_MEM, F64Bytes(LLVolumeFace::getOctreeMemory()));
     }
 
     // make sure each call below gets at least its "fair share" of time
@@ -142,6 +142,7 @@
 #include "llnavigationbar.h"
 #include "llnotificationhandler.h"
 #include "llpaneltopinfobar.h"
+#include "llperfstats.h"
 #include "llpopupview.h"
 #include "llpreviewtexture.h"
 #include "llprogressview.h"
@@ -781,6 +782,20 @@ class LLDebugText
 
             ypos += y_inc;
 
+            const LLPerfStats::AnimationLODStats& anim_stats = LLPerfStats::getAnimationLODStats();
+            addText(xpos, ypos, llformat("%d/%d/%d/%d Avatars animated full/reduced/low/impostor (%d/%d/%d/%d evaluated)",
+                anim_stats.avatars[0], anim_stats.avatars[1], anim_stats.avatars[2], anim_stats.avatars[3],
+                anim_stats.evaluated[0], anim_stats.evaluated[1], anim_stats.evaluated[2], anim_stats.evaluated[3]));
+            ypos += y_inc;
+
+            addText(xpos, ypos, llformat("%.3f/%.3f ms Animation evaluated/saved by LOD", anim_stats.evaluateMs, anim_stats.savedMs));
+            ypos += y_inc;
+
+            const LLPerfStats::ComplexityStats& complexity_stats = LLPerfStats::getComplexityStats();
+            addText(xpos, ypos, llformat("%d/%d/%d Avatar complexity updates/linksets computed/cached per second",
+                complexity_stats.avatarsPerSecond, complexity_stats.linksetsPerSecond, complexity_stats.linksetsCachedPerSecond));
+            ypos += y_inc;
+
             addText(xpos,ypos, llformat("%d Lights visible", LLPipeline::sVisibleLightCount));
 
             ypos += y_inc;
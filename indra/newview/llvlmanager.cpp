@@ -35,6 +35,8 @@
 #include "llframetimer.h"
 #include "llsurface.h"
 #include "llbitpack.h"
+#include "llworld.h"
+#include "workqueue.h"
 
 const   char    LAND_LAYER_CODE                 = 'L';
 const   char    WATER_LAYER_CODE                = 'W';
@@ -48,6 +50,50 @@ const   char    AURORA_CLOUD_LAYER_CODE         = ':';
 
 LLVLManager gVLManager;
 
+namespace
+{
+    // Decode a land layer on the "General" thread pool and apply the heights
+    // to the region's surface back on the main loop.  Returns false if the
+    // queues are not available (early startup or shutdown) so that the caller
+    // can decode inline instead.
+    bool post_land_layer(LLVLData *datap, BOOL b_large_patch)
+    {
+        LL::WorkQueue::ptr_t main_queue = LL::WorkQueue::getInstance("mainloop");
+        LL::WorkQueue::ptr_t general_queue = LL::WorkQueue::getInstance("General");
+        if (!main_queue || !general_queue)
+        {
+            return false;
+        }
+
+        // The region may go away before the work completes, so look it up
+        // again by handle rather than holding on to the pointer.
+        const U64 region_handle = datap->mRegionp->getHandle();
+        const S32 patches_per_edge = datap->mRegionp->getLand().getPatchesPerEdge();
+        const U64 sequence = LLSurface::nextLayerSequence();
+        std::vector<U8> data(datap->mData, datap->mData + datap->mSize);
+
+        return main_queue->postTo(
+            general_queue,
+            [data = std::move(data), b_large_patch, patches_per_edge]() mutable // Work done on general queue
+            {
+                LLSurface::DecodedLayer layer;
+                LLBitPack bit_pack(data.data(), (U32)data.size());
+                LLGroupHeader goph;
+                decode_patch_group_header(bit_pack, &goph);
+                LLSurface::decodeDCTPatches(bit_pack, goph, b_large_patch, patches_per_edge, layer);
+                return layer;
+            },
+            [region_handle, sequence](const LLSurface::DecodedLayer &layer) // Callback to main thread
+            {
+                LLViewerRegion *regionp = LLWorld::getInstance()->getRegionFromHandle(region_handle);
+                if (regionp)
+                {
+                    regionp->getLand().applyDecodedPatches(layer, sequence);
+                }
+            });
+    }
+}
+
 LLVLManager::~LLVLManager()
 {
     S32 i;
@@ -93,6 +139,12 @@ void LLVLManager::unpackData(const S32 num_packets)
     {
         LLVLData *datap = mPacketData[i];
 
+        if ((LAND_LAYER_CODE == datap->mType || AURORA_LAND_LAYER_CODE == datap->mType)
+            && post_land_layer(datap, AURORA_LAND_LAYER_CODE == datap->mType))
+        {
+            continue;
+        }
+
         LLBitPack bit_pack(datap->mData, datap->mSize);
         LLGroupHeader goph;
 
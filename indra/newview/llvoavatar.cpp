@@ -31,6 +31,7 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <sstream>
+#include <mutex>
 
 #include "llaudioengine.h"
 #include "noise.h"
@@ -608,6 +609,11 @@ bool LLVOAvatar::sLimitNonImpostors = false; // True unless RenderAvatarMaxNonIm
 F32 LLVOAvatar::sRenderDistance = 256.f;
 S32 LLVOAvatar::sNumVisibleAvatars = 0;
 S32 LLVOAvatar::sNumLODChangesThisFrame = 0;
+bool LLVOAvatar::sAnimatingInParallel = false;
+
+// resolveStepHeightGlobal() walks shared world state, avatars animating in
+// parallel take turns at it
+static std::mutex sGroundMutex;
 
 const LLUUID LLVOAvatar::sStepSoundOnLand("e8af4a28-aa83-4310-a7c4-c047e15ea0df");
 const LLUUID LLVOAvatar::sStepSounds[LL_MCODE_END] =
@@ -858,6 +864,17 @@ LLVOAvatar::~LLVOAvatar()
 
     logPendingPhases();
 
+    if (mAttachmentOverrideUpdatesAvoided)
+    {
+        LL_DEBUGS("Avatar") << avString() << "attachment overrides updated " << mAttachmentOverrideUpdates
+                            << " times, " << mAttachmentOverrideUpdatesAvoided << " updates coalesced" << LL_ENDL;
+        if (isSelf())
+        {
+            LL_INFOS("Avatar") << "Attachment overrides updated " << mAttachmentOverrideUpdates << " times, "
+                               << mAttachmentOverrideUpdatesAvoided << " full updates avoided" << LL_ENDL;
+        }
+    }
+
     LL_DEBUGS("Avatar") << "LLVOAvatar Destructor (0x" << this << ") id:" << mID << LL_ENDL;
 
     std::for_each(mAttachmentPoints.begin(), mAttachmentPoints.end(), DeletePairedPointer());
@@ -2557,11 +2574,71 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
 
+    if (!idleUpdateBeforeCharacter(agent, time))
+    {
+        return;
+    }
+
+    // animate the character
+    BOOL detailed_update = updateCharacter(agent);
+
+    idleUpdateAfterCharacter(detailed_update);
+}
+
+//virtual
+bool LLVOAvatar::canAnimateInParallel() const
+{
+    // Self must see its animations play reliably (see updateCharacter()),
+    // and UI avatars belong to their floaters.
+    return !isSelf() && !isUIAvatar();
+}
+
+bool LLVOAvatar::beginIdleUpdate(LLAgent &agent, const F64 &time)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    mIdleUpdatePending = true;
+    mCharacterUpdatePending = false;
+    mIdleUpdateContinues = idleUpdateBeforeCharacter(agent, time);
+    return mIdleUpdateContinues && beginCharacterUpdate(agent);
+}
+
+void LLVOAvatar::finishIdleUpdate()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    if (!mIdleUpdatePending)
+    {
+        return;
+    }
+    mIdleUpdatePending = false;
+
     if (isDead())
     {
-        LL_INFOS() << "Warning!  Idle on dead avatar" << LL_ENDL;
+        // killed since beginIdleUpdate() by another object's idleUpdate()
+        mCharacterUpdatePending = false;
         return;
     }
+
+    if (mIdleUpdateContinues)
+    {
+        bool detailed_update = mCharacterUpdatePending && finishCharacterUpdate();
+        idleUpdateAfterCharacter(detailed_update);
+    }
+}
+
+bool LLVOAvatar::idleUpdateBeforeCharacter(LLAgent &agent, const F64 &time)
+{
+    if (isDead())
+    {
+        LL_INFOS() << "Warning!  Idle on dead avatar" << LL_ENDL;
+        return false;
+    }
+
+    // apply this frame's attachment changes in one pass
+    if (mAttachmentOverrideRequests)
+    {
+        updateAttachmentOverrides();
+    }
+
     // record time and refresh "tooSlow" status
     updateTooSlow();
 
@@ -2573,7 +2650,7 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
         {
             idleUpdateNameTag(idleCalcNameTagPosition(mLastRootPos));
         }
-        return;
+        return false;
     }
 
     // Update should be happening max once per frame.
@@ -2665,11 +2742,13 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
     // attach objects that were waiting for a drawable
     lazyAttach();
 
-    // animate the character
     // store off last frame's root position to be consistent with camera position
     mLastRootPos = mRoot->getWorldPosition();
-    BOOL detailed_update = updateCharacter(agent);
+    return true;
+}
 
+void LLVOAvatar::idleUpdateAfterCharacter(bool detailed_update)
+{
     static LLUICachedControl<bool> visualizers_in_calls("ShowVoiceVisualizersInCalls", false);
     bool voice_enabled = (visualizers_in_calls || LLVoiceClient::getInstance()->inProximalChannel()) &&
                          LLVoiceClient::getInstance()->getVoiceEnabled(mID);
@@ -4567,41 +4646,72 @@ void LLVOAvatar::updateOrientation(LLAgent& agent, F32 speed, F32 delta_time)
 }
 
 //------------------------------------------------------------------------
-// updateTimeStep()
-// Factored out from updateCharacter().
+// updateAnimationLOD()
 //
-// Updates the time step used by the motion controller, based on area
-// and avatar count criteria.  This will also stop the
-// ANIM_AGENT_WALK_ADJUST animation under some circumstances.
+// Picks the animation level of detail from the avatar's size on screen,
+// with some hysteresis at each cutoff. Smaller avatars are evaluated at
+// reduced rates, staggered across avatars, and interpolated in between;
+// the smallest and impostors also skip additive motions and animation
+// constraints.
 // ------------------------------------------------------------------------
-void LLVOAvatar::updateTimeStep()
+void LLVOAvatar::updateAnimationLOD()
 {
-    if (!isSelf() && !isUIAvatar()) // ie, non-self avatars, and animated objects will be affected.
+    static LLCachedControl<bool> animation_lod(gSavedSettings, "AvatarAnimationLOD", true);
+    static LLCachedControl<F32> reduced_area(gSavedSettings, "AvatarAnimationLODReducedArea", 6000.f);
+    static LLCachedControl<F32> reduced_rate(gSavedSettings, "AvatarAnimationLODReducedRate", 20.f);
+    static LLCachedControl<F32> low_area(gSavedSettings, "AvatarAnimationLODLowArea", 1500.f);
+    static LLCachedControl<F32> low_rate(gSavedSettings, "AvatarAnimationLODLowRate", 10.f);
+
+    // An avatar must grow this much past a cutoff to get back the finer
+    // LOD, so one hovering at a cutoff doesn't switch rates every frame.
+    const F32 LOD_HYSTERESIS = 1.25f;
+
+    const LLMotionController::EAnimationLOD prev_lod = mMotionController.getAnimationLOD();
+    LLMotionController::EAnimationLOD lod = LLMotionController::ANIMATION_LOD_FULL;
+    F32 time_step = 0.f;
+    // ie, non-self avatars and animated objects, unless previewing or playing backwards
+    if (animation_lod && !isSelf() && !isUIAvatar() && mSpecialRenderMode == 0
+        && mMotionController.getTimeFactor() > 0.f)
     {
-        // Note that sInstances counts animated objects and
-        // standard avatars in the same bucket. Is this desirable?
-        F32 time_quantum = clamp_rescale((F32)sInstances.size(), 10.f, 35.f, 0.f, 0.25f);
-        F32 pixel_area_scale = clamp_rescale(mPixelArea, 100, 5000, 1.f, 0.f);
-        F32 time_step = time_quantum * pixel_area_scale;
-        // Extrema:
-        //   If number of avs is 10 or less, time_step is unmodified (flagged with 0.0).
-        //   If area of av is 5000 or greater, time_step is unmodified (flagged with 0.0).
-        //   If number of avs is 35 or greater, and area of av is 100 or less,
-        //   time_step takes the maximum possible value of 0.25.
-        //   Other situations will give values within the (0, 0.25) range.
-        if (time_step != 0.f)
+        F32 low_cutoff = low_area;
+        F32 reduced_cutoff = reduced_area;
+        if (prev_lod >= LLMotionController::ANIMATION_LOD_LOW)
+        {
+            low_cutoff *= LOD_HYSTERESIS;
+        }
+        if (prev_lod >= LLMotionController::ANIMATION_LOD_REDUCED)
+        {
+            reduced_cutoff *= LOD_HYSTERESIS;
+        }
+
+        if (isImpostor())
+        {
+            // already evaluated only as often as the impostor is refreshed
+            lod = LLMotionController::ANIMATION_LOD_IMPOSTOR;
+        }
+        else if (mPixelArea < low_cutoff)
         {
-            // disable walk motion servo controller as it doesn't work with motion timesteps
-            stopMotion(ANIM_AGENT_WALK_ADJUST);
-            removeAnimationData("Walk Speed");
+            lod = LLMotionController::ANIMATION_LOD_LOW;
+            time_step = 1.f / llmax((F32)low_rate, 1.f);
+        }
+        else if (mPixelArea < reduced_cutoff)
+        {
+            lod = LLMotionController::ANIMATION_LOD_REDUCED;
+            time_step = 1.f / llmax((F32)reduced_rate, 1.f);
         }
-        // See SL-763 - playback with altered time step does not
-        // appear to work correctly, odd behavior for distant avatars.
-        // As of 11-2017, LLMotionController::updateMotions() will
-        // ignore the value here. Need to re-enable if it's every
-        // fixed.
-        mMotionController.setTimeStep(time_step);
     }
+
+    if (time_step != 0.f)
+    {
+        // disable walk motion servo controller as it doesn't work with motion timesteps
+        stopMotion(ANIM_AGENT_WALK_ADJUST);
+        removeAnimationData("Walk Speed");
+    }
+
+    // spread the steps the way computeNeedsUpdate() spreads impostor updates
+    F32 phase = time_step * (F32)mID.mData[0] / 256.f;
+    mMotionController.setAnimationLOD(lod);
+    mMotionController.setTimeStep(time_step, phase);
 }
 
 void LLVOAvatar::updateRootPositionAndRotation(LLAgent& agent, F32 speed, bool was_sit_ground_constrained)
@@ -4804,11 +4914,29 @@ bool LLVOAvatar::computeNeedsUpdate()
 //------------------------------------------------------------------------
 bool LLVOAvatar::updateCharacter(LLAgent &agent)
 {
+    if (!beginCharacterUpdate(agent))
+    {
+        return FALSE;
+    }
+    animateCharacter();
+    return finishCharacterUpdate();
+}
+
+//------------------------------------------------------------------------
+// beginCharacterUpdate()
+// Everything updateCharacter() does on the main thread before motions
+// are evaluated. Returns false if there is nothing to animate.
+//------------------------------------------------------------------------
+bool LLVOAvatar::beginCharacterUpdate(LLAgent &agent)
+{
+    mCharacterUpdatePending = false;
+    mMotionsPending = false;
+
     updateDebugText();
 
     if (!mIsBuilt)
     {
-        return FALSE;
+        return false;
     }
 
     BOOL visible = isVisible();
@@ -4850,7 +4978,7 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     if (!needs_update && !isSelf())
     {
         updateMotions(LLCharacter::HIDDEN_UPDATE);
-        return FALSE;
+        return false;
     }
 
     //--------------------------------------------------------------------
@@ -4860,10 +4988,9 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     updateOverallAppearance();
 
     //--------------------------------------------------------------------
-    // change animation time quanta based on avatar render load
+    // change animation rate and detail based on avatar size on screen
     //--------------------------------------------------------------------
-    // SL-763 the time step quantization does not currently work.
-    //updateTimeStep();
+    updateAnimationLOD();
 
     //--------------------------------------------------------------------
     // Update sitting state based on parent and active animation info.
@@ -4909,20 +5036,83 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     // update animations
     if (!visible && !isSelf()) // NOTE: never do a "hidden update" for self avatar as it interrupts controller processing
     {
-        updateMotions(LLCharacter::HIDDEN_UPDATE);
+        mMotionUpdateType = LLCharacter::HIDDEN_UPDATE;
     }
     else if (mSpecialRenderMode == 1) // Animation Preview
     {
-        updateMotions(LLCharacter::FORCE_UPDATE);
+        mMotionUpdateType = LLCharacter::FORCE_UPDATE;
     }
     else
     {
         // Might be better to do HIDDEN_UPDATE if cloud
-        updateMotions(LLCharacter::NORMAL_UPDATE);
+        mMotionUpdateType = LLCharacter::NORMAL_UPDATE;
+    }
+    mMotionsPending = prepareMotions(mMotionUpdateType);
+
+    // evaluate the skeleton in one flat pass, see LLSkeletonPose
+    static LLCachedControl<bool> pose_buffer(gSavedSettings, "AvatarSkeletonPoseBuffer", true);
+    if (mRoot->hasPoseBuffer() != (bool)pose_buffer)
+    {
+        mRoot->setPoseBuffer(pose_buffer);
+    }
+
+    mCharacterVisible = visible;
+    mWasSitGroundConstrained = was_sit_ground_constrained;
+    mCharacterUpdatePending = true;
+    return true;
+}
+
+//------------------------------------------------------------------------
+// animateCharacter()
+// Evaluates motions and propagates joint matrices. Touches nothing but
+// this avatar's skeleton and motions, so many avatars may be animated at
+// once on worker threads.
+//------------------------------------------------------------------------
+void LLVOAvatar::animateCharacter()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    if (!mCharacterUpdatePending)
+    {
+        return;
+    }
+
+    LLMotionController::EAnimationLOD lod = mMotionController.getAnimationLOD();
+    if (mMotionsPending)
+    {
+        U64 start = LLTrace::BlockTimer::getCPUClockCount64();
+        evaluateMotions(mMotionUpdateType);
+        mMotionsPending = false;
+        LLPerfStats::recordAnimation(lod, true, LLTrace::BlockTimer::getCPUClockCount64() - start);
+    }
+    else if (mMotionUpdateType != LLCharacter::HIDDEN_UPDATE)
+    {
+        // interpolating between animation LOD steps
+        LLPerfStats::recordAnimation(lod, false, 0);
+    }
+
+    // Update child joints as needed.
+    mRoot->updateWorldMatrixChildren();
+}
+
+//------------------------------------------------------------------------
+// finishCharacterUpdate()
+// The main thread half of updateCharacter() after animateCharacter().
+//------------------------------------------------------------------------
+bool LLVOAvatar::finishCharacterUpdate()
+{
+    mCharacterUpdatePending = false;
+
+    finishMotions();
+
+    if (mVisualParamsDeferred)
+    {
+        mVisualParamsDeferred = false;
+        updateVisualParams();
     }
 
     // Special handling for sitting on ground.
-    if (!getParent() && (isSitting() || was_sit_ground_constrained))
+    bool root_moved = false;
+    if (!getParent() && (isSitting() || mWasSitGroundConstrained))
     {
 
         F32 off_z = LLVector3d(getHoverOffset()).mdV[VZ];
@@ -4933,6 +5123,7 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
             mRoot->touch();
             // SL-315
             mRoot->setWorldPosition(pos);
+            root_moved = true;
         }
     }
 
@@ -4942,16 +5133,19 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     // Generate footstep sounds when feet hit the ground
     updateFootstepSounds();
 
-    // Update child joints as needed.
-    mRoot->updateWorldMatrixChildren();
+    // animateCharacter() updated the joints before the hover offset
+    if (root_moved)
+    {
+        mRoot->updateWorldMatrixChildren();
+    }
 
-    if (visible)
+    if (mCharacterVisible)
     {
         // System avatar mesh vertices need to be reskinned.
         mNeedsSkin = TRUE;
     }
 
-    return visible;
+    return mCharacterVisible;
 }
 
 //-----------------------------------------------------------------------------
@@ -6581,6 +6775,7 @@ void LLVOAvatar::clearAttachmentOverrides()
     }
 
     mActiveOverrideMeshes.clear();
+    mAttachmentOverrideJoints.clear();
     onActiveOverrideMeshesChanged();
 }
 
@@ -6646,6 +6841,15 @@ void LLVOAvatar::updateAttachmentOverrides()
     dumpStack("AnimatedObjectsStack");
 #endif
 
+    if (mAttachmentOverrideRequests > 1)
+    {
+        LL_DEBUGS("Avatar") << avString() << "coalesced " << mAttachmentOverrideRequests
+                            << " attachment override updates" << LL_ENDL;
+        mAttachmentOverrideUpdatesAvoided += mAttachmentOverrideRequests - 1;
+    }
+    mAttachmentOverrideRequests = 0;
+    ++mAttachmentOverrideUpdates;
+
     std::set<LLUUID> meshes_seen;
 
     // Handle the case that we're updating the skeleton of an animated object.
@@ -6750,6 +6954,11 @@ void LLVOAvatar::updateAttachmentOverrides()
 #endif
 }
 
+void LLVOAvatar::requestAttachmentOverrideUpdate()
+{
+    ++mAttachmentOverrideRequests;
+}
+
 void LLVOAvatar::notifyAttachmentMeshLoaded()
 {
     if (!isFullyLoaded())
@@ -6849,6 +7058,7 @@ void LLVOAvatar::addAttachmentOverridesForObject(LLViewerObject *vo, std::set<LL
             bool fullRig = (jointCnt>=JOINT_COUNT_REQUIRED_FOR_FULLRIG) ? true : false;
             if ( fullRig && !mesh_overrides_loaded )
             {
+                std::vector<S32>& overridden_joints = mAttachmentOverrideJoints[mesh_id];
                 for ( int i=0; i<jointCnt; ++i )
                 {
                     std::string lookingForJoint = pSkinData->mJointNames[i].c_str();
@@ -6858,6 +7068,7 @@ void LLVOAvatar::addAttachmentOverridesForObject(LLViewerObject *vo, std::set<LL
                         const LLVector3& jointPos = LLVector3(pSkinData->mAlternateBindMatrix[i].getTranslation());
                         if (pJoint->aboveJointPosThreshold(jointPos))
                         {
+                            overridden_joints.push_back(pJoint->getJointNum());
                             bool override_changed;
                             pJoint->addAttachmentPosOverride( jointPos, mesh_id, avString(), override_changed );
 
@@ -7048,25 +7259,44 @@ void LLVOAvatar::removeAttachmentOverridesForObject(LLViewerObject *vo)
 //-----------------------------------------------------------------------------
 void LLVOAvatar::removeAttachmentOverridesForObject(const LLUUID& mesh_id)
 {
-    LLJoint* pJointPelvis = getJoint("mPelvis");
     const std::string av_string = avString();
-    for (S32 joint_num = 0; joint_num < LL_CHARACTER_MAX_ANIMATED_JOINTS; joint_num++)
+    auto remove_overrides = [&](S32 joint_num)
     {
-        LLJoint *pJoint = getJoint(joint_num);
+        LLJoint *pJoint = joint_num < LL_CHARACTER_MAX_ANIMATED_JOINTS ? getJoint(joint_num) : NULL;
         if ( pJoint )
         {
             bool dummy; // unused
             pJoint->removeAttachmentPosOverride(mesh_id, av_string, dummy);
             pJoint->removeAttachmentScaleOverride(mesh_id, av_string);
         }
-        if ( pJoint && pJoint == pJointPelvis)
+    };
+
+    // Only the joints the mesh overrode can hold its overrides.
+    std::map<LLUUID, std::vector<S32> >::iterator joints_it = mAttachmentOverrideJoints.find(mesh_id);
+    if (joints_it != mAttachmentOverrideJoints.end())
+    {
+        for (S32 joint_num : joints_it->second)
         {
-            removePelvisFixup( mesh_id );
-            // SL-315
-            pJoint->setPosition( LLVector3( 0.0f, 0.0f, 0.0f) );
+            remove_overrides(joint_num);
+        }
+        mAttachmentOverrideJoints.erase(joints_it);
+    }
+    else
+    {
+        for (S32 joint_num = 0; joint_num < LL_CHARACTER_MAX_ANIMATED_JOINTS; joint_num++)
+        {
+            remove_overrides(joint_num);
         }
     }
 
+    LLJoint* pJointPelvis = getJoint("mPelvis");
+    if ( pJointPelvis )
+    {
+        removePelvisFixup( mesh_id );
+        // SL-315
+        pJointPelvis->setPosition( LLVector3( 0.0f, 0.0f, 0.0f) );
+    }
+
     postPelvisSetRecalc();
 
     mActiveOverrideMeshes.erase(mesh_id);
@@ -7129,6 +7359,12 @@ void LLVOAvatar::getGround(const LLVector3 &in_pos_agent, LLVector3 &out_pos_age
         return;
     }
 
+    std::unique_lock<std::mutex> lock(sGroundMutex, std::defer_lock);
+    if (sAnimatingInParallel)
+    {
+        lock.lock();
+    }
+
     p0_global = gAgent.getPosGlobalFromAgent(in_pos_agent) + z_vec;
     p1_global = gAgent.getPosGlobalFromAgent(in_pos_agent) - z_vec;
     LLViewerObject *obj;
@@ -7293,6 +7529,14 @@ void LLVOAvatar::initAttachmentPoints(bool ignore_hud_joints)
 //-----------------------------------------------------------------------------
 void LLVOAvatar::updateVisualParams()
 {
+    if (sAnimatingInParallel)
+    {
+        // a motion on a worker thread: applying params reaches the pipeline
+        // and may start motions, finishCharacterUpdate() will do it
+        mVisualParamsDeferred = true;
+        return;
+    }
+
     ESex avatar_sex = (getVisualParamWeight("male") > 0.5f) ? SEX_MALE : SEX_FEMALE;
     if (getSex() != avatar_sex)
     {
@@ -7661,10 +7905,10 @@ const LLViewerJointAttachment *LLVOAvatar::attachObject(LLViewerObject *viewer_o
 
     if (!viewer_object->isAnimatedObject())
     {
-        updateAttachmentOverrides();
+        requestAttachmentOverrideUpdate();
     }
 
-    updateVisualComplexity();
+    updateVisualComplexity(viewer_object);
 
     if (viewer_object->isSelected())
     {
@@ -7937,14 +8181,14 @@ BOOL LLVOAvatar::detachObject(LLViewerObject *viewer_object)
 
         if (attachment->isObjectAttached(viewer_object))
         {
-            updateVisualComplexity();
+            updateVisualComplexity(viewer_object);
             bool is_animated_object = viewer_object->isAnimatedObject();
             cleanupAttachedMesh(viewer_object);
 
             attachment->removeObject(viewer_object);
             if (!is_animated_object)
             {
-                updateAttachmentOverrides();
+                requestAttachmentOverrideUpdate();
             }
             viewer_object->refreshBakeTexture();
 
@@ -11149,8 +11393,94 @@ void LLVOAvatar::updateVisualComplexity()
 #endif
     // Set the cache time to in the past so it's updated ASAP
     mVisualComplexityStale = true;
+    mLinksetComplexity.clear();
 }
 
+void LLVOAvatar::updateVisualComplexity(const LLViewerObject* object)
+{
+    const LLViewerObject* root = object ? object->getRootEdit() : nullptr;
+    if (root)
+    {
+        mLinksetComplexity.invalidate(root->getID());
+    }
+    mVisualComplexityStale = true;
+}
+
+// Compute the cost of an attached linkset from scratch. The texture cost
+// is that of the unique textures across the whole linkset, which is why
+// it is cached per linkset rather than per volume.
+void LLVOAvatar::computeLinksetComplexity(
+    const LLViewerObject* attached_object,
+    LLVOVolume::texture_cost_t& textures,
+    LLLinksetComplexityCache::Linkset& linkset)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    linkset.mVisibleTriangles = attached_object->recursiveGetTriangleCount();
+    linkset.mEstTriangles = attached_object->recursiveGetEstTrianglesMax();
+    linkset.mSurfaceArea = attached_object->recursiveGetScaledSurfaceArea();
+    linkset.mCost = 0.f;
+    linkset.mValid = true;
+
+    textures.clear();
+    const LLDrawable* drawable = attached_object->mDrawable;
+    const LLVOVolume* volume = drawable ? drawable->getVOVolume() : nullptr;
+    if (!volume)
+    {
+        // not costed until it has a volume
+        linkset.mValid = false;
+        return;
+    }
+
+    F32 attachment_total_cost = 0;
+    F32 attachment_volume_cost = 0;
+    F32 attachment_texture_cost = 0;
+    F32 attachment_children_cost = 0;
+    const F32 animated_object_attachment_surcharge = 1000;
+
+    if (volume->isAnimatedObjectFast())
+    {
+        attachment_volume_cost += animated_object_attachment_surcharge;
+    }
+    attachment_volume_cost += volume->getRenderCost(textures);
+
+    const_child_list_t& children = volume->getChildren();
+    for (LLViewerObject* child_obj : children)
+    {
+        LLVOVolume *child = child_obj ? child_obj->asVolume() : nullptr;
+
+        if (child)
+        {
+            attachment_children_cost += child->getRenderCost(textures);
+        }
+    }
+
+    for (LLVOVolume::texture_cost_t::iterator volume_texture = textures.begin();
+        volume_texture != textures.end();
+        ++volume_texture)
+    {
+        // add the cost of each individual texture in the linkset
+        const LLViewerTexture* img = *volume_texture;
+        attachment_texture_cost += LLVOVolume::getTextureCost(img);
+        if (!img->getFullWidth() || !img->getFullHeight())
+        {
+            // the cost changes once the size is known, and nothing tells
+            // us when that is
+            linkset.mValid = false;
+        }
+    }
+    attachment_total_cost = attachment_volume_cost + attachment_texture_cost + attachment_children_cost;
+#ifdef SHOW_DEBUG
+    LL_DEBUGS("ARCdetail") << "Attachment costs " << attached_object->getAttachmentItemID()
+        << " total: " << attachment_total_cost
+        << ", volume: " << attachment_volume_cost
+        << ", " << textures.size()
+        << " textures: " << attachment_texture_cost
+        << ", " << volume->numChildren()
+        << " children: " << attachment_children_cost
+        << LL_ENDL;
+#endif
+    linkset.mCost = attachment_total_cost;
+}
 
 // Account for the complexity of a single top-level object associated
 // with an avatar. This will be either an attached object or an animated
@@ -11163,81 +11493,49 @@ void LLVOAvatar::accountRenderComplexityForObject(
     hud_complexity_list_t& hud_complexity_list,
     object_complexity_list_t& object_complexity_list,
     std::map<LLUUID, U32>& item_complexity,
-    std::map<LLUUID, U32>& temp_item_complexity)
+    std::map<LLUUID, U32>& temp_item_complexity,
+    U32& linksets_computed,
+    U32& linksets_cached)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
     if (attached_object && !attached_object->isHUDAttachment())
     {
-        mAttachmentVisibleTriangleCount += attached_object->recursiveGetTriangleCount();
-        mAttachmentEstTriangleCount += attached_object->recursiveGetEstTrianglesMax();
-        mAttachmentSurfaceArea += attached_object->recursiveGetScaledSurfaceArea();
-
-        textures.clear();
-        const LLDrawable* drawable = attached_object->mDrawable;
-        if (drawable)
+        LLLinksetComplexityCache::Linkset& linkset = mLinksetComplexity.get(attached_object->getID());
+        if (linkset.mValid)
         {
-            const LLVOVolume* volume = drawable->getVOVolume();
-            if (volume)
-            {
-                F32 attachment_total_cost = 0;
-                F32 attachment_volume_cost = 0;
-                F32 attachment_texture_cost = 0;
-                F32 attachment_children_cost = 0;
-                const F32 animated_object_attachment_surcharge = 1000;
-
-                if (volume->isAnimatedObjectFast())
-                {
-                    attachment_volume_cost += animated_object_attachment_surcharge;
-                }
-                attachment_volume_cost += volume->getRenderCost(textures);
+            ++linksets_cached;
+        }
+        else
+        {
+            computeLinksetComplexity(attached_object, textures, linkset);
+            ++linksets_computed;
+        }
 
-                const_child_list_t& children = volume->getChildren();
-                for (LLViewerObject* child_obj : children)
-                {
-                    LLVOVolume *child = child_obj ? child_obj->asVolume() : nullptr;
+        mAttachmentVisibleTriangleCount += linkset.mVisibleTriangles;
+        mAttachmentEstTriangleCount += linkset.mEstTriangles;
+        mAttachmentSurfaceArea += linkset.mSurfaceArea;
 
-                    if (child)
-                    {
-                        attachment_children_cost += child->getRenderCost(textures);
-                    }
-                }
+        const LLDrawable* drawable = attached_object->mDrawable;
+        if (drawable && drawable->getVOVolume())
+        {
+            F32 attachment_total_cost = linkset.mCost;
+            // Limit attachment complexity to avoid signed integer flipping of the wearer's ACI
+            cost += (U32)llclamp(attachment_total_cost, MIN_ATTACHMENT_COMPLEXITY, max_attachment_complexity);
 
-                for (LLVOVolume::texture_cost_t::iterator volume_texture = textures.begin();
-                    volume_texture != textures.end();
-                    ++volume_texture)
+            if (isSelf())
+            {
+                LLObjectComplexity object_complexity;
+                object_complexity.objectName = attached_object->getAttachmentItemName();
+                object_complexity.objectId = attached_object->getAttachmentItemID();
+                object_complexity.objectCost = attachment_total_cost;
+                object_complexity_list.push_back(object_complexity);
+                if (!attached_object->isTempAttachment())
                 {
-                    // add the cost of each individual texture in the linkset
-                    attachment_texture_cost += LLVOVolume::getTextureCost(*volume_texture);
+                    item_complexity.insert(std::make_pair(attached_object->getAttachmentItemID(), (U32)attachment_total_cost));
                 }
-                attachment_total_cost = attachment_volume_cost + attachment_texture_cost + attachment_children_cost;
-#ifdef SHOW_DEBUG
-                LL_DEBUGS("ARCdetail") << "Attachment costs " << attached_object->getAttachmentItemID()
-                    << " total: " << attachment_total_cost
-                    << ", volume: " << attachment_volume_cost
-                    << ", " << textures.size()
-                    << " textures: " << attachment_texture_cost
-                    << ", " << volume->numChildren()
-                    << " children: " << attachment_children_cost
-                    << LL_ENDL;
-#endif
-                // Limit attachment complexity to avoid signed integer flipping of the wearer's ACI
-                cost += (U32)llclamp(attachment_total_cost, MIN_ATTACHMENT_COMPLEXITY, max_attachment_complexity);
-
-                if (isSelf())
+                else
                 {
-                    LLObjectComplexity object_complexity;
-                    object_complexity.objectName = attached_object->getAttachmentItemName();
-                    object_complexity.objectId = attached_object->getAttachmentItemID();
-                    object_complexity.objectCost = attachment_total_cost;
-                    object_complexity_list.push_back(object_complexity);
-                    if (!attached_object->isTempAttachment())
-                    {
-                        item_complexity.insert(std::make_pair(attached_object->getAttachmentItemID(), (U32)attachment_total_cost));
-                    }
-                    else
-                    {
-                        temp_item_complexity.insert(std::make_pair(attached_object->getID(), (U32)attachment_total_cost));
-                    }
+                    temp_item_complexity.insert(std::make_pair(attached_object->getID(), (U32)attachment_total_cost));
                 }
             }
         }
@@ -11340,6 +11638,8 @@ void LLVOAvatar::calculateUpdateRenderComplexity()
         U32 body_parts_complexity;
 
         U32 cost = VISUAL_COMPLEXITY_UNKNOWN;
+        U32 linksets_computed = 0;
+        U32 linksets_cached = 0;
         LLVOVolume::texture_cost_t textures;
         hud_complexity_list_t hud_complexity_list;
         object_complexity_list_t object_complexity_list;
@@ -11379,6 +11679,7 @@ void LLVOAvatar::calculateUpdateRenderComplexity()
         mAttachmentVisibleTriangleCount = 0;
         mAttachmentEstTriangleCount = 0.f;
         mAttachmentSurfaceArea = 0.f;
+        mLinksetComplexity.beginPass();
 
         // A standalone animated object needs to be accounted for
         // using its associated volume. Attached animated objects
@@ -11390,7 +11691,8 @@ void LLVOAvatar::calculateUpdateRenderComplexity()
             if (volp && !volp->isAttachment())
             {
                 accountRenderComplexityForObject(volp, max_attachment_complexity,
-                                                 textures, cost, hud_complexity_list, object_complexity_list, item_complexity, temp_item_complexity);
+                                                 textures, cost, hud_complexity_list, object_complexity_list, item_complexity, temp_item_complexity,
+                                                 linksets_computed, linksets_cached);
             }
         }
 
@@ -11401,9 +11703,15 @@ void LLVOAvatar::calculateUpdateRenderComplexity()
             for (LLViewerObject* attached_object : attachment->mAttachedObjects)
             {
                 accountRenderComplexityForObject(attached_object, max_attachment_complexity,
-                                                 textures, cost, hud_complexity_list, object_complexity_list, item_complexity, temp_item_complexity);
+                                                 textures, cost, hud_complexity_list, object_complexity_list, item_complexity, temp_item_complexity,
+                                                 linksets_computed, linksets_cached);
             }
         }
+
+        // forget linksets that are no longer attached
+        mLinksetComplexity.endPass();
+        LLPerfStats::recordComplexityUpdate(linksets_computed, linksets_cached);
+
 #ifdef SHOW_DEBUG
         if ( cost != mVisualComplexity )
         {
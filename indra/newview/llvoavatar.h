@@ -56,6 +56,7 @@
 #include "llviewerstats.h"
 #include "llvovolume.h"
 #include "llavatarrendernotifier.h"
+#include "lllinksetcomplexity.h"
 #include "llmodel.h"
 //BD - Poser
 #include "bdanimator.h"
@@ -223,6 +224,9 @@ class LLVOAvatar :
     void                    clearAttachmentOverrides();
     void                    rebuildAttachmentOverrides();
     void                    updateAttachmentOverrides();
+    // Defers updateAttachmentOverrides() to the next idle update, so that
+    // every attachment change in a frame costs one pass over the skeleton.
+    void                    requestAttachmentOverrideUpdate();
     void                    showAttachmentOverrides(bool verbose = false) const;
     void                    getAttachmentOverrideNames(std::set<std::string>& pos_names,
                                                        std::set<std::string>& scale_names) const;
@@ -240,6 +244,14 @@ class LLVOAvatar :
 
     std::set<LLUUID>        mActiveOverrideMeshes;
     void            onActiveOverrideMeshesChanged();
+    // Joints each active mesh overrides, so that removing a mesh only
+    // touches those.
+    std::map<LLUUID, std::vector<S32> > mAttachmentOverrideJoints;
+    // requestAttachmentOverrideUpdate() calls since the last update
+    U32             mAttachmentOverrideRequests = 0;
+    // update passes, and the requests they covered, over this avatar's life
+    U32             mAttachmentOverrideUpdates = 0;
+    U32             mAttachmentOverrideUpdatesAvoided = 0;
 
     /*virtual*/ const LLUUID&   getID() const override;
     /*virtual*/ void            addDebugText(const std::string& text) override;
@@ -285,9 +297,40 @@ class LLVOAvatar :
     void            updateFootstepSounds();
     void            computeUpdatePeriod();
     void            updateOrientation(LLAgent &agent, F32 speed, F32 delta_time);
-    void            updateTimeStep();
+    void            updateAnimationLOD();
     void            updateRootPositionAndRotation(LLAgent &agent, F32 speed, bool was_sit_ground_constrained);
 
+    // idleUpdate() in the phases LLViewerObjectList::update() runs crowds
+    // in: beginIdleUpdate() for every avatar on the main thread, then
+    // animateCharacter() for all of them at once on the parallel cull pool,
+    // then finishIdleUpdate() for each back on the main thread, where
+    // idleUpdate() would have run. beginIdleUpdate() returns false if there
+    // is nothing to animate. While sAnimatingInParallel is set, anything
+    // animateCharacter() would do outside the avatar waits for
+    // finishIdleUpdate().
+    virtual bool    canAnimateInParallel() const;
+    bool            beginIdleUpdate(LLAgent &agent, const F64 &time);
+    void            animateCharacter();
+    void            finishIdleUpdate();
+    bool            isIdleUpdatePending() const { return mIdleUpdatePending; }
+    static bool     sAnimatingInParallel;
+protected:
+    bool            idleUpdateBeforeCharacter(LLAgent &agent, const F64 &time);
+    void            idleUpdateAfterCharacter(bool detailed_update);
+    bool            beginCharacterUpdate(LLAgent &agent);
+    bool            finishCharacterUpdate();
+private:
+    // state carried from beginIdleUpdate() to finishIdleUpdate()
+    bool            mIdleUpdatePending = false;
+    bool            mIdleUpdateContinues = false;
+    bool            mCharacterUpdatePending = false;
+    bool            mMotionsPending = false;
+    bool            mVisualParamsDeferred = false;
+    bool            mCharacterVisible = false;
+    bool            mWasSitGroundConstrained = false;
+    LLCharacter::e_update_t mMotionUpdateType = LLCharacter::NORMAL_UPDATE;
+public:
+
     void            idleUpdateVoiceVisualizer(bool voice_enabled, const LLVector3 &position);
     void            idleUpdateMisc(bool detailed_update);
     virtual void    idleUpdateAppearanceAnimation();
@@ -312,10 +355,15 @@ class LLVOAvatar :
                                                      hud_complexity_list_t& hud_complexity_list,
                                                      object_complexity_list_t& object_complexity_list,
                                                      std::map<LLUUID, U32>& item_complexity,
-                                                     std::map<LLUUID, U32>& temp_item_complexity);
+                                                     std::map<LLUUID, U32>& temp_item_complexity,
+                                                     U32& linksets_computed,
+                                                     U32& linksets_cached);
     void            calculateUpdateRenderComplexity();
     static const U32 VISUAL_COMPLEXITY_UNKNOWN;
+    // Everything about this avatar's complexity may have changed.
     void            updateVisualComplexity();
+    // Only the attached linkset that object belongs to has changed.
+    void            updateVisualComplexity(const LLViewerObject* object);
 
     void placeProfileQuery();
     void readProfileQuery(S32 retries);
@@ -590,6 +638,11 @@ class LLVOAvatar :
     mutable U32  mVisualComplexity;
     mutable bool mVisualComplexityStale;
     mutable F64  mVisualComplexityUpdateTime = 0.f;
+
+    LLLinksetComplexityCache mLinksetComplexity;
+    void computeLinksetComplexity(const LLViewerObject* attached_object,
+                                  LLVOVolume::texture_cost_t& textures,
+                                  LLLinksetComplexityCache::Linkset& linkset);
     U32          mReportedVisualComplexity; // from other viewers through the simulator
 
     mutable bool        mCachedInMuteList;
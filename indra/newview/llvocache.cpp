@@ -567,42 +567,6 @@ bool LLVOCacheEntry::isAnyVisible(const LLVector4a& camera_origin, const LLVecto
     return vis;
 }
 
-void LLVOCacheEntry::calcSceneContribution(const LLVector4a& camera_origin, bool needs_update, U32 last_update, F32 max_dist)
-{
-    if(!needs_update && getVisible() >= last_update)
-    {
-        return; //no need to update
-    }
-
-    LLVector4a lookAt;
-    lookAt.setSub(getPositionGroup(), camera_origin);
-    F32 distance = lookAt.getLength3().getF32();
-    distance -= sNearRadius;
-
-    if(distance <= 0.f)
-    {
-        //nearby objects, set a large number
-        const F32 LARGE_SCENE_CONTRIBUTION = 1000.f; //a large number to force to load the object.
-        mSceneContrib = LARGE_SCENE_CONTRIBUTION;
-    }
-    else
-    {
-        F32 rad = getBinRadius();
-        max_dist += rad;
-
-        if(distance + sNearRadius < max_dist)
-        {
-            mSceneContrib = (rad * rad) / distance;
-        }
-        else
-        {
-            mSceneContrib = 0.f; //out of draw distance, not to load
-        }
-    }
-
-    setVisible();
-}
-
 void LLVOCacheEntry::saveBoundingSphere()
 {
     mBSphereCenter = getPositionGroup();
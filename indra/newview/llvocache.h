@@ -120,7 +120,6 @@ class LLVOCacheEntry final
     S32 getHitCount() const         { return mHitCount; }
     S32 getCRCChangeCount() const   { return mCRCChangeCount; }
 
-    void calcSceneContribution(const LLVector4a& camera_origin, bool needs_update, U32 last_update, F32 dist_threshold);
     void setSceneContribution(F32 scene_contrib) {mSceneContrib = scene_contrib;}
     F32 getSceneContribution() const             { return mSceneContrib;}
 
@@ -288,7 +288,7 @@ void LLVOSurfacePatch::updateMainGeometry(LLFace *facep,
                                         LLStrider<U16> &indicesp,
                                         U32 &index_offset)
 {
-    S32 i, j, x, y;
+    S32 i, j, y;
 
     U32 patch_size, render_stride;
     S32 num_vertices, num_indices;
@@ -315,19 +315,11 @@ void LLVOSurfacePatch::updateMainGeometry(LLFace *facep,
     {
         facep->mCenterAgent = mPatchp->getPointAgent(8, 8);
 
-        // Generate patch points first
+        // Generate patch points first, a row at a time
         for (j = 0; j < vert_size; j++)
         {
-            for (i = 0; i < vert_size; i++)
-            {
-                x = i * render_stride;
-                y = j * render_stride;
-                mPatchp->eval(x, y, render_stride, verticesp.get(), normalsp.get(), texCoords0p.get(), texCoords1p.get());
-                verticesp++;
-                normalsp++;
-                texCoords0p++;
-                texCoords1p++;
-            }
+            y = j * render_stride;
+            mPatchp->evalRow(0, y, render_stride, vert_size, verticesp, normalsp, texCoords0p, texCoords1p);
         }
 
         for (j = 0; j < (vert_size - 1); j++)
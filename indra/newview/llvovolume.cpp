@@ -68,6 +68,9 @@
 #include "llselectmgr.h"
 #include "pipeline.h"
 #include "llsdutil.h"
+#include "hbxxh.h"
+#include "llparallelcull.h"
+#include "llviewerstats.h"
 #include "llmatrix4a.h"
 #include "llmediaentry.h"
 #include "llmediadataclient.h"
@@ -430,6 +433,7 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
                     gPipeline.markTextured(mDrawable);
                     mFaceMappingChanged = TRUE;
                     mTexAnimMode = 0;
+                    updateVisualComplexity();
                 }
             }
 
@@ -533,6 +537,7 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
                 gPipeline.markTextured(mDrawable);
                 mFaceMappingChanged = TRUE;
                 mTexAnimMode = 0;
+                updateVisualComplexity();
             }
 
             if (value & 0x400)
@@ -638,6 +643,7 @@ void LLVOVolume::animateTextures()
                 start = end = mTextureAnimp->mFace;
             }
 
+            bool matrix_added = false;
             for (S32 i = start; i <= end; i++)
             {
                 LLFace* facep = mDrawable->getFace(i);
@@ -667,6 +673,7 @@ void LLVOVolume::animateTextures()
                 if (!facep->mTextureMatrix)
                 {
                     facep->mTextureMatrix = new LLMatrix4a();
+                    matrix_added = true;
                 }
 
                 LLMatrix4a& tex_mat = *facep->mTextureMatrix;
@@ -689,6 +696,12 @@ void LLVOVolume::animateTextures()
                 tex_mat.translate_affine(trans);
 
             }
+
+            if (matrix_added)
+            {
+                // animated faces cost more
+                updateVisualComplexity();
+            }
         }
         else
         {
@@ -974,6 +987,7 @@ void LLVOVolume::setScale(const LLVector3 &scale, BOOL damped)
         }
 
         updateRadius();
+        updateVisualComplexity();
 
         //since drawable transforms do not include scale, changing volume scale
         //requires an immediate rebuild of volume verts.
@@ -1208,12 +1222,12 @@ void LLVOVolume::updateVisualComplexity()
     LLVOAvatar* avatar = getAvatarAncestor();
     if (avatar)
     {
-        avatar->updateVisualComplexity();
+        avatar->updateVisualComplexity(this);
     }
     LLVOAvatar* rigged_avatar = getAvatar();
     if(rigged_avatar && (rigged_avatar != avatar))
     {
-        rigged_avatar->updateVisualComplexity();
+        rigged_avatar->updateVisualComplexity(this);
     }
 }
 
@@ -1449,6 +1463,11 @@ BOOL LLVOVolume::calcLOD()
     F32 distance;
     F32 lod_factor = LLVOVolume::sLODFactor;
 
+    // scored this frame by LLViewerObjectList::updateApparentAngles
+    const LLObjectScores& scores = gObjectList.getScores();
+    const bool scored = !mDrawable->isState(LLDrawable::RIGGED) &&
+        gObjectList.hasCurrentScore(this, LLViewerCamera::getInstance()->getOrigin());
+
     if (mDrawable->isState(LLDrawable::RIGGED))
     {
         LLVOAvatar* avatar = getAvatar();
@@ -1496,7 +1515,14 @@ BOOL LLVOVolume::calcLOD()
     else
     {
         distance = mDrawable->mDistanceWRTCamera;
-        radius = getVolume() ? getVolume()->mLODScaleBias.scaledVec(getScale()).length() : getScale().length();
+        if (scored)
+        {
+            radius = scores.getRadius(getScoreIndex());
+        }
+        else
+        {
+            radius = getVolume() ? getVolume()->mLODScaleBias.scaledVec(getScale()).length() : getScale().length();
+        }
         if (distance <= 0.f || radius <= 0.f)
         {
 #ifdef SHOW_DEBUG
@@ -1531,20 +1557,28 @@ BOOL LLVOVolume::calcLOD()
         }
     }
 
-    distance *= sDistanceFactor;
-
     F32 rampDist = LLVOVolume::sLODFactor * 2;
 
-    if (distance < rampDist)
+    if (scored && distance == scores.getLODDistance(getScoreIndex()))
     {
-        // Boost LOD when you're REALLY close
-        distance *= 1.0f/rampDist;
-        distance *= distance;
-        distance *= rampDist;
+        // the drawable's distance came from the same pass (or from the same
+        // position), so the adjustment below has been done already
+        distance = scores.getLODAdjustedDistance(getScoreIndex());
     }
+    else
+    {
+        distance *= sDistanceFactor;
 
+        if (distance < rampDist)
+        {
+            // Boost LOD when you're REALLY close
+            distance *= 1.0f/rampDist;
+            distance *= distance;
+            distance *= rampDist;
+        }
 
-    distance *= F_PI/3.f;
+        distance *= F_PI/3.f;
+    }
 
     static LLCachedControl<bool> ignore_fov_zoom(gSavedSettings,"IgnoreFOVZoomForLODs");
     if(!ignore_fov_zoom)
@@ -1885,6 +1919,7 @@ BOOL LLVOVolume::genBBoxes(BOOL force_global, BOOL should_update_octree_bounds)
 
         updateRadius();
         mDrawable->movePartition();
+        gObjectList.updateScore(this);
     }
 #ifdef SHOW_DEBUG
     else
@@ -1995,7 +2030,7 @@ bool LLVOVolume::lodOrSculptChanged(LLDrawable *drawable, BOOL &compiled, BOOL &
 
     if ((new_lod != old_lod) || mSculptChanged)
     {
-        if (mDrawable->isState(LLDrawable::RIGGED))
+        if (mDrawable->isState(LLDrawable::RIGGED) || isAttachment())
         {
             updateVisualComplexity();
         }
@@ -2078,6 +2113,8 @@ BOOL LLVOVolume::updateGeometry(LLDrawable *drawable)
     if (mVolumeChanged || mFaceMappingChanged)
     {
         dirtySpatialGroup();
+        // textures or face parameters changed
+        updateVisualComplexity();
 
         bool was_regen_faces = false;
         should_update_octree_bounds = true;
@@ -2266,6 +2303,8 @@ S32 LLVOVolume::setTEColor(const U8 te, const LLColor4& color)
             //treat this alpha change as an LoD update since render batches may need to get rebuilt
             mLODChanged = TRUE;
             gPipeline.markRebuild(mDrawable, LLDrawable::REBUILD_VOLUME);
+            // alpha faces cost more
+            updateVisualComplexity();
         }
         retval = LLPrimitive::setTEColor(te, color);
         if (mDrawable.notNull() && retval)
@@ -3080,6 +3119,7 @@ void LLVOVolume::setIsLight(BOOL is_light)
             // Not a light.  Remove it from the pipeline's light set.
             gPipeline.setLight(mDrawable, FALSE);
         }
+        updateVisualComplexity();
     }
 }
 
@@ -3715,16 +3755,9 @@ void LLVOVolume::onSetExtendedMeshFlags(U32 flags)
     if (isAttachment() && getAvatarAncestor())
     {
         updateVisualComplexity();
-        if (flags & LLExtendedMeshParams::ANIMATED_MESH_ENABLED_FLAG)
-        {
-            // Making a rigged mesh into an animated object
-            getAvatarAncestor()->updateAttachmentOverrides();
-        }
-        else
-        {
-            // Making an animated object into a rigged mesh
-            getAvatarAncestor()->updateAttachmentOverrides();
-        }
+        // Making a rigged mesh into an animated object or back: its joint
+        // overrides move between the avatar and the control avatar.
+        getAvatarAncestor()->requestAttachmentOverrideUpdate();
     }
 }
 
@@ -4014,8 +4047,6 @@ U32 LLVOVolume::getRenderCost(texture_cost_t &textures) const
     U32 num_triangles = 0;
 
     // per-prim costs
-    static const U32 ARC_PARTICLE_COST = 1; // determined experimentally
-    static const U32 ARC_PARTICLE_MAX = 2048; // default values
     static const U32 ARC_LIGHT_COST = 500; // static cost for light-producing prims
     static const U32 ARC_MEDIA_FACE_COST = 1500; // static cost per media-enabled face
 
@@ -4232,12 +4263,7 @@ U32 LLVOVolume::getRenderCost(texture_cost_t &textures) const
     // add additional costs
     if (particles)
     {
-        const LLPartSysData *part_sys_data = &(mPartSourcep->mPartSysData);
-        const LLPartData *part_data = &(part_sys_data->mPartData);
-        U32 num_particles = (U32)(part_sys_data->mBurstPartCount * llceil( part_data->mMaxAge / part_sys_data->mBurstRate));
-        num_particles = num_particles > ARC_PARTICLE_MAX ? ARC_PARTICLE_MAX : num_particles;
-        F32 part_size = (llmax(part_data->mStartScale[0], part_data->mEndScale[0]) + llmax(part_data->mStartScale[1], part_data->mEndScale[1])) / 2.f;
-        shame += num_particles * part_size * ARC_PARTICLE_COST;
+        shame += getParticleCost();
     }
 
     if (produces_light)
@@ -4770,9 +4796,9 @@ BOOL LLVOVolume::lineSegmentIntersect(const LLVector4a& start, const LLVector4a&
                 continue;
             }
 
-            // This calculates the bounding box of the skinned mesh from scratch. It's actually quite expensive, but not nearly as expensive as building a full octree.
-            // rebuild_face_octrees = false because an octree for this face will be built later only if needed for narrow phase picking.
-            updateRiggedVolume(true, i, false);
+            // This calculates the bounding box of the skinned mesh, skipped if the pose hasn't changed since the last update.
+            // An octree for this face will be built by lineSegmentIntersect only if needed for narrow phase picking.
+            updateRiggedVolume(true, i);
             face_hit = volume->lineSegmentIntersect(local_start, local_end, i,
                                                     &p, &tc, &n, &tn);
 
@@ -4896,7 +4922,7 @@ void LLVOVolume::clearRiggedVolume()
     }
 }
 
-void LLVOVolume::updateRiggedVolume(bool force_treat_as_rigged, LLRiggedVolume::FaceIndex face_index, bool rebuild_face_octrees)
+void LLVOVolume::updateRiggedVolume(bool force_treat_as_rigged, LLRiggedVolume::FaceIndex face_index)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
     //Update mRiggedVolume to match current animation frame of avatar.
@@ -4936,15 +4962,14 @@ void LLVOVolume::updateRiggedVolume(bool force_treat_as_rigged, LLRiggedVolume::
         updateRelativeXform();
     }
 
-    mRiggedVolume->update(mSkinInfo, avatar, volume, face_index, rebuild_face_octrees);
+    mRiggedVolume->update(mSkinInfo, avatar, volume, face_index);
 }
 
 void LLRiggedVolume::update(
     const LLMeshSkinInfo* skin,
     LLVOAvatar* avatar,
     const LLVolume* volume,
-    FaceIndex face_index,
-    bool rebuild_face_octrees)
+    FaceIndex face_index)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
     bool copy = false;
@@ -4969,6 +4994,7 @@ void LLRiggedVolume::update(
     if (copy)
     {
         copyVolumeFaces(volume);
+        mSkinHashes.assign(vol_num_faces, 0);
     }
     else
     {
@@ -4983,6 +5009,10 @@ void LLRiggedVolume::update(
         }
     }
 
+    if (mSkinHashes.size() != (size_t) vol_num_faces)
+    {
+        mSkinHashes.assign(vol_num_faces, 0);
+    }
 
     //build matrix palette
     static const size_t kMaxJoints = LL_MAX_JOINTS_PER_MESH_OBJECT;
@@ -4990,11 +5020,26 @@ void LLRiggedVolume::update(
     LLMatrix4a mat[kMaxJoints];
     U32 maxJoints = LLSkinningUtil::getMeshJointCount(skin);
     LLSkinningUtil::initSkinningMatrixPalette(mat, maxJoints, skin, avatar);
-    const LLMatrix4a bind_shape_matrix = skin->mBindShapeMatrix;
+    LLSkinningUtil::applyBindShapeMatrix(mat, maxJoints, skin);
+
+    // faces skinned with an identical palette from the same source are
+    // already up to date.  The source is identified by its mesh and LOD
+    // rather than its address, which a reloaded volume can reuse (only
+    // mesh volumes carry skin info, so the sculpt ID names the asset).
+    const LLVolumeParams& src_params = volume->getParams();
+    const U8 sculpt_type = src_params.getSculptType();
+    const F32 detail = volume->getDetail();
+    HBXXH64 hasher;
+    hasher.update(mat, sizeof(LLMatrix4a) * maxJoints);
+    hasher.update(src_params.getSculptID().mData, UUID_BYTES);
+    hasher.update(&sculpt_type, sizeof(sculpt_type));
+    hasher.update(&detail, sizeof(detail));
+    U64 palette_hash = hasher.digest();
+    if (palette_hash == 0)
+    { //0 means never skinned
+        palette_hash = 1;
+    }
 
-    S32 rigged_vert_count = 0;
-    S32 rigged_face_count = 0;
-    LLVector4a box_min, box_max;
     S32 face_begin;
     S32 face_end;
     if (face_index == DO_NOT_UPDATE_FACES)
@@ -5012,6 +5057,23 @@ void LLRiggedVolume::update(
         face_begin = face_index;
         face_end = face_begin + 1;
     }
+
+    // split stale faces into vertex ranges that can be skinned in parallel
+    static const U32 kSkinRangeSize = 4096;
+
+    struct SkinRange
+    {
+        LLVector4a mMin;
+        LLVector4a mMax;
+        S32 mFace;
+        U32 mBegin;
+        U32 mCount;
+    };
+    std::vector<SkinRange> ranges;
+
+    S32 rigged_vert_count = 0;
+    S32 rigged_face_count = 0;
+
     for (S32 i = face_begin; i < face_end; ++i)
     {
         const LLVolumeFace& vol_face = volume->getVolumeFace(i);
@@ -5020,66 +5082,109 @@ void LLRiggedVolume::update(
 
         LLVector4a* weight = vol_face.mWeights;
 
-        if ( weight )
+        if (weight && dst_face.mPositions && dst_face.mExtents && dst_face.mNumVertices > 0)
         {
             LLSkinningUtil::checkSkinWeights(weight, dst_face.mNumVertices, skin);
 
-            LLVector4a* pos = dst_face.mPositions;
+            rigged_vert_count += dst_face.mNumVertices;
+            rigged_face_count++;
 
-            if (pos && dst_face.mExtents)
+            if (mSkinHashes[i] == palette_hash)
             {
-                rigged_vert_count += dst_face.mNumVertices;
-                rigged_face_count++;
+                continue;
+            }
 
-                {
-                    for (U32 j = 0; j < dst_face.mNumVertices; ++j)
-                    {
-                        LLMatrix4a final_mat;
-                        LLSkinningUtil::getPerVertexSkinMatrixUnchecked(weight[j], mat, final_mat);
-
-                        LLVector4a& v = vol_face.mPositions[j];
-                        LLVector4a t;
-                        LLVector4a dst;
-                        bind_shape_matrix.affineTransform(v, t);
-                        final_mat.affineTransform(t, dst);
-                        pos[j] = dst;
-                    }
-                }
+            mSkinHashes[i] = palette_hash;
+            dst_face.destroyOctree();
 
-                //update bounding box
-                // VFExtents change
-                LLVector4a& min = dst_face.mExtents[0];
-                LLVector4a& max = dst_face.mExtents[1];
+            for (U32 begin = 0; begin < (U32) dst_face.mNumVertices; begin += kSkinRangeSize)
+            {
+                SkinRange& range = ranges.emplace_back();
+                range.mFace = i;
+                range.mBegin = begin;
+                range.mCount = llmin(kSkinRangeSize, (U32) dst_face.mNumVertices - begin);
+            }
+        }
+    }
 
-                min = pos[0];
-                max = pos[1];
-                if (i==0)
-                {
-                    box_min = min;
-                    box_max = max;
-                }
+    if (!ranges.empty())
+    {
+        LL_PROFILE_ZONE_NAMED_CATEGORY_VOLUME("rigged volume - skin");
 
-                for (U32 j = 1; j < dst_face.mNumVertices; ++j)
-                {
-                    min.setMin(min, pos[j]);
-                    max.setMax(max, pos[j]);
-                }
+        auto skin_range = [&](U32 idx)
+        {
+            SkinRange& range = ranges[idx];
+            const LLVolumeFace& vol_face = volume->getVolumeFace(range.mFace);
+            LLVolumeFace& dst_face = mVolumeFaces[range.mFace];
 
-                box_min.setMin(min,box_min);
-                box_max.setMax(max,box_max);
+            LLSkinningUtil::skinPositions(mat, vol_face.mWeights + range.mBegin,
+                vol_face.mPositions + range.mBegin, range.mCount,
+                dst_face.mPositions + range.mBegin, range.mMin, range.mMax);
+        };
 
-                dst_face.mCenter->setAdd(dst_face.mExtents[0], dst_face.mExtents[1]);
-                dst_face.mCenter->mul(0.5f);
+        if (ranges.size() > 1 && LLParallelCull::isAvailable())
+        {
+            LLParallelCull::run((U32) ranges.size(), skin_range);
+        }
+        else
+        {
+            for (U32 idx = 0; idx < ranges.size(); ++idx)
+            {
+                skin_range(idx);
+            }
+        }
 
+        //update bounding boxes
+        // VFExtents change
+        for (U32 idx = 0; idx < ranges.size(); ++idx)
+        {
+            const SkinRange& range = ranges[idx];
+            LLVolumeFace& dst_face = mVolumeFaces[range.mFace];
+            LLVector4a& min = dst_face.mExtents[0];
+            LLVector4a& max = dst_face.mExtents[1];
+
+            if (range.mBegin == 0)
+            {
+                min = range.mMin;
+                max = range.mMax;
+            }
+            else
+            {
+                min.setMin(min, range.mMin);
+                max.setMax(max, range.mMax);
             }
 
-            if (rebuild_face_octrees)
+            if (range.mBegin + range.mCount == (U32) dst_face.mNumVertices)
             {
-                dst_face.destroyOctree();
-                dst_face.createOctree();
+                dst_face.mCenter->setAdd(min, max);
+                dst_face.mCenter->mul(0.5f);
             }
         }
     }
+
+    LLVector4a box_min, box_max;
+    box_min.clear();
+    box_max.clear();
+    bool first = true;
+    for (S32 i = face_begin; i < face_end; ++i)
+    {
+        const LLVolumeFace& dst_face = mVolumeFaces[i];
+        if (mSkinHashes[i] != 0 && dst_face.mExtents)
+        {
+            if (first)
+            {
+                box_min = dst_face.mExtents[0];
+                box_max = dst_face.mExtents[1];
+                first = false;
+            }
+            else
+            {
+                box_min.setMin(box_min, dst_face.mExtents[0]);
+                box_max.setMax(box_max, dst_face.mExtents[1]);
+            }
+        }
+    }
+
     mExtraDebugText = llformat("rigged %d/%d - box (%f %f %f) (%f %f %f)",
                                rigged_face_count, rigged_vert_count,
                                box_min[0], box_min[1], box_min[2],
@@ -5562,6 +5667,332 @@ void LLVolumeGeometryManager::getGeometry(LLSpatialGroup* group)
 
 }
 
+namespace
+{
+    // Defers LLFace::getGeometryVolume() calls so the vertex and index data
+    // for a spatial group can be generated on the parallel cull pool while
+    // the main thread waits.  Only the CPU side copy of each buffer is
+    // written by the jobs; unmapping (the GL upload) and draw info
+    // registration stay on the main thread.
+    class FaceGeometryQueue
+    {
+    public:
+        // Must be called on the main thread with the drawable's relative
+        // transform in the state getGeometryVolume() expects.  The matrices
+        // are copied since animated children reset theirs right after.
+        void add(LLFace* facep, LLVolume* volume, S32 te_idx,
+                 const LLMatrix4a& mat_vert, const LLMatrix4a& mat_norm, U16 index_offset)
+        {
+            LLVertexBuffer* buffer = facep->getVertexBuffer();
+            if (!buffer)
+            {
+                return;
+            }
+
+            if (use_threads() && te_idx >= 0 && te_idx < volume->getNumVolumeFaces())
+            {
+                // tangent generation writes to the (possibly shared) volume,
+                // so get it out of the way before any worker touches it
+                const LLTextureEntry* tep = facep->getTextureEntry();
+                if (buffer->hasDataType(LLVertexBuffer::TYPE_TANGENT) ||
+                    (tep && (tep->getBumpmap() || tep->getTexGen() != LLTextureEntry::TEX_GEN_DEFAULT)))
+                {
+                    volume->genTangents(te_idx);
+                }
+            }
+
+            Job& job = mJobs.emplace_back();
+            job.mFace = facep;
+            job.mBuffer = buffer;
+            job.mVolume = volume;
+            job.mTEIndex = te_idx;
+            job.mVertMat = mat_vert;
+            job.mNormMat = mat_norm;
+            job.mIndexOffset = index_offset;
+            job.mFailed = false;
+        }
+
+        // Queue a face at its current place in its vertex buffer, giving
+        // animated children the relative transform they are built with.
+        void add(LLFace* facep)
+        {
+            LLDrawable* drawablep = facep->getDrawable();
+            LLVOVolume* vobj = drawablep->getVOVolume();
+
+            if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+            {
+                vobj->updateRelativeXform(true);
+            }
+
+            add(facep, vobj->getVolume(), facep->getTEOffset(),
+                vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), facep->getGeomIndex());
+
+            if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+            {
+                vobj->updateRelativeXform(false);
+            }
+        }
+
+        // Generate geometry for every queued face.  Returns the number of
+        // faces that could not be built.
+        U32 build(bool force_rebuild, bool no_debug_assert)
+        {
+            if (mJobs.empty())
+            {
+                return 0;
+            }
+
+            LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+            F64 start = LLTimer::getTotalSeconds();
+
+            // LLVertexBuffer tracks its mapped regions in plain vectors, so
+            // all faces sharing a buffer are filled by the same job
+            std::stable_sort(mJobs.begin(), mJobs.end(),
+                [](const Job& lhs, const Job& rhs) { return lhs.mBuffer < rhs.mBuffer; });
+
+            mRanges.clear();
+            for (U32 i = 0; i < mJobs.size(); ++i)
+            {
+                if (i == 0 || mJobs[i].mBuffer != mJobs[i - 1].mBuffer)
+                {
+                    mRanges.push_back(i);
+                }
+            }
+            mRanges.push_back((U32)mJobs.size());
+
+            auto fill = [this, force_rebuild, no_debug_assert](U32 range)
+            {
+                for (U32 i = mRanges[range], end = mRanges[range + 1]; i < end; ++i)
+                {
+                    Job& job = mJobs[i];
+                    job.mFailed = !job.mFace->getGeometryVolume(*job.mVolume, job.mTEIndex,
+                        job.mVertMat, job.mNormMat, job.mIndexOffset, force_rebuild, no_debug_assert);
+                }
+            };
+
+            U32 range_count = (U32)mRanges.size() - 1;
+            if (use_threads())
+            {
+                LLParallelCull::run(range_count, fill);
+            }
+            else
+            {
+                for (U32 i = 0; i < range_count; ++i)
+                {
+                    fill(i);
+                }
+            }
+
+            U32 failed = 0;
+            for (const Job& job : mJobs)
+            {
+                failed += job.mFailed ? 1 : 0;
+            }
+
+            sFacesBuilt += (U32)mJobs.size();
+            sBuildSeconds += LLTimer::getTotalSeconds() - start;
+
+            return failed;
+        }
+
+        // Flush the staging copy of every touched buffer.  Main thread only.
+        void unmapBuffers()
+        {
+            LLVertexBuffer* last = nullptr;
+            for (const Job& job : mJobs)
+            {
+                if (job.mBuffer != last)
+                {
+                    last = job.mBuffer;
+                    last->unmapBuffer();
+                }
+            }
+            mJobs.clear();
+        }
+
+        // Report faces/ms for everything built since the last call.
+        static void recordRate()
+        {
+            if (sFacesBuilt > 0 && sBuildSeconds > 0.0)
+            {
+                record(LLStatViewer::GEOMETRY_REBUILD_RATE, sFacesBuilt / (sBuildSeconds * 1000.0));
+            }
+            sFacesBuilt = 0;
+            sBuildSeconds = 0.0;
+        }
+
+    private:
+        static bool use_threads()
+        {
+            static LLCachedControl<bool> threaded(gSavedSettings, "RenderThreadedGeometryRebuild", true);
+            return threaded && LLParallelCull::isAvailable();
+        }
+
+        struct Job
+        {
+            LLMatrix4a      mVertMat;
+            LLMatrix4a      mNormMat;
+            LLFace*         mFace;
+            LLVertexBuffer* mBuffer;
+            LLVolume*       mVolume;
+            S32             mTEIndex;
+            U16             mIndexOffset;
+            bool            mFailed;
+        };
+
+        std::vector<Job> mJobs;
+        std::vector<U32> mRanges;
+
+        static U32 sFacesBuilt;
+        static F64 sBuildSeconds;
+    };
+
+    U32 FaceGeometryQueue::sFacesBuilt = 0;
+    F64 FaceGeometryQueue::sBuildSeconds = 0.0;
+
+    // genDrawInfo lays batches out first, then generates their geometry in
+    // one go, then registers faces in the original order
+    struct FaceBatch
+    {
+        LLFace** mBegin;
+        LLFace** mEnd;
+        bool mBakeSunlight;
+    };
+
+    U32 sBatchGeneration = 0;
+
+    // Try to reuse the group's last full layout of a face list: put the
+    // faces back in layout order on their old vertex buffers and queue
+    // geometry only for faces whose drawables were flagged for rebuild.
+    // Fails without touching anything if a face was added, removed, resized
+    // or moved between lists since, or if most of the list changed anyway
+    // and a fresh sort would batch better.
+    bool patch_batch_layout(LLSpatialGroup* group, const LLSpatialGroup::BatchLayout& layout, U32 mask,
+                            LLFace** faces, U32 face_count, BOOL distance_sort, BOOL batch_textures,
+                            std::vector<FaceBatch>& batches, FaceGeometryQueue& geometry)
+    {
+        static LLCachedControl<bool> patch_draw_info(gSavedSettings, "RenderPatchDrawInfo", true);
+
+        if (!patch_draw_info ||
+            layout.mGeneration == 0 ||
+            layout.mMask != mask ||
+            layout.mBatchTextures != (bool)batch_textures ||
+            layout.mSlots.size() != face_count ||
+            (distance_sort && group->hasState(LLSpatialGroup::ALPHA_DIRTY)))
+        {
+            return false;
+        }
+
+        static std::vector<LLFace*> order;
+        order.assign(face_count, nullptr);
+
+        U32 dirty_count = 0;
+
+        for (U32 i = 0; i < face_count; ++i)
+        {
+            LLFace* facep = faces[i];
+
+            if (facep->mBatchGeneration != layout.mGeneration ||
+                facep->mBatchPosition >= face_count ||
+                order[facep->mBatchPosition] != nullptr)
+            { //face wasn't in this layout
+                return false;
+            }
+
+            const LLSpatialGroup::BatchLayout::Slot& slot = layout.mSlots[facep->mBatchPosition];
+            if (slot.mGeomCount != facep->getGeomCount() ||
+                slot.mIndicesCount != facep->getIndicesCount())
+            { //resized, everything after it in the buffer would have to move
+                return false;
+            }
+
+            if (batch_textures && facep->getTextureIndex() != 0 && !can_batch_texture(facep))
+            { //face can no longer share an indexed texture batch
+                return false;
+            }
+
+            if (facep->getDrawable()->isState(LLDrawable::REBUILD_ALL))
+            {
+                ++dirty_count;
+            }
+
+            order[facep->mBatchPosition] = facep;
+        }
+
+        if (dirty_count * 2 > face_count)
+        {
+            return false;
+        }
+
+        std::copy(order.begin(), order.end(), faces);
+
+        LLFace** batch_begin = faces;
+        for (U32 i = 0; i < face_count; ++i)
+        {
+            LLFace* facep = faces[i];
+            LLVertexBuffer* buffer = layout.mSlots[i].mBuffer;
+
+            if (i > 0 && buffer != layout.mSlots[i - 1].mBuffer)
+            {
+                batches.push_back({ batch_begin, faces + i,
+                    LLPipeline::sBakeSunlight && (*batch_begin)->getDrawable()->isStatic() });
+                batch_begin = faces + i;
+            }
+
+            facep->setVertexBuffer(buffer);
+
+            if (facep->getDrawable()->isState(LLDrawable::REBUILD_ALL))
+            {
+                facep->updateRebuildFlags();
+                geometry.add(facep);
+            }
+        }
+
+        batches.push_back({ batch_begin, faces + face_count,
+            LLPipeline::sBakeSunlight && (*batch_begin)->getDrawable()->isStatic() });
+
+        return true;
+    }
+
+    // Remember where the faces of a freshly laid out list went.
+    void record_batch_layout(LLSpatialGroup::BatchLayout& layout, U32 mask, LLFace** faces, U32 face_count, BOOL batch_textures)
+    {
+        layout.clear();
+
+        if (++sBatchGeneration == 0)
+        { //0 marks faces and layouts that were never recorded
+            ++sBatchGeneration;
+        }
+
+        layout.mSlots.reserve(face_count);
+
+        for (U32 i = 0; i < face_count; ++i)
+        {
+            LLFace* facep = faces[i];
+            LLVertexBuffer* buffer = facep->getVertexBuffer();
+            if (!buffer)
+            { //allocation failed, nothing to patch next time
+                layout.clear();
+                return;
+            }
+
+            if (layout.mBuffers.empty() || layout.mBuffers.back() != buffer)
+            {
+                layout.mBuffers.push_back(buffer);
+            }
+
+            layout.mSlots.push_back({ buffer, facep->getGeomCount(), facep->getIndicesCount() });
+
+            facep->mBatchGeneration = sBatchGeneration;
+            facep->mBatchPosition = i;
+        }
+
+        layout.mGeneration = sBatchGeneration;
+        layout.mMask = mask;
+        layout.mBatchTextures = batch_textures;
+    }
+}
+
 // add a face pointer to a list of face pointers without going over MAX_COUNT faces
 template<typename T>
 static inline void add_face(T*** list, U32* count, T* face)
@@ -5855,7 +6286,14 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
                     {
                         type = LLDrawPool::POOL_SIMPLE;
                     }
+                    const bool was_alpha = facep->isInAlphaPool();
                     facep->setPoolType(type);
+                    if (facep->isInAlphaPool() != was_alpha)
+                    {
+                        // the cost of alpha faces is only known once they
+                        // have been put in the alpha pool, after setTEColor()
+                        vobj->updateVisualComplexity();
+                    }
 
                     if (vobj->isHUDAttachment() && !is_pbr)
                     {
@@ -6050,16 +6488,17 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
     U32 extra_mask = LLVertexBuffer::MAP_TEXTURE_INDEX;
     BOOL alpha_sort = TRUE;
     BOOL rigged = FALSE;
+    U32 layout_index = 0;
     for (int i = 0; i < 2; ++i) //two sets, static and rigged)
     {
-        geometryBytes += genDrawInfo(group, simple_mask | extra_mask, sSimpleFaces[i], simple_count[i], FALSE, batch_textures, rigged);
-        geometryBytes += genDrawInfo(group, fullbright_mask | extra_mask, sFullbrightFaces[i], fullbright_count[i], FALSE, batch_textures, rigged);
-        geometryBytes += genDrawInfo(group, alpha_mask | extra_mask, sAlphaFaces[i], alpha_count[i], alpha_sort, batch_textures, rigged);
-        geometryBytes += genDrawInfo(group, bump_mask | extra_mask, sBumpFaces[i], bump_count[i], FALSE, FALSE, rigged);
-        geometryBytes += genDrawInfo(group, norm_mask | extra_mask, sNormFaces[i], norm_count[i], FALSE, FALSE, rigged);
-        geometryBytes += genDrawInfo(group, spec_mask | extra_mask, sSpecFaces[i], spec_count[i], FALSE, FALSE, rigged);
-        geometryBytes += genDrawInfo(group, normspec_mask | extra_mask, sNormSpecFaces[i], normspec_count[i], FALSE, FALSE, rigged);
-        geometryBytes += genDrawInfo(group, pbr_mask | extra_mask, sPbrFaces[i], pbr_count[i], FALSE, FALSE, rigged);
+        geometryBytes += genDrawInfo(group, layout_index++, simple_mask | extra_mask, sSimpleFaces[i], simple_count[i], FALSE, batch_textures, rigged);
+        geometryBytes += genDrawInfo(group, layout_index++, fullbright_mask | extra_mask, sFullbrightFaces[i], fullbright_count[i], FALSE, batch_textures, rigged);
+        geometryBytes += genDrawInfo(group, layout_index++, alpha_mask | extra_mask, sAlphaFaces[i], alpha_count[i], alpha_sort, batch_textures, rigged);
+        geometryBytes += genDrawInfo(group, layout_index++, bump_mask | extra_mask, sBumpFaces[i], bump_count[i], FALSE, FALSE, rigged);
+        geometryBytes += genDrawInfo(group, layout_index++, norm_mask | extra_mask, sNormFaces[i], norm_count[i], FALSE, FALSE, rigged);
+        geometryBytes += genDrawInfo(group, layout_index++, spec_mask | extra_mask, sSpecFaces[i], spec_count[i], FALSE, FALSE, rigged);
+        geometryBytes += genDrawInfo(group, layout_index++, normspec_mask | extra_mask, sNormSpecFaces[i], normspec_count[i], FALSE, FALSE, rigged);
+        geometryBytes += genDrawInfo(group, layout_index++, pbr_mask | extra_mask, sPbrFaces[i], pbr_count[i], FALSE, FALSE, rigged);
 
         // for rigged set, add weights and disable alpha sorting (rigged items use depth buffer)
         extra_mask |= LLVertexBuffer::MAP_WEIGHT4;
@@ -6083,6 +6522,8 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
     group->mLastUpdateTime = gFrameTimeSeconds;
     group->mBuilt = 1.f;
     group->clearState(LLSpatialGroup::GEOM_DIRTY | LLSpatialGroup::ALPHA_DIRTY);
+
+    FaceGeometryQueue::recordRate();
 }
 
 void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
@@ -6101,6 +6542,9 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 
             U32 buffer_count = 0;
 
+            FaceGeometryQueue geometry;
+            std::vector<LLDrawable*> rebuilt;
+
             for (LLSpatialGroup::element_iter drawable_iter = group->getDataBegin(); drawable_iter != group->getDataEnd(); ++drawable_iter)
             {
                 LLDrawable* drawablep = (LLDrawable*)(*drawable_iter)->getDrawable();
@@ -6127,24 +6571,11 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
                         LLFace* face = drawablep->getFace(i);
                         if (face)
                         {
-                            LLVertexBuffer* buff = face->getVertexBuffer();
-                            if (buff)
-                            {
-                                if (!face->getGeometryVolume(*volume, // volume
-                                    face->getTEOffset(),              // face_index
-                                    vobj->getRelativeXform(),         // mat_vert_in
-                                    vobj->getRelativeXformInvTrans(), // mat_norm_in
-                                    face->getGeomIndex(),             // index_offset
-                                    false,                            // force_rebuild
-                                    true))                            // no_debug_assert
-                                {   // Something's gone wrong with the vertex buffer accounting,
-                                    // rebuild this group with no debug assert because MESH_DIRTY
-                                    group->dirtyGeom();
-                                    gPipeline.markRebuild(group);
-                                }
-
-                                buff->unmapBuffer();
-                            }
+                            geometry.add(face, volume,
+                                face->getTEOffset(),              // face_index
+                                vobj->getRelativeXform(),         // mat_vert_in
+                                vobj->getRelativeXformInvTrans(), // mat_norm_in
+                                face->getGeomIndex());            // index_offset
                         }
                     }
 
@@ -6153,12 +6584,27 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
                         vobj->updateRelativeXform();
                     }
 
-                    drawablep->clearState(LLDrawable::REBUILD_ALL);
+                    // rebuild flags are read while the geometry is generated
+                    rebuilt.push_back(drawablep);
                 }
             }
 
+            if (geometry.build(false, true))
+            {   // Something's gone wrong with the vertex buffer accounting,
+                // rebuild this group with no debug assert because MESH_DIRTY
+                group->dirtyGeom();
+                gPipeline.markRebuild(group);
+            }
+
+            for (LLDrawable* drawablep : rebuilt)
+            {
+                drawablep->clearState(LLDrawable::REBUILD_ALL);
+            }
+
             {
                 LL_PROFILE_ZONE_NAMED("rebuildMesh - flush");
+                geometry.unmapBuffers();
+
                 for (LLVertexBuffer** iter = locked_buffer, ** end_iter = locked_buffer+buffer_count; iter != end_iter; ++iter)
                 {
                     (*iter)->unmapBuffer();
@@ -6174,6 +6620,8 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 
             group->clearState(LLSpatialGroup::MESH_DIRTY | LLSpatialGroup::NEW_DRAWINFO);
         }
+
+        FaceGeometryQueue::recordRate();
     }
 }
 
@@ -6233,7 +6681,7 @@ struct CompareBatchBreakerRigged
     }
 };
 
-U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace** faces, U32 face_count, BOOL distance_sort, BOOL batch_textures, BOOL rigged)
+U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 layout_index, U32 mask, LLFace** faces, U32 face_count, BOOL distance_sort, BOOL batch_textures, BOOL rigged)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
 
@@ -6244,138 +6692,207 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
     U32 max_vertices = (max_vbo_size * 1024)/LLVertexBuffer::calcVertexSize(group->getSpatialPartition()->mVertexDataMask);
     max_vertices = llmin(max_vertices, (U32) 65535);
 
+    if (group->mBatchLayouts.size() <= layout_index)
     {
-        LL_PROFILE_ZONE_NAMED("genDrawInfo - sort");
-
-        if (rigged)
-        {
-            if (!distance_sort) // <--- alpha "sort" rigged faces by maintaining original draw order
-            {
-                //sort faces by things that break batches, including avatar and mesh id
-                std::sort(faces, faces + face_count, CompareBatchBreakerRigged());
-            }
-        }
-        else if (!distance_sort)
-        {
-            //sort faces by things that break batches, not including avatar and mesh id
-            std::sort(faces, faces + face_count, CompareBatchBreaker());
-        }
-        else
-        {
-            //sort faces by distance
-            std::sort(faces, faces+face_count, LLFace::CompareDistanceGreater());
-        }
+        group->mBatchLayouts.resize(layout_index + 1);
     }
+    LLSpatialGroup::BatchLayout& layout = group->mBatchLayouts[layout_index];
 
     bool hud_group = group->isHUDGroup() ;
-    LLFace** face_iter = faces;
-    LLFace** end_faces = faces+face_count;
 
     LLSpatialGroup::buffer_map_t buffer_map;
 
-    LLViewerTexture* last_tex = NULL;
-
-    S32 texture_index_channels = LLGLSLShader::sIndexedTextureChannels;
+    std::vector<FaceBatch> batches;
+    FaceGeometryQueue geometry;
 
-    bool flexi = false;
+    bool patched = face_count > 0 &&
+        patch_batch_layout(group, layout, mask, faces, face_count, distance_sort, batch_textures, batches, geometry);
 
-    while (face_iter != end_faces)
+    if (patched)
     {
-        //pull off next face
-        LLFace* facep = *face_iter;
-        LLViewerTexture* tex = facep->getTexture();
-        const LLTextureEntry* te = facep->getTextureEntry();
-        LLMaterialPtr mat = te->getMaterialParams();
-        LLMaterialID matId = te->getMaterialID();
-
-        if (distance_sort)
+        for (const LLPointer<LLVertexBuffer>& buffer : layout.mBuffers)
         {
-            tex = NULL;
+            geometryBytes += buffer->getSize() + buffer->getIndicesSize();
         }
 
-        if (last_tex != tex)
+        add(LLStatViewer::DRAW_INFO_PATCHES, 1);
+    }
+    else
+    {
+        if (face_count > 0)
         {
-            last_tex = tex;
+            add(LLStatViewer::DRAW_INFO_REBUILDS, 1);
         }
 
-        bool bake_sunlight = LLPipeline::sBakeSunlight && facep->getDrawable()->isStatic();
+        {
+            LL_PROFILE_ZONE_NAMED("genDrawInfo - sort");
 
-        U32 index_count = facep->getIndicesCount();
-        U32 geom_count = facep->getGeomCount();
+            if (rigged)
+            {
+                if (!distance_sort) // <--- alpha "sort" rigged faces by maintaining original draw order
+                {
+                    //sort faces by things that break batches, including avatar and mesh id
+                    std::sort(faces, faces + face_count, CompareBatchBreakerRigged());
+                }
+            }
+            else if (!distance_sort)
+            {
+                //sort faces by things that break batches, not including avatar and mesh id
+                std::sort(faces, faces + face_count, CompareBatchBreaker());
+            }
+            else
+            {
+                //sort faces by distance
+                std::sort(faces, faces+face_count, LLFace::CompareDistanceGreater());
+            }
+        }
 
-        flexi = flexi || facep->getViewerObject()->getVolume()->isUnique();
+        LLFace** face_iter = faces;
+        LLFace** end_faces = faces+face_count;
 
-        //sum up vertices needed for this render batch
-        LLFace** i = face_iter;
-        ++i;
+        LLViewerTexture* last_tex = NULL;
 
-        const U32 MAX_TEXTURE_COUNT = 32;
-        LLViewerTexture* texture_list[MAX_TEXTURE_COUNT];
+        S32 texture_index_channels = LLGLSLShader::sIndexedTextureChannels;
 
-        U32 texture_count = 0;
+        bool flexi = false;
 
+        while (face_iter != end_faces)
         {
-            LL_PROFILE_ZONE_NAMED("genDrawInfo - face size");
-            if (batch_textures)
+            //pull off next face
+            LLFace* facep = *face_iter;
+            LLViewerTexture* tex = facep->getTexture();
+            const LLTextureEntry* te = facep->getTextureEntry();
+            LLMaterialPtr mat = te->getMaterialParams();
+            LLMaterialID matId = te->getMaterialID();
+
+            if (distance_sort)
             {
-                U8 cur_tex = 0;
-                facep->setTextureIndex(cur_tex);
-                if (texture_count < MAX_TEXTURE_COUNT)
-                {
-                    texture_list[texture_count++] = tex;
-                }
+                tex = NULL;
+            }
 
-                if (can_batch_texture(facep))
-                { //populate texture_list with any textures that can be batched
-                  //move i to the next unbatchable face
-                    while (i != end_faces)
-                    {
-                        facep = *i;
+            if (last_tex != tex)
+            {
+                last_tex = tex;
+            }
 
-                        if (!can_batch_texture(facep))
-                        { //face is bump mapped or has an animated texture matrix -- can't
-                            //batch more than 1 texture at a time
-                            facep->setTextureIndex(0);
-                            break;
-                        }
+            bool bake_sunlight = LLPipeline::sBakeSunlight && facep->getDrawable()->isStatic();
+
+            U32 index_count = facep->getIndicesCount();
+            U32 geom_count = facep->getGeomCount();
+
+            flexi = flexi || facep->getViewerObject()->getVolume()->isUnique();
+
+            //sum up vertices needed for this render batch
+            LLFace** i = face_iter;
+            ++i;
+
+            const U32 MAX_TEXTURE_COUNT = 32;
+            LLViewerTexture* texture_list[MAX_TEXTURE_COUNT];
+
+            U32 texture_count = 0;
 
-                        if (facep->getTexture() != tex)
+            {
+                LL_PROFILE_ZONE_NAMED("genDrawInfo - face size");
+                if (batch_textures)
+                {
+                    U8 cur_tex = 0;
+                    facep->setTextureIndex(cur_tex);
+                    if (texture_count < MAX_TEXTURE_COUNT)
+                    {
+                        texture_list[texture_count++] = tex;
+                    }
+
+                    if (can_batch_texture(facep))
+                    { //populate texture_list with any textures that can be batched
+                      //move i to the next unbatchable face
+                        while (i != end_faces)
                         {
-                            if (distance_sort)
-                            { //textures might be out of order, see if texture exists in current batch
-                                bool found = false;
-                                for (U32 tex_idx = 0; tex_idx < texture_count; ++tex_idx)
-                                {
-                                    if (facep->getTexture() == texture_list[tex_idx])
+                            facep = *i;
+
+                            if (!can_batch_texture(facep))
+                            { //face is bump mapped or has an animated texture matrix -- can't
+                                //batch more than 1 texture at a time
+                                facep->setTextureIndex(0);
+                                break;
+                            }
+
+                            if (facep->getTexture() != tex)
+                            {
+                                if (distance_sort)
+                                { //textures might be out of order, see if texture exists in current batch
+                                    bool found = false;
+                                    for (U32 tex_idx = 0; tex_idx < texture_count; ++tex_idx)
+                                    {
+                                        if (facep->getTexture() == texture_list[tex_idx])
+                                        {
+                                            cur_tex = tex_idx;
+                                            found = true;
+                                            break;
+                                        }
+                                    }
+
+                                    if (!found)
                                     {
-                                        cur_tex = tex_idx;
-                                        found = true;
-                                        break;
+                                        cur_tex = texture_count;
                                     }
                                 }
+                                else
+                                {
+                                    cur_tex++;
+                                }
 
-                                if (!found)
+                                if (cur_tex >= texture_index_channels)
+                                { //cut batches when index channels are depleted
+                                    break;
+                                }
+
+                                tex = facep->getTexture();
+
+                                if (texture_count < MAX_TEXTURE_COUNT)
                                 {
-                                    cur_tex = texture_count;
+                                    texture_list[texture_count++] = tex;
                                 }
                             }
-                            else
-                            {
-                                cur_tex++;
-                            }
 
-                            if (cur_tex >= texture_index_channels)
-                            { //cut batches when index channels are depleted
+                            if (geom_count + facep->getGeomCount() > max_vertices)
+                            { //cut batches on geom count too big
                                 break;
                             }
 
-                            tex = facep->getTexture();
+                            ++i;
 
-                            if (texture_count < MAX_TEXTURE_COUNT)
-                            {
-                                texture_list[texture_count++] = tex;
-                            }
+                            flexi = flexi || facep->getViewerObject()->getVolume()->isUnique();
+
+                            index_count += facep->getIndicesCount();
+                            geom_count += facep->getGeomCount();
+
+                            facep->setTextureIndex(cur_tex);
                         }
+                    }
+                    else
+                    {
+                        facep->setTextureIndex(0);
+                    }
+
+                    tex = texture_list[0];
+                }
+                else
+                {
+                    while (i != end_faces &&
+                        (LLPipeline::sTextureBindTest ||
+                            (distance_sort ||
+                                ((*i)->getTexture() == tex))))
+                    {
+                        facep = *i;
+                        const LLTextureEntry* nextTe = facep->getTextureEntry();
+                        if (nextTe->getMaterialID() != matId)
+                        {
+                            break;
+                        }
+
+                        //face has no texture index
+                        facep->mDrawInfo = NULL;
+                        facep->setTextureIndex(FACE_DO_NOT_BATCH_TEXTURES);
 
                         if (geom_count + facep->getGeomCount() > max_vertices)
                         { //cut batches on geom count too big
@@ -6383,133 +6900,98 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
                         }
 
                         ++i;
-
-                        flexi = flexi || facep->getViewerObject()->getVolume()->isUnique();
-
                         index_count += facep->getIndicesCount();
                         geom_count += facep->getGeomCount();
 
-                        facep->setTextureIndex(cur_tex);
+                        flexi = flexi || facep->getViewerObject()->getVolume()->isUnique();
                     }
                 }
-                else
-                {
-                    facep->setTextureIndex(0);
-                }
-
-                tex = texture_list[0];
             }
-            else
-            {
-                while (i != end_faces &&
-                    (LLPipeline::sTextureBindTest ||
-                        (distance_sort ||
-                            ((*i)->getTexture() == tex))))
-                {
-                    facep = *i;
-                    const LLTextureEntry* nextTe = facep->getTextureEntry();
-                    if (nextTe->getMaterialID() != matId)
-                    {
-                        break;
-                    }
 
-                    //face has no texture index
-                    facep->mDrawInfo = NULL;
-                    facep->setTextureIndex(FACE_DO_NOT_BATCH_TEXTURES);
+            //create vertex buffer
+            LLPointer<LLVertexBuffer> buffer;
 
-                    if (geom_count + facep->getGeomCount() > max_vertices)
-                    { //cut batches on geom count too big
-                        break;
-                    }
-
-                    ++i;
-                    index_count += facep->getIndicesCount();
-                    geom_count += facep->getGeomCount();
-
-                    flexi = flexi || facep->getViewerObject()->getVolume()->isUnique();
+            {
+                LL_PROFILE_ZONE_NAMED("genDrawInfo - allocate");
+                buffer = new LLVertexBuffer(mask);
+                if(!buffer->allocateBuffer(geom_count, index_count))
+                {
+                    LL_WARNS() << "Failed to allocate group Vertex Buffer to "
+                        << geom_count << " vertices and "
+                        << index_count << " indices" << LL_ENDL;
+                    buffer = NULL;
                 }
             }
-        }
-
-        //create vertex buffer
-        LLPointer<LLVertexBuffer> buffer;
 
-        {
-            LL_PROFILE_ZONE_NAMED("genDrawInfo - allocate");
-            buffer = new LLVertexBuffer(mask);
-            if(!buffer->allocateBuffer(geom_count, index_count))
+            if (buffer)
             {
-                LL_WARNS() << "Failed to allocate group Vertex Buffer to "
-                    << geom_count << " vertices and "
-                    << index_count << " indices" << LL_ENDL;
-                buffer = NULL;
+                geometryBytes += buffer->getSize() + buffer->getIndicesSize();
+                buffer_map[mask][*face_iter].push_back(buffer);
+                batches.push_back({ face_iter, i, bake_sunlight });
             }
-        }
-
-        if (buffer)
-        {
-            geometryBytes += buffer->getSize() + buffer->getIndicesSize();
-            buffer_map[mask][*face_iter].push_back(buffer);
-        }
 
-        //add face geometry
+            //add face geometry
 
-        U32 indices_index = 0;
-        U16 index_offset = 0;
-
-        while (face_iter < i)
-        {
-            //update face indices for new buffer
-            facep = *face_iter;
+            U32 indices_index = 0;
+            U16 index_offset = 0;
 
-            if (buffer.isNull())
+            while (face_iter < i)
             {
-                // Bulk allocation failed
+                //update face indices for new buffer
+                facep = *face_iter;
+
+                if (buffer.isNull())
+                {
+                    // Bulk allocation failed
+                    facep->setVertexBuffer(buffer);
+                    facep->setSize(0, 0); // mark as no geometry
+                    ++face_iter;
+                    continue;
+                }
+                facep->setIndicesIndex(indices_index);
+                facep->setGeomIndex(index_offset);
                 facep->setVertexBuffer(buffer);
-                facep->setSize(0, 0); // mark as no geometry
-                ++face_iter;
-                continue;
-            }
-            facep->setIndicesIndex(indices_index);
-            facep->setGeomIndex(index_offset);
-            facep->setVertexBuffer(buffer);
 
-            if (batch_textures && facep->getTextureIndex() == FACE_DO_NOT_BATCH_TEXTURES)
-            {
-                LL_ERRS() << "Invalid texture index." << LL_ENDL;
-            }
+                if (batch_textures && facep->getTextureIndex() == FACE_DO_NOT_BATCH_TEXTURES)
+                {
+                    LL_ERRS() << "Invalid texture index." << LL_ENDL;
+                }
 
-            {
-                //for debugging, set last time face was updated vs moved
-                facep->updateRebuildFlags();
+                {
+                    //for debugging, set last time face was updated vs moved
+                    facep->updateRebuildFlags();
 
-                { //copy face geometry into vertex buffer
-                    LLDrawable* drawablep = facep->getDrawable();
-                    LLVOVolume* vobj = drawablep->getVOVolume();
-                    LLVolume* volume = vobj->getVolume();
+                    //queue face geometry for copy into vertex buffer
+                    geometry.add(facep);
+                }
 
-                    if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
-                    {
-                        vobj->updateRelativeXform(true);
-                    }
+                index_offset += facep->getGeomCount();
+                indices_index += facep->getIndicesCount();
 
-                    U32 te_idx = facep->getTEOffset();
+                ++face_iter;
+            }
+        }
 
-                    if (!facep->getGeometryVolume(*volume, te_idx,
-                        vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset,true))
-                    {
-                        LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
-                    }
+        record_batch_layout(layout, mask, faces, face_count, batch_textures);
+    }
 
-                    if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
-                    {
-                        vobj->updateRelativeXform(false);
-                    }
-                }
-            }
+    {
+        LL_PROFILE_ZONE_NAMED("genDrawInfo - geometry");
+        U32 failed = geometry.build(true, false);
+        if (failed)
+        {
+            LL_WARNS() << "Failed to get geometry for " << failed << " face(s)!" << LL_ENDL;
+        }
+        geometry.unmapBuffers();
+    }
+
+    for (const FaceBatch& batch : batches)
+    {
+        bool bake_sunlight = batch.mBakeSunlight;
 
-            index_offset += facep->getGeomCount();
-            indices_index += facep->getIndicesCount();
+        for (LLFace** face_iter = batch.mBegin; face_iter != batch.mEnd; ++face_iter)
+        {
+            LLFace* facep = *face_iter;
 
             //append face to appropriate render batch
 
@@ -6528,7 +7010,7 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
                 fullbright = TRUE;
             }
 
-            tex = facep->getTexture();
+            LLViewerTexture* tex = facep->getTexture();
 
             BOOL is_alpha = (facep->getPoolType() == LLDrawPool::POOL_ALPHA) ? TRUE : FALSE;
 
@@ -6848,21 +7330,17 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
                     registerFace(group, facep, LLRenderPass::PASS_GLOW);
                 }
             }
-
-            ++face_iter;
-        }
-
-        if (buffer)
-        {
-            buffer->unmapBuffer();
         }
     }
 
-    auto& mask_buffer_map = buffer_map[mask];
+    if (!patched)
+    { //a patched layout keeps the buffers already in the map
+        auto& mask_buffer_map = buffer_map[mask];
 
-    auto& group_buffer_map = group->mBufferMap[mask];
-    group_buffer_map.clear();
-    group_buffer_map.insert(mask_buffer_map.begin(), mask_buffer_map.end());
+        auto& group_buffer_map = group->mBufferMap[mask];
+        group_buffer_map.clear();
+        group_buffer_map.insert(mask_buffer_map.begin(), mask_buffer_map.end());
+    }
 
     return geometryBytes;
 }
@@ -68,14 +68,21 @@ class LLRiggedVolume final : public LLVolume
     using FaceIndex = S32;
     static const FaceIndex UPDATE_ALL_FACES = -1;
     static const FaceIndex DO_NOT_UPDATE_FACES = -2;
+    // Skin src_volume into this volume's faces and update their extents.
+    // Faces already skinned with the same joint palette are left alone;
+    // re-skinned faces drop their octree, which LLVolume::lineSegmentIntersect
+    // rebuilds the next time a pick reaches that face.
     void update(
         const LLMeshSkinInfo* skin,
         LLVOAvatar* avatar,
         const LLVolume* src_volume,
-        FaceIndex face_index = UPDATE_ALL_FACES,
-        bool rebuild_face_octrees = true);
+        FaceIndex face_index = UPDATE_ALL_FACES);
 
     std::string mExtraDebugText;
+
+private:
+    // palette hash each face was last skinned with, 0 if never
+    std::vector<U64> mSkinHashes;
 };
 
 // Base class for implementations of the volume - Primitive, Flexible Object, etc.
@@ -407,11 +414,10 @@ class LLVOVolume final : public LLViewerObject
 
 
     // Rigged volume update (for raycasting)
-    // By default, this updates the bounding boxes of all the faces and builds an octree for precise per-triangle raycasting
+    // By default, this updates the bounding boxes of all the faces; per-triangle octrees are built when a pick needs them
     void updateRiggedVolume(
         bool force_treat_as_rigged,
-        LLRiggedVolume::FaceIndex face_index = LLRiggedVolume::UPDATE_ALL_FACES,
-        bool rebuild_face_octrees = true);
+        LLRiggedVolume::FaceIndex face_index = LLRiggedVolume::UPDATE_ALL_FACES);
     LLRiggedVolume* getRiggedVolume();
 
     //returns true if volume should be treated as a rigged volume
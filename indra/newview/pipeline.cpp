@@ -109,6 +109,7 @@
 #include "llfloaterpathfindingcharacters.h"
 #include "llfloatertools.h"
 #include "llpanelface.h"
+#include "llparallelcull.h"
 #include "llpathfindingpathtool.h"
 #include "llscenemonitor.h"
 #include "llprogressview.h"
@@ -2454,28 +2455,38 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result)
 
     sCull->clear();
 
-    for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin();
-            iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
+    // Reading back occlusion queries happens mid-traversal and needs GL, so only culls
+    // that skip it (shadow maps, reflections, occlusion off) can spread across threads.
+    static LLCachedControl<bool> parallel_cull(gSavedSettings, "RenderParallelCull", true);
+    if (parallel_cull && LLParallelCull::isAvailable() && (sUseOcclusion < 2 || sReflectionRender))
     {
-        LLViewerRegion* region = *iter;
-
-        for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+        cullPartitionsParallel(camera);
+    }
+    else
+    {
+        for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin();
+                iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
         {
-            LLSpatialPartition* part = region->getSpatialPartition(i);
-            if (part)
+            LLViewerRegion* region = *iter;
+
+            for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
             {
-                if (hasRenderType(part->mDrawableType))
+                LLSpatialPartition* part = region->getSpatialPartition(i);
+                if (part)
                 {
-                    part->cull(camera);
+                    if (hasRenderType(part->mDrawableType))
+                    {
+                        part->cull(camera);
+                    }
                 }
             }
-        }
 
-        //scan the VO Cache tree
-        LLVOCachePartition* vo_part = region->getVOCachePartition();
-        if(vo_part)
-        {
-            vo_part->cull(camera, sUseOcclusion > 0);
+            //scan the VO Cache tree
+            LLVOCachePartition* vo_part = region->getVOCachePartition();
+            if(vo_part)
+            {
+                vo_part->cull(camera, sUseOcclusion > 0);
+            }
         }
     }
 
@@ -2499,6 +2510,60 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result)
     }
 }
 
+void LLPipeline::cullPartitionsParallel(LLCamera& camera)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_PIPELINE;
+
+    // only touched from the main thread, kept around to avoid reallocating every pass
+    static std::vector<LLSpatialPartition*> partitions;
+    static std::vector<std::vector<LLSpatialGroup*> > visible;
+
+    partitions.clear();
+    for (LLViewerRegion* region : LLWorld::getInstance()->getRegionList())
+    {
+        for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+        {
+            LLSpatialPartition* part = region->getSpatialPartition(i);
+            if (part && hasRenderType(part->mDrawableType))
+            {
+                part->prepareCull();
+                partitions.push_back(part);
+            }
+        }
+    }
+
+    if (visible.size() < partitions.size())
+    {
+        visible.resize(partitions.size());
+    }
+
+    LLParallelCull::run((U32)partitions.size(), [&camera](U32 i)
+        {
+            visible[i].clear();
+            partitions[i]->cullVisible(camera, visible[i]);
+        });
+
+    // merge in the same order the serial cull visits partitions so the
+    // cull result (and everything sorted from it) is identical
+    for (U32 i = 0; i < partitions.size(); ++i)
+    {
+        for (LLSpatialGroup* group : visible[i])
+        {
+            markNotCulled(group, camera);
+        }
+    }
+
+    // the VO cache cull updates region state rather than the cull result, leave it here
+    for (LLViewerRegion* region : LLWorld::getInstance()->getRegionList())
+    {
+        LLVOCachePartition* vo_part = region->getVOCachePartition();
+        if (vo_part)
+        {
+            vo_part->cull(camera, sUseOcclusion > 0);
+        }
+    }
+}
+
 void LLPipeline::markNotCulled(LLSpatialGroup* group, LLCamera& camera)
 {
     if (group->isEmpty())
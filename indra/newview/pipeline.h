@@ -240,6 +240,8 @@ class LLPipeline
 
     // Populate given LLCullResult with results of a frustum cull of the entire scene against the given LLCamera
     void updateCull(LLCamera& camera, LLCullResult& result);
+    // Spatial partition part of updateCull, traversals spread over LLParallelCull
+    void cullPartitionsParallel(LLCamera& camera);
     void createObjects(F32 max_dtime);
     void createObject(LLViewerObject* vobj);
     void processPartitionQ();
@@ -0,0 +1,132 @@
+/**
+ * @file lllinksetcomplexity_test.cpp
+ * @brief Attached linkset complexity cache tests
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../lllinksetcomplexity.h"
+
+#include "lltut.h"
+
+// Covers the cache itself: which entries survive a pass and which need
+// recomputing. What invalidates a linkset is up to LLVOAvatar and the
+// objects, and is not exercised here.
+namespace tut
+{
+    struct linkset_complexity_data
+    {
+        linkset_complexity_data()
+        {
+            mHat.generate();
+            mShoes.generate();
+        }
+
+        // One complexity pass over the given linksets, as
+        // LLVOAvatar::calculateUpdateRenderComplexity() makes it, costing
+        // those that are not valid at cost. Returns how many it costed.
+        U32 pass(std::initializer_list<LLUUID> attached, F32 cost)
+        {
+            U32 computed = 0;
+            mCache.beginPass();
+            for (const LLUUID& root_id : attached)
+            {
+                LLLinksetComplexityCache::Linkset& linkset = mCache.get(root_id);
+                if (!linkset.mValid)
+                {
+                    linkset.mCost = cost;
+                    linkset.mValid = true;
+                    ++computed;
+                }
+            }
+            mCache.endPass();
+            return computed;
+        }
+
+        LLLinksetComplexityCache mCache;
+        LLUUID mHat;
+        LLUUID mShoes;
+    };
+    typedef test_group<linkset_complexity_data> linkset_complexity_group;
+    typedef linkset_complexity_group::object linkset_complexity_object;
+    tut::linkset_complexity_group linkset_complexity_test("LLLinksetComplexityCache");
+
+    template<> template<>
+    void linkset_complexity_object::test<1>()
+    {
+        set_test_name("get() and endPass()");
+
+        mCache.beginPass();
+        LLLinksetComplexityCache::Linkset& hat = mCache.get(mHat);
+        ensure("new linksets start invalid", !hat.mValid);
+        ensure("and not yet valid in the cache", !mCache.isValid(mHat));
+        hat.mCost = 1000.f;
+        hat.mValid = true;
+        mCache.endPass();
+        ensure("costed linkset kept", mCache.isValid(mHat));
+        ensure_equals("one linkset", mCache.size(), 1U);
+
+        ensure_equals("second pass costs only the new linkset", pass({ mHat, mShoes }, 2500.f), 1U);
+        ensure_equals("cost kept across passes", mCache.get(mHat).mCost, 1000.f);
+        ensure_equals("new linkset costed", mCache.get(mShoes).mCost, 2500.f);
+        ensure_equals("unchanged linksets are not costed again", pass({ mHat, mShoes }, 0.f), 0U);
+    }
+
+    template<> template<>
+    void linkset_complexity_object::test<2>()
+    {
+        set_test_name("invalidate()");
+
+        pass({ mHat, mShoes }, 1000.f);
+        mCache.invalidate(mHat);
+        ensure("invalidated linkset", !mCache.isValid(mHat));
+        ensure("other linkset untouched", mCache.isValid(mShoes));
+        ensure_equals("only the invalidated linkset is costed", pass({ mHat, mShoes }, 1400.f), 1U);
+        ensure_equals("with its new cost", mCache.get(mHat).mCost, 1400.f);
+        ensure_equals("other cost kept", mCache.get(mShoes).mCost, 1000.f);
+
+        LLUUID unknown;
+        unknown.generate();
+        mCache.invalidate(unknown);
+        ensure_equals("invalidating an unknown linkset adds nothing", mCache.size(), 2U);
+    }
+
+    template<> template<>
+    void linkset_complexity_object::test<3>()
+    {
+        set_test_name("detach, reattach and clear()");
+
+        pass({ mHat, mShoes }, 1000.f);
+        pass({ mShoes }, 1000.f);
+        ensure_equals("detached linkset forgotten", mCache.size(), 1U);
+        ensure("detached linkset no longer valid", !mCache.isValid(mHat));
+        ensure_equals("reattached linkset costed again", pass({ mHat, mShoes }, 300.f), 1U);
+        ensure_equals("with its new cost", mCache.get(mHat).mCost, 300.f);
+
+        mCache.clear();
+        ensure_equals("clear() forgets everything", mCache.size(), 0U);
+        ensure_equals("and every linkset is costed again", pass({ mHat, mShoes }, 0.f), 2U);
+    }
+}
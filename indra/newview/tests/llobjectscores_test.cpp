@@ -0,0 +1,294 @@
+/**
+ * @file llobjectscores_test.cpp
+ * @brief Object score table tests and scoring benchmark
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llobjectscores.h"
+
+#include "llmath.h"
+
+#include "lltut.h"
+#include "lltimer.h"
+#include "stringize.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Bounds
+    {
+        LLVector3 mCenter;
+        F32 mRadius;
+        F32 mMaxScale;
+        F32 mMidScale;
+        F32 mMinScale;
+        U32 mFlags;
+    };
+
+    // Objects spread over a 3x3 block of regions around the eye, with a few
+    // right on top of it and a few HUD objects.
+    std::vector<Bounds> make_bounds(U32 count, U32 seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<F32> xy(-256.f, 512.f);
+        std::uniform_real_distribution<F32> z(0.f, 200.f);
+        std::uniform_real_distribution<F32> extent(0.01f, 64.f);
+
+        std::vector<Bounds> bounds(count);
+        for (U32 i = 0; i < count; ++i)
+        {
+            Bounds& b = bounds[i];
+            if (i % 37 == 0)
+            {
+                b.mCenter.set(128.f, 128.f, 30.f);
+            }
+            else
+            {
+                b.mCenter.set(xy(rng), xy(rng), z(rng));
+            }
+            F32 s[3] = { extent(rng), extent(rng), extent(rng) };
+            std::sort(s, s + 3);
+            b.mMinScale = s[0];
+            b.mMidScale = s[1];
+            b.mMaxScale = s[2];
+            b.mRadius = LLVector3(s[0], s[1], s[2]).length() * 0.5f;
+            b.mFlags = (i % 101 == 0) ? LLObjectScores::HUD : 0;
+        }
+        return bounds;
+    }
+
+    LLObjectScores::Params make_params()
+    {
+        LLObjectScores::Params params;
+        params.mEye.set(128.f, 128.f, 30.f);
+        params.mPixelMeterRatio = 1200.f;
+        params.mScreenPixelArea = 1920.f * 1080.f;
+        params.mDistanceFactor = 1.f / 1.125f;
+        params.mLODRampDistance = 2.f;
+        params.mNearRadius = 16.f;
+        params.mMaxDistance = 256.f;
+        return params;
+    }
+
+    void fill(LLObjectScores& scores, const std::vector<Bounds>& bounds)
+    {
+        scores.resize((U32)bounds.size());
+        for (U32 i = 0; i < bounds.size(); ++i)
+        {
+            const Bounds& b = bounds[i];
+            scores.set(i, b.mCenter, b.mRadius, b.mMaxScale, b.mMidScale, b.mMinScale, b.mFlags);
+        }
+    }
+
+    // The per-object computations LLObjectScores replaces, one object at a time.
+    struct Reference
+    {
+        F32 mLODDistance;
+        F32 mLODAdjusted;
+        F32 mAppAngle;
+        F32 mPixelArea;
+        F32 mInterest;
+    };
+
+    Reference reference(const Bounds& b, const LLObjectScores::Params& params)
+    {
+        Reference r;
+        F32 dist = (params.mEye - b.mCenter).length();
+
+        // LLViewerObject::setPixelAreaAndAngle
+        F32 range = dist - b.mMinScale/2;
+        if (range < 0.001f || (b.mFlags & LLObjectScores::HUD))
+        {
+            r.mAppAngle = 180.f;
+            r.mPixelArea = params.mScreenPixelArea;
+        }
+        else
+        {
+            r.mAppAngle = (F32)atan2(b.mMaxScale, range) * RAD_TO_DEG;
+            F32 pixels_per_meter = params.mPixelMeterRatio / range;
+            r.mPixelArea = (pixels_per_meter * b.mMaxScale) * (pixels_per_meter * b.mMidScale);
+            if (r.mPixelArea > params.mScreenPixelArea)
+            {
+                r.mAppAngle = 180.f;
+                r.mPixelArea = params.mScreenPixelArea;
+            }
+        }
+
+        // LLDrawable::updateDistance, LLVOVolume::calcLOD
+        r.mLODDistance = ll_round(dist, 0.01f);
+        F32 distance = r.mLODDistance * params.mDistanceFactor;
+        F32 rampDist = params.mLODRampDistance;
+        if (distance < rampDist)
+        {
+            distance *= 1.0f/rampDist;
+            distance *= distance;
+            distance *= rampDist;
+        }
+        r.mLODAdjusted = distance * (F_PI/3.f);
+
+        // LLViewerRegion::updateVisibleEntries
+        F32 near_dist = dist - params.mNearRadius;
+        if (near_dist <= 0.f)
+        {
+            r.mInterest = LLObjectScores::LARGE_INTEREST;
+        }
+        else if (near_dist + params.mNearRadius < params.mMaxDistance + b.mRadius)
+        {
+            r.mInterest = (b.mRadius * b.mRadius) / near_dist;
+        }
+        else
+        {
+            r.mInterest = 0.f;
+        }
+        return r;
+    }
+
+    bool close(F32 a, F32 b)
+    {
+        return fabsf(a - b) <= 1.0e-5f * llmax(1.f, fabsf(a), fabsf(b));
+    }
+}
+
+namespace tut
+{
+    struct objectscores_test
+    {
+    };
+    typedef test_group<objectscores_test> objectscores_t;
+    typedef objectscores_t::object objectscores_object_t;
+    tut::objectscores_t tut_objectscores("LLObjectScores");
+
+    template<> template<>
+    void objectscores_object_t::test<1>()
+    {
+        set_test_name("scores match per-object computation");
+        const LLObjectScores::Params params = make_params();
+        // sizes on both sides of the four wide loop
+        const U32 counts[] = { 0, 1, 3, 4, 5, 1001 };
+        for (U32 count : counts)
+        {
+            std::vector<Bounds> bounds = make_bounds(count, count);
+            LLObjectScores scores;
+            fill(scores, bounds);
+            scores.score(params);
+
+            ensure_equals("size", scores.size(), count);
+            for (U32 i = 0; i < count; ++i)
+            {
+                const Reference r = reference(bounds[i], params);
+                const std::string what = STRINGIZE("count " << count << " entry " << i);
+                ensure(what + " scored", scores.isScored(i));
+                // rounded to cm, a sqrt ulp may land on the other side
+                ensure(what + " LOD distance", fabsf(scores.getLODDistance(i) - r.mLODDistance) <= 0.0101f);
+                if (scores.getLODDistance(i) == r.mLODDistance)
+                {
+                    ensure(what + " adjusted", close(scores.getLODAdjustedDistance(i), r.mLODAdjusted));
+                }
+                ensure(what + " angle", close(scores.getAppAngle(i), r.mAppAngle));
+                ensure(what + " area", close(scores.getPixelArea(i), r.mPixelArea));
+                ensure(what + " interest", close(scores.getInterest(i), r.mInterest));
+            }
+        }
+    }
+
+    template<> template<>
+    void objectscores_object_t::test<2>()
+    {
+        set_test_name("set and remove keep entries in step");
+        std::vector<Bounds> bounds = make_bounds(9, 7);
+        LLObjectScores scores;
+        for (U32 i = 0; i < bounds.size(); ++i)
+        {
+            ensure_equals("add returns the end", scores.add(), i);
+        }
+        fill(scores, bounds);
+        ensure("unscored after set", !scores.isScored(0));
+
+        const LLObjectScores::Params params = make_params();
+        scores.score(params);
+        ensure("eye kept", scores.getEye() == params.mEye);
+
+        // drop entry 2, the last one takes its place
+        scores.removeSwap(2);
+        bounds[2] = bounds.back();
+        bounds.pop_back();
+        ensure_equals("size after remove", scores.size(), (U32)bounds.size());
+        ensure("moved entry keeps its score", close(scores.getInterest(2), reference(bounds[2], params).mInterest));
+        ensure_equals("moved entry keeps its flags", scores.getFlags(2), bounds[2].mFlags);
+
+        scores.set(3, bounds[3].mCenter, bounds[3].mRadius, 1.f, 1.f, 1.f, LLObjectScores::USER_FLAG_0);
+        ensure("unscored after set", !scores.isScored(3));
+        ensure("user flag kept", scores.getFlags(3) & LLObjectScores::USER_FLAG_0);
+        scores.score(params);
+        ensure("scored", scores.isScored(3));
+        ensure("user flag survives scoring", scores.getFlags(3) & LLObjectScores::USER_FLAG_0);
+
+        scores.clear();
+        ensure_equals("cleared", scores.size(), 0U);
+    }
+
+    template<> template<>
+    void objectscores_object_t::test<3>()
+    {
+        set_test_name("scoring benchmark");
+        const U32 count = 50000;
+        const U32 passes = 100;
+        std::vector<Bounds> bounds = make_bounds(count, 1);
+        LLObjectScores::Params params = make_params();
+
+        std::vector<Reference> refs(count);
+        F32 sum = 0.f;
+        LLTimer timer;
+        for (U32 pass = 0; pass < passes; ++pass)
+        {
+            params.mEye.mV[VX] = 128.f + pass * 0.1f;
+            for (U32 i = 0; i < count; ++i)
+            {
+                refs[i] = reference(bounds[i], params);
+            }
+            sum += refs[pass].mInterest;
+        }
+        const F64 serial_ms = timer.getElapsedTimeF64() * 1000.0 / passes;
+
+        LLObjectScores scores;
+        fill(scores, bounds);
+        timer.reset();
+        for (U32 pass = 0; pass < passes; ++pass)
+        {
+            params.mEye.mV[VX] = 128.f + pass * 0.1f;
+            scores.score(params);
+            sum -= scores.getInterest(pass);
+        }
+        const F64 table_ms = timer.getElapsedTimeF64() * 1000.0 / passes;
+
+        ensure("same interest", fabsf(sum) < 1.f);
+
+        LL_INFOS("Benchmark") << count << " objects: " << serial_ms << " ms per object, "
+            << table_ms << " ms batched" << LL_ENDL;
+    }
+}
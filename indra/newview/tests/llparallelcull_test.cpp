@@ -0,0 +1,322 @@
+/**
+ * @file llparallelcull_test.cpp
+ * @brief Parallel partition cull tests and CPU-only cull benchmark
+ *
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llparallelcull.h"
+
+#include "llcamera.h"
+#include "llvolumeoctree.h"
+
+#include "lltut.h"
+#include "lltimer.h"
+#include "stringize.h"
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+    typedef LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*> node_t;
+
+    // One spatial partition's worth of objects.  Each object is a single
+    // "triangle" spanning its bounding box, which is all the cull looks at.
+    struct BenchPartition
+    {
+        BenchPartition(const LLVector3& region_origin, U32 count, F32 max_size, U32 seed)
+            : mVerts(count * 3),
+              mObjects(new LLVolumeTriangle[count])
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<F32> xy(0.f, 256.f);
+            std::uniform_real_distribution<F32> z(20.f, 120.f);
+            std::uniform_real_distribution<F32> extent(0.25f, max_size);
+
+            LLVector4a center(region_origin.mV[0] + 128.f, region_origin.mV[1] + 128.f, 64.f);
+            LLVector4a size(128.f, 128.f, 128.f);
+            mOctree = new LLVolumeOctree(center, size);
+
+            for (U32 i = 0; i < count; ++i)
+            {
+                LLVector4a pos(region_origin.mV[0] + xy(rng), region_origin.mV[1] + xy(rng), z(rng));
+                LLVector4a half(extent(rng), extent(rng), extent(rng));
+
+                LLVector4a* v = &mVerts[i * 3];
+                v[0].setSub(pos, half);
+                v[1].setAdd(pos, half);
+                v[2] = pos;
+
+                LLVolumeTriangle* tri = &mObjects[i];
+                tri->mV[0] = &v[0];
+                tri->mV[1] = &v[1];
+                tri->mV[2] = &v[2];
+                tri->mPositionGroup = pos;
+                tri->mRadius = half.getLength3().getF32();
+                mOctree->insert(tri);
+            }
+
+            while (!mOctree->balance()) { }
+
+            LLVolumeOctreeRebound rebound;
+            rebound.traverse(mOctree);
+        }
+
+        std::vector<LLVector4a> mVerts;
+        std::unique_ptr<LLVolumeTriangle[]> mObjects;
+        LLPointer<LLVolumeOctree> mOctree;   // declared last, torn down before the objects
+    };
+
+    // Same shape as LLViewerOctreeCull::traverse: test a node's bounds
+    // against the frustum, take whole subtrees once a node is fully
+    // inside, and record every non-empty node reached.
+    class BenchCull : public LLOctreeTraveler<LLVolumeTriangle, LLVolumeTriangle*>
+    {
+    public:
+        BenchCull(LLCamera* camera, std::vector<const node_t*>& visible)
+            : mCamera(camera), mVisible(visible), mRes(0)
+        {
+        }
+
+        void traverse(const node_t* node) override
+        {
+            if (mRes == 2)
+            {
+                LLOctreeTraveler<LLVolumeTriangle, LLVolumeTriangle*>::traverse(node);
+                return;
+            }
+
+            const LLVolumeOctreeListener* bounds = (const LLVolumeOctreeListener*)node->getListener(0);
+            mRes = mCamera->AABBInFrustum(bounds->mBounds[0], bounds->mBounds[1]);
+            if (mRes)
+            {
+                LLOctreeTraveler<LLVolumeTriangle, LLVolumeTriangle*>::traverse(node);
+            }
+            mRes = 0;
+        }
+
+        void visit(const node_t* branch) override
+        {
+            if (branch->getElementCount())
+            {
+                mVisible.push_back(branch);
+            }
+        }
+
+    private:
+        LLCamera* mCamera;
+        std::vector<const node_t*>& mVisible;
+        S32 mRes;
+    };
+
+    // A 3x3 block of regions around the camera with partitions sized like
+    // a busy sim: lots of prims, fewer trees, avatars and particles.
+    struct BenchScene
+    {
+        BenchScene()
+        {
+            const U32 counts[] = { 4000, 1200, 400, 300, 200, 120, 60, 30 };
+            const F32 sizes[] = { 6.f, 12.f, 8.f, 3.f, 2.f, 1.f, 20.f, 1.f };
+            U32 seed = 1;
+            for (S32 ry = -1; ry <= 1; ++ry)
+            {
+                for (S32 rx = -1; rx <= 1; ++rx)
+                {
+                    LLVector3 origin(rx * 256.f, ry * 256.f, 0.f);
+                    for (U32 p = 0; p < LL_ARRAY_SIZE(counts); ++p)
+                    {
+                        mPartitions.emplace_back(new BenchPartition(origin, counts[p], sizes[p], seed++));
+                    }
+                }
+            }
+        }
+
+        std::vector<std::unique_ptr<BenchPartition> > mPartitions;
+    };
+
+    // Perspective camera at origin looking along at, near/far corners
+    // built the same way LLViewerCamera does for a non-ortho view.
+    void setup_camera(LLCamera& camera, const LLVector3& origin, F32 yaw)
+    {
+        LLVector3 at(cosf(yaw), sinf(yaw), -0.1f);
+        at.normVec();
+        LLVector3 up(0.f, 0.f, 1.f);
+        LLVector3 left = up % at;
+        left.normVec();
+        up = at % left;
+
+        camera.setOrigin(origin);
+        camera.setAxes(at, left, up);
+        camera.setView(1.0f);
+        camera.setAspect(16.f / 9.f);
+        camera.setNear(0.5f);
+        camera.setFar(256.f);
+
+        F32 half_h = tanf(camera.getView() * 0.5f) * camera.getNear();
+        F32 half_w = half_h * camera.getAspect();
+        LLVector3 near_center = origin + at * camera.getNear();
+
+        LLVector3 frust[8];
+        frust[0] = near_center + left * half_w - up * half_h;
+        frust[1] = near_center - left * half_w - up * half_h;
+        frust[2] = near_center - left * half_w + up * half_h;
+        frust[3] = near_center + left * half_w + up * half_h;
+        for (U32 i = 0; i < 4; ++i)
+        {
+            LLVector3 dir = frust[i] - origin;
+            dir.normVec();
+            frust[i + 4] = origin + dir * camera.getFar();
+        }
+        camera.calcAgentFrustumPlanes(frust);
+    }
+
+    void cull_scene(BenchScene& scene, LLCamera& camera, std::vector<std::vector<const node_t*> >& visible)
+    {
+        visible.resize(scene.mPartitions.size());
+        LLParallelCull::run((U32)scene.mPartitions.size(), [&](U32 i)
+            {
+                visible[i].clear();
+                BenchCull culler(&camera, visible[i]);
+                culler.traverse(scene.mPartitions[i]->mOctree);
+            });
+    }
+
+    size_t count_visible(const std::vector<std::vector<const node_t*> >& visible)
+    {
+        size_t count = 0;
+        for (const auto& part : visible)
+        {
+            count += part.size();
+        }
+        return count;
+    }
+}
+
+namespace tut
+{
+    struct parallelcull_test
+    {
+        parallelcull_test()
+        {
+            LLParallelCull::initClass(3);
+        }
+
+        ~parallelcull_test()
+        {
+            LLParallelCull::cleanupClass();
+        }
+    };
+    typedef test_group<parallelcull_test> parallelcull_t;
+    typedef parallelcull_t::object parallelcull_object_t;
+    tut::parallelcull_t tut_parallelcull("LLParallelCull");
+
+    template<> template<>
+    void parallelcull_object_t::test<1>()
+    {
+        set_test_name("every job runs exactly once");
+        const U32 counts[] = { 0, 1, 2, 7, 72, 1000 };
+        for (U32 count : counts)
+        {
+            std::vector<std::atomic<U32> > runs(count);
+            for (auto& r : runs)
+            {
+                r = 0;
+            }
+            LLParallelCull::run(count, [&runs](U32 i) { ++runs[i]; });
+            for (U32 i = 0; i < count; ++i)
+            {
+                ensure_equals(STRINGIZE("count " << count << " job " << i), runs[i].load(), 1U);
+            }
+        }
+    }
+
+    template<> template<>
+    void parallelcull_object_t::test<2>()
+    {
+        set_test_name("parallel cull matches serial cull");
+        BenchScene scene;
+        LLCamera camera;
+        setup_camera(camera, LLVector3(128.f, 128.f, 40.f), 0.3f);
+
+        std::vector<std::vector<const node_t*> > serial(scene.mPartitions.size());
+        for (size_t i = 0; i < scene.mPartitions.size(); ++i)
+        {
+            BenchCull culler(&camera, serial[i]);
+            culler.traverse(scene.mPartitions[i]->mOctree);
+        }
+
+        std::vector<std::vector<const node_t*> > parallel;
+        for (U32 pass = 0; pass < 8; ++pass)
+        {
+            cull_scene(scene, camera, parallel);
+            ensure("merged result matches serial order", parallel == serial);
+        }
+        ensure("camera sees part of the scene", count_visible(serial) > 0);
+    }
+
+    template<> template<>
+    void parallelcull_object_t::test<3>()
+    {
+        set_test_name("cull pass benchmark");
+        BenchScene scene;
+        LLCamera camera;
+        std::vector<std::vector<const node_t*> > visible(scene.mPartitions.size());
+
+        const U32 passes = 200;
+        size_t serial_visible = 0;
+        LLTimer timer;
+        for (U32 pass = 0; pass < passes; ++pass)
+        {
+            setup_camera(camera, LLVector3(128.f, 128.f, 40.f), pass * 0.0314f);
+            for (size_t i = 0; i < scene.mPartitions.size(); ++i)
+            {
+                visible[i].clear();
+                BenchCull culler(&camera, visible[i]);
+                culler.traverse(scene.mPartitions[i]->mOctree);
+            }
+            serial_visible += count_visible(visible);
+        }
+        const F64 serial_ms = timer.getElapsedTimeF64() * 1000.0 / passes;
+
+        size_t parallel_visible = 0;
+        timer.reset();
+        for (U32 pass = 0; pass < passes; ++pass)
+        {
+            setup_camera(camera, LLVector3(128.f, 128.f, 40.f), pass * 0.0314f);
+            cull_scene(scene, camera, visible);
+            parallel_visible += count_visible(visible);
+        }
+        const F64 parallel_ms = timer.getElapsedTimeF64() * 1000.0 / passes;
+
+        ensure_equals("same nodes visible", parallel_visible, serial_visible);
+
+        LL_INFOS("Benchmark") << scene.mPartitions.size() << " partitions, "
+            << serial_visible / passes << " visible nodes per pass: "
+            << serial_ms << " ms serial, " << parallel_ms << " ms parallel" << LL_ENDL;
+    }
+}
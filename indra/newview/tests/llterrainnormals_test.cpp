@@ -0,0 +1,249 @@
+/**
+ * @file llterrainnormals_test.cpp
+ * @brief Tests and timings for the terrain normal kernels
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llterrainnormals.h"
+
+#include "lltut.h"
+#include "lltimer.h"
+#include "stringize.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Surface sized like LLSurface: grids per edge plus the north/east buffer.
+    struct TestSurface
+    {
+        TestSurface(U32 region_width, U32 patch_edge) :
+            mStride(region_width + 1),
+            mPatchEdge(patch_edge),
+            mHeights(mStride * mStride),
+            mNormals(mStride * mStride)
+        {
+            // rolling hills plus noise, so that normals are not trivial
+            std::mt19937 rng(region_width);
+            std::uniform_real_distribution<F32> noise(-0.5f, 0.5f);
+            for (U32 y = 0; y < mStride; y++)
+            {
+                for (U32 x = 0; x < mStride; x++)
+                {
+                    mHeights[y*mStride + x] = 20.f + 8.f*sinf(x*0.05f) * cosf(y*0.07f) + noise(rng);
+                }
+            }
+        }
+
+        // Normals for every point whose stencil stays on the surface.
+        void computeScalar(F32 mpg)
+        {
+            const S32 s = mStride;
+            for (U32 y = 2; y + 2 < mStride; y++)
+            {
+                for (U32 x = 2; x + 2 < mStride; x++)
+                {
+                    const F32 *z = &mHeights[y*s + x];
+                    mNormals[y*s + x] = LLTerrainNormals::smoothNormal(z[-2 - 2*s], z[-2 + 2*s], z[2 - 2*s], z[2 + 2*s], mpg);
+                }
+            }
+        }
+
+        void computeRows(F32 mpg)
+        {
+            for (U32 y = 2; y + 2 < mStride; y++)
+            {
+                LLTerrainNormals::smoothNormalRow(&mHeights[y*mStride + 2], mStride, 2, mpg, mStride - 4, &mNormals[y*mStride + 2]);
+            }
+        }
+
+        U32 mStride;
+        U32 mPatchEdge;
+        std::vector<F32> mHeights;
+        std::vector<LLVector3> mNormals;
+    };
+
+    // Points the band-based LLSurfacePatch::updateNormals() used to
+    // recompute for a set of invalid flags.
+    U32 band_point_count(const BOOL invalid[9], U32 n)
+    {
+        U32 count = 0;
+        if (invalid[EAST] || invalid[NORTHEAST] || invalid[SOUTHEAST])  count += 3 * (n + 1);
+        if (invalid[NORTHEAST] || invalid[NORTH] || invalid[NORTHWEST]) count += 3 * (n + 1);
+        if (invalid[NORTHWEST] || invalid[WEST] || invalid[SOUTHWEST])  count += 2 * n;
+        if (invalid[SOUTHWEST] || invalid[SOUTH] || invalid[SOUTHEAST]) count += 2 * n;
+        if (invalid[NORTHEAST])                                          count += 4;
+        if (invalid[MIDDLE])                                             count += (n - 4) * (n - 4);
+        return count;
+    }
+
+    U32 mask_point_count(const U64 *row_masks, U32 n)
+    {
+        U32 count = 0;
+        for (U32 y = 0; y <= n; y++)
+        {
+            for (U64 mask = row_masks[y]; mask; mask &= mask - 1)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+}
+
+namespace tut
+{
+    struct terrainnormals_test
+    {
+        void benchmark(const std::string &name, U32 region_width)
+        {
+            const U32 patch_edge = 16;
+            const F32 mpg = 1.f * 2;
+            TestSurface surface(region_width, patch_edge);
+            const U32 patches = (region_width / patch_edge) * (region_width / patch_edge);
+            const S32 reps = region_width > 256 ? 4 : 16;
+
+            LLTimer timer;
+            for (S32 i = 0; i < reps; i++)
+            {
+                surface.computeScalar(mpg);
+            }
+            const F64 scalar_ms = timer.getElapsedTimeF64() * 1000.0 / reps;
+            std::vector<LLVector3> scalar_normals = surface.mNormals;
+
+            timer.reset();
+            for (S32 i = 0; i < reps; i++)
+            {
+                surface.computeRows(mpg);
+            }
+            const F64 rows_ms = timer.getElapsedTimeF64() * 1000.0 / reps;
+
+            ensure(name + " row normals bit-identical",
+                   0 == memcmp(scalar_normals.data(), surface.mNormals.data(), scalar_normals.size() * sizeof(LLVector3)));
+
+            // One neighbor edge changing, which is what a LayerData patch
+            // arriving next door does to every interior patch.
+            BOOL invalid[9] = { FALSE };
+            invalid[EAST] = invalid[NORTHEAST] = invalid[SOUTHEAST] = TRUE;
+            U64 row_masks[LLTerrainNormals::MAX_PATCH_EDGE + 1];
+            LLTerrainNormals::buildDirtyRows(invalid, patch_edge, row_masks);
+
+            LL_INFOS("Benchmark") << name << ": " << patches << " patches, full rebuild "
+                << scalar_ms << " ms scalar, " << rows_ms << " ms rows; east edge update recomputes "
+                << mask_point_count(row_masks, patch_edge) << " normals per patch (was "
+                << band_point_count(invalid, patch_edge) << ")" << LL_ENDL;
+        }
+    };
+    typedef test_group<terrainnormals_test> terrainnormals_t;
+    typedef terrainnormals_t::object terrainnormals_object_t;
+    tut::terrainnormals_t tut_terrainnormals("LLTerrainNormals");
+
+    template<> template<>
+    void terrainnormals_object_t::test<1>()
+    {
+        set_test_name("row kernel matches smoothNormal for every tail length");
+        TestSurface surface(64, 16);
+        const S32 s = surface.mStride;
+        for (S32 step = 1; step <= 2; step++)
+        {
+            for (U32 count = 1; count <= 13; count++)
+            {
+                LLVector3 row[16];
+                const U32 y = 7;
+                LLTerrainNormals::smoothNormalRow(&surface.mHeights[y*s + step], s, step, 0.75f*step, count, row);
+                for (U32 i = 0; i < count; i++)
+                {
+                    const F32 *z = &surface.mHeights[y*s + step + i];
+                    LLVector3 expected = LLTerrainNormals::smoothNormal(z[-step - step*s], z[-step + step*s],
+                                                                        z[step - step*s], z[step + step*s], 0.75f*step);
+                    ensure(STRINGIZE("step " << step << " count " << count << " point " << i),
+                           0 == memcmp(&expected, &row[i], sizeof(LLVector3)));
+                }
+            }
+        }
+    }
+
+    template<> template<>
+    void terrainnormals_object_t::test<2>()
+    {
+        set_test_name("dirty rows cover every normal that reads an invalid neighbor");
+        const U32 n = 16;
+        // For each direction, the patch offset the stencil has to cross into.
+        const S32 dir_dx[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+        const S32 dir_dy[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+        for (U32 dir = 0; dir < 8; dir++)
+        {
+            BOOL invalid[9] = { FALSE };
+            invalid[dir] = TRUE;
+            U64 row_masks[LLTerrainNormals::MAX_PATCH_EDGE + 1];
+            LLTerrainNormals::buildDirtyRows(invalid, n, row_masks);
+
+            for (S32 y = 0; y <= (S32)n; y++)
+            {
+                for (S32 x = 0; x <= (S32)n; x++)
+                {
+                    bool reads_neighbor = false;
+                    for (S32 sy = -2; sy <= 2; sy += 4)
+                    {
+                        for (S32 sx = -2; sx <= 2; sx += 4)
+                        {
+                            const S32 px = (x + sx < 0) ? -1 : (x + sx >= (S32)n ? 1 : 0);
+                            const S32 py = (y + sy < 0) ? -1 : (y + sy >= (S32)n ? 1 : 0);
+                            reads_neighbor |= (px == dir_dx[dir] && py == dir_dy[dir]);
+                        }
+                    }
+                    if (reads_neighbor)
+                    {
+                        ensure(STRINGIZE("direction " << dir << " point " << x << "," << y),
+                               (row_masks[y] >> x) & 1);
+                    }
+                }
+            }
+            ensure(STRINGIZE("direction " << dir << " marks no more than the old bands"),
+                   mask_point_count(row_masks, n) <= band_point_count(invalid, n));
+        }
+
+        BOOL all[9] = { TRUE, TRUE, TRUE, TRUE, TRUE, TRUE, TRUE, TRUE, TRUE };
+        U64 row_masks[LLTerrainNormals::MAX_PATCH_EDGE + 1];
+        LLTerrainNormals::buildDirtyRows(all, n, row_masks);
+        ensure_equals("own heights changing marks the whole patch", mask_point_count(row_masks, n), (n + 1) * (n + 1));
+    }
+
+    template<> template<>
+    void terrainnormals_object_t::test<3>()
+    {
+        set_test_name("256 patch region benchmark");
+        benchmark("256m region", 256);
+    }
+
+    template<> template<>
+    void terrainnormals_object_t::test<4>()
+    {
+        set_test_name("var-region benchmark");
+        benchmark("1024m var-region", 1024);
+    }
+}